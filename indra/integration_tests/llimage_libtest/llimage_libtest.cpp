@@ -97,6 +97,11 @@ static const char USAGE[] = "\n"
 "        Results in <metric>_report.csv\n"
 " -s, --image-stats\n"
 "        Output stats for each input and output image.\n"
+" -prog, --progressive\n"
+"        Decode each j2c input the way the texture fetcher refines it, coarsest discard\n"
+"        level first, and print the time to first pixels and to full resolution\n"
+"        (which is also the total decode time), against a single full decode and a\n"
+"        full decode preceded by a preview two levels down.\n"
 "\n";
 
 // true when all image loading is done. Used by metric logging thread to know when to stop the thread.
@@ -122,6 +127,72 @@ void output_image_stats(LLPointer<LLImageFormatted> image, const std::string &fi
 	return;
 }
 
+// Decode one discard level of a j2c image from the bytes it needs, returns the time it took in ms
+F64 timed_decode(LLImageJ2C* image, S32 discard_level)
+{
+	LLTimer timer;
+	LLPointer<LLImageRaw> raw_image = new LLImageRaw;
+	image->setDiscardLevel(discard_level);
+	image->setMaxBytes(discard_level > 0 ? image->calcDataSize(discard_level) : 0);
+	image->decode(raw_image, 0.0f);
+	image->setMaxBytes(0);
+	return timer.getElapsedTimeF64() * 1000.0;
+}
+
+// Compare the decode time of refining a j2c image level by level, decoding it at once,
+// and decoding it after a coarse preview
+void output_progressive_stats(const std::string &src_filename)
+{
+	LLPointer<LLImageFormatted> image = create_image(src_filename);
+	if (image.isNull() || (image->getCodec() != IMG_CODEC_J2C))
+	{
+		std::cout << "Progressive stats only apply to j2c images, skipping " << src_filename << std::endl;
+		return;
+	}
+	if (!image->load(src_filename) || !image->updateData())
+	{
+		std::cout << "Error: Image " << src_filename << " could not be loaded" << std::endl;
+		return;
+	}
+	LLImageJ2C* j2c = (LLImageJ2C*)(image.get());
+
+	// Same floor as the decode thread uses for previews
+	S32 coarsest = MAX_DISCARD_LEVEL;
+	while ((coarsest > 0) && (((j2c->getWidth() >> coarsest) < 8) || ((j2c->getHeight() >> coarsest) < 8)))
+	{
+		coarsest--;
+	}
+
+	std::cout << "Progressive decode of : " << src_filename << ", " << j2c->getWidth() << "x" << j2c->getHeight()
+			  << ", data : " << j2c->getDataSize() << std::endl;
+
+	// All the data is at hand, so the time to full resolution is also the total decode time.
+	// A pass per discard level as more of the stream arrives, each from scratch.
+	F64 first_pixels = 0.0;
+	F64 refine_total = 0.0;
+	for (S32 d = coarsest; d >= 0; d--)
+	{
+		F64 pass = timed_decode(j2c, d);
+		if (d == coarsest)
+		{
+			first_pixels = pass;
+		}
+		refine_total += pass;
+		std::cout << "    discard " << d << " : " << (d > 0 ? j2c->calcDataSize(d) : j2c->getDataSize())
+				  << " bytes, " << pass << " ms" << std::endl;
+	}
+	std::cout << "    refine  : first pixels " << first_pixels << " ms, full resolution " << refine_total << " ms" << std::endl;
+
+	F64 direct = timed_decode(j2c, 0);
+	std::cout << "    direct  : first pixels " << direct << " ms, full resolution " << direct << " ms" << std::endl;
+
+	S32 preview_level = llmin(2, coarsest);
+	F64 preview = (preview_level > 0 ? timed_decode(j2c, preview_level) : 0.0);
+	F64 full = timed_decode(j2c, 0);
+	std::cout << "    preview : first pixels " << (preview > 0.0 ? preview : full) << " ms, full resolution "
+			  << preview + full << " ms" << std::endl;
+}
+
 // Load an image from file and return a raw (decompressed) instance of its data
 LLPointer<LLImageRaw> load_image(const std::string &src_filename, int discard_level, int* region, int load_size, bool output_stats)
 {
@@ -349,6 +420,7 @@ int main(int argc, char** argv)
 	// Other optional parsed arguments
 	bool analyze_performance = false;
 	bool image_stats = false;
+	bool progressive = false;
 	int* region = NULL;
 	int discard_level = -1;
 	int load_size = 0;
@@ -557,6 +629,10 @@ int main(int argc, char** argv)
 		{
 			image_stats = true;
 		}
+		else if (!strcmp(argv[arg], "--progressive") || !strcmp(argv[arg], "-prog"))
+		{
+			progressive = true;
+		}
 	}
 		
 	// Check arguments consistency. Exit with proper message if inconsistent.
@@ -590,6 +666,11 @@ int main(int argc, char** argv)
 	std::list<std::string>::iterator out_end = output_filenames.end();
 	for (; in_file != in_end; ++in_file, ++out_file)
 	{
+		if (progressive)
+		{
+			output_progressive_stats(*in_file);
+		}
+
 		// Load file
 		LLPointer<LLImageRaw> raw_image = load_image(*in_file, discard_level, region, load_size, image_stats);
 		if (!raw_image)
@@ -192,7 +192,7 @@ static LLTrace::BlockTimerStatHandle FTM_UPDATE_ANIMATION("Update Animation");
 static LLTrace::BlockTimerStatHandle FTM_UPDATE_HIDDEN_ANIMATION("Update Hidden Anim");
 static LLTrace::BlockTimerStatHandle FTM_UPDATE_MOTIONS("Update Motions");
 
-void LLCharacter::updateMotions(e_update_t update_type)
+void LLCharacter::updateMotions(e_update_t update_type, bool defer_blend)
 {
 	if (update_type == HIDDEN_UPDATE)
 	{
@@ -210,7 +210,7 @@ void LLCharacter::updateMotions(e_update_t update_type)
 		bool force_update = (update_type == FORCE_UPDATE);
 		{
 			LL_RECORD_BLOCK_TIME(FTM_UPDATE_MOTIONS);
-			mMotionController.updateMotions(force_update);
+			mMotionController.updateMotions(force_update, defer_blend);
 		}
 	}
 }
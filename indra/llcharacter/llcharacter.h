@@ -155,8 +155,14 @@ public:
 	virtual void requestStopMotion( LLMotion* motion );
 	
 	// periodic update function, steps the motion controller
+	// defer_blend leaves the new pose for applyPendingPose()
 	enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
-	void updateMotions(e_update_t update_type);
+	void updateMotions(e_update_t update_type, bool defer_blend = false);
+
+	// blends the pose a deferred updateMotions() left into the joints,
+	// safe on a worker thread while other characters update
+	void applyPendingPose() { mMotionController.applyPendingPose(); }
+	bool hasPendingPose() const { return mMotionController.hasPendingPose(); }
 
 	LLAnimPauseRequest requestPause();
 	BOOL areAnimationsPaused() const { return mMotionController.isPaused(); }
@@ -140,9 +140,11 @@ public:
 	typedef std::vector<LLJoint*> child_vec_t;
 	child_vec_t mChildren;
 
-	// debug statics
-	static S32		sNumTouches;
-	static S32		sNumUpdates;
+	// debug statics, running counts of this thread as avatar skeletons may
+	// be updated on the job system. Never reset, take the difference over
+	// the updates to count, which unsigned wrap around keeps right.
+	static thread_local U32	sNumTouches;
+	static thread_local U32	sNumUpdates;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
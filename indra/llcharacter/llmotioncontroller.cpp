@@ -141,6 +141,7 @@ LLMotionController::LLMotionController()
 	  mLastTime(0.0f),
 	  mHasRunOnce(FALSE),
 	  mPaused(FALSE),
+	  mPendingPose(false),
 	  mPausedFrame(0),
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
@@ -811,8 +812,11 @@ void LLMotionController::updateLoadingMotions()
 //-----------------------------------------------------------------------------
 // updateMotion()
 //-----------------------------------------------------------------------------
-void LLMotionController::updateMotions(bool force_update)
+void LLMotionController::updateMotions(bool force_update, bool defer_blend)
 {
+	// A pose nobody applied would be blended with the next one
+	applyPendingPose();
+
     // SL-763: "Distant animated objects run at super fast speed"
     // The use_quantum optimization or possibly the associated code in setTimeStamp()
     // does not work as implemented.
@@ -889,6 +893,10 @@ void LLMotionController::updateMotions(bool force_update)
 		{
 			mPoseBlender.blendAndCache(TRUE);
 		}
+		else if (defer_blend)
+		{
+			mPendingPose = true;
+		}
 		else
 		{
 			mPoseBlender.blendAndApply();
@@ -899,12 +907,26 @@ void LLMotionController::updateMotions(bool force_update)
 //	LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
 }
 
+//-----------------------------------------------------------------------------
+// applyPendingPose()
+//-----------------------------------------------------------------------------
+void LLMotionController::applyPendingPose()
+{
+	if (mPendingPose)
+	{
+		mPendingPose = false;
+		mPoseBlender.blendAndApply();
+	}
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
 //-----------------------------------------------------------------------------
 void LLMotionController::updateMotionsMinimal()
 {
+	applyPendingPose();
+
 	// Always update mPrevTimerElapsed
 	mPrevTimerElapsed = mTimer.getElapsedTimeF32();
 
@@ -1089,6 +1111,8 @@ void LLMotionController::deactivateAllMotions()
 //-----------------------------------------------------------------------------
 void LLMotionController::flushAllMotions()
 {
+	applyPendingPose();
+
 	std::vector<std::pair<LLUUID,F32> > active_motions;
 	active_motions.reserve(mActiveMotions.size());
 	for(auto motionp : mActiveMotions)
@@ -131,7 +131,15 @@ public:
 	// invokes the update handlers for each active motion
 	// activates sequenced motions
 	// deactivates terminated motions`
-	void updateMotions(bool force_update = false);
+	// defer_blend leaves blending the new pose into the joints to
+	// applyPendingPose()
+	void updateMotions(bool force_update = false, bool defer_blend = false);
+
+	// blends the pose a deferred updateMotions() left into the joints.
+	// Only touches this controller's joints, so other characters may be
+	// updated on other threads meanwhile.
+	void applyPendingPose();
+	bool hasPendingPose() const { return mPendingPose; }
 
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
@@ -223,6 +231,7 @@ protected:
 	F32					mLastTime;
 	BOOL				mHasRunOnce;
 	BOOL				mPaused;
+	bool				mPendingPose;
 	U64					mPausedFrame;
 	F32					mTimeStep;
 	S32					mTimeStepCount;
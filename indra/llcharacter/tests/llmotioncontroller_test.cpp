@@ -0,0 +1,357 @@
+/**
+ * @file llmotioncontroller_test.cpp
+ * @brief Deferred pose blending of LLMotionController, and a benchmark of
+ * animating a crowd of avatars on the job system
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llcharacter.h"
+#include "../lljoint.h"
+#include "../lljointstate.h"
+#include "../llmotion.h"
+#include "../llmotioncontroller.h"
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "lljobsystem.h"
+#include "lltimer.h"
+#include "v3dmath.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	const S32 JOINT_COUNT = 100;		// about the bones an avatar skeleton animates
+	const S32 SAMPLE_COUNT = 30;		// recorded poses per animation
+
+	// Frame of the recordings every motion plays, rather than the time, so
+	// that avatars updated at different times end up in the same pose
+	S32 sRecordedFrame = 0;
+
+	F32 frand(U32& seed)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return (F32)(seed >> 8) / (F32)(1 << 24);
+	}
+
+	// Joint rotations sampled from an animation
+	struct LLRecording
+	{
+		LLRecording()
+		{
+			U32 seed = 17;
+			for (S32 s = 0; s < SAMPLE_COUNT; ++s)
+			{
+				for (S32 j = 0; j < JOINT_COUNT; ++j)
+				{
+					LLVector3 axis(frand(seed) - 0.5f, frand(seed) - 0.5f, frand(seed) - 0.5f);
+					axis.normVec();
+					mRotations[s][j].setAngleAxis(frand(seed) * F_PI_BY_TWO, axis);
+				}
+			}
+		}
+
+		LLQuaternion mRotations[SAMPLE_COUNT][JOINT_COUNT];
+	};
+
+	const LLRecording& get_recording()
+	{
+		static const LLRecording recording;
+		return recording;
+	}
+
+	// Plays back the recording from a sample picked by its id, on every joint
+	class LLRecordedMotion : public LLMotion
+	{
+	public:
+		LLRecordedMotion(const LLUUID& id)
+		:	LLMotion(id),
+			mOffset(id.mData[0] % SAMPLE_COUNT)
+		{
+		}
+
+		static LLMotion* create(const LLUUID& id) { return new LLRecordedMotion(id); }
+
+		BOOL getLoop() override { return TRUE; }
+		F32 getDuration() override { return 1.f; }
+		F32 getEaseInDuration() override { return 0.f; }
+		F32 getEaseOutDuration() override { return 0.f; }
+		LLJoint::JointPriority getPriority() override { return LLJoint::MEDIUM_PRIORITY; }
+		LLMotionBlendType getBlendType() override { return NORMAL_BLEND; }
+		F32 getMinPixelArea() override { return 0.f; }
+
+		LLMotionInitStatus onInitialize(LLCharacter* character) override
+		{
+			for (S32 j = 0; j < JOINT_COUNT; ++j)
+			{
+				LLPointer<LLJointState> state = new LLJointState(character->getCharacterJoint(j));
+				state->setUsage(LLJointState::ROT);
+				addJointState(state);
+				mStates.push_back(state);
+			}
+			return STATUS_SUCCESS;
+		}
+
+		BOOL onActivate() override { return TRUE; }
+
+		BOOL onUpdate(F32 active_time, U8* joint_mask) override
+		{
+			const S32 sample = (sRecordedFrame + mOffset) % SAMPLE_COUNT;
+			for (S32 j = 0; j < JOINT_COUNT; ++j)
+			{
+				mStates[j]->setRotation(get_recording().mRotations[sample][j]);
+			}
+			return TRUE;
+		}
+
+		void onDeactivate() override {}
+
+	private:
+		S32 mOffset;
+		std::vector<LLPointer<LLJointState> > mStates;
+	};
+
+	// Two motions of the same priority, so that every joint is blended
+	const LLUUID WALK_ID("6ed24bd8-91aa-4b12-ccc7-c97c857ab4e0");
+	const LLUUID WAVE_ID("c541c47f-e0c0-058b-ad1a-d6ae3a4584d9");
+
+	// A character with a branching skeleton, as an avatar without its meshes
+	class LLTestAvatar : public LLCharacter
+	{
+	public:
+		LLTestAvatar()
+		:	mJoints(new LLJoint[JOINT_COUNT])
+		{
+			for (S32 j = 0; j < JOINT_COUNT; ++j)
+			{
+				mJoints[j].setup(llformat("joint%d", j), j ? &mJoints[(j - 1) / 3] : nullptr);
+				mJoints[j].setJointNum(j);
+				mJoints[j].setPosition(LLVector3(0.f, 0.05f * (j % 3), 0.1f));
+			}
+			registerMotion(WALK_ID, LLRecordedMotion::create);
+			registerMotion(WAVE_ID, LLRecordedMotion::create);
+			startMotion(WALK_ID);
+			startMotion(WAVE_ID);
+		}
+
+		// What LLVOAvatar::updateCharacter() and updatePose() do for animation
+		void animate()
+		{
+			getMotionController().updateMotions();
+			mJoints[0].updateWorldMatrixChildren();
+		}
+
+		void updatePose()
+		{
+			applyPendingPose();
+			mJoints[0].updateWorldMatrixChildren();
+		}
+
+		bool samePose(LLTestAvatar& other)
+		{
+			for (S32 j = 0; j < JOINT_COUNT; ++j)
+			{
+				const LLMatrix4& mine = mJoints[j].getXform()->getWorldMatrix();
+				const LLMatrix4& theirs = other.mJoints[j].getXform()->getWorldMatrix();
+				for (S32 k = 0; k < 16; ++k)
+				{
+					if (mine.mMatrix[k / 4][k % 4] != theirs.mMatrix[k / 4][k % 4])
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		LLJoint& joint(S32 j) { return mJoints[j]; }
+
+		const char* getAnimationPrefix() override { return "avatar"; }
+		LLJoint* getRootJoint() override { return &mJoints[0]; }
+		LLVector3 getCharacterPosition() override { return LLVector3::zero; }
+		LLQuaternion getCharacterRotation() override { return LLQuaternion::DEFAULT; }
+		LLVector3 getCharacterVelocity() override { return LLVector3::zero; }
+		LLVector3 getCharacterAngularVelocity() override { return LLVector3::zero; }
+		void getGround(const LLVector3& inPos, LLVector3& outPos, LLVector3& outNorm) override
+		{
+			outPos = inPos;
+			outPos.mV[VZ] = 0.f;
+			outNorm = LLVector3::z_axis;
+		}
+		LLJoint* getCharacterJoint(U32 i) override { return i < (U32)JOINT_COUNT ? &mJoints[i] : nullptr; }
+		F32 getTimeDilation() override { return 1.f; }
+		F32 getPixelArea() const override { return 100000.f; }
+		LLPolyMesh* getHeadMesh() override { return nullptr; }
+		LLPolyMesh* getUpperBodyMesh() override { return nullptr; }
+		LLVector3d getPosGlobalFromAgent(const LLVector3& position) override { return LLVector3d(position); }
+		LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override { return LLVector3(position); }
+		void addDebugText(const std::string& text) override {}
+		const LLUUID& getID() const override { return LLUUID::null; }
+
+	private:
+		std::unique_ptr<LLJoint[]> mJoints;
+	};
+
+	static LLJobType sAnimateAvatarJobType("animate_avatar");
+
+	typedef std::vector<std::unique_ptr<LLTestAvatar> > avatar_list_t;
+
+	void make_avatars(S32 count, avatar_list_t& avatars)
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			avatars.emplace_back(new LLTestAvatar());
+		}
+	}
+
+	// Motions on this thread, then the poses on the job system, as
+	// LLViewerObjectList::update() does for the avatars around us
+	void animate_parallel(avatar_list_t& avatars)
+	{
+		for (auto& avatar : avatars)
+		{
+			avatar->getMotionController().updateMotions(false, true);
+		}
+
+		LLJobSystem::job_list_t jobs;
+		for (auto& avatar : avatars)
+		{
+			LLTestAvatar* avatarp = avatar.get();
+			jobs.push_back(LLJobSystem::getInstance()->submit(sAnimateAvatarJobType,
+				[avatarp]()
+				{
+					avatarp->updatePose();
+				}, LLJobSystem::PRIORITY_HIGH));
+		}
+		for (const LLJobSystem::job_ptr_t& job : jobs)
+		{
+			LLJobSystem::getInstance()->wait(job);
+		}
+	}
+}
+
+namespace tut
+{
+	struct motioncontroller_data
+	{
+		motioncontroller_data()
+		{
+			// Param singletons can only be initialized once per process
+			if (!LLJobSystem::instanceExists())
+			{
+				LLJobSystem::initParamSingleton(llmax(2U, std::thread::hardware_concurrency()) - 1);
+			}
+			sRecordedFrame = 0;
+		}
+	};
+	typedef test_group<motioncontroller_data> motioncontroller_test;
+	typedef motioncontroller_test::object motioncontroller_object;
+	tut::motioncontroller_test motioncontroller("LLMotionController");
+
+	template<> template<>
+	void motioncontroller_object::test<1>()
+	{
+		set_test_name("Deferred blend leaves the joints alone until applied");
+		LLTestAvatar immediate, deferred;
+		for (sRecordedFrame = 0; sRecordedFrame < 10; ++sRecordedFrame)
+		{
+			const LLQuaternion before = deferred.joint(5).getRotation();
+			immediate.animate();
+			deferred.getMotionController().updateMotions(false, true);
+			ensure("pose pending", deferred.hasPendingPose());
+			ensure("joint untouched", deferred.joint(5).getRotation() == before);
+
+			deferred.updatePose();
+			ensure("pose applied", !deferred.hasPendingPose());
+			ensure("same pose", deferred.samePose(immediate));
+		}
+
+		// A pose nobody applied is not blended into the next one
+		deferred.getMotionController().updateMotions(false, true);
+		deferred.animate();
+		immediate.animate();
+		ensure("no stale pose", deferred.samePose(immediate));
+	}
+
+	template<> template<>
+	void motioncontroller_object::test<2>()
+	{
+		set_test_name("Poses updated on the job system match serial ones");
+		const S32 AVATARS = 16;
+		avatar_list_t serial, parallel;
+		make_avatars(AVATARS, serial);
+		make_avatars(AVATARS, parallel);
+
+		for (sRecordedFrame = 0; sRecordedFrame < 20; ++sRecordedFrame)
+		{
+			for (auto& avatar : serial)
+			{
+				avatar->animate();
+			}
+			animate_parallel(parallel);
+
+			for (S32 i = 0; i < AVATARS; ++i)
+			{
+				ensure("same pose", parallel[i]->samePose(*serial[i]));
+			}
+		}
+	}
+
+	template<> template<>
+	void motioncontroller_object::test<3>()
+	{
+		set_test_name("Crowd animation time");
+		const S32 AVATARS = 60;
+		const S32 FRAMES = 100;
+		avatar_list_t serial, parallel;
+		make_avatars(AVATARS, serial);
+		make_avatars(AVATARS, parallel);
+
+		LLTimer timer;
+		for (sRecordedFrame = 0; sRecordedFrame < FRAMES; ++sRecordedFrame)
+		{
+			for (auto& avatar : serial)
+			{
+				avatar->animate();
+			}
+		}
+		const F64 serial_time = timer.getElapsedTimeF64() / FRAMES;
+
+		timer.reset();
+		for (sRecordedFrame = 0; sRecordedFrame < FRAMES; ++sRecordedFrame)
+		{
+			animate_parallel(parallel);
+		}
+		const F64 parallel_time = timer.getElapsedTimeF64() / FRAMES;
+
+		std::cout << "\nAnimating " << AVATARS << " avatars of " << JOINT_COUNT << " joints on "
+				  << LLJobSystem::getInstance()->getWorkerCount() << " workers: serial "
+				  << serial_time * 1000.0 << " ms, parallel " << parallel_time * 1000.0
+				  << " ms per frame" << std::endl;
+	}
+}
@@ -0,0 +1,409 @@
+/**
+ * @file lljobsystem.cpp
+ * @brief Shared work stealing pool of worker threads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lljobsystem.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "llthread.h"
+#include "lltimer.h"
+#include "lltracethreadrecorder.h"
+
+using namespace std::chrono_literals;
+
+// Worker queue index of the current thread, -1 if it is not one of the pool's workers
+static thread_local S32 sWorkerIndex = -1;
+
+// Worker threads hand their trace data to the main recorder after this many jobs, and when idle
+static const U32 TRACE_PUSH_INTERVAL = 64;
+
+//============================================================================
+
+LLJobType::LLJobType(const std::string& name)
+:	mCount(("job_" + name + "_count").c_str(), "Jobs run"),
+	mRunTime(("job_" + name + "_run").c_str(), "Time spent running a job"),
+	mWaitTime(("job_" + name + "_wait").c_str(), "Time a job spent queued"),
+	mName(name)
+{
+}
+
+//============================================================================
+
+class LLJobSystem::Worker final : public LLThread
+{
+public:
+	Worker(LLJobSystem* owner, U32 index)
+	:	LLThread(llformat("JobWorker %u", index)),
+		mOwner(owner),
+		mIndex(index)
+	{
+	}
+
+private:
+	void run() override
+	{
+		sWorkerIndex = (S32)mIndex;
+		U32 ran = 0;
+		while (true)
+		{
+			job_ptr_t job = mOwner->findJob(mIndex);
+			if (job)
+			{
+				mOwner->runJob(job);
+				if (++ran >= TRACE_PUSH_INTERVAL)
+				{
+					LLTrace::get_thread_recorder()->pushToParent();
+					ran = 0;
+				}
+				continue;
+			}
+			if (ran)
+			{
+				LLTrace::get_thread_recorder()->pushToParent();
+				ran = 0;
+			}
+			// Only leave once the queues are empty, so shutdown() runs everything queued
+			if (mOwner->mQuitting)
+			{
+				break;
+			}
+			mOwner->waitForWork();
+		}
+	}
+
+	LLJobSystem* mOwner;
+	U32 mIndex;
+};
+
+//============================================================================
+
+LLJobSystem::Job::Job(LLJobType& type, work_t work, work_t callback, EPriority priority)
+:	mType(type),
+	mWork(std::move(work)),
+	mCallback(std::move(callback)),
+	mPriority(priority),
+	mWaitCount(1),
+	mDone(false),
+	mQueuedTime(0.0)
+{
+}
+
+//============================================================================
+
+LLJobSystem::LLJobSystem(U32 num_workers)
+:	mNextQueue(0),
+	mPendingJobs(0),
+	mQuitting(false),
+	mCompletionCount(0)
+{
+	if (num_workers == 0)
+	{
+		// Leave a core for the main thread
+		num_workers = llmax(std::thread::hardware_concurrency(), 2U) - 1;
+	}
+	num_workers = llclamp(num_workers, 1U, MAX_WORKERS);
+
+	for (U32 i = 0; i < num_workers; ++i)
+	{
+		mQueues.emplace_back(std::make_unique<WorkQueue>());
+		for (auto& size : mQueues.back()->mSize)
+		{
+			size = 0;
+		}
+	}
+	for (U32 i = 0; i < num_workers; ++i)
+	{
+		mWorkers.emplace_back(std::make_unique<Worker>(this, i));
+		mWorkers.back()->start();
+	}
+	LL_INFOS() << "Job system started with " << num_workers << " worker(s)" << LL_ENDL;
+}
+
+LLJobSystem::~LLJobSystem()
+{
+	shutdown();
+}
+
+void LLJobSystem::cleanupSingleton()
+{
+	shutdown();
+}
+
+void LLJobSystem::shutdown()
+{
+	if (mQuitting.exchange(true))
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mWorkMutex);
+	}
+	mWorkCondition.notify_all();
+
+	for (auto& worker : mWorkers)
+	{
+		for (S32 timeout = 1000; timeout > 0 && !worker->isStopped(); --timeout)
+		{
+			std::this_thread::sleep_for(10ms);
+		}
+		if (!worker->isStopped())
+		{
+			LL_WARNS() << "Job system worker failed to stop" << LL_ENDL;
+		}
+	}
+	mWorkers.clear();
+
+	// Dependents of the last jobs may have been queued after their worker looked
+	while (job_ptr_t job = findJob(0))
+	{
+		runJob(job);
+	}
+
+	std::lock_guard<std::mutex> lock(mCompletionMutex);
+	if (!mCompletions.empty())
+	{
+		LL_INFOS() << "Job system dropping " << mCompletions.size() << " completion callback(s)" << LL_ENDL;
+		mCompletions.clear();
+		mCompletionCount = 0;
+	}
+}
+
+//static
+bool LLJobSystem::isWorkerThread()
+{
+	return sWorkerIndex >= 0;
+}
+
+LLJobSystem::job_ptr_t LLJobSystem::submit(LLJobType& type, work_t work, EPriority priority,
+										   work_t callback, const job_list_t& depends_on)
+{
+	if (mQuitting)
+	{
+		return nullptr;
+	}
+	llassert(priority >= PRIORITY_HIGH && priority < PRIORITY_COUNT);
+
+	job_ptr_t job = new Job(type, std::move(work), std::move(callback), priority);
+	for (Job* dependency : depends_on)
+	{
+		if (!dependency)
+		{
+			continue;
+		}
+		// finishJob() sets mDone under the same lock, so we either see it done or get notified
+		std::lock_guard<std::mutex> lock(dependency->mDependentsMutex);
+		if (!dependency->mDone)
+		{
+			job->mWaitCount++;
+			dependency->mDependents.push_back(job);
+		}
+	}
+	if (--job->mWaitCount == 0)
+	{
+		enqueue(job);
+	}
+	return job;
+}
+
+void LLJobSystem::enqueue(Job* job)
+{
+	job->mQueuedTime = LLTimer::getTotalSeconds();
+	mPendingJobs++;
+
+	// Workers keep what they spawn, everybody else spreads jobs around
+	const U32 index = sWorkerIndex >= 0 ? (U32)sWorkerIndex : mNextQueue++ % (U32)mQueues.size();
+	WorkQueue& queue = *mQueues[index];
+	{
+		std::lock_guard<std::mutex> lock(queue.mMutex);
+		queue.mJobs[job->mPriority].push_back(job);
+		queue.mSize[job->mPriority]++;
+	}
+
+	// Taking the lock orders this with a worker between its last look and its wait
+	{
+		std::lock_guard<std::mutex> lock(mWorkMutex);
+	}
+	mWorkCondition.notify_one();
+}
+
+bool LLJobSystem::popJob(WorkQueue& queue, EPriority priority, job_ptr_t& job, const LLJobType* type)
+{
+	std::lock_guard<std::mutex> lock(queue.mMutex);
+	std::deque<job_ptr_t>& jobs = queue.mJobs[priority];
+	std::deque<job_ptr_t>::iterator iter = jobs.begin();
+	if (type)
+	{
+		iter = std::find_if(jobs.begin(), jobs.end(), [type](const job_ptr_t& queued) { return &queued->mType == type; });
+	}
+	if (iter == jobs.end())
+	{
+		return false;
+	}
+	job = *iter;
+	jobs.erase(iter);
+	queue.mSize[priority]--;
+	return true;
+}
+
+LLJobSystem::job_ptr_t LLJobSystem::findJob(U32 queue_index, const LLJobType* type)
+{
+	const U32 count = (U32)mQueues.size();
+	job_ptr_t job;
+	for (S32 priority = PRIORITY_HIGH; priority < PRIORITY_COUNT; ++priority)
+	{
+		// Own queue first, then steal from the others
+		for (U32 i = 0; i < count; ++i)
+		{
+			WorkQueue& queue = *mQueues[(queue_index + i) % count];
+			if (queue.mSize[priority] > 0 && popJob(queue, (EPriority)priority, job, type))
+			{
+				return job;
+			}
+		}
+	}
+	return job;
+}
+
+void LLJobSystem::runJob(Job* job)
+{
+	const F64 start = LLTimer::getTotalSeconds();
+	record(job->mType.mWaitTime, F64Seconds(start - job->mQueuedTime));
+
+	job->mWork();
+	job->mWork = nullptr; // release whatever it captured
+
+	record(job->mType.mRunTime, F64Seconds(LLTimer::getTotalSeconds() - start));
+	add(job->mType.mCount, 1);
+
+	finishJob(job);
+	mPendingJobs--;
+}
+
+void LLJobSystem::finishJob(Job* job)
+{
+	job_list_t dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->mDependentsMutex);
+		job->mDone = true;
+		dependents.swap(job->mDependents);
+	}
+	job->mDoneCondition.notify_all();
+
+	if (job->mCallback)
+	{
+		std::lock_guard<std::mutex> lock(mCompletionMutex);
+		mCompletions.push_back(job);
+		mCompletionCount++;
+	}
+
+	for (Job* dependent : dependents)
+	{
+		if (--dependent->mWaitCount == 0)
+		{
+			enqueue(dependent);
+		}
+	}
+}
+
+void LLJobSystem::waitForWork()
+{
+	std::unique_lock<std::mutex> lock(mWorkMutex);
+	mWorkCondition.wait_for(lock, 100ms, [this]()
+	{
+		if (mQuitting)
+		{
+			return true;
+		}
+		for (const auto& queue : mQueues)
+		{
+			for (const auto& size : queue->mSize)
+			{
+				if (size > 0)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	});
+}
+
+void LLJobSystem::wait(const job_ptr_t& job)
+{
+	if (job.isNull())
+	{
+		return;
+	}
+	// A worker helps with anything, so jobs waiting on the jobs they spawned never hold up the
+	// pool. Any other thread, the main thread in particular, only takes on more of the same work.
+	const bool on_worker = sWorkerIndex >= 0;
+	const U32 queue_index = on_worker ? (U32)sWorkerIndex : 0;
+	const LLJobType* type = on_worker ? nullptr : &job->mType;
+	while (!job->isDone())
+	{
+		job_ptr_t other = findJob(queue_index, type);
+		if (other)
+		{
+			runJob(other);
+			continue;
+		}
+		// Woken as soon as the job is done, the timeout is only to look for more to help with
+		std::unique_lock<std::mutex> lock(job->mDependentsMutex);
+		job->mDoneCondition.wait_for(lock, 1ms, [&job]() { return job->mDone.load(); });
+	}
+}
+
+S32 LLJobSystem::runCompletions(F32 max_time_ms)
+{
+	const F64 max_time = (F64)max_time_ms * .001;
+	LLTimer timer;
+	while (mCompletionCount > 0)
+	{
+		job_ptr_t job;
+		{
+			std::lock_guard<std::mutex> lock(mCompletionMutex);
+			if (mCompletions.empty())
+			{
+				break;
+			}
+			job = mCompletions.front();
+			mCompletions.pop_front();
+			mCompletionCount--;
+		}
+		job->mCallback();
+		job->mCallback = nullptr;
+
+		if (max_time > 0.0 && timer.getElapsedTimeF64() > max_time)
+		{
+			break;
+		}
+	}
+	return mCompletionCount;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file lljobsystem.h
+ * @brief Shared work stealing pool of worker threads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLJOBSYSTEM_H
+#define LL_LLJOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "llpointer.h"
+#include "llrefcount.h"
+#include "llsingleton.h"
+#include "lltrace.h"
+
+// Kind of work submitted to the job system. Every type reports how many of its jobs
+// ran, how long they ran and how long they were queued through LLTrace, as
+// job_<name>_count, job_<name>_run and job_<name>_wait.
+// Declare these statically, trace handles are never unregistered.
+class LL_COMMON_API LLJobType
+{
+public:
+	LLJobType(const std::string& name);
+
+	const std::string& getName() const { return mName; }
+
+	LLTrace::CountStatHandle<> mCount;
+	LLTrace::EventStatHandle<F64Seconds> mRunTime;
+	LLTrace::EventStatHandle<F64Seconds> mWaitTime;
+
+private:
+	std::string mName;
+};
+
+// Pool of worker threads shared by every subsystem with short, independent pieces of work.
+//
+// Each worker has its own queue per priority. Workers take jobs from their own queue and,
+// when that is empty, steal from the other workers' queues, always looking at the highest
+// priority first. Jobs submitted from a worker go to its own queue, jobs from any other
+// thread are spread over the workers.
+//
+// A job can depend on other jobs, it is queued once the last of them has finished.
+// A job can also have a completion callback, which runs on the main thread from
+// runCompletions() after the job has finished.
+class LL_COMMON_API LLJobSystem final : public LLParamSingleton<LLJobSystem>
+{
+	// num_workers = 0 sizes the pool from the hardware concurrency
+	LLSINGLETON(LLJobSystem, U32 num_workers = 0);
+	~LLJobSystem();
+
+public:
+	enum EPriority
+	{
+		PRIORITY_HIGH = 0,
+		PRIORITY_NORMAL,
+		PRIORITY_LOW,
+		PRIORITY_COUNT
+	};
+
+	static constexpr U32 MAX_WORKERS = 32;
+
+	typedef std::function<void()> work_t;
+
+	class LL_COMMON_API Job : public LLThreadSafeRefCount
+	{
+		friend class LLJobSystem;
+	public:
+		Job(LLJobType& type, work_t work, work_t callback, EPriority priority);
+
+		const LLJobType& getType() const { return mType; }
+		EPriority getPriority() const { return mPriority; }
+		// True once the work has run. The completion callback may still be pending.
+		bool isDone() const { return mDone; }
+
+	private:
+		LLJobType& mType;
+		work_t mWork;
+		work_t mCallback;
+		const EPriority mPriority;
+		std::atomic<S32> mWaitCount;	// unfinished dependencies, plus one until submitted
+		std::atomic<bool> mDone;
+		F64 mQueuedTime;
+		std::mutex mDependentsMutex;
+		std::condition_variable mDoneCondition;	// signalled with mDependentsMutex when mDone is set
+		std::vector<LLPointer<Job> > mDependents;
+	};
+	typedef LLPointer<Job> job_ptr_t;
+	typedef std::vector<job_ptr_t> job_list_t;
+
+	// Any thread. Queues work to run on a worker once every job in depends_on is done,
+	// then queues callback for the main thread. Returns nullptr after shutdown.
+	job_ptr_t submit(LLJobType& type, work_t work, EPriority priority = PRIORITY_NORMAL,
+					 work_t callback = work_t(), const job_list_t& depends_on = job_list_t());
+
+	// Any thread. Blocks until job is done, running other queued jobs meanwhile: any job
+	// on a worker, only jobs of the same type anywhere else.
+	void wait(const job_ptr_t& job);
+
+	// Main thread. Runs completion callbacks of finished jobs for up to max_time_ms
+	// (0 = no limit). Returns the number of callbacks still waiting.
+	S32 runCompletions(F32 max_time_ms = 0.f);
+
+	// Stops accepting jobs, runs everything already queued and stops the workers.
+	void shutdown();
+
+	U32 getWorkerCount() const { return (U32)mWorkers.size(); }
+	// Jobs queued or running, not counting those waiting for dependencies
+	S32 getPending() const { return mPendingJobs; }
+	// True on one of the pool's worker threads
+	static bool isWorkerThread();
+
+private:
+	void cleanupSingleton() override;
+
+	class Worker;
+
+	struct WorkQueue
+	{
+		std::mutex mMutex;
+		std::deque<job_ptr_t> mJobs[PRIORITY_COUNT];
+		std::atomic<S32> mSize[PRIORITY_COUNT];
+	};
+
+	void enqueue(Job* job);
+	// type restricts the search to jobs of that type
+	job_ptr_t findJob(U32 queue_index, const LLJobType* type = nullptr);
+	bool popJob(WorkQueue& queue, EPriority priority, job_ptr_t& job, const LLJobType* type);
+	void runJob(Job* job);
+	void finishJob(Job* job);
+	void waitForWork();
+
+	std::vector<std::unique_ptr<WorkQueue> > mQueues;
+	std::vector<std::unique_ptr<Worker> > mWorkers;
+	std::atomic<U32> mNextQueue;
+	std::atomic<S32> mPendingJobs;
+	std::atomic<bool> mQuitting;
+
+	std::mutex mWorkMutex;
+	std::condition_variable mWorkCondition;
+
+	std::mutex mCompletionMutex;
+	std::deque<job_ptr_t> mCompletions;
+	std::atomic<S32> mCompletionCount;
+};
+
+#endif // LL_LLJOBSYSTEM_H
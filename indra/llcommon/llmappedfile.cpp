@@ -0,0 +1,271 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Cross platform memory mapped file
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "linden_common.h"
+#include "llmappedfile.h"
+
+#include "llstring.h"
+
+LLMappedFile::LLMappedFile()
+:	mMode(READ_ONLY),
+	mData(nullptr),
+	mSize(0),
+#if LL_WINDOWS
+	mFileHandle(INVALID_HANDLE_VALUE),
+	mMappingHandle(nullptr)
+#else
+	mFileDescriptor(-1)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	close();
+}
+
+bool LLMappedFile::open(const std::string& filename, EMode mode, size_t size)
+{
+	close();
+
+	mFileName = filename;
+	mMode = mode;
+
+	if (mFileName.empty())
+	{
+		// Anonymous mapping, nothing to open
+		if (!size)
+		{
+			return false;
+		}
+		mSize = size;
+		return map();
+	}
+
+#if LL_WINDOWS
+	DWORD access = (mode == READ_WRITE) ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+	DWORD disposition = (mode == READ_WRITE) ? OPEN_ALWAYS : OPEN_EXISTING;
+	HANDLE file = CreateFileW(ll_convert_string_to_wide(mFileName).c_str(), access,
+							  FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, disposition,
+							  FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LL_DEBUGS("MappedFile") << "Unable to open " << mFileName << " error: " << GetLastError() << LL_ENDL;
+		return false;
+	}
+	mFileHandle = file;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		close();
+		return false;
+	}
+	mSize = (size_t)file_size.QuadPart;
+#else
+	int flags = (mode == READ_WRITE) ? (O_RDWR | O_CREAT) : O_RDONLY;
+	mFileDescriptor = ::open(mFileName.c_str(), flags, 0600);
+	if (mFileDescriptor == -1)
+	{
+		LL_DEBUGS("MappedFile") << "Unable to open " << mFileName << " errno: " << errno << LL_ENDL;
+		return false;
+	}
+
+	struct stat file_status;
+	if (::fstat(mFileDescriptor, &file_status) != 0)
+	{
+		close();
+		return false;
+	}
+	mSize = (size_t)file_status.st_size;
+#endif
+
+	if (size > mSize)
+	{
+		if (mode != READ_WRITE)
+		{
+			// Can't grow a file we don't own
+			close();
+			return false;
+		}
+		return resize(size);
+	}
+
+	if (!mSize)
+	{
+		// Nothing to map, an empty mapping is an error on every platform
+		close();
+		return false;
+	}
+
+	return map();
+}
+
+void LLMappedFile::close()
+{
+	unmap();
+#if LL_WINDOWS
+	if (mFileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle((HANDLE)mFileHandle);
+		mFileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (mFileDescriptor != -1)
+	{
+		::close(mFileDescriptor);
+		mFileDescriptor = -1;
+	}
+#endif
+	mSize = 0;
+}
+
+bool LLMappedFile::resize(size_t size)
+{
+	if (mMode != READ_WRITE || !size)
+	{
+		return false;
+	}
+
+	unmap();
+	if (!mFileName.empty())
+	{
+#if LL_WINDOWS
+		LARGE_INTEGER new_size;
+		new_size.QuadPart = (LONGLONG)size;
+		if (!SetFilePointerEx((HANDLE)mFileHandle, new_size, nullptr, FILE_BEGIN)
+			|| !SetEndOfFile((HANDLE)mFileHandle))
+		{
+			LL_WARNS("MappedFile") << "Unable to resize " << mFileName << " to " << size << " error: " << GetLastError() << LL_ENDL;
+			close();
+			return false;
+		}
+#else
+		if (::ftruncate(mFileDescriptor, (off_t)size) != 0)
+		{
+			LL_WARNS("MappedFile") << "Unable to resize " << mFileName << " to " << size << " errno: " << errno << LL_ENDL;
+			close();
+			return false;
+		}
+#endif
+	}
+	mSize = size;
+	return map();
+}
+
+bool LLMappedFile::flush(bool wait)
+{
+	if (!mData || mMode != READ_WRITE || mFileName.empty())
+	{
+		return true;
+	}
+#if LL_WINDOWS
+	if (!FlushViewOfFile(mData, 0))
+	{
+		return false;
+	}
+	return !wait || FlushFileBuffers((HANDLE)mFileHandle);
+#else
+	return ::msync(mData, mSize, wait ? MS_SYNC : MS_ASYNC) == 0;
+#endif
+}
+
+bool LLMappedFile::map()
+{
+#if LL_WINDOWS
+	DWORD protect = (mMode == READ_ONLY) ? PAGE_READONLY : (mMode == COPY_ON_WRITE) ? PAGE_WRITECOPY : PAGE_READWRITE;
+	DWORD access = (mMode == READ_ONLY) ? FILE_MAP_READ : (mMode == COPY_ON_WRITE) ? FILE_MAP_COPY : FILE_MAP_ALL_ACCESS;
+	HANDLE file = (HANDLE)mFileHandle;
+	if (mFileName.empty())
+	{
+		// Pagefile backed, the only writable anonymous mapping windows offers
+		protect = PAGE_READWRITE;
+		access = FILE_MAP_ALL_ACCESS;
+		file = INVALID_HANDLE_VALUE;
+	}
+	mMappingHandle = CreateFileMappingW(file, nullptr, protect, (DWORD)((U64)mSize >> 32), (DWORD)(mSize & 0xFFFFFFFF), nullptr);
+	if (!mMappingHandle)
+	{
+		LL_WARNS("MappedFile") << "CreateFileMapping failed for " << mFileName << " error: " << GetLastError() << LL_ENDL;
+		return false;
+	}
+	mData = (U8*)MapViewOfFile((HANDLE)mMappingHandle, access, 0, 0, mSize);
+	if (!mData)
+	{
+		LL_WARNS("MappedFile") << "MapViewOfFile failed for " << mFileName << " error: " << GetLastError() << LL_ENDL;
+		CloseHandle((HANDLE)mMappingHandle);
+		mMappingHandle = nullptr;
+		return false;
+	}
+#else
+	int prot = (mMode == READ_ONLY) ? PROT_READ : (PROT_READ | PROT_WRITE);
+	int flags = (mMode == READ_WRITE) ? MAP_SHARED : MAP_PRIVATE;
+	int fd = mFileDescriptor;
+	if (mFileName.empty())
+	{
+		flags = MAP_PRIVATE | MAP_ANONYMOUS;
+		prot = PROT_READ | PROT_WRITE;
+		fd = -1;
+	}
+	void* address = ::mmap(nullptr, mSize, prot, flags, fd, 0);
+	if (address == MAP_FAILED)
+	{
+		LL_WARNS("MappedFile") << "mmap failed for " << mFileName << " errno: " << errno << LL_ENDL;
+		return false;
+	}
+	mData = (U8*)address;
+#endif
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (!mData)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	UnmapViewOfFile(mData);
+	if (mMappingHandle)
+	{
+		CloseHandle((HANDLE)mMappingHandle);
+		mMappingHandle = nullptr;
+	}
+#else
+	::munmap(mData, mSize);
+#endif
+	mData = nullptr;
+}
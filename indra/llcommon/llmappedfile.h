@@ -0,0 +1,98 @@
+/**
+ * @file llmappedfile.h
+ * @brief Cross platform memory mapped file
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+/**
+ * @class LLMappedFile
+ * @brief Maps a whole file into the address space of the process.
+ *
+ * Used for on-disk indexes and caches that want to be read in place
+ * instead of being parsed at startup. The file name is UTF8. An empty
+ * file name creates an anonymous mapping which is never written out,
+ * so callers can keep the same code path when the cache is unavailable.
+ */
+class LL_COMMON_API LLMappedFile
+{
+public:
+	enum EMode
+	{
+		READ_ONLY,		// map an existing file, the view may not be written
+		READ_WRITE,		// map the file, creating or growing it to the requested size
+		COPY_ON_WRITE	// map an existing file, writes stay private to this process
+	};
+
+	LLMappedFile();
+	~LLMappedFile();
+
+	LLMappedFile(const LLMappedFile&) = delete;
+	LLMappedFile& operator=(const LLMappedFile&) = delete;
+
+	// Maps filename. When size is non zero the file is grown to at least
+	// size bytes (READ_WRITE only). Returns false if the file could not be mapped.
+	bool open(const std::string& filename, EMode mode, size_t size = 0);
+	void close();
+
+	// Grows or shrinks the file and remaps it. Previous pointers into the view become invalid.
+	bool resize(size_t size);
+
+	// Schedules dirty pages for writing. When wait is true, blocks until they are on disk.
+	bool flush(bool wait = false);
+
+	bool isOpen() const { return mData != nullptr; }
+	bool isWritable() const { return mData && mMode != READ_ONLY; }
+	size_t size() const { return mSize; }
+	U8* data() { return mData; }
+	const U8* data() const { return mData; }
+	const std::string& getFileName() const { return mFileName; }
+
+	template<typename T> T* getAs(size_t offset = 0)
+	{
+		return (offset + sizeof(T) <= mSize) ? reinterpret_cast<T*>(mData + offset) : nullptr;
+	}
+	template<typename T> const T* getAs(size_t offset = 0) const
+	{
+		return (offset + sizeof(T) <= mSize) ? reinterpret_cast<const T*>(mData + offset) : nullptr;
+	}
+
+private:
+	bool map();
+	void unmap();
+
+	std::string mFileName;
+	EMode mMode;
+	U8* mData;
+	size_t mSize;
+#if LL_WINDOWS
+	void* mFileHandle;
+	void* mMappingHandle;
+#else
+	int mFileDescriptor;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
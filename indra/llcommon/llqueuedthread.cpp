@@ -27,23 +27,36 @@
 #include "llqueuedthread.h"
 
 #include "llstl.h"
+#include "lljobsystem.h"
 #include "lltimer.h"	// ms_sleep()
 #include "lltracethreadrecorder.h"
 #include "llthread.h"
 
 using namespace std::chrono_literals;
 
+// A pooled queue gives its worker back after this long, so other jobs get a turn
+static const F64 POOLED_DRAIN_SLICE = 0.005;
+
 //============================================================================
 
 // MAIN THREAD
-LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause) :
+LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause, LLJobType* pool_job_type) :
 	LLThread(name),
 	mThreaded(threaded),
     mStarted(false),
 	mIdleThread(true),
+	mPoolJobType(threaded ? pool_job_type : nullptr),
+	mDrainScheduled(false),
+	mDrainJobs(0),
 	mRequestQueueSize(0),
     mNextHandle(0)
 {
+	if (mPoolJobType && !LLJobSystem::instanceExists())
+	{
+		LL_WARNS() << "Job system not running, " << mName << " uses its own thread" << LL_ENDL;
+		mPoolJobType = nullptr;
+	}
+
 	if (mThreaded)
 	{
 		if(should_pause)
@@ -51,7 +64,15 @@ LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool shou
 			pause() ; //call this before start the thread.
 		}
 
-		start();
+		if (mPoolJobType)
+		{
+			// No thread of our own, but the request status logic is the same
+			mStatus = RUNNING;
+		}
+		else
+		{
+			start();
+		}
 	}
 }
 
@@ -71,7 +92,25 @@ void LLQueuedThread::shutdown()
 	setQuitting();
 
 	unpause(); // MAIN THREAD
-	if (mThreaded)
+	if (mPoolJobType)
+	{
+		// Let a running drain see the quit flag and finish
+		S32 timeout = 1000;
+		for ( ; timeout > 0 && (mDrainScheduled || mDrainJobs > 0); timeout--)
+		{
+			std::this_thread::sleep_for(10ms);
+		}
+		if (timeout == 0)
+		{
+			LL_WARNS() << "~LLQueuedThread (" << mName << ") timed out!" << LL_ENDL;
+		}
+		if (mStarted && !isStopped())
+		{
+			endThread();
+		}
+		mStatus = STOPPED;
+	}
+	else if (mThreaded)
 	{
 		S32 timeout = 100;
 		for ( ; timeout>0; timeout--)
@@ -140,8 +179,12 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 		pending = getPending();
 		if(pending > 0)
 		{
-		unpause();
-	}
+			unpause();
+			if (mPoolJobType)
+			{
+				scheduleDrain();
+			}
+		}
 	}
 	else
 	{
@@ -160,7 +203,11 @@ void LLQueuedThread::incQueue()
 	// Something has been added to the queue
 	if (!isPaused())
 	{
-		if (mThreaded)
+		if (mPoolJobType)
+		{
+			scheduleDrain();
+		}
+		else if (mThreaded)
 		{
 			wake(); // Wake the thread up if necessary.
 		}
@@ -464,7 +511,7 @@ S32 LLQueuedThread::processNextRequest()
 			mRequestQueue.insert(req);
 			mRequestQueueSize = mRequestQueue.size();
 			unlockData();
-			if (mThreaded && start_priority < PRIORITY_NORMAL)
+			if (mThreaded && !mPoolJobType && start_priority < PRIORITY_NORMAL)
 			{
 				std::this_thread::sleep_for(1ms); // sleep the thread a little
 			}
@@ -520,6 +567,67 @@ void LLQueuedThread::run()
 	LL_INFOS() << "LLQueuedThread " << mName << " EXITING." << LL_ENDL;
 }
 
+// Any thread. Makes sure a job is on its way to process the queue, at most one at a time
+// so requests are processed in order and never concurrently, as on a thread of our own.
+void LLQueuedThread::scheduleDrain(bool yield)
+{
+	if (isQuitting() || mDrainScheduled.exchange(true))
+	{
+		return;
+	}
+	mIdleThread = false;
+
+	LLJobSystem::job_ptr_t job;
+	if (LLJobSystem::instanceExists())
+	{
+		job = LLJobSystem::getInstance()->submit(*mPoolJobType, [this]() { drainQueue(true); },
+			yield ? LLJobSystem::PRIORITY_LOW : LLJobSystem::PRIORITY_NORMAL);
+	}
+	if (job.isNull())
+	{
+		// The job system is shutting down, do all of the work here
+		drainQueue(false);
+	}
+}
+
+// Runs as a job on the job system, or inline until the queue is empty when
+// the job system can no longer take jobs
+void LLQueuedThread::drainQueue(bool sliced)
+{
+	// Shutdown waits on this count, so it must be the last thing we touch
+	++mDrainJobs;
+
+	if (!mStarted)
+	{
+		startThread();
+		mStarted = true;
+	}
+
+	LLTimer timer;
+	S32 pending = 1;
+	while (pending > 0 && !isQuitting() && !isPaused()
+		   && (!sliced || timer.getElapsedTimeF64() < POOLED_DRAIN_SLICE))
+	{
+		threadedUpdate();
+		pending = processNextRequest();
+	}
+	if (pending <= 0)
+	{
+		mIdleThread = true;
+	}
+
+	// A request added since our last look saw the flag set and left it to us.
+	// If we used up the slice, let everything else queued go first.
+	// A paused queue is picked up again by update().
+	mDrainScheduled = false;
+	if (getPending() > 0 && !isPaused())
+	{
+		scheduleDrain(pending > 0);
+	}
+
+	--mDrainJobs;
+}
+
 // virtual
 void LLQueuedThread::startThread()
 {
@@ -35,6 +35,8 @@
 #include "llthread.h"
 #include "llsimplehash.h"
 
+class LLJobType;
+
 //============================================================================
 // Note: ~LLQueuedThread is O(N) N=# of queued threads, assumed to be small
 //   It is assumed that LLQueuedThreads are rarely created/destroyed.
@@ -146,7 +148,11 @@ protected:
 public:
 	static handle_t nullHandle() { return handle_t(0); }
 
-	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	// With a pool_job_type, requests are processed as jobs of that type on the LLJobSystem
+	// workers instead of on a thread of our own, one at a time as before. Falls back to
+	// an own thread when the job system is not running.
+	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false,
+				   LLJobType* pool_job_type = nullptr);
 	virtual ~LLQueuedThread();
 	void shutdown() override;
 	
@@ -160,6 +166,9 @@ private:
 	virtual void endThread(void);
 	virtual void threadedUpdate(void);
 
+	void scheduleDrain(bool yield = false);
+	void drainQueue(bool sliced);
+
 protected:
 	handle_t generateHandle();
 	bool addRequest(QueuedRequest* req);
@@ -177,6 +186,7 @@ public:
 
 	virtual S32 getPending() const { return mRequestQueueSize; } // May be called from any thread
 	bool getThreaded() const { return mThreaded; }
+	bool getPooled() const { return mPoolJobType != nullptr; }
 
 	// Request accessors
 	status_t getRequestStatus(handle_t handle);
@@ -195,6 +205,9 @@ protected:
 	bool mThreaded;  // if false, run on main thread and do updates during update()
 	bool mStarted;  // required when mThreaded is false to call startThread() from update()
 	LLAtomicBool mIdleThread; // request queue is empty (or we are quitting) and the thread is idle
+	LLJobType* mPoolJobType; // set when requests run on the job system
+	std::atomic<bool> mDrainScheduled; // a job system job is queued or processing requests
+	std::atomic<S32> mDrainJobs; // drains currently running, shutdown waits for them to return
 	
 	typedef std::set<QueuedRequest*, queued_request_less> request_queue_t;
 	request_queue_t mRequestQueue;
@@ -78,7 +78,7 @@ class LLSD::Impl
 protected:
 	Impl();
 
-	enum StaticAllocationMarker { STATIC_USAGE_COUNT = 0xFFFFFFFF };
+	enum StaticAllocationMarker { STATIC_USAGE_COUNT = 0x7FFFFFFF };
 	Impl(StaticAllocationMarker);
 		///< This constructor is used for static objects and causes the
 		//   suppresses adjusting the debugging counters when they are
@@ -88,9 +88,17 @@ protected:
 	
 	bool shared() const							{ return (mUseCount > 1) && (mUseCount != STATIC_USAGE_COUNT); }
 	
-	U32 mUseCount;
+	U32 mUseCount : 31;
+	U32 mInArena : 1;
 
 public:
+	template<class T, class... Args>
+	static T* create(Args&&... args);
+		///< new T, or a T in the thread's current LLSDArena if there is one
+
+	static void destroy(Impl* impl);
+		///< delete impl, wherever create() put it
+
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
 
@@ -145,7 +153,7 @@ public:
 	virtual const LLSD& ref(Integer) const		{ return undef(); }
 
 	virtual LLSD::map_const_iterator beginMap() const { return endMap(); }
-	virtual LLSD::map_const_iterator endMap() const { static const std::map<String, LLSD> empty; return empty.end(); }
+	virtual LLSD::map_const_iterator endMap() const { static const LLSD::Map empty; return empty.end(); }
 	virtual LLSD::array_const_iterator beginArray() const { return endArray(); }
 	virtual LLSD::array_const_iterator endArray() const { static const std::vector<LLSD> empty; return empty.end(); }
 
@@ -365,7 +373,7 @@ namespace
 	class ImplMap final : public LLSD::Impl
 	{
 	private:
-		typedef std::map<LLSD::String, LLSD>	DataMap;
+		typedef LLSD::Map	DataMap;
 		
 		DataMap mData;
 		
@@ -373,7 +381,7 @@ namespace
 		ImplMap(DataMap data) : mData(std::move(data)) { }
 		
 	public:
-		ImplMap() = default;
+		ImplMap() : mData(DataMap::allocator_type(LLSDArena::current())) { }
 
         ImplMap& makeMap(LLSD::Impl*&) override;
 
@@ -388,6 +396,7 @@ namespace
 		using LLSD::Impl::ref; // Unhiding ref(LLSD::Integer)
 		LLSD get(const LLSD::String&) const override; 
 		void insert(const LLSD::String& k, const LLSD& v);
+		void insert(LLSD::String&& k, LLSD&& v);
 		void erase(const LLSD::String&) override;
 		              LLSD& ref(const LLSD::String&);
 		const LLSD& ref(const LLSD::String&) const override;
@@ -431,7 +440,12 @@ namespace
 	
 	void ImplMap::insert(const LLSD::String& k, const LLSD& v)
 	{
-		mData.insert(DataMap::value_type(k, v));
+		mData.emplace(k, v);
+	}
+
+	void ImplMap::insert(LLSD::String&& k, LLSD&& v)
+	{
+		mData.emplace(std::move(k), std::move(v));
 	}
 	
 	void ImplMap::erase(const LLSD::String& k)
@@ -633,14 +647,14 @@ namespace
 }
 
 LLSD::Impl::Impl()
-	: mUseCount(0)
+	: mUseCount(0), mInArena(0)
 {
 	++sAllocationCount;
 	++sOutstandingCount;
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-	: mUseCount(0)
+	: mUseCount(0), mInArena(0)
 {
 }
 
@@ -649,6 +663,40 @@ LLSD::Impl::~Impl()
 	--sOutstandingCount;
 }
 
+// Arena values are preceded by the arena they came from, which they keep alive.
+// The prefix is padded so that the value keeps its own alignment.
+template<class T, class... Args>
+T* LLSD::Impl::create(Args&&... args)
+{
+	LLSDArena* arena = LLSDArena::current();
+	if (!arena)
+	{
+		return new T(std::forward<Args>(args)...);
+	}
+
+	constexpr size_t align = alignof(T) > alignof(LLSDArena*) ? alignof(T) : alignof(LLSDArena*);
+	constexpr size_t prefix = (sizeof(LLSDArena*) + align - 1) & ~(align - 1);
+	U8* block = (U8*)arena->allocate(prefix + sizeof(T), align);
+	*(LLSDArena**)(block + prefix - sizeof(LLSDArena*)) = arena;
+	T* impl = new (block + prefix) T(std::forward<Args>(args)...);
+	impl->mInArena = 1;
+	arena->ref();
+	return impl;
+}
+
+void LLSD::Impl::destroy(Impl* impl)
+{
+	if (!impl->mInArena)
+	{
+		delete impl;
+		return;
+	}
+
+	LLSDArena* arena = *(LLSDArena**)((U8*)impl - sizeof(LLSDArena*));
+	impl->~Impl();
+	arena->unref();
+}
+
 void LLSD::Impl::reset(Impl*& var, Impl* impl)
 {
 	if (var != impl)
@@ -659,7 +707,7 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
 		}
 		if (var && var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
 		{
-			delete var;
+			destroy(var);
 		}
 		var = impl;
 	}
@@ -671,7 +719,7 @@ void LLSD::Impl::move(Impl*& var, Impl*& impl)
 
 	if (var && var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
 	{
-		delete var; // destroy var if usage falls to 0 and not static
+		destroy(var); // destroy var if usage falls to 0 and not static
 	}
 	var = impl; // Steal impl to var without incrementing use since this is a move
 	impl = nullptr; // null out old-impl pointer
@@ -691,14 +739,14 @@ const LLSD::Impl& LLSD::Impl::safe(const Impl* impl)
 
 ImplMap& LLSD::Impl::makeMap(Impl*& var)
 {
-	ImplMap* im = new ImplMap;
+	ImplMap* im = create<ImplMap>();
 	reset(var, im);
 	return *im;
 }
 
 ImplArray& LLSD::Impl::makeArray(Impl*& var)
 {
-	ImplArray* ia = new ImplArray;
+	ImplArray* ia = create<ImplArray>();
 	reset(var, ia);
 	return *ia;
 }
@@ -716,42 +764,42 @@ void LLSD::Impl::assignUndefined(Impl*& var)
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Boolean v)
 {
-	reset(var, new ImplBoolean(v));
+	reset(var, create<ImplBoolean>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Integer v)
 {
-	reset(var, new ImplInteger(v));
+	reset(var, create<ImplInteger>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Real v)
 {
-	reset(var, new ImplReal(v));
+	reset(var, create<ImplReal>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
 {
-	reset(var, new ImplString(v));
+	reset(var, create<ImplString>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::UUID& v)
 {
-	reset(var, new ImplUUID(v));
+	reset(var, create<ImplUUID>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::Date& v)
 {
-	reset(var, new ImplDate(v));
+	reset(var, create<ImplDate>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::URI& v)
 {
-	reset(var, new ImplURI(v));
+	reset(var, create<ImplURI>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::Binary& v)
 {
-	reset(var, new ImplBinary(v));
+	reset(var, create<ImplBinary>(v));
 }
 
 
@@ -885,6 +933,7 @@ LLSD LLSD::emptyMap()
 bool LLSD::has(const String& k) const	{ return safe(impl).has(k); }
 LLSD LLSD::get(const String& k) const	{ return safe(impl).get(k); } 
 void LLSD::insert(const String& k, const LLSD& v) {	makeMap(impl).insert(k, v); }
+void LLSD::insert(String&& k, LLSD&& v)		{	makeMap(impl).insert(std::move(k), std::move(v)); }
 
 LLSD& LLSD::with(const String& k, const LLSD& v)
 										{ 
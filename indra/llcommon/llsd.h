@@ -34,6 +34,7 @@
 #include "stdtypes.h"
 
 #include "lldate.h"
+#include "llsdarena.h"
 #include "lluri.h"
 #include "lluuid.h"
 
@@ -291,6 +292,7 @@ public:
 		bool has(const String&) const;
 		LLSD get(const String&) const;
 		void insert(const String&, const LLSD&);
+		void insert(String&&, LLSD&&);
 		void erase(const String&);
 		LLSD& with(const String&, const LLSD&);
 		
@@ -319,8 +321,11 @@ public:
 	//@{
 		int size() const;
 
-		typedef std::map<String, LLSD>::iterator		map_iterator;
-		typedef std::map<String, LLSD>::const_iterator	map_const_iterator;
+		// Maps parsed inside an LLSDArena::Scope keep their nodes in the arena
+		typedef std::map<String, LLSD, std::less<String>,
+						 LLSDArenaAllocator<std::pair<const String, LLSD> > > Map;
+		typedef Map::iterator		map_iterator;
+		typedef Map::const_iterator	map_const_iterator;
 		
 		map_iterator		beginMap();
 		map_iterator		endMap();
@@ -0,0 +1,112 @@
+/**
+ * @file llsdarena.cpp
+ * @brief Per document memory arena for parsed LLSD
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llsdarena.h"
+
+#include <algorithm>
+
+// Small documents stay in one small chunk, big ones quickly get big chunks
+static const size_t FIRST_CHUNK_SIZE = 4 * 1024;
+static const size_t MAX_CHUNK_SIZE = 256 * 1024;
+
+static thread_local LLSDArena* sCurrentArena = nullptr;
+
+LLSDArena::LLSDArena()
+:	mCursor(nullptr),
+	mLimit(nullptr),
+	mNextChunkSize(FIRST_CHUNK_SIZE),
+	mAllocatedBytes(0),
+	mUsedBytes(0)
+{
+}
+
+LLSDArena::~LLSDArena()
+{
+	for (const Chunk& chunk : mChunks)
+	{
+		delete[] chunk.mBegin;
+	}
+}
+
+void* LLSDArena::allocate(size_t size, size_t align)
+{
+	llassert(align && (align & (align - 1)) == 0 && align <= alignof(std::max_align_t));
+	U8* p = (U8*)(((uintptr_t)mCursor + align - 1) & ~(uintptr_t)(align - 1));
+	if (!mCursor || p + size > mLimit)
+	{
+		// new[] memory is aligned for any fundamental type, the most we are asked for
+		const size_t chunk_size = llmax(mNextChunkSize, size);
+		mNextChunkSize = llmin(mNextChunkSize * 2, MAX_CHUNK_SIZE);
+		p = new U8[chunk_size];
+		mLimit = p + chunk_size;
+		mAllocatedBytes += chunk_size;
+
+		Chunk chunk = { p, mLimit };
+		auto it = std::upper_bound(mChunks.begin(), mChunks.end(), p,
+								   [](const U8* address, const Chunk& other) { return address < other.mBegin; });
+		mChunks.insert(it, chunk);
+	}
+	mCursor = p + size;
+	mUsedBytes += size;
+	return p;
+}
+
+bool LLSDArena::owns(const void* p) const
+{
+	const U8* address = (const U8*)p;
+	auto it = std::upper_bound(mChunks.begin(), mChunks.end(), address,
+							   [](const U8* address, const Chunk& other) { return address < other.mBegin; });
+	return it != mChunks.begin() && address < (it - 1)->mEnd;
+}
+
+//static
+LLSDArena* LLSDArena::current()
+{
+	return sCurrentArena;
+}
+
+//============================================================================
+
+LLSDArena::Scope::Scope(bool use_arena)
+:	mPrevious(sCurrentArena),
+	mActive(use_arena)
+{
+	if (mActive)
+	{
+		mArena = new LLSDArena;
+		sCurrentArena = mArena.get();
+	}
+}
+
+LLSDArena::Scope::~Scope()
+{
+	if (mActive)
+	{
+		sCurrentArena = mPrevious;
+	}
+}
@@ -0,0 +1,161 @@
+/**
+ * @file llsdarena.h
+ * @brief Per document memory arena for parsed LLSD
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDARENA_H
+#define LL_LLSDARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "llrefcount.h"
+#include "llpointer.h"
+
+/**
+ * @brief LLSDArena hands out the memory for the nodes of one parsed LLSD document.
+ *
+ * While an LLSDArena::Scope is open on a thread, every LLSD value and map node created on that thread is
+ * carved out of the scope's arena instead of being allocated on its own. Nothing is ever freed back to the
+ * arena: each value created in it holds a reference, and the whole arena goes away with the last of them.
+ * Documents which are parsed, read and dropped, like most capability responses, thus cost a handful of
+ * large allocations instead of one or two per value.
+ *
+ * Changes made to the document once the scope is closed allocate as usual, and copies never share the arena.
+ */
+class LL_COMMON_API LLSDArena : public LLThreadSafeRefCount
+{
+	LOG_CLASS(LLSDArena);
+public:
+	LLSDArena();
+
+	/**
+	 * Memory for size bytes aligned on align, which must be a power of two no larger than std::max_align_t's.
+	 */
+	void* allocate(size_t size, size_t align);
+	/**
+	 * True if p was handed out by this arena.
+	 */
+	bool owns(const void* p) const;
+
+	// Bytes reserved from the system, and the part of them handed out
+	size_t getAllocatedBytes() const	{ return mAllocatedBytes; }
+	size_t getUsedBytes() const			{ return mUsedBytes; }
+
+	/**
+	 * Arena of the innermost scope open on this thread, nullptr if there is none.
+	 */
+	static LLSDArena* current();
+
+	/**
+	 * Makes a new arena current on this thread for its lifetime, or does nothing if use_arena is false.
+	 */
+	class LL_COMMON_API Scope
+	{
+	public:
+		Scope(bool use_arena = true);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		LLSDArena* getArena() const	{ return mArena.get(); }
+
+	private:
+		LLPointer<LLSDArena> mArena;
+		LLSDArena* mPrevious;
+		bool mActive;
+	};
+
+private:
+	~LLSDArena();
+
+	struct Chunk
+	{
+		U8* mBegin;
+		U8* mEnd;
+	};
+
+	// Sorted by address, for owns()
+	std::vector<Chunk> mChunks;
+	U8* mCursor;
+	U8* mLimit;
+	size_t mNextChunkSize;
+	size_t mAllocatedBytes;
+	size_t mUsedBytes;
+};
+
+/**
+ * @brief Allocator for LLSD containers, taking memory from the arena current when the container was made.
+ *
+ * Only while that arena is still current, so elements added later, possibly on another thread, come from
+ * the heap. Copied containers always use the heap, and swapped ones take their allocator along with their nodes.
+ */
+template<class T>
+class LLSDArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::false_type propagate_on_container_copy_assignment;
+	typedef std::false_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+	typedef std::false_type is_always_equal;
+
+	LLSDArenaAllocator(LLSDArena* arena = nullptr) noexcept : mArena(arena) { }
+	template<class U>
+	LLSDArenaAllocator(const LLSDArenaAllocator<U>& other) noexcept : mArena(other.getArena()) { }
+
+	T* allocate(size_t n)
+	{
+		if (mArena && mArena == LLSDArena::current())
+		{
+			return static_cast<T*>(mArena->allocate(n * sizeof(T), alignof(T)));
+		}
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		if (!mArena || !mArena->owns(p))
+		{
+			std::allocator<T>().deallocate(p, n);
+		}
+	}
+
+	LLSDArenaAllocator select_on_container_copy_construction() const { return LLSDArenaAllocator(); }
+
+	LLSDArena* getArena() const { return mArena; }
+
+private:
+	LLSDArena* mArena;
+};
+
+template<class T, class U>
+bool operator==(const LLSDArenaAllocator<T>& a, const LLSDArenaAllocator<U>& b) { return a.getArena() == b.getArena(); }
+template<class T, class U>
+bool operator!=(const LLSDArenaAllocator<T>& a, const LLSDArenaAllocator<U>& b) { return a.getArena() != b.getArena(); }
+
+#endif // LL_LLSDARENA_H
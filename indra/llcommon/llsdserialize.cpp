@@ -313,7 +313,7 @@ static const char BINARY_FALSE_SERIAL = '0';
  * LLSDParser
  */
 LLSDParser::LLSDParser()
-	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false)
+	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false), mUseArena(false)
 {
 }
 
@@ -325,6 +325,7 @@ S32 LLSDParser::parse(std::istream& istr, LLSD& data, S32 max_bytes, S32 max_dep
 {
 	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
 	mMaxBytesLeft = max_bytes;
+	LLSDArena::Scope arena(mUseArena);
 	return doParse(istr, data, max_depth);
 }
 
@@ -334,6 +335,7 @@ S32 LLSDParser::parseLines(std::istream& istr, LLSD& data)
 {
 	mCheckLimits = false;
 	mParseLines = true;
+	LLSDArena::Scope arena(mUseArena);
 	return doParse(istr, data);
 }
 
@@ -1138,7 +1140,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) con
 			// There must be a value for every key, thus child_count
 			// must be greater than 0.
 			parse_count += child_count;
-			map.insert(name, child);
+			map.insert(std::move(name), std::move(child));
 		}
 		else
 		{
@@ -2148,28 +2150,57 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is,
 
 LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, U8* in, S32 size)
 {
-	U8* result = NULL;
+	std::vector<U8> buffer;
 	U32 cur_size = 0;
+	EZipRresult result = unzip_block(buffer, cur_size, in, size);
+	if (result != ZR_OK)
+	{
+		return result;
+	}
+
+	return parse_llsd_block(data, buffer.data(), cur_size);
+}
+
+LLUZipHelper::EZipRresult LLUZipHelper::unzip_block(std::vector<U8>& buffer, U32& out_size, const U8* in, S32 size)
+{
+	out_size = 0;
 	z_stream strm;
-		
+
 	const U32 CHUNK = 65536;
 
-	U8 out[CHUNK];
-		
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
 	strm.avail_in = size;
-	strm.next_in = in;
+	strm.next_in = const_cast<U8*>(in);
 
 	S32 ret = inflateInit(&strm);
-	
+	if (ret != Z_OK)
+	{
+		return ZR_MEM_ERROR;
+	}
+
 	do
 	{
-		strm.avail_out = CHUNK;
-		strm.next_out = out;
+		// Inflate straight into the buffer, doubling it when it runs short
+		if (buffer.size() - out_size < CHUNK)
+		{
+			try
+			{
+				buffer.resize(llmax(buffer.size() * 2, (size_t)out_size + CHUNK));
+			}
+			catch (const std::bad_alloc&)
+			{
+				LL_WARNS() << "Failed to unzip block: can't reallocate memory, current size: " << out_size << " bytes." << LL_ENDL;
+				inflateEnd(&strm);
+				return ZR_MEM_ERROR;
+			}
+		}
+
+		strm.avail_out = (uInt)(buffer.size() - out_size);
+		strm.next_out = buffer.data() + out_size;
 		ret = inflate(&strm, Z_NO_FLUSH);
-		
+
 		switch (ret)
 		{
 		case Z_NEED_DICT:
@@ -2178,27 +2209,11 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, U8* in, S32 size)
 		case Z_MEM_ERROR:
 		case Z_STREAM_ERROR:
 			inflateEnd(&strm);
-			free(result);
 			return ZR_MEM_ERROR;
 			break;
 		}
 
-		U32 have = CHUNK-strm.avail_out;
-
-		U8* new_result = (U8*)realloc(result, cur_size + have);
-		if (new_result == NULL)
-		{
-			LL_WARNS() << "Failed to unzip LLSD block: can't reallocate memory, current size: " << cur_size << " bytes; requested " << cur_size + have << " bytes." << LL_ENDL;
-			inflateEnd(&strm);
-			if (result)
-			{
-				free(result);
-			}
-			return ZR_MEM_ERROR;
-		}
-		result = new_result;
-		memcpy(result+cur_size, out, have);
-		cur_size += have;
+		out_size = (U32)(buffer.size() - strm.avail_out);
 
 	} while (ret == Z_OK);
 
@@ -2206,25 +2221,24 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, U8* in, S32 size)
 
 	if (ret != Z_STREAM_END)
 	{
-		free(result);
 		return ZR_DATA_ERROR;
 	}
 
-	//result now points to the decompressed LLSD block
-	{
-		char* result_ptr = strip_deprecated_header((char*)result, cur_size);
+	return ZR_OK;
+}
 
-		boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
-		
-		if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
-		{
-			LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
-			free(result);
-			return ZR_PARSE_ERROR;
-		}
+LLUZipHelper::EZipRresult LLUZipHelper::parse_llsd_block(LLSD& data, const U8* in, U32 size)
+{
+	char* result_ptr = strip_deprecated_header((char*)in, size);
+
+	boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, size);
+
+	if (!LLSDSerialize::fromBinary(data, istrm, size, UNZIP_LLSD_MAX_DEPTH))
+	{
+		LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
+		return ZR_PARSE_ERROR;
 	}
 
-	free(result);
 	return ZR_OK;
 }
 
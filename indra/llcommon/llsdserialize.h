@@ -91,6 +91,14 @@ public:
 	 */
 	void reset()	{ doReset();	};
 
+	/** 
+	 * @brief Builds the documents parsed from now on in an LLSDArena of their own.
+	 *
+	 * Worth it for large documents which are read and dropped. Keeping any part of
+	 * such a document keeps the whole arena.
+	 */
+	void setUseArena(bool use_arena)	{ mUseArena = use_arena; }
+
 
 protected:
 	/** 
@@ -212,6 +220,11 @@ protected:
 	 * @brief Use line-based reading to get text
 	 */
 	bool mParseLines;
+
+	/**
+	 * @brief Parse into a new LLSDArena
+	 */
+	bool mUseArena;
 };
 
 /** 
@@ -841,6 +854,13 @@ public:
     // return OK or reason for failure
 	static EZipRresult unzip_llsd(LLSD& data, std::istream& is, S32 size);
 	static EZipRresult unzip_llsd(LLSD& data, U8* in, S32 size);
+
+	// Inflates a zlib block into buffer without parsing it. The buffer only
+	// ever grows, so callers can keep it around as scratch space for the next
+	// block. out_size receives the inflated size.
+	static EZipRresult unzip_block(std::vector<U8>& buffer, U32& out_size, const U8* in, S32 size);
+	// Parses an inflated binary LLSD block, as unzip_llsd() does
+	static EZipRresult parse_llsd_block(LLSD& data, const U8* in, U32 size);
 };
 
 //dirty little zip functions -- yell at davep
@@ -28,11 +28,15 @@
 #define LL_LLTHREADSAFEQUEUE_H
 
 #include "llexception.h"
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <string>
 #include <mutex>
 #include <shared_mutex>
 #include <condition_variable>
+#include <thread>
+#include <vector>
 
 //
 // A general queue exception.
@@ -63,10 +67,25 @@ public:
 	}
 };
 
+//
+// Storage selectors for LLThreadSafeQueue.
+//
+// LLQueueLocked keeps elements in a std::deque behind a mutex. Try operations
+// give up when another thread holds the lock.
+//
+// LLQueueLockFree keeps them in a fixed ring buffer (capacity rounded up to a
+// power of two) that producers and consumers claim slots in with atomics only.
+// Try operations only fail when the queue is full or empty, blocking ones spin
+// briefly and then sleep until the other side makes room or adds something.
+// Elements must be default constructible and assignable.
+//
+struct LLQueueLocked {};
+struct LLQueueLockFree {};
+
 //
 // Implements a thread safe FIFO.
 //
-template<typename ElementT>
+template<typename ElementT, typename StorageT = LLQueueLocked>
 class LLThreadSafeQueue
 {
 public:
@@ -117,15 +136,15 @@ private:
 // LLThreadSafeQueue
 //-----------------------------------------------------------------------------
 
-template<typename ElementT>
-LLThreadSafeQueue<ElementT>::LLThreadSafeQueue(size_t capacity) :
+template<typename ElementT, typename StorageT>
+LLThreadSafeQueue<ElementT, StorageT>::LLThreadSafeQueue(size_t capacity) :
 mCapacity(capacity)
 {
 }
 
 
-template<typename ElementT>
-void LLThreadSafeQueue<ElementT>::pushFront(ElementT const & element)
+template<typename ElementT, typename StorageT>
+void LLThreadSafeQueue<ElementT, StorageT>::pushFront(ElementT const & element)
 {
     while (true)
     {
@@ -144,8 +163,8 @@ void LLThreadSafeQueue<ElementT>::pushFront(ElementT const & element)
 }
 
 
-template<typename ElementT>
-bool LLThreadSafeQueue<ElementT>::tryPushFront(ElementT const & element)
+template<typename ElementT, typename StorageT>
+bool LLThreadSafeQueue<ElementT, StorageT>::tryPushFront(ElementT const & element)
 {
     std::unique_lock<decltype(mLock)> lock1(mLock, std::defer_lock);
     if (!lock1.try_lock())
@@ -160,8 +179,8 @@ bool LLThreadSafeQueue<ElementT>::tryPushFront(ElementT const & element)
 }
 
 
-template<typename ElementT>
-ElementT LLThreadSafeQueue<ElementT>::popBack(void)
+template<typename ElementT, typename StorageT>
+ElementT LLThreadSafeQueue<ElementT, StorageT>::popBack(void)
 {
     while (true)
     {
@@ -181,8 +200,8 @@ ElementT LLThreadSafeQueue<ElementT>::popBack(void)
 }
 
 
-template<typename ElementT>
-bool LLThreadSafeQueue<ElementT>::tryPopBack(ElementT & element)
+template<typename ElementT, typename StorageT>
+bool LLThreadSafeQueue<ElementT, StorageT>::tryPopBack(ElementT & element)
 {
     std::unique_lock<decltype(mLock)> lock1(mLock, std::defer_lock);
     if (!lock1.try_lock())
@@ -198,11 +217,260 @@ bool LLThreadSafeQueue<ElementT>::tryPopBack(ElementT & element)
 }
 
 
-template<typename ElementT>
-size_t LLThreadSafeQueue<ElementT>::size(void)
+template<typename ElementT, typename StorageT>
+size_t LLThreadSafeQueue<ElementT, StorageT>::size(void)
 {
     std::unique_lock<decltype(mLock)> lock(mLock);
     return mStorage.size();
 }
 
+
+// LLThreadSafeQueue, lock free ring buffer
+//-----------------------------------------------------------------------------
+
+// Bounded multi producer, multi consumer queue after Dmitry Vyukov's design.
+// Every slot carries a sequence number telling which lap of the ring it is
+// ready for, so a thread claims a slot with a single compare and swap on the
+// enqueue or dequeue position and never touches the other side's counter.
+template<typename ElementT>
+class LLThreadSafeQueue<ElementT, LLQueueLockFree>
+{
+public:
+	typedef ElementT value_type;
+
+	LLThreadSafeQueue(size_t capacity = 1024U);
+
+	// Same contract as the locked queue, see above
+	void pushFront(ElementT const & element);
+	bool tryPushFront(ElementT const & element);
+	ElementT popBack(void);
+	bool tryPopBack(ElementT & element);
+
+	// Approximate while other threads push or pop
+	size_t size();
+
+	size_t capacity() const { return mMask + 1; }
+
+private:
+	// Spins before a blocked caller goes to sleep
+	static const U32 SPIN_COUNT = 64;
+
+	static size_t roundCapacity(size_t capacity);
+
+	// The try operations without waking anybody
+	bool push(ElementT const & element);
+	bool pop(ElementT & element);
+
+	void wakeWaiters();
+	template<typename TryT> void waitUntil(TryT try_op);
+
+	struct Cell
+	{
+		std::atomic<size_t> mSequence;
+		ElementT mData;
+	};
+
+	std::vector<Cell> mBuffer;
+	size_t mMask;
+
+	// Producers and consumers each hammer their own cache line
+	alignas(64) std::atomic<size_t> mEnqueuePos;
+	alignas(64) std::atomic<size_t> mDequeuePos;
+
+	// Only used by callers blocked on a full or empty queue
+	alignas(64) std::atomic<S32> mWaiters;
+	std::mutex mWaitMutex;
+	std::condition_variable mWaitCond;
+};
+
+template<typename ElementT>
+LLThreadSafeQueue<ElementT, LLQueueLockFree>::LLThreadSafeQueue(size_t capacity) :
+	mBuffer(roundCapacity(capacity)),
+	mMask(mBuffer.size() - 1),
+	mEnqueuePos(0),
+	mDequeuePos(0),
+	mWaiters(0)
+{
+	for (size_t i = 0; i < mBuffer.size(); ++i)
+	{
+		mBuffer[i].mSequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+
+//static
+template<typename ElementT>
+size_t LLThreadSafeQueue<ElementT, LLQueueLockFree>::roundCapacity(size_t capacity)
+{
+	size_t size = 2;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+
+template<typename ElementT>
+bool LLThreadSafeQueue<ElementT, LLQueueLockFree>::tryPushFront(ElementT const & element)
+{
+	if (!push(element))
+	{
+		return false;
+	}
+	wakeWaiters();
+	return true;
+}
+
+
+template<typename ElementT>
+bool LLThreadSafeQueue<ElementT, LLQueueLockFree>::tryPopBack(ElementT & element)
+{
+	if (!pop(element))
+	{
+		return false;
+	}
+	wakeWaiters();
+	return true;
+}
+
+
+template<typename ElementT>
+bool LLThreadSafeQueue<ElementT, LLQueueLockFree>::push(ElementT const & element)
+{
+	Cell* cell;
+	size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		cell = &mBuffer[pos & mMask];
+		size_t seq = cell->mSequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0)
+		{
+			// Slot is free on this lap, claim it
+			if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			// Consumers have not emptied it since the last lap: full
+			return false;
+		}
+		else
+		{
+			// Another producer got there first
+			pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->mData = element;
+	cell->mSequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+
+template<typename ElementT>
+bool LLThreadSafeQueue<ElementT, LLQueueLockFree>::pop(ElementT & element)
+{
+	Cell* cell;
+	size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		cell = &mBuffer[pos & mMask];
+		size_t seq = cell->mSequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+		if (diff == 0)
+		{
+			if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			// Nothing written to it on this lap yet: empty
+			return false;
+		}
+		else
+		{
+			pos = mDequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	element = std::move(cell->mData);
+	// Free for the producers' next lap
+	cell->mSequence.store(pos + mMask + 1, std::memory_order_release);
+	return true;
+}
+
+
+template<typename ElementT>
+void LLThreadSafeQueue<ElementT, LLQueueLockFree>::pushFront(ElementT const & element)
+{
+	waitUntil([&]() { return push(element); });
+}
+
+
+template<typename ElementT>
+ElementT LLThreadSafeQueue<ElementT, LLQueueLockFree>::popBack(void)
+{
+	ElementT value;
+	waitUntil([&]() { return pop(value); });
+	return value;
+}
+
+
+template<typename ElementT>
+size_t LLThreadSafeQueue<ElementT, LLQueueLockFree>::size(void)
+{
+	size_t dequeued = mDequeuePos.load(std::memory_order_relaxed);
+	size_t enqueued = mEnqueuePos.load(std::memory_order_relaxed);
+	return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+
+template<typename ElementT>
+void LLThreadSafeQueue<ElementT, LLQueueLockFree>::wakeWaiters()
+{
+	// Pairs with the fence in waitUntil(): either the waiter sees our change
+	// when it tries again, or we see it waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (mWaiters.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(mWaitMutex);
+		mWaitCond.notify_all();
+	}
+}
+
+
+template<typename ElementT>
+template<typename TryT>
+void LLThreadSafeQueue<ElementT, LLQueueLockFree>::waitUntil(TryT try_op)
+{
+	for (U32 spins = 0; spins < SPIN_COUNT; ++spins)
+	{
+		if (try_op())
+		{
+			wakeWaiters();
+			return;
+		}
+		std::this_thread::yield();
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mWaitMutex);
+		mWaiters.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		// Wakers need the mutex to notify, so nothing slips in between a failed try and the wait
+		while (!try_op())
+		{
+			mWaitCond.wait(lock);
+		}
+		mWaiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+	wakeWaiters();
+}
+
 #endif
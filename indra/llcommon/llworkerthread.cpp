@@ -34,8 +34,8 @@
 //============================================================================
 // Run on MAIN thread
 
-LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded, bool should_pause) :
-	LLQueuedThread(name, threaded, should_pause),
+LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded, bool should_pause, LLJobType* pool_job_type) :
+	LLQueuedThread(name, threaded, should_pause, pool_job_type),
 	mDeleteListSize(0)
 {
 	mDeleteMutex = new LLMutex();
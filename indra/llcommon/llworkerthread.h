@@ -81,7 +81,8 @@ private:
 	LLMutex* mDeleteMutex;
 	
 public:
-	LLWorkerThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	LLWorkerThread(const std::string& name, bool threaded = true, bool should_pause = false,
+				   LLJobType* pool_job_type = nullptr);
 	~LLWorkerThread();
 
 	/*virtual*/ S32 update(F32 max_time_ms) override;
@@ -0,0 +1,362 @@
+/**
+ * @file lljobsystem_test.cpp
+ * @brief Tests for the shared job system and queued threads running on it
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lljobsystem.h"
+
+#include <thread>
+
+#include "../llqueuedthread.h"
+
+#include "../test/lltut.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	LLJobType sTestJobType("test");
+	LLJobType sOtherJobType("other");
+
+	void wait_for_completions(S32 expected, S32& ran)
+	{
+		for (S32 i = 0; i < 1000 && ran < expected; ++i)
+		{
+			LLJobSystem::getInstance()->runCompletions();
+			std::this_thread::sleep_for(1ms);
+		}
+	}
+
+	// Records the order requests ran in, and whether two ever ran at once
+	class TestQueue : public LLQueuedThread
+	{
+	public:
+		class Request : public QueuedRequest
+		{
+		public:
+			Request(TestQueue* queue, handle_t handle, U32 priority, S32 id)
+			:	QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+				mQueue(queue),
+				mID(id)
+			{
+			}
+
+			bool processRequest() override
+			{
+				if (mQueue->mRunning++ > 0)
+				{
+					mQueue->mOverlapped = true;
+				}
+				std::this_thread::sleep_for(100us);
+				{
+					LLMutexLock lock(&mQueue->mOrderMutex);
+					mQueue->mOrder.push_back(mID);
+				}
+				mQueue->mRunning--;
+				return true;
+			}
+
+		private:
+			TestQueue* mQueue;
+			S32 mID;
+		};
+
+		TestQueue()
+		:	LLQueuedThread("TestQueue", true, false, &sTestJobType),
+			mRunning(0),
+			mOverlapped(false)
+		{
+		}
+
+		void add(U32 priority, S32 id)
+		{
+			addRequest(new Request(this, generateHandle(), priority, id));
+		}
+
+		std::vector<S32> getOrder()
+		{
+			LLMutexLock lock(&mOrderMutex);
+			return mOrder;
+		}
+
+		std::atomic<S32> mRunning;
+		std::atomic<bool> mOverlapped;
+		LLMutex mOrderMutex;
+		std::vector<S32> mOrder;
+	};
+}
+
+namespace tut
+{
+	struct jobsystem_data
+	{
+		jobsystem_data()
+		{
+			// Param singletons can only be initialized once per process
+			if (!LLJobSystem::instanceExists())
+			{
+				LLJobSystem::initParamSingleton(2);
+			}
+		}
+	};
+	typedef test_group<jobsystem_data> jobsystem_test;
+	typedef jobsystem_test::object jobsystem_object;
+	tut::jobsystem_test jobsystem("LLJobSystem");
+
+	// Every job runs exactly once
+	template<> template<>
+	void jobsystem_object::test<1>()
+	{
+		LLJobSystem* jobs = LLJobSystem::getInstance();
+		ensure_equals("worker count", jobs->getWorkerCount(), 2U);
+
+		const S32 COUNT = 1000;
+		std::atomic<S32> ran(0);
+		std::atomic<S32> on_worker(0);
+		LLJobSystem::job_list_t submitted;
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			submitted.push_back(jobs->submit(sTestJobType, [&]()
+			{
+				ran++;
+				if (LLJobSystem::isWorkerThread())
+				{
+					on_worker++;
+				}
+			}, (LLJobSystem::EPriority)(i % LLJobSystem::PRIORITY_COUNT)));
+		}
+		for (const auto& job : submitted)
+		{
+			jobs->wait(job);
+			ensure("done", job->isDone());
+		}
+		ensure_equals("ran", (S32)ran, COUNT);
+		// wait() lends a hand, so the main thread may have run a few
+		ensure("mostly on workers", on_worker > 0);
+		ensure("not a worker", !LLJobSystem::isWorkerThread());
+	}
+
+	// Dependents start once everything they depend on has finished
+	template<> template<>
+	void jobsystem_object::test<2>()
+	{
+		LLJobSystem* jobs = LLJobSystem::getInstance();
+		std::atomic<S32> first(0);
+		std::atomic<S32> second(0);
+		S32 seen_first = -1;
+		S32 seen_second = -1;
+
+		LLJobSystem::job_list_t deps;
+		deps.push_back(jobs->submit(sTestJobType, [&]() { std::this_thread::sleep_for(20ms); first = 1; }));
+		deps.push_back(jobs->submit(sTestJobType, [&]() { std::this_thread::sleep_for(10ms); second = 2; }));
+		// Already finished dependencies are not waited for
+		LLJobSystem::job_ptr_t done = jobs->submit(sTestJobType, []() {});
+		jobs->wait(done);
+		deps.push_back(done);
+
+		LLJobSystem::job_ptr_t last = jobs->submit(sTestJobType, [&]()
+		{
+			seen_first = first;
+			seen_second = second;
+		}, LLJobSystem::PRIORITY_HIGH, LLJobSystem::work_t(), deps);
+		jobs->wait(last);
+		ensure_equals("first", seen_first, 1);
+		ensure_equals("second", seen_second, 2);
+	}
+
+	// Completion callbacks run on the thread calling runCompletions(), after the work
+	template<> template<>
+	void jobsystem_object::test<3>()
+	{
+		LLJobSystem* jobs = LLJobSystem::getInstance();
+		const S32 COUNT = 10;
+		std::atomic<S32> worked(0);
+		S32 completed = 0;
+		bool in_order = true;
+		const std::thread::id main_id = std::this_thread::get_id();
+		bool on_main = true;
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			jobs->submit(sTestJobType, [&]() { worked++; }, LLJobSystem::PRIORITY_NORMAL, [&]()
+			{
+				completed++;
+				in_order = in_order && worked >= completed;
+				on_main = on_main && std::this_thread::get_id() == main_id;
+			});
+		}
+		wait_for_completions(COUNT, completed);
+		ensure_equals("completed", completed, COUNT);
+		ensure("after the work", in_order);
+		ensure("on this thread", on_main);
+		ensure_equals("nothing left", jobs->runCompletions(), 0);
+	}
+
+	// Jobs waiting on jobs they submitted do not hold up the pool
+	template<> template<>
+	void jobsystem_object::test<4>()
+	{
+		LLJobSystem* jobs = LLJobSystem::getInstance();
+		std::atomic<S32> leaves(0);
+		LLJobSystem::job_list_t parents;
+		// More parents than workers, each blocking on its children
+		for (S32 i = 0; i < 8; ++i)
+		{
+			parents.push_back(jobs->submit(sTestJobType, [&]()
+			{
+				LLJobSystem::job_list_t children;
+				for (S32 j = 0; j < 8; ++j)
+				{
+					children.push_back(LLJobSystem::getInstance()->submit(sTestJobType, [&]() { leaves++; }));
+				}
+				for (const auto& child : children)
+				{
+					LLJobSystem::getInstance()->wait(child);
+				}
+			}));
+		}
+		for (const auto& parent : parents)
+		{
+			jobs->wait(parent);
+		}
+		ensure_equals("leaves", (S32)leaves, 64);
+	}
+
+	// A queued thread on the pool keeps processing one request at a time, by priority
+	template<> template<>
+	void jobsystem_object::test<5>()
+	{
+		TestQueue queue;
+		ensure("pooled", queue.getPooled());
+
+		// Hold the queue while filling it, so priorities decide the order
+		queue.pause();
+		for (S32 i = 0; i < 20; ++i)
+		{
+			queue.add(LLQueuedThread::PRIORITY_LOW + i, i);
+		}
+		queue.add(LLQueuedThread::PRIORITY_HIGH, 100);
+		ensure_equals("held", queue.getPending(), 21);
+		for (S32 i = 0; i < 1000 && queue.getPending() > 0; ++i)
+		{
+			queue.update(0.f);
+			std::this_thread::sleep_for(1ms);
+		}
+		ensure_equals("drained", queue.getPending(), 0);
+
+		std::vector<S32> order = queue.getOrder();
+		ensure_equals("count", order.size(), (size_t)21);
+		ensure_equals("high first", order[0], 100);
+		for (S32 i = 1; i < 21; ++i)
+		{
+			ensure_equals("low by priority", order[i], 20 - i);
+		}
+		ensure("one at a time", !queue.mOverlapped);
+		queue.shutdown();
+	}
+
+	// Away from the workers, wait() only lends a hand with jobs of the type it waits for
+	template<> template<>
+	void jobsystem_object::test<6>()
+	{
+		LLJobSystem* jobs = LLJobSystem::getInstance();
+		const std::thread::id main_id = std::this_thread::get_id();
+		std::atomic<bool> release(false);
+		std::atomic<S32> blocked(0);
+
+		// Keep both workers busy so everything else stays queued
+		LLJobSystem::job_list_t blockers;
+		for (S32 i = 0; i < 2; ++i)
+		{
+			blockers.push_back(jobs->submit(sOtherJobType, [&]()
+			{
+				blocked++;
+				while (!release)
+				{
+					std::this_thread::sleep_for(100us);
+				}
+			}));
+		}
+		for (S32 i = 0; i < 1000 && blocked < 2; ++i)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+		ensure_equals("workers busy", (S32)blocked, 2);
+
+		std::atomic<S32> other_on_main(0);
+		for (S32 i = 0; i < 10; ++i)
+		{
+			jobs->submit(sOtherJobType, [&]()
+			{
+				if (std::this_thread::get_id() == main_id)
+				{
+					other_on_main++;
+				}
+			}, LLJobSystem::PRIORITY_HIGH);
+		}
+		bool test_on_main = false;
+		LLJobSystem::job_ptr_t job = jobs->submit(sTestJobType, [&]()
+		{
+			test_on_main = std::this_thread::get_id() == main_id;
+		}, LLJobSystem::PRIORITY_LOW);
+		jobs->wait(job);
+		ensure("ran the awaited job", test_on_main);
+		ensure_equals("left the other type alone", (S32)other_on_main, 0);
+
+		release = true;
+		for (const auto& blocker : blockers)
+		{
+			jobs->wait(blocker);
+		}
+	}
+
+	// Shutdown runs what is queued and refuses anything new
+	template<> template<>
+	void jobsystem_object::test<7>()
+	{
+		LLJobSystem* jobs = LLJobSystem::getInstance();
+		std::atomic<S32> ran(0);
+		for (S32 i = 0; i < 100; ++i)
+		{
+			jobs->submit(sTestJobType, [&]() { std::this_thread::sleep_for(100us); ran++; });
+		}
+		jobs->shutdown();
+		ensure_equals("ran", (S32)ran, 100);
+		ensure_equals("no workers", jobs->getWorkerCount(), 0U);
+		ensure("refused", jobs->submit(sTestJobType, []() {}).isNull());
+		LLJobSystem::deleteSingleton();
+
+		// Queued threads created now work on their own
+		TestQueue queue;
+		ensure("not pooled", !queue.getPooled());
+		queue.add(LLQueuedThread::PRIORITY_NORMAL, 1);
+		for (S32 i = 0; i < 1000 && queue.getPending() > 0; ++i)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+		ensure_equals("processed", queue.getOrder().size(), (size_t)1);
+		queue.shutdown();
+	}
+}
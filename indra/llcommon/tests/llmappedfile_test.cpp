@@ -0,0 +1,151 @@
+/**
+ * @file llmappedfile_test.cpp
+ * @brief Tests for LLMappedFile
+ *
+ * @cond
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ * @endcond
+ */
+
+#include "linden_common.h"
+
+#include "../llmappedfile.h"
+
+#include "llfile.h"
+#include "lluuid.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	const size_t PAGE = 4096;
+}
+
+namespace tut
+{
+	struct mappedfile_data
+	{
+		mappedfile_data()
+		{
+			LLUUID id;
+			id.generate();
+			mFileName = std::string(LLFile::tmpdir()) + "llmappedfile_test_" + id.asString();
+		}
+
+		~mappedfile_data()
+		{
+			LLFile::remove(mFileName, ENOENT);
+		}
+
+		std::string mFileName;
+	};
+	typedef test_group<mappedfile_data> mappedfile_test;
+	typedef mappedfile_test::object mappedfile_object;
+	tut::mappedfile_test mappedfile("LLMappedFile");
+
+	template<> template<>
+	void mappedfile_object::test<1>()
+	{
+		set_test_name("Write, close and map again");
+		{
+			LLMappedFile file;
+			ensure("created", file.open(mFileName, LLMappedFile::READ_WRITE, PAGE));
+			ensure("writable", file.isWritable());
+			ensure_equals("size", file.size(), PAGE);
+			*file.getAs<U32>(0) = 0x12345678;
+			*file.getAs<U32>(PAGE - sizeof(U32)) = 0x9ABCDEF0;
+			ensure("past the end", file.getAs<U32>(PAGE - 2) == nullptr);
+			ensure("flushed", file.flush(true));
+		}
+
+		LLMappedFile file;
+		ensure("mapped again", file.open(mFileName, LLMappedFile::READ_ONLY));
+		ensure("read only", !file.isWritable());
+		ensure_equals("same size", file.size(), PAGE);
+		ensure_equals("first word", *file.getAs<U32>(0), 0x12345678U);
+		ensure_equals("last word", *file.getAs<U32>(PAGE - sizeof(U32)), 0x9ABCDEF0U);
+	}
+
+	template<> template<>
+	void mappedfile_object::test<2>()
+	{
+		set_test_name("Growing remaps and keeps the contents");
+		LLMappedFile file;
+		ensure("created", file.open(mFileName, LLMappedFile::READ_WRITE, PAGE));
+		memset(file.data(), 0x5A, PAGE);
+
+		ensure("grown", file.resize(PAGE * 16));
+		ensure_equals("new size", file.size(), PAGE * 16);
+		ensure_equals("old contents", file.data()[PAGE - 1], 0x5A);
+		ensure_equals("new pages are zero", file.data()[PAGE * 16 - 1], 0);
+		file.data()[PAGE * 16 - 1] = 0xA5;
+		file.close();
+
+		// Asking for less than the file holds never shrinks it
+		ensure("mapped again", file.open(mFileName, LLMappedFile::READ_WRITE, PAGE));
+		ensure_equals("kept size", file.size(), PAGE * 16);
+		ensure_equals("grown contents", file.data()[PAGE * 16 - 1], 0xA5);
+	}
+
+	template<> template<>
+	void mappedfile_object::test<3>()
+	{
+		set_test_name("Copy on write stays private");
+		{
+			LLMappedFile file;
+			ensure("created", file.open(mFileName, LLMappedFile::READ_WRITE, PAGE));
+			file.data()[0] = 1;
+		}
+
+		LLMappedFile file;
+		ensure("can't grow a copy", !file.open(mFileName, LLMappedFile::COPY_ON_WRITE, PAGE * 2));
+		ensure("mapped as copy", file.open(mFileName, LLMappedFile::COPY_ON_WRITE));
+		ensure("writable copy", file.isWritable());
+		file.data()[0] = 2;
+		ensure("can't resize a copy", !file.resize(PAGE * 2));
+		file.close();
+
+		ensure("mapped again", file.open(mFileName, LLMappedFile::READ_ONLY));
+		ensure_equals("file untouched", file.data()[0], 1);
+	}
+
+	template<> template<>
+	void mappedfile_object::test<4>()
+	{
+		set_test_name("Anonymous mapping and failures");
+		LLMappedFile file;
+		ensure("missing file", !file.open(mFileName, LLMappedFile::READ_ONLY));
+		ensure("nothing open", !file.isOpen());
+		ensure("no file made", !LLFile::isfile(mFileName));
+		ensure("empty file", !file.open(mFileName, LLMappedFile::READ_WRITE));
+
+		ensure("anonymous needs a size", !file.open(LLStringUtil::null, LLMappedFile::READ_WRITE));
+		ensure("anonymous", file.open(LLStringUtil::null, LLMappedFile::READ_WRITE, PAGE));
+		ensure("anonymous writable", file.isWritable());
+		ensure_equals("anonymous zeroed", file.data()[PAGE - 1], 0);
+		file.data()[0] = 1;
+		ensure("nothing to flush", file.flush(true));
+		file.close();
+		ensure("closed", !file.isOpen());
+		ensure_equals("closed size", file.size(), size_t(0));
+	}
+}
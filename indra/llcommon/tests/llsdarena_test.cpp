@@ -0,0 +1,236 @@
+/**
+ * @file llsdarena_test.cpp
+ * @brief Tests and parse benchmark for LLSD documents built in an LLSDArena
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llsdarena.h"
+
+#include <iostream>
+#include <sstream>
+
+#include "llmemory.h"
+#include "llsdserialize.h"
+#include "llsdutil.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	enum EFormat
+	{
+		FORMAT_BINARY,
+		FORMAT_NOTATION,
+		FORMAT_XML,
+		FORMAT_COUNT
+	};
+
+	const char* FORMAT_NAMES[FORMAT_COUNT] = { "binary", "notation", "xml" };
+
+	// Shaped like an AIS inventory fetch, no real captures ship with the tree
+	LLSD make_inventory(S32 count)
+	{
+		LLSD items = LLSD::emptyArray();
+		for (S32 i = 0; i < count; ++i)
+		{
+			LLSD item;
+			item["item_id"] = LLUUID::generateNewID();
+			item["parent_id"] = LLUUID::generateNewID();
+			item["asset_id"] = LLUUID::generateNewID();
+			item["name"] = llformat("Item number %d", i);
+			item["desc"] = "(No Description)";
+			item["type"] = 6;
+			item["inv_type"] = 6;
+			item["flags"] = i;
+			item["created_at"] = LLDate::now();
+			item["sale_info"] = LLSDMap("sale_price", 10)("sale_type", "not");
+			item["permissions"] = LLSDMap("base_mask", 0x7fffffff)("owner_mask", 0x7fffffff)
+				("group_mask", 0)("everyone_mask", 0)("next_owner_mask", 0x82000)
+				("creator_id", LLUUID::generateNewID())("owner_id", LLUUID::generateNewID());
+			items.append(item);
+		}
+		return LLSDMap("folder_id", LLUUID::generateNewID())("version", 42)("items", items);
+	}
+
+	std::string format(const LLSD& sd, EFormat format)
+	{
+		std::ostringstream str;
+		switch (format)
+		{
+		case FORMAT_BINARY:		LLSDSerialize::toBinary(sd, str);	break;
+		case FORMAT_NOTATION:	LLSDSerialize::toNotation(sd, str);	break;
+		default:				LLSDSerialize::toXML(sd, str);		break;
+		}
+		return str.str();
+	}
+
+	LLPointer<LLSDParser> make_parser(EFormat format)
+	{
+		switch (format)
+		{
+		case FORMAT_BINARY:		return new LLSDBinaryParser;
+		case FORMAT_NOTATION:	return new LLSDNotationParser;
+		default:				return new LLSDXMLParser;
+		}
+	}
+
+	LLSD parse(const std::string& text, EFormat format, bool use_arena)
+	{
+		std::istringstream str(text);
+		LLPointer<LLSDParser> parser = make_parser(format);
+		parser->setUseArena(use_arena);
+		LLSD sd;
+		tut::ensure("parsed", parser->parse(str, sd, LLSDSerialize::SIZE_UNLIMITED) > 0);
+		return sd;
+	}
+}
+
+namespace tut
+{
+	struct sdarena_data
+	{
+	};
+	typedef test_group<sdarena_data> sdarena_test;
+	typedef sdarena_test::object sdarena_object;
+	tut::sdarena_test sdarena("LLSDArena");
+
+	// Chunks grow, allocations stay aligned and are recognized
+	template<> template<>
+	void sdarena_object::test<1>()
+	{
+		LLPointer<LLSDArena> arena;
+		{
+			LLSDArena::Scope scope;
+			arena = scope.getArena();
+			ensure("current", LLSDArena::current() == arena.get());
+			{
+				LLSDArena::Scope disabled(false);
+				ensure("unchanged", LLSDArena::current() == arena.get());
+				LLSDArena::Scope nested;
+				ensure("nested", LLSDArena::current() == nested.getArena());
+			}
+			ensure("restored", LLSDArena::current() == arena.get());
+		}
+		ensure("closed", LLSDArena::current() == nullptr);
+
+		// Every fundamental alignment, even where it is more than a pointer's
+		std::vector<void*> blocks;
+		for (S32 i = 0; i < 1000; ++i)
+		{
+			const size_t align = (size_t)1 << (i % 5);
+			if (align > alignof(std::max_align_t))
+			{
+				continue;
+			}
+			void* p = arena->allocate(1 + i % 97, align);
+			ensure("aligned", ((uintptr_t)p & (align - 1)) == 0);
+			blocks.push_back(p);
+		}
+		void* large = arena->allocate(1024 * 1024, 8);
+		for (void* p : blocks)
+		{
+			ensure("owned", arena->owns(p));
+		}
+		ensure("large owned", arena->owns(large));
+		S32 on_heap = 0;
+		ensure("heap not owned", !arena->owns(&on_heap));
+		ensure("used", arena->getUsedBytes() <= arena->getAllocatedBytes());
+	}
+
+	// Documents survive the round trip in every format
+	template<> template<>
+	void sdarena_object::test<2>()
+	{
+		const LLSD inventory = make_inventory(200);
+		for (S32 f = 0; f < FORMAT_COUNT; ++f)
+		{
+			const std::string text = format(inventory, (EFormat)f);
+			LLSD parsed = parse(text, (EFormat)f, true);
+			ensure(std::string("equal ") + FORMAT_NAMES[f], llsd_equals(parsed, inventory));
+		}
+	}
+
+	// Parts kept after the document is dropped keep the arena, later changes go to the heap
+	template<> template<>
+	void sdarena_object::test<3>()
+	{
+		const LLSD inventory = make_inventory(50);
+		LLSD kept;
+		LLSD copy;
+		{
+			LLSD parsed = parse(format(inventory, FORMAT_BINARY), FORMAT_BINARY, true);
+			kept = parsed["items"][7];
+			copy = parsed["items"][8];
+
+			// Changing a parsed map once the parse is done
+			parsed["items"][9]["name"] = "renamed";
+			parsed["items"][9]["extra"] = LLSDMap("added", true);
+			parsed["items"][9].erase("desc");
+			ensure_equals("renamed", parsed["items"][9]["name"].asString(), std::string("renamed"));
+			ensure("added", parsed["items"][9]["extra"]["added"].asBoolean());
+			ensure("erased", !parsed["items"][9].has("desc"));
+		}
+		ensure("kept", llsd_equals(kept, inventory["items"][7]));
+		ensure("shared", llsd_equals(copy, inventory["items"][8]));
+
+		kept["permissions"]["owner_mask"] = 0;
+		kept.insert("more", LLSD::emptyMap());
+		ensure_equals("changed", kept["permissions"]["owner_mask"].asInteger(), 0);
+		ensure("inserted", kept.has("more"));
+
+		// Copy on write moves the copy out of the arena
+		LLSD other = copy;
+		other["name"] = "other";
+		ensure_equals("copy written", other["name"].asString(), std::string("other"));
+		ensure("original untouched", llsd_equals(copy, inventory["items"][8]));
+	}
+
+	// Parse time and memory, with and without an arena
+	template<> template<>
+	void sdarena_object::test<4>()
+	{
+		const LLSD inventory = make_inventory(10000);
+		std::cout << "\nLLSD parse of " << inventory["items"].size() << " inventory items:" << std::endl;
+		for (S32 f = 0; f < FORMAT_COUNT; ++f)
+		{
+			const std::string text = format(inventory, (EFormat)f);
+			F64 seconds[2];
+			S64 rss[2];
+			for (S32 use_arena = 0; use_arena < 2; ++use_arena)
+			{
+				const U64 rss_before = LLMemory::getCurrentRSS();
+				LLTimer timer;
+				LLSD parsed = parse(text, (EFormat)f, use_arena);
+				rss[use_arena] = (S64)LLMemory::getCurrentRSS() - (S64)rss_before;
+				parsed.clear();
+				seconds[use_arena] = timer.getElapsedTimeF64();
+			}
+			std::cout << "  " << FORMAT_NAMES[f] << " (" << text.size() / 1024 << " KB): heap "
+					  << seconds[0] * 1000.0 << " ms, " << rss[0] / 1024 << " KB resident; arena "
+					  << seconds[1] * 1000.0 << " ms, " << rss[1] / 1024 << " KB resident" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,207 @@
+/**
+ * @file llthreadsafequeue_test.cpp
+ * @brief Tests and contention benchmark for both LLThreadSafeQueue storages
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llthreadsafequeue.h"
+
+#include <iostream>
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// Every producer pushes 1..count, so the consumers' total tells whether
+	// anything was lost or duplicated
+	template<typename QueueT>
+	U64 run_contention(QueueT& queue, S32 producers, S32 consumers, U64 count)
+	{
+		std::atomic<U64> total(0);
+		std::atomic<S32> producers_left(producers);
+		std::vector<std::thread> threads;
+		for (S32 i = 0; i < producers; ++i)
+		{
+			threads.emplace_back([&]()
+			{
+				for (U64 n = 1; n <= count; ++n)
+				{
+					queue.pushFront(n);
+				}
+				producers_left--;
+			});
+		}
+		for (S32 i = 0; i < consumers; ++i)
+		{
+			threads.emplace_back([&]()
+			{
+				U64 sum = 0;
+				U64 value = 0;
+				while (true)
+				{
+					if (queue.tryPopBack(value))
+					{
+						sum += value;
+					}
+					else if (producers_left == 0 && queue.size() == 0)
+					{
+						break;
+					}
+					else
+					{
+						std::this_thread::yield();
+					}
+				}
+				total += sum;
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		return total;
+	}
+
+	template<typename QueueT>
+	F64 time_contention(S32 producers, S32 consumers, U64 count)
+	{
+		QueueT queue(1024);
+		LLTimer timer;
+		U64 total = run_contention(queue, producers, consumers, count);
+		F64 elapsed = timer.getElapsedTimeF64();
+		tut::ensure_equals(llformat("%d/%d total", producers, consumers), total, (U64)producers * count * (count + 1) / 2);
+		return elapsed;
+	}
+}
+
+namespace tut
+{
+	struct threadsafequeue_data
+	{
+	};
+	typedef test_group<threadsafequeue_data> threadsafequeue_test;
+	typedef threadsafequeue_test::object threadsafequeue_object;
+	tut::threadsafequeue_test threadsafequeue("LLThreadSafeQueue");
+
+	// First in, first out, and full queues refuse more
+	template<> template<>
+	void threadsafequeue_object::test<1>()
+	{
+		LLThreadSafeQueue<S32> locked(4);
+		LLThreadSafeQueue<S32, LLQueueLockFree> lockfree(4);
+		ensure_equals("capacity", lockfree.capacity(), (size_t)4);
+		for (S32 i = 0; i < 4; ++i)
+		{
+			ensure("locked push", locked.tryPushFront(i));
+			ensure("lock free push", lockfree.tryPushFront(i));
+		}
+		ensure("locked full", !locked.tryPushFront(4));
+		ensure("lock free full", !lockfree.tryPushFront(4));
+		ensure_equals("locked size", locked.size(), (size_t)4);
+		ensure_equals("lock free size", lockfree.size(), (size_t)4);
+
+		S32 value = -1;
+		for (S32 i = 0; i < 4; ++i)
+		{
+			ensure("locked pop", locked.tryPopBack(value));
+			ensure_equals("locked order", value, i);
+			ensure("lock free pop", lockfree.tryPopBack(value));
+			ensure_equals("lock free order", value, i);
+		}
+		ensure("locked empty", !locked.tryPopBack(value));
+		ensure("lock free empty", !lockfree.tryPopBack(value));
+
+		// Wraps around the ring more than once
+		for (S32 i = 0; i < 10; ++i)
+		{
+			lockfree.pushFront(i);
+			ensure_equals("lock free wrap", lockfree.popBack(), i);
+		}
+	}
+
+	// Capacity rounds up to a power of two, non trivial elements survive
+	template<> template<>
+	void threadsafequeue_object::test<2>()
+	{
+		LLThreadSafeQueue<std::string, LLQueueLockFree> queue(100);
+		ensure_equals("capacity", queue.capacity(), (size_t)128);
+		for (S32 i = 0; i < 128; ++i)
+		{
+			ensure("push", queue.tryPushFront(llformat("element %d", i)));
+		}
+		ensure("full", !queue.tryPushFront("one too many"));
+		std::string value;
+		for (S32 i = 0; i < 128; ++i)
+		{
+			ensure("pop", queue.tryPopBack(value));
+			ensure_equals("value", value, llformat("element %d", i));
+		}
+	}
+
+	// Blocking calls wait for the other side, in both directions
+	template<> template<>
+	void threadsafequeue_object::test<3>()
+	{
+		LLThreadSafeQueue<S32, LLQueueLockFree> queue(2);
+		const S32 COUNT = 10000;
+		S64 sum = 0;
+		std::thread consumer([&]()
+		{
+			for (S32 i = 0; i < COUNT; ++i)
+			{
+				sum += queue.popBack();
+			}
+		});
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			queue.pushFront(i);
+			if (i % 1000 == 0)
+			{
+				// Let the consumer go to sleep on an empty queue now and then
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+		}
+		consumer.join();
+		ensure_equals("sum", sum, (S64)COUNT * (COUNT - 1) / 2);
+	}
+
+	// Nothing lost or duplicated under contention, and how the two compare
+	template<> template<>
+	void threadsafequeue_object::test<4>()
+	{
+		const U64 COUNT = 200000;
+		const S32 threads[][2] = { { 1, 1 }, { 2, 2 }, { 4, 4 }, { 8, 1 }, { 1, 8 } };
+		std::cout << "\nLLThreadSafeQueue, " << COUNT << " elements per producer:" << std::endl;
+		for (const auto& config : threads)
+		{
+			F64 locked = time_contention<LLThreadSafeQueue<U64> >(config[0], config[1], COUNT);
+			F64 lockfree = time_contention<LLThreadSafeQueue<U64, LLQueueLockFree> >(config[0], config[1], COUNT);
+			std::cout << "  " << config[0] << " producer(s), " << config[1] << " consumer(s): locked "
+					  << locked * 1000.0 << " ms, lock free " << lockfree * 1000.0 << " ms" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,199 @@
+/**
+ * @file _httpconcurrency.cpp
+ * @brief Definitions for internal class adapting a policy class's concurrency.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "_httpconcurrency.h"
+
+#include "_httpinternal.h"
+
+#include <algorithm>
+
+
+namespace LLCore
+{
+
+
+HttpConcurrencyControl::HttpConcurrencyControl()
+	: mCeiling(0),
+	  mLimit(0),
+	  mHoldOff(0),
+	  mWindowStart(0),
+	  mSamples(0),
+	  mRTTSum(0),
+	  mBaseRTTSum(0),
+	  mBytes(0),
+	  mSaturated(false),
+	  mBaseRTT(0),
+	  mWindowRTT(0),
+	  mThroughput(0)
+{
+	std::fill_n(mSizeBaseRTT, SIZE_CLASS_COUNT, HttpTime(0));
+}
+
+
+HttpConcurrencyControl::~HttpConcurrencyControl()
+{}
+
+
+void HttpConcurrencyControl::setCeiling(int ceiling)
+{
+	if (ceiling == mCeiling)
+	{
+		return;
+	}
+	
+	if (ceiling <= 0)
+	{
+		// Off, start from scratch next time
+		mCeiling = 0;
+		mLimit = 0;
+		mHoldOff = 0;
+		std::fill_n(mSizeBaseRTT, SIZE_CLASS_COUNT, HttpTime(0));
+		mBaseRTT = 0;
+		mWindowRTT = 0;
+		mThroughput = 0;
+		resetWindow();
+		return;
+	}
+
+	// Start at the ceiling.  That's how the class behaved
+	// without control and the first congestion brings it down.
+	if (! mCeiling || mLimit > ceiling)
+	{
+		mLimit = ceiling;
+	}
+	mCeiling = ceiling;
+}
+
+
+HttpConcurrencyControl::EChange HttpConcurrencyControl::onCompletion(HttpTime now,
+																	 HttpTime rtt,
+																	 size_t bytes,
+																	 bool congested)
+{
+	if (! mCeiling)
+	{
+		return CHANGE_NONE;
+	}
+
+	if (mHoldOff > 0)
+	{
+		// Issued before the last backoff, its news is old
+		--mHoldOff;
+		if (congested)
+		{
+			return CHANGE_NONE;
+		}
+	}
+	else if (congested)
+	{
+		// Multiplicative decrease.  Everything still active was
+		// issued under the old limit, don't punish it twice.
+		mHoldOff = mLimit;
+		mLimit = (std::max)(HTTP_CONCURRENCY_LIMIT_MIN, mLimit / 2);
+		resetWindow();
+		return CHANGE_BACKOFF;
+	}
+
+	if (! mSamples)
+	{
+		mWindowStart = now - (std::min)(now, rtt);
+	}
+
+	// Judge the sample against the best seen at its size.  Drift
+	// up slowly so a route or server change doesn't leave us
+	// comparing against a minimum that's gone.
+	HttpTime & size_base(mSizeBaseRTT[getSizeClass(bytes)]);
+	if (! size_base || rtt < size_base)
+	{
+		size_base = rtt;
+	}
+	mBaseRTTSum += size_base;
+	size_base += (rtt - size_base) / 256;
+
+	++mSamples;
+	mRTTSum += rtt;
+	mBytes += bytes;
+	if (mSamples < (std::max)(mLimit, HTTP_CONCURRENCY_WINDOW_MIN))
+	{
+		return CHANGE_NONE;
+	}
+
+	// Window complete
+	const U64 last_throughput(mThroughput);
+	const HttpTime elapsed((std::max)(now - mWindowStart, HttpTime(1)));
+	mWindowRTT = mRTTSum / mSamples;
+	mBaseRTT = mBaseRTTSum / mSamples;
+	mThroughput = mBytes * U64L(1000000) / elapsed;
+
+	EChange change(CHANGE_NONE);
+	if (mWindowRTT > mBaseRTT * HTTP_CONCURRENCY_LATENCY_TOLERANCE)
+	{
+		// Latency gradient says requests are queueing up
+		if (mLimit > HTTP_CONCURRENCY_LIMIT_MIN)
+		{
+			--mLimit;
+			change = CHANGE_DECREASE;
+		}
+	}
+	else if (mSaturated
+			 && mLimit < mCeiling
+			 && mThroughput * 4 >= last_throughput * 3)
+	{
+		// Had more work than room and the last step didn't
+		// cost us throughput, try one more.
+		++mLimit;
+		change = CHANGE_INCREASE;
+	}
+	resetWindow();
+	return change;
+}
+
+
+// static
+int HttpConcurrencyControl::getSizeClass(size_t bytes)
+{
+	// Under 8KB, under 16KB, ... 512KB and up
+	int size_class(0);
+	for (bytes >>= 13; bytes && size_class < SIZE_CLASS_COUNT - 1; bytes >>= 1)
+	{
+		++size_class;
+	}
+	return size_class;
+}
+
+
+void HttpConcurrencyControl::resetWindow()
+{
+	mWindowStart = 0;
+	mSamples = 0;
+	mRTTSum = 0;
+	mBaseRTTSum = 0;
+	mBytes = 0;
+	mSaturated = false;
+}
+
+
+}  // end namespace LLCore
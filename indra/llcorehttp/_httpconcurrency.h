@@ -0,0 +1,150 @@
+/**
+ * @file _httpconcurrency.h
+ * @brief Declarations for internal class adapting a policy class's concurrency.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2012-2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef	_LLCORE_HTTP_CONCURRENCY_H_
+#define	_LLCORE_HTTP_CONCURRENCY_H_
+
+
+#include "httpcommon.h"
+
+
+namespace LLCore
+{
+
+/// Adaptive limit on the number of requests a policy class has
+/// active at one time.  Works below a ceiling taken from the
+/// class's connection and pipelining options, which stay in force
+/// as hard limits in libcurl.
+///
+/// The limit follows an AIMD scheme.  Congestion reported by the
+/// service (503, 429 and other retryable failures) halves it.  Once
+/// per window of completions, about a round trip's worth, latency
+/// is compared to the lowest seen for responses of the same size:
+/// a queue building up somewhere takes one off the limit, otherwise
+/// a class that had work waiting gets one more as long as
+/// throughput isn't falling.
+///
+/// Sizes are grouped into power of two classes, each with its own
+/// baseline, so a window heavy in large transfers isn't mistaken
+/// for congestion on a class that also makes small requests.
+///
+/// Threading:  not thread-safe.  Expected to be used entirely by
+/// the worker thread.
+class HttpConcurrencyControl
+{
+public:
+	HttpConcurrencyControl();
+	~HttpConcurrencyControl();
+
+	HttpConcurrencyControl(const HttpConcurrencyControl &) = delete;		// Not defined
+	void operator=(const HttpConcurrencyControl &) = delete;				// Not defined
+
+	enum EChange
+	{
+		CHANGE_NONE,
+		CHANGE_INCREASE,			// additive increase
+		CHANGE_DECREASE,			// latency rising
+		CHANGE_BACKOFF				// congestion reported
+	};
+
+	/// Set the most requests allowed to be active.  A limit above
+	/// it is brought down to it.  Zero turns control off and
+	/// forgets what was learned, the next ceiling set starts over.
+	void setCeiling(int ceiling);
+	int getCeiling() const
+		{
+			return mCeiling;
+		}
+
+	int getLimit() const
+		{
+			return mLimit;
+		}
+
+	/// Note that the class had requests waiting for room under
+	/// the limit.  Only a limit that was in the way is raised.
+	void noteSaturated()
+		{
+			mSaturated = true;
+		}
+
+	/// Feed one finished transfer.
+	///
+	/// @param now			Completion time
+	/// @param rtt			Time from issue to completion
+	/// @param bytes		Body bytes received
+	/// @param congested	Service reported congestion
+	/// @return				Change made to the limit, if any
+	EChange onCompletion(HttpTime now, HttpTime rtt, size_t bytes, bool congested);
+
+	/// Baseline for the most recent window's mix of sizes, and its
+	/// average latency
+	HttpTime getBaseRTT() const
+		{
+			return mBaseRTT;
+		}
+	HttpTime getWindowRTT() const
+		{
+			return mWindowRTT;
+		}
+
+	/// Bytes per second over the most recent window
+	U64 getThroughput() const
+		{
+			return mThroughput;
+		}
+
+	/// Size class of a response of bytes
+	static int getSizeClass(size_t bytes);
+
+	enum { SIZE_CLASS_COUNT = 8 };
+
+protected:
+	void resetWindow();
+	
+protected:
+	int					mCeiling;
+	int					mLimit;
+	int					mHoldOff;			// Completions to ignore congestion from after a backoff
+
+	// Window being gathered
+	HttpTime			mWindowStart;
+	int					mSamples;
+	HttpTime			mRTTSum;
+	HttpTime			mBaseRTTSum;		// Sum of the baselines of the window's sizes
+	U64					mBytes;
+	bool				mSaturated;
+
+	// Results of earlier windows
+	HttpTime			mSizeBaseRTT[SIZE_CLASS_COUNT];	// Lowest latency, by size class
+	HttpTime			mBaseRTT;
+	HttpTime			mWindowRTT;
+	U64					mThroughput;
+};  // end class HttpConcurrencyControl
+
+}  // end namespace LLCore
+
+#endif	// _LLCORE_HTTP_CONCURRENCY_H_
@@ -156,9 +156,20 @@ const long HTTP_PIPELINING_MAX = 20L;
 // Miscellaneous defaults
 const bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
+const long HTTP_COALESCE_LIMIT_DEFAULT = 0L;
+const long HTTP_COALESCE_LIMIT_MAX = 64L * 1024L * 1024L;
+const long HTTP_ADAPTIVE_CONCURRENCY_DEFAULT = 0L;
 
 // Tuning parameters
 
+// Adaptive concurrency.  Lowest limit the controller goes to,
+// fewest completions it judges latency on and how many times
+// the baseline latency a window may average before the limit
+// is taken down.
+const int HTTP_CONCURRENCY_LIMIT_MIN = 1;
+const int HTTP_CONCURRENCY_WINDOW_MIN = 4;
+const int HTTP_CONCURRENCY_LATENCY_TOLERANCE = 2;
+
 // Time worker thread sleeps after a pass through the
 // request, ready and active queues.
 const int HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS = 2;
@@ -299,6 +299,9 @@ void HttpLibcurl::cancelRequest(const HttpOpRequest::ptr_t &op)
 						   << LL_ENDL;
 	}
 
+	// Requests riding on this transfer weren't canceled, send them back
+	mService->getPolicy().releaseCoalesced(op);
+
 	// Cancel op and deliver for notification
 	op->cancel();
 }
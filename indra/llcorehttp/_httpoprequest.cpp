@@ -155,6 +155,9 @@ HttpOpRequest::HttpOpRequest()
 	  mPolicyRetryLimit(HTTP_RETRY_COUNT_DEFAULT),
 	  mPolicyMinRetryBackoff(HttpTime(HTTP_RETRY_BACKOFF_MIN_DEFAULT)),
 	  mPolicyMaxRetryBackoff(HttpTime(HTTP_RETRY_BACKOFF_MAX_DEFAULT)),
+	  mPolicyIssuedAt(HttpTime(0)),
+	  mCoalescedOffset(0),
+	  mCoalescedLength(0),
       mRequestId(0)
 {
 	// *NOTE:  As members are added, retry initialization/cleanup
@@ -302,6 +305,64 @@ HttpStatus HttpOpRequest::cancel()
 }
 
 
+bool HttpOpRequest::canCoalesceWith(const HttpOpRequest & other) const
+{
+	return (HOR_GET == mReqMethod
+			&& HOR_GET == other.mReqMethod
+			&& (mProcFlags & PF_SCAN_RANGE_HEADER)
+			&& (other.mProcFlags & PF_SCAN_RANGE_HEADER)
+			&& mReqLength
+			&& other.mReqLength
+			&& mReqHeaders == other.mReqHeaders
+			&& mReqOptions == other.mReqOptions
+			&& mReqURL == other.mReqURL);
+}
+
+
+bool HttpOpRequest::takeCoalescedReply(const HttpOpRequest & carrier, off_t body_offset)
+{
+	BufferArray * body(carrier.mReplyBody);
+	size_t offset(carrier.mReplyOffset), length(carrier.mReplyLength), full_length(carrier.mReplyFullLength);
+	if (body && body_offset >= 0)
+	{
+		// Cut our range out of the partial body
+		const size_t body_size(body->size());
+		if (mReqOffset < body_offset || size_t(mReqOffset - body_offset) >= body_size)
+		{
+			return false;
+		}
+		const size_t pos(mReqOffset - body_offset);
+		offset = mReqOffset;
+		length = (std::min)(mReqLength, body_size - pos);
+		BufferArray * part = new BufferArray();
+		body->read(pos, part->appendBufferAlloc(length), length);
+		body = part;
+	}
+	else if (body)
+	{
+		body->addRef();
+	}
+
+	mStatus = carrier.mStatus;
+	mReplyHeaders = carrier.mReplyHeaders;
+	mReplyConType = carrier.mReplyConType;
+	mReplyRetryAfter = carrier.mReplyRetryAfter;
+	mPolicyRetries = carrier.mPolicyRetries;
+	mPolicy503Retries = carrier.mPolicy503Retries;
+	mReplyOffset = offset;
+	mReplyLength = length;
+	mReplyFullLength = full_length;
+
+	// Carrier may be ourselves, don't release its body before we're done with it
+	if (mReplyBody)
+	{
+		mReplyBody->release();
+	}
+	mReplyBody = body;
+	return true;
+}
+
+
 HttpStatus HttpOpRequest::setupGet(HttpRequest::policy_t policy_id,
 								   HttpRequest::priority_t priority,
 								   const std::string & url,
@@ -31,6 +31,7 @@
 #include "linden_common.h"		// Modifies curl/curl.h interfaces
 
 #include <string>
+#include <vector>
 #include <curl/curl.h>
 
 #include <openssl/x509_vfy.h>
@@ -163,6 +164,25 @@ public:
 
 	HttpStatus cancel() override;
 
+	// True if both are bounded byte range GETs of the same
+	// resource with the same headers and options, so one
+	// transfer can answer both.
+	//
+	// Threading:  called by worker thread
+	//
+	bool canCoalesceWith(const HttpOpRequest & other) const;
+
+	// Takes this request's share of a transfer made for a coalesced
+	// request.  body_offset is the position of the carrier's reply body
+	// within the resource when the body is partial, -1 when it isn't
+	// (a full body or a failure, handed over as is).  Returns false if
+	// the body doesn't reach this request's range, which should then be
+	// issued on its own.
+	//
+	// Threading:  called by worker thread
+	//
+	bool takeCoalescedReply(const HttpOpRequest & carrier, off_t body_offset);
+
 protected:
 	// Common setup for all the request methods.
 	//
@@ -232,6 +252,14 @@ public:
 	int					mPolicyRetryLimit;
 	HttpTime			mPolicyMinRetryBackoff; // initial delay between retries (mcs)
 	HttpTime			mPolicyMaxRetryBackoff;
+	HttpTime			mPolicyIssuedAt;		// when last handed to transport
+
+	// Coalescing data.  A carrier request holds the requests riding
+	// on its transfer and its own range from before it was widened.
+	std::vector<ptr_t>	mCoalescedOps;
+	std::weak_ptr<HttpOpRequest> mCoalescedInto;
+	off_t				mCoalescedOffset;
+	size_t				mCoalescedLength;
 
     // Alchemy: Request ID for message logger
     U64                 mRequestId;
@@ -32,9 +32,13 @@
 #include "_httpservice.h"
 #include "_httplibcurl.h"
 #include "_httppolicyclass.h"
+#include "_httpconcurrency.h"
 
 #include "lltimer.h"
 #include "httpstats.h"
+#include "bufferarray.h"
+
+#include <algorithm>
 
 namespace
 {
@@ -67,6 +71,7 @@ public:
 	HttpRetryQueue		mRetryQueue;
 
 	HttpPolicyClass		mOptions;
+	HttpConcurrencyControl	mConcurrency;
 	HttpTime			mThrottleEnd;
 	long				mThrottleLeft;
 	long				mRequestCount;
@@ -120,6 +125,8 @@ void HttpPolicy::shutdown()
 			HttpOpRequest::ptr_t op(retryq.top());
 			retryq.pop();
 		
+			// Riders go to the ready queue and are canceled below
+			releaseCoalesced(op);
 			op->cancel();
 		}
 
@@ -252,6 +259,16 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 						 ? (state.mOptions.mPerHostConnectionLimit
 							* state.mOptions.mPipelining)
 						 : state.mOptions.mConnectionLimit);
+		if (state.mOptions.mAdaptiveConcurrency)
+		{
+			// Configured limit is now the ceiling
+			state.mConcurrency.setCeiling(active_limit);
+			active_limit = state.mConcurrency.getLimit();
+		}
+		else
+		{
+			state.mConcurrency.setCeiling(0);
+		}
 		int needed(active_limit - active);		// Expect negatives here
 
 		if (needed > 0)
@@ -265,6 +282,7 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 			
 				retryq.pop();
 				
+				op->mPolicyIssuedAt = now;
 				op->stageFromReady(mService);
                 op.reset();
 
@@ -294,6 +312,11 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 				HttpOpRequest::ptr_t op(readyq.top());
 				readyq.pop();
 
+				if (state.mOptions.mCoalesceLimit > 0L)
+				{
+					coalesceReady(state, op);
+				}
+				op->mPolicyIssuedAt = now;
 				op->stageFromReady(mService);
 				op.reset();
 					
@@ -318,6 +341,12 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 			}
 		}
 
+		if (needed <= 0 && ! readyq.empty())
+		{
+			// Work is waiting on the concurrency limit
+			state.mConcurrency.noteSaturated();
+		}
+
 	throttle_on:
 		
 		if (! readyq.empty() || ! retryq.empty())
@@ -377,6 +406,7 @@ bool HttpPolicy::cancel(HttpHandle handle)
 			{
 				HttpOpRequest::ptr_t op(*cur);
 				c1.erase(cur);									// All iterators are now invalidated
+				releaseCoalesced(op);
 				op->cancel();
 				return true;
 			}
@@ -397,6 +427,18 @@ bool HttpPolicy::cancel(HttpHandle handle)
 			}
 		}
 	}
+
+	// Finally, the request may be riding on another's transfer
+	HttpOpRequest::ptr_t op(HttpOpRequest::fromHandle<HttpOpRequest>(handle));
+	HttpOpRequest::ptr_t carrier(op ? op->mCoalescedInto.lock() : HttpOpRequest::ptr_t());
+	if (carrier)
+	{
+		std::vector<HttpOpRequest::ptr_t> & parts(carrier->mCoalescedOps);
+		parts.erase(std::remove(parts.begin(), parts.end(), op), parts.end());
+		op->mCoalescedInto.reset();
+		op->cancel();
+		return true;
+	}
 	
 	return false;
 }
@@ -404,6 +446,8 @@ bool HttpPolicy::cancel(HttpHandle handle)
 
 bool HttpPolicy::stageAfterCompletion(const HttpOpRequest::ptr_t &op)
 {
+	adaptConcurrency(op);
+	
 	// Retry or finalize
 	if (! op->mStatus)
 	{
@@ -428,6 +472,13 @@ bool HttpPolicy::stageAfterCompletion(const HttpOpRequest::ptr_t &op)
 		}
 	}
 
+	if (! op->mCoalescedOps.empty() && ! splitCoalesced(op))
+	{
+		// Server sent less than asked for, try our own range alone
+		addOp(op);
+		return true;
+	}
+
 	// This op is done, finalize it delivering it to the reply queue...
 	if (! op->mStatus)
 	{
@@ -450,6 +501,191 @@ bool HttpPolicy::stageAfterCompletion(const HttpOpRequest::ptr_t &op)
 	return false;						// not active
 }
 
+
+void HttpPolicy::adaptConcurrency(const HttpOpRequest::ptr_t &op)
+{
+	static const HttpStatus error_429(429);
+	static const HttpStatus error_503(503);
+
+	ClassState & state(*mClasses[op->mReqPolicy]);
+	if (! state.mOptions.mAdaptiveConcurrency)
+	{
+		return;
+	}
+
+	// Server busy replies and transport trouble say we are
+	// asking too much.  Other failures are about the request.
+	const bool congested(error_503 == op->mStatus
+						 || error_429 == op->mStatus
+						 || (! op->mStatus.isHttpStatus() && op->mStatus.isRetryable()));
+	const HttpTime now(totalTime());
+	const HttpTime rtt(now > op->mPolicyIssuedAt ? now - op->mPolicyIssuedAt : HttpTime(0));
+	const size_t bytes(op->mReplyBody ? op->mReplyBody->size() : 0);
+
+	HttpConcurrencyControl & control(state.mConcurrency);
+	const HttpConcurrencyControl::EChange change(control.onCompletion(now, rtt, bytes, congested));
+	if (HttpConcurrencyControl::CHANGE_NONE == change)
+	{
+		return;
+	}
+
+	HTTPStats::EConcurrencyChange stats_change(HTTPStats::CONCURRENCY_INCREASE);
+	if (HttpConcurrencyControl::CHANGE_DECREASE == change)
+	{
+		stats_change = HTTPStats::CONCURRENCY_DECREASE;
+	}
+	else if (HttpConcurrencyControl::CHANGE_BACKOFF == change)
+	{
+		stats_change = HTTPStats::CONCURRENCY_BACKOFF;
+	}
+	HTTPStats::instance().recordConcurrency(op->mReqPolicy,
+											control.getLimit(),
+											control.getCeiling(),
+											stats_change);
+	LL_DEBUGS(LOG_CORE) << "HTTP policy class " << op->mReqPolicy
+						<< " concurrency " << control.getLimit()
+						<< " of " << control.getCeiling()
+						<< (HttpConcurrencyControl::CHANGE_BACKOFF == change ? " after congestion"
+							: HttpConcurrencyControl::CHANGE_DECREASE == change ? " on latency"
+							: "")
+						<< ".  RTT:  " << (control.getWindowRTT() / HttpTime(1000))
+						<< " mS, base " << (control.getBaseRTT() / HttpTime(1000))
+						<< " mS, throughput " << control.getThroughput() << " B/s"
+						<< LL_ENDL;
+}
+
+
+void HttpPolicy::releaseCoalesced(const HttpOpRequest::ptr_t &op)
+{
+	if (op->mCoalescedOps.empty())
+	{
+		return;
+	}
+
+	std::vector<HttpOpRequest::ptr_t> parts;
+	parts.swap(op->mCoalescedOps);
+	op->mReqOffset = op->mCoalescedOffset;
+	op->mReqLength = op->mCoalescedLength;
+	for (const HttpOpRequest::ptr_t & part : parts)
+	{
+		part->mCoalescedInto.reset();
+		addOp(part);
+	}
+}
+
+
+void HttpPolicy::coalesceReady(ClassState & state, const HttpOpRequest::ptr_t &op)
+{
+	if (! op->mCoalescedOps.empty() || ! op->canCoalesceWith(*op))
+	{
+		return;
+	}
+
+	const off_t limit(state.mOptions.mCoalesceLimit);
+	off_t first(op->mReqOffset);
+	off_t end(op->mReqOffset + off_t(op->mReqLength));
+	size_t requested(op->mReqLength);
+
+	HttpReadyQueue::container_type & c(state.mReadyQueue.get_container());
+	for (auto iter(c.begin()); c.end() != iter;)
+	{
+		const HttpOpRequest::ptr_t other(*iter);
+		const off_t other_first(other->mReqOffset);
+		const off_t other_end(other->mReqOffset + off_t(other->mReqLength));
+		if (other_first <= end && other_end >= first							// touching or overlapping
+			&& (std::max)(end, other_end) - (std::min)(first, other_first) <= limit
+			&& other->mCoalescedOps.empty()
+			&& op->canCoalesceWith(*other))
+		{
+			first = (std::min)(first, other_first);
+			end = (std::max)(end, other_end);
+			requested += other->mReqLength;
+			other->mCoalescedInto = op;
+			op->mCoalescedOps.push_back(other);
+			c.erase(iter);
+
+			// All iterators are now invalidated and the wider
+			// range may reach requests we've already passed.
+			iter = c.begin();
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	if (op->mCoalescedOps.empty())
+	{
+		return;
+	}
+
+	op->mCoalescedOffset = op->mReqOffset;
+	op->mCoalescedLength = op->mReqLength;
+	op->mReqOffset = first;
+	op->mReqLength = size_t(end - first);
+	HTTPStats::instance().recordCoalesced(op->mCoalescedOps.size(), requested - op->mReqLength);
+
+	if (op->mTracing > HTTP_TRACE_OFF)
+	{
+		LL_INFOS(LOG_CORE) << "TRACE, Coalesced, Handle:  "
+						   << op->getHandle()
+						   << ", Requests:  " << (op->mCoalescedOps.size() + 1)
+						   << ", Range:  " << first << "-" << (end - 1)
+						   << LL_ENDL;
+	}
+}
+
+
+bool HttpPolicy::splitCoalesced(const HttpOpRequest::ptr_t &op)
+{
+	static const HttpStatus partial_content(206);
+
+	// Same check as stageFromActive() but before the body is cut up
+	if (op->mReplyLength
+		&& op->mReplyBody
+		&& op->mReplyBody->size()
+		&& op->mReplyLength != op->mReplyBody->size())
+	{
+		op->mStatus = HttpStatus(HttpStatus::LLCORE, HE_INV_CONTENT_RANGE_HDR);
+	}
+
+	// Where a partial body sits in the resource.  A 206 without a
+	// Content-Range header is taken to start where we asked it to.
+	off_t body_offset(-1);
+	if (op->mStatus && op->mReplyBody)
+	{
+		if (op->mReplyLength)
+		{
+			body_offset = op->mReplyOffset;
+		}
+		else if (partial_content == op->mStatus)
+		{
+			body_offset = op->mReqOffset;
+		}
+	}
+
+	std::vector<HttpOpRequest::ptr_t> parts;
+	parts.swap(op->mCoalescedOps);
+	op->mReqOffset = op->mCoalescedOffset;
+	op->mReqLength = op->mCoalescedLength;
+	for (const HttpOpRequest::ptr_t & part : parts)
+	{
+		part->mCoalescedInto.reset();
+		if (part->takeCoalescedReply(*op, body_offset))
+		{
+			part->stageFromActive(mService);
+			HTTPStats::instance().recordResultCode(part->mStatus.getType());
+		}
+		else
+		{
+			addOp(part);
+		}
+	}
+
+	// Ourselves last, the others read from our body
+	return op->takeCoalescedReply(*op, body_offset);
+}
+
 	
 HttpPolicyClass & HttpPolicy::getClassOptions(HttpRequest::policy_t pclass)
 {
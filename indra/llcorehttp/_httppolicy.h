@@ -131,6 +131,13 @@ public:
 	///
 	/// Threading:  called by worker thread
     bool stageAfterCompletion(const opReqPtr_t &op);
+
+	/// Returns requests coalesced into a request that is going
+	/// away without a reply (canceled) to the ready queue so they
+	/// are issued on their own.
+	///
+	/// Threading:  called by worker thread
+	void releaseCoalesced(const opReqPtr_t &op);
 	
 	/// Get a reference to global policy options.  Caller is expected
 	/// to do context checks like no setting once running.  These
@@ -169,6 +176,18 @@ public:
 protected:
 	struct ClassState;
 	typedef std::vector<ClassState *>	class_list_t;
+
+	// Feeds a finished transfer to its class's concurrency
+	// control and records any change it makes.
+	void adaptConcurrency(const opReqPtr_t &op);
+
+	// Moves ready requests that can share op's transfer into it,
+	// widening its range to cover them.
+	void coalesceReady(ClassState & state, const opReqPtr_t &op);
+
+	// Hands each request coalesced into op its part of the reply.
+	// Returns false if the reply doesn't cover op's own range.
+	bool splitCoalesced(const opReqPtr_t &op);
 	
 	HttpPolicyGlobal					mGlobalOptions;
 	class_list_t						mClasses;
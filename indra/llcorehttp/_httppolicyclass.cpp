@@ -37,7 +37,9 @@ HttpPolicyClass::HttpPolicyClass()
 	: mConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
 	  mPerHostConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
 	  mPipelining(HTTP_PIPELINING_DEFAULT),
-	  mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT)
+	  mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT),
+	  mCoalesceLimit(HTTP_COALESCE_LIMIT_DEFAULT),
+	  mAdaptiveConcurrency(HTTP_ADAPTIVE_CONCURRENCY_DEFAULT)
 {}
 
 
@@ -53,6 +55,8 @@ HttpPolicyClass & HttpPolicyClass::operator=(const HttpPolicyClass & other)
 		mPerHostConnectionLimit = other.mPerHostConnectionLimit;
 		mPipelining = other.mPipelining;
 		mThrottleRate = other.mThrottleRate;
+		mCoalesceLimit = other.mCoalesceLimit;
+		mAdaptiveConcurrency = other.mAdaptiveConcurrency;
 	}
 	return *this;
 }
@@ -62,7 +66,9 @@ HttpPolicyClass::HttpPolicyClass(const HttpPolicyClass & other)
 	: mConnectionLimit(other.mConnectionLimit),
 	  mPerHostConnectionLimit(other.mPerHostConnectionLimit),
 	  mPipelining(other.mPipelining),
-	  mThrottleRate(other.mThrottleRate)
+	  mThrottleRate(other.mThrottleRate),
+	  mCoalesceLimit(other.mCoalesceLimit),
+	  mAdaptiveConcurrency(other.mAdaptiveConcurrency)
 {}
 
 
@@ -86,6 +92,14 @@ HttpStatus HttpPolicyClass::set(HttpRequest::EPolicyOption opt, long value)
 		mThrottleRate = llclamp(value, 0L, 1000000L);
 		break;
 
+	case HttpRequest::PO_COALESCE_LIMIT:
+		mCoalesceLimit = llclamp(value, 0L, HTTP_COALESCE_LIMIT_MAX);
+		break;
+
+	case HttpRequest::PO_ADAPTIVE_CONCURRENCY:
+		mAdaptiveConcurrency = value ? 1L : 0L;
+		break;
+
 	default:
 		return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
 	}
@@ -114,6 +128,14 @@ HttpStatus HttpPolicyClass::get(HttpRequest::EPolicyOption opt, long * value) co
 		*value = mThrottleRate;
 		break;
 
+	case HttpRequest::PO_COALESCE_LIMIT:
+		*value = mCoalesceLimit;
+		break;
+
+	case HttpRequest::PO_ADAPTIVE_CONCURRENCY:
+		*value = mAdaptiveConcurrency;
+		break;
+
 	default:
 		return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
 	}
@@ -64,6 +64,8 @@ public:
 	long						mPerHostConnectionLimit;
 	long						mPipelining;
 	long						mThrottleRate;
+	long						mCoalesceLimit;
+	long						mAdaptiveConcurrency;
 };  // end class HttpPolicyClass
 
 }  // end namespace LLCore
@@ -231,6 +231,28 @@ public:
 		/// Global only
 		PO_SSL_VERIFY_CALLBACK,
 
+		/// Long value that if positive lets GET byte range requests
+		/// waiting in the class share a transfer.  Requests for the
+		/// same URL, with the same headers and options objects, whose
+		/// ranges touch or overlap are merged into one request of at
+		/// most this many bytes and the reply body is split back out
+		/// to each of them.  A value of zero, the default, disables
+		/// coalescing.
+		///
+		/// Per-class only
+		PO_COALESCE_LIMIT,
+
+		/// Long value that if non-zero lets the class adapt the
+		/// number of requests it has active to the service's
+		/// response.  Connection and pipelining options become a
+		/// ceiling, the class backs off from it on 503 and other
+		/// congestion and when latency grows, and works back up
+		/// while it has requests waiting.  A value of zero, the
+		/// default, issues requests up to the ceiling always.
+		///
+		/// Per-class only
+		PO_ADAPTIVE_CONCURRENCY,
+
 		PO_LAST  // Always at end
 	};
 
@@ -45,6 +45,9 @@ void HTTPStats::resetStats()
     mDataDown.reset();
     mDataUp.reset();
     mRequests = 0;
+    mCoalescedRequests = 0;
+    mCoalescedBytesSaved = 0;
+    mConcurrency.clear();
 }
 
 
@@ -61,6 +64,48 @@ void HTTPStats::recordResultCode(S32 code)
 
 }
 
+HTTPStats::ConcurrencyStats::ConcurrencyStats()
+    : mLimit(0),
+      mLowestLimit(0),
+      mCeiling(0),
+      mIncreases(0),
+      mDecreases(0),
+      mBackoffs(0)
+{
+}
+
+
+void HTTPStats::recordConcurrency(S32 policy_class, S32 limit, S32 ceiling, EConcurrencyChange change)
+{
+    ConcurrencyStats & stats(mConcurrency[policy_class]);
+
+    stats.mLimit = limit;
+    stats.mLowestLimit = stats.mLowestLimit ? llmin(stats.mLowestLimit, limit) : limit;
+    stats.mCeiling = ceiling;
+    switch (change)
+    {
+    case CONCURRENCY_INCREASE:
+        ++stats.mIncreases;
+        break;
+
+    case CONCURRENCY_DECREASE:
+        ++stats.mDecreases;
+        break;
+
+    case CONCURRENCY_BACKOFF:
+        ++stats.mBackoffs;
+        break;
+    }
+}
+
+
+HTTPStats::ConcurrencyStats HTTPStats::getConcurrencyStats(S32 policy_class) const
+{
+    std::map<S32, ConcurrencyStats>::const_iterator it(mConcurrency.find(policy_class));
+
+    return (it == mConcurrency.end()) ? ConcurrencyStats() : (*it).second;
+}
+
 namespace
 {
     std::string byte_count_converter(F32 bytes)
@@ -93,6 +138,7 @@ void HTTPStats::dumpStats()
     out << "Data Sent: " << byte_count_converter(mDataUp.getSum()) << "   (" << mDataUp.getSum() << ")" << std::endl;
     out << "Data Recv: " << byte_count_converter(mDataDown.getSum()) << "   (" << mDataDown.getSum() << ")" << std::endl;
     out << "Total requests: " << mRequests << "(request objects created)" << std::endl;
+    out << "Coalesced requests: " << mCoalescedRequests << "   (" << byte_count_converter(F32(mCoalescedBytesSaved)) << " overlap saved)" << std::endl;
     out << std::endl;
     out << "Result Codes:" << std::endl << "--- -----" << std::endl;
 
@@ -101,6 +147,20 @@ void HTTPStats::dumpStats()
         out << code.first << " " << code.second << std::endl;
     }
 
+    if (! mConcurrency.empty())
+    {
+        out << std::endl;
+        out << "Adaptive Concurrency:" << std::endl << "Class Limit Lowest Ceiling Up Down Backoff" << std::endl;
+
+        for (auto& entry : mConcurrency)
+        {
+            const ConcurrencyStats & stats(entry.second);
+
+            out << entry.first << " " << stats.mLimit << " " << stats.mLowestLimit << " " << stats.mCeiling
+                << " " << stats.mIncreases << " " << stats.mDecreases << " " << stats.mBackoffs << std::endl;
+        }
+    }
+
     LL_WARNS("HTTPCore") << out.str() << LL_ENDL;
 }
 
@@ -57,6 +57,42 @@ namespace LLCore
 
         void    recordHTTPRequest() { ++mRequests; }
 
+        // Requests that rode on another's transfer and the bytes their
+        // ranges had in common with it
+        void    recordCoalesced(size_t requests, size_t bytes_saved)
+        {
+            mCoalescedRequests += requests;
+            mCoalescedBytesSaved += bytes_saved;
+        }
+
+        U64     getCoalescedRequests() const { return mCoalescedRequests; }
+        U64     getCoalescedBytesSaved() const { return mCoalescedBytesSaved; }
+
+        // Decisions of a policy class's adaptive concurrency control
+        enum EConcurrencyChange
+        {
+            CONCURRENCY_INCREASE,
+            CONCURRENCY_DECREASE,       // latency rising
+            CONCURRENCY_BACKOFF         // congestion reported
+        };
+
+        struct ConcurrencyStats
+        {
+            ConcurrencyStats();
+
+            S32     mLimit;
+            S32     mLowestLimit;
+            S32     mCeiling;
+            U32     mIncreases;
+            U32     mDecreases;
+            U32     mBackoffs;
+        };
+
+        void    recordConcurrency(S32 policy_class, S32 limit, S32 ceiling, EConcurrencyChange change);
+
+        // All zero for a class that never changed
+        ConcurrencyStats getConcurrencyStats(S32 policy_class) const;
+
         void    recordResultCode(S32 code);
 
         void    dumpStats();
@@ -65,8 +101,11 @@ namespace LLCore
         StatsAccumulator mDataUp;
 
         S32              mRequests;
+        U64              mCoalescedRequests;
+        U64              mCoalescedBytesSaved;
 
         std::map<S32, S32> mResultCodes;
+        std::map<S32, ConcurrencyStats> mConcurrency;
     };
 
 
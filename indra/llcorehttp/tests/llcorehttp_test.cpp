@@ -44,6 +44,7 @@
 #include "test_httprequest.hpp"
 #include "test_httpheaders.hpp"
 #include "test_httprequestqueue.hpp"
+#include "test_httpconcurrency.hpp"
 
 #include "llsd.h"
 #include "lldate.h"
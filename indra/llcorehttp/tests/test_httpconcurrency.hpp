@@ -0,0 +1,250 @@
+/** 
+ * @file test_httpconcurrency.hpp
+ * @brief unit tests for the LLCore::HttpConcurrencyControl class
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#ifndef TEST_LLCORE_HTTP_CONCURRENCY_H_
+#define TEST_LLCORE_HTTP_CONCURRENCY_H_
+
+#include "_httpconcurrency.h"
+
+#include <iostream>
+
+
+using namespace LLCore;
+
+
+
+namespace tut
+{
+
+struct HttpConcurrencyTestData
+{
+	// the test objects inherit from this so the member functions and variables
+	// can be referenced directly inside of the test functions.
+	HttpConcurrencyTestData()
+		: mNow(0)
+		{}
+
+	// Completes count transfers a millisecond apart, returns
+	// the last change made.
+	HttpConcurrencyControl::EChange feed(HttpConcurrencyControl & control,
+										 int count,
+										 HttpTime rtt,
+										 size_t bytes,
+										 bool congested)
+		{
+			HttpConcurrencyControl::EChange change(HttpConcurrencyControl::CHANGE_NONE);
+			for (int i(0); i < count; ++i)
+			{
+				mNow += 1000;
+				change = control.onCompletion(mNow, rtt, bytes, congested);
+			}
+			return change;
+		}
+
+	HttpTime mNow;
+};
+
+typedef test_group<HttpConcurrencyTestData> HttpConcurrencyTestGroupType;
+typedef HttpConcurrencyTestGroupType::object HttpConcurrencyTestObjectType;
+HttpConcurrencyTestGroupType HttpConcurrencyTestGroup("HttpConcurrency Tests");
+
+template <> template <>
+void HttpConcurrencyTestObjectType::test<1>()
+{
+	set_test_name("HttpConcurrencyControl ceiling");
+
+	HttpConcurrencyControl control;
+	ensure_equals("Off on construction", control.getLimit(), 0);
+	ensure_equals("Off ignores completions",
+				  feed(control, 20, 1000, 1000, true),
+				  HttpConcurrencyControl::CHANGE_NONE);
+
+	control.setCeiling(8);
+	ensure_equals("Starts at ceiling", control.getLimit(), 8);
+
+	control.setCeiling(16);
+	ensure_equals("Raised ceiling leaves limit alone", control.getLimit(), 8);
+
+	control.setCeiling(4);
+	ensure_equals("Lowered ceiling clamps limit", control.getLimit(), 4);
+
+	control.setCeiling(0);
+	control.setCeiling(12);
+	ensure_equals("Restarts at ceiling after off", control.getLimit(), 12);
+}
+
+template <> template <>
+void HttpConcurrencyTestObjectType::test<2>()
+{
+	set_test_name("HttpConcurrencyControl backs off on congestion");
+
+	HttpConcurrencyControl control;
+	control.setCeiling(8);
+
+	ensure_equals("Congestion backs off",
+				  feed(control, 1, 1000, 0, true),
+				  HttpConcurrencyControl::CHANGE_BACKOFF);
+	ensure_equals("Limit halved", control.getLimit(), 4);
+
+	// The other seven were active before the backoff
+	ensure_equals("Congestion from earlier requests ignored",
+				  feed(control, 7, 1000, 0, true),
+				  HttpConcurrencyControl::CHANGE_NONE);
+	ensure_equals("Limit unchanged", control.getLimit(), 4);
+
+	ensure_equals("New congestion backs off",
+				  feed(control, 2, 1000, 0, true),
+				  HttpConcurrencyControl::CHANGE_BACKOFF);
+	ensure_equals("Limit halved again", control.getLimit(), 2);
+
+	feed(control, 4, 1000, 0, true);
+	feed(control, 1, 1000, 0, true);
+	ensure_equals("Limit halved to floor", control.getLimit(), 1);
+	feed(control, 2, 1000, 0, true);
+	feed(control, 1, 1000, 0, true);
+	ensure_equals("Limit has a floor", control.getLimit(), 1);
+}
+
+template <> template <>
+void HttpConcurrencyTestObjectType::test<3>()
+{
+	set_test_name("HttpConcurrencyControl follows latency");
+
+	HttpConcurrencyControl control;
+	control.setCeiling(8);
+
+	// One window (limit's worth of completions) sets the baseline
+	ensure_equals("Steady latency, no change",
+				  feed(control, 8, 10000, 1000, false),
+				  HttpConcurrencyControl::CHANGE_NONE);
+	ensure_equals("Baseline latency", control.getBaseRTT(), HttpTime(10000));
+
+	ensure_equals("Nothing until window completes",
+				  feed(control, 7, 30000, 1000, false),
+				  HttpConcurrencyControl::CHANGE_NONE);
+	ensure_equals("Rising latency decreases",
+				  feed(control, 1, 30000, 1000, false),
+				  HttpConcurrencyControl::CHANGE_DECREASE);
+	ensure_equals("Limit down by one", control.getLimit(), 7);
+	ensure_equals("Window latency", control.getWindowRTT(), HttpTime(30000));
+	ensure("Baseline drifts up slowly",
+		   control.getBaseRTT() > HttpTime(10000) && control.getBaseRTT() < HttpTime(12000));
+
+	// Saturated but latency is still high, keep coming down
+	control.noteSaturated();
+	ensure_equals("High latency beats saturation",
+				  feed(control, 7, 30000, 1000, false),
+				  HttpConcurrencyControl::CHANGE_DECREASE);
+	ensure_equals("Limit down by one more", control.getLimit(), 6);
+}
+
+template <> template <>
+void HttpConcurrencyTestObjectType::test<4>()
+{
+	set_test_name("HttpConcurrencyControl increases when saturated");
+
+	HttpConcurrencyControl control;
+	control.setCeiling(4);
+	feed(control, 1, 1000, 0, true);
+	ensure_equals("Backed off", control.getLimit(), 2);
+	feed(control, 4, 1000, 1000, false);				// Drain the old requests
+	ensure_equals("Unsaturated, no increase", control.getLimit(), 2);
+
+	control.noteSaturated();
+	ensure_equals("Saturated, increase",
+				  feed(control, 4, 1000, 1000, false),
+				  HttpConcurrencyControl::CHANGE_INCREASE);
+	ensure_equals("Limit up by one", control.getLimit(), 3);
+
+	control.noteSaturated();
+	feed(control, 4, 1000, 1000, false);
+	ensure_equals("Limit up to ceiling", control.getLimit(), 4);
+
+	control.noteSaturated();
+	ensure_equals("Not past ceiling",
+				  feed(control, 4, 1000, 1000, false),
+				  HttpConcurrencyControl::CHANGE_NONE);
+	ensure_equals("Limit at ceiling", control.getLimit(), 4);
+}
+
+template <> template <>
+void HttpConcurrencyTestObjectType::test<5>()
+{
+	set_test_name("HttpConcurrencyControl holds when throughput falls");
+
+	HttpConcurrencyControl control;
+	control.setCeiling(8);
+	feed(control, 1, 1000, 0, true);
+	feed(control, 8, 1000, 1000, false);
+	ensure_equals("Backed off", control.getLimit(), 4);
+
+	control.noteSaturated();
+	feed(control, 4, 1000, 1000, false);
+	ensure_equals("Saturated, increase", control.getLimit(), 5);
+	ensure_equals("Throughput measured", control.getThroughput(), U64(1000000));
+
+	control.noteSaturated();
+	ensure_equals("Falling throughput, no increase",
+				  feed(control, 5, 1000, 100, false),
+				  HttpConcurrencyControl::CHANGE_NONE);
+	ensure_equals("Limit unchanged", control.getLimit(), 5);
+}
+
+template <> template <>
+void HttpConcurrencyTestObjectType::test<6>()
+{
+	set_test_name("HttpConcurrencyControl judges latency by response size");
+
+	HttpConcurrencyControl control;
+	control.setCeiling(8);
+
+	// Small header fetches set a low baseline
+	feed(control, 8, 10000, 4 * 1024, false);
+	ensure_equals("Small baseline", control.getBaseRTT(), HttpTime(10000));
+
+	// Large fetches taking longer are not congestion
+	ensure_equals("Large window, no change",
+				  feed(control, 8, 200000, 400 * 1024, false),
+				  HttpConcurrencyControl::CHANGE_NONE);
+	ensure_equals("Large baseline", control.getBaseRTT(), HttpTime(200000));
+
+	for (int i(0); i < 10; ++i)
+	{
+		feed(control, 1 + i % 4, 10000, 4 * 1024, false);
+		feed(control, 7 - i % 4, 200000, 400 * 1024, false);
+	}
+	ensure_equals("Mixed sizes leave limit alone", control.getLimit(), 8);
+
+	// Large fetches slowing down still count
+	feed(control, 4, 10000, 4 * 1024, false);
+	ensure_equals("Slower large fetches decrease",
+				  feed(control, 4, 600000, 400 * 1024, false),
+				  HttpConcurrencyControl::CHANGE_DECREASE);
+	ensure_equals("Limit down by one", control.getLimit(), 7);
+}
+
+}  // end namespace tut
+
+#endif  // TEST_LLCORE_HTTP_CONCURRENCY_H_
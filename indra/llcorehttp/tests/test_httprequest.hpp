@@ -32,8 +32,10 @@
 #include "httpheaders.h"
 #include "httpresponse.h"
 #include "httpoptions.h"
+#include "httpstats.h"
 #include "_httpservice.h"
 #include "_httprequestqueue.h"
+#include "_httpinternal.h"
 
 #include <curl/curl.h>
 #include <boost/regex.hpp>
@@ -183,6 +185,45 @@ public:
 	regex_container_t mHeadersDisallowed;
 };
 
+// Checks a 206 reply from the '/ranged/' path of the test server,
+// a 4096 byte resource with byte i being 'a' + i % 26.
+class RangeHandler : public LLCore::HttpHandler
+{
+public:
+	RangeHandler(HttpRequestTestData * state, unsigned int offset, unsigned int length)
+		: mState(state),
+		  mOffset(offset),
+		  mLength(length)
+		{}
+
+	virtual void onCompleted(HttpHandle handle, HttpResponse * response)
+		{
+			ensure("Handler got a response", NULL != response);
+			ensure("Partial content received", HttpStatus(206) == response->getStatus());
+
+			unsigned int offset(0), length(0), full_length(0);
+			response->getRange(&offset, &length, &full_length);
+			ensure_equals("Reply starts at requested offset", offset, mOffset);
+			ensure_equals("Reply has requested length", length, mLength);
+			ensure_equals("Reply has full length", full_length, 4096U);
+
+			BufferArray * body(response->getBody());
+			ensure("Reply has a body", NULL != body);
+			ensure_equals("Body has requested length", body->size(), size_t(mLength));
+			std::vector<char> data(mLength);
+			body->read(0, &data[0], mLength);
+			for (unsigned int i(0); i < mLength; ++i)
+			{
+				ensure("Body matches resource", data[i] == char('a' + (mOffset + i) % 26));
+			}
+			mState->mHandlerCalls++;
+		}
+
+	HttpRequestTestData * mState;
+	unsigned int mOffset;
+	unsigned int mLength;
+};
+
 typedef test_group<HttpRequestTestData> HttpRequestTestGroupType;
 typedef HttpRequestTestGroupType::object HttpRequestTestObjectType;
 HttpRequestTestGroupType HttpRequestTestGroup("HttpRequest Tests");
@@ -3233,6 +3274,243 @@ void HttpRequestTestObjectType::test<23>()
 	}
 }
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+	ScopedCurlInit ready;
+
+	set_test_name("HttpRequest GET byte ranges coalesced");
+
+	// Four ranges of one resource.  The first three touch or overlap
+	// and should share one transfer, the last one stands alone.
+	static const unsigned int ranges[][2] = { { 0, 100 }, { 100, 100 }, { 150, 100 }, { 1000, 10 } };
+	static const int range_count(sizeof(ranges) / sizeof(ranges[0]));
+
+	// Handlers can be stack-allocated *if* there are no dangling
+	// references to them after completion of this method.
+	TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+	std::vector<LLCore::HttpHandler::ptr_t> range_handlers;
+	for (int i(0); i < range_count; ++i)
+	{
+		range_handlers.push_back(std::make_shared<RangeHandler>(this, ranges[i][0], ranges[i][1]));
+	}
+    std::string url(get_base_url() + "/ranged/");
+
+	mHandlerCalls = 0;
+
+	HttpRequest * req = NULL;
+
+	try
+	{
+        // Get singletons created
+		HttpRequest::createService();
+
+		HttpStatus status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_COALESCE_LIMIT,
+															   HttpRequest::DEFAULT_POLICY_ID,
+															   65536,
+															   NULL);
+		ensure("Coalesce limit accepted", bool(status));
+		HTTPStats::instance().resetStats();
+
+		// Queue everything before the worker starts so that all
+		// of it reaches the ready queue together.
+		req = new HttpRequest();
+		for (int i(0); i < range_count; ++i)
+		{
+			HttpHandle handle = req->requestGetByteRange(HttpRequest::DEFAULT_POLICY_ID,
+														 0U,
+														 url,
+														 ranges[i][0],
+														 ranges[i][1],
+														 HttpOptions::ptr_t(),
+														 HttpHeaders::ptr_t(),
+														 range_handlers[i]);
+			ensure("Valid handle returned for ranged request", handle != LLCORE_HTTP_HANDLE_INVALID);
+		}
+
+		HttpRequest::startThread();
+
+		// Run the notification pump.
+		int count(0);
+		int limit(LOOP_COUNT_LONG);
+		while (count++ < limit && mHandlerCalls < range_count)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Requests executed in reasonable time", count < limit);
+		ensure("One handler invocation for each request", mHandlerCalls == range_count);
+		ensure_equals("Two requests rode on another's transfer", HTTPStats::instance().getCoalescedRequests(), U64(2));
+		ensure_equals("Overlapping bytes fetched once", HTTPStats::instance().getCoalescedBytesSaved(), U64(50));
+
+		// Okay, request a shutdown of the servicing thread
+		mStatus = HttpStatus();
+		mHandlerCalls = 0;
+		HttpHandle handle = req->requestStopThread(handlerp);
+		ensure("Valid handle returned for stop request", handle != LLCORE_HTTP_HANDLE_INVALID);
+	
+		// Run the notification pump again
+		count = 0;
+		limit = LOOP_COUNT_LONG;
+		while (count++ < limit && mHandlerCalls < 1)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Stop request executed in reasonable time", count < limit);
+		ensure("Stop handler invocation", mHandlerCalls == 1);
+
+		// See that we actually shutdown the thread
+		count = 0;
+		limit = LOOP_COUNT_SHORT;
+		while (count++ < limit && ! HttpService::isStopped())
+		{
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Thread actually stopped running", HttpService::isStopped());
+
+		// release the request object
+		delete req;
+		req = NULL;
+
+		// Shut down service
+		HttpRequest::destroyService();
+	}
+	catch (...)
+	{
+		stop_thread(req);
+		delete req;
+		HttpRequest::destroyService();
+		throw;
+	}
+}
+
+template <> template <>
+void HttpRequestTestObjectType::test<25>()
+{
+	ScopedCurlInit ready;
+
+	set_test_name("HttpRequest adaptive concurrency against throttling server");
+
+	// The '/throttle/' server path answers a few requests in any
+	// short window and refuses the rest with 503s.  The default
+	// class's connection limit lets more than that through at
+	// once, adaptive control should come down from it and every
+	// request should get through on retries.
+	static const int request_count(32);
+
+	// Handlers can be stack-allocated *if* there are no dangling
+	// references to them after completion of this method.
+	TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+    std::string url(get_base_url() + "/throttle/");
+
+	mHandlerCalls = 0;
+
+	HttpRequest * req = NULL;
+	HttpOptions::ptr_t opts;
+
+	try
+	{
+        // Get singletons created
+		HttpRequest::createService();
+
+		HttpStatus status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_ADAPTIVE_CONCURRENCY,
+															   HttpRequest::DEFAULT_POLICY_ID,
+															   1,
+															   NULL);
+		ensure("Adaptive concurrency accepted", bool(status));
+		HTTPStats::instance().resetStats();
+
+		// Start threading early so that thread memory is invariant
+		// over the test.
+		HttpRequest::startThread();
+
+		// Get singletons created
+		req = new HttpRequest();
+
+		// Quick retries, don't give up
+		opts = HttpOptions::ptr_t(new HttpOptions());
+		opts->setRetries(HTTP_RETRY_COUNT_MAX);
+		opts->setMinBackoff(10000);
+		opts->setMaxBackoff(50000);
+
+		// Issue a burst of GETs
+		mStatus = HttpStatus(200);
+		for (int i(0); i < request_count; ++i)
+		{
+			HttpHandle handle = req->requestGet(HttpRequest::DEFAULT_POLICY_ID,
+												0U,
+												url,
+												opts,
+												HttpHeaders::ptr_t(),
+												handlerp);
+			ensure("Valid handle returned for get request", handle != LLCORE_HTTP_HANDLE_INVALID);
+		}
+
+		// Run the notification pump.
+		int count(0);
+		int limit(LOOP_COUNT_LONG);
+		while (count++ < limit && mHandlerCalls < request_count)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Requests executed in reasonable time", count < limit);
+		ensure("One handler invocation for each request", mHandlerCalls == request_count);
+
+		const HTTPStats::ConcurrencyStats stats(HTTPStats::instance().getConcurrencyStats(HttpRequest::DEFAULT_POLICY_ID));
+		ensure("Backed off on congestion", stats.mBackoffs > 0);
+		ensure_equals("Ceiling is the connection limit", stats.mCeiling, HTTP_CONNECTION_LIMIT_DEFAULT);
+		ensure("Came down from the ceiling", stats.mLowestLimit > 0 && stats.mLowestLimit < stats.mCeiling);
+
+		// Okay, request a shutdown of the servicing thread
+		mStatus = HttpStatus();
+		mHandlerCalls = 0;
+		HttpHandle handle = req->requestStopThread(handlerp);
+		ensure("Valid handle returned for stop request", handle != LLCORE_HTTP_HANDLE_INVALID);
+	
+		// Run the notification pump again
+		count = 0;
+		limit = LOOP_COUNT_LONG;
+		while (count++ < limit && mHandlerCalls < 1)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Stop request executed in reasonable time", count < limit);
+		ensure("Stop handler invocation", mHandlerCalls == 1);
+
+		// See that we actually shutdown the thread
+		count = 0;
+		limit = LOOP_COUNT_SHORT;
+		while (count++ < limit && ! HttpService::isStopped())
+		{
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Thread actually stopped running", HttpService::isStopped());
+
+		// release options
+		opts.reset();
+		
+		// release the request object
+		delete req;
+		req = NULL;
+
+		// Shut down service
+		HttpRequest::destroyService();
+	}
+	catch (...)
+	{
+		stop_thread(req);
+		opts.reset();
+		delete req;
+		HttpRequest::destroyService();
+		throw;
+	}
+}
+
 
 }  // end namespace tut
 
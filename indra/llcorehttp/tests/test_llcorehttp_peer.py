@@ -30,6 +30,7 @@ $/LicenseInfo$
 """
 
 import os
+import re
 import sys
 import time
 import select
@@ -79,12 +80,23 @@ class TestHTTPRequestHandler(BaseHTTPRequestHandler):
     -- '/503/4/'            "Retry-After: (*#*(@*(@(")"
     -- '/503/5/'            "Retry-After: aklsjflajfaklsfaklfasfklasdfklasdgahsdhgasdiogaioshdgo"
     -- '/503/6/'            "Retry-After: 1 2 3 4 5 6 7 8 9 10"
+    - '/ranged/'        4096 byte resource, byte i being chr(ord('a') + i % 26).
+                        A "Range: bytes=first-last" header gets a 206
+                        with that part of it, no header the whole thing.
+    - '/throttle/'      Stand-in for a throttling service.  Answers
+                        at most THROTTLE_COUNT requests in any
+                        THROTTLE_WINDOW seconds, 503 (no 'Retry-After')
+                        to the rest.
 
     Some combinations make no sense, there's no effort to protect
     you from that.
     """
     ignore_exceptions = (Exception,)
 
+    THROTTLE_COUNT = 4
+    THROTTLE_WINDOW = 0.1
+    throttle_arrivals = []
+
     def read(self):
         # The following logic is adapted from the library module
         # SimpleXMLRPCServer.py.
@@ -222,6 +234,44 @@ class TestHTTPRequestHandler(BaseHTTPRequestHandler):
             self.end_headers()
             if body:
                 self.wfile.write(body)
+        elif "/throttle/" in self.path:
+            now = time.time()
+            arrivals = [t for t in TestHTTPRequestHandler.throttle_arrivals
+                        if now - t < self.THROTTLE_WINDOW]
+            if len(arrivals) < self.THROTTLE_COUNT:
+                arrivals.append(now)
+                body = "Not throttled"
+                self.send_response(200)
+            else:
+                body = "Throttled"
+                self.send_response(503)
+            TestHTTPRequestHandler.throttle_arrivals = arrivals
+            if "/reflect/" in self.path:
+                self.reflect_headers()
+            self.send_header("Content-type", "text/plain")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            if withdata:
+                self.wfile.write(body)
+        elif "/ranged/" in self.path:
+            resource = ''.join(chr(ord('a') + i % 26) for i in xrange(4096))
+            match = re.match(r"bytes=(\d+)-(\d*)$", self.headers.getheader("Range", ""))
+            if match:
+                first = int(match.group(1))
+                last = min(int(match.group(2) or len(resource) - 1), len(resource) - 1)
+                body = resource[first:last + 1]
+                self.send_response(206)
+                self.send_header("Content-Range", "bytes %d-%d/%d" % (first, last, len(resource)))
+            else:
+                body = resource
+                self.send_response(200)
+            if "/reflect/" in self.path:
+                self.reflect_headers()
+            self.send_header("Content-type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            if withdata:
+                self.wfile.write(body)
         elif "fail" not in self.path:
             data = data.copy()          # we're going to modify
             # Ensure there's a "reply" key in data, even if there wasn't before
@@ -28,23 +28,110 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "llimagej2c.h"
+
+#include "lltimer.h"
+#include "lltrace.h"
+#include "lltracethreadrecorder.h"
+
+using namespace std::chrono_literals;
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	// Index of the decode worker running on this thread, 0 for the queued thread itself
+	thread_local U32 sDecodeWorkerIndex = 0;
+
+	// Previews smaller than this on either side are not worth a decode
+	const S32 MIN_PREVIEW_SIZE = 8;
+
+	LLTrace::CountStatHandle<> sWorkerDecodes[LLImageDecodeThread::MAX_DECODE_WORKERS] =
+	{
+		{ "image_decode_worker_0", "Images decoded by decode worker 0" },
+		{ "image_decode_worker_1", "Images decoded by decode worker 1" },
+		{ "image_decode_worker_2", "Images decoded by decode worker 2" },
+		{ "image_decode_worker_3", "Images decoded by decode worker 3" },
+		{ "image_decode_worker_4", "Images decoded by decode worker 4" },
+		{ "image_decode_worker_5", "Images decoded by decode worker 5" },
+		{ "image_decode_worker_6", "Images decoded by decode worker 6" },
+		{ "image_decode_worker_7", "Images decoded by decode worker 7" },
+	};
+
+	LLTrace::CountStatHandle<F64Seconds> sWorkerDecodeTime[LLImageDecodeThread::MAX_DECODE_WORKERS] =
+	{
+		{ "image_decode_worker_time_0", "Time spent decoding by decode worker 0" },
+		{ "image_decode_worker_time_1", "Time spent decoding by decode worker 1" },
+		{ "image_decode_worker_time_2", "Time spent decoding by decode worker 2" },
+		{ "image_decode_worker_time_3", "Time spent decoding by decode worker 3" },
+		{ "image_decode_worker_time_4", "Time spent decoding by decode worker 4" },
+		{ "image_decode_worker_time_5", "Time spent decoding by decode worker 5" },
+		{ "image_decode_worker_time_6", "Time spent decoding by decode worker 6" },
+		{ "image_decode_worker_time_7", "Time spent decoding by decode worker 7" },
+	};
+}
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, U32 pool_size)
 	: LLQueuedThread("imagedecode", threaded)
 	, mCreationListSize(0)
 {
 	mCreationMutex = new LLMutex();
+
+	if (threaded)
+	{
+		if (pool_size == 0)
+		{
+			// Leave a core for the main thread and one for the other background threads
+			pool_size = llmax(std::thread::hardware_concurrency(), 3U) - 2;
+		}
+		pool_size = llclamp(pool_size, 1U, MAX_DECODE_WORKERS);
+
+		for (U32 i = 1; i < pool_size; ++i)
+		{
+			mWorkers.emplace_back(std::make_unique<DecodeWorker>(this, i));
+		}
+		for (auto& worker : mWorkers)
+		{
+			worker->start();
+		}
+		LL_INFOS() << "Image decode pool started with " << pool_size << " worker(s)" << LL_ENDL;
+	}
 }
 
 //virtual 
 LLImageDecodeThread::~LLImageDecodeThread()
 {
+	shutdownWorkers();
 	delete mCreationMutex ;
 }
 
+// MAIN THREAD
+// virtual
+void LLImageDecodeThread::shutdown()
+{
+	// Workers pull from our request queue, so they have to stop before it is torn down
+	shutdownWorkers();
+	LLQueuedThread::shutdown();
+}
+
+void LLImageDecodeThread::shutdownWorkers()
+{
+	for (auto& worker : mWorkers)
+	{
+		worker->shutdown();
+	}
+	mWorkers.clear();
+}
+
+// virtual
+void LLImageDecodeThread::startThread()
+{
+	sDecodeWorkerIndex = 0;
+}
+
 // MAIN THREAD
 // virtual
 S32 LLImageDecodeThread::update(F32 max_time_ms)
@@ -56,7 +143,7 @@ S32 LLImageDecodeThread::update(F32 max_time_ms)
 		{
 			ImageRequest* req = new ImageRequest(info.handle, info.image,
 				info.priority, info.discard, info.needs_aux,
-				info.responder);
+				info.responder, info.preview_discard);
 
 			bool res = addRequest(req);
 			if (!res)
@@ -68,15 +155,22 @@ S32 LLImageDecodeThread::update(F32 max_time_ms)
 		mCreationListSize = 0;
 	}
 	S32 res = LLQueuedThread::update(max_time_ms);
+	if (res > 0)
+	{
+		for (auto& worker : mWorkers)
+		{
+			worker->wake();
+		}
+	}
 	return res;
 }
 
 LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(LLImageFormatted* image, 
-	U32 priority, S32 discard, BOOL needs_aux, Responder* responder)
+	U32 priority, S32 discard, BOOL needs_aux, Responder* responder, S32 preview_discard)
 {
 	LLMutexLock lock(mCreationMutex);
 	handle_t handle = generateHandle();
-	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder));
+	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder, preview_discard));
 	mCreationListSize = mCreationList.size();
 	return handle;
 }
@@ -96,12 +190,52 @@ LLImageDecodeThread::Responder::~Responder()
 
 //----------------------------------------------------------------------------
 
+LLImageDecodeThread::DecodeWorker::DecodeWorker(LLImageDecodeThread* owner, U32 index)
+	: LLThread("imagedecode" + std::to_string(index)),
+	  mOwner(owner),
+	  mIndex(index)
+{
+}
+
+// virtual
+bool LLImageDecodeThread::DecodeWorker::runCondition()
+{
+	// mRunCondition must be locked here
+	return !mOwner->isPaused() && mOwner->mRequestQueueSize > 0;
+}
+
+// virtual
+void LLImageDecodeThread::DecodeWorker::run()
+{
+	sDecodeWorkerIndex = mIndex;
+
+	while (true)
+	{
+		// Sleeps until the owner has queued work and is not paused, or we are asked to quit
+		checkPause();
+
+		if (isQuitting())
+		{
+			LLTrace::get_thread_recorder()->pushToParent();
+			break;
+		}
+
+		if (mOwner->processNextRequest() == 0)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
-												LLImageDecodeThread::Responder* responder)
+												LLImageDecodeThread::Responder* responder, S32 preview_discard)
 	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
 	  mFormattedImage(image),
 	  mDiscardLevel(discard),
+	  mPreviewDiscard(preview_discard),
 	  mNeedsAux(needs_aux),
 	  mDecodedRaw(FALSE),
 	  mDecodedAux(FALSE),
@@ -123,6 +257,8 @@ LLImageDecodeThread::ImageRequest::~ImageRequest()
 bool LLImageDecodeThread::ImageRequest::processRequest()
 {
 	const F32 decode_time_slice = .1f;
+	const U32 worker = sDecodeWorkerIndex;
+	LLTimer decode_timer;
 	bool done = true;
 	if (!mDecodedRaw && mFormattedImage.notNull())
 	{
@@ -138,6 +274,10 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 			{
 				return true; // done (failed)
 			}
+			if (mPreviewDiscard > mDiscardLevel && mDiscardLevel >= 0)
+			{
+				decodePreview();
+			}
 			if (mDiscardLevel >= 0)
 			{
 				mFormattedImage->setDiscardLevel(mDiscardLevel);
@@ -163,9 +303,52 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 		mDecodedAux = done && mDecodedImageAux->getData();
 	}
 
+	add(sWorkerDecodeTime[worker], F64Seconds(decode_timer.getElapsedTimeF64()));
+	if (done)
+	{
+		add(sWorkerDecodes[worker], 1);
+	}
+
 	return done;
 }
 
+// Decodes the coarse level from the leading bytes of the stream in one go,
+// a preview that has to wait for the next time slice is no use.
+void LLImageDecodeThread::ImageRequest::decodePreview()
+{
+	if (mFormattedImage->getCodec() != IMG_CODEC_J2C || mResponder.isNull())
+	{
+		return;
+	}
+	LLImageJ2C* j2c = (LLImageJ2C*)mFormattedImage.get();
+	if ((j2c->getWidth() >> mPreviewDiscard) < MIN_PREVIEW_SIZE ||
+		(j2c->getHeight() >> mPreviewDiscard) < MIN_PREVIEW_SIZE ||
+		(j2c->getLevels() > 0 && mPreviewDiscard >= j2c->getLevels()))
+	{
+		return;
+	}
+	const S32 preview_bytes = j2c->calcDataSize(mPreviewDiscard);
+	if (preview_bytes * 2 > j2c->getDataSize())
+	{
+		// Hardly cheaper than the full decode, which follows right away
+		return;
+	}
+
+	// The full decode that follows keeps the caller's byte cap
+	const S32 max_bytes = j2c->getMaxBytes();
+	j2c->setDiscardLevel(mPreviewDiscard);
+	j2c->setMaxBytes(preview_bytes);
+	LLPointer<LLImageRaw> preview = new LLImageRaw(j2c->getWidth(), j2c->getHeight(), j2c->getComponents());
+	bool done = j2c->decode(preview, 0.f);
+	const S32 preview_discard = j2c->getRawDiscardLevel();
+	j2c->setMaxBytes(max_bytes);
+
+	if (done && preview->getData())
+	{
+		mResponder->preview(preview, preview_discard);
+	}
+}
+
 void LLImageDecodeThread::ImageRequest::finishRequest(bool completed)
 {
 	if (mResponder.notNull())
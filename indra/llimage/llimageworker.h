@@ -40,6 +40,9 @@ public:
 		virtual ~Responder();
 	public:
 		virtual void completed(bool success, LLImageRaw* raw, LLImageRaw* aux) = 0;
+		// Called from the decode thread with a coarser decode of the same image,
+		// ahead of completed(), when the request asked for one
+		virtual void preview(LLImageRaw* raw, S32 discard) {}
 	};
 
 	class ImageRequest : public LLQueuedThread::QueuedRequest
@@ -50,7 +53,7 @@ public:
 	public:
 		ImageRequest(handle_t handle, LLImageFormatted* image,
 					 U32 priority, S32 discard, BOOL needs_aux,
-					 LLImageDecodeThread::Responder* responder);
+					 LLImageDecodeThread::Responder* responder, S32 preview_discard = -1);
 
 		/*virtual*/ bool processRequest() override;
 		/*virtual*/ void finishRequest(bool completed) override;
@@ -59,9 +62,12 @@ public:
 		bool tut_isOK();
 		
 	private:
+		void decodePreview();
+
 		// input
 		LLPointer<LLImageFormatted> mFormattedImage;
 		S32 mDiscardLevel;
+		S32 mPreviewDiscard;
 		BOOL mNeedsAux;
 		// output
 		LLPointer<LLImageRaw> mDecodedImageRaw;
@@ -72,18 +78,46 @@ public:
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// Maximum number of decode workers, including the queued thread itself
+	static constexpr U32 MAX_DECODE_WORKERS = 8;
+
+	// pool_size is the total number of threads decoding; 0 picks a size from the hardware concurrency
+	LLImageDecodeThread(bool threaded = true, U32 pool_size = 1);
 	virtual ~LLImageDecodeThread();
+	void shutdown() override;
 
+	// When preview_discard is coarser than discard, a J2C image is first decoded
+	// at that level from the bytes it needs and handed to Responder::preview()
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
-						 Responder* responder);
+						 Responder* responder, S32 preview_discard = -1);
 	S32 update(F32 max_time_ms) override;
 
+	U32 getPoolSize() const { return (U32)mWorkers.size() + 1; }
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
-	
+
 private:
+	void startThread() override;
+	void shutdownWorkers();
+
+	// Extra decode thread which services the same priority ordered request queue as
+	// the LLQueuedThread. Whichever worker is free first takes the highest priority request.
+	class DecodeWorker final : public LLThread
+	{
+	public:
+		DecodeWorker(LLImageDecodeThread* owner, U32 index);
+
+	private:
+		bool runCondition() override;
+		void run() override;
+
+		LLImageDecodeThread* mOwner;
+		U32 mIndex;
+	};
+	std::vector<std::unique_ptr<DecodeWorker>> mWorkers;
+
 	struct creation_info
 	{
 		LLPointer<LLImageFormatted> image;
@@ -91,9 +125,10 @@ private:
 		handle_t handle;
 		U32 priority;
 		S32 discard;
+		S32 preview_discard;
 		BOOL needs_aux;
-		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r)
-			: image(i), responder(r), handle(h), priority(p), discard(d), needs_aux(aux)
+		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r, S32 pd)
+			: image(i), responder(r), handle(h), priority(p), discard(d), preview_discard(pd), needs_aux(aux)
 		{}
 	};
 	typedef std::list<creation_info> creation_list_t;
@@ -36,6 +36,8 @@
 // Tut header
 #include "../test/lltut.h"
 
+#include <algorithm>
+
 // -------------------------------------------------------------------------------------------
 // Stubbing: Declarations required to link and run the class being tested
 // Notes: 
@@ -244,6 +246,35 @@ namespace tut
 		ensure("LLImageDecodeThread: threaded work unit not processed", done == true);
 	}
 
+	template<> template<>
+	void imagedecodethread_object_t::test<3>()
+	{
+		// Test a threaded instance running a pool of decode workers
+		mThread = new LLImageDecodeThread(true, 4);
+		ensure("LLImageDecodeThread: pool constructor failed", mThread != NULL);
+		ensure_equals("LLImageDecodeThread: pool size incorrect", mThread->getPoolSize(), 4U);
+		// Queue several work units so that more than one worker gets something to do
+		const S32 REQUEST_COUNT = 8;
+		bool done[REQUEST_COUNT];
+		for (S32 i = 0; i < REQUEST_COUNT; ++i)
+		{
+			mThread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL + i, 0, FALSE, new responder_test(&done[i]));
+		}
+		mThread->update(1);
+		const U32 INCREMENT_TIME = 500;				// 500 milliseconds
+		const U32 MAX_TIME = 20 * INCREMENT_TIME;	// Do the loop 20 times max, i.e. wait 10 seconds but no more
+		U32 total_time = 0;
+		bool all_done = false;
+		while (!all_done && (total_time < MAX_TIME))
+		{
+			ms_sleep(INCREMENT_TIME);
+			total_time += INCREMENT_TIME;
+			all_done = std::all_of(done, done + REQUEST_COUNT, [](bool d) { return d; });
+		}
+		// Verifies that every responder has been called
+		ensure("LLImageDecodeThread: pooled work units not processed", all_done);
+	}
+
 	// ---------------------------------------------------------------------------------------
 	// Test the LLImageDecodeThread::ImageRequest interface
 	// ---------------------------------------------------------------------------------------
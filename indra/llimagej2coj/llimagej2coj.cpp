@@ -193,7 +193,14 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	opj_setup_decoder(dinfo, &parameters);
 
 	/* open a byte stream */
-	cio = opj_cio_open((opj_common_ptr)dinfo, base.getData(), base.getDataSize());
+	// Like the KDU decoder, only read as far as the caller asked, a lower
+	// resolution pass over a partial stream needs no more than its layers
+	S32 max_bytes = base.getDataSize();
+	if (base.getMaxBytes() > 0 && base.getMaxBytes() < max_bytes)
+	{
+		max_bytes = base.getMaxBytes();
+	}
+	cio = opj_cio_open((opj_common_ptr)dinfo, base.getData(), max_bytes);
 
 	/* decode the stream and fill the image structure */
 	image = opj_decode(dinfo, cio);
@@ -223,6 +223,9 @@ protected:
 	LLSaleInfo mSaleInfo;
 	LLInventoryType::EType mInventoryType;
 	U32 mFlags;
+
+	friend class LLInventoryCacheReader;
+	friend class LLInventoryCacheWriter;
 };
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -280,6 +283,9 @@ public:
 	//--------------------------------------------------------------------
 protected:
 	LLFolderType::EType	mPreferredType; // Type that this category was "meant" to hold (although it may hold any type).	
+
+	friend class LLInventoryCacheReader;
+	friend class LLInventoryCacheWriter;
 };
 
 
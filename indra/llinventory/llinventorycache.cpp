@@ -0,0 +1,391 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Compact binary file format for the local inventory cache
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llinventorycache.h"
+
+#include <cerrno>
+
+#include "llcrc.h"
+#include "llfile.h"
+#include "llinventory.h"
+#include "llxorcipher.h"
+
+using namespace LLInventoryCache;
+
+// Same key LLInventoryItem::exportFile() scrambles restricted asset ids with
+static const LLUUID SHADOW_ID_KEY("3c115e51-04f4-523c-9fa6-98aff1034730");
+
+static void unscramble_asset_id(LLUUID& id)
+{
+	LLXORCipher cipher(SHADOW_ID_KEY.mData, UUID_BYTES);
+	cipher.decrypt(id.mData, UUID_BYTES);
+}
+
+static void scramble_asset_id(LLUUID& id)
+{
+	LLXORCipher cipher(SHADOW_ID_KEY.mData, UUID_BYTES);
+	cipher.encrypt(id.mData, UUID_BYTES);
+}
+
+///----------------------------------------------------------------------------
+/// Class LLInventoryCacheWriter
+///----------------------------------------------------------------------------
+
+LLInventoryCacheWriter::LLInventoryCacheWriter()
+{
+	static_assert(sizeof(Header) == 64, "inventory cache header layout changed");
+	static_assert(sizeof(CategoryRecord) == 24, "inventory cache category layout changed");
+	static_assert(sizeof(ItemRecord) == 80, "inventory cache item layout changed");
+	mStringOffsets.push_back(0);
+}
+
+void LLInventoryCacheWriter::reserve(U32 categories, U32 items)
+{
+	mCategories.reserve(categories);
+	mItems.reserve(items);
+	// Every item has a few ids of its own, most creators, owners and groups repeat
+	mUUIDs.reserve(categories + items * 3);
+	mUUIDIndex.reserve(categories + items * 3);
+}
+
+U32 LLInventoryCacheWriter::internUUID(const LLUUID& id)
+{
+	auto inserted = mUUIDIndex.emplace(id, (U32)mUUIDs.size());
+	if (inserted.second)
+	{
+		mUUIDs.push_back(id);
+	}
+	return inserted.first->second;
+}
+
+U32 LLInventoryCacheWriter::internString(const std::string& str)
+{
+	auto inserted = mStringIndex.emplace(str, (U32)(mStringOffsets.size() - 1));
+	if (inserted.second)
+	{
+		mStringBytes.append(str);
+		mStringOffsets.push_back((U32)mStringBytes.size());
+	}
+	return inserted.first->second;
+}
+
+void LLInventoryCacheWriter::addCategory(const LLInventoryCategory& cat, const LLUUID& owner_id, S32 version)
+{
+	CategoryRecord record;
+	memset(&record, 0, sizeof(record));
+	record.mID = internUUID(cat.mUUID);
+	record.mParent = internUUID(cat.mParentUUID);
+	record.mOwner = internUUID(owner_id);
+	record.mName = internString(cat.mName);
+	record.mVersion = version;
+	record.mType = (S8)cat.mType;
+	record.mPreferredType = (S8)cat.mPreferredType;
+	mCategories.push_back(record);
+}
+
+void LLInventoryCacheWriter::addItem(const LLInventoryItem& item)
+{
+	const LLPermissions& perm = item.mPermissions;
+
+	ItemRecord record;
+	memset(&record, 0, sizeof(record));
+	record.mID = internUUID(item.mUUID);
+	record.mParent = internUUID(item.mParentUUID);
+	if ((perm.getMaskBase() & PERM_ITEM_UNRESTRICTED) == PERM_ITEM_UNRESTRICTED
+		|| item.mAssetUUID.isNull())
+	{
+		record.mAsset = internUUID(item.mAssetUUID);
+	}
+	else
+	{
+		LLUUID shadow_id(item.mAssetUUID);
+		scramble_asset_id(shadow_id);
+		record.mAsset = internUUID(shadow_id);
+		record.mBits |= ITEM_SHADOW_ASSET;
+	}
+	record.mCreator = internUUID(perm.getCreator());
+	record.mOwner = internUUID(perm.getOwner());
+	record.mLastOwner = internUUID(perm.getLastOwner());
+	record.mGroup = internUUID(perm.getGroup());
+	record.mMaskBase = perm.getMaskBase();
+	record.mMaskOwner = perm.getMaskOwner();
+	record.mMaskGroup = perm.getMaskGroup();
+	record.mMaskEveryone = perm.getMaskEveryone();
+	record.mMaskNextOwner = perm.getMaskNextOwner();
+	if (perm.isGroupOwned())
+	{
+		record.mBits |= ITEM_GROUP_OWNED;
+	}
+	record.mFlags = item.mFlags;
+	record.mSalePrice = item.mSaleInfo.getSalePrice();
+	record.mSaleType = (S8)item.mSaleInfo.getSaleType();
+	record.mName = internString(item.mName);
+	record.mDescription = internString(item.mDescription);
+	record.mCreationDate = (S64)item.mCreationDate;
+	record.mType = (S8)item.mType;
+	record.mInventoryType = (S8)item.mInventoryType;
+	mItems.push_back(record);
+}
+
+bool LLInventoryCacheWriter::save(const std::string& filename, U32 cache_version) const
+{
+	Header header;
+	memset(&header, 0, sizeof(header));
+	header.mMagic = MAGIC;
+	header.mFormatVersion = FORMAT_VERSION;
+	header.mCacheVersion = cache_version;
+	header.mCategoryCount = (U32)mCategories.size();
+	header.mItemCount = (U32)mItems.size();
+	header.mUUIDCount = (U32)mUUIDs.size();
+	header.mStringCount = (U32)(mStringOffsets.size() - 1);
+	header.mStringBytes = (U32)mStringBytes.size();
+
+	struct Section
+	{
+		const void* mData;
+		size_t mSize;
+	};
+	const Section sections[] =
+	{
+		{ mCategories.data(), mCategories.size() * sizeof(CategoryRecord) },
+		{ mItems.data(), mItems.size() * sizeof(ItemRecord) },
+		{ mUUIDs.data(), mUUIDs.size() * sizeof(LLUUID) },
+		{ mStringOffsets.data(), mStringOffsets.size() * sizeof(U32) },
+		{ mStringBytes.data(), mStringBytes.size() },
+	};
+
+	LLCRC crc;
+	header.mFileSize = sizeof(Header);
+	for (const Section& section : sections)
+	{
+		crc.update((const U8*)section.mData, section.mSize);
+		header.mFileSize += section.mSize;
+	}
+	header.mCRC = crc.getCRC();
+
+	const std::string temp_filename = filename + ".tmp";
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+	if (!fp)
+	{
+		LL_WARNS("Inventory") << "Unable to write inventory cache " << temp_filename << LL_ENDL;
+		return false;
+	}
+	bool success = fwrite(&header, sizeof(header), 1, fp) == 1;
+	for (const Section& section : sections)
+	{
+		if (success && section.mSize)
+		{
+			success = fwrite(section.mData, section.mSize, 1, fp) == 1;
+		}
+	}
+	success = (fclose(fp) == 0) && success;
+
+	if (success)
+	{
+		// rename() does not replace an existing file everywhere
+		LLFile::remove(filename, ENOENT);
+		success = LLFile::rename(temp_filename, filename) == 0;
+	}
+	if (!success)
+	{
+		LL_WARNS("Inventory") << "Unable to write inventory cache " << filename << LL_ENDL;
+		LLFile::remove(temp_filename, ENOENT);
+	}
+	return success;
+}
+
+///----------------------------------------------------------------------------
+/// Class LLInventoryCacheReader
+///----------------------------------------------------------------------------
+
+LLInventoryCacheReader::LLInventoryCacheReader()
+:	mHeader(nullptr),
+	mCategories(nullptr),
+	mItems(nullptr),
+	mUUIDs(nullptr),
+	mStringOffsets(nullptr),
+	mStringBytes(nullptr)
+{
+}
+
+bool LLInventoryCacheReader::open(const std::string& filename)
+{
+	close();
+	if (!mFile.open(filename, LLMappedFile::READ_ONLY))
+	{
+		return false;
+	}
+
+	const Header* header = mFile.getAs<Header>();
+	if (mFile.size() < sizeof(Header)
+		|| header->mMagic != MAGIC
+		|| header->mFormatVersion != FORMAT_VERSION
+		|| header->mFileSize != mFile.size())
+	{
+		LL_INFOS("Inventory") << "Ignoring inventory cache " << filename << " in an unknown format" << LL_ENDL;
+		mFile.close();
+		return false;
+	}
+
+	// All counts are 32 bit, none of the products can overflow 64 bits
+	const U64 categories_offset = sizeof(Header);
+	const U64 items_offset = categories_offset + (U64)header->mCategoryCount * sizeof(CategoryRecord);
+	const U64 uuids_offset = items_offset + (U64)header->mItemCount * sizeof(ItemRecord);
+	const U64 offsets_offset = uuids_offset + (U64)header->mUUIDCount * sizeof(LLUUID);
+	const U64 bytes_offset = offsets_offset + ((U64)header->mStringCount + 1) * sizeof(U32);
+	if (bytes_offset + header->mStringBytes != header->mFileSize)
+	{
+		LL_WARNS("Inventory") << "Inventory cache " << filename << " is truncated" << LL_ENDL;
+		mFile.close();
+		return false;
+	}
+
+	LLCRC crc;
+	crc.update(mFile.data() + sizeof(Header), mFile.size() - sizeof(Header));
+	if (crc.getCRC() != header->mCRC)
+	{
+		LL_WARNS("Inventory") << "Inventory cache " << filename << " failed its checksum" << LL_ENDL;
+		mFile.close();
+		return false;
+	}
+
+	mHeader = header;
+	mCategories = mFile.getAs<CategoryRecord>(categories_offset);
+	mItems = mFile.getAs<ItemRecord>(items_offset);
+	mUUIDs = mFile.getAs<LLUUID>(uuids_offset);
+	mStringOffsets = mFile.getAs<U32>(offsets_offset);
+	mStringBytes = mFile.getAs<char>(bytes_offset);
+	return true;
+}
+
+void LLInventoryCacheReader::close()
+{
+	mFile.close();
+	mHeader = nullptr;
+	mCategories = nullptr;
+	mItems = nullptr;
+	mUUIDs = nullptr;
+	mStringOffsets = nullptr;
+	mStringBytes = nullptr;
+}
+
+const LLUUID* LLInventoryCacheReader::getUUID(U32 index) const
+{
+	return index < mHeader->mUUIDCount ? &mUUIDs[index] : nullptr;
+}
+
+bool LLInventoryCacheReader::getString(U32 index, std::string& str) const
+{
+	if (index >= mHeader->mStringCount)
+	{
+		return false;
+	}
+	const U32 begin = mStringOffsets[index];
+	const U32 end = mStringOffsets[index + 1];
+	if (begin > end || end > mHeader->mStringBytes)
+	{
+		return false;
+	}
+	str.assign(mStringBytes + begin, end - begin);
+	return true;
+}
+
+bool LLInventoryCacheReader::getCategory(U32 index, LLInventoryCategory& cat, LLUUID& owner_id, S32& version) const
+{
+	if (!mHeader || index >= mHeader->mCategoryCount)
+	{
+		return false;
+	}
+	const CategoryRecord& record = mCategories[index];
+	const LLUUID* id = getUUID(record.mID);
+	const LLUUID* parent_id = getUUID(record.mParent);
+	const LLUUID* owner = getUUID(record.mOwner);
+	if (!id || !parent_id || !owner || !getString(record.mName, cat.mName))
+	{
+		return false;
+	}
+	cat.mUUID = *id;
+	cat.mParentUUID = *parent_id;
+	cat.mType = (LLAssetType::EType)record.mType;
+	cat.mPreferredType = (LLFolderType::EType)record.mPreferredType;
+	owner_id = *owner;
+	version = record.mVersion;
+	return true;
+}
+
+bool LLInventoryCacheReader::getItem(U32 index, LLInventoryItem& item) const
+{
+	if (!mHeader || index >= mHeader->mItemCount)
+	{
+		return false;
+	}
+	const ItemRecord& record = mItems[index];
+	const LLUUID* id = getUUID(record.mID);
+	const LLUUID* parent_id = getUUID(record.mParent);
+	const LLUUID* asset_id = getUUID(record.mAsset);
+	const LLUUID* creator = getUUID(record.mCreator);
+	const LLUUID* owner = getUUID(record.mOwner);
+	const LLUUID* last_owner = getUUID(record.mLastOwner);
+	const LLUUID* group = getUUID(record.mGroup);
+	if (!id || !parent_id || !asset_id || !creator || !owner || !last_owner || !group
+		|| !getString(record.mName, item.mName)
+		|| !getString(record.mDescription, item.mDescription))
+	{
+		return false;
+	}
+
+	item.mUUID = *id;
+	item.mParentUUID = *parent_id;
+	item.mAssetUUID = *asset_id;
+	if (record.mBits & ITEM_SHADOW_ASSET)
+	{
+		unscramble_asset_id(item.mAssetUUID);
+	}
+
+	// Same end state as LLPermissions::importFile(): the saved masks and flags, then fix()
+	LLPermissions& perm = item.mPermissions;
+	perm.mCreator = *creator;
+	perm.mOwner = *owner;
+	perm.mLastOwner = *last_owner;
+	perm.mGroup = *group;
+	perm.mMaskBase = record.mMaskBase;
+	perm.mMaskOwner = record.mMaskOwner;
+	perm.mMaskGroup = record.mMaskGroup;
+	perm.mMaskEveryone = record.mMaskEveryone;
+	perm.mMaskNextOwner = record.mMaskNextOwner;
+	perm.mIsGroupOwned = (record.mBits & ITEM_GROUP_OWNED) != 0;
+	perm.fix();
+
+	item.mSaleInfo.setSaleType((LLSaleInfo::EForSale)record.mSaleType);
+	item.mSaleInfo.setSalePrice(record.mSalePrice);
+	item.mType = (LLAssetType::EType)record.mType;
+	item.mInventoryType = (LLInventoryType::EType)record.mInventoryType;
+	item.mFlags = record.mFlags;
+	item.mCreationDate = (time_t)record.mCreationDate;
+	return true;
+}
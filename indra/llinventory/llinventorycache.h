@@ -0,0 +1,181 @@
+/**
+ * @file llinventorycache.h
+ * @brief Compact binary file format for the local inventory cache
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+#include "llfoldertype.h"
+#include "llmappedfile.h"
+#include "lluuid.h"
+
+class LLInventoryCategory;
+class LLInventoryItem;
+
+// Inventory cache file layout, all in host byte order:
+//
+//   Header
+//   CategoryRecord[category count]
+//   ItemRecord[item count]
+//   LLUUID[uuid count]				every distinct id, records refer to them by index
+//   U32[string count + 1]			offsets into the string bytes
+//   char[string bytes]				every distinct name and description, not terminated
+//
+// Records have a fixed size, so the file is used in place once mapped and
+// checked against the CRC in the header. Anything that does not match the
+// expected layout is rejected as a whole and the caller falls back to the server.
+namespace LLInventoryCache
+{
+	const U32 MAGIC = 0x43564e49; // "INVC"
+	const U32 FORMAT_VERSION = 1;
+
+	struct Header
+	{
+		U32 mMagic;
+		U32 mFormatVersion;
+		U32 mCacheVersion;		// caller defined, see LLInventoryModel::sCurrentInvCacheVersion
+		U32 mCategoryCount;
+		U32 mItemCount;
+		U32 mUUIDCount;
+		U32 mStringCount;
+		U32 mStringBytes;
+		U64 mFileSize;
+		U32 mCRC;				// of everything after the header
+		U8 mReserved[20];
+	};
+
+	struct CategoryRecord
+	{
+		U32 mID;
+		U32 mParent;
+		U32 mOwner;
+		U32 mName;
+		S32 mVersion;
+		S8 mType;
+		S8 mPreferredType;
+		U16 mPad;
+	};
+
+	enum
+	{
+		ITEM_GROUP_OWNED = 1 << 0,
+		ITEM_SHADOW_ASSET = 1 << 1,		// asset id is stored scrambled, as in LLInventoryItem::exportFile()
+	};
+
+	struct ItemRecord
+	{
+		U32 mID;
+		U32 mParent;
+		U32 mAsset;
+		U32 mCreator;
+		U32 mOwner;
+		U32 mLastOwner;
+		U32 mGroup;
+		U32 mMaskBase;
+		U32 mMaskOwner;
+		U32 mMaskGroup;
+		U32 mMaskEveryone;
+		U32 mMaskNextOwner;
+		U32 mFlags;
+		S32 mSalePrice;
+		U32 mName;
+		U32 mDescription;
+		S64 mCreationDate;
+		S8 mType;
+		S8 mInventoryType;
+		S8 mSaleType;
+		U8 mBits;
+		U32 mPad;
+	};
+}
+
+// Collects categories and items and writes them out as one cache file.
+class LLInventoryCacheWriter
+{
+public:
+	LLInventoryCacheWriter();
+
+	void reserve(U32 categories, U32 items);
+
+	// Owner and version live on the viewer side category
+	void addCategory(const LLInventoryCategory& cat, const LLUUID& owner_id, S32 version);
+	void addItem(const LLInventoryItem& item);
+
+	// Writes to a temporary file first and renames it over filename,
+	// so a crash never leaves a truncated cache behind.
+	bool save(const std::string& filename, U32 cache_version) const;
+
+	U32 getCategoryCount() const { return (U32)mCategories.size(); }
+	U32 getItemCount() const { return (U32)mItems.size(); }
+
+private:
+	U32 internUUID(const LLUUID& id);
+	U32 internString(const std::string& str);
+
+	std::vector<LLInventoryCache::CategoryRecord> mCategories;
+	std::vector<LLInventoryCache::ItemRecord> mItems;
+	std::vector<LLUUID> mUUIDs;
+	std::vector<U32> mStringOffsets;
+	std::string mStringBytes;
+	absl::flat_hash_map<LLUUID, U32> mUUIDIndex;
+	absl::flat_hash_map<std::string, U32> mStringIndex;
+};
+
+// Maps a cache file and hands out its records.
+class LLInventoryCacheReader
+{
+public:
+	LLInventoryCacheReader();
+
+	// Maps and validates filename. Returns false if it is missing or damaged.
+	bool open(const std::string& filename);
+	void close();
+
+	U32 getCacheVersion() const { return mHeader ? mHeader->mCacheVersion : 0; }
+	U32 getCategoryCount() const { return mHeader ? mHeader->mCategoryCount : 0; }
+	U32 getItemCount() const { return mHeader ? mHeader->mItemCount : 0; }
+
+	// Fill in the record at index, returning false if it refers outside the tables
+	bool getCategory(U32 index, LLInventoryCategory& cat, LLUUID& owner_id, S32& version) const;
+	bool getItem(U32 index, LLInventoryItem& item) const;
+
+private:
+	const LLUUID* getUUID(U32 index) const;
+	bool getString(U32 index, std::string& str) const;
+
+	LLMappedFile mFile;
+	const LLInventoryCache::Header* mHeader;
+	const LLInventoryCache::CategoryRecord* mCategories;
+	const LLInventoryCache::ItemRecord* mItems;
+	const LLUUID* mUUIDs;
+	const U32* mStringOffsets;
+	const char* mStringBytes;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
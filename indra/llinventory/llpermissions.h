@@ -110,6 +110,9 @@ private:
 	// Fix internal consistency for group/agent ownership
 	void fixOwnership();
 
+	// Restores saved permissions without going through the setters
+	friend class LLInventoryCacheReader;
+
 public:
 	static const LLPermissions DEFAULT;
 
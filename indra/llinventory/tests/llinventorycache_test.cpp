@@ -0,0 +1,310 @@
+/**
+ * @file llinventorycache_test.cpp
+ * @brief Tests and load time benchmark for the binary inventory cache
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llinventorycache.h"
+
+#include <iostream>
+
+#include "../llinventory.h"
+#include "llfile.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// A few creators, owners and names shared by many items, like a real inventory
+	LLPointer<LLInventoryItem> make_item(S32 index, const LLUUID& parent_id, PermissionMask base)
+	{
+		static LLUUID creators[4];
+		static LLUUID group_id;
+		if (creators[0].isNull())
+		{
+			for (LLUUID& creator : creators)
+			{
+				creator.generate();
+			}
+			group_id.generate();
+		}
+		LLUUID item_id;
+		item_id.generate();
+		LLUUID asset_id;
+		asset_id.generate();
+
+		LLPermissions perm;
+		perm.init(creators[index % 4], creators[0], creators[(index + 1) % 4], group_id);
+		perm.initMasks(base, base, PERM_COPY, PERM_COPY, PERM_MODIFY | PERM_COPY);
+
+		return new LLInventoryItem(
+			item_id,
+			parent_id,
+			perm,
+			asset_id,
+			LLAssetType::AT_OBJECT,
+			LLInventoryType::IT_OBJECT,
+			llformat("Object %d", index % 100),
+			std::string("Used for Testing"),
+			LLSaleInfo(LLSaleInfo::FS_COPY, index),
+			index,
+			1500000000 + index);
+	}
+
+	void ensure_same_item(const std::string& msg, const LLInventoryItem* expected, const LLInventoryItem* actual)
+	{
+		tut::ensure_equals(msg + " id", actual->getUUID(), expected->getUUID());
+		tut::ensure_equals(msg + " parent", actual->getParentUUID(), expected->getParentUUID());
+		tut::ensure_equals(msg + " asset", actual->getAssetUUID(), expected->getAssetUUID());
+		tut::ensure(msg + " permissions", actual->getPermissions() == expected->getPermissions());
+		tut::ensure_equals(msg + " type", actual->getType(), expected->getType());
+		tut::ensure_equals(msg + " inventory type", actual->getInventoryType(), expected->getInventoryType());
+		tut::ensure_equals(msg + " flags", actual->getFlags(), expected->getFlags());
+		tut::ensure(msg + " sale info", actual->getSaleInfo() == expected->getSaleInfo());
+		tut::ensure_equals(msg + " name", actual->getName(), expected->getName());
+		tut::ensure_equals(msg + " description", actual->getDescription(), expected->getDescription());
+		tut::ensure_equals(msg + " creation date", actual->getCreationDate(), expected->getCreationDate());
+	}
+}
+
+namespace tut
+{
+	struct inventorycache_data
+	{
+		inventorycache_data()
+		{
+			LLUUID id;
+			id.generate();
+			mFileName = std::string(LLFile::tmpdir()) + "llinventorycache_test_" + id.asString();
+		}
+
+		~inventorycache_data()
+		{
+			LLFile::remove(mFileName, ENOENT);
+		}
+
+		std::string mFileName;
+	};
+	typedef test_group<inventorycache_data> inventorycache_test;
+	typedef inventorycache_test::object inventorycache_object;
+	tut::inventorycache_test invcache("LLInventoryCache");
+
+	// Round trip of categories and items, including restricted and group owned ones
+	template<> template<>
+	void inventorycache_object::test<1>()
+	{
+		LLUUID root_id;
+		root_id.generate();
+		LLUUID owner_id;
+		owner_id.generate();
+		LLPointer<LLInventoryCategory> cat = new LLInventoryCategory(root_id, LLUUID::null, LLFolderType::FT_ROOT_INVENTORY, "My Inventory \xe2\x98\x83");
+
+		LLInventoryItem::item_array_t items;
+		items.push_back(make_item(0, root_id, PERM_ALL));
+		items.push_back(make_item(1, root_id, PERM_MOVE | PERM_TRANSFER));
+		items.push_back(make_item(2, root_id, PERM_ALL));
+		LLPermissions group_perm;
+		group_perm.init(owner_id, LLUUID::null, owner_id, root_id);
+		items.back()->setPermissions(group_perm);
+
+		LLInventoryCacheWriter writer;
+		writer.addCategory(*cat, owner_id, 42);
+		for (const auto& item : items)
+		{
+			writer.addItem(*item);
+		}
+		ensure("save", writer.save(mFileName, 7));
+
+		LLInventoryCacheReader reader;
+		ensure("open", reader.open(mFileName));
+		ensure_equals("cache version", reader.getCacheVersion(), 7U);
+		ensure_equals("category count", reader.getCategoryCount(), 1U);
+		ensure_equals("item count", reader.getItemCount(), (U32)items.size());
+
+		LLPointer<LLInventoryCategory> read_cat = new LLInventoryCategory;
+		LLUUID read_owner_id;
+		S32 version = 0;
+		ensure("category", reader.getCategory(0, *read_cat, read_owner_id, version));
+		ensure_equals("category id", read_cat->getUUID(), root_id);
+		ensure_equals("category parent", read_cat->getParentUUID(), LLUUID::null);
+		ensure_equals("category name", read_cat->getName(), cat->getName());
+		ensure_equals("category preferred type", read_cat->getPreferredType(), LLFolderType::FT_ROOT_INVENTORY);
+		ensure_equals("category owner", read_owner_id, owner_id);
+		ensure_equals("category version", version, 42);
+
+		LLPointer<LLInventoryItem> read_item;
+		for (U32 i = 0; i < items.size(); ++i)
+		{
+			read_item = new LLInventoryItem;
+			ensure("item", reader.getItem(i, *read_item));
+			ensure_same_item(llformat("item %d", i), items[i], read_item);
+		}
+		ensure("group owned", read_item->getPermissions().isGroupOwned());
+		ensure("out of range", !reader.getItem((U32)items.size(), *read_item));
+	}
+
+	// Shared ids and strings are only stored once
+	template<> template<>
+	void inventorycache_object::test<2>()
+	{
+		LLUUID root_id;
+		root_id.generate();
+		const U32 COUNT = 1000;
+		LLInventoryCacheWriter writer;
+		for (U32 i = 0; i < COUNT; ++i)
+		{
+			writer.addItem(*make_item(0, root_id, PERM_ALL));
+		}
+		ensure("save", writer.save(mFileName, 1));
+
+		// Item, asset, the shared parent, creator, last owner and group ids, one name, one description
+		const size_t expected = sizeof(LLInventoryCache::Header)
+			+ COUNT * (sizeof(LLInventoryCache::ItemRecord) + 2 * sizeof(LLUUID))
+			+ 4 * sizeof(LLUUID)
+			+ 3 * sizeof(U32)
+			+ std::string("Object 0Used for Testing").size();
+		llstat st;
+		ensure("stat", LLFile::stat(mFileName, &st) == 0);
+		ensure_equals("file size", (size_t)st.st_size, expected);
+	}
+
+	// Damaged and truncated files are rejected
+	template<> template<>
+	void inventorycache_object::test<3>()
+	{
+		LLUUID root_id;
+		root_id.generate();
+		LLInventoryCacheWriter writer;
+		for (S32 i = 0; i < 100; ++i)
+		{
+			writer.addItem(*make_item(i, root_id, PERM_ALL));
+		}
+		ensure("save", writer.save(mFileName, 1));
+
+		LLInventoryCacheReader reader;
+		ensure("intact", reader.open(mFileName));
+		reader.close();
+
+		LLFILE* fp = LLFile::fopen(mFileName, "r+b");
+		ensure("reopen", fp != nullptr);
+		U8 byte = 0;
+		fseek(fp, sizeof(LLInventoryCache::Header) + 100, SEEK_SET);
+		ensure("read byte", fread(&byte, 1, 1, fp) == 1);
+		byte = ~byte;
+		fseek(fp, sizeof(LLInventoryCache::Header) + 100, SEEK_SET);
+		fwrite(&byte, 1, 1, fp);
+		fclose(fp);
+		ensure("damaged", !reader.open(mFileName));
+
+		ensure("save again", writer.save(mFileName, 1));
+		std::vector<U8> buffer(sizeof(LLInventoryCache::Header) + 64);
+		fp = LLFile::fopen(mFileName, "rb");
+		ensure("read", fp && fread(buffer.data(), buffer.size(), 1, fp) == 1);
+		fclose(fp);
+		fp = LLFile::fopen(mFileName, "wb");
+		fwrite(buffer.data(), buffer.size(), 1, fp);
+		fclose(fp);
+		ensure("truncated", !reader.open(mFileName));
+	}
+
+	// Load time of the text cache against the binary one, for a large inventory
+	template<> template<>
+	void inventorycache_object::test<4>()
+	{
+		const S32 COUNT = 100000;
+		LLUUID root_id;
+		root_id.generate();
+		LLInventoryItem::item_array_t items;
+		items.reserve(COUNT);
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			items.push_back(make_item(i, root_id, (i % 3) ? PERM_ALL : PERM_MOVE | PERM_TRANSFER));
+		}
+
+		// Text format, the way LLInventoryModel::saveToFile() and loadFromFile() do it
+		const std::string text_filename = mFileName + ".inv";
+		LLFILE* fp = LLFile::fopen(text_filename, "wb");
+		ensure("text open", fp != nullptr);
+		for (const auto& item : items)
+		{
+			item->exportFile(fp);
+		}
+		fclose(fp);
+
+		LLTimer timer;
+		LLInventoryItem::item_array_t text_items;
+		fp = LLFile::fopen(text_filename, "rb");
+		char buffer[MAX_STRING];
+		char keyword[MAX_STRING];
+		while (fgets(buffer, MAX_STRING, fp))
+		{
+			if (sscanf(buffer, " %254s", keyword) == 1 && 0 == strcmp("inv_item", keyword))
+			{
+				LLPointer<LLInventoryItem> item = new LLInventoryItem;
+				if (item->importFile(fp))
+				{
+					text_items.push_back(item);
+				}
+			}
+		}
+		fclose(fp);
+		const F64 text_time = timer.getElapsedTimeF64();
+		LLFile::remove(text_filename);
+		ensure_equals("text item count", text_items.size(), items.size());
+
+		LLInventoryCacheWriter writer;
+		writer.reserve(0, COUNT);
+		for (const auto& item : items)
+		{
+			writer.addItem(*item);
+		}
+		ensure("save", writer.save(mFileName, 1));
+
+		timer.reset();
+		LLInventoryItem::item_array_t binary_items;
+		binary_items.reserve(COUNT);
+		LLInventoryCacheReader reader;
+		ensure("open", reader.open(mFileName));
+		for (U32 i = 0; i < reader.getItemCount(); ++i)
+		{
+			LLPointer<LLInventoryItem> item = new LLInventoryItem;
+			if (reader.getItem(i, *item))
+			{
+				binary_items.push_back(item);
+			}
+		}
+		const F64 binary_time = timer.getElapsedTimeF64();
+		ensure_equals("binary item count", binary_items.size(), items.size());
+		for (S32 i = 0; i < COUNT; i += 997)
+		{
+			ensure_same_item(llformat("text %d", i), items[i], text_items[i]);
+			ensure_same_item(llformat("binary %d", i), items[i], binary_items[i]);
+		}
+
+		std::cout << "\nInventory cache load, " << COUNT << " items: text " << text_time * 1000.0
+				  << " ms, binary " << binary_time * 1000.0 << " ms" << std::endl;
+	}
+}
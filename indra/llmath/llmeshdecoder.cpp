@@ -0,0 +1,589 @@
+/**
+ * @file llmeshdecoder.cpp
+ * @brief Direct decoding of mesh asset LOD blocks
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llmath.h"
+#include "llmeshdecoder.h"
+
+#include <cstring>
+
+#include "llsd.h"
+#include "llvector4a.h"
+
+namespace
+{
+	// Same limit LLUZipHelper gives the LLSD parser
+	const S32 MAX_DEPTH = 96;
+
+	// Cursor over a binary LLSD block, see LLSDBinaryParser::doParse() for the format
+	class BlockReader
+	{
+	public:
+		BlockReader(const U8* data, U32 size)
+		:	mCur(data),
+			mEnd(data + size)
+		{
+		}
+
+		bool get(U8& c)
+		{
+			if (mCur >= mEnd)
+			{
+				return false;
+			}
+			c = *mCur++;
+			return true;
+		}
+
+		bool getU32(U32& value)
+		{
+			if (mEnd - mCur < 4)
+			{
+				return false;
+			}
+			value = ((U32)mCur[0] << 24) | ((U32)mCur[1] << 16) | ((U32)mCur[2] << 8) | (U32)mCur[3];
+			mCur += 4;
+			return true;
+		}
+
+		bool getF64(F64& value)
+		{
+			if (mEnd - mCur < 8)
+			{
+				return false;
+			}
+			U64 bits = 0;
+			for (U32 i = 0; i < 8; ++i)
+			{
+				bits = (bits << 8) | mCur[i];
+			}
+			memcpy(&value, &bits, sizeof(F64));
+			mCur += 8;
+			return true;
+		}
+
+		// Size prefixed bytes of a string, key, uri or binary
+		bool getSized(const U8*& bytes, U32& size)
+		{
+			if (!getU32(size) || (S32)size < 0 || (U32)(mEnd - mCur) < size)
+			{
+				return false;
+			}
+			bytes = mCur;
+			mCur += size;
+			return true;
+		}
+
+		bool skip(U32 size)
+		{
+			if ((U32)(mEnd - mCur) < size)
+			{
+				return false;
+			}
+			mCur += size;
+			return true;
+		}
+
+		// Skips one value of any type
+		bool skipValue(S32 depth)
+		{
+			U8 c;
+			if (depth <= 0 || !get(c))
+			{
+				return false;
+			}
+
+			const U8* bytes;
+			U32 size;
+			switch (c)
+			{
+			case '!':
+			case '0':
+			case '1':
+				return true;
+			case 'i':
+				return skip(4);
+			case 'r':
+			case 'd':
+				return skip(8);
+			case 'u':
+				return skip(16);
+			case 's':
+			case 'l':
+			case 'b':
+				return getSized(bytes, size);
+			case '[':
+			{
+				U32 count;
+				if (!getU32(count))
+				{
+					return false;
+				}
+				for (U32 i = 0; i < count; ++i)
+				{
+					if (!skipValue(depth - 1))
+					{
+						return false;
+					}
+				}
+				return get(c) && c == ']';
+			}
+			case '{':
+			{
+				U32 count;
+				if (!getU32(count))
+				{
+					return false;
+				}
+				for (U32 i = 0; i < count; ++i)
+				{
+					if (!getKey(bytes, size) || !skipValue(depth - 1))
+					{
+						return false;
+					}
+				}
+				return get(c) && c == '}';
+			}
+			default:
+				// Notation style strings and anything unknown go to the LLSD parser
+				return false;
+			}
+		}
+
+		// Key of the next map entry
+		bool getKey(const U8*& key, U32& size)
+		{
+			U8 c;
+			return get(c) && c == 'k' && getSized(key, size);
+		}
+
+		// A number as LLSD::asReal() would convert it
+		bool getReal(F64& value)
+		{
+			U8 c;
+			if (!get(c))
+			{
+				return false;
+			}
+			switch (c)
+			{
+			case '!':
+			case '0':
+				value = 0.0;
+				return true;
+			case '1':
+				value = 1.0;
+				return true;
+			case 'i':
+			{
+				U32 i;
+				if (!getU32(i))
+				{
+					return false;
+				}
+				value = (F64)(S32)i;
+				return true;
+			}
+			case 'r':
+				return getF64(value);
+			default:
+				return false;
+			}
+		}
+
+		// A binary stream, undefined reads as empty like LLSD::asBinary()
+		bool getBinary(const U8*& bytes, U32& size)
+		{
+			U8 c;
+			if (!get(c))
+			{
+				return false;
+			}
+			if (c == '!')
+			{
+				bytes = nullptr;
+				size = 0;
+				return true;
+			}
+			if (c != 'b' || !getSized(bytes, size))
+			{
+				return false;
+			}
+			if (!size)
+			{
+				bytes = nullptr;
+			}
+			return true;
+		}
+
+		// An array of up to count numbers, missing ones read as zero
+		bool getVector(F32* v, U32 count)
+		{
+			U8 c;
+			U32 size;
+			if (!get(c))
+			{
+				return false;
+			}
+			if (c == '!')
+			{
+				return true;
+			}
+			if (c != '[' || !getU32(size))
+			{
+				return false;
+			}
+			for (U32 i = 0; i < size; ++i)
+			{
+				F64 value;
+				if (i >= count)
+				{
+					if (!skipValue(MAX_DEPTH))
+					{
+						return false;
+					}
+				}
+				else if (getReal(value))
+				{
+					v[i] = (F32)value;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return get(c) && c == ']';
+		}
+
+		// A {Min, Max} domain map
+		bool getDomain(F32* min, F32* max, U32 count)
+		{
+			U8 c;
+			U32 size;
+			if (!get(c))
+			{
+				return false;
+			}
+			if (c == '!')
+			{
+				return true;
+			}
+			if (c != '{' || !getU32(size))
+			{
+				return false;
+			}
+			bool has_min = false;
+			bool has_max = false;
+			for (U32 i = 0; i < size; ++i)
+			{
+				const U8* key;
+				U32 key_size;
+				if (!getKey(key, key_size))
+				{
+					return false;
+				}
+				// Duplicate keys keep their first value, as LLSD::insert() does
+				if (matches(key, key_size, "Min") && !has_min)
+				{
+					has_min = true;
+					if (!getVector(min, count))
+					{
+						return false;
+					}
+				}
+				else if (matches(key, key_size, "Max") && !has_max)
+				{
+					has_max = true;
+					if (!getVector(max, count))
+					{
+						return false;
+					}
+				}
+				else if (!skipValue(MAX_DEPTH))
+				{
+					return false;
+				}
+			}
+			return get(c) && c == '}';
+		}
+
+		static bool matches(const U8* key, U32 size, const char* name)
+		{
+			return strlen(name) == size && memcmp(key, name, size) == 0;
+		}
+
+	private:
+		const U8* mCur;
+		const U8* mEnd;
+	};
+
+	bool parse_face(BlockReader& reader, LLMeshDecoder::Face& face)
+	{
+		U8 c;
+		U32 size;
+		if (!reader.get(c) || c != '{' || !reader.getU32(size))
+		{
+			return false;
+		}
+
+		enum
+		{
+			SEEN_POSITION = 1 << 0,
+			SEEN_NORMAL = 1 << 1,
+			SEEN_TEXCOORD = 1 << 2,
+			SEEN_TRIANGLES = 1 << 3,
+			SEEN_WEIGHTS = 1 << 4,
+			SEEN_POSITION_DOMAIN = 1 << 5,
+			SEEN_TEXCOORD_DOMAIN = 1 << 6
+		};
+		U32 seen = 0;
+
+		for (U32 i = 0; i < size; ++i)
+		{
+			const U8* key;
+			U32 key_size;
+			if (!reader.getKey(key, key_size))
+			{
+				return false;
+			}
+
+			bool ok;
+			if (BlockReader::matches(key, key_size, "NoGeometry"))
+			{
+				face.mNoGeometry = true;
+				ok = reader.skipValue(MAX_DEPTH);
+			}
+			else if (BlockReader::matches(key, key_size, "Position") && !(seen & SEEN_POSITION))
+			{
+				seen |= SEEN_POSITION;
+				ok = reader.getBinary(face.mPosition, face.mPositionSize);
+			}
+			else if (BlockReader::matches(key, key_size, "Normal") && !(seen & SEEN_NORMAL))
+			{
+				seen |= SEEN_NORMAL;
+				ok = reader.getBinary(face.mNormal, face.mNormalSize);
+			}
+			else if (BlockReader::matches(key, key_size, "TexCoord0") && !(seen & SEEN_TEXCOORD))
+			{
+				seen |= SEEN_TEXCOORD;
+				ok = reader.getBinary(face.mTexCoord, face.mTexCoordSize);
+			}
+			else if (BlockReader::matches(key, key_size, "TriangleList") && !(seen & SEEN_TRIANGLES))
+			{
+				seen |= SEEN_TRIANGLES;
+				ok = reader.getBinary(face.mTriangleList, face.mTriangleListSize);
+			}
+			else if (BlockReader::matches(key, key_size, "Weights") && !(seen & SEEN_WEIGHTS))
+			{
+				seen |= SEEN_WEIGHTS;
+				face.mHasWeights = true;
+				ok = reader.getBinary(face.mWeights, face.mWeightsSize);
+			}
+			else if (BlockReader::matches(key, key_size, "PositionDomain") && !(seen & SEEN_POSITION_DOMAIN))
+			{
+				seen |= SEEN_POSITION_DOMAIN;
+				ok = reader.getDomain(face.mPositionMin.mV, face.mPositionMax.mV, 3);
+			}
+			else if (BlockReader::matches(key, key_size, "TexCoord0Domain") && !(seen & SEEN_TEXCOORD_DOMAIN))
+			{
+				seen |= SEEN_TEXCOORD_DOMAIN;
+				ok = reader.getDomain(face.mTexCoordMin.mV, face.mTexCoordMax.mV, 2);
+			}
+			else
+			{
+				ok = reader.skipValue(MAX_DEPTH);
+			}
+
+			if (!ok)
+			{
+				return false;
+			}
+		}
+
+		return reader.get(c) && c == '}';
+	}
+
+	void get_binary(const LLSD& sd, const U8*& bytes, U32& size)
+	{
+		const LLSD::Binary& binary = sd.asBinary();
+		size = (U32)binary.size();
+		bytes = size ? binary.data() : nullptr;
+	}
+
+	const __m128i XYZ_MASK = _mm_set_epi16(0, 0, 0, 0, 0, -1, -1, -1);
+
+	// Four U16 (8 bytes) widened to floats
+	LL_FORCE_INLINE LLQuad load_u16x4(const U8* in, const __m128i& mask)
+	{
+		const __m128i q = _mm_and_si128(_mm_loadl_epi64((const __m128i*)in), mask);
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(q, _mm_setzero_si128()));
+	}
+
+	// Last entry of a stream, without reading past its end
+	LL_FORCE_INLINE LLQuad load_last(const U8* in, U32 bytes)
+	{
+		U8 tail[8] = { 0 };
+		memcpy(tail, in, bytes);
+		return load_u16x4(tail, _mm_set1_epi32(-1));
+	}
+
+	// Widens count U16 triplets with w = 0 and applies op, which must use the
+	// same operations in the same order as the LLVector4a code it replaces
+	template<typename T>
+	void dequantize_xyz(const U8* in, U32 count, LLVector4a* out, const T& op)
+	{
+		if (!count)
+		{
+			return;
+		}
+
+		// Eight byte loads read the first U16 of the next triplet, masked off
+		const U32 last = count - 1;
+		for (U32 i = 0; i < last; ++i)
+		{
+			out[i] = op(load_u16x4(in + i * 6, XYZ_MASK));
+		}
+		out[last] = op(load_last(in + last * 6, 6));
+	}
+}
+
+LLMeshDecoder::Face::Face()
+:	mNoGeometry(false),
+	mHasWeights(false),
+	mPosition(nullptr),
+	mPositionSize(0),
+	mNormal(nullptr),
+	mNormalSize(0),
+	mTexCoord(nullptr),
+	mTexCoordSize(0),
+	mTriangleList(nullptr),
+	mTriangleListSize(0),
+	mWeights(nullptr),
+	mWeightsSize(0),
+	mPositionMin(0.f, 0.f, 0.f),
+	mPositionMax(0.f, 0.f, 0.f),
+	mTexCoordMin(0.f, 0.f),
+	mTexCoordMax(0.f, 0.f)
+{
+}
+
+bool LLMeshDecoder::parseFaces(const U8* data, U32 size, face_list_t& faces)
+{
+	faces.clear();
+
+	BlockReader reader(data, size);
+	U8 c;
+	U32 count;
+	if (!reader.get(c) || c != '[' || !reader.getU32(count) || count > size)
+	{
+		return false;
+	}
+
+	faces.resize(count);
+	for (U32 i = 0; i < count; ++i)
+	{
+		if (!parse_face(reader, faces[i]))
+		{
+			faces.clear();
+			return false;
+		}
+	}
+
+	if (!reader.get(c) || c != ']')
+	{
+		faces.clear();
+		return false;
+	}
+	return true;
+}
+
+void LLMeshDecoder::getFaces(const LLSD& mdl, face_list_t& faces)
+{
+	faces.clear();
+	faces.resize(mdl.size());
+
+	for (U32 i = 0; i < faces.size(); ++i)
+	{
+		const LLSD& sd = mdl[(LLSD::Integer)i];
+		Face& face = faces[i];
+
+		face.mNoGeometry = sd.has("NoGeometry");
+		face.mHasWeights = sd.has("Weights");
+		get_binary(sd["Position"], face.mPosition, face.mPositionSize);
+		get_binary(sd["Normal"], face.mNormal, face.mNormalSize);
+		get_binary(sd["TexCoord0"], face.mTexCoord, face.mTexCoordSize);
+		get_binary(sd["TriangleList"], face.mTriangleList, face.mTriangleListSize);
+		get_binary(sd["Weights"], face.mWeights, face.mWeightsSize);
+
+		face.mPositionMin.setValue(sd["PositionDomain"]["Min"]);
+		face.mPositionMax.setValue(sd["PositionDomain"]["Max"]);
+		face.mTexCoordMin.setValue(sd["TexCoord0Domain"]["Min"]);
+		face.mTexCoordMax.setValue(sd["TexCoord0Domain"]["Max"]);
+	}
+}
+
+void LLMeshDecoder::dequantizePositions(const U8* in, U32 count, const LLVector4a& min, const LLVector4a& range, LLVector4a* out)
+{
+	const LLQuad scale = _mm_set1_ps(65535.f);
+	const LLQuad min_q = min;
+	const LLQuad range_q = range;
+	dequantize_xyz(in, count, out, [&](const LLQuad& v)
+	{
+		return _mm_add_ps(_mm_mul_ps(_mm_div_ps(v, scale), range_q), min_q);
+	});
+}
+
+void LLMeshDecoder::dequantizeNormals(const U8* in, U32 count, LLVector4a* out)
+{
+	const LLQuad scale = _mm_set1_ps(65535.f);
+	const LLQuad two = _mm_set1_ps(2.f);
+	const LLQuad one = _mm_set1_ps(1.f);
+	dequantize_xyz(in, count, out, [&](const LLQuad& v)
+	{
+		return _mm_sub_ps(_mm_mul_ps(_mm_div_ps(v, scale), two), one);
+	});
+}
+
+void LLMeshDecoder::dequantizeTexCoords(const U8* in, U32 count, const LLVector4a& min, const LLVector4a& range, LLVector2* out)
+{
+	const LLQuad scale = _mm_set1_ps(65535.f);
+	const LLQuad min_q = min;
+	const LLQuad range_q = range;
+	const __m128i all = _mm_set1_epi32(-1);
+
+	// Two coordinates per vector, an odd last one gets zeros in its upper half
+	LLVector4a* out4 = (LLVector4a*)out;
+	const U32 pairs = count / 2;
+	for (U32 i = 0; i < pairs; ++i)
+	{
+		const LLQuad v = load_u16x4(in + i * 8, all);
+		out4[i] = _mm_add_ps(_mm_mul_ps(_mm_div_ps(v, scale), range_q), min_q);
+	}
+	if (count & 1)
+	{
+		const LLQuad v = load_last(in + pairs * 8, 4);
+		out4[pairs] = _mm_add_ps(_mm_mul_ps(_mm_div_ps(v, scale), range_q), min_q);
+	}
+}
@@ -0,0 +1,89 @@
+/**
+ * @file llmeshdecoder.h
+ * @brief Direct decoding of mesh asset LOD blocks
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHDECODER_H
+#define LL_LLMESHDECODER_H
+
+#include <vector>
+
+#include "v2math.h"
+#include "v3math.h"
+
+class LLSD;
+class LLVector4a;
+
+// Reads the faces of an inflated mesh LOD block (a binary LLSD array of face
+// maps) in place, instead of building an LLSD tree and copying every stream
+// out of it, and dequantizes the U16 vertex streams four lanes at a time.
+// Results match the LLSD path of LLVolume::unpackVolumeFaces() bit for bit.
+namespace LLMeshDecoder
+{
+	// One face of a LOD block. Streams point into the block they came from
+	// and are empty when the face does not have them.
+	struct Face
+	{
+		Face();
+
+		bool mNoGeometry;
+		bool mHasWeights;
+
+		const U8* mPosition;
+		U32 mPositionSize;
+		const U8* mNormal;
+		U32 mNormalSize;
+		const U8* mTexCoord;
+		U32 mTexCoordSize;
+		const U8* mTriangleList;
+		U32 mTriangleListSize;
+		const U8* mWeights;
+		U32 mWeightsSize;
+
+		LLVector3 mPositionMin;
+		LLVector3 mPositionMax;
+		LLVector2 mTexCoordMin;
+		LLVector2 mTexCoordMax;
+	};
+	typedef std::vector<Face> face_list_t;
+
+	// Walks an inflated binary LLSD block. Returns false when the block is
+	// malformed or encoded in a way the walker does not handle (notation style
+	// strings, the deprecated header, unexpected types), callers then parse it
+	// with LLSDSerialize and use getFaces().
+	bool parseFaces(const U8* data, U32 size, face_list_t& faces);
+
+	// Same faces from an already parsed block, mdl must outlive them
+	void getFaces(const LLSD& mdl, face_list_t& faces);
+
+	// Quantized streams are packed U16 triplets (pairs for texture coordinates)
+	// in little endian order, with no alignment requirement.
+	void dequantizePositions(const U8* in, U32 count, const LLVector4a& min, const LLVector4a& range, LLVector4a* out);
+	void dequantizeNormals(const U8* in, U32 count, LLVector4a* out);
+	// out must have room for an even number of coordinates, as
+	// LLVolumeFace::allocateVertices() pads it.
+	void dequantizeTexCoords(const U8* in, U32 count, const LLVector4a& min, const LLVector4a& range, LLVector2* out);
+}
+
+#endif // LL_LLMESHDECODER_H
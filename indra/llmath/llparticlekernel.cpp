@@ -0,0 +1,313 @@
+/**
+ * @file llparticlekernel.cpp
+ * @brief Structure of arrays particle state and its update kernel
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llmath.h"
+#include "llparticlekernel.h"
+#include "llvector4a.h"
+
+namespace
+{
+	const S32 MIN_CAPACITY = 16;
+
+	// Bytes of the block of a store of the given capacity
+	size_t block_size(S32 capacity)
+	{
+		return (size_t)capacity * (LLParticleStore::COMPONENT_COUNT * sizeof(F32) + sizeof(U32));
+	}
+
+	LL_FORCE_INLINE LLQuad select(const LLQuad& mask, const LLQuad& a, const LLQuad& b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	LL_FORCE_INLINE LLQuad has_flag(const __m128i& flags, U32 flag)
+	{
+		const __m128i bit = _mm_set1_epi32((S32)flag);
+		return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, bit), bit));
+	}
+
+	// start * (1 - frac) + end * frac, as LLViewerPartGroup always did it
+	LL_FORCE_INLINE LLQuad interpolate(const F32* start, const F32* end, const LLQuad& frac, const LLQuad& one_minus_frac)
+	{
+		return _mm_add_ps(_mm_mul_ps(_mm_load_ps(start), one_minus_frac), _mm_mul_ps(frac, _mm_load_ps(end)));
+	}
+
+	// llclamp(a, lo, hi), which favors lo when lo > hi
+	LL_FORCE_INLINE LLQuad clamp(const LLQuad& a, const LLQuad& lo, const LLQuad& hi)
+	{
+		return select(_mm_cmplt_ps(a, lo), lo, _mm_min_ps(a, hi));
+	}
+
+	LL_FORCE_INLINE F32 desired_size(F32 dx, F32 dy, F32 dz, F32 scale_x, F32 scale_y, F32 limit)
+	{
+		const F32 size = sqrtf(dx * dx + dy * dy + dz * dz) / 4.f;
+		return llclamp(size, sqrtf(scale_x * scale_x + scale_y * scale_y) * 0.5f, limit);
+	}
+}
+
+LLParticleStore::LLParticleStore()
+	: mData(nullptr),
+	mFlags(nullptr),
+	mSize(0),
+	mCapacity(0)
+{
+}
+
+LLParticleStore::~LLParticleStore()
+{
+	ll_aligned_free_16(mData);
+}
+
+void LLParticleStore::reserve(S32 capacity)
+{
+	capacity = (capacity + 3) & ~3;
+	if (capacity <= mCapacity)
+	{
+		return;
+	}
+
+	// Zeroed so that the lanes past the last particle hold no garbage floats
+	F32* data = (F32*)ll_aligned_malloc_16(block_size(capacity));
+	memset(data, 0, block_size(capacity));
+	U32* flags = (U32*)(data + COMPONENT_COUNT * capacity);
+	if (mData)
+	{
+		for (S32 i = 0; i < COMPONENT_COUNT; ++i)
+		{
+			memcpy(data + i * capacity, mData + i * mCapacity, mSize * sizeof(F32));
+		}
+		memcpy(flags, mFlags, mSize * sizeof(U32));
+		ll_aligned_free_16(mData);
+	}
+	mData = data;
+	mFlags = flags;
+	mCapacity = capacity;
+}
+
+S32 LLParticleStore::append()
+{
+	if (mSize == mCapacity)
+	{
+		reserve(llmax(mCapacity * 2, MIN_CAPACITY));
+	}
+
+	const S32 index = mSize++;
+	for (S32 i = 0; i < COMPONENT_COUNT; ++i)
+	{
+		mData[i * mCapacity + index] = 0.f;
+	}
+	mFlags[index] = 0;
+	return index;
+}
+
+void LLParticleStore::remove(S32 index)
+{
+	llassert(index >= 0 && index < mSize);
+	const S32 last = --mSize;
+	if (index != last)
+	{
+		for (S32 i = 0; i < COMPONENT_COUNT; ++i)
+		{
+			mData[i * mCapacity + index] = mData[i * mCapacity + last];
+		}
+		mFlags[index] = mFlags[last];
+	}
+}
+
+void LLParticleKernel::update(LLParticleStore& store, F32 dt, const Bounds& bounds, U8* results)
+{
+	typedef LLParticleStore S;
+
+	F32* pos[3] = { store.get(S::POS_X), store.get(S::POS_Y), store.get(S::POS_Z) };
+	F32* vel[3] = { store.get(S::VEL_X), store.get(S::VEL_Y), store.get(S::VEL_Z) };
+	const F32* accel[3] = { store.get(S::ACCEL_X), store.get(S::ACCEL_Y), store.get(S::ACCEL_Z) };
+	F32* age = store.get(S::AGE);
+	const F32* max_age = store.get(S::MAX_AGE);
+	F32* skip = store.get(S::SKIP_OFFSET);
+	const F32* start_color = store.get(S::START_RED);
+	const F32* end_color = store.get(S::END_RED);
+	F32* color = store.get(S::RED);
+	const F32* start_scale = store.get(S::START_SCALE_X);
+	const F32* end_scale = store.get(S::END_SCALE_X);
+	F32* scale = store.get(S::SCALE_X);
+	const F32* start_glow = store.get(S::START_GLOW);
+	const F32* end_glow = store.get(S::END_GLOW);
+	F32* glow = store.get(S::GLOW);
+	const U32* flags = store.getFlags();
+	// Components of a group are consecutive arrays of the same capacity
+	const S32 stride = (S32)(store.get(S::POS_Y) - store.get(S::POS_X));
+
+	const LLQuad zero = _mm_setzero_ps();
+	const LLQuad one = _mm_set1_ps(1.f);
+	const LLQuad half = _mm_set1_ps(0.5f);
+	const LLQuad quarter = _mm_set1_ps(0.25f);
+	const LLQuad dtv = _mm_set1_ps(dt);
+	const LLQuad min_size = _mm_set1_ps(bounds.mMinSize);
+	const LLQuad max_size = _mm_set1_ps(bounds.mMaxSize);
+	const LLQuad size_limit = _mm_set1_ps(bounds.mSizeLimit);
+
+	const S32 count = store.size();
+	for (S32 i = 0; i < count; i += 4)
+	{
+		const __m128i flag = _mm_load_si128((const __m128i*)(flags + i));
+
+		const LLQuad step = _mm_sub_ps(dtv, _mm_load_ps(skip + i));
+		_mm_store_ps(skip + i, zero);
+		const LLQuad cur = _mm_add_ps(_mm_load_ps(age + i), step);
+		const LLQuad frac = _mm_div_ps(cur, _mm_load_ps(max_age + i));
+		const LLQuad one_minus_frac = _mm_sub_ps(one, frac);
+
+		// Velocity interpolation
+		const LLQuad integrate = has_flag(flag, S::INTEGRATE);
+		const LLQuad half_step_sq = _mm_mul_ps(_mm_mul_ps(half, step), step);
+		LLQuad p[3];
+		for (S32 k = 0; k < 3; ++k)
+		{
+			const LLQuad a = _mm_load_ps(accel[k] + i);
+			const LLQuad v = _mm_load_ps(vel[k] + i);
+			p[k] = _mm_load_ps(pos[k] + i);
+			LLQuad np = _mm_add_ps(p[k], _mm_mul_ps(step, v));
+			np = _mm_add_ps(np, _mm_mul_ps(half_step_sq, a));
+			p[k] = select(integrate, np, p[k]);
+			_mm_store_ps(pos[k] + i, p[k]);
+			_mm_store_ps(vel[k] + i, select(integrate, _mm_add_ps(v, _mm_mul_ps(a, step)), v));
+		}
+
+		const LLQuad interp_color = has_flag(flag, S::INTERP_COLOR);
+		for (S32 k = 0; k < 4; ++k)
+		{
+			F32* c = color + k * stride + i;
+			_mm_store_ps(c, select(interp_color, interpolate(start_color + k * stride + i, end_color + k * stride + i, frac, one_minus_frac), _mm_load_ps(c)));
+		}
+
+		const LLQuad interp_scale = has_flag(flag, S::INTERP_SCALE);
+		LLQuad s[2];
+		for (S32 k = 0; k < 2; ++k)
+		{
+			F32* sc = scale + k * stride + i;
+			s[k] = select(interp_scale, interpolate(start_scale + k * stride + i, end_scale + k * stride + i, frac, one_minus_frac), _mm_load_ps(sc));
+			_mm_store_ps(sc, s[k]);
+		}
+
+		const LLQuad g0 = _mm_load_ps(start_glow + i);
+		_mm_store_ps(glow + i, _mm_add_ps(g0, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(end_glow + i), g0), frac)));
+		_mm_store_ps(age + i, cur);
+
+		// Kill or move to another group
+		const LLQuad expired = _mm_or_ps(_mm_cmpgt_ps(cur, _mm_load_ps(max_age + i)), has_flag(flag, S::KILLED));
+
+		LLQuad outside = zero;
+		LLQuad dist_sq = zero;
+		for (S32 k = 0; k < 3; ++k)
+		{
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(p[k], _mm_set1_ps(bounds.mMin[k])));
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(p[k], _mm_set1_ps(bounds.mMax[k])));
+			const LLQuad d = _mm_sub_ps(p[k], _mm_set1_ps(bounds.mCamera[k]));
+			dist_sq = _mm_add_ps(dist_sq, _mm_mul_ps(d, d));
+		}
+		const LLQuad scale_sq = _mm_add_ps(_mm_mul_ps(s[0], s[0]), _mm_mul_ps(s[1], s[1]));
+		const LLQuad desired = clamp(_mm_mul_ps(_mm_sqrt_ps(dist_sq), quarter),
+									 _mm_mul_ps(_mm_sqrt_ps(scale_sq), half), size_limit);
+		const LLQuad bad_size = _mm_or_ps(_mm_cmplt_ps(desired, min_size), _mm_cmpgt_ps(desired, max_size));
+		outside = _mm_or_ps(outside, _mm_and_ps(_mm_cmpgt_ps(desired, zero), bad_size));
+
+		const S32 expired_bits = _mm_movemask_ps(expired);
+		const S32 outside_bits = _mm_movemask_ps(outside) & ~expired_bits;
+		for (S32 k = 0; k < 4; ++k)
+		{
+			results[i + k] = (U8)(((expired_bits >> k) & 1) * EXPIRED | ((outside_bits >> k) & 1) * OUTSIDE);
+		}
+	}
+}
+
+void LLParticleKernel::updateScalar(LLParticleStore& store, F32 dt, const Bounds& bounds, U8* results)
+{
+	typedef LLParticleStore S;
+
+	F32* pos[3] = { store.get(S::POS_X), store.get(S::POS_Y), store.get(S::POS_Z) };
+	F32* vel[3] = { store.get(S::VEL_X), store.get(S::VEL_Y), store.get(S::VEL_Z) };
+	const F32* accel[3] = { store.get(S::ACCEL_X), store.get(S::ACCEL_Y), store.get(S::ACCEL_Z) };
+	F32* age = store.get(S::AGE);
+	const F32* max_age = store.get(S::MAX_AGE);
+	F32* skip = store.get(S::SKIP_OFFSET);
+	const S32 stride = (S32)(store.get(S::POS_Y) - store.get(S::POS_X));
+	const U32* flags = store.getFlags();
+
+	const S32 count = store.size();
+	for (S32 i = 0; i < count; ++i)
+	{
+		const F32 step = dt - skip[i];
+		skip[i] = 0.f;
+		const F32 cur = age[i] + step;
+		const F32 frac = cur / max_age[i];
+
+		if (flags[i] & S::INTEGRATE)
+		{
+			for (S32 k = 0; k < 3; ++k)
+			{
+				pos[k][i] += step * vel[k][i];
+				pos[k][i] += 0.5f * step * step * accel[k][i];
+				vel[k][i] += accel[k][i] * step;
+			}
+		}
+
+		if (flags[i] & S::INTERP_COLOR)
+		{
+			for (S32 k = 0; k < 4; ++k)
+			{
+				store.get(S::RED)[k * stride + i] = store.get(S::START_RED)[k * stride + i] * (1.f - frac)
+													+ frac * store.get(S::END_RED)[k * stride + i];
+			}
+		}
+
+		F32* scale_x = store.get(S::SCALE_X);
+		F32* scale_y = store.get(S::SCALE_Y);
+		if (flags[i] & S::INTERP_SCALE)
+		{
+			scale_x[i] = store.get(S::START_SCALE_X)[i] * (1.f - frac) + frac * store.get(S::END_SCALE_X)[i];
+			scale_y[i] = store.get(S::START_SCALE_Y)[i] * (1.f - frac) + frac * store.get(S::END_SCALE_Y)[i];
+		}
+
+		store.get(S::GLOW)[i] = lerp(store.get(S::START_GLOW)[i], store.get(S::END_GLOW)[i], frac);
+		age[i] = cur;
+
+		if (cur > max_age[i] || (flags[i] & S::KILLED))
+		{
+			results[i] = EXPIRED;
+			continue;
+		}
+
+		bool outside = false;
+		for (S32 k = 0; k < 3; ++k)
+		{
+			outside = outside || pos[k][i] < bounds.mMin[k] || pos[k][i] > bounds.mMax[k];
+		}
+		const F32 desired = desired_size(pos[0][i] - bounds.mCamera[0], pos[1][i] - bounds.mCamera[1], pos[2][i] - bounds.mCamera[2],
+										 scale_x[i], scale_y[i], bounds.mSizeLimit);
+		outside = outside || (desired > 0.f && (desired < bounds.mMinSize || desired > bounds.mMaxSize));
+		results[i] = outside ? OUTSIDE : 0;
+	}
+}
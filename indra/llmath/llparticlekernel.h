@@ -0,0 +1,125 @@
+/**
+ * @file llparticlekernel.h
+ * @brief Structure of arrays particle state and its update kernel
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPARTICLEKERNEL_H
+#define LL_LLPARTICLEKERNEL_H
+
+// Simulated state of the particles of a particle group, one array per
+// component so that LLParticleKernel::update() moves four particles at a
+// time. The arrays share one 16 byte aligned block, padded to a multiple of
+// four particles, that only grows.
+class LLParticleStore
+{
+public:
+	enum EComponent
+	{
+		POS_X, POS_Y, POS_Z,
+		VEL_X, VEL_Y, VEL_Z,
+		ACCEL_X, ACCEL_Y, ACCEL_Z,
+		AGE,				// time since the particle was emitted
+		MAX_AGE,
+		SKIP_OFFSET,		// part of the next time step the particle was not there for
+		START_RED, START_GREEN, START_BLUE, START_ALPHA,
+		END_RED, END_GREEN, END_BLUE, END_ALPHA,
+		RED, GREEN, BLUE, ALPHA,
+		START_SCALE_X, START_SCALE_Y,
+		END_SCALE_X, END_SCALE_Y,
+		SCALE_X, SCALE_Y,
+		START_GLOW, END_GLOW,
+		GLOW,
+		COMPONENT_COUNT
+	};
+
+	// Flags of each particle. Bits from FIRST_USER_FLAG up are left to the caller.
+	enum
+	{
+		INTEGRATE		= 0x01,		// moved by its velocity and acceleration
+		INTERP_COLOR	= 0x02,
+		INTERP_SCALE	= 0x04,
+		KILLED			= 0x08,		// expires on the next update
+		FIRST_USER_FLAG	= 0x100
+	};
+
+	LLParticleStore();
+	~LLParticleStore();
+
+	S32 size() const	{ return mSize; }
+	bool empty() const	{ return mSize == 0; }
+
+	// Index of a new last particle, with all its components and flags zero
+	S32 append();
+	// Moves the last particle to index, like vector_replace_with_last()
+	void remove(S32 index);
+	void clear()		{ mSize = 0; }
+
+	F32* get(EComponent component)				{ return mData + component * mCapacity; }
+	const F32* get(EComponent component) const	{ return mData + component * mCapacity; }
+	U32* getFlags()								{ return mFlags; }
+	const U32* getFlags() const					{ return mFlags; }
+
+private:
+	LLParticleStore(const LLParticleStore&);
+	LLParticleStore& operator=(const LLParticleStore&);
+
+	void reserve(S32 capacity);
+
+	F32* mData;			// COMPONENT_COUNT arrays of mCapacity, then mCapacity flags
+	U32* mFlags;
+	S32 mSize;
+	S32 mCapacity;
+};
+
+namespace LLParticleKernel
+{
+	// Where the particles of a group belong, see LLViewerPartGroup::posInGroup()
+	struct Bounds
+	{
+		F32 mMin[3];
+		F32 mMax[3];
+		F32 mCamera[3];		// the desired size grows with the distance to it
+		F32 mMinSize;		// range of desired sizes of the group
+		F32 mMaxSize;
+		F32 mSizeLimit;		// desired sizes are clamped to it
+	};
+
+	// What update() found about each particle
+	enum
+	{
+		EXPIRED = 0x1,		// past its max age, or killed
+		OUTSIDE = 0x2		// alive, but belongs to another group
+	};
+
+	// Advances every particle by dt less its SKIP_OFFSET, which is cleared:
+	// position and velocity of those flagged INTEGRATE, color and scale
+	// interpolation of those flagged for it, glow and age. Then sets results
+	// for each, room for size() rounded up to four is needed.
+	void update(LLParticleStore& store, F32 dt, const Bounds& bounds, U8* results);
+
+	// Same as update(), one particle at a time, for tests and benchmarks
+	void updateScalar(LLParticleStore& store, F32 dt, const Bounds& bounds, U8* results);
+}
+
+#endif // LL_LLPARTICLEKERNEL_H
@@ -0,0 +1,190 @@
+/**
+ * @file llskinningkernel.cpp
+ * @brief Batched CPU skinning of rigged mesh vertices
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llmath.h"
+#include "llskinningkernel.h"
+#include "llmatrix4a.h"
+
+namespace
+{
+	// Joint indices (clamped) and normalized weights of a vertex
+	LL_FORCE_INLINE LLQuad decode_weights(const LLVector4a& weights, const __m128i& max_joint, S32* idx)
+	{
+		__m128i joint = _mm_cvttps_epi32(weights);
+		LLQuad weight = _mm_sub_ps(weights, _mm_cvtepi32_ps(joint));
+		joint = _mm_min_epi16(joint, max_joint);
+		joint = _mm_max_epi16(joint, _mm_setzero_si128());
+		_mm_store_si128((__m128i*)idx, joint);
+
+		LLQuad sum = _mm_add_ps(weight, _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		if (_mm_movemask_ps(_mm_cmple_ps(sum, LLVector4a::getEpsilon())))
+		{
+			return _mm_set_ss(1.f);
+		}
+		return _mm_div_ps(weight, sum);
+	}
+
+	LL_FORCE_INLINE LLQuad splat(const LLQuad& v, const S32 i)
+	{
+		switch (i)
+		{
+		case 0:		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+		case 1:		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+		case 2:		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+		default:	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+	}
+
+#if defined(AL_AVX)
+	LL_FORCE_INLINE __m256 splat256(const LLQuad& v, const S32 i)
+	{
+		const LLQuad s = splat(v, i);
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(s), s, 1);
+	}
+
+	LL_FORCE_INLINE __m256 mul_add(const __m256 a, const __m256 b, const __m256 c)
+	{
+#if defined(AL_AVX2)
+		return _mm256_fmadd_ps(a, b, c);
+#else
+		return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+	}
+
+	// Weighted sum of four joint matrices, two columns at a time
+	LL_FORCE_INLINE void blend(const LLMatrix4a* palette, const S32* idx, const LLQuad& weight, LLQuad* cols)
+	{
+		const F32* m0 = palette[idx[0]].getF32ptr();
+		const F32* m1 = palette[idx[1]].getF32ptr();
+		const F32* m2 = palette[idx[2]].getF32ptr();
+		const F32* m3 = palette[idx[3]].getF32ptr();
+
+		const __m256 w0 = splat256(weight, 0);
+		__m256 c01 = _mm256_mul_ps(_mm256_loadu_ps(m0), w0);
+		__m256 c23 = _mm256_mul_ps(_mm256_loadu_ps(m0 + 8), w0);
+
+		const __m256 w1 = splat256(weight, 1);
+		c01 = mul_add(_mm256_loadu_ps(m1), w1, c01);
+		c23 = mul_add(_mm256_loadu_ps(m1 + 8), w1, c23);
+
+		const __m256 w2 = splat256(weight, 2);
+		c01 = mul_add(_mm256_loadu_ps(m2), w2, c01);
+		c23 = mul_add(_mm256_loadu_ps(m2 + 8), w2, c23);
+
+		const __m256 w3 = splat256(weight, 3);
+		c01 = mul_add(_mm256_loadu_ps(m3), w3, c01);
+		c23 = mul_add(_mm256_loadu_ps(m3 + 8), w3, c23);
+
+		cols[0] = _mm256_castps256_ps128(c01);
+		cols[1] = _mm256_extractf128_ps(c01, 1);
+		cols[2] = _mm256_castps256_ps128(c23);
+		cols[3] = _mm256_extractf128_ps(c23, 1);
+	}
+#else
+	LL_FORCE_INLINE void blend(const LLMatrix4a* palette, const S32* idx, const LLQuad& weight, LLQuad* cols)
+	{
+		const LLQuad w0 = splat(weight, 0);
+		const LLQuad w1 = splat(weight, 1);
+		const LLQuad w2 = splat(weight, 2);
+		const LLQuad w3 = splat(weight, 3);
+
+		const F32* m0 = palette[idx[0]].getF32ptr();
+		const F32* m1 = palette[idx[1]].getF32ptr();
+		const F32* m2 = palette[idx[2]].getF32ptr();
+		const F32* m3 = palette[idx[3]].getF32ptr();
+
+		for (U32 i = 0; i < 4; ++i)
+		{
+			LLQuad col = _mm_mul_ps(_mm_load_ps(m0 + i * 4), w0);
+			col = _mm_add_ps(col, _mm_mul_ps(_mm_load_ps(m1 + i * 4), w1));
+			col = _mm_add_ps(col, _mm_mul_ps(_mm_load_ps(m2 + i * 4), w2));
+			cols[i] = _mm_add_ps(col, _mm_mul_ps(_mm_load_ps(m3 + i * 4), w3));
+		}
+	}
+#endif
+}
+
+const char* LLSkinningKernel::getInstructionSet()
+{
+#if defined(AL_AVX2)
+	return "AVX2";
+#elif defined(AL_AVX)
+	return "AVX";
+#else
+	return "SSE2";
+#endif
+}
+
+void LLSkinningKernel::skin(const LLMatrix4a* palette, S32 joint_count,
+							const LLVector4a* weights, const LLVector4a* positions, LLVector4a* out_positions,
+							const LLVector4a* normals, LLVector4a* out_normals,
+							S32 count, LLVector4a* extents)
+{
+	if (count <= 0 || joint_count <= 0)
+	{
+		return;
+	}
+
+	const __m128i max_joint = _mm_set1_epi32(joint_count - 1);
+	LLQuad min = _mm_set1_ps(F32_MAX);
+	LLQuad max = _mm_set1_ps(-F32_MAX);
+	const bool skin_normals = normals && out_normals;
+
+	LL_ALIGN_16(S32 idx[4]);
+	LLQuad cols[4];
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLQuad weight = decode_weights(weights[i], max_joint, idx);
+		blend(palette, idx, weight, cols);
+
+		const LLQuad v = positions[i];
+		LLQuad p = _mm_add_ps(_mm_mul_ps(cols[0], splat(v, 0)), cols[3]);
+		p = _mm_add_ps(p, _mm_mul_ps(cols[1], splat(v, 1)));
+		p = _mm_add_ps(p, _mm_mul_ps(cols[2], splat(v, 2)));
+		out_positions[i] = p;
+
+		min = _mm_min_ps(min, p);
+		max = _mm_max_ps(max, p);
+
+		if (skin_normals)
+		{
+			const LLQuad n = normals[i];
+			LLQuad r = _mm_mul_ps(cols[0], splat(n, 0));
+			r = _mm_add_ps(r, _mm_mul_ps(cols[1], splat(n, 1)));
+			r = _mm_add_ps(r, _mm_mul_ps(cols[2], splat(n, 2)));
+			LLVector4a& out = out_normals[i];
+			out = r;
+			out.normalize3fast();
+		}
+	}
+
+	if (extents)
+	{
+		extents[0] = min;
+		extents[1] = max;
+	}
+}
@@ -0,0 +1,55 @@
+/**
+ * @file llskinningkernel.h
+ * @brief Batched CPU skinning of rigged mesh vertices
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKINNINGKERNEL_H
+#define LL_LLSKINNINGKERNEL_H
+
+class LLMatrix4a;
+class LLVector4a;
+
+// Skins whole vertex streams at once, instead of blending a matrix for each
+// vertex through LLSkinningUtil::getPerVertexSkinMatrix() and transforming
+// it separately. The instruction set is chosen when building (AL_AVX2, AL_AVX
+// or plain SSE2), like the rest of the AL_AVX code.
+namespace LLSkinningKernel
+{
+	// Instruction set the kernel was built for, for logs and benchmarks
+	const char* getInstructionSet();
+
+	// Skins count vertices with up to four joints each. Weights use the volume
+	// face encoding (joint index in the integer part, weight in the fraction),
+	// joint indices are clamped to joint_count, and vertices whose weights add
+	// up to nothing follow their first joint. palette holds the joint matrices
+	// with the bind shape matrix already applied.
+	// normals and out_normals may be null, out_normals are normalized.
+	// extents, if not null, receives the min and max of the skinned positions.
+	void skin(const LLMatrix4a* palette, S32 joint_count,
+			  const LLVector4a* weights, const LLVector4a* positions, LLVector4a* out_positions,
+			  const LLVector4a* normals, LLVector4a* out_normals,
+			  S32 count, LLVector4a* extents);
+}
+
+#endif // LL_LLSKINNINGKERNEL_H
@@ -45,6 +45,7 @@
 #include "lloctree.h"
 #include "llvolume.h"
 #include "llvolumeoctree.h"
+#include "llmeshdecoder.h"
 #include "llstl.h"
 #include "llsdserialize.h"
 #include "llvector4a.h"
@@ -678,7 +679,8 @@ LLProfile::Face* LLProfile::addHole(const LLProfileParams& params, BOOL flat, F3
 
 	Face *face = addFace(mTotalOut, mTotal-mTotalOut,0,LL_FACE_INNER_SIDE, flat);
 
-	static LLAlignedArray<LLVector4a,64> pt;
+	// scratch, volumes are also generated on the job system
+	static thread_local LLAlignedArray<LLVector4a,64> pt;
 	pt.resize(mTotal) ;
 
 	for (S32 i=mTotalOut;i<mTotal;i++)
@@ -2024,9 +2026,10 @@ void LLPathParams::copyParams(const LLPathParams &params)
 	setSkew(params.getSkew());
 }
 
-S32 LLVolume::sNumMeshPoints = 0;
+std::atomic<S32> LLVolume::sNumMeshPoints(0);
 
-LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
+LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique,
+				   const BOOL defer_faces)
 	: mParams(params)
 {
 	mUnique = is_unique;
@@ -2035,6 +2038,7 @@ LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL ge
 	mSculptLevel = -2;
 	mSurfaceArea = 1.f; //only calculated for sculpts, defaults to 1 for all other prims
 	mIsMeshAssetLoaded = FALSE;
+	mGenerating = false;
 	mLODScaleBias.setVec(1,1,1);
 	mHullPoints = nullptr;
 	mHullIndices = nullptr;
@@ -2056,7 +2060,8 @@ LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL ge
 
 	generate();
 	
-	if ((mParams.getSculptID().isNull() && mParams.getSculptType() == LL_SCULPT_TYPE_NONE) || mParams.getSculptType() == LL_SCULPT_TYPE_MESH)
+	if (!defer_faces &&
+		((mParams.getSculptID().isNull() && mParams.getSculptType() == LL_SCULPT_TYPE_NONE) || mParams.getSculptType() == LL_SCULPT_TYPE_MESH))
 	{
 		createVolumeFaces();
 	}
@@ -2355,12 +2360,62 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
 	return retval;
 }
 
+// Per thread scratch buffers of unpackVolumeFaces() are released past this size
+static const size_t MAX_SCRATCH_SIZE = 16 * 1024 * 1024;
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
 	//input stream is now pointing at a zlib compressed block of LLSD
-	//decompress block
+	//read it into a scratch buffer kept by this thread
+	static thread_local std::vector<U8> in;
+	if (size <= 0)
+	{
+		return false;
+	}
+
+	try
+	{
+		if (in.size() < (size_t)size)
+		{
+			in.resize(size);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		LL_WARNS() << "Failed to allocate " << size << " bytes for LoD block" << LL_ENDL;
+		return false;
+	}
+	is.read((char*)in.data(), size);
+
+	const bool success = unpackVolumeFaces(in.data(), size);
+
+	// Don't hang on to the scratch space of unusually large blocks
+	if (in.capacity() > MAX_SCRATCH_SIZE)
+	{
+		std::vector<U8>().swap(in);
+	}
+	return success;
+}
+
+bool LLVolume::unpackVolumeFaces(const U8* data, S32 size)
+{
+	//decompress block into a scratch buffer kept by this thread, and read the
+	//faces straight out of it when possible instead of building LLSD
+	static thread_local std::vector<U8> block;
+	U32 block_size = 0;
 	LLSD mdl;
-	U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, is, size);
+	LLMeshDecoder::face_list_t faces;
+
+	U32 uzip_result = LLUZipHelper::unzip_block(block, block_size, data, size);
+	if (uzip_result == LLUZipHelper::ZR_OK && !LLMeshDecoder::parseFaces(block.data(), block_size, faces))
+	{
+		uzip_result = LLUZipHelper::parse_llsd_block(mdl, block.data(), block_size);
+		if (uzip_result == LLUZipHelper::ZR_OK)
+		{
+			LLMeshDecoder::getFaces(mdl, faces);
+		}
+	}
+
 	if (uzip_result != LLUZipHelper::ZR_OK)
 	{
 		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
@@ -2368,7 +2423,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 	}
 	
 	{
-		U32 face_count = mdl.size();
+		U32 face_count = faces.size();
 
 		if (face_count == 0)
 		{ //no faces unpacked, treat as failed decode
@@ -2381,8 +2436,9 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 		for (U32 i = 0; i < face_count; ++i)
 		{
 			LLVolumeFace& face = mVolumeFaces[i];
+			const LLMeshDecoder::Face& src = faces[i];
 
-			if (mdl[i].has("NoGeometry"))
+			if (src.mNoGeometry)
 			{ //face has no geometry, continue
 				face.resizeIndices(3);
 				face.resizeVertices(1);
@@ -2393,46 +2449,27 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 				continue;
 			}
 
-			LLSD::Binary pos = mdl[i]["Position"];
-			LLSD::Binary norm = mdl[i]["Normal"];
-			LLSD::Binary tc = mdl[i]["TexCoord0"];
-			LLSD::Binary idx = mdl[i]["TriangleList"];
-
-			
-
 			//copy out indices
-			face.resizeIndices(idx.size()/2);
+			face.resizeIndices(src.mTriangleListSize/2);
 			
-			if (idx.empty() || face.mNumIndices < 3)
+			if (!src.mTriangleListSize || face.mNumIndices < 3)
 			{ //why is there an empty index list?
 				LL_WARNS() << "Empty face present! Face index: " << i << " Total: " << face_count << LL_ENDL;
 				continue;
 			}
 
-			U16* indices = (U16*) &(idx[0]);
-			U32 count = idx.size()/2;
-			for (U32 j = 0; j < count; ++j)
-			{
-				face.mIndices[j] = indices[j];
-			}
+			memcpy(face.mIndices, src.mTriangleList, face.mNumIndices * sizeof(U16));
 
 			//copy out vertices
-			U32 num_verts = pos.size()/(3*2);
+			U32 num_verts = src.mPositionSize/(3*2);
 			face.resizeVertices(num_verts);
 
-			LLVector3 minp;
-			LLVector3 maxp;
-			LLVector2 min_tc; 
-			LLVector2 max_tc; 
-		
-			minp.setValue(mdl[i]["PositionDomain"]["Min"]);
-			maxp.setValue(mdl[i]["PositionDomain"]["Max"]);
 			LLVector4a min_pos, max_pos;
-			min_pos.load3(minp.mV);
-			max_pos.load3(maxp.mV);
+			min_pos.load3(src.mPositionMin.mV);
+			max_pos.load3(src.mPositionMax.mV);
 
-			min_tc.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
-			max_tc.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
+			const LLVector2& min_tc = src.mTexCoordMin;
+			const LLVector2& max_tc = src.mTexCoordMax;
 
 			LLVector4a pos_range;
 			pos_range.setSub(max_pos, min_pos);
@@ -2442,84 +2479,31 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 			tc_range.set(tc_range2[0], tc_range2[1], tc_range2[0], tc_range2[1]);
 			LLVector4a min_tc4(min_tc[0], min_tc[1], min_tc[0], min_tc[1]);
 
-			LLVector4a* pos_out = face.mPositions;
-			LLVector4a* norm_out = face.mNormals;
-			LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
+			LLMeshDecoder::dequantizePositions(src.mPosition, num_verts, min_pos, pos_range, face.mPositions);
 
+			// Short normal or texture coordinate streams leave the rest of the vertices zeroed
 			{
-				U16* v = (U16*) &(pos[0]);
-				for (U32 j = 0; j < num_verts; ++j)
-				{
-					pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
-					pos_out->div(65535.f);
-					pos_out->mul(pos_range);
-					pos_out->add(min_pos);
-					pos_out++;
-					v += 3;
-				}
-
+				const U32 count = llmin(num_verts, src.mNormalSize/(3*2));
+				LLMeshDecoder::dequantizeNormals(src.mNormal, count, face.mNormals);
+				memset(face.mNormals + count, 0, sizeof(LLVector4a)*(num_verts - count));
 			}
 
 			{
-				if (!norm.empty())
-				{
-					U16* n = (U16*) &(norm[0]);
-					for (U32 j = 0; j < num_verts; ++j)
-					{
-						norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
-						norm_out->div(65535.f);
-						norm_out->mul(2.f);
-						norm_out->sub(1.f);
-						norm_out++;
-						n += 3;
-					}
-				}
-				else
-				{
-					memset(norm_out, 0, sizeof(LLVector4a)*num_verts);
-				}
-			}
-
-			{
-				if (!tc.empty())
-				{
-					U16* t = (U16*) &(tc[0]);
-					for (U32 j = 0; j < num_verts; j+=2)
-					{
-						if (j < num_verts-1)
-						{
-							tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
-						}
-						else
-						{
-							tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
-						}
-
-						t += 4;
-
-						tc_out->div(65535.f);
-						tc_out->mul(tc_range);
-						tc_out->add(min_tc4);
-
-						tc_out++;
-					}
-				}
-				else
-				{
-					memset(tc_out, 0, sizeof(LLVector2)*num_verts);
-				}
+				const U32 count = llmin(num_verts, src.mTexCoordSize/(2*2));
+				LLMeshDecoder::dequantizeTexCoords(src.mTexCoord, count, min_tc4, tc_range, face.mTexCoords);
+				memset(face.mTexCoords + count, 0, sizeof(LLVector2)*(num_verts - count));
 			}
 
-			if (mdl[i].has("Weights"))
+			if (src.mHasWeights)
 			{
 				face.allocateWeights(num_verts);
 
-				LLSD::Binary weights = mdl[i]["Weights"];
+				const U8* weights = src.mWeights;
 
 				U32 idx = 0;
 
 				U32 cur_vertex = 0;
-				while (idx < weights.size() && cur_vertex < num_verts)
+				while (idx < src.mWeightsSize && cur_vertex < num_verts)
 				{
 					const U8 END_INFLUENCES = 0xFF;
 					U8 joint = weights[idx++];
@@ -2529,7 +2513,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
                     U32 joints[4] = {0,0,0,0};
 					LLVector4 joints_with_weights(0,0,0,0);
 
-					while (joint != END_INFLUENCES && idx < weights.size())
+					while (joint != END_INFLUENCES && idx < src.mWeightsSize)
 					{
 						U16 influence = weights[idx++];
 						influence |= ((U16) weights[idx++] << 8);
@@ -2566,7 +2550,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 					cur_vertex++;
 				}
 
-				if (cur_vertex != num_verts || idx != weights.size())
+				if (cur_vertex != num_verts || idx != src.mWeightsSize)
 				{
 					LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
 				}
@@ -2672,6 +2656,14 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 		}
 	}
 
+	// Don't hang on to the scratch space of unusually large blocks
+	if (block.capacity() > MAX_SCRATCH_SIZE)
+	{
+		faces.clear();
+		mdl.clear();
+		std::vector<U8>().swap(block);
+	}
+
 	if (!cacheOptimize())
 	{
 		// Out of memory?
@@ -5497,6 +5489,18 @@ void LLVolumeFace::createOctree(F32 scaler, const LLVector4a& center, const LLVe
 	}
 }
 
+void LLVolumeFace::refitOctree(F32 scaler)
+{
+	if (!mOctree)
+	{
+		createOctree(scaler);
+		return;
+	}
+
+	LLVolumeOctreeRebound rebound(this);
+	rebound.traverse(mOctree);
+}
+
 
 void LLVolumeFace::swapData(LLVolumeFace& rhs)
 {
@@ -6680,7 +6684,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 
 	LLVector4a* norm = mNormals;
 
-	static LLAlignedArray<LLVector4a, 64> triangle_normals;
+	static thread_local LLAlignedArray<LLVector4a, 64> triangle_normals;
 	triangle_normals.resize(count);
 	LLVector4a* output = triangle_normals.mArray;
 	LLVector4a* end_output = output+count;
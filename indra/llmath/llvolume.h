@@ -27,6 +27,7 @@
 #ifndef LL_LLVOLUME_H
 #define LL_LLVOLUME_H
 
+#include <atomic>
 #include <iostream>
 
 class LLProfileParams;
@@ -907,6 +908,9 @@ public:
 	bool cacheOptimize();
 
 	void createOctree(F32 scaler = 0.25f, const LLVector4a& center = LLVector4a(0,0,0), const LLVector4a& size = LLVector4a(0.5f,0.5f,0.5f));
+	// Recomputes the node bounds of an existing octree after the positions moved
+	// (rigged meshes), keeping the triangle layout. Creates the octree if missing.
+	void refitOctree(F32 scaler = 0.25f);
 
 	enum
 	{
@@ -994,7 +998,9 @@ public:
 		S32 mCountT;
 	};
 
-	LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face = FALSE, const BOOL is_unique = FALSE);
+	// defer_faces leaves the volume faces out, for volumes whose faces are generated elsewhere
+	LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face = FALSE, const BOOL is_unique = FALSE,
+			 const BOOL defer_faces = FALSE);
 	
 	U8 getProfileType()	const								{ return mParams.getProfileParams().getCurveType(); }
 	U8 getPathType() const									{ return mParams.getPathParams().getCurveType(); }
@@ -1050,7 +1056,8 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	// Changed by volumes generated on the job system
+	static std::atomic<S32> sNumMeshPoints;
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -1083,16 +1090,23 @@ protected:
 	void createVolumeFaces();
 public:
 	bool unpackVolumeFaces(std::istream& is, S32 size);
+	// data is the zlib compressed LOD block
+	bool unpackVolumeFaces(const U8* data, S32 size);
 
 	void setMeshAssetLoaded(BOOL loaded);
 	BOOL isMeshAssetLoaded();
 
+	// True while LLVolumeLODGroup generates the faces of this volume on the job system.
+	// Until then the faces are empty or borrowed from another LOD of the same shape.
+	bool isGenerating() const { return mGenerating; }
+
  protected:
 	BOOL mUnique;
 	F32 mDetail;
 	S32 mSculptLevel;
 	F32 mSurfaceArea; //unscaled surface area
 	BOOL mIsMeshAssetLoaded;
+	bool mGenerating;
 	
 	const LLVolumeParams mParams;
 	LLPath *mPathp;
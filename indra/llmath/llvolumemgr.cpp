@@ -27,6 +27,9 @@
 
 #include "llvolumemgr.h"
 #include "llvolume.h"
+#include "lljobsystem.h"
+#include "lltimer.h"
+#include "lltrace.h"
 
 
 const F32 BASE_THRESHOLD = 0.03f;
@@ -40,11 +43,26 @@ F32 LLVolumeLODGroup::mDetailThresholds[NUM_LODS] = {BASE_THRESHOLD,
 //static
 F32 LLVolumeLODGroup::mDetailScales[NUM_LODS] = {1.f, 1.5f, 2.5f, 4.f};
 
+static LLJobType sGenerateVolumeJobType("generate_volume");
+
+static LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > VOLUME_CACHE_HIT_RATE("volume_cache_hits");
+static LLTrace::EventStatHandle<F64Seconds> VOLUME_GENERATE_TIME("volume_generate_time");
+
+// Faces of a placeholder volume being generated on the job system
+struct LLVolumeLODGroup::GenerateRequest
+{
+	LLPointer<LLVolume> mVolume;		// placeholder handed out meanwhile
+	LLPointer<LLVolume> mGenerated;		// only touched by the job until it is done
+	LLJobSystem::job_ptr_t mJob;
+	generated_callback_t mCallback;
+};
+
 
 //============================================================================
 
 LLVolumeMgr::LLVolumeMgr()
-:	mDataMutex(nullptr)
+:	mDataMutex(nullptr),
+	mAsyncGeneration(false)
 {
 	// the LLMutex magic interferes with easy unit testing,
 	// so you now must manually call useMutex() to use it
@@ -87,7 +105,7 @@ BOOL LLVolumeMgr::cleanup()
 // Note however that LLVolumeLODGroup that contains the volume
 //  also holds a LLPointer so the volume will only go away after
 //  anything holding the volume and the LODGroup are destroyed
-LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32 detail)
+LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32 detail, bool allow_async)
 {
 	LLVolumeLODGroup* volgroupp;
 	if (mDataMutex)
@@ -107,7 +125,13 @@ LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32
 	{
 		mDataMutex->unlock();
 	}
-	return volgroupp->refLOD(detail);
+	return volgroupp->refLOD(detail, allow_async && mAsyncGeneration ? &mGeneratedCallback : nullptr);
+}
+
+void LLVolumeMgr::setAsyncGeneration(bool enable, const LLVolumeLODGroup::generated_callback_t& callback)
+{
+	mAsyncGeneration = enable;
+	mGeneratedCallback = callback;
 }
 
 // virtual
@@ -274,6 +298,7 @@ bool LLVolumeLODGroup::cleanupRefs()
 				LL_WARNS() << " LOD " << i << " refs = " << mLODRefs[i] << LL_ENDL;
 				mLODRefs[i] = 0;
 				mVolumeLODs[i] = nullptr;
+				mGenerateRequests[i] = nullptr;
 			}
 		}
 		LL_WARNS() << *getVolumeParams() << LL_ENDL;
@@ -282,7 +307,7 @@ bool LLVolumeLODGroup::cleanupRefs()
 	return res;
 }
 
-LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
+LLVolume* LLVolumeLODGroup::refLOD(const S32 detail, const generated_callback_t* async_callback)
 {
 	llassert(detail >=0 && detail < NUM_LODS);
 	mAccessCount[detail]++;
@@ -290,12 +315,117 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	mRefs++;
 	if (mVolumeLODs[detail].isNull())
 	{
-		mVolumeLODs[detail] = new LLVolume(mVolumeParams, mDetailScales[detail]);
+		record(VOLUME_CACHE_HIT_RATE, LLUnits::Ratio::fromValue(0));
+		if (async_callback && canGenerateAsync(mVolumeParams) && LLJobSystem::instanceExists())
+		{
+			generateAsync(detail, *async_callback);
+		}
+		else
+		{
+			LLTimer timer;
+			mVolumeLODs[detail] = new LLVolume(mVolumeParams, mDetailScales[detail]);
+			record(VOLUME_GENERATE_TIME, F64Seconds(timer.getElapsedTimeF64()));
+		}
+	}
+	else
+	{
+		record(VOLUME_CACHE_HIT_RATE, LLUnits::Ratio::fromValue(1));
+		if (mGenerateRequests[detail])
+		{
+			if (!async_callback && mVolumeLODs[detail]->isGenerating())
+			{ // caller needs the faces now
+				LLJobSystem::getInstance()->wait(mGenerateRequests[detail]->mJob);
+				finishGenerate(mGenerateRequests[detail]);
+			}
+			if (!mVolumeLODs[detail]->isGenerating())
+			{
+				mGenerateRequests[detail] = nullptr;
+			}
+		}
 	}
 	mLODRefs[detail]++;
 	return mVolumeLODs[detail];
 }
 
+// static
+bool LLVolumeLODGroup::canGenerateAsync(const LLVolumeParams& params)
+{
+	// Sculpties need their sculpt map and meshes their asset, only plain prims come
+	// from the parameters alone. Flexible paths belong to a single object.
+	return params.getSculptID().isNull() && params.getSculptType() == LL_SCULPT_TYPE_NONE &&
+		params.getPathParams().getCurveType() != LL_PCODE_PATH_FLEXIBLE;
+}
+
+void LLVolumeLODGroup::generateAsync(const S32 detail, const generated_callback_t& callback)
+{
+	// Path and profile are cheap and give the face count, the faces are the expensive part
+	LLVolume* placeholder = new LLVolume(mVolumeParams, mDetailScales[detail], FALSE, FALSE, TRUE);
+	mVolumeLODs[detail] = placeholder;
+
+	// Show the closest LOD already generated until the faces are in, lower ones first
+	for (S32 offset = 1; offset < NUM_LODS; ++offset)
+	{
+		const LLVolume* closest = nullptr;
+		if (detail - offset >= 0 && mVolumeLODs[detail - offset].notNull() && !mVolumeLODs[detail - offset]->isGenerating())
+		{
+			closest = mVolumeLODs[detail - offset];
+		}
+		else if (detail + offset < NUM_LODS && mVolumeLODs[detail + offset].notNull() && !mVolumeLODs[detail + offset]->isGenerating())
+		{
+			closest = mVolumeLODs[detail + offset];
+		}
+		if (closest)
+		{
+			placeholder->mVolumeFaces = closest->mVolumeFaces;
+			break;
+		}
+	}
+
+	request_ptr_t request = std::make_shared<GenerateRequest>();
+	request->mVolume = placeholder;
+	request->mCallback = callback;
+	const LLVolumeParams params = mVolumeParams;
+	const F32 scale = mDetailScales[detail];
+	request->mJob = LLJobSystem::getInstance()->submit(sGenerateVolumeJobType,
+		[request, params, scale]()
+		{
+			LLTimer timer;
+			request->mGenerated = new LLVolume(params, scale);
+			record(VOLUME_GENERATE_TIME, F64Seconds(timer.getElapsedTimeF64()));
+		},
+		LLJobSystem::PRIORITY_NORMAL,
+		[request]() { finishGenerate(request); });
+
+	if (request->mJob.isNull())
+	{ // job system is shutting down
+		placeholder->mVolumeFaces.clear();
+		placeholder->createVolumeFaces();
+		return;
+	}
+	placeholder->mGenerating = true;
+	mGenerateRequests[detail] = request;
+}
+
+// static
+void LLVolumeLODGroup::finishGenerate(const request_ptr_t& request)
+{
+	LLVolume* volume = request->mVolume;
+	if (!volume->isGenerating())
+	{ // already waited for
+		return;
+	}
+
+	volume->mVolumeFaces.swap(request->mGenerated->mVolumeFaces);
+	volume->mGenerating = false;
+	request->mGenerated = nullptr;
+	request->mJob = nullptr;
+
+	if (request->mCallback)
+	{
+		request->mCallback(volume);
+	}
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
@@ -27,6 +27,9 @@
 #ifndef LL_LLVOLUMEMGR_H
 #define LL_LLVOLUMEMGR_H
 
+#include <functional>
+#include <memory>
+
 #include "llvolume.h"
 #include "llpointer.h"
 #include "llthread.h"
@@ -44,6 +47,9 @@ public:
 		NUM_LODS = 4
 	};
 
+	// Called on the main thread with a volume whose faces were generated on the job system
+	typedef std::function<void(LLVolume*)> generated_callback_t;
+
 	LLVolumeLODGroup(const LLVolumeParams &params);
 	~LLVolumeLODGroup();
 	bool cleanupRefs();
@@ -53,7 +59,10 @@ public:
 	static F32 getVolumeScaleFromDetail(const S32 detail);
 	static S32 getVolumeDetailFromScale(F32 scale);
 
-	LLVolume* refLOD(const S32 detail);
+	// With an async_callback, the faces of a missing prim LOD are generated on the job
+	// system and a placeholder is returned meanwhile, see LLVolume::isGenerating().
+	// Without one, a LOD still being generated is waited for.
+	LLVolume* refLOD(const S32 detail, const generated_callback_t* async_callback = nullptr);
 	BOOL derefLOD(LLVolume *volumep);
 	S32 getNumRefs() const { return mRefs; }
 	
@@ -63,6 +72,13 @@ public:
 	friend std::ostream& operator<<(std::ostream& s, const LLVolumeLODGroup& volgroup);
 
 protected:
+	struct GenerateRequest;
+	typedef std::shared_ptr<GenerateRequest> request_ptr_t;
+
+	static bool canGenerateAsync(const LLVolumeParams& params);
+	void generateAsync(const S32 detail, const generated_callback_t& callback);
+	static void finishGenerate(const request_ptr_t& request);
+
 	LLVolumeParams mVolumeParams;
 
 	S32 mRefs;
@@ -71,6 +87,7 @@ protected:
 	static F32 mDetailThresholds[NUM_LODS];
 	static F32 mDetailScales[NUM_LODS];
 	S32		mAccessCount[NUM_LODS];
+	request_ptr_t mGenerateRequests[NUM_LODS];
 };
 
 class LLVolumeMgr final
@@ -85,9 +102,15 @@ public:
 	// whatever calls getVolume() never owns the LLVolume* and
 	// cannot keep references for long since it may be deleted
 	// later.  For best results hold it in an LLPointer<LLVolume>.
-	LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail);
+	// allow_async lets a missing prim LOD be generated on the job system when async
+	// generation is on, a placeholder volume is returned meanwhile.
+	LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail, bool allow_async = false);
 	void unrefVolume(LLVolume *volumep);
 
+	// callback gets each placeholder volume once its faces are in
+	void setAsyncGeneration(bool enable, const LLVolumeLODGroup::generated_callback_t& callback);
+	bool getAsyncGeneration() const { return mAsyncGeneration; }
+
 	void dump();
 
 	// manually call this for mutex magic
@@ -105,6 +128,9 @@ protected:
 	volume_lod_group_map_t mVolumeLODGroups;
 
 	LLMutex* mDataMutex;
+
+	bool mAsyncGeneration;
+	LLVolumeLODGroup::generated_callback_t mGeneratedCallback;
 };
 
 #endif // LL_LLVOLUMEMGR_H
@@ -0,0 +1,284 @@
+/**
+ * @file llmeshdecoder_test.cpp
+ * @brief Tests for LLMeshDecoder
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmath.h"
+#include "../llmeshdecoder.h"
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <boost/align/aligned_allocator.hpp>
+
+#include "llsd.h"
+#include "llsdserialize.h"
+#include "llsdutil.h"
+#include "llvector4a.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	typedef std::vector<LLVector4a, boost::alignment::aligned_allocator<LLVector4a, 16> > vector4a_vec_t;
+
+	U16 rand_u16(U32& seed)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return (U16)(seed >> 16);
+	}
+
+	LLSD::Binary make_stream(U32& seed, U32 count)
+	{
+		LLSD::Binary bytes(count * 2);
+		for (U32 i = 0; i < count; ++i)
+		{
+			const U16 v = rand_u16(seed);
+			memcpy(&bytes[i * 2], &v, 2);
+		}
+		return bytes;
+	}
+
+	LLSD make_domain(const LLSD& min, const LLSD& max)
+	{
+		LLSD domain;
+		domain["Min"] = min;
+		domain["Max"] = max;
+		return domain;
+	}
+
+	// Shaped like an uploaded LOD block, no mesh assets ship with the tree
+	LLSD make_block(U32 face_count, U32 vertex_count)
+	{
+		U32 seed = 3;
+		LLSD block = LLSD::emptyArray();
+		for (U32 f = 0; f < face_count; ++f)
+		{
+			// Odd vertex counts exercise the last texture coordinate pair
+			const U32 verts = vertex_count + f % 2;
+			LLSD face;
+			face["Position"] = make_stream(seed, verts * 3);
+			face["Normal"] = make_stream(seed, verts * 3);
+			face["TexCoord0"] = make_stream(seed, verts * 2);
+			LLSD::Binary indices(verts * 2);
+			for (U32 i = 0; i < verts; ++i)
+			{
+				const U16 index = (U16)((i * 7) % verts);
+				memcpy(&indices[i * 2], &index, 2);
+			}
+			face["TriangleList"] = indices;
+			face["PositionDomain"] = make_domain(LLSDArray(-0.5)(-1.25)(-2.0), LLSDArray(0.5)(1.25)(2.0));
+			// Integers and short arrays read the way LLSD::asReal() reads them
+			face["TexCoord0Domain"] = make_domain(LLSDArray(0)(-1), LLSDArray(1.5));
+			face["Weights"] = LLSD::Binary(verts, 0xFF);
+			face["Other"] = LLSDMap("Nested", LLSDArray("text")(LLUUID::null)(LLSD()));
+			block.append(face);
+		}
+		LLSD empty;
+		empty["NoGeometry"] = true;
+		block.append(empty);
+		return block;
+	}
+
+	std::string to_binary(const LLSD& sd)
+	{
+		std::ostringstream str;
+		LLSDSerialize::toBinary(sd, str);
+		return str.str();
+	}
+
+	LLSD from_binary(const std::string& bytes)
+	{
+		std::istringstream str(bytes);
+		LLSD sd;
+		LLSDSerialize::fromBinary(sd, str, bytes.size());
+		return sd;
+	}
+
+	bool same_stream(const U8* a, U32 a_size, const U8* b, U32 b_size)
+	{
+		return a_size == b_size && (!a_size || memcmp(a, b, a_size) == 0);
+	}
+
+	// Bit for bit, unless the compiler is free to fuse or reorder the arithmetic
+	// of either side (fast math, FMA contraction), then to the last bit or so
+	bool same_floats(const void* a, const void* b, U32 count)
+	{
+#if defined(__FAST_MATH__) || defined(__FMA__)
+		const F32* fa = (const F32*)a;
+		const F32* fb = (const F32*)b;
+		for (U32 i = 0; i < count; ++i)
+		{
+			if (fabsf(fa[i] - fb[i]) > 1e-6f * llmax(1.f, fabsf(fa[i])))
+			{
+				return false;
+			}
+		}
+		return true;
+#else
+		return memcmp(a, b, count * sizeof(F32)) == 0;
+#endif
+	}
+
+	// What LLVolume::unpackVolumeFaces() did with each stream before LLMeshDecoder
+	void reference_positions(const U8* in, U32 count, const LLVector4a& min, const LLVector4a& range, LLVector4a* out)
+	{
+		const U16* v = (const U16*)in;
+		for (U32 j = 0; j < count; ++j)
+		{
+			out->set((F32)v[0], (F32)v[1], (F32)v[2]);
+			out->div(65535.f);
+			out->mul(range);
+			out->add(min);
+			out++;
+			v += 3;
+		}
+	}
+
+	void reference_normals(const U8* in, U32 count, LLVector4a* out)
+	{
+		const U16* n = (const U16*)in;
+		for (U32 j = 0; j < count; ++j)
+		{
+			out->set((F32)n[0], (F32)n[1], (F32)n[2]);
+			out->div(65535.f);
+			out->mul(2.f);
+			out->sub(1.f);
+			out++;
+			n += 3;
+		}
+	}
+
+	void reference_texcoords(const U8* in, U32 count, const LLVector4a& min, const LLVector4a& range, LLVector2* out)
+	{
+		const U16* t = (const U16*)in;
+		LLVector4a* tc_out = (LLVector4a*)out;
+		for (U32 j = 0; j < count; j += 2)
+		{
+			if (j < count - 1)
+			{
+				tc_out->set((F32)t[0], (F32)t[1], (F32)t[2], (F32)t[3]);
+			}
+			else
+			{
+				tc_out->set((F32)t[0], (F32)t[1], 0.f, 0.f);
+			}
+			t += 4;
+			tc_out->div(65535.f);
+			tc_out->mul(range);
+			tc_out->add(min);
+			tc_out++;
+		}
+	}
+}
+
+namespace tut
+{
+	struct meshdecoder_data
+	{
+	};
+	typedef test_group<meshdecoder_data> meshdecoder_test;
+	typedef meshdecoder_test::object meshdecoder_object;
+	tut::meshdecoder_test meshdecoder("LLMeshDecoder");
+
+	// The walker finds the same faces as the LLSD parser
+	template<> template<>
+	void meshdecoder_object::test<1>()
+	{
+		const std::string bytes = to_binary(make_block(8, 101));
+		const LLSD mdl = from_binary(bytes);
+
+		LLMeshDecoder::face_list_t direct;
+		LLMeshDecoder::face_list_t parsed;
+		ensure("parsed", LLMeshDecoder::parseFaces((const U8*)bytes.data(), bytes.size(), direct));
+		LLMeshDecoder::getFaces(mdl, parsed);
+		ensure_equals("face count", direct.size(), parsed.size());
+
+		for (size_t i = 0; i < direct.size(); ++i)
+		{
+			const LLMeshDecoder::Face& a = direct[i];
+			const LLMeshDecoder::Face& b = parsed[i];
+			ensure_equals("no geometry", a.mNoGeometry, b.mNoGeometry);
+			ensure_equals("has weights", a.mHasWeights, b.mHasWeights);
+			ensure("position", same_stream(a.mPosition, a.mPositionSize, b.mPosition, b.mPositionSize));
+			ensure("normal", same_stream(a.mNormal, a.mNormalSize, b.mNormal, b.mNormalSize));
+			ensure("texcoord", same_stream(a.mTexCoord, a.mTexCoordSize, b.mTexCoord, b.mTexCoordSize));
+			ensure("triangles", same_stream(a.mTriangleList, a.mTriangleListSize, b.mTriangleList, b.mTriangleListSize));
+			ensure("weights", same_stream(a.mWeights, a.mWeightsSize, b.mWeights, b.mWeightsSize));
+			ensure("position domain", a.mPositionMin == b.mPositionMin && a.mPositionMax == b.mPositionMax);
+			ensure("texcoord domain", a.mTexCoordMin == b.mTexCoordMin && a.mTexCoordMax == b.mTexCoordMax);
+		}
+		ensure("empty face", direct.back().mNoGeometry && !direct.back().mPositionSize);
+		ensure("short domain", direct[0].mTexCoordMin == LLVector2(0.f, -1.f) && direct[0].mTexCoordMax == LLVector2(1.5f, 0.f));
+	}
+
+	// Blocks the walker does not handle are left to the LLSD parser
+	template<> template<>
+	void meshdecoder_object::test<2>()
+	{
+		LLMeshDecoder::face_list_t faces;
+		const std::string bytes = to_binary(make_block(2, 10));
+
+		const std::string header = "<? LLSD/Binary ?>\n" + bytes;
+		ensure("deprecated header", !LLMeshDecoder::parseFaces((const U8*)header.data(), header.size(), faces));
+		ensure("truncated", !LLMeshDecoder::parseFaces((const U8*)bytes.data(), bytes.size() - 1, faces));
+		ensure("cleared", faces.empty());
+
+		LLSD face;
+		face["Position"] = "not a binary";
+		const std::string mistyped = to_binary(LLSDArray(face));
+		ensure("mistyped", !LLMeshDecoder::parseFaces((const U8*)mistyped.data(), mistyped.size(), faces));
+	}
+
+	// Dequantized streams match the LLVector4a code bit for bit
+	template<> template<>
+	void meshdecoder_object::test<3>()
+	{
+		for (U32 count = 1; count < 20; ++count)
+		{
+			U32 seed = count;
+			const LLSD::Binary xyz = make_stream(seed, count * 3);
+			const LLSD::Binary uv = make_stream(seed, count * 2);
+			const LLVector4a min(-3.f, 0.25f, -0.001f);
+			const LLVector4a range(6.f, 10.f, 0.002f);
+			const LLVector4a min_tc(-1.f, 2.f, -1.f, 2.f);
+			const LLVector4a range_tc(3.f, 0.5f, 3.f, 0.5f);
+
+			vector4a_vec_t expected(count + 1), actual(count + 1);
+			reference_positions(xyz.data(), count, min, range, expected.data());
+			LLMeshDecoder::dequantizePositions(xyz.data(), count, min, range, actual.data());
+			ensure("positions", same_floats(expected.data(), actual.data(), count * 4));
+
+			reference_normals(xyz.data(), count, expected.data());
+			LLMeshDecoder::dequantizeNormals(xyz.data(), count, actual.data());
+			ensure("normals", same_floats(expected.data(), actual.data(), count * 4));
+
+			reference_texcoords(uv.data(), count, min_tc, range_tc, (LLVector2*)expected.data());
+			LLMeshDecoder::dequantizeTexCoords(uv.data(), count, min_tc, range_tc, (LLVector2*)actual.data());
+			ensure("texcoords", same_floats(expected.data(), actual.data(), ((count + 1) / 2) * 4));
+		}
+	}
+}
@@ -0,0 +1,340 @@
+/**
+ * @file llparticlekernel_test.cpp
+ * @brief Tests and particle simulation benchmark for LLParticleKernel
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmath.h"
+#include "../llparticlekernel.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	typedef LLParticleStore S;
+
+	F32 frand(U32& seed)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return (F32)(seed >> 8) / (F32)(1 << 24);
+	}
+
+	// A 16m group around the origin, seen from 40m away
+	LLParticleKernel::Bounds make_bounds()
+	{
+		LLParticleKernel::Bounds bounds;
+		const F32 box_radius = F_SQRT3 * 16.f * 0.5f;
+		for (S32 k = 0; k < 3; ++k)
+		{
+			bounds.mMin[k] = -8.f;
+			bounds.mMax[k] = 8.f;
+			bounds.mCamera[k] = 0.f;
+		}
+		bounds.mCamera[0] = 40.f;
+		bounds.mMinSize = box_radius * 0.5f;
+		bounds.mMaxSize = box_radius * 2.f;
+		bounds.mSizeLimit = 32.f;
+		return bounds;
+	}
+
+	// Particles as LLViewerPartSourceScript emits them, a mix of every flag
+	void fill_store(U32& seed, S32 count, LLParticleStore& store)
+	{
+		for (S32 n = 0; n < count; ++n)
+		{
+			const S32 i = store.append();
+			for (S32 k = 0; k < 3; ++k)
+			{
+				store.get((S::EComponent)(S::POS_X + k))[i] = frand(seed) * 14.f - 7.f;
+				store.get((S::EComponent)(S::VEL_X + k))[i] = frand(seed) * 4.f - 2.f;
+				store.get((S::EComponent)(S::ACCEL_X + k))[i] = frand(seed) - 0.5f;
+			}
+			store.get(S::MAX_AGE)[i] = 1.f + frand(seed) * 5.f;
+			store.get(S::AGE)[i] = frand(seed) * store.get(S::MAX_AGE)[i];
+			store.get(S::SKIP_OFFSET)[i] = n % 3 ? 0.f : frand(seed) * 0.02f;
+			for (S32 k = 0; k < 4; ++k)
+			{
+				store.get((S::EComponent)(S::START_RED + k))[i] = frand(seed);
+				store.get((S::EComponent)(S::END_RED + k))[i] = frand(seed);
+				store.get((S::EComponent)(S::RED + k))[i] = store.get((S::EComponent)(S::START_RED + k))[i];
+			}
+			for (S32 k = 0; k < 2; ++k)
+			{
+				store.get((S::EComponent)(S::START_SCALE_X + k))[i] = 0.1f + frand(seed) * 4.f;
+				store.get((S::EComponent)(S::END_SCALE_X + k))[i] = 0.1f + frand(seed) * 4.f;
+				store.get((S::EComponent)(S::SCALE_X + k))[i] = store.get((S::EComponent)(S::START_SCALE_X + k))[i];
+			}
+			store.get(S::START_GLOW)[i] = frand(seed);
+			store.get(S::END_GLOW)[i] = frand(seed);
+			store.getFlags()[i] = (n % 7 ? S::INTEGRATE : 0) | (n % 2 ? S::INTERP_COLOR : 0)
+								  | (n % 5 ? S::INTERP_SCALE : 0) | (n % 41 ? 0 : S::KILLED);
+		}
+	}
+
+	// What LLViewerPartGroup does to its store in a frame: prepare, simulate,
+	// then drop the particles that left and take in some new ones
+	void step_group(U32& seed, LLParticleStore& store, const LLParticleKernel::Bounds& bounds, std::vector<U8>& results)
+	{
+		if (store.size() > 0)
+		{
+			store.get(S::POS_X)[0] += 0.25f;
+		}
+		results.resize((store.size() + 3) & ~3);
+		LLParticleKernel::update(store, 0.05f, bounds, results.data());
+		for (S32 i = store.size() - 1; i >= 0; i--)
+		{
+			if (results[i])
+			{
+				store.remove(i);
+			}
+		}
+		fill_store(seed, 16, store);
+	}
+
+	void copy_store(const LLParticleStore& from, LLParticleStore& to)
+	{
+		to.clear();
+		for (S32 i = 0; i < from.size(); ++i)
+		{
+			to.append();
+			for (S32 c = 0; c < S::COMPONENT_COUNT; ++c)
+			{
+				to.get((S::EComponent)c)[i] = from.get((S::EComponent)c)[i];
+			}
+			to.getFlags()[i] = from.getFlags()[i];
+		}
+	}
+}
+
+namespace tut
+{
+	struct particlekernel_data
+	{
+	};
+	typedef test_group<particlekernel_data> particlekernel_test;
+	typedef particlekernel_test::object particlekernel_object;
+	tut::particlekernel_test particlekernel("LLParticleKernel");
+
+	// Appending and removing keeps every component of a particle together
+	template<> template<>
+	void particlekernel_object::test<1>()
+	{
+		LLParticleStore store;
+		for (S32 i = 0; i < 100; ++i)
+		{
+			ensure_equals("index", store.append(), i);
+			ensure_equals("zeroed", store.get(S::GLOW)[i], 0.f);
+			store.get(S::POS_X)[i] = (F32)i;
+			store.get(S::GLOW)[i] = (F32)-i;
+			store.getFlags()[i] = i;
+		}
+		ensure("aligned", ((uintptr_t)store.get(S::VEL_Y) & 0xf) == 0 && ((uintptr_t)store.getFlags() & 0xf) == 0);
+
+		store.remove(10);
+		store.remove(98);
+		ensure_equals("size", store.size(), 98);
+		ensure_equals("last moved", store.get(S::POS_X)[10], 99.f);
+		ensure_equals("last moved glow", store.get(S::GLOW)[10], -99.f);
+		ensure_equals("last moved flags", store.getFlags()[10], (U32)99);
+		ensure_equals("removed last", store.get(S::POS_X)[97], 97.f);
+
+		store.clear();
+		ensure("cleared", store.empty());
+	}
+
+	// Matches the one particle at a time update over a few seconds
+	template<> template<>
+	void particlekernel_object::test<2>()
+	{
+		U32 seed = 5;
+		LLParticleStore simd, scalar;
+		fill_store(seed, 1001, simd);
+		copy_store(simd, scalar);
+		const LLParticleKernel::Bounds bounds = make_bounds();
+		std::vector<U8> simd_results(simd.size() + 3), scalar_results(simd.size() + 3);
+
+		for (S32 frame = 0; frame < 30; ++frame)
+		{
+			LLParticleKernel::update(simd, 0.05f, bounds, simd_results.data());
+			LLParticleKernel::updateScalar(scalar, 0.05f, bounds, scalar_results.data());
+			for (S32 i = 0; i < simd.size(); ++i)
+			{
+				for (S32 c = 0; c < S::COMPONENT_COUNT; ++c)
+				{
+					const F32 expected = scalar.get((S::EComponent)c)[i];
+					ensure_approximately_equals("component", simd.get((S::EComponent)c)[i], expected, 12);
+				}
+				// Particles right at an edge may fall on either side of it
+				const F32 x = scalar.get(S::POS_X)[i];
+				if (fabsf(x - bounds.mMin[0]) > 1e-3f && fabsf(x - bounds.mMax[0]) > 1e-3f)
+				{
+					ensure_equals("results", simd_results[i], scalar_results[i]);
+				}
+			}
+		}
+	}
+
+	// Flags and results for hand made particles
+	template<> template<>
+	void particlekernel_object::test<3>()
+	{
+		LLParticleStore store;
+		for (S32 i = 0; i < 5; ++i)
+		{
+			store.append();
+			store.get(S::MAX_AGE)[i] = 2.f;
+			store.get(S::START_SCALE_X)[i] = 1.f;
+			store.get(S::END_SCALE_X)[i] = 3.f;
+			store.get(S::SCALE_X)[i] = 1.f;
+			store.get(S::VEL_Z)[i] = 1.f;
+			store.get(S::POS_X)[i] = 30.f;		// too small for the group that close to the camera
+		}
+		store.get(S::POS_X)[0] = 0.f;
+		store.getFlags()[0] = S::INTEGRATE | S::INTERP_SCALE;
+		store.get(S::SKIP_OFFSET)[0] = 0.5f;
+		store.get(S::AGE)[1] = 1.9f;
+		store.getFlags()[2] = S::KILLED;
+		store.get(S::POS_X)[3] = 9.f;
+		store.get(S::POS_X)[4] = 0.f;
+		store.get(S::POS_Z)[4] = 7.5f;
+		store.getFlags()[4] = S::INTEGRATE;
+
+		std::vector<U8> results(8, 0xff);
+		LLParticleKernel::update(store, 1.f, make_bounds(), results.data());
+
+		ensure_approximately_equals("moved by dt less skip", store.get(S::POS_Z)[0], 0.5f, 20);
+		ensure_approximately_equals("scale", store.get(S::SCALE_X)[0], 1.5f, 20);
+		ensure_equals("skip cleared", store.get(S::SKIP_OFFSET)[0], 0.f);
+		ensure_equals("not moved", store.get(S::POS_Z)[3], 0.f);
+		ensure_equals("inside", results[0], (U8)0);
+		ensure_equals("too old", results[1], (U8)LLParticleKernel::EXPIRED);
+		ensure_equals("killed", results[2], (U8)LLParticleKernel::EXPIRED);
+		ensure_equals("out of the box", results[3], (U8)LLParticleKernel::OUTSIDE);
+		ensure_equals("moved out of the box", results[4], (U8)LLParticleKernel::OUTSIDE);
+	}
+
+	// Simulation time of the viewer's particle budget, in groups of 256
+	template<> template<>
+	void particlekernel_object::test<4>()
+	{
+		const S32 GROUPS = 64;
+		const S32 PER_GROUP = 256;
+		const S32 FRAMES = 50;
+		U32 seed = 9;
+		std::vector<LLParticleStore> simd(GROUPS), scalar(GROUPS);
+		for (S32 g = 0; g < GROUPS; ++g)
+		{
+			fill_store(seed, PER_GROUP, simd[g]);
+			copy_store(simd[g], scalar[g]);
+		}
+		const LLParticleKernel::Bounds bounds = make_bounds();
+		std::vector<U8> results(PER_GROUP);
+
+		LLTimer timer;
+		for (S32 f = 0; f < FRAMES; ++f)
+		{
+			for (S32 g = 0; g < GROUPS; ++g)
+			{
+				LLParticleKernel::updateScalar(scalar[g], 0.02f, bounds, results.data());
+			}
+		}
+		const F64 reference = timer.getElapsedTimeF64() / FRAMES;
+
+		timer.reset();
+		for (S32 f = 0; f < FRAMES; ++f)
+		{
+			for (S32 g = 0; g < GROUPS; ++g)
+			{
+				LLParticleKernel::update(simd[g], 0.02f, bounds, results.data());
+			}
+		}
+		const F64 kernel = timer.getElapsedTimeF64() / FRAMES;
+
+		std::cout << "\nSimulating " << GROUPS * PER_GROUP << " particles: scalar " << reference * 1000.0
+				  << " ms, kernel " << kernel * 1000.0 << " ms" << std::endl;
+	}
+
+	// simulate() of one group on another thread while the main thread prepares
+	// and finishes a second group, as RenderParallelParticles does
+	template<> template<>
+	void particlekernel_object::test<5>()
+	{
+		const S32 FRAMES = 200;
+		const LLParticleKernel::Bounds bounds = make_bounds();
+		U32 seed = 13;
+		LLParticleStore worker, worker_ref, local, local_ref;
+		fill_store(seed, 4001, worker);
+		copy_store(worker, worker_ref);
+		fill_store(seed, 777, local);
+		copy_store(local, local_ref);
+
+		std::vector<U8> worker_results((worker.size() + 3) & ~3);
+		std::thread thread([&]()
+			{
+				for (S32 f = 0; f < FRAMES; ++f)
+				{
+					LLParticleKernel::update(worker, 0.05f, bounds, worker_results.data());
+				}
+			});
+		U32 local_seed = 21;
+		std::vector<U8> local_results;
+		for (S32 f = 0; f < FRAMES; ++f)
+		{
+			step_group(local_seed, local, bounds, local_results);
+		}
+		thread.join();
+
+		std::vector<U8> results((worker_ref.size() + 3) & ~3);
+		for (S32 f = 0; f < FRAMES; ++f)
+		{
+			LLParticleKernel::update(worker_ref, 0.05f, bounds, results.data());
+		}
+		local_seed = 21;
+		for (S32 f = 0; f < FRAMES; ++f)
+		{
+			step_group(local_seed, local_ref, bounds, local_results);
+		}
+
+		ensure("worker results", worker_results == results);
+		ensure_equals("local size", local.size(), local_ref.size());
+		for (S32 c = 0; c < S::COMPONENT_COUNT; ++c)
+		{
+			for (S32 i = 0; i < worker.size(); ++i)
+			{
+				ensure_equals("worker component", worker.get((S::EComponent)c)[i], worker_ref.get((S::EComponent)c)[i]);
+			}
+			for (S32 i = 0; i < local.size(); ++i)
+			{
+				ensure_equals("local component", local.get((S::EComponent)c)[i], local_ref.get((S::EComponent)c)[i]);
+			}
+		}
+	}
+}
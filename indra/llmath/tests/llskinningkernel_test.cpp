@@ -0,0 +1,251 @@
+/**
+ * @file llskinningkernel_test.cpp
+ * @brief Tests and skinning benchmark for LLSkinningKernel
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmath.h"
+#include "../llskinningkernel.h"
+
+#include <iostream>
+#include <vector>
+#include <boost/align/aligned_allocator.hpp>
+
+#include "llmatrix4a.h"
+#include "llmemory.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	const S32 JOINT_COUNT = 110;
+
+	typedef std::vector<LLVector4a, boost::alignment::aligned_allocator<LLVector4a, 16> > vector4a_vec_t;
+	typedef std::vector<LLMatrix4a, boost::alignment::aligned_allocator<LLMatrix4a, 16> > matrix4a_vec_t;
+
+	F32 frand(U32& seed)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return (F32)(seed >> 8) / (F32)(1 << 24);
+	}
+
+	void make_matrix(U32& seed, LLMatrix4a& mat)
+	{
+		LLVector4a cols[4];
+		for (U32 i = 0; i < 4; ++i)
+		{
+			cols[i].set(frand(seed) - 0.5f, frand(seed) - 0.5f, frand(seed) - 0.5f, 0.f);
+		}
+		cols[0].add(LLVector4a(1.f, 0.f, 0.f, 0.f));
+		cols[1].add(LLVector4a(0.f, 1.f, 0.f, 0.f));
+		cols[2].add(LLVector4a(0.f, 0.f, 1.f, 0.f));
+		cols[3].add(LLVector4a(0.f, 0.f, 0.f, 1.f));
+		mat.setRow<0>(cols[0]);
+		mat.setRow<1>(cols[1]);
+		mat.setRow<2>(cols[2]);
+		mat.setRow<3>(cols[3]);
+	}
+
+	// Body shaped input with up to four influences per vertex, encoded like LLVolumeFace::mWeights
+	void make_mesh(S32 count, vector4a_vec_t& weights, vector4a_vec_t& positions, vector4a_vec_t& normals)
+	{
+		U32 seed = 1;
+		weights.resize(count);
+		positions.resize(count);
+		normals.resize(count);
+		for (S32 i = 0; i < count; ++i)
+		{
+			F32 w[4];
+			for (U32 k = 0; k < 4; ++k)
+			{
+				const F32 joint = (F32)((i / 64 + k * 7) % JOINT_COUNT);
+				w[k] = joint + (k < (U32)(i % 4) + 1 ? llclamp(frand(seed), 0.01f, 0.99f) : 0.f);
+			}
+			weights[i].set(w[0], w[1], w[2], w[3]);
+			positions[i].set(frand(seed) - 0.5f, frand(seed) - 0.5f, frand(seed) * 2.f, 1.f);
+			normals[i].set(frand(seed) - 0.5f, frand(seed) - 0.5f, frand(seed) - 0.5f, 0.f);
+			normals[i].normalize3fast();
+		}
+	}
+
+	// Per vertex path the kernel replaces: blend a matrix, then bind shape and blended transform
+	void skin_reference(const LLMatrix4a* mat, const LLMatrix4a& bind_shape, const vector4a_vec_t& weights,
+						const vector4a_vec_t& positions, const vector4a_vec_t& normals,
+						vector4a_vec_t& out_positions, vector4a_vec_t& out_normals)
+	{
+		for (size_t i = 0; i < weights.size(); ++i)
+		{
+			LL_ALIGN_16(S32 idx[4]);
+			LLVector4a weight;
+			F32 sum = 0.f;
+			for (U32 k = 0; k < 4; ++k)
+			{
+				idx[k] = llmin((S32)weights[i][k], JOINT_COUNT - 1);
+				weight.getF32ptr()[k] = weights[i][k] - (S32)weights[i][k];
+				sum += weight[k];
+			}
+			weight.mul(1.f / sum);
+
+			LLMatrix4a final_mat;
+			final_mat.setMul(mat[idx[0]], weight.getVectorAt<0>());
+			final_mat.setMulAdd(mat[idx[1]], weight.getVectorAt<1>());
+			final_mat.setMulAdd(mat[idx[2]], weight.getVectorAt<2>());
+			final_mat.setMulAdd(mat[idx[3]], weight.getVectorAt<3>());
+
+			LLVector4a dst;
+			bind_shape.affineTransform(positions[i], dst);
+			final_mat.affineTransform(dst, out_positions[i]);
+
+			bind_shape.rotate(normals[i], dst);
+			final_mat.rotate(dst, out_normals[i]);
+			out_normals[i].normalize3fast();
+		}
+	}
+
+	void make_palette(const LLMatrix4a* mat, const LLMatrix4a& bind_shape, LLMatrix4a* palette)
+	{
+		for (S32 j = 0; j < JOINT_COUNT; ++j)
+		{
+			palette[j].setMul(mat[j], bind_shape);
+		}
+	}
+}
+
+namespace tut
+{
+	struct skinningkernel_data
+	{
+	};
+	typedef test_group<skinningkernel_data> skinningkernel_test;
+	typedef skinningkernel_test::object skinningkernel_object;
+	tut::skinningkernel_test skinningkernel("LLSkinningKernel");
+
+	// Matches the per vertex path, and computes the extents
+	template<> template<>
+	void skinningkernel_object::test<1>()
+	{
+		U32 seed = 42;
+		matrix4a_vec_t mat(JOINT_COUNT);
+		matrix4a_vec_t palette(JOINT_COUNT);
+		LLMatrix4a bind_shape;
+		for (S32 j = 0; j < JOINT_COUNT; ++j)
+		{
+			make_matrix(seed, mat[j]);
+		}
+		make_matrix(seed, bind_shape);
+		make_palette(mat.data(), bind_shape, palette.data());
+
+		vector4a_vec_t weights, positions, normals;
+		make_mesh(1000, weights, positions, normals);
+
+		vector4a_vec_t ref_positions(weights.size()), ref_normals(weights.size());
+		skin_reference(mat.data(), bind_shape, weights, positions, normals, ref_positions, ref_normals);
+
+		vector4a_vec_t out_positions(weights.size()), out_normals(weights.size());
+		LLVector4a extents[2];
+		LLSkinningKernel::skin(palette.data(), JOINT_COUNT, weights.data(), positions.data(), out_positions.data(),
+							   normals.data(), out_normals.data(), (S32)weights.size(), extents);
+
+		LLVector4a min = ref_positions[0];
+		LLVector4a max = ref_positions[0];
+		for (size_t i = 0; i < weights.size(); ++i)
+		{
+			ensure("position", out_positions[i].equals3(ref_positions[i], 1e-4f));
+			ensure("normal", out_normals[i].equals3(ref_normals[i], 1e-3f));
+			min.setMin(min, ref_positions[i]);
+			max.setMax(max, ref_positions[i]);
+		}
+		ensure("min", extents[0].equals3(min, 1e-4f));
+		ensure("max", extents[1].equals3(max, 1e-4f));
+
+		// Positions only
+		LLSkinningKernel::skin(palette.data(), JOINT_COUNT, weights.data(), positions.data(), out_positions.data(),
+							   nullptr, nullptr, (S32)weights.size(), nullptr);
+		ensure("positions only", out_positions[17].equals3(ref_positions[17], 1e-4f));
+	}
+
+	// Out of range joints are clamped and weightless vertices follow their first joint
+	template<> template<>
+	void skinningkernel_object::test<2>()
+	{
+		LLMatrix4a palette[2];
+		palette[0].setIdentity();
+		palette[1].setIdentity();
+		palette[1].setRow<3>(LLVector4a(0.f, 0.f, 5.f, 1.f));
+
+		LLVector4a weights[2];
+		weights[0].set(0.f, 0.f, 0.f, 0.f);
+		weights[1].set(9.5f, 0.f, 0.f, 0.f);
+		LLVector4a positions[2];
+		positions[0].set(1.f, 2.f, 3.f, 1.f);
+		positions[1].set(1.f, 2.f, 3.f, 1.f);
+		LLVector4a out[2];
+
+		LLSkinningKernel::skin(palette, 2, weights, positions, out, nullptr, nullptr, 2, nullptr);
+		ensure("first joint", out[0].equals3(LLVector4a(1.f, 2.f, 3.f), 1e-5f));
+		ensure("clamped joint", out[1].equals3(LLVector4a(1.f, 2.f, 8.f), 1e-5f));
+	}
+
+	// Skinning time for a 60k triangle body, per vertex path against the kernel
+	template<> template<>
+	void skinningkernel_object::test<3>()
+	{
+		U32 seed = 7;
+		matrix4a_vec_t mat(JOINT_COUNT);
+		matrix4a_vec_t palette(JOINT_COUNT);
+		LLMatrix4a bind_shape;
+		for (S32 j = 0; j < JOINT_COUNT; ++j)
+		{
+			make_matrix(seed, mat[j]);
+		}
+		make_matrix(seed, bind_shape);
+
+		vector4a_vec_t weights, positions, normals;
+		make_mesh(32768, weights, positions, normals);
+		vector4a_vec_t out_positions(weights.size()), out_normals(weights.size());
+		LLVector4a extents[2];
+
+		const S32 FRAMES = 20;
+		LLTimer timer;
+		for (S32 f = 0; f < FRAMES; ++f)
+		{
+			skin_reference(mat.data(), bind_shape, weights, positions, normals, out_positions, out_normals);
+		}
+		const F64 reference = timer.getElapsedTimeF64() / FRAMES;
+
+		timer.reset();
+		for (S32 f = 0; f < FRAMES; ++f)
+		{
+			make_palette(mat.data(), bind_shape, palette.data());
+			LLSkinningKernel::skin(palette.data(), JOINT_COUNT, weights.data(), positions.data(), out_positions.data(),
+								   normals.data(), out_normals.data(), (S32)weights.size(), extents);
+		}
+		const F64 kernel = timer.getElapsedTimeF64() / FRAMES;
+
+		std::cout << "\nSkinning " << weights.size() << " vertices (" << LLSkinningKernel::getInstructionSet()
+				  << "): per vertex " << reference * 1000.0 << " ms, kernel " << kernel * 1000.0 << " ms" << std::endl;
+	}
+}
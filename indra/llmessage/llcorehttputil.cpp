@@ -49,6 +49,8 @@ namespace LLCoreHttpUtil
 {
 
 const F32 HTTP_REQUEST_EXPIRY_SECS = 60.0f;
+// LLSD responses at least this large are parsed into an arena of their own
+const size_t ARENA_PARSE_MIN_BYTES = 16 * 1024;
 
 namespace 
 {
@@ -110,7 +112,7 @@ private:
 // *TODO:  Currently converts only from XML content.  A mode
 // to convert using fromBinary() might be useful as well.  Mesh
 // headers could use it.
-bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
+bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd, bool use_arena)
 {
     // Convert response to LLSD
     BufferArray * body(response->getBody());
@@ -121,7 +123,10 @@ bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
 
     LLCore::BufferArrayStream bas(body);
     LLSD body_llsd;
-    S32 parse_status(LLSDSerialize::fromXML(body_llsd, bas, log));
+    LLPointer<LLSDXMLParser> parser = new LLSDXMLParser(log);
+    // Only callers that read the result once and drop it ask for the arena
+    parser->setUseArena(use_arena && body->size() >= ARENA_PARSE_MIN_BYTES);
+    S32 parse_status(parser->parse(bas, body_llsd, LLSDSerialize::SIZE_UNLIMITED));
     if (LLSDParser::PARSE_FAILURE == parse_status){
         return false;
     }
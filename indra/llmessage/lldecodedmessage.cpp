@@ -0,0 +1,388 @@
+/**
+ * @file lldecodedmessage.cpp
+ * @brief Template messages decoded through their compiled layout
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lldecodedmessage.h"
+
+#include "llmessagereader.h"
+#include "message_layouts.h"
+
+namespace
+{
+	// The template is read from app_settings at runtime, it may not be the
+	// one the layouts were generated from
+	bool matches(const LLMsgLayout& layout, const LLMessageTemplate& msg_template)
+	{
+		if (strcmp(layout.mName, msg_template.mName)
+			|| layout.mFrequency != msg_template.mFrequency
+			|| layout.mBlockCount != (S32)msg_template.mMemberBlocks.size())
+		{
+			return false;
+		}
+
+		const LLMsgBlockLayout* block_layout = layout.mBlocks;
+		for (const LLMessageBlock* block : msg_template.mMemberBlocks)
+		{
+			if (strcmp(block_layout->mName, block->mName)
+				|| block_layout->mType != block->mType
+				|| (block->mType == MBT_MULTIPLE && block_layout->mNumber != block->mNumber)
+				|| block_layout->mFieldCount != (S32)block->mMemberVariables.size())
+			{
+				return false;
+			}
+
+			const LLMsgFieldLayout* field = block_layout->mFields;
+			for (const LLMessageVariable* variable : block->mMemberVariables)
+			{
+				if (strcmp(field->mName, variable->getName())
+					|| field->mType != variable->getType()
+					|| field->mSize != variable->getSize())
+				{
+					return false;
+				}
+				++field;
+			}
+			++block_layout;
+		}
+		return true;
+	}
+}
+
+LLMessageDecoder::LLMessageDecoder(const LLMsgLayout& layout, decode_func_t decode)
+	: mLayout(&layout),
+	  mDecode(decode)
+{
+	LLMessageStringTable* strings = LLMessageStringTable::getInstance();
+	for (S32 b = 0; b < layout.mBlockCount; ++b)
+	{
+		const LLMsgBlockLayout& block = layout.mBlocks[b];
+		mBlockNames.push_back(strings->getString(block.mName));
+		mFirstField.push_back((S32)mFieldNames.size());
+		for (S32 f = 0; f < block.mFieldCount; ++f)
+		{
+			mFieldNames.push_back(strings->getString(block.mFields[f].mName));
+		}
+	}
+	mFirstField.push_back((S32)mFieldNames.size());
+}
+
+// static
+const LLMessageDecoder* LLMessageDecoder::find(const LLMessageTemplate& msg_template)
+{
+	static const std::vector<LLMessageDecoder> decoders = []()
+	{
+		std::vector<LLMessageDecoder> decoders;
+#define LL_MESSAGE_DECODER(NAME) \
+		decoders.emplace_back(LLMessageLayouts::NAME::LAYOUT, \
+							  &LLDecodedMessage::decodeLayout<LLMessageLayouts::NAME::LAYOUT>);
+		LL_MESSAGE_LAYOUTS(LL_MESSAGE_DECODER)
+#undef LL_MESSAGE_DECODER
+		return decoders;
+	}();
+
+	for (const LLMessageDecoder& decoder : decoders)
+	{
+		if (decoder.mLayout->mNumber == msg_template.mMessageNumber)
+		{
+			if (matches(*decoder.mLayout, msg_template))
+			{
+				return &decoder;
+			}
+			LL_WARNS("Messaging") << "Template of " << msg_template.mName
+				<< " differs from the one the viewer was built with, decoding it the generic way" << LL_ENDL;
+			break;
+		}
+	}
+	return nullptr;
+}
+
+LLDecodedMessage::LLDecodedMessage()
+	: mDecoder(nullptr),
+	  mBuffer(nullptr),
+	  mDecodePos(0),
+	  mNextField(0)
+{
+}
+
+bool LLDecodedMessage::decode(const LLMessageDecoder* decoder, const U8* buffer, S32 decode_pos, S32 receive_size)
+{
+	mDecoder = nullptr;
+	mBuffer = buffer;
+	mDecodePos = decode_pos;
+	mNextField = 0;
+	mBlocks.resize(decoder->mLayout->mBlockCount);
+	if (!(this->*decoder->mDecode)(buffer, decode_pos, receive_size))
+	{
+		return false;
+	}
+	mDecoder = decoder;
+	return true;
+}
+
+void LLDecodedMessage::clear()
+{
+	mDecoder = nullptr;
+	mBuffer = nullptr;
+}
+
+// One instance per layout, so that the compiler sees the block types, field
+// sizes and offsets as constants and unrolls what it can.
+template<const LLMsgLayout& LAYOUT>
+bool LLDecodedMessage::decodeLayout(const U8* buffer, S32 decode_pos, S32 receive_size)
+{
+	S32 field_count = 0;
+	bool empty = true;
+	for (S32 b = 0; b < LAYOUT.mBlockCount; ++b)
+	{
+		const LLMsgBlockLayout& block = LAYOUT.mBlocks[b];
+
+		// how many of this block, as in LLTemplateMessageReader::decodeData()
+		S32 repeat_number = 1;
+		if (block.mType == MBT_MULTIPLE)
+		{
+			repeat_number = block.mNumber;
+		}
+		else if (block.mType == MBT_VARIABLE)
+		{
+			// missing variable blocks at the end of the message are legal
+			repeat_number = decode_pos < receive_size ? buffer[decode_pos++] : 0;
+		}
+		empty = empty && !repeat_number;
+
+		mBlocks[b].mFirstField = field_count;
+		mBlocks[b].mCount = repeat_number;
+		field_count += repeat_number * block.mFieldCount;
+		if ((S32)mFields.size() < field_count)
+		{
+			mFields.resize(field_count);
+		}
+		Field* field = mFields.data() + mBlocks[b].mFirstField;
+
+		if (block.mFixedSize >= 0)
+		{
+			// every variable at a known offset, one check for all the repeats
+			if (decode_pos + repeat_number * block.mFixedSize > receive_size)
+			{
+				return false;
+			}
+			for (S32 i = 0; i < repeat_number; ++i)
+			{
+				for (S32 f = 0; f < block.mFieldCount; ++f)
+				{
+					field->mOffset = decode_pos + block.mFields[f].mOffset;
+					field->mSize = block.mFields[f].mSize;
+					++field;
+				}
+				decode_pos += block.mFixedSize;
+			}
+			continue;
+		}
+
+		for (S32 i = 0; i < repeat_number; ++i)
+		{
+			for (S32 f = 0; f < block.mFieldCount; ++f)
+			{
+				const LLMsgFieldLayout& variable = block.mFields[f];
+				S32 size = variable.mSize;
+				if (variable.mType == MVT_VARIABLE)
+				{
+					if (decode_pos + variable.mSize > receive_size)
+					{
+						return false;
+					}
+					U8 tsizeb = 0;
+					U16 tsizeh = 0;
+					U32 tsize = 0;
+					switch (variable.mSize)
+					{
+					case 1:
+						tsizeb = buffer[decode_pos];
+						tsize = tsizeb;
+						break;
+					case 2:
+						htolememcpy(&tsizeh, &buffer[decode_pos], MVT_U16, 2);
+						tsize = tsizeh;
+						break;
+					default:
+						htolememcpy(&tsize, &buffer[decode_pos], MVT_U32, 4);
+						break;
+					}
+					decode_pos += variable.mSize;
+					if (tsize > (U32)receive_size)
+					{
+						return false;
+					}
+					size = (S32)tsize;
+				}
+				if (decode_pos + size > receive_size)
+				{
+					return false;
+				}
+				field->mOffset = decode_pos;
+				field->mSize = size;
+				++field;
+				decode_pos += size;
+			}
+		}
+	}
+	return !empty || !LAYOUT.mBlockCount;
+}
+
+S32 LLDecodedMessage::findBlock(const char* blockname) const
+{
+	const S32 count = (S32)mDecoder->mBlockNames.size();
+	for (S32 b = 0; b < count; ++b)
+	{
+		if (mDecoder->mBlockNames[b] == blockname)
+		{
+			return b;
+		}
+	}
+	return -1;
+}
+
+S32 LLDecodedMessage::findField(S32 block, const char* varname) const
+{
+	const char* const* names = &mDecoder->mFieldNames[mDecoder->mFirstField[block]];
+	const S32 count = mDecoder->mFirstField[block + 1] - mDecoder->mFirstField[block];
+	S32 f = mNextField < count ? mNextField : 0;
+	for (S32 n = 0; n < count; ++n)
+	{
+		if (names[f] == varname)
+		{
+			mNextField = f + 1;
+			return f;
+		}
+		f = f + 1 < count ? f + 1 : 0;
+	}
+	return -1;
+}
+
+void LLDecodedMessage::getData(const char* blockname, const char* varname, void* datap,
+							   S32 size, S32 blocknum, S32 max_size) const
+{
+	const S32 b = findBlock(blockname);
+	if (b < 0 || blocknum >= mBlocks[b].mCount)
+	{
+		LL_ERRS() << "Block " << blockname << " #" << blocknum
+			<< " not in message " << getLayout().mName << LL_ENDL;
+		return;
+	}
+
+	const S32 f = findField(b, varname);
+	if (f < 0)
+	{
+		LL_ERRS() << "Variable "<< varname << " not in message "
+			<< getLayout().mName << " block " << blockname << LL_ENDL;
+		return;
+	}
+
+	const LLMsgFieldLayout& variable = getLayout().mBlocks[b].mFields[f];
+	const Field& field = mFields[mBlocks[b].mFirstField + blocknum * getLayout().mBlocks[b].mFieldCount + f];
+	if (size && size != field.mSize)
+	{
+		LL_ERRS() << "Msg " << getLayout().mName
+			<< " variable " << varname
+			<< " is size " << field.mSize
+			<< " but copying into buffer of size " << size
+			<< LL_ENDL;
+		return;
+	}
+
+	if (max_size >= field.mSize)
+	{
+		if (field.mSize)
+		{
+			htolememcpy(datap, mBuffer + field.mOffset, variable.mType, field.mSize);
+		}
+	}
+	else
+	{
+		LL_WARNS() << "Msg " << getLayout().mName
+			<< " variable " << varname
+			<< " is size " << field.mSize
+			<< " but truncated to max size of " << max_size
+			<< LL_ENDL;
+
+		memcpy(datap, mBuffer + field.mOffset, max_size);
+	}
+}
+
+S32 LLDecodedMessage::getNumberOfBlocks(const char* blockname) const
+{
+	const S32 b = findBlock(blockname);
+	return b < 0 ? 0 : mBlocks[b].mCount;
+}
+
+S32 LLDecodedMessage::getSize(const char* blockname, const char* varname) const
+{
+	const S32 b = findBlock(blockname);
+	if (b < 0 || !mBlocks[b].mCount)
+	{	// don't crash
+		LL_INFOS() << "Block " << blockname << " not in message "
+			<< getLayout().mName << LL_ENDL;
+		return LL_BLOCK_NOT_IN_MESSAGE;
+	}
+
+	const S32 f = findField(b, varname);
+	if (f < 0)
+	{	// don't crash
+		LL_INFOS() << "Variable " << varname << " not in message "
+			<< getLayout().mName << " block " << blockname << LL_ENDL;
+		return LL_VARIABLE_NOT_IN_BLOCK;
+	}
+
+	if (getLayout().mBlocks[b].mType != MBT_SINGLE)
+	{	// This is a serious error - crash
+		LL_ERRS() << "Block " << blockname << " isn't type MBT_SINGLE,"
+			" use getSize with blocknum argument!" << LL_ENDL;
+		return LL_MESSAGE_ERROR;
+	}
+
+	return mFields[mBlocks[b].mFirstField + f].mSize;
+}
+
+S32 LLDecodedMessage::getSize(const char* blockname, S32 blocknum, const char* varname) const
+{
+	const S32 b = findBlock(blockname);
+	if (b < 0 || blocknum >= mBlocks[b].mCount)
+	{	// don't crash
+		LL_INFOS() << "Block " << blockname << " #" << blocknum << " not in message "
+			<< getLayout().mName << LL_ENDL;
+		return LL_BLOCK_NOT_IN_MESSAGE;
+	}
+
+	const S32 f = findField(b, varname);
+	if (f < 0)
+	{	// don't crash
+		LL_INFOS() << "Variable " << varname << " not in message "
+			<< getLayout().mName << " block " << blockname << LL_ENDL;
+		return LL_VARIABLE_NOT_IN_BLOCK;
+	}
+
+	return mFields[mBlocks[b].mFirstField + blocknum * getLayout().mBlocks[b].mFieldCount + f].mSize;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file lldecodedmessage.h
+ * @brief Template messages decoded through their compiled layout
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLDECODEDMESSAGE_H
+#define LL_LLDECODEDMESSAGE_H
+
+#include "llmessagelayout.h"
+
+class LLDecodedMessage;
+
+// Decoder generated for one of the layouts of message_layouts.h, with the
+// string table names of its blocks and variables to look them up by.
+class LLMessageDecoder
+{
+public:
+	// Decoder of the messages of msg_template, null if it has no compiled
+	// layout or the template read at runtime no longer matches it
+	static const LLMessageDecoder* find(const LLMessageTemplate& msg_template);
+
+	typedef bool (LLDecodedMessage::*decode_func_t)(const U8* buffer, S32 decode_pos, S32 receive_size);
+	LLMessageDecoder(const LLMsgLayout& layout, decode_func_t decode);
+
+	const LLMsgLayout*	mLayout;
+	decode_func_t		mDecode;
+	std::vector<const char*> mBlockNames;
+	std::vector<S32> mFirstField;			// in mFieldNames, by block
+	std::vector<const char*> mFieldNames;
+};
+
+// Where each field of a message is in the receive buffer, what
+// LLTemplateMessageReader::decodeData() reads instead of copying every field
+// into a LLMsgData for messages with a compiled layout. Only valid as long as
+// the buffer is, that is while the handlers of the message run.
+class LLDecodedMessage
+{
+public:
+	LLDecodedMessage();
+
+	// False when the message runs off the end of the packet or has no block,
+	// left to the generic decode which reports it
+	bool decode(const LLMessageDecoder* decoder, const U8* buffer, S32 decode_pos, S32 receive_size);
+	void clear();
+	bool isDecoded() const { return mDecoder != nullptr; }
+	const LLMsgLayout& getLayout() const { return *mDecoder->mLayout; }
+	const U8* getBuffer() const { return mBuffer; }
+	S32 getDecodePos() const { return mDecodePos; }
+
+	// Same arguments and errors as the LLTemplateMessageReader getters
+	void getData(const char* blockname, const char* varname, void* datap,
+				 S32 size, S32 blocknum, S32 max_size) const;
+	S32 getNumberOfBlocks(const char* blockname) const;
+	S32 getSize(const char* blockname, const char* varname) const;
+	S32 getSize(const char* blockname, S32 blocknum, const char* varname) const;
+
+	// Read a field by its generated name, without looking it up, e.g.
+	// get<LLMessageLayouts::CoarseLocationUpdate::Location::X>(i)
+	template<class FIELD>
+	typename LLMsgValue<FIELD::TYPE>::type_t get(S32 blocknum = 0) const
+	{
+		typename LLMsgValue<FIELD::TYPE>::type_t value;
+		htolememcpy(&value, mBuffer + getField<FIELD>(blocknum).mOffset, FIELD::TYPE, FIELD::SIZE);
+		return value;
+	}
+
+	// Bytes of a MVT_VARIABLE or MVT_FIXED field, in place
+	template<class FIELD>
+	const U8* getBinary(S32& size, S32 blocknum = 0) const
+	{
+		const Field& field = getField<FIELD>(blocknum);
+		size = field.mSize;
+		return mBuffer + field.mOffset;
+	}
+
+private:
+	struct Field
+	{
+		S32 mOffset;
+		S32 mSize;
+	};
+
+	struct Block
+	{
+		S32 mFirstField;	// in mFields
+		S32 mCount;
+	};
+
+	template<const LLMsgLayout& LAYOUT>
+	bool decodeLayout(const U8* buffer, S32 decode_pos, S32 receive_size);
+	friend class LLMessageDecoder;
+
+	template<class FIELD>
+	const Field& getField(S32 blocknum) const
+	{
+		llassert(mDecoder->mLayout == &FIELD::LAYOUT);
+		const Block& block = mBlocks[FIELD::BLOCK_INDEX];
+		if (blocknum >= block.mCount)
+		{
+			LL_ERRS() << "Block " << FIELD::LAYOUT.mBlocks[FIELD::BLOCK_INDEX].mName << " #" << blocknum
+				<< " not in message " << FIELD::LAYOUT.mName << LL_ENDL;
+		}
+		return mFields[block.mFirstField + blocknum * FIELD::FIELD_COUNT + FIELD::FIELD_INDEX];
+	}
+
+	S32 findBlock(const char* blockname) const;
+	S32 findField(S32 block, const char* varname) const;
+
+	const LLMessageDecoder* mDecoder;
+	const U8* mBuffer;
+	S32 mDecodePos;
+	std::vector<Block> mBlocks;
+	std::vector<Field> mFields;
+	mutable S32 mNextField;		// handlers mostly read variables in template order
+};
+
+#endif // LL_LLDECODEDMESSAGE_H
@@ -0,0 +1,93 @@
+/**
+ * @file llmessagelayout.h
+ * @brief Compile time descriptions of message template layouts
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGELAYOUT_H
+#define LL_LLMESSAGELAYOUT_H
+
+#include "llmessagetemplate.h"
+
+// The same description of a message as LLMessageTemplate, but as constants
+// generated from message_template.msg at build time by
+// scripts/message_layouts.py, see message_layouts.h in the llmessage build
+// directory. Blocks and variables are in template order.
+
+struct LLMsgFieldLayout
+{
+	const char*			mName;
+	EMsgVariableType	mType;
+	S32					mSize;		// of a fixed field, of the length prefix of a MVT_VARIABLE one
+	S32					mOffset;	// from the start of the block, -1 past a MVT_VARIABLE field
+};
+
+struct LLMsgBlockLayout
+{
+	const char*				mName;
+	EMsgBlockType			mType;
+	S32						mNumber;		// repeats of a MBT_MULTIPLE block
+	const LLMsgFieldLayout*	mFields;
+	S32						mFieldCount;
+	S32						mFixedSize;		// -1 if the block has a MVT_VARIABLE field
+};
+
+struct LLMsgLayout
+{
+	const char*				mName;
+	U32						mNumber;		// as in LLMessageTemplate::mMessageNumber
+	EMsgFrequency			mFrequency;
+	const LLMsgBlockLayout*	mBlocks;
+	S32						mBlockCount;
+};
+
+// Value a field of the given type is read into by LLDecodedMessage::get(),
+// only types that need no conversion from the wire have one.
+template<EMsgVariableType TYPE> struct LLMsgValue;
+template<> struct LLMsgValue<MVT_U8> { typedef U8 type_t; };
+template<> struct LLMsgValue<MVT_U16> { typedef U16 type_t; };
+template<> struct LLMsgValue<MVT_U32> { typedef U32 type_t; };
+template<> struct LLMsgValue<MVT_U64> { typedef U64 type_t; };
+template<> struct LLMsgValue<MVT_S8> { typedef S8 type_t; };
+template<> struct LLMsgValue<MVT_S16> { typedef S16 type_t; };
+template<> struct LLMsgValue<MVT_S32> { typedef S32 type_t; };
+template<> struct LLMsgValue<MVT_S64> { typedef S64 type_t; };
+template<> struct LLMsgValue<MVT_F32> { typedef F32 type_t; };
+template<> struct LLMsgValue<MVT_F64> { typedef F64 type_t; };
+template<> struct LLMsgValue<MVT_BOOL> { typedef U8 type_t; };
+template<> struct LLMsgValue<MVT_IP_ADDR> { typedef U32 type_t; };
+template<> struct LLMsgValue<MVT_LLUUID> { typedef LLUUID type_t; };
+
+// A field of a generated layout, e.g. LLMessageLayouts::LayerData::LayerID::Type
+template<const LLMsgLayout& MESSAGE, S32 BLOCK, S32 FIELD>
+struct LLMsgField
+{
+	static constexpr const LLMsgLayout& LAYOUT = MESSAGE;
+	static constexpr S32 BLOCK_INDEX = BLOCK;
+	static constexpr S32 FIELD_INDEX = FIELD;
+	static constexpr S32 FIELD_COUNT = MESSAGE.mBlocks[BLOCK].mFieldCount;
+	static constexpr EMsgVariableType TYPE = MESSAGE.mBlocks[BLOCK].mFields[FIELD].mType;
+	static constexpr S32 SIZE = MESSAGE.mBlocks[BLOCK].mFields[FIELD].mSize;
+};
+
+#endif // LL_LLMESSAGELAYOUT_H
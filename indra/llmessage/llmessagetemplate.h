@@ -31,6 +31,8 @@
 #include "llstl.h"
 #include "llindexedvector.h"
 
+class LLMessageDecoder;
+
 class LLMsgVarData
 {
 public:
@@ -279,7 +281,8 @@ public:
 		mTotalDecodeTime(0.f),
 		mMaxDecodeTimePerMsg(0.f),
 		mBanFromTrusted(false),
-		mBanFromUntrusted(false)
+		mBanFromUntrusted(false),
+		mDecoder(nullptr)
 	{
 		mName = LLMessageStringTable::getInstance()->getString(name);
 	}
@@ -407,6 +410,8 @@ public:
 	bool									mBanFromTrusted;
 	bool									mBanFromUntrusted;
 
+	const LLMessageDecoder*					mDecoder;			// compiled layout decoder, null to decode it the generic way
+
 private:
 	// message handler function (this is set by each application)
 	typedef std::vector<std::function<void(LLMessageSystem *msgsystem)>> callback_list_t;
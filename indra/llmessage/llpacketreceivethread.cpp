@@ -0,0 +1,181 @@
+/**
+ * @file llpacketreceivethread.cpp
+ * @brief Thread draining the message system socket ahead of the main thread
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketreceivethread.h"
+
+#if LL_WINDOWS
+	#include "llwin32headerslean.h"
+#else
+	#include <netinet/in.h>
+#endif
+
+#include "llproxy.h"
+#include "lltrace.h"
+#include "lltracethreadrecorder.h"
+#include "message.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// Long enough to be idle, short enough for LLThread::shutdown() not to wait on it
+	const S32 RECEIVE_WAIT_MS = 50;
+
+	LLTrace::CountStatHandle<> sPacketsReceived("udp_packets_received", "Packets pulled from the socket by the receive thread");
+	LLTrace::CountStatHandle<> sReceiveBatches("udp_receive_batches", "Socket reads by the receive thread");
+	LLTrace::SampleStatHandle<> sReceiveQueueDepth("udp_receive_queue_depth", "Packets received but not yet handled by the main thread");
+}
+
+LLPacketReceiveThread::LLPacketReceiveThread(S32 socket)
+	: LLThread("packetreceive"),
+	  mSocket(socket),
+	  mPackets(new Packet[RING_SIZE]),
+	  mHead(0),
+	  mTail(0),
+	  mSOCKSProxy(LLProxy::isSOCKSProxyEnabled())
+{
+}
+
+LLPacketReceiveThread::~LLPacketReceiveThread()
+{
+	shutdown();
+	delete[] mPackets;
+}
+
+const LLPacketReceiveThread::Packet* LLPacketReceiveThread::front()
+{
+	mSOCKSProxy.store(LLProxy::isSOCKSProxyEnabled(), std::memory_order_relaxed);
+
+	const U32 tail = mTail.load(std::memory_order_relaxed);
+	const U32 depth = mHead.load(std::memory_order_acquire) - tail;
+	sample(sReceiveQueueDepth, depth);
+	return depth ? &mPackets[tail & (RING_SIZE - 1)] : nullptr;
+}
+
+void LLPacketReceiveThread::pop()
+{
+	mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+U32 LLPacketReceiveThread::size() const
+{
+	return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+}
+
+// virtual
+void LLPacketReceiveThread::run()
+{
+	LLNetPacket batch[BATCH_SIZE];
+
+	while (!isQuitting())
+	{
+		const U32 head = mHead.load(std::memory_order_relaxed);
+		const U32 room = RING_SIZE - (head - mTail.load(std::memory_order_acquire));
+		if (!room)
+		{
+			// The main thread is behind, the socket buffer keeps the rest meanwhile
+			std::this_thread::sleep_for(1ms);
+			continue;
+		}
+		if (!wait_for_packet(mSocket, RECEIVE_WAIT_MS))
+		{
+			continue;
+		}
+
+		const S32 count = llmin((S32)room, BATCH_SIZE);
+		for (S32 i = 0; i < count; ++i)
+		{
+			batch[i].mBuffer = (char*)mPackets[(head + i) & (RING_SIZE - 1)].mData;
+		}
+		const S32 received = receive_packets(mSocket, batch, count);
+		for (S32 i = 0; i < received; ++i)
+		{
+			Packet& packet = mPackets[(head + i) & (RING_SIZE - 1)];
+			packet.mSize = batch[i].mSize;
+			packet.mSender = LLHost(batch[i].mSenderIP, batch[i].mSenderPort);
+			packet.mReceivingIF = LLHost(batch[i].mReceivingIP, INVALID_PORT);
+			decode(packet);
+		}
+		if (received)
+		{
+			mHead.store(head + received, std::memory_order_release);
+			add(sPacketsReceived, received);
+			add(sReceiveBatches, 1);
+			LLTrace::get_thread_recorder()->pushToParent();
+		}
+	}
+
+	LLTrace::get_thread_recorder()->pushToParent();
+}
+
+void LLPacketReceiveThread::decode(Packet& packet)
+{
+	if (mSOCKSProxy.load(std::memory_order_relaxed))
+	{
+		if (packet.mSize > SOCKS_HEADER_SIZE)
+		{
+			// *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+			proxywrap_t header;
+			memcpy(&header, packet.mData, sizeof(header));
+			packet.mSender = LLHost(header.addr, ntohs(header.port));
+			packet.mSize -= SOCKS_HEADER_SIZE;
+			memmove(packet.mData, packet.mData + SOCKS_HEADER_SIZE, packet.mSize);
+		}
+		else
+		{
+			packet.mSize = 0;
+		}
+	}
+
+	// The same checks LLMessageSystem::checkMessages() makes on appended acks
+	packet.mBodySize = packet.mSize;
+	packet.mExpandedSize = 0;
+	if (packet.mSize < LL_MINIMUM_VALID_PACKET_SIZE)
+	{
+		return;
+	}
+	if (packet.mData[0] & LL_ACK_FLAG)
+	{
+		const S32 acks = packet.mData[--packet.mBodySize];
+		if (packet.mBodySize >= (S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE))
+		{
+			packet.mBodySize -= acks * sizeof(TPACKETID);
+		}
+		else
+		{
+			packet.mBodySize = -1;
+			return;
+		}
+	}
+
+	if (packet.mData[0] & LL_ZERO_CODE_FLAG)
+	{
+		// A packet that would not fit is left to LLMessageSystem::zeroCodeExpand(), which reports it
+		packet.mExpandedSize = zero_code_expand(packet.mData, packet.mBodySize, packet.mExpanded, NET_BUFFER_SIZE);
+	}
+}
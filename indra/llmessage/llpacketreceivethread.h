@@ -0,0 +1,84 @@
+/**
+ * @file llpacketreceivethread.h
+ * @brief Thread draining the message system socket ahead of the main thread
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETRECEIVETHREAD_H
+#define LL_LLPACKETRECEIVETHREAD_H
+
+#include <atomic>
+
+#include "llhost.h"
+#include "llproxy.h"
+#include "llthread.h"
+#include "net.h"
+
+// Pulls datagrams off the socket in batches, into a fixed pool of packet
+// slots used as a single producer, single consumer ring, so a burst is not
+// left in the socket buffer until the next frame. Work that needs no circuit
+// state (removing the SOCKS header, checking the appended acks, zero code
+// expansion) is done here. Everything else, acks included, stays with
+// LLMessageSystem on the main thread.
+//
+// When the ring is full the thread stops reading, and the socket buffer
+// holds the rest as it did before there was a thread.
+class LLPacketReceiveThread final : public LLThread
+{
+public:
+	struct Packet
+	{
+		LLHost	mSender;
+		LLHost	mReceivingIF;
+		S32		mSize;			// of mData
+		S32		mBodySize;		// mSize less the appended acks, -1 when their count is malformed
+		S32		mExpandedSize;	// of mExpanded, 0 when not zero coded or it would not fit
+		U8		mData[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];
+		U8		mExpanded[NET_BUFFER_SIZE];
+	};
+
+	// Power of 2
+	static constexpr U32 RING_SIZE = 256;
+	static constexpr S32 BATCH_SIZE = 32;
+
+	LLPacketReceiveThread(S32 socket);
+	~LLPacketReceiveThread();
+
+	// Main thread side. The front packet stays valid until pop().
+	const Packet* front();
+	void pop();
+	U32 size() const;
+
+private:
+	void run() override;
+	void decode(Packet& packet);
+
+	S32 mSocket;
+	Packet* mPackets;
+	std::atomic<U32> mHead;		// next slot the thread fills
+	std::atomic<U32> mTail;		// next slot the main thread reads
+	// LLProxy's UDP setting, which only the main thread may read, refreshed by front()
+	std::atomic<bool> mSOCKSProxy;
+};
+
+#endif
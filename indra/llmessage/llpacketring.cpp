@@ -56,7 +56,8 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mLastReceived(nullptr)
 {
 }
 
@@ -69,6 +70,8 @@ LLPacketRing::~LLPacketRing ()
 ///////////////////////////////////////////////////////////
 void LLPacketRing::cleanup ()
 {
+	stopReceiveThread();
+
 	LLPacketBuffer *packetp;
 
 	while (!mReceiveQueue.empty())
@@ -117,6 +120,46 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
 	mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::startReceiveThread(S32 socket)
+{
+	if (!mReceiveThread)
+	{
+		mReceiveThread = std::make_unique<LLPacketReceiveThread>(socket);
+		mReceiveThread->start();
+		LL_INFOS("Messaging") << "Receiving packets on a thread of their own" << LL_ENDL;
+	}
+}
+
+void LLPacketRing::stopReceiveThread()
+{
+	mLastReceived = nullptr;
+	mReceiveThread.reset();
+}
+
+void LLPacketRing::releaseLastReceived()
+{
+	if (mLastReceived)
+	{
+		mLastReceived = nullptr;
+		mReceiveThread->pop();
+	}
+}
+
+S32 LLPacketRing::receiveFromThread(char *datap)
+{
+	const LLPacketReceiveThread::Packet* packetp = mReceiveThread->front();
+	if (!packetp)
+	{
+		return 0;
+	}
+	memcpy(datap, packetp->mData, packetp->mSize);	/*Flawfinder: ignore*/
+	mLastSender = packetp->mSender;
+	mLastReceivingIF = packetp->mReceivingIF;
+	// Held until the next receive, the message system may use its expanded body
+	mLastReceived = packetp;
+	return packetp->mSize;
+}
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -159,6 +202,8 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 {
 	S32 packet_size = 0;
 
+	releaseLastReceived();
+
 	// If using the throttle, simulate a limited size input buffer.
 	if (mUseInThrottle)
 	{
@@ -168,7 +213,23 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		while (!done)
 		{
 			LLPacketBuffer *packetp;
-			packetp = new LLPacketBuffer(socket);
+			if (mReceiveThread)
+			{
+				const LLPacketReceiveThread::Packet* receivedp = mReceiveThread->front();
+				if (receivedp)
+				{
+					packetp = new LLPacketBuffer(receivedp->mSender, (const char*)receivedp->mData, receivedp->mSize, receivedp->mReceivingIF);
+					mReceiveThread->pop();
+				}
+				else
+				{
+					packetp = new LLPacketBuffer(LLHost(), nullptr, 0);
+				}
+			}
+			else
+			{
+				packetp = new LLPacketBuffer(socket);
+			}
 
 			if (packetp->getSize())
 			{
@@ -225,7 +286,12 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	else
 	{
 		// no delay, pull straight from net
-		if (LLProxy::isSOCKSProxyEnabled())
+		if (mReceiveThread)
+		{
+			// or from what the receive thread pulled from it
+			packet_size = receiveFromThread(datap);
+		}
+		else if (LLProxy::isSOCKSProxyEnabled())
 		{
 			U8 buffer[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];
 			packet_size = receive_packet(socket, static_cast<char*>(static_cast<void*>(buffer)));
@@ -251,7 +317,10 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 			mLastSender = ::get_sender();
 		}
 
-		mLastReceivingIF = ::get_receiving_interface();
+		if (!mReceiveThread)
+		{
+			mLastReceivingIF = ::get_receiving_interface();
+		}
 
 		if (packet_size)  // did we actually get a packet?
 		{
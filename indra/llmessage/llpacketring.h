@@ -28,10 +28,12 @@
 #ifndef LL_LLPACKETRING_H
 #define LL_LLPACKETRING_H
 
+#include <memory>
 #include <queue>
 
 #include "llhost.h"
 #include "llpacketbuffer.h"
+#include "llpacketreceivethread.h"
 #include "llproxy.h"
 #include "llthrottle.h"
 #include "net.h"
@@ -53,6 +55,14 @@ public:
 	S32  receivePacket (S32 socket, char *datap);
 	S32  receiveFromRing (S32 socket, char *datap);
 
+	// Receive from the socket on a thread of its own. Stop it before closing the socket.
+	void startReceiveThread(S32 socket);
+	void stopReceiveThread();
+	bool isReceiveThreaded() const				{ return mReceiveThread != nullptr; }
+	// The packet last returned by receivePacket() when it came from the receive
+	// thread unthrottled, with the work done on it there. Valid until the next receivePacket().
+	const LLPacketReceiveThread::Packet* getLastReceived() const	{ return mLastReceived; }
+
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, const LLHost& host);
 
 	inline LLHost getLastSender();
@@ -83,8 +93,13 @@ protected:
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 
+	std::unique_ptr<LLPacketReceiveThread> mReceiveThread;
+	const LLPacketReceiveThread::Packet* mLastReceived;
+
 private:
 	BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, const LLHost& host);
+	S32  receiveFromThread(char *datap);
+	void releaseLastReceived();
 };
 
 
@@ -60,6 +60,7 @@ void LLTemplateMessageReader::clearMessage()
 	mCurrentRMessageTemplate = nullptr;
 	delete mCurrentRMessageData;
 	mCurrentRMessageData = nullptr;
+	mDecodedMessage.clear();
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -71,6 +72,12 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
+	if (mDecodedMessage.isDecoded())
+	{
+		mDecodedMessage.getData(blockname, varname, datap, size, blocknum, max_size);
+		return;
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		LL_ERRS() << "Invalid mCurrentMessageData in getData!" << LL_ENDL;
@@ -159,6 +166,11 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
+	if (mDecodedMessage.isDecoded())
+	{
+		return mDecodedMessage.getNumberOfBlocks(blockname);
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
@@ -186,6 +198,11 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mDecodedMessage.isDecoded())
+	{
+		return mDecodedMessage.getSize(blockname, varname);
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
@@ -234,6 +251,11 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mDecodedMessage.isDecoded())
+	{
+		return mDecodedMessage.getSize(blockname, blocknum, varname);
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
@@ -535,19 +557,8 @@ void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S3
 
 static LLTrace::BlockTimerStatHandle FTM_PROCESS_MESSAGES("Process Messages");
 
-// decode a given message
-BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, BOOL custom)
+BOOL LLTemplateMessageReader::decodeBlocks(const U8* buffer, S32 decode_pos, const LLHost& sender, BOOL custom)
 {
-	llassert( mReceiveSize >= 0 );
-	llassert( mCurrentRMessageTemplate);
-	llassert( !mCurrentRMessageData );
-	delete mCurrentRMessageData; // just to make sure
-
-	// The offset tells us how may bytes to skip after the end of the
-	// message name.
-	U8 offset = buffer[PHL_OFFSET];
-	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
-
 	// create base working data set
 	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
 	
@@ -706,6 +717,31 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 		LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
 		return FALSE;
 	}
+	return TRUE;
+}
+
+// decode a given message
+BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, BOOL custom)
+{
+	llassert( mReceiveSize >= 0 );
+	llassert( mCurrentRMessageTemplate);
+	llassert( !mCurrentRMessageData );
+	delete mCurrentRMessageData; // just to make sure
+
+	// The offset tells us how may bytes to skip after the end of the
+	// message name.
+	U8 offset = buffer[PHL_OFFSET];
+	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+
+	// Messages with a compiled layout are only indexed, anything unusual
+	// about them is left to the generic decode to report
+	mDecodedMessage.clear();
+	const LLMessageDecoder* decoder = custom ? nullptr : mCurrentRMessageTemplate->mDecoder;
+	if (!(decoder && mDecodedMessage.decode(decoder, buffer, decode_pos, mReceiveSize))
+		&& !decodeBlocks(buffer, decode_pos, sender, custom))
+	{
+		return FALSE;
+	}
 
 	if (!custom)
 	{
@@ -837,6 +873,12 @@ void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
     {
         return;
     }
+	if (!mCurrentRMessageData && mDecodedMessage.isDecoded())
+	{
+		// Only built when a handler forwards the message
+		LLTemplateMessageReader* self = const_cast<LLTemplateMessageReader*>(this);
+		self->decodeBlocks(mDecodedMessage.getBuffer(), mDecodedMessage.getDecodePos(), LLHost(), TRUE);
+	}
 	builder.copyFromMessageData(*mCurrentRMessageData);
 }
 
@@ -845,3 +887,8 @@ LLMessageTemplate* LLTemplateMessageReader::getTemplate()
 	return mCurrentRMessageTemplate;
 }
 
+const LLDecodedMessage* LLTemplateMessageReader::getDecodedMessage() const
+{
+	return mDecodedMessage.isDecoded() ? &mDecodedMessage : nullptr;
+}
+
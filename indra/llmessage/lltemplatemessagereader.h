@@ -27,6 +27,7 @@
 #ifndef LL_LLTEMPLATEMESSAGEREADER_H
 #define LL_LLTEMPLATEMESSAGEREADER_H
 
+#include "lldecodedmessage.h"
 #include "llmessagereader.h"
 
 class LLMessageTemplate;
@@ -107,6 +108,9 @@ public:
 	BOOL decodeData(const U8* buffer, const LLHost& sender, BOOL custom = FALSE);
 	LLMessageTemplate* getTemplate();
 
+	// Fields of the current message when it has a compiled layout, else null
+	const LLDecodedMessage* getDecodedMessage() const;
+
 private:
 
 	void getData(const char *blockname, const char *varname, void *datap, 
@@ -115,11 +119,15 @@ private:
 	BOOL decodeTemplate(const U8* buffer, S32 buffer_size,  // inputs
 						LLMessageTemplate** msg_template, BOOL custom = FALSE);	// outputs
 
+	// Copies every field into mCurrentRMessageData
+	BOOL decodeBlocks(const U8* buffer, S32 decode_pos, const LLHost& sender, BOOL custom);
+
 	void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
 	LLMsgData* mCurrentRMessageData;
+	LLDecodedMessage mDecodedMessage;
 	message_template_number_map_t& mMessageNumbers;
 };
 
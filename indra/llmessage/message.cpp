@@ -327,6 +327,7 @@ LLMessageSystem::~LLMessageSystem()
 	
 	if (!mbError)
 	{
+		mPacketRing.stopReceiveThread();
 		end_net(mSocket);
 	}
 	mSocket = 0;
@@ -577,8 +578,16 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 				}
 			}
 
-			// process the message as normal
-			mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			// process the message as normal, the receive thread may have expanded it already
+			const LLPacketReceiveThread::Packet* received = faked_message ? nullptr : mPacketRing.getLastReceived();
+			if (received && received->mExpandedSize && (received->mBodySize == receive_size))
+			{
+				mIncomingCompressedSize = zeroCodeExpanded(&buffer, &receive_size, received->mExpanded, received->mExpandedSize);
+			}
+			else
+			{
+				mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			}
 			U32 cur_rec_pkt_id = 0U;
 			memcpy(&cur_rec_pkt_id, buffer + PHL_PACKET_ID, sizeof(cur_rec_pkt_id));
 			mCurrentRecvPacketID = ntohl(cur_rec_pkt_id);
@@ -2874,32 +2883,16 @@ S32 LLMessageSystem::zeroCodeAdjustCurrentSendTotal()
 
 
 
-S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
+S32 zero_code_expand(const U8* in, S32 in_size, U8* out, S32 out_size)
 {
-	if ((*data_size ) < LL_MINIMUM_VALID_PACKET_SIZE)
-	{
-		LL_WARNS("Messaging") << "zeroCodeExpand() called with data_size of " << *data_size
-			<< LL_ENDL;
-	}
-
-	mTotalBytesIn += *data_size;
-
-	// if we're not zero-coded, simply return.
-	if (!(*data[0] & LL_ZERO_CODE_FLAG))
+	if (in_size < LL_PACKET_ID_SIZE || out_size < LL_PACKET_ID_SIZE)
 	{
 		return 0;
 	}
 
-	S32 in_size = *data_size;
-	mCompressedPacketsIn++;
-	mCompressedBytesIn += *data_size;
-	
-	*data[0] &= (~LL_ZERO_CODE_FLAG);
-
-	S32 count = (*data_size);  
-	
-	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
+	const U8 *inptr = in;
+	U8 *outptr = out;
+	S32 count = in_size;
 
 // skip the packet id field
 
@@ -2908,6 +2901,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		count--;
 		*outptr++ = *inptr++;
 	}
+	out[0] &= (~LL_ZERO_CODE_FLAG);
 
 // reconstruct encoded packet, keeping track of net size gain
 
@@ -2916,26 +2910,19 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 	while (count--)
 	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+		if (outptr - out > out_size - 1)
 		{
-			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
-			break;
+			return 0;
 		}
 		if (!((*outptr++ = *inptr++)))
 		{
 			while (((count--)) && (!(*inptr)))
 			{
+				if (outptr - out > out_size - 256)
+				{
+					return 0;
+				}
 				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
-  				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
-					count = -1;
-					break;
-  				}
 				memset(outptr,0,255);
 				outptr += 255;
 			}
@@ -2945,23 +2932,69 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 				break;
 			}
 
-			else
+			if (outptr - out > out_size - (*inptr))
 			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
-				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
-				}
-				memset(outptr,0,(*inptr) - 1);
-				outptr += ((*inptr) - 1);
-				inptr++;
+				return 0;
 			}
+			memset(outptr,0,(*inptr) - 1);
+			outptr += ((*inptr) - 1);
+			inptr++;
 		}		
 	}
+
+	return (S32)(outptr - out);
+}
+
+S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
+{
+	if ((*data_size ) < LL_MINIMUM_VALID_PACKET_SIZE)
+	{
+		LL_WARNS("Messaging") << "zeroCodeExpand() called with data_size of " << *data_size
+			<< LL_ENDL;
+	}
+
+	mTotalBytesIn += *data_size;
+
+	// if we're not zero-coded, simply return.
+	if (!(*data[0] & LL_ZERO_CODE_FLAG))
+	{
+		return 0;
+	}
+
+	S32 in_size = *data_size;
+	mCompressedPacketsIn++;
+	mCompressedBytesIn += *data_size;
 	
+	*data[0] &= (~LL_ZERO_CODE_FLAG);
+
+	S32 expanded_size = zero_code_expand(*data, in_size, mEncodedRecvBuffer, MAX_BUFFER_SIZE);
+	if (!expanded_size && in_size >= LL_PACKET_ID_SIZE)
+	{
+		LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size" << LL_ENDL;
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+	}
+	
+	*data = mEncodedRecvBuffer;
+	*data_size = expanded_size;
+	mUncompressedBytesIn += *data_size;
+
+	return(in_size);
+}
+
+// Takes the body zero code expanded off the main thread, with the same
+// bookkeeping as zeroCodeExpand()
+S32 LLMessageSystem::zeroCodeExpanded(U8** data, S32* data_size, const U8* expanded, S32 expanded_size)
+{
+	S32 in_size = *data_size;
+	mTotalBytesIn += in_size;
+	mCompressedPacketsIn++;
+	mCompressedBytesIn += in_size;
+
+	*data[0] &= (~LL_ZERO_CODE_FLAG);
+
+	memcpy(mEncodedRecvBuffer, expanded, expanded_size);	/* Flawfinder: ignore */
 	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
+	*data_size = expanded_size;
 	mUncompressedBytesIn += *data_size;
 
 	return(in_size);
@@ -2977,6 +3010,7 @@ void LLMessageSystem::addTemplate(LLMessageTemplate *templatep)
 	}
 	mMessageTemplates[templatep->mName] = templatep;
 	mMessageNumbers[templatep->mMessageNumber] = templatep;
+	templatep->mDecoder = LLMessageDecoder::find(*templatep);
 }
 
 
@@ -3095,6 +3129,15 @@ char* LLMessageSystem::getMessageName()
 	return const_cast<char*>(mMessageReader->getMessageName());
 }
 
+const LLDecodedMessage* LLMessageSystem::getDecodedMessage() const
+{
+	if (mMessageReader != mTemplateMessageReader)
+	{
+		return nullptr;
+	}
+	return mTemplateMessageReader->getDecodedMessage();
+}
+
 const LLUUID& LLMessageSystem::getSenderID() const
 {
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(mLastSender);
@@ -184,6 +184,7 @@ class LLSDMessageBuilder;
 class LLMessageReader;
 class LLTemplateMessageReader;
 class LLSDMessageReader;
+class LLDecodedMessage;
 
 
 
@@ -345,6 +346,10 @@ public:
 
 	char	*getMessageName();
 
+	// Fields of the message being handled, to read by their offset when it
+	// came as a template message with a compiled layout, else null
+	const LLDecodedMessage* getDecodedMessage() const;
+
 	const LLHost& getSender() const;
 	U32		getSenderIP() const;			// getSender() is preferred
 	U32		getSenderPort() const;		// getSender() is preferred
@@ -455,6 +460,7 @@ public:
 
 	S32     zeroCode(U8 **data, S32 *data_size);
 	S32		zeroCodeExpand(U8 **data, S32 *data_size);
+	S32		zeroCodeExpanded(U8 **data, S32 *data_size, const U8 *expanded, S32 expanded_size);
 	S32		zeroCodeAdjustCurrentSendTotal();
 
 	// Uses ping-based retry
@@ -858,6 +864,12 @@ void end_messaging_system(bool print_summary = true);
 
 void null_message_callback(LLMessageSystem *msg, void **data);
 
+// Expands the zero coded packet in, in_size bytes from its packet id field
+// on, into out, which holds out_size bytes, clearing the zero code flag of
+// the copy. Returns the expanded size, 0 if in is shorter than the packet id
+// field or would expand past out_size.
+S32 zero_code_expand(const U8* in, S32 in_size, U8* out, S32 out_size);
+
 //
 // Inlines
 //
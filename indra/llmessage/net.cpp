@@ -39,6 +39,7 @@
 	#include <netinet/in.h>
 	#include <arpa/inet.h>
 	#include <fcntl.h>
+	#include <poll.h>
 	#include <cerrno>
 #endif
 
@@ -336,6 +337,39 @@ S32 receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 count)
+{
+	// No batched receive on Windows, one recvfrom() per datagram
+	S32 received = 0;
+	for (; received < count; ++received)
+	{
+		struct sockaddr_in from;
+		int addr_size = sizeof(from);
+		LLNetPacket& packet = packets[received];
+		int nRet = recvfrom(hSocket, packet.mBuffer, NET_BUFFER_SIZE, 0, (struct sockaddr*)&from, &addr_size);
+		if (nRet == SOCKET_ERROR || nRet == 0)
+		{
+			break;
+		}
+		packet.mSize = nRet;
+		packet.mSenderIP = from.sin_addr.s_addr;
+		packet.mSenderPort = ntohs(from.sin_port);
+		packet.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+	}
+	return received;
+}
+
+bool wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	fd_set read_set;
+	FD_ZERO(&read_set);
+	FD_SET(hSocket, &read_set);
+	struct timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+	return select(0, &read_set, NULL, NULL, &timeout) > 0;
+}
+
 // Returns TRUE on success.
 BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort)
 {
@@ -597,6 +631,86 @@ int receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+#if LL_LINUX
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 count)
+{
+	const S32 MAX_BATCH = 64;
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iovs[MAX_BATCH];
+	struct sockaddr_in from[MAX_BATCH];
+	char cmsgs[MAX_BATCH][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	count = llmin(count, MAX_BATCH);
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = packets[i].mBuffer;
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+		msgs[i].msg_hdr.msg_name = &from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received <= 0)
+	{
+		return 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLNetPacket& packet = packets[i];
+		packet.mSize = msgs[i].msg_len;
+		packet.mSenderIP = from[i].sin_addr.s_addr;
+		packet.mSenderPort = ntohs(from[i].sin_port);
+		packet.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+		for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsgptr))
+		{
+			if (cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO)
+			{
+				// Specified rather than routed, as recvfrom_destip() does
+				packet.mReceivingIP = ((in_pktinfo*)CMSG_DATA(cmsgptr))->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+	return received;
+}
+#else
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 count)
+{
+	// No batched receive here, one recvfrom() per datagram
+	S32 received = 0;
+	for (; received < count; ++received)
+	{
+		struct sockaddr_in from;
+		socklen_t addr_size = sizeof(from);
+		LLNetPacket& packet = packets[received];
+		int nRet = recvfrom(hSocket, packet.mBuffer, NET_BUFFER_SIZE, 0, (struct sockaddr*)&from, &addr_size);
+		if (nRet <= 0)
+		{
+			break;
+		}
+		packet.mSize = nRet;
+		packet.mSenderIP = from.sin_addr.s_addr;
+		packet.mSenderPort = ntohs(from.sin_port);
+		packet.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+	}
+	return received;
+}
+#endif
+
+bool wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	struct pollfd fd;
+	fd.fd = hSocket;
+	fd.events = POLLIN;
+	fd.revents = 0;
+	return poll(&fd, 1, timeout_ms) > 0 && (fd.revents & POLLIN);
+}
+
 BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient, int nPort)
 {
 	int		ret;
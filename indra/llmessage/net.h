@@ -45,6 +45,24 @@ S32		receive_packet(int hSocket, char * receiveBuffer);
 
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// One datagram of a batched receive. mBuffer must hold NET_BUFFER_SIZE bytes.
+struct LLNetPacket
+{
+	char*	mBuffer;
+	S32		mSize;
+	U32		mSenderIP;
+	U32		mSenderPort;
+	U32		mReceivingIP;	// INVALID_HOST_IP_ADDRESS when the platform does not tell
+};
+
+// Receives up to count waiting datagrams, in a single recvmmsg() call on Linux.
+// Returns the number received, 0 when none is waiting or on error.
+// Does not touch the state get_sender() and get_receiving_interface() report.
+S32		receive_packets(int hSocket, LLNetPacket* packets, S32 count);
+
+// Blocks until a datagram is waiting or timeout_ms has passed. Returns true if one is waiting.
+bool	wait_for_packet(int hSocket, S32 timeout_ms);
+
 //void	get_sender(char * tmp);
 LLHost	get_sender();
 U32		get_sender_port();
@@ -33,7 +33,8 @@
 #include "patch_code.h"
 #include "llbitpack.h"
 
-U32 gPatchSize, gWordBits;
+// Per thread, so that several threads can each decode a LayerData packet
+thread_local U32 gPatchSize, gWordBits;
 
 void	init_patch_coding(LLBitPack &bitpack)
 {
@@ -88,4 +88,9 @@ void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
 
+// Same as decompress_patch() for NORMAL_PATCH_SIZE and LARGE_PATCH_SIZE patches,
+// vectorized and independent of the state set by the routines above, so it can
+// run on any thread. Rows of the patch are stride heights apart.
+void decompress_patch_simd(F32 *patch, S32 stride, const S32 *cpatch, const LLPatchHeader *ph, S32 size);
+
 #endif
@@ -29,6 +29,7 @@
 #include "llmath.h"
 //#include "vmath.h"
 #include "v3math.h"
+#include "llvector4a.h"
 #include "patch_dct.h"
 
 LLGroupHeader	*gGOPP;
@@ -39,14 +40,14 @@ void set_group_of_patch_header(LLGroupHeader *gopp)
 }
 
 F32 gPatchDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-void build_patch_dequantize_table(S32 size)
+void build_patch_dequantize_table(S32 size, F32 *table)
 {
 	S32 i, j;
 	for (j = 0; j < size; j++)
 	{
 		for (i = 0; i < size; i++)
 		{
-			gPatchDequantizeTable[j*size + i] = (1.f + 2.f*(i+j));
+			table[j*size + i] = (1.f + 2.f*(i+j));
 		}
 	}
 }
@@ -55,7 +56,7 @@ S32	gCurrentDeSize = 0;
 
 F32	gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void setup_patch_icosines(S32 size)
+void setup_patch_icosines(S32 size, F32 *icosines)
 {
 	S32 n, u;
 	F32 oosob = F_PI*0.5f/size;
@@ -64,14 +65,14 @@ void setup_patch_icosines(S32 size)
 	{
 		for (n = 0; n < size; n++)
 		{
-			gPatchICosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
+			icosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
 		}
 	}
 }
 
 S32	gDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void build_decopy_matrix(S32 size)
+void build_decopy_matrix(S32 size, S32 *decopy_matrix)
 {
 	S32 i, j, count;
 	BOOL	b_diag = FALSE;
@@ -84,7 +85,7 @@ void build_decopy_matrix(S32 size)
 	while (  (i < size)
 		   &&(j < size))
 	{
-		gDeCopyMatrix[j*size + i] = count;
+		decopy_matrix[j*size + i] = count;
 
 		count++;
 
@@ -140,9 +141,9 @@ void init_patch_decompressor(S32 size)
 	if (size != gCurrentDeSize)
 	{
 		gCurrentDeSize = size;
-		build_patch_dequantize_table(size);
-		setup_patch_icosines(size);
-		build_decopy_matrix(size);
+		build_patch_dequantize_table(size, gPatchDequantizeTable);
+		setup_patch_icosines(size, gPatchICosines);
+		build_decopy_matrix(size, gDeCopyMatrix);
 	}
 }
 
@@ -682,3 +683,132 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
 	}
 }
 
+
+//============================================================================
+// decompress_patch_simd(): the same dequantization and IDCT as
+// decompress_patch(), four heights at a time, with tables of its own so that
+// patches of either size can be decompressed on any thread.
+
+namespace
+{
+	template<S32 SIZE>
+	struct LLPatchIDCTTables
+	{
+		LLPatchIDCTTables()
+		{
+			build_patch_dequantize_table(SIZE, mDequantize);
+			setup_patch_icosines(SIZE, mWeights);
+			build_decopy_matrix(SIZE, mDecopy);
+			// The DC term is weighted by OO_SQRT2 rather than cos(0)
+			for (S32 n = 0; n < SIZE; n++)
+			{
+				mWeights[n] = OO_SQRT2;
+			}
+		}
+
+		LL_ALIGN_16(F32 mWeights[SIZE*SIZE]);
+		LL_ALIGN_16(F32 mDequantize[SIZE*SIZE]);
+		S32 mDecopy[SIZE*SIZE];
+	};
+
+	template<S32 SIZE>
+	void idct_patch_simd(F32 *patch, S32 stride, const S32 *cpatch, F32 mult, F32 addval)
+	{
+		constexpr S32 QUADS = SIZE/4;
+		static const LLPatchIDCTTables<SIZE> tables;
+
+		LL_ALIGN_16(F32 block[SIZE*SIZE]);
+		LL_ALIGN_16(F32 temp[SIZE*SIZE]);
+
+		// Dequantize, noting the last row and column holding a coefficient.
+		// Coefficients come in zigzag order up to an end of block, so past
+		// those the block is all zeroes and the IDCT can skip it.
+		S32 rows = 0;
+		S32 columns = 0;
+		const S32 *decopy = tables.mDecopy;
+		for (S32 j = 0; j < SIZE; j++)
+		{
+			for (S32 q = 0; q < QUADS; q++, decopy += 4)
+			{
+				const LLIQuad coefs = _mm_setr_epi32(cpatch[decopy[0]], cpatch[decopy[1]], cpatch[decopy[2]], cpatch[decopy[3]]);
+				const S32 offset = j*SIZE + q*4;
+				_mm_store_ps(block + offset, _mm_mul_ps(_mm_cvtepi32_ps(coefs), _mm_load_ps(tables.mDequantize + offset)));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(coefs, _mm_setzero_si128())) != 0xFFFF)
+				{
+					rows = j + 1;
+					columns = llmax(columns, q*4 + 4);
+				}
+			}
+		}
+
+		// Columns: row n of temp is the rows of block weighted by column n of the weights
+		for (S32 n = 0; n < SIZE; n++)
+		{
+			LLQuad acc[QUADS];
+			for (S32 q = 0; q < QUADS; q++)
+			{
+				acc[q] = _mm_setzero_ps();
+			}
+			for (S32 u = 0; u < rows; u++)
+			{
+				const LLQuad weight = _mm_set1_ps(tables.mWeights[u*SIZE + n]);
+				const F32 *row = block + u*SIZE;
+				for (S32 q = 0; q < QUADS; q++)
+				{
+					acc[q] = _mm_add_ps(acc[q], _mm_mul_ps(weight, _mm_load_ps(row + q*4)));
+				}
+			}
+			for (S32 q = 0; q < QUADS; q++)
+			{
+				_mm_store_ps(temp + n*SIZE + q*4, acc[q]);
+			}
+		}
+
+		// Lines: row j of the patch is the rows of the weights weighted by row j of temp,
+		// scaled by 2/SIZE and mapped to heights in one go
+		const LLQuad scale = _mm_set1_ps(mult*2.f/SIZE);
+		const LLQuad offset = _mm_set1_ps(addval);
+		for (S32 j = 0; j < SIZE; j++)
+		{
+			LLQuad acc[QUADS];
+			for (S32 q = 0; q < QUADS; q++)
+			{
+				acc[q] = _mm_setzero_ps();
+			}
+			const F32 *line = temp + j*SIZE;
+			for (S32 u = 0; u < columns; u++)
+			{
+				const LLQuad value = _mm_set1_ps(line[u]);
+				const F32 *weights = tables.mWeights + u*SIZE;
+				for (S32 q = 0; q < QUADS; q++)
+				{
+					acc[q] = _mm_add_ps(acc[q], _mm_mul_ps(value, _mm_load_ps(weights + q*4)));
+				}
+			}
+			F32 *out = patch + j*stride;
+			for (S32 q = 0; q < QUADS; q++)
+			{
+				_mm_storeu_ps(out + q*4, _mm_add_ps(_mm_mul_ps(acc[q], scale), offset));
+			}
+		}
+	}
+}
+
+void decompress_patch_simd(F32 *patch, S32 stride, const S32 *cpatch, const LLPatchHeader *ph, S32 size)
+{
+	S32		prequant = (ph->quant_wbits >> 4) + 2;
+	S32		quantize = 1<<prequant;
+	F32		ooq = 1.f/(F32)quantize;
+	F32		mult = ooq*ph->range;
+	F32		addval = mult*(F32)(1<<(prequant - 1))+ph->dc_offset;
+
+	llassert(size == NORMAL_PATCH_SIZE || size == LARGE_PATCH_SIZE);
+	if (size == NORMAL_PATCH_SIZE)
+	{
+		idct_patch_simd<NORMAL_PATCH_SIZE>(patch, stride, cpatch, mult, addval);
+	}
+	else
+	{
+		idct_patch_simd<LARGE_PATCH_SIZE>(patch, stride, cpatch, mult, addval);
+	}
+}
@@ -0,0 +1,254 @@
+/**
+ * @file llpacketreceivethread_test.cpp
+ * @brief Tests for the packet receive ring and zero code expansion
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketreceivethread.h"
+#include "../message.h"
+#include "../net.h"
+
+#include "lltimer.h"
+
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// As LLTemplateMessageBuilder zero codes a message: every run of zeroes
+	// after the packet id field becomes 0 [count]
+	std::vector<U8> zero_code(const std::vector<U8>& data)
+	{
+		std::vector<U8> out(data.begin(), data.begin() + LL_PACKET_ID_SIZE);
+		U8 num_zeroes = 0;
+		for (size_t i = LL_PACKET_ID_SIZE; i < data.size(); ++i)
+		{
+			if (!data[i])
+			{
+				if (num_zeroes)
+				{
+					if (++num_zeroes > 254)
+					{
+						out.push_back(num_zeroes);
+						num_zeroes = 0;
+					}
+				}
+				else
+				{
+					out.push_back(0);
+					num_zeroes = 1;
+				}
+			}
+			else
+			{
+				if (num_zeroes)
+				{
+					out.push_back(num_zeroes);
+					num_zeroes = 0;
+				}
+				out.push_back(data[i]);
+			}
+		}
+		if (num_zeroes)
+		{
+			out.push_back(num_zeroes);
+		}
+		out[0] |= LL_ZERO_CODE_FLAG;
+		return out;
+	}
+
+	// Packet id field followed by body_size bytes with runs of zeroes in them
+	std::vector<U8> make_body(U32 id, S32 body_size, S32 zero_run)
+	{
+		std::vector<U8> data(LL_PACKET_ID_SIZE + body_size, 0);
+		data[1] = (U8)(id >> 24);
+		data[2] = (U8)(id >> 16);
+		data[3] = (U8)(id >> 8);
+		data[4] = (U8)id;
+		for (S32 i = 0; i < body_size; ++i)
+		{
+			const bool zero = zero_run && (i / zero_run) % 2;
+			data[LL_PACKET_ID_SIZE + i] = zero ? 0 : (U8)(1 + (i + id) % 200);
+		}
+		return data;
+	}
+
+	U32 packet_id(const U8* data)
+	{
+		return ((U32)data[1] << 24) | ((U32)data[2] << 16) | ((U32)data[3] << 8) | data[4];
+	}
+}
+
+namespace tut
+{
+	struct packetreceivethread_data
+	{
+	};
+	typedef test_group<packetreceivethread_data> packetreceivethread_test;
+	typedef packetreceivethread_test::object packetreceivethread_object;
+	tut::packetreceivethread_test packetreceivethread("LLPacketReceiveThread");
+
+	template<> template<>
+	void packetreceivethread_object::test<1>()
+	{
+		set_test_name("Zero code expansion");
+		const S32 runs[] = { 0, 1, 3, 254, 255, 256, 300, 1000 };
+		for (S32 run : runs)
+		{
+			const std::vector<U8> body = make_body(run, 2000, run);
+			const std::vector<U8> coded = zero_code(body);
+			std::vector<U8> out(NET_BUFFER_SIZE);
+			const S32 size = zero_code_expand(coded.data(), (S32)coded.size(), out.data(), NET_BUFFER_SIZE);
+			ensure_equals("expanded size", size, (S32)body.size());
+			ensure("flag cleared", !(out[0] & LL_ZERO_CODE_FLAG));
+			ensure("input left alone", coded[0] & LL_ZERO_CODE_FLAG);
+			ensure("expanded", !memcmp(out.data(), body.data(), body.size()));
+		}
+
+		// Trailing zeroes, and 0 0 [count] wrapping past 256 zeroes
+		const U8 wrap[] = { LL_ZERO_CODE_FLAG, 0, 0, 0, 7, 0, 9, 0, 0, 0, 5, 3, 0, 2 };
+		std::vector<U8> out(NET_BUFFER_SIZE, 0xff);
+		const S32 size = zero_code_expand(wrap, sizeof(wrap), out.data(), NET_BUFFER_SIZE);
+		ensure_equals("wrapped size", size, LL_PACKET_ID_SIZE + 1 + 517 + 1 + 2);
+		ensure_equals("first byte", out[LL_PACKET_ID_SIZE], (U8)9);
+		for (S32 i = LL_PACKET_ID_SIZE + 1; i < LL_PACKET_ID_SIZE + 1 + 517; ++i)
+		{
+			ensure_equals("wrapped zeroes", out[i], (U8)0);
+		}
+		ensure_equals("after the run", out[LL_PACKET_ID_SIZE + 1 + 517], (U8)3);
+		ensure_equals("trailing zeroes", out[size - 1], (U8)0);
+	}
+
+	template<> template<>
+	void packetreceivethread_object::test<2>()
+	{
+		set_test_name("Zero code expansion past the buffer");
+		const S32 OUT_SIZE = 1024;
+		const S32 GUARD = 512;
+		std::vector<U8> out(OUT_SIZE + GUARD);
+
+		// Plain bytes, short runs, long runs, and a run wrapping past 256, running off the end
+		std::vector<std::vector<U8> > packets;
+		const S32 runs[] = { 0, 100, 600 };
+		for (S32 run : runs)
+		{
+			packets.push_back(zero_code(make_body(run, 3000, run)));
+		}
+		const U8 wrap[] = { LL_ZERO_CODE_FLAG, 0, 0, 0, 1, 0, 9, 0, 0, 0, 0, 0, 0, 5, 9 };
+		packets.push_back(std::vector<U8>(wrap, wrap + sizeof(wrap)));
+		for (const std::vector<U8>& coded : packets)
+		{
+			std::fill(out.begin(), out.end(), 0xee);
+			ensure_equals("too large", zero_code_expand(coded.data(), (S32)coded.size(), out.data(), OUT_SIZE), 0);
+			for (S32 i = OUT_SIZE; i < OUT_SIZE + GUARD; ++i)
+			{
+				ensure_equals("nothing written past the buffer", out[i], (U8)0xee);
+			}
+		}
+
+		// Just fits
+		const std::vector<U8> body = make_body(1, OUT_SIZE - LL_PACKET_ID_SIZE, 50);
+		const std::vector<U8> coded = zero_code(body);
+		ensure_equals("fits", zero_code_expand(coded.data(), (S32)coded.size(), out.data(), OUT_SIZE), OUT_SIZE);
+
+		// Shorter than the packet id field
+		ensure_equals("too short", zero_code_expand(coded.data(), LL_PACKET_ID_SIZE - 1, out.data(), OUT_SIZE), 0);
+	}
+
+	template<> template<>
+	void packetreceivethread_object::test<3>()
+	{
+		set_test_name("Ring keeps order when the main thread falls behind");
+		S32 socket = -1;
+		int port = NET_USE_OS_ASSIGNED_PORT;
+		ensure_equals("socket", start_net(socket, port), 0);
+		const U32 localhost = ip_string_to_u32("127.0.0.1");
+
+		// More than the ring holds, the socket buffer keeps the rest meanwhile
+		const U32 COUNT = LLPacketReceiveThread::RING_SIZE + 44;
+		{
+			LLPacketReceiveThread thread(socket);
+			thread.start();
+			for (U32 id = 0; id < COUNT; ++id)
+			{
+				std::vector<U8> data = make_body(id, 100 + id % 50, id % 3 ? 20 : 0);
+				if (id % 2)
+				{
+					data = zero_code(data);
+				}
+				if (id % 5 == 0)
+				{
+					// Two appended acks
+					data[0] |= LL_ACK_FLAG;
+					data.insert(data.end(), 2 * sizeof(TPACKETID), 0xab);
+					data.push_back(2);
+				}
+				ensure("sent", send_packet(socket, (const char*)data.data(), (S32)data.size(), localhost, port));
+			}
+
+			LLTimer timer;
+			while (thread.size() < LLPacketReceiveThread::RING_SIZE && timer.getElapsedTimeF32() < 10.f)
+			{
+				ms_sleep(1);
+			}
+			ensure_equals("ring full", thread.size(), (U32)LLPacketReceiveThread::RING_SIZE);
+
+			U32 expected = 0;
+			while (expected < COUNT && timer.getElapsedTimeF32() < 20.f)
+			{
+				const LLPacketReceiveThread::Packet* packet = thread.front();
+				if (!packet)
+				{
+					ms_sleep(1);
+					continue;
+				}
+
+				const std::vector<U8> body = make_body(expected, 100 + expected % 50, expected % 3 ? 20 : 0);
+				ensure_equals("in order", packet_id(packet->mData), expected);
+				ensure_equals("sender port", packet->mSender.getPort(), (U32)port);
+				if (expected % 2)
+				{
+					ensure_equals("expanded size", packet->mExpandedSize, (S32)body.size());
+					ensure("expanded", !memcmp(packet->mExpanded + 1, body.data() + 1, body.size() - 1));
+				}
+				else
+				{
+					ensure_equals("not zero coded", packet->mExpandedSize, 0);
+					ensure_equals("body size", packet->mBodySize, (S32)body.size());
+				}
+				if (expected % 5 == 0)
+				{
+					ensure_equals("acks", packet->mSize - packet->mBodySize, (S32)(2 * sizeof(TPACKETID) + 1));
+				}
+				thread.pop();
+				++expected;
+			}
+			ensure_equals("all received", expected, COUNT);
+			ensure_equals("ring empty", thread.size(), 0U);
+		}
+		end_net(socket);
+	}
+}
@@ -0,0 +1,217 @@
+/**
+ * @file patch_idct_test.cpp
+ * @brief Checks decompress_patch_simd() against the scalar decompress_patch().
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmath.h"
+#include "../patch_dct.h"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	const S32 REGION_STRIDE = 257;	// grids per edge of a 256m region, plus its north and east edges
+
+	S32 irand(U32& seed, S32 range)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return (S32)((seed >> 8) % (U32)(2 * range + 1)) - range;
+	}
+
+	// Coefficients of a terrain patch as decode_patch() leaves them: the first
+	// count in zigzag order, zeroes past the end of block
+	void make_patch(U32& seed, S32 size, S32 count, std::vector<S32>& cpatch, LLPatchHeader& ph)
+	{
+		cpatch.assign(size * size, 0);
+		for (S32 i = 0; i < count; ++i)
+		{
+			// Energy is mostly in the low frequencies
+			cpatch[i] = irand(seed, i < 8 ? 2000 : 200);
+		}
+		ph.dc_offset = (F32)irand(seed, 100) + 20.f;
+		ph.range = (U16)(irand(seed, 100) + 150);
+		ph.quant_wbits = (U8)((irand(seed, 2) + 3) << 4 | 11);
+		ph.patchids = 0;
+	}
+
+	void decompress_scalar(F32* patch, S32 stride, std::vector<S32>& cpatch, LLPatchHeader& ph, S32 size)
+	{
+		LLGroupHeader gop;
+		gop.stride = stride;
+		gop.patch_size = size;
+		gop.layer_type = 0;
+		init_patch_decompressor(size);
+		set_group_of_patch_header(&gop);
+		decompress_patch(patch, cpatch.data(), &ph);
+	}
+
+	// Largest difference between the two decodes, relative to the height range
+	F32 compare(const F32* expected, const F32* actual, S32 stride, S32 size, const LLPatchHeader& ph)
+	{
+		F32 max_diff = 0.f;
+		for (S32 j = 0; j < size; ++j)
+		{
+			for (S32 i = 0; i < size; ++i)
+			{
+				max_diff = llmax(max_diff, fabsf(expected[j * stride + i] - actual[j * stride + i]));
+			}
+		}
+		return max_diff / ph.range;
+	}
+
+	// Float sums in another order, not a different result
+	const F32 TOLERANCE = 1.e-5f;
+}
+
+namespace tut
+{
+	struct patch_idct_data
+	{
+		void checkSize(S32 size)
+		{
+			U32 seed = 1;
+			std::vector<S32> cpatch;
+			LLPatchHeader ph;
+			std::vector<F32> expected(size * size);
+			std::vector<F32> actual(size * size);
+			const S32 counts[] = { 0, 1, 3, 10, 36, 100, size * size / 2, size * size };
+			for (S32 count : counts)
+			{
+				for (S32 pass = 0; pass < 8; ++pass)
+				{
+					make_patch(seed, size, count, cpatch, ph);
+					decompress_scalar(expected.data(), size, cpatch, ph, size);
+					decompress_patch_simd(actual.data(), size, cpatch.data(), &ph, size);
+
+					std::ostringstream msg;
+					msg << size << "x" << size << " patch with " << count << " coefficients";
+					ensure(msg.str(), compare(expected.data(), actual.data(), size, size, ph) < TOLERANCE);
+				}
+			}
+		}
+	};
+
+	typedef test_group<patch_idct_data> patch_idct_test;
+	typedef patch_idct_test::object patch_idct_object;
+	tut::patch_idct_test patch_idct("patch_idct");
+
+	template<> template<>
+	void patch_idct_object::test<1>()
+	{
+		set_test_name("16x16 patches");
+		checkSize(NORMAL_PATCH_SIZE);
+	}
+
+	template<> template<>
+	void patch_idct_object::test<2>()
+	{
+		set_test_name("32x32 patches");
+		checkSize(LARGE_PATCH_SIZE);
+	}
+
+	template<> template<>
+	void patch_idct_object::test<3>()
+	{
+		set_test_name("Patch inside a region height field");
+		U32 seed = 7;
+		std::vector<S32> cpatch;
+		LLPatchHeader ph;
+		make_patch(seed, NORMAL_PATCH_SIZE, 60, cpatch, ph);
+
+		const F32 UNTOUCHED = -1234.f;
+		std::vector<F32> expected(REGION_STRIDE * (NORMAL_PATCH_SIZE + 1), UNTOUCHED);
+		std::vector<F32> actual(expected);
+		// Unaligned, as patches of a region are
+		const S32 origin = REGION_STRIDE + 3 * NORMAL_PATCH_SIZE;
+		decompress_scalar(expected.data() + origin, REGION_STRIDE, cpatch, ph, NORMAL_PATCH_SIZE);
+		decompress_patch_simd(actual.data() + origin, REGION_STRIDE, cpatch.data(), &ph, NORMAL_PATCH_SIZE);
+
+		ensure("Ensure same heights", compare(expected.data() + origin, actual.data() + origin, REGION_STRIDE, NORMAL_PATCH_SIZE, ph) < TOLERANCE);
+		for (size_t i = 0; i < actual.size(); ++i)
+		{
+			const S32 row = (S32)i / REGION_STRIDE - 1;
+			const S32 column = (S32)i % REGION_STRIDE - 3 * NORMAL_PATCH_SIZE;
+			if (row < 0 || row >= NORMAL_PATCH_SIZE || column < 0 || column >= NORMAL_PATCH_SIZE)
+			{
+				ensure_equals("Ensure nothing written outside the patch", actual[i], UNTOUCHED);
+			}
+		}
+	}
+
+	template<> template<>
+	void patch_idct_object::test<4>()
+	{
+		set_test_name("Both sizes on several threads at once");
+		const S32 THREADS = 4;
+		const S32 PATCHES = 64;
+
+		// Expected results first, the scalar decoder has one set of tables for everyone
+		std::vector<std::vector<S32> > cpatches(PATCHES);
+		std::vector<LLPatchHeader> headers(PATCHES);
+		std::vector<std::vector<F32> > expected(PATCHES);
+		U32 seed = 11;
+		for (S32 p = 0; p < PATCHES; ++p)
+		{
+			const S32 size = p & 1 ? LARGE_PATCH_SIZE : NORMAL_PATCH_SIZE;
+			make_patch(seed, size, 20 + p * 3, cpatches[p], headers[p]);
+			expected[p].resize(size * size);
+			decompress_scalar(expected[p].data(), size, cpatches[p], headers[p], size);
+		}
+
+		std::vector<std::vector<F32> > actual(THREADS * PATCHES);
+		std::vector<std::thread> threads;
+		for (S32 t = 0; t < THREADS; ++t)
+		{
+			threads.emplace_back([&, t]()
+			{
+				for (S32 p = 0; p < PATCHES; ++p)
+				{
+					const S32 size = p & 1 ? LARGE_PATCH_SIZE : NORMAL_PATCH_SIZE;
+					std::vector<F32>& out = actual[t * PATCHES + p];
+					out.resize(size * size);
+					decompress_patch_simd(out.data(), size, cpatches[p].data(), &headers[p], size);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (S32 t = 0; t < THREADS; ++t)
+		{
+			for (S32 p = 0; p < PATCHES; ++p)
+			{
+				const S32 size = p & 1 ? LARGE_PATCH_SIZE : NORMAL_PATCH_SIZE;
+				ensure("Ensure same heights", compare(expected[p].data(), actual[t * PATCHES + p].data(), size, size, headers[p]) < TOLERANCE);
+			}
+		}
+	}
+}
@@ -45,6 +45,8 @@ static int nextPowerOf2( int value )
 	return next_power_of_2;
 }
 
+U32 LLPluginClassMedia::sFrameBuffers = 3;
+
 LLPluginClassMedia::LLPluginClassMedia(LLPluginClassMediaOwner *owner)
 {
 	mOwner = owner;
@@ -99,6 +101,8 @@ void LLPluginClassMedia::reset()
 	mRequestedTextureCoordsOpenGL = false;
 	mTextureSharedMemorySize = 0;
 	mTextureSharedMemoryName.clear();
+	mFrameRing.detach();
+	mFrameRingActive = false;
 	mDefaultMediaWidth = 0;
 	mDefaultMediaHeight = 0;
 	mNaturalMediaWidth = 0;
@@ -207,10 +211,21 @@ void LLPluginClassMedia::idle(void)
 
 
 		// Size change has been requested but not initiated yet.
-		size_t newsize = mRequestedTextureWidth * mRequestedTextureHeight * mRequestedTextureDepth;
+		size_t framesize = mRequestedTextureWidth * mRequestedTextureHeight * mRequestedTextureDepth;
 
 		// Add an extra line for padding, just in case.
-		newsize += mRequestedTextureWidth * mRequestedTextureDepth;
+		framesize += mRequestedTextureWidth * mRequestedTextureDepth;
+
+		// Several frames let the plugin draw the next one while we upload the last
+		U32 framecount = llmin(sFrameBuffers, LLPluginFrameRing::MAX_FRAMES);
+		if(framecount < LLPluginFrameRing::MIN_FRAMES)
+		{
+			framecount = 1;
+		}
+		size_t newsize = (framecount > 1) ? LLPluginFrameRing::getSegmentSize(framesize, framecount) : framesize;
+
+		mFrameRing.detach();
+		mFrameRingActive = false;
 
 		if(newsize != mTextureSharedMemorySize)
 		{
@@ -243,6 +258,17 @@ void LLPluginClassMedia::idle(void)
 			}
 		}
 
+		if(framecount > 1 && !mTextureSharedMemoryName.empty())
+		{
+			// Lay the frames out again even when the segment is reused, frames the plugin publishes before it attaches again are skipped
+			void *addr = mPlugin->getSharedMemoryAddress(mTextureSharedMemoryName);
+			if(!mFrameRing.create(addr, mTextureSharedMemorySize, framesize, framecount,
+								  mRequestedTextureWidth * mRequestedTextureDepth, mRequestedTextureHeight))
+			{
+				framecount = 1;
+			}
+		}
+
 		// This is our local indicator that a change is in progress.
 		mTextureWidth = -1;
 		mTextureHeight = -1;
@@ -260,6 +286,7 @@ void LLPluginClassMedia::idle(void)
 			message.setValueS32("height", mRequestedMediaHeight);
 			message.setValueS32("texture_width", mRequestedTextureWidth);
 			message.setValueS32("texture_height", mRequestedTextureHeight);
+			message.setValueU32("frame_count", framecount);
 			message.setValueReal("background_r", mBackgroundColor.mV[VX]);
 			message.setValueReal("background_g", mBackgroundColor.mV[VY]);
 			message.setValueReal("background_b", mBackgroundColor.mV[VZ]);
@@ -410,6 +437,30 @@ void LLPluginClassMedia::resetDirty(void)
 	mDirtyRect = LLRect::null;
 }
 
+unsigned char* LLPluginClassMedia::acquireFrame(LLRect& dirty_rect)
+{
+	if(mFrameRingActive)
+	{
+		return mFrameRing.acquireLatest(dirty_rect);
+	}
+
+	// A single frame, which the plugin may be drawing into while we read it
+	if(!getDirty(&dirty_rect))
+	{
+		return nullptr;
+	}
+	resetDirty();
+	return getBitsData();
+}
+
+void LLPluginClassMedia::releaseFrame()
+{
+	if(mFrameRingActive)
+	{
+		mFrameRing.release();
+	}
+}
+
 std::string LLPluginClassMedia::translateModifiers(MASK modifiers)
 {
 	std::string result;
@@ -792,6 +843,30 @@ F64 LLPluginClassMedia::getCPUUsage()
 	return result;
 }
 
+F64 LLPluginClassMedia::getMessageRate()
+{
+	F64 result = 0.0;
+
+	if(mPlugin)
+	{
+		result = mPlugin->getMessageRate();
+	}
+
+	return result;
+}
+
+F64 LLPluginClassMedia::getMessageCPU()
+{
+	F64 result = 0.0;
+
+	if(mPlugin)
+	{
+		result = mPlugin->getMessageCPU() + mPlugin->getPluginMessageCPU();
+	}
+
+	return result;
+}
+
 void LLPluginClassMedia::sendPickFileResponse(const std::vector<std::string> files)
 {
 	LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_MEDIA, "pick_file_response");
@@ -1089,6 +1164,10 @@ void LLPluginClassMedia::receivePluginMessage(const LLPluginMessage &message)
 			mMediaWidth = message.getValueS32("width");
 			mMediaHeight = message.getValueS32("height");
 
+			// Plugins which don't know about the frame ring keep drawing into the first frame
+			mFrameRingActive = mFrameRing.isValid() && message.hasValue("frame_ring") && message.getValueBoolean("frame_ring");
+			LL_DEBUGS("Plugin") << "texture frames: " << (mFrameRingActive ? mFrameRing.getFrameCount() : 1) << LL_ENDL;
+
 			// This invalidates any existing dirty rect.
 			resetDirty();
 
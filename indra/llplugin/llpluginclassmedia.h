@@ -30,6 +30,7 @@
 #define LL_LLPLUGINCLASSMEDIA_H
 
 #include "llgltypes.h"
+#include "llpluginframering.h"
 #include "llpluginprocessparent.h"
 #include "llrect.h"
 #include "llpluginclassmediaowner.h"
@@ -98,6 +99,16 @@ public:
 	
 	bool getDirty(LLRect *dirty_rect = nullptr);
 	void resetDirty(void);
+
+	// Returns the newest frame with what changed since the last one, or NULL if nothing did.
+	// With a frame ring the plugin keeps drawing into other frames until releaseFrame() is called,
+	// so upload straight from the returned pointer and release it right after.
+	unsigned char* acquireFrame(LLRect& dirty_rect);
+	void releaseFrame();
+	bool getFrameRingActive() const { return mFrameRingActive; };
+
+	// Number of frames in the texture shared memory for new size changes, fewer than 2 turns the ring off.
+	static void setFrameBuffers(U32 count) { sFrameBuffers = count; };
 	
 	typedef enum 
 	{
@@ -175,6 +186,9 @@ public:
 	void setLowPrioritySizeLimit(int size);
 	
 	F64 getCPUUsage();
+	// Messages per second to and from the plugin process, and seconds each took to flatten or parse on both sides
+	F64 getMessageRate();
+	F64 getMessageCPU();
 	
 	void sendPickFileResponse(const std::vector<std::string> files);
 
@@ -354,6 +368,11 @@ protected:
 	
 	std::string mTextureSharedMemoryName;
 	size_t		mTextureSharedMemorySize;
+
+	// Frames in the texture shared memory, only used once the plugin confirms it knows about them
+	LLPluginFrameRing mFrameRing;
+	bool		mFrameRingActive;
+	static U32	sFrameBuffers;
 	
 	// True to scale requested media up to the full size of the texture (i.e. next power of two)
 	bool		mAutoScaleMedia;
@@ -0,0 +1,397 @@
+/**
+ * @file llpluginframering.cpp
+ * @brief Ring of media frame buffers in a plugin shared memory segment
+ *
+ * @cond
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ * @endcond
+ */
+
+#include "linden_common.h"
+
+#include "llpluginframering.h"
+
+// The header is shared between processes, its atomics must not hide a lock
+static_assert(std::atomic<U32>::is_always_lock_free, "frame ring needs lock free atomics");
+
+static const U32 FRAME_RING_MAGIC = 0x464d5231; // "FMR1"
+// Frames and the header start on cache lines
+static const size_t FRAME_ALIGNMENT = 64;
+// Unread areas kept apart before the oldest ones get merged
+static const size_t MAX_UNREAD_RECTS = 8;
+
+// Epochs of the rings laid out by this process, never 0 so a zeroed header matches none
+static std::atomic<U32> sLastEpoch(0);
+
+static size_t align_frame(size_t size)
+{
+	return (size + FRAME_ALIGNMENT - 1) & ~(FRAME_ALIGNMENT - 1);
+}
+
+// True if serial a was published after serial b, allowing for wrap around
+static bool is_newer(U32 a, U32 b)
+{
+	return (S32)(a - b) > 0;
+}
+
+// LLRect::unionWith() does not know an empty rect covers nothing
+static void add_rect(LLRect& rect, const LLRect& other)
+{
+	if (other.isEmpty())
+	{
+		return;
+	}
+	if (rect.isEmpty())
+	{
+		rect = other;
+	}
+	else
+	{
+		rect.unionWith(other);
+	}
+}
+
+LLPluginFrameRing::LLPluginFrameRing()
+:	mHeader(nullptr),
+	mBase(nullptr),
+	mEpoch(0),
+	mWriteIndex(0),
+	mSerial(0),
+	mFullFrameUpdates(false),
+	mReadIndex(-1),
+	mReadSerial(0)
+{
+}
+
+//static
+size_t LLPluginFrameRing::getSegmentSize(size_t frame_size, U32 frame_count)
+{
+	return align_frame(frame_size) * frame_count + sizeof(Header);
+}
+
+bool LLPluginFrameRing::create(void* address, size_t segment_size, size_t frame_size, U32 frame_count, U32 row_bytes, U32 height)
+{
+	detach();
+	if (!address || frame_count < MIN_FRAMES || frame_count > MAX_FRAMES
+		|| (size_t)row_bytes * height > frame_size
+		|| getSegmentSize(frame_size, frame_count) > segment_size)
+	{
+		return false;
+	}
+
+	mEpoch = ++sLastEpoch;
+	if (!mEpoch)
+	{
+		mEpoch = ++sLastEpoch;
+	}
+
+	mBase = (U8*)address;
+	mHeader = (Header*)(mBase + align_frame(frame_size) * frame_count);
+	// A plugin still using the previous layout stops publishing before any of it changes
+	mHeader->mEpoch.store(mEpoch, std::memory_order_release);
+	mHeader->mMagic = FRAME_RING_MAGIC;
+	mHeader->mFrameCount = frame_count;
+	mHeader->mFrameSize = align_frame(frame_size);
+	mHeader->mRowBytes = row_bytes;
+	mHeader->mHeight = height;
+	mHeader->mReadSerial.store(0, std::memory_order_relaxed);
+	for (Frame& frame : mHeader->mFrames)
+	{
+		frame.mEpoch = 0;
+		frame.mSerial = 0;
+		frame.mLeft = frame.mTop = frame.mRight = frame.mBottom = 0;
+		frame.mState.store(FRAME_FREE, std::memory_order_relaxed);
+	}
+	// The plugin only looks at the segment once the size_change message tells it to
+	std::atomic_thread_fence(std::memory_order_release);
+	return true;
+}
+
+bool LLPluginFrameRing::attach(void* address, size_t segment_size)
+{
+	detach();
+	if (!address || segment_size < sizeof(Header))
+	{
+		return false;
+	}
+
+	// create() made the segment exactly as large as the frames and the header after them
+	Header* header = (Header*)((U8*)address + segment_size - sizeof(Header));
+	if (header->mMagic != FRAME_RING_MAGIC
+		|| header->mFrameCount < MIN_FRAMES || header->mFrameCount > MAX_FRAMES
+		|| getSegmentSize(header->mFrameSize, header->mFrameCount) != segment_size)
+	{
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	mBase = (U8*)address;
+	mHeader = header;
+	mEpoch = header->mEpoch.load(std::memory_order_acquire);
+	mSerial = 0;
+	mUnreadRects.clear();
+	for (LLRect& rect : mStaleRects)
+	{
+		rect = LLRect::null;
+	}
+
+	// Only one plugin writes to the segment, so a frame left being drawn was ours before the ring was laid out again
+	for (U32 i = 0; i < header->mFrameCount; ++i)
+	{
+		U32 expected = FRAME_WRITING;
+		header->mFrames[i].mState.compare_exchange_strong(expected, FRAME_FREE, std::memory_order_relaxed);
+	}
+	for (U32 i = 0; i < header->mFrameCount; ++i)
+	{
+		U32 expected = FRAME_FREE;
+		if (header->mFrames[i].mState.compare_exchange_strong(expected, FRAME_WRITING, std::memory_order_acquire))
+		{
+			mWriteIndex = i;
+			return true;
+		}
+	}
+	// The reader holds one frame at most, the others were published
+	claimFrame(header->mFrameCount - 1);
+	return true;
+}
+
+void LLPluginFrameRing::detach()
+{
+	mHeader = nullptr;
+	mBase = nullptr;
+	mEpoch = 0;
+	mReadIndex = -1;
+	mReadSerial = 0;
+}
+
+U32 LLPluginFrameRing::getFrameCount() const
+{
+	return mHeader ? mHeader->mFrameCount : 0;
+}
+
+U8* LLPluginFrameRing::getFrame(U32 index) const
+{
+	if (!mHeader || index >= mHeader->mFrameCount)
+	{
+		return nullptr;
+	}
+	return mBase + mHeader->mFrameSize * index;
+}
+
+U8* LLPluginFrameRing::getWriteFrame() const
+{
+	return getFrame(mWriteIndex);
+}
+
+bool LLPluginFrameRing::isCurrent() const
+{
+	return mHeader && mHeader->mEpoch.load(std::memory_order_acquire) == mEpoch;
+}
+
+U8* LLPluginFrameRing::publish(S32 left, S32 top, S32 right, S32 bottom)
+{
+	if (!mHeader)
+	{
+		return nullptr;
+	}
+	if (!isCurrent())
+	{
+		// Laid out again by the viewer, keep drawing into the same frame until we attach to the new layout
+		return getWriteFrame();
+	}
+
+	LLRect rect(left, llmax(top, bottom), right, llmin(top, bottom));
+
+	// Forget what the reader has already seen, the rest goes out with this frame
+	const U32 read_serial = mHeader->mReadSerial.load(std::memory_order_acquire);
+	while (!mUnreadRects.empty() && !is_newer(mUnreadRects.front().first, read_serial))
+	{
+		mUnreadRects.erase(mUnreadRects.begin());
+	}
+	if (mUnreadRects.size() >= MAX_UNREAD_RECTS)
+	{
+		add_rect(mUnreadRects[1].second, mUnreadRects[0].second);
+		mUnreadRects.erase(mUnreadRects.begin());
+	}
+	mUnreadRects.emplace_back(++mSerial, rect);
+
+	LLRect unread;
+	for (const auto& entry : mUnreadRects)
+	{
+		add_rect(unread, entry.second);
+	}
+
+	const U32 published = mWriteIndex;
+	Frame& frame = mHeader->mFrames[published];
+	frame.mEpoch = mEpoch;
+	frame.mSerial = mSerial;
+	frame.mLeft = unread.mLeft;
+	frame.mTop = unread.mTop;
+	frame.mRight = unread.mRight;
+	frame.mBottom = unread.mBottom;
+	frame.mState.store(FRAME_READY, std::memory_order_release);
+
+	if (!mFullFrameUpdates)
+	{
+		for (U32 i = 0; i < mHeader->mFrameCount; ++i)
+		{
+			add_rect(mStaleRects[i], rect);
+		}
+		mStaleRects[published] = LLRect::null;
+	}
+
+	claimFrame(published);
+	if (!mFullFrameUpdates && mWriteIndex != published)
+	{
+		copyStale(published, mWriteIndex);
+	}
+	return getWriteFrame();
+}
+
+void LLPluginFrameRing::claimFrame(U32 published)
+{
+	const U32 count = mHeader->mFrameCount;
+	// Only the reader moves frames around meanwhile, and it holds one at most, so this ends quickly
+	while (true)
+	{
+		// A free frame first, starting after the one just published
+		for (U32 n = 1; n < count; ++n)
+		{
+			const U32 i = (published + n) % count;
+			U32 expected = FRAME_FREE;
+			if (mHeader->mFrames[i].mState.compare_exchange_strong(expected, FRAME_WRITING, std::memory_order_acquire))
+			{
+				mWriteIndex = i;
+				return;
+			}
+		}
+
+		// Otherwise take back the oldest frame the reader has not picked up, the one just published last of all
+		S32 oldest = -1;
+		for (U32 n = 1; n <= count; ++n)
+		{
+			const U32 i = (published + n) % count;
+			if (mHeader->mFrames[i].mState.load(std::memory_order_relaxed) == FRAME_READY
+				&& (oldest < 0 || (i != published && is_newer(mHeader->mFrames[oldest].mSerial, mHeader->mFrames[i].mSerial))))
+			{
+				oldest = i;
+			}
+		}
+		if (oldest >= 0)
+		{
+			U32 expected = FRAME_READY;
+			if (mHeader->mFrames[oldest].mState.compare_exchange_strong(expected, FRAME_WRITING, std::memory_order_acquire))
+			{
+				mWriteIndex = oldest;
+				return;
+			}
+		}
+	}
+}
+
+void LLPluginFrameRing::copyStale(U32 from, U32 to)
+{
+	LLRect& stale = mStaleRects[to];
+	if (stale.isEmpty())
+	{
+		return;
+	}
+
+	// Whole rows, they are contiguous and the rect's columns rarely save much
+	const size_t row_bytes = mHeader->mRowBytes;
+	const S32 bottom = llclamp(stale.mBottom, 0, (S32)mHeader->mHeight);
+	const S32 top = llclamp(stale.mTop, 0, (S32)mHeader->mHeight);
+	if (top > bottom)
+	{
+		memcpy(getFrame(to) + bottom * row_bytes, getFrame(from) + bottom * row_bytes, (top - bottom) * row_bytes);
+	}
+	stale = LLRect::null;
+}
+
+U8* LLPluginFrameRing::acquireLatest(LLRect& dirty_rect)
+{
+	if (!mHeader)
+	{
+		return nullptr;
+	}
+	release();
+
+	const U32 count = mHeader->mFrameCount;
+	// The writer may take a frame back between looking and claiming it, then look again
+	for (S32 tries = 0; tries < 4; ++tries)
+	{
+		S32 newest = -1;
+		U32 newest_serial = mReadSerial;
+		for (U32 i = 0; i < count; ++i)
+		{
+			Frame& frame = mHeader->mFrames[i];
+			if (frame.mState.load(std::memory_order_acquire) != FRAME_READY)
+			{
+				continue;
+			}
+			if (frame.mEpoch != mEpoch)
+			{
+				// Published into the previous layout of the segment, its serial means nothing now
+				U32 expected = FRAME_READY;
+				frame.mState.compare_exchange_strong(expected, FRAME_FREE, std::memory_order_relaxed);
+			}
+			else if (is_newer(frame.mSerial, newest_serial))
+			{
+				newest = i;
+				newest_serial = frame.mSerial;
+			}
+		}
+		if (newest < 0)
+		{
+			return nullptr;
+		}
+
+		Frame& frame = mHeader->mFrames[newest];
+		U32 expected = FRAME_READY;
+		if (!frame.mState.compare_exchange_strong(expected, FRAME_READING, std::memory_order_acq_rel))
+		{
+			continue;
+		}
+
+		// The frame is ours now, it may even have been published again since we looked
+		if (frame.mEpoch != mEpoch)
+		{
+			frame.mState.store(FRAME_FREE, std::memory_order_release);
+			continue;
+		}
+		mReadIndex = newest;
+		mReadSerial = frame.mSerial;
+		dirty_rect.set(frame.mLeft, frame.mTop, frame.mRight, frame.mBottom);
+		mHeader->mReadSerial.store(mReadSerial, std::memory_order_release);
+		return mBase + mHeader->mFrameSize * newest;
+	}
+	return nullptr;
+}
+
+void LLPluginFrameRing::release()
+{
+	if (mHeader && mReadIndex >= 0)
+	{
+		mHeader->mFrames[mReadIndex].mState.store(FRAME_FREE, std::memory_order_release);
+	}
+	mReadIndex = -1;
+}
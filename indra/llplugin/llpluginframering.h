@@ -0,0 +1,183 @@
+/**
+ * @file llpluginframering.h
+ * @brief Ring of media frame buffers in a plugin shared memory segment
+ *
+ * @cond
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ * @endcond
+ */
+
+#ifndef LL_LLPLUGINFRAMERING_H
+#define LL_LLPLUGINFRAMERING_H
+
+#include <atomic>
+#include <vector>
+
+#include "llrect.h"
+
+/**
+ * @brief LLPluginFrameRing splits a media texture shared memory segment into several frame buffers.
+ *
+ * The plugin (writer) always owns one frame to draw into, and publishes it with its dirty rect once done.
+ * The viewer (reader) acquires the newest published frame, uploads it straight from the segment and releases it.
+ * Each frame carries an ownership flag in a small header, which both processes only change with atomic
+ * compare and swap, so neither side ever waits for the other:
+ *   FREE -> WRITING -> READY -> READING -> FREE
+ * When no frame is free, the writer takes back the oldest published frame. Every published frame carries the
+ * union of the areas changed since the last frame the reader acquired, so skipping frames never loses an update.
+ *
+ * Frames start at the beginning of the segment and the header follows the last one, so a plugin which knows
+ * nothing of the ring keeps drawing into frame 0 as before.
+ *
+ * The viewer lays the ring out again in the same segment when the media changes size. Every layout gets a new
+ * epoch, which the writer stamps on the frames it publishes: the reader skips frames from an older layout, and the
+ * writer stops publishing into a ring laid out again until it attaches to it.
+ */
+class LLPluginFrameRing
+{
+	LOG_CLASS(LLPluginFrameRing);
+public:
+	enum EFrameState
+	{
+		FRAME_FREE = 0,
+		FRAME_WRITING,
+		FRAME_READY,
+		FRAME_READING
+	};
+
+	static const U32 MIN_FRAMES = 2;
+	static const U32 MAX_FRAMES = 4;
+
+	LLPluginFrameRing();
+
+   /**
+    * Size of a segment holding frame_count frames of frame_size bytes each, plus the header.
+    */
+	static size_t getSegmentSize(size_t frame_size, U32 frame_count);
+
+   /**
+    * Lays out a ring in a segment, every frame free and with a new epoch. Used by the viewer.
+    *
+    * @param[in] row_bytes Bytes in a row of pixels, frames hold at least height rows.
+    *
+    * @return False if the segment is too small for the requested frames.
+    */
+	bool create(void* address, size_t segment_size, size_t frame_size, U32 frame_count, U32 row_bytes, U32 height);
+   /**
+    * Uses a ring laid out by create() in a segment mapped by this process. Used by the plugin, which takes over
+    * any frame it was still drawing into from an older layout of the segment.
+    *
+    * @return False if the segment does not hold a valid ring.
+    */
+	bool attach(void* address, size_t segment_size);
+	void detach();
+
+	bool isValid() const { return mHeader != nullptr; }
+	U32 getEpoch() const { return mEpoch; }
+	U32 getFrameCount() const;
+	U8* getFrame(U32 index) const;
+
+   /**
+    * The plugin redraws all of its frame every time, so frames it gets back do not need to be brought up to date first.
+    */
+	void setFullFrameUpdates(bool full_frames) { mFullFrameUpdates = full_frames; }
+
+	// Writer side
+
+   /**
+    * Frame the plugin is drawing into.
+    */
+	U8* getWriteFrame() const;
+   /**
+    * Hands the frame being drawn to the reader with the area which changed since the last one, in the plugin's
+    * coordinates (top may be above or below bottom), and moves on to another frame.
+    *
+    * @return The frame to draw the next update into. Unless full frame updates are set, it holds the same image as the one just published.
+    */
+	U8* publish(S32 left, S32 top, S32 right, S32 bottom);
+
+	// Reader side
+
+   /**
+    * Takes the newest published frame, releasing any older ones which were never read.
+    *
+    * @param[out] dirty_rect Area changed since the last acquired frame, with top and bottom in order (mBottom <= mTop).
+    *
+    * @return The frame, or nullptr if nothing was published since the last call.
+    */
+	U8* acquireLatest(LLRect& dirty_rect);
+   /**
+    * Gives the frame returned by acquireLatest() back to the writer.
+    */
+	void release();
+
+private:
+	// Only the side owning a frame, as told by mState, touches the rest of it
+	struct Frame
+	{
+		std::atomic<U32> mState;
+		U32 mEpoch;
+		U32 mSerial;
+		S32 mLeft;
+		S32 mTop;
+		S32 mRight;
+		S32 mBottom;
+	};
+
+	struct Header
+	{
+		U32 mMagic;
+		U32 mFrameCount;
+		U64 mFrameSize;
+		U32 mRowBytes;
+		U32 mHeight;
+		// Layout of the segment the frames belong to
+		std::atomic<U32> mEpoch;
+		// Serial of the last frame the reader acquired
+		std::atomic<U32> mReadSerial;
+		Frame mFrames[MAX_FRAMES];
+	};
+
+	bool isCurrent() const;
+	void claimFrame(U32 published);
+	void copyStale(U32 from, U32 to);
+
+	Header* mHeader;
+	U8* mBase;
+	// Epoch of the layout this side uses
+	U32 mEpoch;
+
+	// Writer state, local to the plugin process
+	U32 mWriteIndex;
+	U32 mSerial;
+	// Areas published since the reader's last frame, merged down when the reader falls far behind
+	std::vector<std::pair<U32, LLRect> > mUnreadRects;
+	// Area each frame is missing compared to the last published one
+	LLRect mStaleRects[MAX_FRAMES];
+	bool mFullFrameUpdates;
+
+	// Reader state, local to the viewer process
+	S32 mReadIndex;
+	U32 mReadSerial;
+};
+
+#endif // LL_LLPLUGINFRAMERING_H
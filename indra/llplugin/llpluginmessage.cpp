@@ -350,12 +350,29 @@ void* LLPluginMessage::getValuePointer(const std::string &key) const
 /**
  *	Flatten the message into a string.
  *
+ * @param[in] format Wire format
  * @return Message as a string.
  */
-std::string LLPluginMessage::generate(void) const
+std::string LLPluginMessage::generate(EFormat format) const
 {
 	std::ostringstream result;
-	
+
+	if (format == FORMAT_BINARY)
+	{
+		// Leave room for the header, filled in once the size is known
+		result.write("\0\0\0\0\0", BINARY_HEADER_SIZE);
+		LLSDSerialize::toBinary(mMessage, result);
+
+		std::string buffer = result.str();
+		U32 size = (U32)(buffer.size() - BINARY_HEADER_SIZE);
+		buffer[0] = BINARY_MARKER;
+		buffer[1] = (char)((size >> 24) & 0xFF);
+		buffer[2] = (char)((size >> 16) & 0xFF);
+		buffer[3] = (char)((size >> 8) & 0xFF);
+		buffer[4] = (char)(size & 0xFF);
+		return buffer;
+	}
+
 	// Pretty XML may be slightly easier to deal with while debugging...
 //	LLSDSerialize::toXML(mMessage, result);
 	LLSDSerialize::toPrettyXML(mMessage, result);
@@ -373,13 +390,58 @@ int LLPluginMessage::parse(const std::string &message)
 	// clear any previous state
 	clear();
 
-	std::istringstream input(message);
-	
-	S32 parse_result = LLSDSerialize::fromXML(mMessage, input);
+	S32 parse_result;
+	if (isBinary(message))
+	{
+		size_t size = getBinarySize(message.data(), message.size());
+		if (size != message.size())
+		{
+			LL_WARNS("Plugin") << "Binary message size mismatch: " << size << " != " << message.size() << LL_ENDL;
+			return LLSDParser::PARSE_FAILURE;
+		}
+		std::istringstream input(message.substr(BINARY_HEADER_SIZE));
+		parse_result = LLSDSerialize::fromBinary(mMessage, input, (S32)(size - BINARY_HEADER_SIZE));
+	}
+	else
+	{
+		std::istringstream input(message);
+		parse_result = LLSDSerialize::fromXML(mMessage, input);
+	}
 	
 	return (int)parse_result;
 }
 
+/**
+ *	Checks whether a flattened message is in the binary format.
+ *
+ * @param[in] message Message as a string
+ * @return True if the message was generated with FORMAT_BINARY
+ */
+// static
+bool LLPluginMessage::isBinary(const std::string &message)
+{
+	return !message.empty() && message[0] == BINARY_MARKER;
+}
+
+/**
+ *	Reads the total size of a binary message from its header.
+ *
+ * @param[in] data Start of the message
+ * @param[in] available Number of bytes at data
+ * @return Size including the header, or 0 if the header is not complete yet.
+ */
+// static
+size_t LLPluginMessage::getBinarySize(const char *data, size_t available)
+{
+	if (available < BINARY_HEADER_SIZE)
+	{
+		return 0;
+	}
+	const U8 *header = (const U8 *)data;
+	U32 size = ((U32)header[1] << 24) | ((U32)header[2] << 16) | ((U32)header[3] << 8) | (U32)header[4];
+	return BINARY_HEADER_SIZE + size;
+}
+
 
 /**
  * Destructor
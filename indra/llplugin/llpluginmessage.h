@@ -85,13 +85,30 @@ public:
 	// get the value of a key as a pointer.
 	void* getValuePointer(const std::string &key) const;
 
+	enum EFormat
+	{
+		FORMAT_XML,		// pretty XML, easy to read in logs, always understood
+		FORMAT_BINARY	// binary LLSD, once both ends have agreed on it. Holds NUL bytes, so
+						// never for plugins, which take C strings
+	};
+
+	// Binary messages start with this byte followed by the length of the LLSD as a big endian U32,
+	// so they can be framed without a delimiter. XML ones never do.
+	static constexpr char BINARY_MARKER = '\x01';
+	static constexpr size_t BINARY_HEADER_SIZE = 5;
+
 	// Flatten the message into a string
-	std::string generate(void) const;
+	std::string generate(EFormat format = FORMAT_XML) const;
 
-	// Parse an incoming message into component parts
+	// Parse an incoming message into component parts, in either format
 	// (this clears out all existing state before starting the parse)
 	// Returns -1 on failure, otherwise returns the number of key/value pairs in the message.
 	int parse(const std::string &message);
+
+	// True if message was generated in FORMAT_BINARY
+	static bool isBinary(const std::string &message);
+	// Size of the binary message starting at data, or 0 if fewer than BINARY_HEADER_SIZE bytes are given
+	static size_t getBinarySize(const char *data, size_t available);
 	
 	
 private:
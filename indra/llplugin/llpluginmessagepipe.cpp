@@ -32,6 +32,7 @@
 #include <utility>
 
 #include "llapr.h"
+#include "llpluginmessage.h"
 
 static const char MESSAGE_DELIMITER = '\0';
 
@@ -122,7 +123,10 @@ bool LLPluginMessagePipe::addMessage(const std::string &message)
 	}
 		
 	mOutput += message;
-	mOutput += MESSAGE_DELIMITER;	// message separator
+	if (!LLPluginMessage::isBinary(message))
+	{
+		mOutput += MESSAGE_DELIMITER;	// message separator, binary messages carry their length instead
+	}
 	
 	return true;
 }
@@ -370,19 +374,40 @@ bool LLPluginMessagePipe::pumpInput(F64 timeout)
 
 void LLPluginMessagePipe::processInput(void)
 {
-	// Look for input delimiter(s) in the input buffer.
-	int delim;
+	// Look for complete messages in the input buffer: binary ones by their length, XML ones by the delimiter.
 	mInputMutex.lock();
-	while((delim = mInput.find(MESSAGE_DELIMITER)) != std::string::npos)
-	{	
+	while(!mInput.empty())
+	{
+		std::string::size_type length;
+		std::string::size_type consumed;
+		if (LLPluginMessage::isBinary(mInput))
+		{
+			length = LLPluginMessage::getBinarySize(mInput.data(), mInput.size());
+			if (length == 0 || length > mInput.size())
+			{
+				// Wait for the rest of it
+				break;
+			}
+			consumed = length;
+		}
+		else
+		{
+			length = mInput.find(MESSAGE_DELIMITER);
+			if (length == std::string::npos)
+			{
+				break;
+			}
+			consumed = length + 1;
+		}
+
 		// Let the owner process this message
 		if (mOwner)
 		{
 			// Pull the message out of the input buffer before calling receiveMessageRaw.
 			// It's now possible for this function to get called recursively (in the case where the plugin makes a blocking request)
 			// and this guarantees that the messages will get dequeued correctly.
-			std::string message(mInput, 0, delim);
-			mInput.erase(0, delim + 1);
+			std::string message(mInput, 0, length);
+			mInput.erase(0, consumed);
 			mInputMutex.unlock();
 			mOwner->receiveMessageRaw(message);
 			mInputMutex.lock();
@@ -390,6 +415,7 @@ void LLPluginMessagePipe::processInput(void)
 		else
 		{
 			LL_WARNS("Plugin") << "!mOwner" << LL_ENDL;
+			break;
 		}
 	}
 	mInputMutex.unlock();
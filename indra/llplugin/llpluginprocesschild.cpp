@@ -44,6 +44,9 @@ LLPluginProcessChild::LLPluginProcessChild()
 	mSocket = LLSocket::create(gAPRPoolp, LLSocket::STREAM_TCP);
 	mSleepTime = PLUGIN_IDLE_SECONDS;	// default: send idle messages at 100Hz
 	mCPUElapsed = 0.0;
+	mBinaryMessages = false;
+	mMessageCount = 0;
+	mMessageElapsed = 0.0;
 	mBlockingRequest = false;
 	mBlockingResponseReceived = false;
 }
@@ -191,12 +194,16 @@ void LLPluginProcessChild::idle(void)
 					// Note that this will not take into account any threads or additional processes the plugin spawns, but it's a first approximation.
 					// If we could write OS-specific functions to query the actual CPU usage of this process, that would be a better approximation.
 					heartbeat.setValueReal("cpu_usage", mCPUElapsed / mHeartbeat.getElapsedTimeF64());
+					// Average cost of flattening and parsing a message on this side of the pipe
+					heartbeat.setValueReal("message_cpu", mMessageCount ? mMessageElapsed / (F64)mMessageCount : 0.0);
 
 					sendMessageToParent(heartbeat);
 
 					mHeartbeat.reset();
 					mHeartbeat.setTimerExpirySec(HEARTBEAT_SECONDS);
 					mCPUElapsed = 0.0;
+					mMessageCount = 0;
+					mMessageElapsed = 0.0;
 				}
 			}
 			// receivePluginMessage will transition to STATE_UNLOADING
@@ -306,10 +313,15 @@ void LLPluginProcessChild::sendMessageToPlugin(const LLPluginMessage &message)
 {
 	if (mInstance)
 	{
-		std::string buffer = message.generate();
+		// Plugins take a NUL terminated string through the C ABI, so they
+		// always get XML. Binary messages are only for the parent socket.
+		LLTimer elapsed;
+		std::string buffer = message.generate(LLPluginMessage::FORMAT_XML);
+		mMessageElapsed += elapsed.getElapsedTimeF64();
+		mMessageCount++;
 
 		LL_DEBUGS("Plugin") << "Sending to plugin: " << buffer << LL_ENDL;
-		LLTimer elapsed;
+		elapsed.reset();
 
 		mInstance->sendMessage(buffer);
 
@@ -323,9 +335,12 @@ void LLPluginProcessChild::sendMessageToPlugin(const LLPluginMessage &message)
 
 void LLPluginProcessChild::sendMessageToParent(const LLPluginMessage &message)
 {
-	std::string buffer = message.generate();
+	LLTimer elapsed;
+	std::string buffer = message.generate(getMessageFormat());
+	mMessageElapsed += elapsed.getElapsedTimeF64();
+	mMessageCount++;
 
-	LL_DEBUGS("Plugin") << "Sending to parent: " << buffer << LL_ENDL;
+	LL_DEBUGS("Plugin") << "Sending to parent: " << (mBinaryMessages ? message.generate() : buffer) << LL_ENDL;
 
 	writeMessageRaw(buffer);
 }
@@ -334,11 +349,14 @@ void LLPluginProcessChild::receiveMessageRaw(const std::string &message)
 {
 	// Incoming message from the TCP Socket
 
-	LL_DEBUGS("Plugin") << "Received from parent: " << message << LL_ENDL;
-
 	// Decode this message
+	LLTimer elapsed;
 	LLPluginMessage parsed;
 	parsed.parse(message);
+	mMessageElapsed += elapsed.getElapsedTimeF64();
+	mMessageCount++;
+
+	LL_DEBUGS("Plugin") << "Received from parent: " << (LLPluginMessage::isBinary(message) ? parsed.generate() : message) << LL_ENDL;
 
 	if (mBlockingRequest)
 	{
@@ -372,6 +390,8 @@ void LLPluginProcessChild::receiveMessageRaw(const std::string &message)
 			{
 				mPluginFile = parsed.getValue("file");
 				mPluginDir = parsed.getValue("dir");
+				// From here on both ends understand either format, and we answer in binary if offered
+				mBinaryMessages = parsed.hasValue("binary_messages") && parsed.getValueBoolean("binary_messages");
 			}
 			else if (message_name == "shutdown_plugin")
 			{
@@ -464,7 +484,18 @@ void LLPluginProcessChild::receiveMessageRaw(const std::string &message)
 	{
 		LLTimer elapsed;
 
-		mInstance->sendMessage(message);
+		if (LLPluginMessage::isBinary(message))
+		{
+			// Binary LLSD holds NUL bytes, the plugin gets XML
+			std::string buffer = parsed.generate(LLPluginMessage::FORMAT_XML);
+			mMessageElapsed += elapsed.getElapsedTimeF64();
+			elapsed.reset();
+			mInstance->sendMessage(buffer);
+		}
+		else
+		{
+			mInstance->sendMessage(message);
+		}
 
 		mCPUElapsed += elapsed.getElapsedTimeF64();
 	}
@@ -486,12 +517,15 @@ void LLPluginProcessChild::receivePluginMessage(const std::string &message)
 
 	// FIXME: how should we handle queueing here?
 
+	// Decode this message
+	LLTimer elapsed;
+	LLPluginMessage parsed;
+	parsed.parse(message);
+	mMessageElapsed += elapsed.getElapsedTimeF64();
+	mMessageCount++;
+
 	// Intercept certain base messages (responses to ones sent by this class)
 	{
-		// Decode this message
-		LLPluginMessage parsed;
-		parsed.parse(message);
-
 		if (parsed.hasValue("blocking_request"))
 		{
 			mBlockingRequest = true;
@@ -512,6 +546,7 @@ void LLPluginProcessChild::receivePluginMessage(const std::string &message)
 				LLPluginMessage new_message(LLPLUGIN_MESSAGE_CLASS_INTERNAL, "load_plugin_response");
 				LLSD versions = parsed.getValueLLSD("versions");
 				new_message.setValueLLSD("versions", versions);
+				new_message.setValueBoolean("binary_messages", mBinaryMessages);
 
 				if (parsed.hasValue("plugin_version"))
 				{
@@ -557,7 +592,18 @@ void LLPluginProcessChild::receivePluginMessage(const std::string &message)
 	if (passMessage)
 	{
 		LL_DEBUGS("Plugin") << "Passing through to parent: " << message << LL_ENDL;
-		writeMessageRaw(message);
+		if (mBinaryMessages && !LLPluginMessage::isBinary(message))
+		{
+			// Plugins talk XML to us, the parent gets binary
+			elapsed.reset();
+			std::string buffer = parsed.generate(LLPluginMessage::FORMAT_BINARY);
+			mMessageElapsed += elapsed.getElapsedTimeF64();
+			writeMessageRaw(buffer);
+		}
+		else
+		{
+			writeMessageRaw(message);
+		}
 	}
 
 	while (mBlockingRequest)
@@ -581,6 +627,11 @@ void LLPluginProcessChild::setState(EState state)
 	mState = state;
 };
 
+LLPluginMessage::EFormat LLPluginProcessChild::getMessageFormat() const
+{
+	return mBinaryMessages ? LLPluginMessage::FORMAT_BINARY : LLPluginMessage::FORMAT_XML;
+}
+
 void LLPluginProcessChild::deliverQueuedMessages()
 {
 	if (!mBlockingRequest)
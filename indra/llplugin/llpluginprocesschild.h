@@ -104,11 +104,15 @@ private:
 	LLTimer mHeartbeat;
     F64		mSleepTime;
     F64		mCPUElapsed;
+	bool	mBinaryMessages;		// parent offered binary messages in load_plugin, parent socket only
+	U32		mMessageCount;			// messages flattened or parsed this heartbeat cycle
+	F64		mMessageElapsed;		// and the time that took
 	bool	mBlockingRequest;
 	bool	mBlockingResponseReceived;
 	std::queue<std::string> mMessageQueue;
     LLTimer mWaitGoodbye;
 	void deliverQueuedMessages();
+	LLPluginMessage::EFormat getMessageFormat() const;
 	
 };
 
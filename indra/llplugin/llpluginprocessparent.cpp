@@ -36,6 +36,8 @@
 
 #include "llapr.h"
 
+static const F64 MESSAGE_STATS_INTERVAL = 2.0;	// seconds over which message rate and cost are averaged
+
 //virtual 
 LLPluginProcessParentOwner::~LLPluginProcessParentOwner()
 {
@@ -43,6 +45,7 @@ LLPluginProcessParentOwner::~LLPluginProcessParentOwner()
 }
 
 bool LLPluginProcessParent::sUseReadThread = false;
+bool LLPluginProcessParent::sBinaryMessages = true;
 apr_pollset_t *LLPluginProcessParent::sPollSet = nullptr;
 bool LLPluginProcessParent::sPollsetNeedsRebuild = false;
 LLMutex *LLPluginProcessParent::sInstancesMutex;
@@ -92,6 +95,12 @@ LLPluginProcessParent::LLPluginProcessParent(LLPluginProcessParentOwner *owner):
 	mState = STATE_UNINITIALIZED;
 	mSleepTime = 0.0;
 	mCPUUsage = 0.0;
+	mBinaryMessages = false;
+	mMessageCount = 0;
+	mMessageMicroseconds = 0;
+	mMessageRate = 0.0;
+	mMessageCPU = 0.0;
+	mPluginMessageCPU = 0.0;
 	mDisableTimeout = false;
 	mDebug = false;
 	mBlocked = false;
@@ -253,6 +262,7 @@ void LLPluginProcessParent::init(const std::string &launcher_filename, const std
 	mPluginFile = plugin_filename;
 	mPluginDir = plugin_dir;
 	mCPUUsage = 0.0;
+	mBinaryMessages = false;
 	mDebug = debug;	
 	setState(STATE_INITIALIZED);
 }
@@ -307,6 +317,8 @@ void LLPluginProcessParent::idle(void)
 {
 	bool idle_again;
 
+	updateMessageStats();
+
 	do
 	{
 		// process queued messages
@@ -534,6 +546,8 @@ void LLPluginProcessParent::idle(void)
 					LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_INTERNAL, "load_plugin");
 					message.setValue("file", mPluginFile);
 					message.setValue("dir", mPluginDir);
+					// Offer binary messages, the plugin process confirms in load_plugin_response
+					message.setValueBoolean("binary_messages", sBinaryMessages);
 					sendMessage(message);
 				}
 
@@ -667,8 +681,11 @@ void LLPluginProcessParent::sendMessage(const LLPluginMessage &message)
 		mHeartbeat.setTimerExpirySec(mPluginLockupTimeout);
 	}
 	
-	std::string buffer = message.generate();
-	LL_DEBUGS("Plugin") << "Sending: " << buffer << LL_ENDL;	
+	LLTimer elapsed;
+	std::string buffer = message.generate(mBinaryMessages ? LLPluginMessage::FORMAT_BINARY : LLPluginMessage::FORMAT_XML);
+	addMessageStat(elapsed.getElapsedTimeF64());
+
+	LL_DEBUGS("Plugin") << "Sending: " << (mBinaryMessages ? message.generate() : buffer) << LL_ENDL;	
 	writeMessageRaw(buffer);
 	
 	// Try to send message immediately.
@@ -920,10 +937,14 @@ void LLPluginProcessParent::servicePoll()
 
 void LLPluginProcessParent::receiveMessageRaw(const std::string &message)
 {
-	LL_DEBUGS("Plugin") << "Received: " << message << LL_ENDL;
-	
+	LLTimer elapsed;
 	LLPluginMessage parsed;
-	if(LLSDParser::PARSE_FAILURE != parsed.parse(message))
+	S32 parse_result = parsed.parse(message);
+	addMessageStat(elapsed.getElapsedTimeF64());
+
+	LL_DEBUGS("Plugin") << "Received: " << (LLPluginMessage::isBinary(message) ? parsed.generate() : message) << LL_ENDL;
+
+	if(LLSDParser::PARSE_FAILURE != parse_result)
 	{
 		if(parsed.hasValue("blocking_request"))
 		{
@@ -1001,6 +1022,10 @@ void LLPluginProcessParent::receiveMessage(const LLPluginMessage &message)
 				mPluginVersionString = message.getValue("plugin_version");
 				LL_INFOS("Plugin") << "plugin version string: " << mPluginVersionString << LL_ENDL;
 
+				// Older plugin processes don't answer and keep talking XML
+				mBinaryMessages = sBinaryMessages && message.hasValue("binary_messages") && message.getValueBoolean("binary_messages");
+				LL_INFOS("Plugin") << "message format: " << (mBinaryMessages ? "binary" : "XML") << LL_ENDL;
+
 				// Check which message classes/versions the plugin supports.
 				// TODO: check against current versions
 				// TODO: kill plugin on major mismatches?
@@ -1029,8 +1054,12 @@ void LLPluginProcessParent::receiveMessage(const LLPluginMessage &message)
 			mHeartbeat.setTimerExpirySec(mPluginLockupTimeout);
 
 			mCPUUsage = message.getValueReal("cpu_usage");
+			if (message.hasValue("message_cpu"))
+			{
+				mPluginMessageCPU = message.getValueReal("message_cpu");
+			}
 
-			LL_DEBUGS("Plugin") << "cpu usage reported as " << mCPUUsage << LL_ENDL;
+			LL_DEBUGS("Plugin") << "cpu usage reported as " << mCPUUsage << ", " << mPluginMessageCPU << " seconds per message" << LL_ENDL;
 			
 		}
 		else if(message_name == "shm_add_response")
@@ -1067,6 +1096,29 @@ void LLPluginProcessParent::receiveMessage(const LLPluginMessage &message)
 	}
 }
 
+// Any thread
+void LLPluginProcessParent::addMessageStat(F64 seconds)
+{
+	mMessageCount++;
+	mMessageMicroseconds += (U64)(seconds * 1000000.0);
+}
+
+void LLPluginProcessParent::updateMessageStats()
+{
+	F64 elapsed = mMessageStatsTimer.getElapsedTimeF64();
+	if (elapsed < MESSAGE_STATS_INTERVAL)
+	{
+		return;
+	}
+
+	U32 count = mMessageCount.exchange(0);
+	U64 microseconds = mMessageMicroseconds.exchange(0);
+	mMessageStatsTimer.reset();
+
+	mMessageRate = (F64)count / elapsed;
+	mMessageCPU = count ? (F64)microseconds / 1000000.0 / (F64)count : 0.0;
+}
+
 std::string LLPluginProcessParent::addSharedMemory(size_t size)
 {
 	std::string name;
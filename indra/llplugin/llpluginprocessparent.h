@@ -29,6 +29,7 @@
 #ifndef LL_LLPLUGINPROCESSPARENT_H
 #define LL_LLPLUGINPROCESSPARENT_H
 
+#include <atomic>
 #include <queue>
 #include <boost/enable_shared_from_this.hpp>
 
@@ -124,11 +125,21 @@ public:
 	void setLockupTimeout(F32 timeout) { mPluginLockupTimeout = timeout; };
 
 	F64 getCPUUsage() { return mCPUUsage; };
+
+	// Messages per second crossing the pipe in both directions, and the seconds each took to
+	// flatten or parse on our side and, as reported by the plugin process, on its side.
+	F64 getMessageRate() const { return mMessageRate; };
+	F64 getMessageCPU() const { return mMessageCPU; };
+	F64 getPluginMessageCPU() const { return mPluginMessageCPU; };
+	// True once the plugin process agreed to binary messages
+	bool getBinaryMessages() const { return mBinaryMessages; };
 	
 	static void poll(F64 timeout);
 	static bool canPollThreadRun() { return (sPollSet || sPollsetNeedsRebuild || sUseReadThread); };
 	static void setUseReadThread(bool use_read_thread);
 	static bool getUseReadThread() { return sUseReadThread; };
+	// Offer binary messages to plugin processes launched from now on, XML otherwise
+	static void setBinaryMessages(bool binary) { sBinaryMessages = binary; };
 
     static void shutdown();
 private:
@@ -161,6 +172,9 @@ private:
 	bool pluginLockedUp();
 	bool pluginLockedUpOrQuit();
 
+	void addMessageStat(F64 seconds);
+	void updateMessageStats();
+
 	bool accept();
 
 	LLSocket::ptr_t mListenSocket;
@@ -184,6 +198,14 @@ private:
 	LLTimer mHeartbeat;
 	F64		mSleepTime;
 	F64		mCPUUsage;
+
+	bool mBinaryMessages;
+	std::atomic<U32> mMessageCount;				// since mMessageStatsTimer was reset, from any thread
+	std::atomic<U64> mMessageMicroseconds;
+	LLTimer mMessageStatsTimer;
+	F64		mMessageRate;
+	F64		mMessageCPU;
+	F64		mPluginMessageCPU;
 	
 	bool mDisableTimeout;
 	bool mDebug;
@@ -196,6 +218,7 @@ private:
 	F32 mPluginLockupTimeout;		// If we don't receive a heartbeat in this many seconds, we declare the plugin locked up.
 
 	static bool sUseReadThread;
+	static bool sBinaryMessages;
 	apr_pollfd_t mPollFD;
 	static apr_pollset_t *sPollSet;
 	static bool sPollsetNeedsRebuild;
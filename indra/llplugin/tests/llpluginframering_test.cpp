@@ -0,0 +1,167 @@
+/**
+ * @file llpluginframering_test.cpp
+ * @brief Frame ring shared between the viewer and a media plugin
+ *
+ * @cond
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ * @endcond
+ */
+
+#include "linden_common.h"
+
+#include "../llpluginframering.h"
+
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	const U32 WIDTH = 64;
+	const U32 HEIGHT = 32;
+	const U32 DEPTH = 4;
+	const size_t FRAME_SIZE = WIDTH * HEIGHT * DEPTH;
+}
+
+namespace tut
+{
+	struct pluginframering_data
+	{
+		pluginframering_data()
+		:	mSegment((LLPluginFrameRing::getSegmentSize(FRAME_SIZE, 3) + sizeof(U64) - 1) / sizeof(U64), 0)
+		{
+		}
+
+		void* address() { return mSegment.data(); }
+		size_t size() const { return LLPluginFrameRing::getSegmentSize(FRAME_SIZE, 3); }
+
+		bool create(LLPluginFrameRing& viewer)
+		{
+			return viewer.create(address(), size(), FRAME_SIZE, 3, WIDTH * DEPTH, HEIGHT);
+		}
+
+		// Draws a marker into the frame being written and publishes it
+		U8* draw(LLPluginFrameRing& plugin, U8 marker, S32 left, S32 top, S32 right, S32 bottom)
+		{
+			*plugin.getWriteFrame() = marker;
+			return plugin.publish(left, top, right, bottom);
+		}
+
+		// Shared memory stand in, U64 keeps the header's atomics aligned
+		std::vector<U64> mSegment;
+	};
+	typedef test_group<pluginframering_data> pluginframering_test;
+	typedef pluginframering_test::object pluginframering_object;
+	tut::pluginframering_test pluginframering("LLPluginFrameRing");
+
+	template<> template<>
+	void pluginframering_object::test<1>()
+	{
+		set_test_name("Create and attach");
+		LLPluginFrameRing viewer, plugin;
+		ensure("one frame is no ring", !viewer.create(address(), size(), FRAME_SIZE, 1, WIDTH * DEPTH, HEIGHT));
+		ensure("segment too small", !viewer.create(address(), size() - 1, FRAME_SIZE, 3, WIDTH * DEPTH, HEIGHT));
+		ensure("no ring yet", !plugin.attach(address(), size()));
+
+		ensure("created", create(viewer));
+		ensure_equals("viewer frames", viewer.getFrameCount(), 3U);
+		ensure("wrong size", !plugin.attach(address(), size() - 64));
+		ensure("attached", plugin.attach(address(), size()));
+		ensure_equals("plugin frames", plugin.getFrameCount(), 3U);
+		ensure_equals("same epoch", plugin.getEpoch(), viewer.getEpoch());
+		ensure("starts in frame 0", plugin.getWriteFrame() == viewer.getFrame(0));
+		ensure("frames follow each other", viewer.getFrame(1) >= viewer.getFrame(0) + FRAME_SIZE);
+
+		LLRect dirty;
+		ensure("nothing published", viewer.acquireLatest(dirty) == nullptr);
+	}
+
+	template<> template<>
+	void pluginframering_object::test<2>()
+	{
+		set_test_name("Publish and acquire in order");
+		LLPluginFrameRing viewer, plugin;
+		ensure("created", create(viewer));
+		ensure("attached", plugin.attach(address(), size()));
+		plugin.setFullFrameUpdates(true);
+
+		// Skipped frames hand their areas on to the newest one
+		draw(plugin, 1, 0, 0, 10, 10);
+		draw(plugin, 2, 20, 30, 30, 20);
+		LLRect dirty;
+		U8* frame = viewer.acquireLatest(dirty);
+		ensure("acquired", frame != nullptr);
+		ensure_equals("newest frame", *frame, 2);
+		ensure("areas of both frames", dirty == LLRect(0, 30, 30, 0));
+
+		// The writer never gets the frame being read, and only new areas go out next
+		for (U8 marker = 3; marker < 10; ++marker)
+		{
+			ensure("reader frame kept", draw(plugin, marker, 5, 5, 6, 6) != frame);
+		}
+		ensure_equals("reader frame untouched", *frame, 2);
+		frame = viewer.acquireLatest(dirty);
+		ensure("acquired again", frame != nullptr);
+		ensure_equals("newest again", *frame, 9);
+		ensure("only new areas", dirty == LLRect(5, 6, 6, 5));
+
+		ensure("nothing newer", viewer.acquireLatest(dirty) == nullptr);
+	}
+
+	template<> template<>
+	void pluginframering_object::test<3>()
+	{
+		set_test_name("Laying the ring out again in the same segment");
+		LLPluginFrameRing viewer, plugin;
+		ensure("created", create(viewer));
+		ensure("attached", plugin.attach(address(), size()));
+		plugin.setFullFrameUpdates(true);
+
+		LLRect dirty;
+		for (U8 marker = 1; marker < 50; ++marker)
+		{
+			draw(plugin, marker, 0, 0, 1, 1);
+			viewer.acquireLatest(dirty);
+		}
+		draw(plugin, 50, 0, 0, 1, 1);
+
+		// The size changes, the plugin keeps drawing until it gets the message
+		const U32 old_epoch = viewer.getEpoch();
+		ensure("created again", create(viewer));
+		ensure("new epoch", viewer.getEpoch() != old_epoch);
+		U8* stale = draw(plugin, 51, 0, 0, 1, 1);
+		ensure("stale writer keeps its frame", stale == plugin.getWriteFrame());
+		ensure("nothing from the old layout", viewer.acquireLatest(dirty) == nullptr);
+
+		// Attaching takes back the frame we were drawing into and starts counting again
+		ensure("attached again", plugin.attach(address(), size()));
+		ensure_equals("same epoch", plugin.getEpoch(), viewer.getEpoch());
+		draw(plugin, 52, 0, 0, 1, 1);
+		U8* frame = viewer.acquireLatest(dirty);
+		ensure("new layout acquired", frame != nullptr);
+		ensure_equals("newest frame", *frame, 52);
+		draw(plugin, 53, 0, 0, 1, 1);
+		frame = viewer.acquireLatest(dirty);
+		ensure("frames keep coming", frame != nullptr);
+		ensure_equals("next frame", *frame, 53);
+	}
+}
@@ -767,7 +767,8 @@ BOOL LLPrimitive::setVolume(const LLVolumeParams &volume_params, const S32 detai
 			}
 		}
 
-		volumep = sVolumeManager->refVolume(volume_params, detail);
+		// Prim faces may still be generating, see LLVolume::isGenerating()
+		volumep = sVolumeManager->refVolume(volume_params, detail, true);
 		if (volumep == mVolumep)
 		{
 			sVolumeManager->unrefVolume( volumep );  // LLVolumeMgr::refVolume() creates a reference, but we don't need a second one.
@@ -173,6 +173,7 @@ LLGLManager::LLGLManager() :
 	mHasSync(FALSE),
 	mHasMapBufferRange(FALSE),
 	mHasFlushBufferRange(FALSE),
+	mHasBufferStorage(FALSE),
 	mHasPBuffer(FALSE),
 	mHasShaderObjects(FALSE),
 	mNumTextureImageUnits(0),
@@ -723,6 +724,9 @@ void LLGLManager::initExtensions()
     mHasSync = extensions.find("GL_ARB_sync") != extensions.end();
     mHasMapBufferRange = extensions.find("GL_ARB_map_buffer_range") != extensions.end();
     mHasFlushBufferRange = extensions.find("GL_APPLE_flush_buffer_range") != extensions.end();
+#ifdef GL_ARB_buffer_storage
+    mHasBufferStorage = extensions.find("GL_ARB_buffer_storage") != extensions.end();
+#endif
     mHasDepthClamp = extensions.find("GL_ARB_depth_clamp") != extensions.end()
                      || extensions.find("GL_NV_depth_clamp") != extensions.end();
     // mask out FBO support when packed_depth_stencil isn't there 'cause we need it for LLRenderTarget -Brad
@@ -785,6 +789,9 @@ void LLGLManager::initExtensions()
 	mHasSync = GLEW_ARB_sync;
 	mHasMapBufferRange = GLEW_ARB_map_buffer_range;
 	mHasFlushBufferRange = GLEW_APPLE_flush_buffer_range;
+#ifdef GL_ARB_buffer_storage
+	mHasBufferStorage = GLEW_ARB_buffer_storage;
+#endif
 	mHasDepthClamp = GLEW_ARB_depth_clamp || GLEW_NV_depth_clamp;
 	// mask out FBO support when packed_depth_stencil isn't there 'cause we need it for LLRenderTarget -Brad
 #ifdef GL_ARB_framebuffer_object
@@ -91,6 +91,7 @@ public:
 	BOOL mHasSync;
 	BOOL mHasMapBufferRange;
 	BOOL mHasFlushBufferRange;
+	BOOL mHasBufferStorage;
 	BOOL mHasPBuffer;
 	BOOL mHasShaderObjects;
 	S32  mNumTextureImageUnits;
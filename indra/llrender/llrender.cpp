@@ -1139,6 +1139,8 @@ void LLRender::restoreVertexBuffers()
 	llassert_always(mBuffer.isNull());
 	stop_glerror();
 	mBuffer = new LLVertexBuffer(immediate_mask, 0);
+	//flush() maps exactly what it draws
+	mBuffer->setStreamRing();
 	stop_glerror();
 	mBuffer->allocateBuffer(4096, 0, TRUE);
 	stop_glerror();
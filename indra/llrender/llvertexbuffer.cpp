@@ -102,7 +102,7 @@ U32 LLVertexBuffer::sBindCount = 0;
 U32 LLVertexBuffer::sSetCount = 0;
 S32 LLVertexBuffer::sCount = 0;
 S32 LLVertexBuffer::sGLCount = 0;
-S32 LLVertexBuffer::sMappedCount = 0;
+std::atomic<S32> LLVertexBuffer::sMappedCount(0);
 bool LLVertexBuffer::sDisableVBOMapping = true;
 bool LLVertexBuffer::sEnableVBOs = true;
 U32 LLVertexBuffer::sGLRenderBuffer = 0;
@@ -117,6 +117,8 @@ bool LLVertexBuffer::sMapped = false;
 bool LLVertexBuffer::sUseStreamDraw = true;
 bool LLVertexBuffer::sUseVAO = false;
 bool LLVertexBuffer::sPreferStreamDraw = false;
+bool LLVertexBuffer::sUseStreamRing = false;
+LLStreamRing LLVertexBuffer::sStreamRing;
 LLVertexBuffer* LLVertexBuffer::sUtilityBuffer = nullptr;
 
 #if LL_DEBUG || LL_RELEASE_WITH_DEBUG_INFO
@@ -189,6 +191,119 @@ void clean_validate_buffers()
 #define clean_validate_buffers()
 #endif
 
+//============================================================================
+
+static const U32 STREAM_RING_SIZE = 16 * 1024 * 1024;
+
+static LLTrace::BlockTimerStatHandle FTM_STREAM_RING_WAIT("Stream Ring Wait");
+
+LLStreamRing::LLStreamRing()
+:	mBytesCopied(0),
+	mWaitCount(0),
+	mGLName(0),
+	mMappedData(nullptr),
+	mSegmentSize(0),
+	mHead(0),
+	mSegment(0),
+	mSegmentSerial(0)
+{
+}
+
+bool LLStreamRing::init(U32 size)
+{
+	cleanup();
+
+#if defined(GL_ARB_buffer_storage) && defined(GL_ARB_sync)
+	if (!gGLManager.mHasBufferStorage || !gGLManager.mHasSync)
+	{
+		return false;
+	}
+
+	mSegmentSize = (size / SEGMENT_COUNT) & ~0xF;
+	size = mSegmentSize * SEGMENT_COUNT;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffersARB(1, &mGLName);
+	validate_add_buffer(mGLName);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, mGLName);
+	glBufferStorage(GL_ARRAY_BUFFER_ARB, size, nullptr, flags);
+	mMappedData = (volatile U8*)glMapBufferRange(GL_ARRAY_BUFFER_ARB, 0, size, flags);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	stop_glerror();
+
+	if (!mMappedData)
+	{
+		LL_WARNS() << "Could not map the stream ring, streaming buffers upload on their own." << LL_ENDL;
+		cleanup();
+		return false;
+	}
+
+	mHead = 0;
+	mSegment = 0;
+	LL_INFOS() << "Streaming through a " << size / (1024 * 1024) << " MB persistently mapped ring." << LL_ENDL;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void LLStreamRing::cleanup()
+{
+#ifdef GL_ARB_sync
+	for (LLGLSyncFence& fence : mFences)
+	{
+		if (fence.mSync)
+		{
+			glDeleteSync(fence.mSync);
+			fence.mSync = nullptr;
+		}
+	}
+#endif
+
+	if (mGLName)
+	{ //deleting the buffer unmaps it
+		validate_del_buffer(mGLName);
+		glDeleteBuffersARB(1, &mGLName);
+		mGLName = 0;
+	}
+	mMappedData = nullptr;
+
+	//anything copied so far is gone
+	++mSegmentSerial;
+}
+
+U32 LLStreamRing::allocate(U32 size, volatile U8*& data)
+{
+	llassert(isValid() && size <= mSegmentSize);
+	size = (size + 0xF) & ~0xF;
+
+	if (mHead + size > (mSegment + 1) * mSegmentSize)
+	{ //move on to the next segment, the GPU must be done reading it before it gets written again
+		mFences[mSegment].placeFence();
+		mSegment = (mSegment + 1) % SEGMENT_COUNT;
+		mHead = mSegment * mSegmentSize;
+		++mSegmentSerial;
+
+		LLGLSyncFence& fence = mFences[mSegment];
+		if (!fence.isCompleted())
+		{
+			LL_RECORD_BLOCK_TIME(FTM_STREAM_RING_WAIT);
+			//make sure the fence gets to the GPU before waiting on it
+			glFlush();
+			fence.wait();
+			++mWaitCount;
+		}
+	}
+
+	const U32 offset = mHead;
+	mHead += size;
+	mBytesCopied += size;
+	data = mMappedData + offset;
+	return offset;
+}
+
+//============================================================================
+
 U32 LLVBOPool::genBuffer()
 {
 	U32 ret = 0;
@@ -702,6 +817,7 @@ void LLVertexBuffer::drawArrays(U32 mode, const std::vector<LLVector3>& pos, con
 	if (!sUtilityBuffer)
 	{
 		sUtilityBuffer = new LLVertexBuffer(MAP_VERTEX | MAP_NORMAL | MAP_TEXCOORD0, GL_STREAM_DRAW);
+		sUtilityBuffer->setStreamRing();
 		sUtilityBuffer->allocateBuffer(count, count, true);
 	}
 	if (sUtilityBuffer->getNumVerts() < (S32) count)
@@ -711,8 +827,8 @@ void LLVertexBuffer::drawArrays(U32 mode, const std::vector<LLVector3>& pos, con
 
 	LLStrider<LLVector3> vertex_strider;
 	LLStrider<LLVector3> normal_strider;
-	sUtilityBuffer->getVertexStrider(vertex_strider);
-	sUtilityBuffer->getNormalStrider(normal_strider);
+	sUtilityBuffer->getVertexStrider(vertex_strider, 0, count);
+	sUtilityBuffer->getNormalStrider(normal_strider, 0, count);
 	vertex_strider.copyArray(0, pos.data(), count);
 	normal_strider.copyArray(0, norm.data(), count);
 
@@ -744,6 +860,7 @@ void LLVertexBuffer::drawElements(U32 mode, const S32 num_vertices, const LLVect
 	if (!sUtilityBuffer)
 	{
 		sUtilityBuffer = new LLVertexBuffer(MAP_VERTEX | MAP_NORMAL | MAP_TEXCOORD0, GL_STREAM_DRAW);
+		sUtilityBuffer->setStreamRing();
 		sUtilityBuffer->allocateBuffer(num_vertices, num_indices, true);
 	}
 	if (sUtilityBuffer->getNumVerts() < num_vertices || sUtilityBuffer->getNumIndices() < num_indices)
@@ -755,8 +872,8 @@ void LLVertexBuffer::drawElements(U32 mode, const S32 num_vertices, const LLVect
 
 	LLStrider<U16> index_strider;
 	LLStrider<LLVector4a> vertex_strider;
-	sUtilityBuffer->getIndexStrider(index_strider);
-	sUtilityBuffer->getVertexStrider(vertex_strider);
+	sUtilityBuffer->getIndexStrider(index_strider, 0, num_indices);
+	sUtilityBuffer->getVertexStrider(vertex_strider, 0, num_vertices);
 	const S32 index_size = ((num_indices * sizeof(U16)) + 0xF) & ~0xF;
 	const S32 vertex_size = ((num_vertices * 4 * sizeof(F32)) + 0xF) & ~0xF;
 	LLVector4a::memcpyNonAliased16((F32*)index_strider.get(), (F32*)indicesp, index_size);
@@ -765,7 +882,7 @@ void LLVertexBuffer::drawElements(U32 mode, const S32 num_vertices, const LLVect
 	{
 		mask = mask | LLVertexBuffer::MAP_TEXCOORD0;
 		LLStrider<LLVector2> tc_strider;
-		sUtilityBuffer->getTexCoord0Strider(tc_strider);
+		sUtilityBuffer->getTexCoord0Strider(tc_strider, 0, num_vertices);
 		const S32 tc_size = ((num_vertices * 2 * sizeof(F32)) + 0xF) & ~0xF;
 		LLVector4a::memcpyNonAliased16((F32*)tc_strider.get(), (F32*)tc, tc_size);
 	}
@@ -986,6 +1103,13 @@ void LLVertexBuffer::initClass(bool use_vbo, bool no_vbo_mapping)
 {
 	sEnableVBOs = use_vbo && gGLManager.mHasVertexBufferObject;
 	sDisableVBOMapping = sEnableVBOs;// && no_vbo_mapping;
+
+	sStreamRing.cleanup();
+	if (sEnableVBOs && sUseStreamRing)
+	{
+		sStreamRing.init(STREAM_RING_SIZE);
+		unbind();
+	}
 }
 
 //static 
@@ -1027,6 +1151,7 @@ void LLVertexBuffer::cleanupClass()
 	sDynamicIBOPool.cleanup();
 	sStreamVBOPool.cleanup();
 	sDynamicVBOPool.cleanup();
+	sStreamRing.cleanup();
 	clean_validate_buffers();
 
 	while (!sAvailableVAOName.empty())
@@ -1108,7 +1233,15 @@ LLVertexBuffer::LLVertexBuffer(U32 typemask, S32 usage)
 	mIndexLocked(false),
 	mFinal(false),
 	mEmpty(true),
+	mClientWrite(false),
+	mStreamRing(false),
+	mMappedDataUsingRing(false),
+	mMappedIndexDataUsingRing(false),
 	mMappable(false),
+	mRingSerial(0),
+	mRingIndicesWritten(0),
+	mRingIndicesCopied(0),
+	mRingIndicesSerial(0),
 	mFence(nullptr)
 {
 	mMappable = (mUsage == GL_DYNAMIC_DRAW_ARB && !sDisableVBOMapping);
@@ -1117,6 +1250,9 @@ LLVertexBuffer::LLVertexBuffer(U32 typemask, S32 usage)
 	for (U32 i = 0; i < TYPE_MAX; i++)
 	{
 		mOffsets[i] = 0;
+		mRingWritten[i] = 0;
+		mRingCopied[i] = 0;
+		mRingOffsets[i] = 0;
 	}
 
 	sCount++;
@@ -1314,8 +1450,25 @@ bool LLVertexBuffer::createGLBuffer(U32 size)
 	mResidentSize = size;
 
 	mMappedDataUsingVBOs = useVBOs();
+	//each of the vertex and index copies must fit in a ring segment alongside the other
+	mMappedDataUsingRing = mMappedDataUsingVBOs && mStreamRing && !mMappable && sStreamRing.isValid()
+		&& size <= sStreamRing.getMaxAllocation() / 2;
 	
-	if (mMappedDataUsingVBOs)
+	if (mMappedDataUsingRing)
+	{ //client memory only, flushes copy it to the ring
+		mGLBuffer = sStreamRing.getGLName();
+		mMappedData = (U8*)ll_aligned_malloc_16(size);
+		disclaimMem(mSize);
+		mSize = size;
+		claimMem(mSize);
+		for (U32 i = 0; i < TYPE_MAX; i++)
+		{
+			mRingWritten[i] = 0;
+			mRingCopied[i] = 0;
+		}
+		mRingSerial = sStreamRing.getSegmentSerial() - 1;
+	}
+	else if (mMappedDataUsingVBOs)
 	{
 		genBuffer(size);
 	}
@@ -1357,8 +1510,21 @@ bool LLVertexBuffer::createGLIndices(U32 size)
 	size += 16;
 
 	mMappedIndexDataUsingVBOs = useVBOs();
+	mMappedIndexDataUsingRing = mMappedIndexDataUsingVBOs && mStreamRing && !mMappable && sStreamRing.isValid()
+		&& size <= sStreamRing.getMaxAllocation() / 2;
 
-	if (mMappedIndexDataUsingVBOs)
+	if (mMappedIndexDataUsingRing)
+	{
+		mGLIndices = sStreamRing.getGLName();
+		mMappedIndexData = (U8*)ll_aligned_malloc_16(size);
+		disclaimMem(mIndicesSize);
+		mIndicesSize = size;
+		claimMem(mIndicesSize);
+		mRingIndicesWritten = 0;
+		mRingIndicesCopied = 0;
+		mRingIndicesSerial = sStreamRing.getSegmentSerial() - 1;
+	}
+	else if (mMappedIndexDataUsingVBOs)
 	{
 		//pad by another 16 bytes for VBO pointer adjustment
 		size += 16;
@@ -1385,7 +1551,7 @@ void LLVertexBuffer::destroyGLBuffer()
 {
 	if (mGLBuffer || mMappedData)
 	{
-		if (mMappedDataUsingVBOs)
+		if (mMappedDataUsingVBOs && !mMappedDataUsingRing)
 		{
 			releaseBuffer();
 		}
@@ -1399,6 +1565,7 @@ void LLVertexBuffer::destroyGLBuffer()
 	}
 	
 	mGLBuffer = 0;
+	mMappedDataUsingRing = false;
 	//unbind();
 }
 
@@ -1406,7 +1573,7 @@ void LLVertexBuffer::destroyGLIndices()
 {
 	if (mGLIndices || mMappedIndexData)
 	{
-		if (mMappedIndexDataUsingVBOs)
+		if (mMappedIndexDataUsingVBOs && !mMappedIndexDataUsingRing)
 		{
 			releaseIndices();
 		}
@@ -1420,6 +1587,8 @@ void LLVertexBuffer::destroyGLIndices()
 	}
 
 	mGLIndices = 0;
+	mAlignedIndexOffset = 0;
+	mMappedIndexDataUsingRing = false;
 	//unbind();
 }
 
@@ -1490,8 +1659,8 @@ bool LLVertexBuffer::allocateBuffer(S32 nverts, S32 nindices, bool create)
 		//actually allocate space for the vertex buffer if using VBO mapping
 		flush(); //unmap
 
-		if (gGLManager.mHasVertexArrayObject && useVBOs() && sUseVAO)
-		{
+		if (gGLManager.mHasVertexArrayObject && useVBOs() && sUseVAO && !mMappedDataUsingRing)
+		{ //the ring moves the arrays around with every copy, no VAO for it
 #if GL_ARB_vertex_array_object
 			mGLArray = getVAOName();
 #endif
@@ -1677,12 +1846,89 @@ bool expand_region(LLVertexBuffer::MappedRegion& region, U32 offset, U32 length)
 	return true;
 }
 
+//note a range about to be written, merging it with the ranges it touches
+static void map_region(std::vector<LLVertexBuffer::MappedRegion>& regions, S32 type, U32 offset, U32 length, bool mapped_range)
+{
+	//see if range is already mapped
+	for (U32 i = 0; i < regions.size(); ++i)
+	{
+		LLVertexBuffer::MappedRegion& region = regions[i];
+		if (expand_region(region, offset, length))
+		{
+			++i;
+			while (LLVertexBuffer::MappedRegion* pNext = i < regions.size() ? &regions[i] : nullptr)
+			{
+				if (expand_region(region, pNext->mOffset, pNext->mLength))
+				{
+					regions.erase(regions.begin() + i);
+				}
+				else
+				{
+					++i;
+				}
+			}
+			return;
+		}
+	}
+
+	//not already mapped, map new region
+	regions.emplace_back(type, mapped_range ? -1 : offset, length);
+}
+
+void LLVertexBuffer::beginClientWrite()
+{
+	llassert(canClientWrite());
+	mClientWrite = true;
+}
+
+void LLVertexBuffer::setStreamRing()
+{
+	llassert(!mGLBuffer && !mGLIndices);
+	mStreamRing = true;
+}
+
 static LLTrace::BlockTimerStatHandle FTM_VBO_MAP_BUFFER_RANGE("VBO Map Range");
 static LLTrace::BlockTimerStatHandle FTM_VBO_MAP_BUFFER("VBO Map");
 
 // Map for data access
 volatile U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 index, S32 count, bool map_range)
 {
+	if (mMappedDataUsingRing)
+	{ //client memory only, note how far the array is written for the ring copy
+		if (count == -1)
+		{
+			count = mNumVerts-index;
+		}
+		mRingWritten[type] = llmax(mRingWritten[type], (U32)(sTypeSize[type] * (index + count)));
+		if (!mVertexLocked)
+		{
+			mVertexLocked = true;
+			sMappedCount++;
+		}
+		return mMappedData+mOffsets[type]+sTypeSize[type]*index;
+	}
+
+	if (mClientWrite)
+	{ //possibly off the main thread, only note what flush() will have to upload
+		if (useVBOs())
+		{
+			if (count == -1)
+			{
+				count = mNumVerts-index;
+			}
+			if (getSize() > LL_VBO_BLOCK_SIZE)
+			{
+				map_region(mMappedVertexRegions, type, mOffsets[type] + sTypeSize[type] * index, sTypeSize[type] * count, false);
+			}
+			if (!mVertexLocked)
+			{
+				mVertexLocked = true;
+				sMappedCount++;
+			}
+		}
+		return mMappedData+mOffsets[type]+sTypeSize[type]*index;
+	}
+
 	bindGLBuffer();
 	if (mFinal)
 	{
@@ -1706,37 +1952,7 @@ volatile U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 index, S32 count, boo
 			{
 				U32 offset = mOffsets[type] + sTypeSize[type] * index;
 				U32 length = sTypeSize[type] * count;
-
-				bool mapped = false;
-				//see if range is already mapped
-				for (U32 i = 0; i < mMappedVertexRegions.size(); ++i)
-				{
-					MappedRegion& region = mMappedVertexRegions[i];
-					if (expand_region(region, offset, length))
-					{
-						++i;
-						while (MappedRegion* pNext = i < mMappedVertexRegions.size() ? &mMappedVertexRegions[i] : nullptr)
-						{
-							if (expand_region(region, pNext->mOffset, pNext->mLength))
-							{
-								mMappedVertexRegions.erase(mMappedVertexRegions.begin() + i);
-							}
-							else
-							{
-								++i;
-							}
-						}
-						mapped = true;
-						break;
-					}
-				}
-
-				if (!mapped)
-				{
-					//not already mapped, map new region
-					MappedRegion region(type, mMappable && map_range ? -1 : offset, length);
-					mMappedVertexRegions.push_back(region);
-				}
+				map_region(mMappedVertexRegions, type, offset, length, mMappable && map_range);
 			}
 		}
 
@@ -1879,6 +2095,42 @@ static LLTrace::BlockTimerStatHandle FTM_VBO_MAP_INDEX("IBO Map");
 
 volatile U8* LLVertexBuffer::mapIndexBuffer(S32 index, S32 count, bool map_range)
 {
+	if (mMappedIndexDataUsingRing)
+	{
+		if (count == -1)
+		{
+			count = mNumIndices-index;
+		}
+		mRingIndicesWritten = llmax(mRingIndicesWritten, (U32)(sizeof(U16) * (index + count)));
+		if (!mIndexLocked)
+		{
+			mIndexLocked = true;
+			sMappedCount++;
+		}
+		return mMappedIndexData+sizeof(U16)*index;
+	}
+
+	if (mClientWrite)
+	{ //possibly off the main thread, only note what flush() will have to upload
+		if (useVBOs())
+		{
+			if (count == -1)
+			{
+				count = mNumIndices-index;
+			}
+			if (getIndicesSize() > LL_VBO_BLOCK_SIZE)
+			{
+				map_region(mMappedIndexRegions, TYPE_INDEX, sizeof(U16) * index, sizeof(U16) * count, false);
+			}
+			if (!mIndexLocked)
+			{
+				mIndexLocked = true;
+				sMappedCount++;
+			}
+		}
+		return mMappedIndexData+sizeof(U16)*index;
+	}
+
 	bindGLIndices();
 	if (mFinal)
 	{
@@ -1902,37 +2154,7 @@ volatile U8* LLVertexBuffer::mapIndexBuffer(S32 index, S32 count, bool map_range
 			{
 				U32 offset = sizeof(U16) * index;
 				U32 length = sizeof(U16) * count;
-
-				bool mapped = false;
-				//see if range is already mapped
-				for (U32 i = 0; i < mMappedIndexRegions.size(); ++i)
-				{
-					MappedRegion& region = mMappedIndexRegions[i];
-					if (expand_region(region, offset, length))
-					{
-						++i;
-						while (MappedRegion* pNext = i < mMappedIndexRegions.size() ? &mMappedIndexRegions[i] : nullptr)
-						{
-							if (expand_region(region, pNext->mOffset, pNext->mLength))
-							{
-								mMappedIndexRegions.erase(mMappedIndexRegions.begin() + i);
-							}
-							else
-							{
-								++i;
-							}
-						}
-						mapped = true;
-						break;
-					}
-				}
-
-				if (!mapped)
-				{
-					//not already mapped, map new region
-					MappedRegion region(TYPE_INDEX, mMappable && map_range ? -1 : offset, length);
-					mMappedIndexRegions.push_back(region);
-				}
+				map_region(mMappedIndexRegions, TYPE_INDEX, offset, length, mMappable && map_range);
 			}
 		}
 
@@ -2074,6 +2296,14 @@ void LLVertexBuffer::unmapBuffer()
 
 	bool updated_all = false;
 
+	if (mMappedDataUsingRing && mVertexLocked)
+	{
+		updated_all = mIndexLocked;
+		copyToStreamRing();
+		mVertexLocked = false;
+		sMappedCount--;
+	}
+
 	if (mMappedData && mVertexLocked)
 	{
 		//LL_RECORD_BLOCK_TIME(FTM_VBO_UNMAP);
@@ -2155,6 +2385,13 @@ void LLVertexBuffer::unmapBuffer()
 		sMappedCount--;
 	}
 	
+	if (mMappedIndexDataUsingRing && mIndexLocked)
+	{
+		copyIndicesToStreamRing();
+		mIndexLocked = false;
+		sMappedCount--;
+	}
+	
 	if (mMappedIndexData && mIndexLocked)
 	{
 		//LL_RECORD_BLOCK_TIME(FTM_IBO_UNMAP);
@@ -2240,6 +2477,65 @@ void LLVertexBuffer::unmapBuffer()
 	}
 }
 
+static LLTrace::BlockTimerStatHandle FTM_STREAM_RING_COPY("Stream Ring Copy");
+
+void LLVertexBuffer::copyToStreamRing()
+{
+	LL_RECORD_BLOCK_TIME(FTM_STREAM_RING_COPY);
+	//arrays left alone since the last copy are copied as far as they were then
+	U32 size = 0;
+	for (U32 i = 0; i < TYPE_TEXTURE_INDEX; ++i)
+	{
+		if (mTypeMask & (1 << i))
+		{
+			if (mRingWritten[i])
+			{
+				mRingCopied[i] = mRingWritten[i];
+				mRingWritten[i] = 0;
+			}
+			size += (mRingCopied[i] + 0xF) & ~0xF;
+		}
+	}
+
+	volatile U8* dest = nullptr;
+	U32 offset = sStreamRing.allocate(size, dest);
+	for (U32 i = 0; i < TYPE_TEXTURE_INDEX; ++i)
+	{
+		if (mTypeMask & (1 << i))
+		{
+			const U32 length = (mRingCopied[i] + 0xF) & ~0xF;
+			if (length)
+			{ //arrays are 16 byte aligned and padded in both buffers
+				LLVector4a::memcpyNonAliased16((F32*)dest, (F32*)(mMappedData + mOffsets[i]), length);
+			}
+			mRingOffsets[i] = offset;
+			offset += length;
+			dest += length;
+		}
+	}
+	mRingOffsets[TYPE_TEXTURE_INDEX] = mRingOffsets[TYPE_VERTEX] + 12;
+	mRingSerial = sStreamRing.getSegmentSerial();
+}
+
+void LLVertexBuffer::copyIndicesToStreamRing()
+{
+	LL_RECORD_BLOCK_TIME(FTM_STREAM_RING_COPY);
+	if (mRingIndicesWritten)
+	{
+		mRingIndicesCopied = mRingIndicesWritten;
+		mRingIndicesWritten = 0;
+	}
+
+	const U32 length = (mRingIndicesCopied + 0xF) & ~0xF;
+	volatile U8* dest = nullptr;
+	mAlignedIndexOffset = sStreamRing.allocate(length, dest);
+	if (length)
+	{ //createGLIndices() padded the client copy by 16 bytes
+		LLVector4a::memcpyNonAliased16((F32*)dest, (F32*)mMappedIndexData, length);
+	}
+	mRingIndicesSerial = sStreamRing.getSegmentSerial();
+}
+
 //----------------------------------------------------------------------------
 
 template <class T, S32 type>
@@ -2449,6 +2745,7 @@ bool LLVertexBuffer::bindGLIndices(bool force_bind)
 
 void LLVertexBuffer::flush()
 {
+	mClientWrite = false;
 	if (useVBOs())
 	{
 		unmapBuffer();
@@ -2460,6 +2757,21 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 {
 	flush();
 
+	//draws may only read the ring segment being written, the fence placed when leaving it covers them,
+	//copy again what an earlier segment holds (copying one side can move the other's copy behind)
+	while ((mMappedDataUsingRing && mRingSerial != sStreamRing.getSegmentSerial())
+		   || (mMappedIndexDataUsingRing && mRingIndicesSerial != sStreamRing.getSegmentSerial()))
+	{
+		if (mMappedDataUsingRing && mRingSerial != sStreamRing.getSegmentSerial())
+		{
+			copyToStreamRing();
+		}
+		if (mMappedIndexDataUsingRing && mRingIndicesSerial != sStreamRing.getSegmentSerial())
+		{
+			copyIndicesToStreamRing();
+		}
+	}
+
 	//set up pointers if the data mask is different ...
 	bool setup = (sLastMask != data_mask);
 
@@ -2531,7 +2843,8 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 			const bool bindBuffer = bindGLBuffer();
 			const bool bindIndices = bindGLIndices();
 			
-			setup = setup || bindBuffer || bindIndices;
+			//buffers in the ring share its name, their arrays move with each copy
+			setup = setup || bindBuffer || bindIndices || mMappedDataUsingRing;
 		}
 
 		if (gDebugGL && !mGLArray)
@@ -2629,6 +2942,8 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask)
 {
 	stop_glerror();
 	volatile U8* base = useVBOs() ? (U8*) mAlignedOffset : mMappedData;
+	//arrays copied to the stream ring each have their own offset in it
+	const S32* offsets = mMappedDataUsingRing ? mRingOffsets : mOffsets;
 
 	if (gDebugGL && ((data_mask & mTypeMask) != data_mask))
 	{
@@ -2648,50 +2963,50 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask)
 		if (data_mask & MAP_NORMAL)
 		{
 			S32 loc = TYPE_NORMAL;
-			void* ptr = (void*)(base + mOffsets[TYPE_NORMAL]);
+			void* ptr = (void*)(base + offsets[TYPE_NORMAL]);
 			glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_NORMAL], ptr);
 		}
 		if (data_mask & MAP_TEXCOORD3)
 		{
 			S32 loc = TYPE_TEXCOORD3;
-			void* ptr = (void*)(base + mOffsets[TYPE_TEXCOORD3]);
+			void* ptr = (void*)(base + offsets[TYPE_TEXCOORD3]);
 			glVertexAttribPointer(loc,2,GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD3], ptr);
 		}
 		if (data_mask & MAP_TEXCOORD2)
 		{
 			S32 loc = TYPE_TEXCOORD2;
-			void* ptr = (void*)(base + mOffsets[TYPE_TEXCOORD2]);
+			void* ptr = (void*)(base + offsets[TYPE_TEXCOORD2]);
 			glVertexAttribPointer(loc,2,GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD2], ptr);
 		}
 		if (data_mask & MAP_TEXCOORD1)
 		{
 			S32 loc = TYPE_TEXCOORD1;
-			void* ptr = (void*)(base + mOffsets[TYPE_TEXCOORD1]);
+			void* ptr = (void*)(base + offsets[TYPE_TEXCOORD1]);
 			glVertexAttribPointer(loc,2,GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD1], ptr);
 		}
 		if (data_mask & MAP_TANGENT)
 		{
 			S32 loc = TYPE_TANGENT;
-			void* ptr = (void*)(base + mOffsets[TYPE_TANGENT]);
+			void* ptr = (void*)(base + offsets[TYPE_TANGENT]);
 			glVertexAttribPointer(loc, 4,GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_TANGENT], ptr);
 		}
 		if (data_mask & MAP_TEXCOORD0)
 		{
 			S32 loc = TYPE_TEXCOORD0;
-			void* ptr = (void*)(base + mOffsets[TYPE_TEXCOORD0]);
+			void* ptr = (void*)(base + offsets[TYPE_TEXCOORD0]);
 			glVertexAttribPointer(loc,2,GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD0], ptr);
 		}
 		if (data_mask & MAP_COLOR)
 		{
 			S32 loc = TYPE_COLOR;
 			//bind emissive instead of color pointer if emissive is present
-			void* ptr = (data_mask & MAP_EMISSIVE) ? (void*)(base + mOffsets[TYPE_EMISSIVE]) : (void*)(base + mOffsets[TYPE_COLOR]);
+			void* ptr = (data_mask & MAP_EMISSIVE) ? (void*)(base + offsets[TYPE_EMISSIVE]) : (void*)(base + offsets[TYPE_COLOR]);
 			glVertexAttribPointer(loc, 4, GL_UNSIGNED_BYTE, GL_TRUE, LLVertexBuffer::sTypeSize[TYPE_COLOR], ptr);
 		}
 		if (data_mask & MAP_EMISSIVE)
 		{
 			S32 loc = TYPE_EMISSIVE;
-			void* ptr = (void*)(base + mOffsets[TYPE_EMISSIVE]);
+			void* ptr = (void*)(base + offsets[TYPE_EMISSIVE]);
 			glVertexAttribPointer(loc, 4, GL_UNSIGNED_BYTE, GL_TRUE, LLVertexBuffer::sTypeSize[TYPE_EMISSIVE], ptr);
 
 			if (!(data_mask & MAP_COLOR))
@@ -2703,19 +3018,19 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask)
 		if (data_mask & MAP_WEIGHT)
 		{
 			S32 loc = TYPE_WEIGHT;
-			void* ptr = (void*)(base + mOffsets[TYPE_WEIGHT]);
+			void* ptr = (void*)(base + offsets[TYPE_WEIGHT]);
 			glVertexAttribPointer(loc, 1, GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_WEIGHT], ptr);
 		}
 		if (data_mask & MAP_WEIGHT4)
 		{
 			S32 loc = TYPE_WEIGHT4;
-			void* ptr = (void*)(base+mOffsets[TYPE_WEIGHT4]);
+			void* ptr = (void*)(base+offsets[TYPE_WEIGHT4]);
 			glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_WEIGHT4], ptr);
 		}
 		if (data_mask & MAP_CLOTHWEIGHT)
 		{
 			S32 loc = TYPE_CLOTHWEIGHT;
-			void* ptr = (void*)(base + mOffsets[TYPE_CLOTHWEIGHT]);
+			void* ptr = (void*)(base + offsets[TYPE_CLOTHWEIGHT]);
 			glVertexAttribPointer(loc, 4, GL_FLOAT, GL_TRUE,  LLVertexBuffer::sTypeSize[TYPE_CLOTHWEIGHT], ptr);
 		}
 		if (data_mask & MAP_TEXTURE_INDEX && 
@@ -2723,14 +3038,14 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask)
 		{
 #if !LL_DARWIN
 			S32 loc = TYPE_TEXTURE_INDEX;
-			void *ptr = (void*) (base + mOffsets[TYPE_VERTEX] + 12);
+			void *ptr = (void*) (base + offsets[TYPE_VERTEX] + 12);
 			glVertexAttribIPointer(loc, 1, GL_UNSIGNED_INT, LLVertexBuffer::sTypeSize[TYPE_VERTEX], ptr);
 #endif
 		}
 		if (data_mask & MAP_VERTEX)
 		{
 			S32 loc = TYPE_VERTEX;
-			void* ptr = (void*)(base + mOffsets[TYPE_VERTEX]);
+			void* ptr = (void*)(base + offsets[TYPE_VERTEX]);
 			glVertexAttribPointer(loc, 3,GL_FLOAT, GL_FALSE, LLVertexBuffer::sTypeSize[TYPE_VERTEX], ptr);
 		}	
 	}	
@@ -2738,43 +3053,43 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask)
 	{
 		if (data_mask & MAP_NORMAL)
 		{
-			glNormalPointer(GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_NORMAL], (void*)(base + mOffsets[TYPE_NORMAL]));
+			glNormalPointer(GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_NORMAL], (void*)(base + offsets[TYPE_NORMAL]));
 		}
 		if (data_mask & MAP_TEXCOORD3)
 		{
 			glClientActiveTextureARB(GL_TEXTURE3_ARB);
-			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD3], (void*)(base + mOffsets[TYPE_TEXCOORD3]));
+			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD3], (void*)(base + offsets[TYPE_TEXCOORD3]));
 			glClientActiveTextureARB(GL_TEXTURE0_ARB);
 		}
 		if (data_mask & MAP_TEXCOORD2)
 		{
 			glClientActiveTextureARB(GL_TEXTURE2_ARB);
-			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD2], (void*)(base + mOffsets[TYPE_TEXCOORD2]));
+			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD2], (void*)(base + offsets[TYPE_TEXCOORD2]));
 			glClientActiveTextureARB(GL_TEXTURE0_ARB);
 		}
 		if (data_mask & MAP_TEXCOORD1)
 		{
 			glClientActiveTextureARB(GL_TEXTURE1_ARB);
-			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD1], (void*)(base + mOffsets[TYPE_TEXCOORD1]));
+			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD1], (void*)(base + offsets[TYPE_TEXCOORD1]));
 			glClientActiveTextureARB(GL_TEXTURE0_ARB);
 		}
 		if (data_mask & MAP_TANGENT)
 		{
 			glClientActiveTextureARB(GL_TEXTURE2_ARB);
-			glTexCoordPointer(4,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TANGENT], (void*)(base + mOffsets[TYPE_TANGENT]));
+			glTexCoordPointer(4,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TANGENT], (void*)(base + offsets[TYPE_TANGENT]));
 			glClientActiveTextureARB(GL_TEXTURE0_ARB);
 		}
 		if (data_mask & MAP_TEXCOORD0)
 		{
-			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD0], (void*)(base + mOffsets[TYPE_TEXCOORD0]));
+			glTexCoordPointer(2,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_TEXCOORD0], (void*)(base + offsets[TYPE_TEXCOORD0]));
 		}
 		if (data_mask & MAP_COLOR)
 		{
-			glColorPointer(4, GL_UNSIGNED_BYTE, LLVertexBuffer::sTypeSize[TYPE_COLOR], (void*)(base + mOffsets[TYPE_COLOR]));
+			glColorPointer(4, GL_UNSIGNED_BYTE, LLVertexBuffer::sTypeSize[TYPE_COLOR], (void*)(base + offsets[TYPE_COLOR]));
 		}
 		if (data_mask & MAP_VERTEX)
 		{
-			glVertexPointer(3,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_VERTEX], (void*)(base + 0));
+			glVertexPointer(3,GL_FLOAT, LLVertexBuffer::sTypeSize[TYPE_VERTEX], (void*)(base + offsets[TYPE_VERTEX]));
 		}	
 	}
 
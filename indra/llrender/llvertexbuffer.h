@@ -37,6 +37,7 @@
 #include <vector>
 #include <list>
 #include <deque>
+#include <atomic>
 
 #define LL_MAX_VERTEX_ATTRIB_LOCATION 64
 
@@ -94,6 +95,47 @@ public:
 
 };
 
+//============================================================================
+// one large persistently mapped buffer shared by the streaming buffers which
+// opted in with LLVertexBuffer::setStreamRing(), they copy what they wrote into
+// it when flushed instead of uploading to a buffer of their own
+//  Allocations go around the ring one segment after the other. A fence is placed
+//  when allocations leave a segment and waited on before coming back to it, which
+//  only stalls when the GPU is a whole ring behind.
+class LLStreamRing
+{
+public:
+	static const U32 SEGMENT_COUNT = 4;
+
+	LLStreamRing();
+
+	// false if persistent mapping is not available
+	bool init(U32 size);
+	void cleanup();
+
+	bool isValid() const				{ return mGLName != 0; }
+	U32 getGLName() const				{ return mGLName; }
+	U32 getMaxAllocation() const		{ return mSegmentSize; }
+	// changes every time allocations move on to another segment
+	U32 getSegmentSerial() const		{ return mSegmentSerial; }
+
+	// offset in the buffer of size bytes, 16 byte aligned, which can be written at data
+	U32 allocate(U32 size, volatile U8*& data);
+
+	// for the debug display, reset once a frame by the caller
+	U64 mBytesCopied;
+	U32 mWaitCount;
+
+private:
+	U32 mGLName;
+	volatile U8* mMappedData;
+	U32 mSegmentSize;
+	U32 mHead;
+	U32 mSegment;
+	U32 mSegmentSerial;
+	LLGLSyncFence mFences[SEGMENT_COUNT];
+};
+
 
 //============================================================================
 // base class 
@@ -126,6 +168,8 @@ public:
 	static bool	sUseStreamDraw;
 	static bool sUseVAO;
 	static bool	sPreferStreamDraw;
+	static bool sUseStreamRing;
+	static LLStreamRing sStreamRing;
 
 	static void seedPools();
 
@@ -212,6 +256,8 @@ protected:
 	bool	updateNumVerts(S32 nverts);
 	bool	updateNumIndices(S32 nindices); 
 	void	unmapBuffer();
+	void	copyToStreamRing();
+	void	copyIndicesToStreamRing();
 		
 public:
 	LLVertexBuffer(U32 typemask, S32 usage);
@@ -254,6 +300,14 @@ public:
 	bool useVBOs() const;
 	bool isEmpty() const					{ return mEmpty; }
 	bool isLocked() const					{ return mVertexLocked || mIndexLocked; }
+	// True if the buffer is written through a client side copy, which beginClientWrite() can hand to another thread
+	bool canClientWrite() const				{ return !mMappable && !mFinal; }
+	// Lets one other thread at a time fill the client side copy through the getXXXStrider() calls,
+	// which then stay away from GL. The next flush() uploads what was written. Main thread only.
+	void beginClientWrite();
+	// Copies the data into the shared stream ring when flushed instead of uploading it to a buffer of its own.
+	// Only for stream buffers whose draws read no further into each array than it was last written, call before allocateBuffer().
+	void setStreamRing();
 	S32 getNumVerts() const					{ return mNumVerts; }
 	S32 getNumIndices() const				{ return mNumIndices; }
 	
@@ -305,6 +359,10 @@ protected:
 	U32		mIndexLocked : 1;			// if true, index buffer is being or has been written to in client memory
 	U32		mFinal : 1;			// if true, buffer can not be mapped again
 	U32		mEmpty : 1;			// if true, client buffer is empty (or NULL). Old values have been discarded.	
+	U32		mClientWrite : 1;	// if true, another thread may be writing the client side copy, see beginClientWrite()
+	U32		mStreamRing : 1;	// if true, data is copied to sStreamRing when it fits, see setStreamRing()
+	U32		mMappedDataUsingRing : 1;
+	U32		mMappedIndexDataUsingRing : 1;
 	
 	mutable bool	mMappable;     // if true, use memory mapping to upload data (otherwise doublebuffer and use glBufferSubData)
 
@@ -313,6 +371,16 @@ protected:
 	std::vector<MappedRegion> mMappedVertexRegions;
 	std::vector<MappedRegion> mMappedIndexRegions;
 
+	// stream ring copies: bytes of each array written since the last one, then copied by the last one,
+	// where each array was copied to and the segment serial of the copy
+	U32		mRingWritten[TYPE_MAX];
+	U32		mRingCopied[TYPE_MAX];
+	S32		mRingOffsets[TYPE_MAX];
+	U32		mRingSerial;
+	U32		mRingIndicesWritten;
+	U32		mRingIndicesCopied;
+	U32		mRingIndicesSerial;
+
 	mutable LLGLFence* mFence;
 
 	void placeFence() const;
@@ -323,7 +391,7 @@ protected:
 public:
 	static S32 sCount;
 	static S32 sGLCount;
-	static S32 sMappedCount;
+	static std::atomic<S32> sMappedCount;
 	static bool sMapped;
 	typedef std::list<LLVertexBuffer*> buffer_list_t;
 		
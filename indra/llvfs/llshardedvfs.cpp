@@ -0,0 +1,1382 @@
+/**
+ * @file llshardedvfs.cpp
+ * @brief Sharded, segment file based implementation of the virtual file system
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llshardedvfs.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "llcrc.h"
+#include "lldir.h"
+#include "lldiriterator.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+static const U32 MAX_SEGMENT_SIZE = 16 * 1024 * 1024;	// a new segment is started past this
+static const U32 MIN_SEGMENT_SIZE = 256 * 1024;
+static const U64 MIN_SHARD_BUDGET = 1024 * 1024;
+static const U32 COPY_BUFFER_SIZE = 64 * 1024;
+static const U32 JOURNAL_MAGIC = 0x53465653;		// "SVFS"
+static const U32 JOURNAL_VERSION = 1;
+static const F32 EVICT_FRACTION = 0.1f;				// share of the shard budget freed in one stroke
+static const U32 COMPACT_INTERVAL_MS = 5000;
+static const U32 MAX_STORE_RETRIES = 256;			// other names tried when a store is in use
+static const char* JOURNAL_FILENAME = "index";
+static const char* SNAPSHOT_FILENAME = "index.tmp";
+
+enum EJournalOp
+{
+	JOURNAL_PUT = 1,
+	JOURNAL_REMOVE = 2
+};
+
+struct JournalHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+};
+
+struct JournalEntry
+{
+	U32 mOp;
+	S32 mType;
+	U8 mID[UUID_BYTES];
+	U32 mSegment;
+	U32 mOffset;
+	S32 mSize;
+	S32 mLength;
+	U32 mAccessTime;
+	U32 mCRC;			// of all of the above
+
+	U32 computeCRC() const
+	{
+		LLCRC crc;
+		crc.update((const U8*)this, offsetof(JournalEntry, mCRC));
+		return crc.getCRC();
+	}
+};
+
+//============================================================================
+
+class LLShardedVFS::CompactThread : public LLThread
+{
+public:
+	CompactThread(LLShardedVFS* vfs)
+	:	LLThread("VFS Compaction"),
+		mVFS(vfs)
+	{
+	}
+
+	void run() override
+	{
+		while (!isQuitting())
+		{
+			mVFS->compact();
+
+			// Nothing here is urgent, but stay responsive to shutdown
+			for (U32 slept = 0; slept < COMPACT_INTERVAL_MS && !isQuitting(); slept += 100)
+			{
+				ms_sleep(100);
+			}
+		}
+	}
+
+private:
+	LLShardedVFS* mVFS;
+};
+
+//============================================================================
+
+// static
+LLShardedVFS* LLShardedVFS::createShardedVFS(const std::string& dirname, const BOOL read_only, const U64 max_size)
+{
+	LLShardedVFS* new_vfs = new LLShardedVFS(dirname, read_only, max_size);
+
+	// Another viewer holds the store, retry with new names like createLLVFS()
+	U32 count = 0;
+	while (!new_vfs->isValid() && new_vfs->getValidState() != VFSVALID_BAD_CANNOT_OPEN_READONLY && count < MAX_STORE_RETRIES)
+	{
+		delete new_vfs;
+		new_vfs = new LLShardedVFS(dirname + llformat(".%u", count), read_only, max_size);
+		count++;
+	}
+
+	if (!new_vfs->isValid())
+	{
+		delete new_vfs;
+		new_vfs = nullptr;
+	}
+
+	return new_vfs;
+}
+
+// static
+void LLShardedVFS::deleteStores(const std::string& dirname)
+{
+	deleteStore(dirname);
+	// Names may have been skipped by a store that was in use at the time
+	for (U32 count = 0; count < MAX_STORE_RETRIES; ++count)
+	{
+		deleteStore(dirname + llformat(".%u", count));
+	}
+}
+
+// static
+std::string LLShardedVFS::getLockFileName(const std::string& dirname)
+{
+	return dirname + gDirUtilp->getDirDelimiter() + "lock";
+}
+
+// static
+void LLShardedVFS::deleteStore(const std::string& dirname)
+{
+	if (!LLFile::isdir(dirname))
+	{
+		return;
+	}
+
+	const std::string lock_filename = getLockFileName(dirname);
+	if (LLFile::isfile(lock_filename))
+	{
+		// Held by a store open in some viewer, read-only ones included
+		LLFILE* fp = openAndLock(lock_filename, "rb", FALSE);
+		if (!fp)
+		{
+			LL_INFOS("VFS") << "Not deleting " << dirname << ", it is in use" << LL_ENDL;
+			return;
+		}
+		unlockAndClose(fp);
+	}
+	gDirUtilp->deleteDirAndContents(dirname);
+}
+
+LLShardedVFS::LLShardedVFS(const std::string& dirname, const BOOL read_only, const U64 max_size)
+:	LLVFS(read_only),
+	mDirName(dirname),
+	mLockFP(nullptr),
+	mShardBudget(llmax(max_size / NUM_SHARDS, MIN_SHARD_BUDGET)),
+	// Several segments per shard so compaction has something to pick from
+	mSegmentSize(llclamp((U32)llmin(mShardBudget / 4, (U64)MAX_SEGMENT_SIZE), MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE)),
+	mCompactThread(nullptr)
+{
+	mDataFilename = mDirName;
+
+	if (!mReadOnly)
+	{
+		LLFile::mkdir(mDirName);
+	}
+	else if (!LLFile::isdir(mDirName))
+	{
+		LL_WARNS("VFS") << "Can't find " << mDirName << " to open read-only VFS" << LL_ENDL;
+		mValid = VFSVALID_BAD_CANNOT_OPEN_READONLY;
+		return;
+	}
+
+	// Keep other viewer instances out, same locking as the single file VFS
+	mIndexFilename = getLockFileName(mDirName);
+	mLockFP = openAndLock(mIndexFilename, mReadOnly ? "rb" : "a+b", mReadOnly);
+	if (!mLockFP && !mReadOnly)
+	{
+		LL_WARNS("VFS") << "Can't lock " << mDirName << ", it is in use" << LL_ENDL;
+		mValid = VFSVALID_BAD_CANNOT_CREATE;
+		return;
+	}
+
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		Shard& shard = mShards[i];
+		shard.mDirName = mDirName + gDirUtilp->getDirDelimiter() + llformat("%x", i);
+		LLMutexLock lock(&shard.mMutex);
+		if (!openShard(shard))
+		{
+			mValid = mReadOnly ? VFSVALID_BAD_CANNOT_OPEN_READONLY : VFSVALID_BAD_CANNOT_CREATE;
+			return;
+		}
+	}
+
+	mValid = VFSVALID_OK;
+
+	if (!mReadOnly)
+	{
+		mCompactThread = new CompactThread(this);
+		mCompactThread->start();
+	}
+
+	LL_INFOS("VFS") << "Using sharded VFS " << mDirName << " live: " << getLiveBytes() / (1024 * 1024)
+					<< " MB on disk: " << getDiskBytes() / (1024 * 1024) << " MB" << LL_ENDL;
+}
+
+LLShardedVFS::~LLShardedVFS()
+{
+	if (mCompactThread)
+	{
+		mCompactThread->shutdown();
+		delete mCompactThread;
+		mCompactThread = nullptr;
+	}
+
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		closeShard(shard);
+	}
+
+	unlockAndClose(mLockFP);
+	mLockFP = nullptr;
+}
+
+//----------------------------------------------------------------------------
+// Shard management, shard mutex must be locked
+//----------------------------------------------------------------------------
+
+bool LLShardedVFS::openShard(Shard& shard)
+{
+	if (!mReadOnly)
+	{
+		LLFile::mkdir(shard.mDirName);
+	}
+
+	if (!loadJournal(shard))
+	{
+		return false;
+	}
+
+	// Drop records whose data never made it to disk
+	for (record_map_t::iterator iter = shard.mRecords.begin(); iter != shard.mRecords.end();)
+	{
+		const Record& record = iter->second;
+		segment_map_t::iterator seg_iter = shard.mSegments.find(record.mSegment);
+		if (seg_iter == shard.mSegments.end())
+		{
+			Segment segment;
+			llstat file_status;
+			if (LLFile::stat(getSegmentFileName(shard, record.mSegment), &file_status) == 0)
+			{
+				segment.mEnd = (U32)file_status.st_size;
+				seg_iter = shard.mSegments.insert(segment_map_t::value_type(record.mSegment, segment)).first;
+			}
+		}
+		if (seg_iter == shard.mSegments.end() || record.mOffset + (U32)record.mSize > seg_iter->second.mEnd)
+		{
+			LL_WARNS("VFS") << "Dropping " << iter->first.mFileID << " from " << shard.mDirName << ", data is missing" << LL_ENDL;
+			iter = shard.mRecords.erase(iter);
+			continue;
+		}
+		++iter;
+	}
+
+	// Reserved but unwritten space is past the end of the file
+	for (const auto& record_pair : shard.mRecords)
+	{
+		const Record& record = record_pair.second;
+		Segment& segment = shard.mSegments[record.mSegment];
+		segment.mEnd = llmax(segment.mEnd, record.mOffset + (U32)record.mLength);
+		segment.mLiveBytes += record.mLength;
+		shard.mLiveBytes += record.mLength;
+	}
+
+	// Remove segments nothing points to anymore, and never reuse a segment number
+	LLDirIterator iter(shard.mDirName, "*.seg");
+	std::string filename;
+	while (iter.next(filename))
+	{
+		U32 segment_id = (U32)strtoul(filename.c_str(), nullptr, 16);
+		shard.mNextSegment = llmax(shard.mNextSegment, segment_id + 1);
+		segment_map_t::iterator seg_iter = shard.mSegments.find(segment_id);
+		if (!mReadOnly && (seg_iter == shard.mSegments.end() || seg_iter->second.mLiveBytes == 0))
+		{
+			if (seg_iter != shard.mSegments.end())
+			{
+				shard.mSegments.erase(seg_iter);
+			}
+			LLFile::remove(shard.mDirName + gDirUtilp->getDirDelimiter() + filename);
+		}
+	}
+
+	if (mReadOnly)
+	{
+		return true;
+	}
+
+	// Start over with a journal holding only the live records
+	if (!writeSnapshot(shard))
+	{
+		return false;
+	}
+	shard.mJournalFP = LLFile::fopen(shard.mDirName + gDirUtilp->getDirDelimiter() + JOURNAL_FILENAME, "ab");
+	return shard.mJournalFP != nullptr;
+}
+
+void LLShardedVFS::closeShard(Shard& shard)
+{
+	if (shard.mJournalFP)
+	{
+		fclose(shard.mJournalFP);
+		shard.mJournalFP = nullptr;
+		// Clean shutdown, leave a compact index behind
+		writeSnapshot(shard);
+	}
+	for (auto& segment_pair : shard.mSegments)
+	{
+		if (segment_pair.second.mFP)
+		{
+			fclose(segment_pair.second.mFP);
+			segment_pair.second.mFP = nullptr;
+		}
+	}
+	shard.mSegments.clear();
+	shard.mRecords.clear();
+	shard.mLiveBytes = 0;
+}
+
+bool LLShardedVFS::loadJournal(Shard& shard)
+{
+	std::string filename = shard.mDirName + gDirUtilp->getDirDelimiter() + JOURNAL_FILENAME;
+	if (!LLFile::isfile(filename))
+	{
+		// A snapshot is only left on its own if we died right before renaming it
+		filename = shard.mDirName + gDirUtilp->getDirDelimiter() + SNAPSHOT_FILENAME;
+	}
+
+	LLFILE* fp = LLFile::fopen(filename, "rb");
+	if (!fp)
+	{
+		return true; // new shard
+	}
+
+	JournalHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1
+		|| header.mMagic != JOURNAL_MAGIC
+		|| header.mVersion != JOURNAL_VERSION)
+	{
+		LL_WARNS("VFS") << "Discarding incompatible index " << filename << LL_ENDL;
+		fclose(fp);
+		return true;
+	}
+
+	JournalEntry entry;
+	while (fread(&entry, sizeof(entry), 1, fp) == 1)
+	{
+		if (entry.mCRC != entry.computeCRC())
+		{
+			// Torn write from a crash, everything before it is good
+			LL_WARNS("VFS") << "Index " << filename << " is damaged after " << shard.mJournalRecords << " records" << LL_ENDL;
+			break;
+		}
+		LLUUID id;
+		memcpy(id.mData, entry.mID, UUID_BYTES);
+		LLVFSFileSpecifier spec(id, (LLAssetType::EType)entry.mType);
+		if (entry.mOp == JOURNAL_PUT)
+		{
+			Record& record = shard.mRecords[spec];
+			record.mSegment = entry.mSegment;
+			record.mOffset = entry.mOffset;
+			record.mSize = entry.mSize;
+			record.mLength = entry.mLength;
+			record.mAccessTime = entry.mAccessTime;
+		}
+		else
+		{
+			shard.mRecords.erase(spec);
+		}
+		shard.mJournalRecords++;
+	}
+	fclose(fp);
+	return true;
+}
+
+bool LLShardedVFS::writeSnapshot(Shard& shard)
+{
+	const std::string journal_name = shard.mDirName + gDirUtilp->getDirDelimiter() + JOURNAL_FILENAME;
+	const std::string snapshot_name = shard.mDirName + gDirUtilp->getDirDelimiter() + SNAPSHOT_FILENAME;
+
+	LLFILE* fp = LLFile::fopen(snapshot_name, "wb");
+	if (!fp)
+	{
+		LL_WARNS("VFS") << "Unable to write " << snapshot_name << LL_ENDL;
+		return false;
+	}
+
+	JournalHeader header = { JOURNAL_MAGIC, JOURNAL_VERSION };
+	bool success = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	std::vector<JournalEntry> entries;
+	entries.reserve(shard.mRecords.size());
+	for (const auto& record_pair : shard.mRecords)
+	{
+		const Record& record = record_pair.second;
+		JournalEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.mOp = JOURNAL_PUT;
+		entry.mType = record_pair.first.mFileType;
+		memcpy(entry.mID, record_pair.first.mFileID.mData, UUID_BYTES);
+		entry.mSegment = record.mSegment;
+		entry.mOffset = record.mOffset;
+		entry.mSize = record.mSize;
+		entry.mLength = record.mLength;
+		entry.mAccessTime = record.mAccessTime;
+		entry.mCRC = entry.computeCRC();
+		entries.push_back(entry);
+	}
+	if (!entries.empty())
+	{
+		success = success && fwrite(&entries[0], sizeof(JournalEntry), entries.size(), fp) == entries.size();
+	}
+	success = (fclose(fp) == 0) && success;
+	if (!success)
+	{
+		LL_WARNS("VFS") << "Unable to write " << snapshot_name << LL_ENDL;
+		LLFile::remove(snapshot_name);
+		return false;
+	}
+
+	// rename() won't replace a file on windows. If we die in between, loadJournal() picks up the snapshot.
+	LLFile::remove(journal_name, ENOENT);
+	if (LLFile::rename(snapshot_name, journal_name) != 0)
+	{
+		return false;
+	}
+	shard.mJournalRecords = (U32)entries.size();
+	return true;
+}
+
+void LLShardedVFS::journalPut(Shard& shard, const LLVFSFileSpecifier& spec, const Record& record)
+{
+	if (!shard.mJournalFP)
+	{
+		return;
+	}
+	JournalEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.mOp = JOURNAL_PUT;
+	entry.mType = spec.mFileType;
+	memcpy(entry.mID, spec.mFileID.mData, UUID_BYTES);
+	entry.mSegment = record.mSegment;
+	entry.mOffset = record.mOffset;
+	entry.mSize = record.mSize;
+	entry.mLength = record.mLength;
+	entry.mAccessTime = record.mAccessTime;
+	entry.mCRC = entry.computeCRC();
+	if (fwrite(&entry, sizeof(entry), 1, shard.mJournalFP) != 1)
+	{
+		LL_WARNS("VFS") << "Index write failed in " << shard.mDirName << LL_ENDL;
+	}
+	fflush(shard.mJournalFP);
+	shard.mJournalRecords++;
+}
+
+void LLShardedVFS::journalRemove(Shard& shard, const LLVFSFileSpecifier& spec)
+{
+	if (!shard.mJournalFP)
+	{
+		return;
+	}
+	JournalEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.mOp = JOURNAL_REMOVE;
+	entry.mType = spec.mFileType;
+	memcpy(entry.mID, spec.mFileID.mData, UUID_BYTES);
+	entry.mCRC = entry.computeCRC();
+	if (fwrite(&entry, sizeof(entry), 1, shard.mJournalFP) != 1)
+	{
+		LL_WARNS("VFS") << "Index write failed in " << shard.mDirName << LL_ENDL;
+	}
+	fflush(shard.mJournalFP);
+	shard.mJournalRecords++;
+}
+
+std::string LLShardedVFS::getSegmentFileName(const Shard& shard, U32 segment) const
+{
+	return shard.mDirName + gDirUtilp->getDirDelimiter() + llformat("%08x.seg", segment);
+}
+
+LLFILE* LLShardedVFS::getSegmentFile(Shard& shard, U32 segment)
+{
+	segment_map_t::iterator iter = shard.mSegments.find(segment);
+	if (iter == shard.mSegments.end())
+	{
+		return nullptr;
+	}
+	if (!iter->second.mFP)
+	{
+		iter->second.mFP = LLFile::fopen(getSegmentFileName(shard, segment), mReadOnly ? "rb" : "r+b");
+		if (!iter->second.mFP)
+		{
+			LL_WARNS("VFS") << "Unable to open " << getSegmentFileName(shard, segment) << LL_ENDL;
+		}
+	}
+	return iter->second.mFP;
+}
+
+bool LLShardedVFS::reserve(Shard& shard, S32 length, Record& record)
+{
+	segment_map_t::iterator iter = shard.mSegments.find(shard.mActiveSegment);
+	if (iter == shard.mSegments.end()
+		|| (iter->second.mEnd > 0 && iter->second.mEnd + (U32)length > mSegmentSize))
+	{
+		// Seal the current segment (it becomes a compaction candidate) and start a new one
+		U32 segment_id = shard.mNextSegment++;
+		Segment segment;
+		segment.mFP = LLFile::fopen(getSegmentFileName(shard, segment_id), "w+b");
+		if (!segment.mFP)
+		{
+			LL_WARNS("VFS") << "Unable to create " << getSegmentFileName(shard, segment_id) << LL_ENDL;
+			return false;
+		}
+		iter = shard.mSegments.insert(segment_map_t::value_type(segment_id, segment)).first;
+		shard.mActiveSegment = segment_id;
+	}
+
+	Segment& segment = iter->second;
+	record.mSegment = iter->first;
+	record.mOffset = segment.mEnd;
+	record.mLength = length;
+	segment.mEnd += length;
+	segment.mLiveBytes += length;
+	shard.mLiveBytes += length;
+	return true;
+}
+
+// Journal whatever replaces the record before calling this, the segment may be deleted
+void LLShardedVFS::release(Shard& shard, const Record& record)
+{
+	segment_map_t::iterator iter = shard.mSegments.find(record.mSegment);
+	if (iter == shard.mSegments.end())
+	{
+		return;
+	}
+	Segment& segment = iter->second;
+	segment.mLiveBytes -= record.mLength;
+	shard.mLiveBytes -= record.mLength;
+
+	if (segment.mLiveBytes == 0 && iter->first != shard.mActiveSegment && !mReadOnly)
+	{
+		// Nothing left in a sealed segment, no need to wait for compaction
+		if (segment.mFP)
+		{
+			fclose(segment.mFP);
+		}
+		LLFile::remove(getSegmentFileName(shard, iter->first));
+		shard.mSegments.erase(iter);
+	}
+}
+
+void LLShardedVFS::removeRecord(Shard& shard, record_map_t::iterator iter)
+{
+	Record record = iter->second;
+	journalRemove(shard, iter->first);
+	shard.mRecords.erase(iter);
+	release(shard, record);
+}
+
+bool LLShardedVFS::isLockedLocked(const Shard& shard, const LLVFSFileSpecifier& spec) const
+{
+	lock_map_t::const_iterator iter = shard.mLocks.find(spec);
+	if (iter == shard.mLocks.end())
+	{
+		return false;
+	}
+	for (S32 count : iter->second)
+	{
+		if (count > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Least recently used removal of unlocked files, as LLVFS::findFreeBlock() does
+void LLShardedVFS::evict(Shard& shard, const LLVFSFileSpecifier& immune)
+{
+	if (shard.mLiveBytes <= mShardBudget)
+	{
+		return;
+	}
+
+	typedef std::pair<U32, LLVFSFileSpecifier> lru_entry_t;
+	std::vector<lru_entry_t> lru;
+	lru.reserve(shard.mRecords.size());
+	for (const auto& record_pair : shard.mRecords)
+	{
+		if (!(record_pair.first == immune) && !isLockedLocked(shard, record_pair.first))
+		{
+			lru.emplace_back(record_pair.second.mAccessTime, record_pair.first);
+		}
+	}
+	std::sort(lru.begin(), lru.end());
+
+	const U64 target = mShardBudget - (U64)(mShardBudget * EVICT_FRACTION);
+	S32 evicted = 0;
+	for (const lru_entry_t& entry : lru)
+	{
+		if (shard.mLiveBytes <= target)
+		{
+			break;
+		}
+		record_map_t::iterator iter = shard.mRecords.find(entry.second);
+		if (iter != shard.mRecords.end())
+		{
+			removeRecord(shard, iter);
+			evicted++;
+		}
+	}
+	LL_DEBUGS("VFS") << "Evicted " << evicted << " files from " << shard.mDirName << LL_ENDL;
+}
+
+// Copies the record's data to a new region in the active segment and journals the move
+bool LLShardedVFS::moveRecord(Shard& shard, const LLVFSFileSpecifier& spec, Record& record)
+{
+	Record old_record = record;
+	Record new_record = record;
+	if (!reserve(shard, record.mLength, new_record))
+	{
+		return false;
+	}
+
+	LLFILE* src = getSegmentFile(shard, old_record.mSegment);
+	LLFILE* dst = getSegmentFile(shard, new_record.mSegment);
+	bool success = src && dst;
+	std::vector<U8> buffer(llmin((U32)old_record.mSize, COPY_BUFFER_SIZE));
+	for (S32 copied = 0; success && copied < old_record.mSize;)
+	{
+		size_t chunk = llmin((size_t)(old_record.mSize - copied), buffer.size());
+		fseek(src, old_record.mOffset + copied, SEEK_SET);
+		success = fread(&buffer[0], 1, chunk, src) == chunk;
+		if (success)
+		{
+			fseek(dst, new_record.mOffset + copied, SEEK_SET);
+			success = fwrite(&buffer[0], 1, chunk, dst) == chunk;
+		}
+		copied += (S32)chunk;
+	}
+	if (!success)
+	{
+		LL_WARNS("VFS") << "Unable to move " << spec.mFileID << " in " << shard.mDirName << LL_ENDL;
+		release(shard, new_record);
+		return false;
+	}
+	fflush(dst);
+
+	record = new_record;
+	journalPut(shard, spec, record);
+	release(shard, old_record);
+	return true;
+}
+
+U32 LLShardedVFS::pickCompactionCandidate(Shard& shard)
+{
+	U32 candidate = 0;
+	F32 lowest_ratio = 0.5f;
+	for (const auto& segment_pair : shard.mSegments)
+	{
+		const Segment& segment = segment_pair.second;
+		if (segment_pair.first == shard.mActiveSegment || segment.mEnd == 0)
+		{
+			continue;
+		}
+		F32 ratio = (F32)segment.mLiveBytes / (F32)segment.mEnd;
+		if (ratio < lowest_ratio)
+		{
+			lowest_ratio = ratio;
+			candidate = segment_pair.first;
+		}
+	}
+	return candidate;
+}
+
+// Called without the shard mutex, takes it once per file so readers and writers get in between
+bool LLShardedVFS::compactSegment(Shard& shard, U32 segment)
+{
+	std::vector<LLVFSFileSpecifier> specs;
+	{
+		LLMutexLock lock(&shard.mMutex);
+		for (const auto& record_pair : shard.mRecords)
+		{
+			if (record_pair.second.mSegment == segment)
+			{
+				specs.push_back(record_pair.first);
+			}
+		}
+	}
+
+	for (const LLVFSFileSpecifier& spec : specs)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		record_map_t::iterator iter = shard.mRecords.find(spec);
+		if (iter != shard.mRecords.end() && iter->second.mSegment == segment)
+		{
+			if (!moveRecord(shard, spec, iter->second))
+			{
+				return false;
+			}
+		}
+	}
+
+	// release() deleted the segment along with the last record that lived in it
+	LLMutexLock lock(&shard.mMutex);
+	return shard.mSegments.find(segment) == shard.mSegments.end();
+}
+
+S32 LLShardedVFS::compact()
+{
+	if (mReadOnly || !isValid())
+	{
+		return 0;
+	}
+
+	S32 compacted = 0;
+	for (Shard& shard : mShards)
+	{
+		U32 candidate;
+		{
+			LLMutexLock lock(&shard.mMutex);
+			candidate = pickCompactionCandidate(shard);
+		}
+		if (candidate && compactSegment(shard, candidate))
+		{
+			compacted++;
+		}
+	}
+	if (compacted)
+	{
+		LL_DEBUGS("VFS") << "Compacted " << compacted << " segments in " << mDirName << LL_ENDL;
+	}
+	return compacted;
+}
+
+//----------------------------------------------------------------------------
+// LLVFS interface
+//----------------------------------------------------------------------------
+
+BOOL LLShardedVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	Shard& shard = getShard(file_id);
+	LLMutexLock lock(&shard.mMutex);
+
+	record_map_t::iterator iter = shard.mRecords.find(LLVFSFileSpecifier(file_id, file_type));
+	if (iter == shard.mRecords.end())
+	{
+		return FALSE;
+	}
+	iter->second.mAccessTime = (U32)time(nullptr);
+	return TRUE;
+}
+
+S32 LLShardedVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	Shard& shard = getShard(file_id);
+	LLMutexLock lock(&shard.mMutex);
+
+	record_map_t::iterator iter = shard.mRecords.find(LLVFSFileSpecifier(file_id, file_type));
+	if (iter == shard.mRecords.end())
+	{
+		return 0;
+	}
+	iter->second.mAccessTime = (U32)time(nullptr);
+	return iter->second.mSize;
+}
+
+BOOL LLShardedVFS::checkAvailable(S32 max_size)
+{
+	// Space is made by eviction, only files larger than a whole shard can't fit
+	return (U64)max_size <= mShardBudget ? TRUE : FALSE;
+}
+
+S32 LLShardedVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	Shard& shard = getShard(file_id);
+	LLMutexLock lock(&shard.mMutex);
+
+	record_map_t::iterator iter = shard.mRecords.find(LLVFSFileSpecifier(file_id, file_type));
+	if (iter == shard.mRecords.end())
+	{
+		return 0;
+	}
+	iter->second.mAccessTime = (U32)time(nullptr);
+	return iter->second.mLength;
+}
+
+BOOL LLShardedVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size)
+{
+	if (!isValid())
+	{
+		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
+	}
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+	if (max_size <= 0)
+	{
+		LL_WARNS() << "VFS: Attempt to assign size " << max_size << " to vfile " << file_id << LL_ENDL;
+		return FALSE;
+	}
+
+	Shard& shard = getShard(file_id);
+	LLMutexLock lock(&shard.mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	record_map_t::iterator iter = shard.mRecords.find(spec);
+	if (iter == shard.mRecords.end())
+	{
+		Record record;
+		if (!reserve(shard, max_size, record))
+		{
+			LL_WARNS() << "VFS: No space (" << max_size << ") for new virtual file " << file_id << LL_ENDL;
+			return FALSE;
+		}
+		record.mAccessTime = (U32)time(nullptr);
+		shard.mRecords[spec] = record;
+		journalPut(shard, spec, record);
+		evict(shard, spec);
+		return TRUE;
+	}
+
+	Record& record = iter->second;
+	record.mAccessTime = (U32)time(nullptr);
+	if (max_size == record.mLength)
+	{
+		return TRUE;
+	}
+
+	if (max_size < record.mLength)
+	{
+		// Shrinking, the tail of the region becomes dead space
+		S32 dead_bytes = record.mLength - max_size;
+		Segment& segment = shard.mSegments[record.mSegment];
+		segment.mLiveBytes -= dead_bytes;
+		shard.mLiveBytes -= dead_bytes;
+		record.mLength = max_size;
+		if (record.mLength < record.mSize)
+		{
+			LL_WARNS() << "Truncating virtual file " << file_id << " to " << record.mLength << " bytes" << LL_ENDL;
+			record.mSize = record.mLength;
+		}
+		journalPut(shard, spec, record);
+		return TRUE;
+	}
+
+	// Growing, in place if this is the last region of the active segment
+	S32 size_increase = max_size - record.mLength;
+	Segment& segment = shard.mSegments[record.mSegment];
+	if (record.mSegment == shard.mActiveSegment
+		&& record.mOffset + (U32)record.mLength == segment.mEnd
+		&& segment.mEnd + (U32)size_increase <= mSegmentSize)
+	{
+		segment.mEnd += size_increase;
+		segment.mLiveBytes += size_increase;
+		shard.mLiveBytes += size_increase;
+		record.mLength = max_size;
+		journalPut(shard, spec, record);
+		evict(shard, spec);
+		return TRUE;
+	}
+
+	Record grown = record;
+	grown.mLength = max_size;
+	segment.mLiveBytes += size_increase;	// moveRecord() releases the old region at the new length
+	shard.mLiveBytes += size_increase;
+	if (!moveRecord(shard, spec, grown))
+	{
+		segment.mLiveBytes -= size_increase;
+		shard.mLiveBytes -= size_increase;
+		LL_WARNS() << "VFS: No space (" << max_size << ") to resize existing vfile " << file_id << LL_ENDL;
+		return FALSE;
+	}
+	record = grown;
+	evict(shard, spec);
+	return TRUE;
+}
+
+// Locks stay with the name, LLVFile::rename() moves its own lock over
+void LLShardedVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+							  const LLUUID &new_id, const LLAssetType::EType &new_type)
+{
+	if (!isValid())
+	{
+		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
+	}
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+
+	Shard& src_shard = getShard(file_id);
+	Shard& dst_shard = getShard(new_id);
+	// Always lock in the same order, the mutexes are recursive so src == dst is fine
+	Shard& first = (&src_shard < &dst_shard) ? src_shard : dst_shard;
+	Shard& second = (&src_shard < &dst_shard) ? dst_shard : src_shard;
+	LLMutexLock lock_first(&first.mMutex);
+	LLMutexLock lock_second(&second.mMutex);
+
+	LLVFSFileSpecifier old_spec(file_id, file_type);
+	LLVFSFileSpecifier new_spec(new_id, new_type);
+	if (old_spec == new_spec)
+	{
+		return;
+	}
+	record_map_t::iterator src_iter = src_shard.mRecords.find(old_spec);
+	if (src_iter == src_shard.mRecords.end())
+	{
+		LL_WARNS() << "VFS: Attempt to rename nonexistent vfile " << file_id << ":" << file_type << LL_ENDL;
+		return;
+	}
+
+	Record record = src_iter->second;
+	record.mAccessTime = (U32)time(nullptr);
+	if (&src_shard == &dst_shard)
+	{
+		// Replace whatever is in the target location
+		record_map_t::iterator dst_iter = dst_shard.mRecords.find(new_spec);
+		if (dst_iter != dst_shard.mRecords.end())
+		{
+			removeRecord(dst_shard, dst_iter);
+		}
+		src_shard.mRecords.erase(src_iter);
+		src_shard.mRecords[new_spec] = record;
+		journalPut(src_shard, new_spec, record);
+		journalRemove(src_shard, old_spec);
+		return;
+	}
+
+	// Different shards, copy the data over. The source goes only once the copy is safely written,
+	// and whatever is in the target location only once it is replaced.
+	std::vector<U8> buffer(record.mSize);
+	LLFILE* src = getSegmentFile(src_shard, record.mSegment);
+	bool success = src != nullptr;
+	if (success && record.mSize > 0)
+	{
+		fseek(src, record.mOffset, SEEK_SET);
+		success = fread(&buffer[0], 1, record.mSize, src) == (size_t)record.mSize;
+	}
+	Record new_record = record;
+	if (success && reserve(dst_shard, record.mLength, new_record))
+	{
+		LLFILE* dst = getSegmentFile(dst_shard, new_record.mSegment);
+		success = dst != nullptr;
+		if (success && record.mSize > 0)
+		{
+			fseek(dst, new_record.mOffset, SEEK_SET);
+			success = fwrite(&buffer[0], 1, record.mSize, dst) == (size_t)record.mSize;
+			success = fflush(dst) == 0 && success;
+		}
+		if (!success)
+		{
+			release(dst_shard, new_record);
+		}
+	}
+	else
+	{
+		success = false;
+	}
+	if (!success)
+	{
+		LL_WARNS() << "VFS: Unable to rename vfile " << file_id << " to " << new_id << ", keeping it" << LL_ENDL;
+		return;
+	}
+
+	record_map_t::iterator dst_iter = dst_shard.mRecords.find(new_spec);
+	if (dst_iter != dst_shard.mRecords.end())
+	{
+		removeRecord(dst_shard, dst_iter);
+	}
+	dst_shard.mRecords[new_spec] = new_record;
+	journalPut(dst_shard, new_spec, new_record);
+	removeRecord(src_shard, src_iter);
+	evict(dst_shard, new_spec);
+}
+
+void LLShardedVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	if (!isValid())
+	{
+		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
+	}
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+
+	Shard& shard = getShard(file_id);
+	LLMutexLock lock(&shard.mMutex);
+
+	record_map_t::iterator iter = shard.mRecords.find(LLVFSFileSpecifier(file_id, file_type));
+	if (iter != shard.mRecords.end())
+	{
+		removeRecord(shard, iter);
+	}
+	else
+	{
+		LL_WARNS() << "VFS: attempting to remove nonexistent file " << file_id << " type " << file_type << LL_ENDL;
+	}
+}
+
+S32 LLShardedVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length)
+{
+	if (!isValid())
+	{
+		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
+	}
+	llassert(location >= 0);
+	llassert(length >= 0);
+
+	Shard& shard = getShard(file_id);
+	LLMutexLock lock(&shard.mMutex);
+
+	record_map_t::iterator iter = shard.mRecords.find(LLVFSFileSpecifier(file_id, file_type));
+	if (iter == shard.mRecords.end())
+	{
+		return 0;
+	}
+
+	Record& record = iter->second;
+	record.mAccessTime = (U32)time(nullptr);
+	if (location > record.mSize)
+	{
+		LL_WARNS() << "VFS: Attempt to read location " << location << " in file " << file_id << " of length " << record.mSize << LL_ENDL;
+		return 0;
+	}
+	length = llmin(length, record.mSize - location);
+
+	LLFILE* fp = getSegmentFile(shard, record.mSegment);
+	if (!fp || length <= 0)
+	{
+		return 0;
+	}
+	fseek(fp, record.mOffset + location, SEEK_SET);
+	return (S32)fread(buffer, 1, length, fp);
+}
+
+S32 LLShardedVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length)
+{
+	if (!isValid())
+	{
+		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
+	}
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+	llassert(length > 0);
+
+	Shard& shard = getShard(file_id);
+	LLMutexLock lock(&shard.mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	record_map_t::iterator iter = shard.mRecords.find(spec);
+	if (iter == shard.mRecords.end())
+	{
+		return 0;
+	}
+
+	Record& record = iter->second;
+	S32 in_loc = location;
+	if (location == -1)
+	{
+		location = record.mSize;
+	}
+	llassert(location >= 0);
+	record.mAccessTime = (U32)time(nullptr);
+
+	if (location > record.mLength)
+	{
+		LL_WARNS() << "VFS: Attempt to write to location " << in_loc
+				<< " in file " << file_id
+				<< " type " << S32(file_type)
+				<< " of size " << record.mSize
+				<< " block length " << record.mLength
+				<< LL_ENDL;
+		return length;
+	}
+	if (length > record.mLength - location)
+	{
+		LL_WARNS() << "VFS: Truncating write to virtual file " << file_id << " type " << S32(file_type) << LL_ENDL;
+		length = record.mLength - location;
+	}
+
+	LLFILE* fp = getSegmentFile(shard, record.mSegment);
+	if (!fp)
+	{
+		return 0;
+	}
+	fseek(fp, record.mOffset + location, SEEK_SET);
+	S32 write_len = (S32)fwrite(buffer, 1, length, fp);
+	if (write_len != length)
+	{
+		LL_WARNS() << llformat("VFS Write Error: %d != %d", write_len, length) << LL_ENDL;
+	}
+	// The data has to be out before the index entry that covers it
+	fflush(fp);
+
+	if (location + write_len > record.mSize)
+	{
+		record.mSize = location + write_len;
+		journalPut(shard, spec, record);
+	}
+	return write_len;
+}
+
+void LLShardedVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	Shard& shard = getShard(file_id);
+	LLMutexLock shard_lock(&shard.mMutex);
+
+	lock_counts_t& counts = shard.mLocks[LLVFSFileSpecifier(file_id, file_type)];
+	counts[lock]++;
+}
+
+void LLShardedVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	Shard& shard = getShard(file_id);
+	LLMutexLock shard_lock(&shard.mMutex);
+
+	lock_map_t::iterator iter = shard.mLocks.find(LLVFSFileSpecifier(file_id, file_type));
+	if (iter == shard.mLocks.end() || iter->second[lock] <= 0)
+	{
+		LL_WARNS() << "VFS: Decrementing zero-value lock " << lock << LL_ENDL;
+		return;
+	}
+	iter->second[lock]--;
+	if (std::all_of(iter->second.begin(), iter->second.end(), [](S32 count) { return count == 0; }))
+	{
+		shard.mLocks.erase(iter);
+	}
+}
+
+BOOL LLShardedVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	Shard& shard = getShard(file_id);
+	LLMutexLock shard_lock(&shard.mMutex);
+
+	lock_map_t::const_iterator iter = shard.mLocks.find(LLVFSFileSpecifier(file_id, file_type));
+	return (iter != shard.mLocks.end() && iter->second[lock] > 0) ? TRUE : FALSE;
+}
+
+//----------------------------------------------------------------------------
+// Debugging
+//----------------------------------------------------------------------------
+
+void LLShardedVFS::pokeFiles()
+{
+	// Segments are small and opened on demand, there is nothing worth preloading
+}
+
+void LLShardedVFS::audit()
+{
+	S32 bad_records = 0;
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		U64 live_bytes = 0;
+		std::map<U32, U32> segment_live_bytes;
+		for (const auto& record_pair : shard.mRecords)
+		{
+			const Record& record = record_pair.second;
+			segment_map_t::const_iterator iter = shard.mSegments.find(record.mSegment);
+			if (iter == shard.mSegments.end()
+				|| record.mSize > record.mLength
+				|| record.mOffset + (U32)record.mLength > iter->second.mEnd)
+			{
+				LL_WARNS("VFS") << "Bad record " << record_pair.first.mFileID << " in " << shard.mDirName << LL_ENDL;
+				bad_records++;
+			}
+			live_bytes += record.mLength;
+			segment_live_bytes[record.mSegment] += record.mLength;
+		}
+		if (live_bytes != shard.mLiveBytes)
+		{
+			LL_WARNS("VFS") << "Live bytes mismatch in " << shard.mDirName << ": " << live_bytes << " != " << shard.mLiveBytes << LL_ENDL;
+			bad_records++;
+		}
+		for (const auto& segment_pair : shard.mSegments)
+		{
+			if (segment_pair.second.mLiveBytes != segment_live_bytes[segment_pair.first])
+			{
+				LL_WARNS("VFS") << "Live bytes mismatch in segment " << getSegmentFileName(shard, segment_pair.first) << LL_ENDL;
+				bad_records++;
+			}
+		}
+	}
+
+	if (bad_records)
+	{
+		LL_WARNS("VFS") << "VFS audit found " << bad_records << " problems in " << mDirName << LL_ENDL;
+	}
+	else
+	{
+		LL_INFOS("VFS") << "VFS " << mDirName << " passed audit" << LL_ENDL;
+	}
+}
+
+void LLShardedVFS::checkMem()
+{
+	// Regions are never handed out twice, nothing to check
+}
+
+void LLShardedVFS::dumpMap()
+{
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		LL_INFOS() << "Shard " << shard.mDirName << ":" << LL_ENDL;
+		for (const auto& segment_pair : shard.mSegments)
+		{
+			LL_INFOS() << "Segment: " << segment_pair.first << "\tEnd: " << segment_pair.second.mEnd
+					   << "\tLive: " << segment_pair.second.mLiveBytes
+					   << (segment_pair.first == shard.mActiveSegment ? "\t(active)" : "") << LL_ENDL;
+		}
+		for (const auto& record_pair : shard.mRecords)
+		{
+			const Record& record = record_pair.second;
+			LL_INFOS() << "Segment: " << record.mSegment << "\tOffset: " << record.mOffset << "\tLength: " << record.mLength
+					   << "\t" << record_pair.first.mFileID << "\t" << record_pair.first.mFileType << LL_ENDL;
+		}
+	}
+}
+
+void LLShardedVFS::dumpLockCounts()
+{
+	S32 lock_counts[VFSLOCK_COUNT] = { 0 };
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		for (const auto& lock_pair : shard.mLocks)
+		{
+			for (S32 i = 0; i < VFSLOCK_COUNT; i++)
+			{
+				lock_counts[i] += lock_pair.second[i];
+			}
+		}
+	}
+	for (S32 i = 0; i < VFSLOCK_COUNT; i++)
+	{
+		LL_INFOS() << "LockType: " << i << ": " << lock_counts[i] << LL_ENDL;
+	}
+}
+
+void LLShardedVFS::dumpStatistics()
+{
+	size_t files = 0;
+	size_t segments = 0;
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		files += shard.mRecords.size();
+		segments += shard.mSegments.size();
+	}
+	LL_INFOS() << "Sharded VFS " << mDirName << ": " << files << " files in " << segments << " segments, "
+			   << getLiveBytes() / 1024 << " KB live, " << getDiskBytes() / 1024 << " KB on disk, "
+			   << (mShardBudget * NUM_SHARDS) / 1024 << " KB budget" << LL_ENDL;
+}
+
+void LLShardedVFS::listFiles()
+{
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		for (const auto& record_pair : shard.mRecords)
+		{
+			LL_INFOS() << record_pair.first.mFileID << " " << record_pair.first.mFileType << " " << record_pair.second.mSize << LL_ENDL;
+		}
+	}
+}
+
+void LLShardedVFS::dumpFiles()
+{
+	S32 files_extracted = 0;
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		for (const auto& record_pair : shard.mRecords)
+		{
+			const Record& record = record_pair.second;
+			LLFILE* fp = getSegmentFile(shard, record.mSegment);
+			if (!fp || record.mSize <= 0)
+			{
+				continue;
+			}
+			std::vector<U8> buffer(record.mSize);
+			fseek(fp, record.mOffset, SEEK_SET);
+			if (fread(&buffer[0], 1, record.mSize, fp) != (size_t)record.mSize)
+			{
+				continue;
+			}
+
+			std::string extension = LLAssetType::lookup(record_pair.first.mFileType);
+			std::string filename = record_pair.first.mFileID.asString() + "." + extension;
+			LLFILE* out = LLFile::fopen(filename, "wb");
+			if (out)
+			{
+				fwrite(&buffer[0], 1, record.mSize, out);
+				fclose(out);
+				files_extracted++;
+			}
+		}
+	}
+	LL_INFOS() << "Extracted " << files_extracted << " files from " << mDirName << LL_ENDL;
+}
+
+time_t LLShardedVFS::creationTime()
+{
+	llstat lock_file_stat;
+	if (LLFile::stat(mIndexFilename, &lock_file_stat) == 0)
+	{
+		time_t creation_time = lock_file_stat.st_ctime;
+#if LL_DARWIN
+		creation_time = lock_file_stat.st_birthtime;
+#endif
+		return creation_time;
+	}
+	return 0;
+}
+
+U64 LLShardedVFS::getLiveBytes()
+{
+	U64 live_bytes = 0;
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		live_bytes += shard.mLiveBytes;
+	}
+	return live_bytes;
+}
+
+U64 LLShardedVFS::getDiskBytes()
+{
+	U64 disk_bytes = 0;
+	for (Shard& shard : mShards)
+	{
+		LLMutexLock lock(&shard.mMutex);
+		for (const auto& segment_pair : shard.mSegments)
+		{
+			disk_bytes += segment_pair.second.mEnd;
+		}
+	}
+	return disk_bytes;
+}
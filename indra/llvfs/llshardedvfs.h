@@ -0,0 +1,175 @@
+/**
+ * @file llshardedvfs.h
+ * @brief Sharded, segment file based implementation of the virtual file system
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSHARDEDVFS_H
+#define LL_LLSHARDEDVFS_H
+
+#include <array>
+#include <map>
+
+#include "llvfs.h"
+
+// Asset store behind the LLVFS/LLVFile API.
+//
+// Files are keyed by asset id and type and spread over NUM_SHARDS shards by id.
+// Every shard has its own mutex, so mesh, sound and animation traffic on different
+// assets no longer serializes on a single lock and a single data file.
+//
+// Each shard keeps its data in append-only segment files. setMaxSize() reserves a
+// region at the end of the current segment; writes land inside that region, and
+// regions are never reused. Growing a file moves it to a new region, removing or
+// shrinking one leaves dead bytes behind. A background thread rewrites segments
+// that are mostly dead and deletes them.
+//
+// The index of every shard is an append-only journal of checksummed records,
+// written after the data it points to, and replayed on startup up to the first
+// damaged record. It is rewritten as a snapshot on a clean shutdown.
+class LLShardedVFS : public LLVFS
+{
+public:
+	static const S32 NUM_SHARDS = 16;
+
+	// Use this function normally to create a sharded store in dirname.
+	// max_size is the total data budget, least recently used files are removed past it.
+	static LLShardedVFS* createShardedVFS(const std::string& dirname, const BOOL read_only, const U64 max_size);
+	// Deletes the store in dirname, and those createShardedVFS() made next to it while it was in use.
+	// Stores another viewer instance has open are left alone.
+	static void deleteStores(const std::string& dirname);
+
+	~LLShardedVFS() override;
+
+	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type) override;
+	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type) override;
+
+	BOOL checkAvailable(S32 max_size) override;
+
+	S32  getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type) override;
+	BOOL setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size) override;
+
+	void renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+		const LLUUID &new_id, const LLAssetType::EType &new_type) override;
+	void removeFile(const LLUUID &file_id, const LLAssetType::EType file_type) override;
+
+	S32 getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length) override;
+	S32 storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length) override;
+
+	void incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock) override;
+	void decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock) override;
+	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock) override;
+
+	void pokeFiles() override;
+	void audit() override;
+	void checkMem() override;
+	void dumpMap() override;
+	void dumpLockCounts() override;
+	void dumpStatistics() override;
+	void listFiles() override;
+	void dumpFiles() override;
+	time_t creationTime() override;
+
+	// Rewrites sealed segments holding less than half live data. Called from
+	// the compaction thread, public for tests. Returns the number of segments removed.
+	S32 compact();
+
+	const std::string& getDirName() const { return mDirName; }
+	U64 getLiveBytes();
+	U64 getDiskBytes();
+
+private:
+	LLShardedVFS(const std::string& dirname, const BOOL read_only, const U64 max_size);
+
+	static std::string getLockFileName(const std::string& dirname);
+	static void deleteStore(const std::string& dirname);
+
+	struct Record
+	{
+		Record() : mSegment(0), mOffset(0), mSize(0), mLength(0), mAccessTime(0) {}
+		U32 mSegment;		// segment file holding the data
+		U32 mOffset;		// start of the reserved region in the segment
+		S32 mSize;			// bytes written
+		S32 mLength;		// bytes reserved
+		U32 mAccessTime;
+	};
+
+	struct Segment
+	{
+		Segment() : mFP(nullptr), mEnd(0), mLiveBytes(0) {}
+		LLFILE* mFP;
+		U32 mEnd;			// bytes allocated, the next region starts here
+		U32 mLiveBytes;		// bytes reserved by live records
+	};
+
+	typedef std::map<LLVFSFileSpecifier, Record> record_map_t;
+	typedef std::map<U32, Segment> segment_map_t;
+	typedef std::array<S32, VFSLOCK_COUNT> lock_counts_t;
+	typedef std::map<LLVFSFileSpecifier, lock_counts_t> lock_map_t;
+
+	struct Shard
+	{
+		Shard() : mJournalFP(nullptr), mJournalRecords(0), mActiveSegment(0), mNextSegment(1), mLiveBytes(0) {}
+		LLMutex mMutex;
+		std::string mDirName;
+		record_map_t mRecords;
+		segment_map_t mSegments;
+		lock_map_t mLocks;			// by name, a rename does not move them
+		LLFILE* mJournalFP;
+		U32 mJournalRecords;
+		U32 mActiveSegment;			// 0 until the first reservation
+		U32 mNextSegment;
+		U64 mLiveBytes;
+	};
+
+	class CompactThread;
+
+	Shard& getShard(const LLUUID& file_id) { return mShards[file_id.mData[0] % NUM_SHARDS]; }
+
+	// The following functions need the shard mutex locked
+	bool openShard(Shard& shard);
+	void closeShard(Shard& shard);
+	bool loadJournal(Shard& shard);
+	bool writeSnapshot(Shard& shard);
+	void journalPut(Shard& shard, const LLVFSFileSpecifier& spec, const Record& record);
+	void journalRemove(Shard& shard, const LLVFSFileSpecifier& spec);
+	std::string getSegmentFileName(const Shard& shard, U32 segment) const;
+	LLFILE* getSegmentFile(Shard& shard, U32 segment);
+	bool reserve(Shard& shard, S32 length, Record& record);
+	void release(Shard& shard, const Record& record);
+	void removeRecord(Shard& shard, record_map_t::iterator iter);
+	bool isLockedLocked(const Shard& shard, const LLVFSFileSpecifier& spec) const;
+	void evict(Shard& shard, const LLVFSFileSpecifier& immune);
+	bool moveRecord(Shard& shard, const LLVFSFileSpecifier& spec, Record& record);
+	bool compactSegment(Shard& shard, U32 segment);
+	U32 pickCompactionCandidate(Shard& shard);
+
+	std::string mDirName;
+	LLFILE* mLockFP;
+	U64 mShardBudget;
+	U32 mSegmentSize;
+	std::array<Shard, NUM_SHARDS> mShards;
+	CompactThread* mCompactThread;
+};
+
+#endif
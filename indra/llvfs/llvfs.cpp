@@ -553,6 +553,21 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 	mValid = VFSVALID_OK;
 }
     
+LLVFS::LLVFS(const BOOL read_only)
+:	mDataFP(nullptr),
+	mIndexFP(nullptr),
+	mReadOnly(read_only),
+	mValid(VFSVALID_UNKNOWN),
+	mRemoveAfterCrash(FALSE)
+{
+	mDataMutex = new LLMutex();
+
+	for (S32 i = 0; i < VFSLOCK_COUNT; i++)
+	{
+		mLockCounts[i] = 0;
+	}
+}
+
 LLVFS::~LLVFS()
 {
 	if (mDataMutex->isLocked())
@@ -0,0 +1,336 @@
+/**
+ * @file llshardedvfs_test.cpp
+ * @date 2020-09
+ * @brief LLShardedVFS test cases, and a throughput comparison with LLVFS.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../llshardedvfs.h"
+#include "../lldir.h"
+#include "lltimer.h"
+
+#include "lltut.h"
+
+namespace
+{
+	std::vector<U8> make_data(const LLUUID& id, S32 size)
+	{
+		std::vector<U8> data(size);
+		for (S32 i = 0; i < size; ++i)
+		{
+			data[i] = id.mData[i % UUID_BYTES] ^ (U8)i;
+		}
+		return data;
+	}
+
+	bool store_file(LLVFS* vfs, const LLUUID& id, LLAssetType::EType type, const std::vector<U8>& data)
+	{
+		return vfs->setMaxSize(id, type, (S32)data.size())
+			&& vfs->storeData(id, type, &data[0], 0, (S32)data.size()) == (S32)data.size();
+	}
+
+	bool check_file(LLVFS* vfs, const LLUUID& id, LLAssetType::EType type, const std::vector<U8>& data)
+	{
+		std::vector<U8> buffer(data.size());
+		return vfs->getSize(id, type) == (S32)data.size()
+			&& vfs->getData(id, type, &buffer[0], 0, (S32)buffer.size()) == (S32)buffer.size()
+			&& buffer == data;
+	}
+
+	// Every thread writes its own assets and reads them, and those of the other threads, back.
+	// Returns MB/s of payload moved.
+	F64 run_concurrent_load(LLVFS* vfs, S32 num_threads, S32 files_per_thread, S32 file_size)
+	{
+		std::vector<LLUUID> ids(num_threads * files_per_thread);
+		for (LLUUID& id : ids)
+		{
+			id.generate();
+		}
+		std::atomic<S32> failures(0);
+
+		LLTimer timer;
+		std::vector<std::thread> threads;
+		for (S32 t = 0; t < num_threads; ++t)
+		{
+			threads.emplace_back([&, t]()
+			{
+				std::vector<U8> buffer(file_size);
+				for (S32 i = 0; i < files_per_thread; ++i)
+				{
+					const LLUUID& id = ids[t * files_per_thread + i];
+					std::vector<U8> data = make_data(id, file_size);
+					if (!store_file(vfs, id, LLAssetType::AT_MESH, data))
+					{
+						failures++;
+					}
+					// Read back something another thread is likely working on
+					const LLUUID& other = ids[((t + 1) % num_threads) * files_per_thread + i];
+					vfs->getData(other, LLAssetType::AT_MESH, &buffer[0], 0, file_size);
+					if (!check_file(vfs, id, LLAssetType::AT_MESH, data))
+					{
+						failures++;
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		F64 seconds = llmax(timer.getElapsedTimeF64().value(), 0.001);
+
+		tut::ensure_equals("concurrent load failures", failures.load(), 0);
+		// One write and two reads of every file
+		return (3.0 * ids.size() * file_size) / (1024.0 * 1024.0) / seconds;
+	}
+}
+
+namespace tut
+{
+	struct LLShardedVFSFixture
+	{
+		LLShardedVFSFixture()
+		{
+			LLUUID id;
+			id.generate();
+			mDirName = std::string(LLFile::tmpdir()) + "llshardedvfs_test_" + id.asString();
+		}
+
+		~LLShardedVFSFixture()
+		{
+			gDirUtilp->deleteDirAndContents(mDirName);
+			LLFile::rmdir(mDirName);
+			LLFile::remove(mDirName + ".index", ENOENT);
+			LLFile::remove(mDirName + ".data", ENOENT);
+		}
+
+		std::string mDirName;
+	};
+	typedef test_group<LLShardedVFSFixture> LLShardedVFSTest_factory;
+	typedef LLShardedVFSTest_factory::object LLShardedVFSTest_t;
+	LLShardedVFSTest_factory tf("LLShardedVFS");
+
+	template<> template<>
+	void LLShardedVFSTest_t::test<1>()
+	{
+		set_test_name("store, append, read and remove");
+		LLShardedVFS* vfs = LLShardedVFS::createShardedVFS(mDirName, FALSE, 64 * 1024 * 1024);
+		ensure("store created", vfs != nullptr);
+
+		LLUUID id;
+		id.generate();
+		std::vector<U8> data = make_data(id, 5000);
+		ensure("store file", store_file(vfs, id, LLAssetType::AT_SOUND, data));
+		ensure("exists", vfs->getExists(id, LLAssetType::AT_SOUND));
+		ensure("other type does not exist", !vfs->getExists(id, LLAssetType::AT_MESH));
+		ensure("read back", check_file(vfs, id, LLAssetType::AT_SOUND, data));
+
+		// Grow and append, the way LLVFile::APPEND does
+		std::vector<U8> tail = make_data(LLUUID::null, 3000);
+		ensure("grow", vfs->setMaxSize(id, LLAssetType::AT_SOUND, 8000));
+		ensure_equals("append", vfs->storeData(id, LLAssetType::AT_SOUND, &tail[0], -1, 3000), 3000);
+		data.insert(data.end(), tail.begin(), tail.end());
+		ensure("read back grown file", check_file(vfs, id, LLAssetType::AT_SOUND, data));
+
+		// Writes past the reserved length are truncated
+		ensure_equals("truncated write", vfs->storeData(id, LLAssetType::AT_SOUND, &tail[0], 7000, 3000), 1000);
+
+		vfs->removeFile(id, LLAssetType::AT_SOUND);
+		ensure("removed", !vfs->getExists(id, LLAssetType::AT_SOUND));
+		ensure_equals("nothing live", vfs->getLiveBytes(), (U64)0);
+		delete vfs;
+	}
+
+	template<> template<>
+	void LLShardedVFSTest_t::test<2>()
+	{
+		set_test_name("rename within and across shards");
+		LLShardedVFS* vfs = LLShardedVFS::createShardedVFS(mDirName, FALSE, 64 * 1024 * 1024);
+		ensure("store created", vfs != nullptr);
+
+		LLUUID id;
+		id.generate();
+		std::vector<U8> data = make_data(id, 10000);
+		ensure("store file", store_file(vfs, id, LLAssetType::AT_OBJECT, data));
+
+		LLUUID same_shard = id;
+		same_shard.mData[15] ^= 0xFF;
+		vfs->renameFile(id, LLAssetType::AT_OBJECT, same_shard, LLAssetType::AT_OBJECT);
+		ensure("old name gone", !vfs->getExists(id, LLAssetType::AT_OBJECT));
+		ensure("same shard rename", check_file(vfs, same_shard, LLAssetType::AT_OBJECT, data));
+
+		LLUUID other_shard = id;
+		other_shard.mData[0] += 1;
+		vfs->renameFile(same_shard, LLAssetType::AT_OBJECT, other_shard, LLAssetType::AT_OBJECT);
+		ensure("old name gone", !vfs->getExists(same_shard, LLAssetType::AT_OBJECT));
+		ensure("cross shard rename", check_file(vfs, other_shard, LLAssetType::AT_OBJECT, data));
+		ensure_equals("one file live", vfs->getLiveBytes(), (U64)data.size());
+
+		// A file already in the target location is replaced
+		LLUUID target = other_shard;
+		target.mData[0] += 1;
+		ensure("store target", store_file(vfs, target, LLAssetType::AT_OBJECT, make_data(target, 500)));
+		vfs->renameFile(other_shard, LLAssetType::AT_OBJECT, target, LLAssetType::AT_OBJECT);
+		ensure("old name gone again", !vfs->getExists(other_shard, LLAssetType::AT_OBJECT));
+		ensure("target replaced", check_file(vfs, target, LLAssetType::AT_OBJECT, data));
+		ensure_equals("still one file live", vfs->getLiveBytes(), (U64)data.size());
+		delete vfs;
+	}
+
+	template<> template<>
+	void LLShardedVFSTest_t::test<3>()
+	{
+		set_test_name("index survives reopen and a torn write");
+		LLUUID id;
+		id.generate();
+		std::vector<U8> data = make_data(id, 20000);
+		{
+			LLShardedVFS* vfs = LLShardedVFS::createShardedVFS(mDirName, FALSE, 64 * 1024 * 1024);
+			ensure("store file", store_file(vfs, id, LLAssetType::AT_ANIMATION, data));
+			delete vfs;
+		}
+
+		// Simulate a crash in the middle of writing an index record
+		std::string index_name = mDirName + gDirUtilp->getDirDelimiter() + llformat("%x", id.mData[0] % LLShardedVFS::NUM_SHARDS)
+			+ gDirUtilp->getDirDelimiter() + "index";
+		LLFILE* fp = LLFile::fopen(index_name, "ab");
+		ensure("index exists", fp != nullptr);
+		const char garbage[] = "torn";
+		fwrite(garbage, 1, sizeof(garbage), fp);
+		fclose(fp);
+
+		LLShardedVFS* vfs = LLShardedVFS::createShardedVFS(mDirName, FALSE, 64 * 1024 * 1024);
+		ensure("store reopened", vfs != nullptr);
+		ensure("file survived", check_file(vfs, id, LLAssetType::AT_ANIMATION, data));
+		delete vfs;
+	}
+
+	template<> template<>
+	void LLShardedVFSTest_t::test<4>()
+	{
+		set_test_name("compaction and eviction");
+		// Smallest budget there is: 1 MB per shard in 256 KB segments
+		LLShardedVFS* vfs = LLShardedVFS::createShardedVFS(mDirName, FALSE, 0);
+		ensure("store created", vfs != nullptr);
+
+		// Fill past the budget of every shard
+		const S32 FILE_SIZE = 64 * 1024;
+		std::vector<LLUUID> ids(300);
+		for (LLUUID& id : ids)
+		{
+			id.generate();
+			ensure("store file", store_file(vfs, id, LLAssetType::AT_MESH, make_data(id, FILE_SIZE)));
+		}
+		ensure("eviction keeps the budget", vfs->getLiveBytes() <= (U64)LLShardedVFS::NUM_SHARDS * 1024 * 1024);
+
+		// Remove most files, then compact what's left
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			if (i % 4 && vfs->getExists(ids[i], LLAssetType::AT_MESH))
+			{
+				vfs->removeFile(ids[i], LLAssetType::AT_MESH);
+			}
+		}
+		U64 disk_before = vfs->getDiskBytes();
+		while (vfs->compact() > 0)
+		{
+		}
+		ensure("compaction released space", vfs->getDiskBytes() < disk_before);
+		for (size_t i = 0; i < ids.size(); i += 4)
+		{
+			if (vfs->getExists(ids[i], LLAssetType::AT_MESH))
+			{
+				ensure("file survived compaction", check_file(vfs, ids[i], LLAssetType::AT_MESH, make_data(ids[i], FILE_SIZE)));
+			}
+		}
+		vfs->audit();
+		delete vfs;
+	}
+
+	template<> template<>
+	void LLShardedVFSTest_t::test<5>()
+	{
+		set_test_name("concurrent throughput against LLVFS");
+		const S32 NUM_THREADS = llclamp((S32)std::thread::hardware_concurrency(), 2, 8);
+		const S32 FILES_PER_THREAD = 200;
+		const S32 FILE_SIZE = 32 * 1024;
+		const U32 STORE_SIZE = 128 * 1024 * 1024;
+
+		LLFile::mkdir(mDirName);
+		LLVFS* legacy = LLVFS::createLLVFS(mDirName + ".index", mDirName + ".data", FALSE, STORE_SIZE, FALSE);
+		ensure("legacy vfs created", legacy != nullptr);
+		F64 legacy_rate = run_concurrent_load(legacy, NUM_THREADS, FILES_PER_THREAD, FILE_SIZE);
+		delete legacy;
+
+		LLShardedVFS* sharded = LLShardedVFS::createShardedVFS(mDirName + gDirUtilp->getDirDelimiter() + "sharded", FALSE, STORE_SIZE);
+		ensure("sharded vfs created", sharded != nullptr);
+		F64 sharded_rate = run_concurrent_load(sharded, NUM_THREADS, FILES_PER_THREAD, FILE_SIZE);
+		sharded->audit();
+		delete sharded;
+
+		std::cout << "\nVFS throughput, " << NUM_THREADS << " threads, " << FILE_SIZE / 1024 << " KB files: "
+				  << "LLVFS " << legacy_rate << " MB/s, LLShardedVFS " << sharded_rate << " MB/s" << std::endl;
+	}
+
+	template<> template<>
+	void LLShardedVFSTest_t::test<6>()
+	{
+		set_test_name("delete the store and its retries");
+		LLShardedVFS* vfs = LLShardedVFS::createShardedVFS(mDirName, FALSE, 64 * 1024 * 1024);
+		ensure("vfs created", vfs != nullptr);
+		delete vfs;
+
+		// What createShardedVFS() leaves behind when the store was in use
+		const std::string retry_dirname = mDirName + ".7";
+		LLFile::mkdir(retry_dirname);
+		LLFILE* fp = LLFile::fopen(retry_dirname + gDirUtilp->getDirDelimiter() + "lock", "wb");
+		ensure("retry store file", fp != nullptr);
+		fclose(fp);
+
+		LLShardedVFS::deleteStores(mDirName);
+		ensure("store deleted", !LLFile::isdir(mDirName));
+		ensure("retry store deleted", !LLFile::isdir(retry_dirname));
+	}
+
+	template<> template<>
+	void LLShardedVFSTest_t::test<7>()
+	{
+		set_test_name("keep a store that is in use");
+		LLShardedVFS* vfs = LLShardedVFS::createShardedVFS(mDirName, FALSE, 64 * 1024 * 1024);
+		ensure("vfs created", vfs != nullptr);
+
+		LLShardedVFS::deleteStores(mDirName);
+		ensure("store in use kept", LLFile::isdir(mDirName));
+
+		delete vfs;
+		LLShardedVFS::deleteStores(mDirName);
+		ensure("store deleted", !LLFile::isdir(mDirName));
+	}
+}
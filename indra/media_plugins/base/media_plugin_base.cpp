@@ -144,6 +144,8 @@ void MediaPluginBase::sendMessage(const LLPluginMessage &message)
  */
 void MediaPluginBase::setDirty(int left, int top, int right, int bottom)
 {
+	publishFrame(left, top, right, bottom);
+
 	LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_MEDIA, "updated");
 
 	message.setValueS32("left", left);
@@ -154,6 +156,68 @@ void MediaPluginBase::setDirty(int left, int top, int right, int bottom)
 	sendMessage(message);
 }
 
+/**
+ * Hands the frame in mPixels to the plugin loader shell when the texture segment holds several, and moves mPixels on to the next one.
+ *
+ * @param[in] left Left X coordinate of area which changed (0,0 is at top left corner)
+ * @param[in] top Top Y coordinate of area which changed (0,0 is at top left corner)
+ * @param[in] right Right X-coordinate of area which changed (0,0 is at top left corner)
+ * @param[in] bottom Bottom Y-coordinate of area which changed (0,0 is at top left corner)
+ *
+ */
+void MediaPluginBase::publishFrame(int left, int top, int right, int bottom)
+{
+	if (mFrameRing.isValid())
+	{
+		mPixels = mFrameRing.publish(left, top, right, bottom);
+	}
+}
+
+/**
+ * Points mPixels at the texture segment named in a "size_change" message.
+ *
+ * When the message says the segment holds several frames, mPixels is the frame to draw next and changes on every publishFrame().
+ * The plugin must then tell the plugin loader shell it uses them, with "frame_ring" in its "size_change_response".
+ *
+ * @param[in] segment Shared memory segment named in the message
+ * @param[in] size_change The "size_change" message
+ *
+ */
+void MediaPluginBase::setTextureSegment(const SharedSegmentInfo& segment, const LLPluginMessage& size_change)
+{
+	mFrameRing.detach();
+	mPixels = (unsigned char*)segment.mAddress;
+	if (size_change.hasValue("frame_count") && size_change.getValueU32("frame_count") > 1
+		&& mFrameRing.attach(segment.mAddress, segment.mSize))
+	{
+		mPixels = mFrameRing.getWriteFrame();
+	}
+}
+
+/**
+ * Checks whether mPixels points into a shared memory segment.
+ *
+ * @param[in] segment Shared memory segment
+ *
+ * @return True if the plugin draws into this segment.
+ */
+bool MediaPluginBase::isTextureSegment(const SharedSegmentInfo& segment) const
+{
+	const unsigned char* address = (const unsigned char*)segment.mAddress;
+	return mPixels && mPixels >= address && mPixels < address + segment.mSize;
+}
+
+/**
+ * Stops drawing into the texture segment, before it is removed.
+ *
+ */
+void MediaPluginBase::clearTextureSegment()
+{
+	mFrameRing.detach();
+	mPixels = nullptr;
+	mTextureSegmentName.clear();
+}
+
 /**
  * Sends "media_status" message to plugin loader shell ("loading", "playing", "paused", etc.)
  * 
@@ -32,6 +32,7 @@
 
 #include "linden_common.h"
 
+#include "llpluginframering.h"
 #include "llplugininstance.h"
 #include "llpluginmessage.h"
 #include "llpluginmessageclasses.h"
@@ -80,10 +81,19 @@ protected:
 	
 	/// Note: The quicktime plugin overrides this to add current time and duration to the message.
 	virtual void setDirty(int left, int top, int right, int bottom);
+	/// Hands the frame just drawn to the host when it shares several, and points mPixels at the next one. setDirty() calls this.
+	void publishFrame(int left, int top, int right, int bottom);
 
    /** Map of shared memory names to shared memory. */
 	typedef std::map<std::string, SharedSegmentInfo> SharedSegmentMap;
 
+	/// Points mPixels at a texture segment from a size_change message, using its frame ring if the host set one up.
+	void setTextureSegment(const SharedSegmentInfo& segment, const LLPluginMessage& size_change);
+	/// True if mPixels points into this segment.
+	bool isTextureSegment(const SharedSegmentInfo& segment) const;
+	/// Forgets the texture segment before it goes away.
+	void clearTextureSegment();
+
 	
    /** Function to send message from plugin to plugin loader shell. */
 	LLPluginInstance::sendMessageFunction mHostSendFunction;
@@ -109,6 +119,8 @@ protected:
 	EStatus mStatus;
    /** Map of shared memory segments. */
 	SharedSegmentMap mSharedSegments;
+   /** Frames in the texture segment when the host shares several, mPixels is the one being drawn. */
+	LLPluginFrameRing mFrameRing;
 
 };
 
@@ -124,6 +124,8 @@ MediaPluginBase(host_send_func, host_user_data)
 	mHeight = 0;
 	mDepth = 4;
 	mPixels = 0;
+	// CEF hands us the whole page every time
+	mFrameRing.setFullFrameUpdates(true);
 	mEnableMediaPluginDebugging = false;
 	mHostLanguage = "en-US";
 	mCookiesEnabled = true;
@@ -189,12 +191,13 @@ void MediaPluginCEF::onPageChangedCallback(const unsigned char* pixels, int x, i
 		if (mWidth == width && mHeight == height)
 		{
 			memcpy(mPixels, pixels, mWidth * mHeight * mDepth);
+			setDirty(0, 0, mWidth, mHeight);
 		}
 		else
 		{
+			// Nothing was drawn, don't publish a frame holding an older page
 			mCEFLib->setSize(mWidth, mHeight);
 		}
-		setDirty(0, 0, mWidth, mHeight);
 	}
 }
 
@@ -507,10 +510,9 @@ void MediaPluginCEF::receiveMessage(const char* message_string)
 				SharedSegmentMap::iterator iter = mSharedSegments.find(name);
 				if (iter != mSharedSegments.end())
 				{
-					if (mPixels == iter->second.mAddress)
+					if (isTextureSegment(iter->second))
 					{
-						mPixels = NULL;
-						mTextureSegmentName.clear();
+						clearTextureSegment();
 					}
 					mSharedSegments.erase(iter);
 				}
@@ -631,7 +633,7 @@ void MediaPluginCEF::receiveMessage(const char* message_string)
 					SharedSegmentMap::iterator iter = mSharedSegments.find(name);
 					if (iter != mSharedSegments.end())
 					{
-						mPixels = (unsigned char*)iter->second.mAddress;
+						setTextureSegment(iter->second, message_in);
 						mWidth = width;
 						mHeight = height;
 
@@ -648,6 +650,7 @@ void MediaPluginCEF::receiveMessage(const char* message_string)
 				message.setValueS32("height", height);
 				message.setValueS32("texture_width", texture_width);
 				message.setValueS32("texture_height", texture_height);
+				message.setValueBoolean("frame_ring", mFrameRing.isValid());
 				sendMessage(message);
 
 			}
@@ -77,6 +77,8 @@ MediaPluginBase(host_send_func, host_user_data)
 	mHeight = 0;
 	mDepth = 4;
 	mPixels = 0;
+	// update() redraws the whole background every time
+	mFrameRing.setFullFrameUpdates(true);
 	mLastUpdateTime = 0;
 	mBackgroundPixels = 0;
 }
@@ -149,11 +151,10 @@ void mediaPluginExample::receiveMessage(const char* message_string)
 				SharedSegmentMap::iterator iter = mSharedSegments.find(name);
 				if (iter != mSharedSegments.end())
 				{
-					if (mPixels == iter->second.mAddress)
+					if (isTextureSegment(iter->second))
 					{
 						// This is the currently active pixel buffer.  Make sure we stop drawing to it.
-						mPixels = NULL;
-						mTextureSegmentName.clear();
+						clearTextureSegment();
 					}
 					mSharedSegments.erase(iter);
 				}
@@ -202,7 +203,7 @@ void mediaPluginExample::receiveMessage(const char* message_string)
 					SharedSegmentMap::iterator iter = mSharedSegments.find(name);
 					if (iter != mSharedSegments.end())
 					{
-						mPixels = (unsigned char*)iter->second.mAddress;
+						setTextureSegment(iter->second, message_in);
 						mWidth = width;
 						mHeight = height;
 
@@ -217,6 +218,7 @@ void mediaPluginExample::receiveMessage(const char* message_string)
 				message.setValueS32("height", height);
 				message.setValueS32("texture_width", texture_width);
 				message.setValueS32("texture_height", texture_height);
+				message.setValueBoolean("frame_ring", mFrameRing.isValid());
 				sendMessage(message);
 
 				mFirstTime = true;
@@ -34,6 +34,8 @@
 #include "llpluginmessageclasses.h"
 #include "media_plugin_base.h"
 
+#include <mutex>
+
 #define ssize_t SSIZE_T
 
 #include "vlc/vlc.h"
@@ -100,6 +102,10 @@ private:
 	EStatus mVlcStatus;
 
 	bool mEnableMediaPluginLogging;
+
+	// Guards the texture segment and its frame ring, which VLC's thread draws into and publishes
+	// while messages on the plugin thread change them
+	std::mutex mVideoMutex;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -113,6 +119,8 @@ MediaPluginBase(host_send_func, host_user_data)
 	mHeight = 0;
 	mDepth = 4;
 	mPixels = nullptr;
+	// VLC decodes whole pictures
+	mFrameRing.setFullFrameUpdates(true);
 
 	mLibVLC = nullptr;
 	mLibVLCMedia = nullptr;
@@ -161,6 +169,7 @@ void* MediaPluginLibVLC::lock(void* data, void** p_pixels)
 {
 	struct mLibVLCContext* context = (mLibVLCContext*)data;
 
+	std::lock_guard<std::mutex> guard(context->parent->mVideoMutex);
 	*p_pixels = context->texture_pixels;
 
 	return nullptr;
@@ -225,6 +234,13 @@ void MediaPluginLibVLC::resetVLC()
 // *virtual*
 void MediaPluginLibVLC::setDirty(int left, int top, int right, int bottom)
 {
+	// Called from display() on the VLC thread, the next picture gets decoded into the next frame
+	{
+		std::lock_guard<std::mutex> guard(mVideoMutex);
+		publishFrame(left, top, right, bottom);
+		mLibVLCCallbackContext.texture_pixels = mPixels;
+	}
+
 	LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_MEDIA, "updated");
 
 	message.setValueS32("left", left);
@@ -388,7 +404,10 @@ void MediaPluginLibVLC::playMedia()
 	}
 
 	mLibVLCCallbackContext.parent = this;
-	mLibVLCCallbackContext.texture_pixels = mPixels;
+	{
+		std::lock_guard<std::mutex> guard(mVideoMutex);
+		mLibVLCCallbackContext.texture_pixels = mPixels;
+	}
 	mLibVLCCallbackContext.mp = mLibVLCMediaPlayer;
 
 	// Send a "navigate begin" event.
@@ -563,14 +582,15 @@ void MediaPluginLibVLC::receiveMessage(const char* message_string)
 				SharedSegmentMap::iterator iter = mSharedSegments.find(name);
 				if (iter != mSharedSegments.end())
 				{
-					if (mPixels == iter->second.mAddress)
+					if (isTextureSegment(iter->second))
 					{
 						libvlc_media_player_stop(mLibVLCMediaPlayer);
 						libvlc_media_player_release(mLibVLCMediaPlayer);
 						mLibVLCMediaPlayer = nullptr;
 
-						mPixels = nullptr;
-						mTextureSegmentName.clear();
+						std::lock_guard<std::mutex> guard(mVideoMutex);
+						clearTextureSegment();
+						mLibVLCCallbackContext.texture_pixels = nullptr;
 					}
 					mSharedSegments.erase(iter);
 				}
@@ -617,7 +637,10 @@ void MediaPluginLibVLC::receiveMessage(const char* message_string)
 					SharedSegmentMap::iterator iter = mSharedSegments.find(name);
 					if (iter != mSharedSegments.end())
 					{
-						mPixels = (unsigned char*)iter->second.mAddress;
+						{
+							std::lock_guard<std::mutex> guard(mVideoMutex);
+							setTextureSegment(iter->second, message_in);
+						}
 						mWidth = width;
 						mHeight = height;
 						mTextureWidth = texture_width;
@@ -633,6 +656,7 @@ void MediaPluginLibVLC::receiveMessage(const char* message_string)
 				message.setValueS32("height", height);
 				message.setValueS32("texture_width", texture_width);
 				message.setValueS32("texture_height", texture_height);
+				message.setValueBoolean("frame_ring", mFrameRing.isValid());
 				sendMessage(message);
 			}
 			else if (message_name == "load_uri")
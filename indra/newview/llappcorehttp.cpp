@@ -58,63 +58,65 @@ static const struct
 	U32							mMin;
 	U32							mMax;
 	U32							mRate;
+	U32							mCoalesceLimit;
 	bool						mPipelined;
+	bool						mAdaptive;
 	std::string					mKey;
 	const char *				mUsage;
 } init_data[LLAppCoreHttp::AP_COUNT] =
 {
 	{ // AP_DEFAULT
-		8,		8,		8,		0,		false,
+		8,		8,		8,		0,		0,		false,	false,
 		"",
 		"other"
 	},
 	{ // AP_ASSET
-		12,		1,		16,		0,		true,
+		12,		1,		16,		0,		0,		true,	true,
 		"AssetFetchConcurrency",
 		"asset fetch"
 	},
 	{ // AP_TEXTURE
-		12,		1,		16,		0,		true,
+		12,		1,		16,		0,		2 << 20,	true,	true,
 		"TextureFetchConcurrency",
 		"texture fetch"
 	},
 	{ // AP_MESH1
-		32,		1,		128,	0,		false,
+		32,		1,		128,	0,		2 << 20,	false,	true,
 		"MeshMaxConcurrentRequests",
 		"mesh fetch"
 	},
 	{ // AP_MESH2
-		8,		1,		32,		0,		true,	
+		8,		1,		32,		0,		2 << 20,	true,	true,
 		"Mesh2MaxConcurrentRequests",
 		"mesh2 fetch"
 	},
 	{ // AP_LARGE_MESH
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		8 << 20,	false,	true,
 		"",
 		"large mesh fetch"
 	},
 	{ // AP_UPLOADS 
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		0,		false,	false,
 		"",
 		"asset upload"
 	},
 	{ // AP_LONG_POLL
-		32,		32,		32,		0,		false,
+		32,		32,		32,		0,		0,		false,	false,
 		"",
 		"long poll"
 	},
 	{ // AP_INVENTORY
-		4,		1,		4,		0,		false,
+		4,		1,		4,		0,		0,		false,	false,
 		"",
 		"inventory"
 	},
 	{ // AP_MATERIALS
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		0,		false,	false,
 		"RenderMaterials",
 		"material manager requests"
 	},
 	{ // AP_AGENT
-		2,		1,		32,		0,		false,
+		2,		1,		32,		0,		0,		false,	false,
 		"Agent",
 		"Agent requests"
 	}
@@ -126,7 +128,8 @@ static void setting_changed();
 LLAppCoreHttp::HttpClass::HttpClass()
 	: mPolicy(LLCore::HttpRequest::DEFAULT_POLICY_ID),
 	  mConnLimit(0U),
-	  mPipelined(false)
+	  mPipelined(false),
+	  mAdaptive(false)
 {}
 
 
@@ -135,7 +138,8 @@ LLAppCoreHttp::LLAppCoreHttp()
 	  mStopHandle(LLCORE_HTTP_HANDLE_INVALID),
 	  mStopRequested(0.0),
 	  mStopped(false),
-	  mPipelined(true)
+	  mPipelined(true),
+	  mAdaptive(false)
 {}
 
 
@@ -274,6 +278,22 @@ void LLAppCoreHttp::init()
 		}
 	}
 
+	// Signal for global adaptive concurrency preference
+	static const std::string http_adaptive("HttpAdaptiveConcurrency");
+	if (gSavedSettings.controlExists(http_adaptive))
+	{
+		LLPointer<LLControlVariable> cntrl_ptr = gSavedSettings.getControl(http_adaptive);
+		if (cntrl_ptr.isNull())
+		{
+			LL_WARNS("Init") << "Unable to set signal on global setting '" << http_adaptive
+							 << "'" << LL_ENDL;
+		}
+		else
+		{
+			mAdaptiveSignal = cntrl_ptr->getCommitSignal()->connect(boost::bind(&setting_changed));
+		}
+	}
+
 	// Register signals for settings and state changes
 	for (int i(0); i < LL_ARRAY_SIZE(init_data); ++i)
 	{
@@ -361,6 +381,7 @@ void LLAppCoreHttp::cleanup()
         http_class.mSettingsSignal.disconnect();
 	}
 	mPipelinedSignal.disconnect();
+	mAdaptiveSignal.disconnect();
 	
 	delete mRequest;
 	mRequest = nullptr;
@@ -395,6 +416,19 @@ void LLAppCoreHttp::refreshSettings(bool initial)
 		}
         LL_INFOS("Init") << "HTTP Pipelining " << (mPipelined ? "enabled" : "disabled") << "!" << LL_ENDL;
 	}
+
+	// Global adaptive concurrency setting
+	bool adaptive_changed(false);
+	static const std::string http_adaptive("HttpAdaptiveConcurrency");
+	if (gSavedSettings.controlExists(http_adaptive))
+	{
+		bool adaptive(gSavedSettings.getBOOL(http_adaptive));
+		if (adaptive != mAdaptive)
+		{
+			mAdaptive = adaptive;
+			adaptive_changed = true;
+		}
+	}
 	
 	for (int i(0); i < LL_ARRAY_SIZE(init_data); ++i)
 	{
@@ -419,6 +453,21 @@ void LLAppCoreHttp::refreshSettings(bool initial)
 				}
 			}
 
+			if (init_data[i].mCoalesceLimit)
+			{
+				// Let adjacent byte range requests share a transfer
+				status = LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_COALESCE_LIMIT,
+																	mHttpClasses[app_policy].mPolicy,
+																	init_data[i].mCoalesceLimit,
+																	nullptr);
+				if (! status)
+				{
+					LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+									 << " coalesce limit.  Reason:  " << status.toString()
+									 << LL_ENDL;
+				}
+			}
+
 		}
 
 		// Init- or run-time settings.  Must use the queued request API.
@@ -455,6 +504,34 @@ void LLAppCoreHttp::refreshSettings(bool initial)
 			}
 		}
 		
+		// Adaptive concurrency changes
+		if (initial || adaptive_changed)
+		{
+			const bool to_adapt(mAdaptive && init_data[i].mAdaptive);
+			if (to_adapt != mHttpClasses[app_policy].mAdaptive)
+			{
+				LLCore::HttpHandle handle;
+				handle = mRequest->setPolicyOption(LLCore::HttpRequest::PO_ADAPTIVE_CONCURRENCY,
+												   mHttpClasses[app_policy].mPolicy,
+												   (to_adapt ? 1L : 0L),
+                                                   LLCore::HttpHandler::ptr_t());
+				if (LLCORE_HTTP_HANDLE_INVALID == handle)
+				{
+					status = mRequest->getStatus();
+					LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+									 << " adaptive concurrency.  Reason:  " << status.toString()
+									 << LL_ENDL;
+				}
+				else
+				{
+					LL_DEBUGS("Init") << "Changed " << init_data[i].mUsage
+									  << " adaptive concurrency.  New value:  " << to_adapt
+									  << LL_ENDL;
+					mHttpClasses[app_policy].mAdaptive = to_adapt;
+				}
+			}
+		}
+
 		// Get target connection concurrency value
 		U32 setting(init_data[i].mDefault);
 		if (! init_data[i].mKey.empty() && gSavedSettings.controlExists(init_data[i].mKey))
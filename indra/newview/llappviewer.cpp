@@ -117,6 +117,7 @@
 #include "llprimitive.h"
 #include "llurlaction.h"
 #include "llurlentry.h"
+#include "llshardedvfs.h"
 #include "llvfile.h"
 #include "llvfsthread.h"
 #include "llvolumemgr.h"
@@ -160,6 +161,7 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "lljobsystem.h"
 #include "llevents.h"
 
 // The files below handle dependencies from cleanup.
@@ -440,6 +442,7 @@ void init_default_trans_args()
 // File scope definitons
 const char *VFS_DATA_FILE_BASE = "data.db2.x.";
 const char *VFS_INDEX_FILE_BASE = "index.db2.x.";
+const char *SHARDED_VFS_DIR = "assetstore";
 
 
 struct SettingsFile : public LLInitParam::Block<SettingsFile>
@@ -584,6 +587,7 @@ static void settings_to_globals()
 	LLRender::sNsightDebugSupport = gSavedSettings.getBOOL("RenderNsightDebugSupport");
 	LLRender::sAnisotropicFilteringLevel = static_cast<F32>(gSavedSettings.getU32("RenderAnisotropicLevel"));
 	LLVertexBuffer::sUseVAO = gSavedSettings.getBOOL("RenderUseVAO");
+	LLVertexBuffer::sUseStreamRing = gSavedSettings.getBOOL("RenderStreamRing");
 	LLImageGL::sCompressTextures		= gSavedSettings.getBOOL("RenderCompressTextures");
 	LLVOVolume::sLODFactor				= llclamp(gSavedSettings.getF32("RenderVolumeLODFactor"), 0.01f, MAX_LOD_FACTOR);
 	LLVOVolume::sDistanceFactor			= 1.f-LLVOVolume::sLODFactor * 0.1f;
@@ -1355,6 +1359,7 @@ static LLTrace::BlockTimerStatHandle FTM_DECODE("Image Decode");
 static LLTrace::BlockTimerStatHandle FTM_TEXTURE_FETCH("Texture Fetch");
 static LLTrace::BlockTimerStatHandle FTM_VFS("VFS Thread");
 static LLTrace::BlockTimerStatHandle FTM_LFS("LFS Thread");
+static LLTrace::BlockTimerStatHandle FTM_JOB_COMPLETIONS("Job Completions");
 static LLTrace::BlockTimerStatHandle FTM_PAUSE_THREADS("Pause Threads");
 static LLTrace::BlockTimerStatHandle FTM_IDLE("Idle");
 static LLTrace::BlockTimerStatHandle FTM_PUMP("Pump");
@@ -2053,6 +2058,7 @@ bool LLAppViewer::cleanup()
     sTextureFetch = nullptr;
 	delete sImageDecodeThread;
     sImageDecodeThread = nullptr;
+	LLJobSystem::deleteSingleton();
 	delete mFastTimerLogThread;
 	mFastTimerLogThread = nullptr;
 
@@ -2200,11 +2206,14 @@ bool LLAppViewer::initThreads()
 
 	LLImage::initParamSingleton(gSavedSettings.getBOOL("TextureNewByteRange"),gSavedSettings.getS32("TextureReverseByteRange"));
 
+	// Shared worker pool, must be up before the queued threads that run on it
+	LLJobSystem::initParamSingleton(gSavedSettings.getU32("JobSystemWorkers"));
+
 	LLVFSThread::initClass(enable_threads && false);
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, gSavedSettings.getU32("ImageDecodeThreads"));
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -4176,7 +4185,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
 	// Viewer object cache version, change if object update
 	// format changes. JC
-	const U32 INDRA_OBJECT_CACHE_VERSION = 15;
+	const U32 INDRA_OBJECT_CACHE_VERSION = 16;
 
 	return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -4281,120 +4290,145 @@ bool LLAppViewer::initCache()
 	}
 	LL_INFOS("AppCache") << "VFS CACHE SIZE: " << vfs_size / (1024*1024) << " MB" << LL_ENDL;
 
-	// This has to happen BEFORE starting the vfs
-	// time_t	ltime;
-	srand(time(nullptr));		// Flawfinder: ignore
-	U32 old_salt = gSavedSettings.getU32("VFSSalt");
-	U32 new_salt;
-	std::string old_vfs_data_file;
-	std::string old_vfs_index_file;
-	std::string new_vfs_data_file;
-	std::string new_vfs_index_file;
-	std::string static_vfs_index_file;
-	std::string static_vfs_data_file;
-
-	if (gSavedSettings.getBOOL("AllowMultipleViewers"))
+	const std::string sharded_vfs_dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, SHARDED_VFS_DIR);
+	if (gSavedSettings.getBOOL("VFSShardedStore"))
 	{
-		// don't mess with renaming the VFS in this case
-		new_salt = old_salt;
+		// The sharded store replaces the single file VFS, its files are just taking up space,
+		// unless another viewer instance is still using them
+		if (!gSavedSettings.getBOOL("AllowMultipleViewers"))
+		{
+			std::string dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "");
+			gDirUtilp->deleteFilesInDir(dir, std::string(VFS_DATA_FILE_BASE) + "*");
+			gDirUtilp->deleteFilesInDir(dir, std::string(VFS_INDEX_FILE_BASE) + "*");
+		}
+
+		// Resizing only changes the eviction budget, nothing needs to be thrown away
+		gVFS = LLShardedVFS::createShardedVFS(sharded_vfs_dir, false, vfs_size_u32);
+		if (!gVFS)
+		{
+			return false;
+		}
 	}
 	else
 	{
-		do
+		if (!gSavedSettings.getBOOL("AllowMultipleViewers"))
 		{
-			new_salt = ll_rand();
-		} while(new_salt == old_salt);
-	}
-
-	old_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_DATA_FILE_BASE) + llformat("%u", old_salt);
+			LLShardedVFS::deleteStores(sharded_vfs_dir);
+		}
 
-	// make sure this file exists
-	llstat s;
-	S32 stat_result = LLFile::stat(old_vfs_data_file, &s);
-	if (stat_result)
-	{
-		// doesn't exist, look for a data file
-		std::string mask;
-		mask = VFS_DATA_FILE_BASE;
-		mask += "*";
+		// This has to happen BEFORE starting the vfs
+		// time_t	ltime;
+		srand(time(nullptr));		// Flawfinder: ignore
+		U32 old_salt = gSavedSettings.getU32("VFSSalt");
+		U32 new_salt;
+		std::string old_vfs_data_file;
+		std::string old_vfs_index_file;
+		std::string new_vfs_data_file;
+		std::string new_vfs_index_file;
+
+		if (gSavedSettings.getBOOL("AllowMultipleViewers"))
+		{
+			// don't mess with renaming the VFS in this case
+			new_salt = old_salt;
+		}
+		else
+		{
+			do
+			{
+				new_salt = ll_rand();
+			} while(new_salt == old_salt);
+		}
 
-		std::string dir;
-		dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "");
+		old_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_DATA_FILE_BASE) + llformat("%u", old_salt);
 
-		std::string found_file;
-		LLDirIterator iter(dir, mask);
-		if (iter.next(found_file))
+		// make sure this file exists
+		llstat s;
+		S32 stat_result = LLFile::stat(old_vfs_data_file, &s);
+		if (stat_result)
 		{
-			old_vfs_data_file = gDirUtilp->add(dir, found_file);
+			// doesn't exist, look for a data file
+			std::string mask;
+			mask = VFS_DATA_FILE_BASE;
+			mask += "*";
 
-			size_t start_pos = found_file.find_last_of('.');
-			if (start_pos != std::string::npos && start_pos != 0)
+			std::string dir;
+			dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "");
+
+			std::string found_file;
+			LLDirIterator iter(dir, mask);
+			if (iter.next(found_file))
 			{
-				sscanf(found_file.substr(start_pos+1).c_str(), "%d", &old_salt);
+				old_vfs_data_file = gDirUtilp->add(dir, found_file);
+
+				size_t start_pos = found_file.find_last_of('.');
+				if (start_pos != std::string::npos && start_pos != 0)
+				{
+					sscanf(found_file.substr(start_pos+1).c_str(), "%d", &old_salt);
+				}
+				LL_DEBUGS("AppCache") << "Default vfs data file not present, found: " << old_vfs_data_file << " Old salt: " << old_salt << LL_ENDL;
 			}
-			LL_DEBUGS("AppCache") << "Default vfs data file not present, found: " << old_vfs_data_file << " Old salt: " << old_salt << LL_ENDL;
 		}
-	}
 
-	old_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_INDEX_FILE_BASE) + llformat("%u", old_salt);
+		old_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_INDEX_FILE_BASE) + llformat("%u", old_salt);
 
-	stat_result = LLFile::stat(old_vfs_index_file, &s);
-	if (stat_result)
-	{
-		// We've got a bad/missing index file, nukem!
-		LL_WARNS("AppCache") << "Bad or missing vfx index file " << old_vfs_index_file << LL_ENDL;
-		LL_WARNS("AppCache") << "Removing old vfs data file " << old_vfs_data_file << LL_ENDL;
-		LLFile::remove(old_vfs_data_file);
-		LLFile::remove(old_vfs_index_file);
-
-		// Just in case, nuke any other old cache files in the directory.
-		std::string dir;
-		dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "");
+		stat_result = LLFile::stat(old_vfs_index_file, &s);
+		if (stat_result)
+		{
+			// We've got a bad/missing index file, nukem!
+			LL_WARNS("AppCache") << "Bad or missing vfx index file " << old_vfs_index_file << LL_ENDL;
+			LL_WARNS("AppCache") << "Removing old vfs data file " << old_vfs_data_file << LL_ENDL;
+			LLFile::remove(old_vfs_data_file);
+			LLFile::remove(old_vfs_index_file);
 
-		std::string mask;
-		mask = VFS_DATA_FILE_BASE;
-		mask += "*";
+			// Just in case, nuke any other old cache files in the directory.
+			std::string dir;
+			dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "");
 
-		gDirUtilp->deleteFilesInDir(dir, mask);
+			std::string mask;
+			mask = VFS_DATA_FILE_BASE;
+			mask += "*";
 
-		mask = VFS_INDEX_FILE_BASE;
-		mask += "*";
+			gDirUtilp->deleteFilesInDir(dir, mask);
 
-		gDirUtilp->deleteFilesInDir(dir, mask);
-	}
+			mask = VFS_INDEX_FILE_BASE;
+			mask += "*";
 
-	new_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_DATA_FILE_BASE) + llformat("%u", new_salt);
-	new_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_INDEX_FILE_BASE) + llformat("%u", new_salt);
+			gDirUtilp->deleteFilesInDir(dir, mask);
+		}
 
-	static_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_APP_SETTINGS, "static_data.db2");
-	static_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_APP_SETTINGS, "static_index.db2");
+		new_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_DATA_FILE_BASE) + llformat("%u", new_salt);
+		new_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_INDEX_FILE_BASE) + llformat("%u", new_salt);
 
-	if (resize_vfs)
-	{
-		LL_DEBUGS("AppCache") << "Removing old vfs and re-sizing" << LL_ENDL;
+		if (resize_vfs)
+		{
+			LL_DEBUGS("AppCache") << "Removing old vfs and re-sizing" << LL_ENDL;
 
-		LLFile::remove(old_vfs_data_file);
-		LLFile::remove(old_vfs_index_file);
-	}
-	else if (old_salt != new_salt)
-	{
-		// move the vfs files to a new name before opening
-		LL_DEBUGS("AppCache") << "Renaming " << old_vfs_data_file << " to " << new_vfs_data_file << LL_ENDL;
-		LL_DEBUGS("AppCache") << "Renaming " << old_vfs_index_file << " to " << new_vfs_index_file << LL_ENDL;
-		LLFile::rename(old_vfs_data_file, new_vfs_data_file);
-		LLFile::rename(old_vfs_index_file, new_vfs_index_file);
-	}
+			LLFile::remove(old_vfs_data_file);
+			LLFile::remove(old_vfs_index_file);
+		}
+		else if (old_salt != new_salt)
+		{
+			// move the vfs files to a new name before opening
+			LL_DEBUGS("AppCache") << "Renaming " << old_vfs_data_file << " to " << new_vfs_data_file << LL_ENDL;
+			LL_DEBUGS("AppCache") << "Renaming " << old_vfs_index_file << " to " << new_vfs_index_file << LL_ENDL;
+			LLFile::rename(old_vfs_data_file, new_vfs_data_file);
+			LLFile::rename(old_vfs_index_file, new_vfs_index_file);
+		}
 
-	// Startup the VFS...
-	gSavedSettings.setU32("VFSSalt", new_salt);
+		// Startup the VFS...
+		gSavedSettings.setU32("VFSSalt", new_salt);
 
-	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
-	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
-	if (!gVFS)
-	{
-		return false;
+		// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
+		gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
+		if (!gVFS)
+		{
+			return false;
+		}
 	}
 
+	// static_data.db2 ships in the single file format
+	std::string static_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_APP_SETTINGS, "static_data.db2");
+	std::string static_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_APP_SETTINGS, "static_index.db2");
 	gStaticVFS = LLVFS::createLLVFS(static_vfs_index_file, static_vfs_data_file, true, 0, false);
 	if (!gStaticVFS)
 	{
@@ -4443,6 +4477,7 @@ void LLAppViewer::purgeCache()
 		// cef does not support clear_cache and clear_cookies, so clear what we can manually.
 		gDirUtilp->deleteDirAndContents(browser_data);
 	}
+	LLShardedVFS::deleteStores(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, SHARDED_VFS_DIR));
 	gDirUtilp->deleteFilesInDir(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, ""), "*");
 }
 
@@ -4866,6 +4901,13 @@ void LLAppViewer::idle()
 		LLAvatarTracker::instance().idleNotifyObservers();
 	}
 
+	{
+		LL_RECORD_BLOCK_TIME(FTM_JOB_COMPLETIONS);
+		// Main thread side of the work handed to the job system
+		const F32 MAX_COMPLETION_TIME_MS = 2.f;
+		LLJobSystem::getInstance()->runCompletions(MAX_COMPLETION_TIME_MS);
+	}
+
 	// Metrics logging (LLViewerAssetStats, etc.)
 	{
 		static LLTimer report_interval;
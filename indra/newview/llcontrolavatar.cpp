@@ -338,17 +338,15 @@ void LLControlAvatar::markDead()
 	LLVOAvatar::markDead();
 }
 
-void LLControlAvatar::idleUpdate(LLAgent &agent, const F64 &time)
+bool LLControlAvatar::beginIdleUpdate(LLAgent &agent, const F64 &time)
 {
     if (mMarkedForDeath)
     {
         markDead();
         mMarkedForDeath = false;
+        return false;
     }
-    else
-    {
-        LLVOAvatar::idleUpdate(agent,time);
-    }
+    return LLVOAvatar::beginIdleUpdate(agent,time);
 }
 
 BOOL LLControlAvatar::updateCharacter(LLAgent &agent)
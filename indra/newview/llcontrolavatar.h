@@ -53,7 +53,7 @@ public:
     void markForDeath();
     void markDead() override;
 
-    void idleUpdate(LLAgent &agent, const F64 &time) override;
+    bool beginIdleUpdate(LLAgent &agent, const F64 &time) override;
 	BOOL updateCharacter(LLAgent &agent) override;
 
     void getAnimatedVolumes(std::vector<LLVOVolume*>& volumes);
@@ -1784,28 +1784,8 @@ void LLDrawPoolAvatar::updateRiggedFaceVertexBuffer(
         LLSkinningUtil::initSkinningMatrixPalette(mat, count, skin, avatar);
         LLSkinningUtil::checkSkinWeights(weights, buffer->getNumVerts(), skin);
 
-        const U32 max_joints = LLSkinningUtil::getMaxJointCount();
-		for (S32 j = 0; j < buffer->getNumVerts(); ++j)
-		{
-			LLMatrix4a final_mat;
-            LLSkinningUtil::getPerVertexSkinMatrix(weights[j], mat, false, final_mat, max_joints);
-			
-			const LLVector4a& v = vol_face.mPositions[j];
-
-			LLVector4a dst;
-			skin->mBindShapeMatrix.affineTransform(v, dst);
-			final_mat.affineTransform(dst, dst);
-			pos[j] = dst;
-
-			if (norm)
-			{
-				const LLVector4a& n = vol_face.mNormals[j];
-				skin->mBindShapeMatrix.rotate(n, dst);
-				final_mat.rotate(dst, dst);
-				dst.normalize3fast();
-				norm[j] = dst;
-			}
-		}
+		LLSkinningUtil::skinVertices(skin, mat, count, weights, vol_face.mPositions, pos,
+									 norm ? vol_face.mNormals : nullptr, norm, buffer->getNumVerts(), nullptr);
 	}
 }
 
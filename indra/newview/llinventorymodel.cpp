@@ -39,6 +39,7 @@
 #include "llclipboard.h"
 #include "llinventorypanel.h"
 #include "llinventorybridge.h"
+#include "llinventorycache.h"
 #include "llinventoryfunctions.h"
 #include "llinventoryobserver.h"
 #include "llinventorypanel.h"
@@ -83,6 +84,7 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
 static const char PRODUCTION_CACHE_FORMAT_STRING[] = "%s.inv";
 static const char GRID_CACHE_FORMAT_STRING[] = "%s.%s.inv";
+static const char BINARY_CACHE_SUFFIX[] = ".bin";
 static const char * const LOG_INV("Inventory");
 
 struct InventoryIDPtrLess
@@ -1817,9 +1819,23 @@ void LLInventoryModel::cache(
 		INCLUDE_TRASH,
 		can_cache);
 	std::string inventory_filename = getInvCacheAddres(agent_id);
-	saveToFile(inventory_filename, categories, items);
 	std::string gzip_filename(inventory_filename);
 	gzip_filename.append(".gz");
+	std::string binary_filename(inventory_filename);
+	binary_filename.append(BINARY_CACHE_SUFFIX);
+	if (gSavedSettings.getBOOL("InventoryBinaryCache"))
+	{
+		if (saveToBinaryFile(binary_filename, categories, items))
+		{
+			// Migrated, the text cache would only go stale from here on
+			LLFile::remove(gzip_filename, ENOENT);
+			return;
+		}
+		LL_WARNS(LOG_INV) << "Falling back to the text inventory cache" << LL_ENDL;
+	}
+	LLFile::remove(binary_filename, ENOENT);
+
+	saveToFile(inventory_filename, categories, items);
 	if(gzip_file(inventory_filename, gzip_filename))
 	{
 		LL_DEBUGS(LOG_INV) << "Successfully compressed " << inventory_filename << LL_ENDL;
@@ -2133,27 +2149,51 @@ bool LLInventoryModel::loadSkeleton(
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
 		std::string gzip_filename(inventory_filename);
 		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+		std::string binary_filename(inventory_filename);
+		binary_filename.append(BINARY_CACHE_SUFFIX);
+		LLTimer load_timer;
+		bool is_cache_obsolete = false;
 		bool remove_inventory_file = false;
-		if(fp)
+		bool loaded = false;
+		if (gSavedSettings.getBOOL("InventoryBinaryCache") && LLFile::isfile(binary_filename))
 		{
-			fclose(fp);
-			fp = nullptr;
-			if(gunzip_file(gzip_filename, inventory_filename))
+			loaded = loadFromBinaryFile(binary_filename, categories, items, categories_to_update, is_cache_obsolete);
+			if (!loaded)
 			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
+				// Damaged or out of date, try the text cache from before the migration
+				LLFile::remove(binary_filename);
+				categories.clear();
+				items.clear();
+				categories_to_update.clear();
+				is_cache_obsolete = false;
 			}
-			else
+		}
+		if (!loaded)
+		{
+			LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+			if(fp)
 			{
-				LL_INFOS(LOG_INV) << "Unable to gunzip " << gzip_filename << LL_ENDL;
+				fclose(fp);
+				fp = nullptr;
+				if(gunzip_file(gzip_filename, inventory_filename))
+				{
+					// we only want to remove the inventory file if it was
+					// gzipped before we loaded, and we successfully
+					// gunziped it.
+					remove_inventory_file = true;
+				}
+				else
+				{
+					LL_INFOS(LOG_INV) << "Unable to gunzip " << gzip_filename << LL_ENDL;
+				}
 			}
+			loaded = loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete);
 		}
-		bool is_cache_obsolete = false;
-		if (loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete))
+		if (loaded)
 		{
+			LL_INFOS(LOG_INV) << "Read " << categories.size() << " categories and " << items.size()
+				<< " items from the inventory cache in " << load_timer.getElapsedTimeF32() * 1000.f << " ms" << LL_ENDL;
+
 			// We were able to find a cache of files. So, use what we
 			// found to generate a set of categories we should add. We
 			// will go through each category loaded and if the version
@@ -2825,6 +2865,88 @@ bool LLInventoryModel::loadFromFile(const std::string& filename,
 	return true;
 }
 
+// static
+bool LLInventoryModel::loadFromBinaryFile(const std::string& filename,
+										  cat_array_t& categories,
+										  item_array_t& items,
+										  changed_items_t& cats_to_update,
+										  bool& is_cache_obsolete)
+{
+	LL_INFOS(LOG_INV) << "LLInventoryModel::loadFromBinaryFile(" << filename << ")" << LL_ENDL;
+	LLInventoryCacheReader reader;
+	if (!reader.open(filename))
+	{
+		return false;
+	}
+	if (reader.getCacheVersion() != (U32)sCurrentInvCacheVersion)
+	{
+		is_cache_obsolete = true;
+		return false;
+	}
+
+	const U32 category_count = reader.getCategoryCount();
+	categories.reserve(categories.size() + category_count);
+	for (U32 i = 0; i < category_count; ++i)
+	{
+		LLPointer<LLViewerInventoryCategory> inv_cat = new LLViewerInventoryCategory(LLUUID::null);
+		if (!inv_cat->importCache(reader, i))
+		{
+			LL_WARNS(LOG_INV) << "Inventory cache category " << i << " is invalid" << LL_ENDL;
+			return false;
+		}
+		categories.push_back(inv_cat);
+	}
+
+	const U32 item_count = reader.getItemCount();
+	items.reserve(items.size() + item_count);
+	for (U32 i = 0; i < item_count; ++i)
+	{
+		LLPointer<LLViewerInventoryItem> inv_item = new LLViewerInventoryItem;
+		if (!inv_item->importCache(reader, i))
+		{
+			LL_WARNS(LOG_INV) << "Inventory cache item " << i << " is invalid" << LL_ENDL;
+			return false;
+		}
+		// Same filtering as loadFromFile()
+		if (inv_item->getUUID().isNull())
+		{
+			LL_WARNS(LOG_INV) << "Ignoring inventory with null item id: "
+				<< inv_item->getName() << LL_ENDL;
+		}
+		else if (inv_item->getType() == LLAssetType::AT_UNKNOWN)
+		{
+			cats_to_update.insert(inv_item->getParentUUID());
+		}
+		else
+		{
+			items.push_back(inv_item);
+		}
+	}
+	return true;
+}
+
+// static
+bool LLInventoryModel::saveToBinaryFile(const std::string& filename,
+										const cat_array_t& categories,
+										const item_array_t& items)
+{
+	LL_INFOS(LOG_INV) << "LLInventoryModel::saveToBinaryFile(" << filename << ")" << LL_ENDL;
+	LLInventoryCacheWriter writer;
+	writer.reserve((U32)categories.size(), (U32)items.size());
+	for (const LLViewerInventoryCategory* cat : categories)
+	{
+		if (cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+		{
+			cat->exportCache(writer);
+		}
+	}
+	for (const LLViewerInventoryItem* item : items)
+	{
+		writer.addItem(*item);
+	}
+	return writer.save(filename, sCurrentInvCacheVersion);
+}
+
 // static
 bool LLInventoryModel::saveToFile(const std::string& filename,
                                   const cat_array_t& categories,
@@ -4279,7 +4401,7 @@ void LLInventoryModel::FetchItemHttpHandler::onCompleted(LLCore::HttpHandle hand
 
 		// body->write(0, "Garbage Response", 16);		// Dev tool to force error handling
 		LLSD body_llsd;
-		if (! LLCoreHttpUtil::responseToLLSD(response, true, body_llsd))
+		if (! LLCoreHttpUtil::responseToLLSD(response, true, body_llsd, true))
 		{
 			// INFOS-level logging will occur on the parsed failure
 			processFailure("HTTP response for inventory item query has malformed LLSD", response);
@@ -0,0 +1,352 @@
+/**
+ * @file llmeshheaderindex.cpp
+ * @brief Memory mapped index of decoded mesh asset headers
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshheaderindex.h"
+
+#include <cerrno>
+
+#include "llsd.h"
+
+static const U32 INDEX_MAGIC = 0x5849484D; // "MHIX"
+static const U32 INDEX_VERSION = 1;
+static const U32 INDEX_MIN_CAPACITY = 4096;
+static const U32 INDEX_MAX_CAPACITY = 1 << 18;
+
+// Keys of the ranges in a mesh header, in ERange order
+static const char* const RANGE_KEYS[LLMeshHeaderIndex::NUM_RANGES] =
+{
+	"lowest_lod",
+	"low_lod",
+	"medium_lod",
+	"high_lod",
+	"skin",
+	"physics_convex",
+	"physics_mesh"
+};
+
+LLMeshHeaderIndex::Record::Record()
+:	mVersion(-1),
+	mHeaderSize(0)
+{
+	for (S32 i = 0; i < NUM_RANGES; ++i)
+	{
+		mOffset[i] = -1;
+		mSize[i] = 0;
+	}
+}
+
+LLMeshHeaderIndex::LLMeshHeaderIndex()
+:	mHeader(nullptr),
+	mSlots(nullptr),
+	mMask(0),
+	mReadOnly(true)
+{
+	static_assert(sizeof(Header) == 32, "mesh header index header layout changed");
+	static_assert(sizeof(Slot) == 84, "mesh header index slot layout changed");
+}
+
+LLMeshHeaderIndex::~LLMeshHeaderIndex()
+{
+	close();
+}
+
+bool LLMeshHeaderIndex::open(const std::string& filename, bool read_only)
+{
+	close();
+	mReadOnly = read_only;
+	mFileName = read_only ? LLStringUtil::null : filename;
+
+	bool mapped = read_only ? mFile.open(filename, LLMappedFile::COPY_ON_WRITE)
+							: mFile.open(filename, LLMappedFile::READ_WRITE);
+	if (mapped)
+	{
+		const Header* header = mFile.getAs<Header>();
+		if (header
+			&& header->mMagic == INDEX_MAGIC
+			&& header->mVersion == INDEX_VERSION
+			&& header->mCapacity >= INDEX_MIN_CAPACITY
+			&& header->mCapacity <= INDEX_MAX_CAPACITY
+			&& (header->mCapacity & (header->mCapacity - 1)) == 0
+			&& mFile.size() == sizeof(Header) + (size_t)header->mCapacity * sizeof(Slot))
+		{
+			mHeader = mFile.getAs<Header>();
+			mSlots = reinterpret_cast<Slot*>(mFile.data() + sizeof(Header));
+			mMask = mHeader->mCapacity - 1;
+			return true;
+		}
+		mFile.close();
+	}
+
+	// Missing or from an older version: start over
+	return initialize(mFileName, INDEX_MIN_CAPACITY);
+}
+
+bool LLMeshHeaderIndex::initialize(const std::string& filename, U32 capacity)
+{
+	const size_t file_size = sizeof(Header) + (size_t)capacity * sizeof(Slot);
+
+	bool needs_zero = false;
+	bool mapped = false;
+	if (!filename.empty())
+	{
+		// Removing the file gives us a zero filled (and sparse where supported) replacement
+		needs_zero = LLFile::isfile(filename) && LLFile::remove(filename, ENOENT) != 0;
+		mapped = mFile.open(filename, LLMappedFile::READ_WRITE, file_size);
+		if (mapped && mFile.size() != file_size)
+		{
+			mapped = mFile.resize(file_size);
+		}
+	}
+	if (!mapped)
+	{
+		// Keep a working index for this session even if it can't be persisted
+		needs_zero = false;
+		mapped = mFile.open(LLStringUtil::null, LLMappedFile::READ_WRITE, file_size);
+		if (!mapped)
+		{
+			LL_WARNS("Mesh") << "Unable to allocate mesh header index" << LL_ENDL;
+			mHeader = nullptr;
+			mSlots = nullptr;
+			mMask = 0;
+			return false;
+		}
+	}
+	if (needs_zero)
+	{
+		memset(mFile.data(), 0, file_size);
+	}
+
+	mHeader = mFile.getAs<Header>();
+	memset((void*)mHeader, 0, sizeof(Header));
+	mHeader->mMagic = INDEX_MAGIC;
+	mHeader->mVersion = INDEX_VERSION;
+	mHeader->mCapacity = capacity;
+	mSlots = reinterpret_cast<Slot*>(mFile.data() + sizeof(Header));
+	mMask = capacity - 1;
+	return true;
+}
+
+void LLMeshHeaderIndex::close()
+{
+	if (mHeader && !mReadOnly)
+	{
+		mFile.flush(true);
+	}
+	mFile.close();
+	mHeader = nullptr;
+	mSlots = nullptr;
+	mMask = 0;
+}
+
+U32 LLMeshHeaderIndex::size() const
+{
+	return mHeader ? mHeader->mCount : 0;
+}
+
+//static
+U32 LLMeshHeaderIndex::hashID(const LLUUID& id)
+{
+	// Must be stable across sessions, so no std::hash / absl::Hash here
+	U64 lo, hi;
+	memcpy(&lo, id.mData, sizeof(U64));
+	memcpy(&hi, id.mData + sizeof(U64), sizeof(U64));
+	U64 h = lo ^ (hi * 0x9E3779B97F4A7C15ULL);
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return (U32)h;
+}
+
+//static
+U32 LLMeshHeaderIndex::checksum(const Slot& slot)
+{
+	// FNV-1a over everything but the checksum itself
+	const U8* bytes = reinterpret_cast<const U8*>(&slot);
+	U32 h = 2166136261U;
+	for (size_t i = 0; i < sizeof(Slot); ++i)
+	{
+		if (i == offsetof(Slot, mChecksum))
+		{
+			i += sizeof(U32) - 1;
+			continue;
+		}
+		h = (h ^ bytes[i]) * 16777619U;
+	}
+	// Zero is what a free slot holds
+	return h ? h : 1;
+}
+
+bool LLMeshHeaderIndex::find(const LLUUID& id, Record& record) const
+{
+	if (!mSlots || id.isNull())
+	{
+		return false;
+	}
+
+	U32 pos = hashID(id) & mMask;
+	for (U32 probe = 0; probe <= mMask; ++probe, pos = (pos + 1) & mMask)
+	{
+		const Slot& slot = mSlots[pos];
+		if (slot.mID.isNull())
+		{
+			return false;
+		}
+		if (slot.mID == id)
+		{
+			if (slot.mChecksum != checksum(slot))
+			{
+				return false; // torn or damaged, will be rewritten
+			}
+			record.mVersion = slot.mVersion;
+			record.mHeaderSize = slot.mHeaderSize;
+			memcpy(record.mOffset, slot.mOffset, sizeof(record.mOffset));
+			memcpy(record.mSize, slot.mSize, sizeof(record.mSize));
+			return true;
+		}
+	}
+	return false;
+}
+
+void LLMeshHeaderIndex::insert(const LLUUID& id, const Record& record)
+{
+	if (!mSlots || id.isNull())
+	{
+		return;
+	}
+
+	if ((mHeader->mCount + 1) * 4 > mHeader->mCapacity * 3 && !grow())
+	{
+		return;
+	}
+
+	U32 pos = hashID(id) & mMask;
+	for (U32 probe = 0; probe <= mMask; ++probe, pos = (pos + 1) & mMask)
+	{
+		Slot& slot = mSlots[pos];
+		const bool empty = slot.mID.isNull();
+		if (empty || slot.mID == id)
+		{
+			slot.mID = id;
+			slot.mVersion = record.mVersion;
+			slot.mHeaderSize = record.mHeaderSize;
+			memcpy(slot.mOffset, record.mOffset, sizeof(slot.mOffset));
+			memcpy(slot.mSize, record.mSize, sizeof(slot.mSize));
+			slot.mChecksum = checksum(slot);
+			if (empty)
+			{
+				mHeader->mCount++;
+			}
+			return;
+		}
+	}
+}
+
+bool LLMeshHeaderIndex::grow()
+{
+	const U32 capacity = mHeader->mCapacity;
+	if (capacity >= INDEX_MAX_CAPACITY)
+	{
+		// Headers are cheap to fetch again, drop everything rather than grow without bound
+		LL_INFOS("Mesh") << "Mesh header index full, clearing it" << LL_ENDL;
+		mFile.close();
+		return initialize(mFileName, capacity);
+	}
+
+	std::vector<Slot> live;
+	live.reserve(mHeader->mCount);
+	for (U32 i = 0; i < capacity; ++i)
+	{
+		const Slot& slot = mSlots[i];
+		if (slot.mID.notNull() && slot.mChecksum == checksum(slot))
+		{
+			live.push_back(slot);
+		}
+	}
+
+	mFile.close();
+	if (!initialize(mFileName, capacity * 2))
+	{
+		return false;
+	}
+
+	for (const Slot& slot : live)
+	{
+		U32 pos = hashID(slot.mID) & mMask;
+		while (mSlots[pos].mID.notNull())
+		{
+			pos = (pos + 1) & mMask;
+		}
+		mSlots[pos] = slot;
+		mHeader->mCount++;
+	}
+	return true;
+}
+
+//static
+bool LLMeshHeaderIndex::fromHeader(const LLSD& header, U32 header_size, Record& record)
+{
+	if (!header.isMap() || header.has("404") || header_size == 0)
+	{
+		return false;
+	}
+
+	record = Record();
+	record.mVersion = header.has("version") ? header["version"].asInteger() : -1;
+	record.mHeaderSize = header_size;
+	bool has_lod = false;
+	for (S32 i = 0; i < NUM_RANGES; ++i)
+	{
+		if (header.has(RANGE_KEYS[i]))
+		{
+			const LLSD& range = header[RANGE_KEYS[i]];
+			record.mOffset[i] = llmax(range["offset"].asInteger(), 0);
+			record.mSize[i] = llmax(range["size"].asInteger(), 0);
+			has_lod |= i <= HIGH_LOD && record.mSize[i] > 0;
+		}
+	}
+	return has_lod;
+}
+
+//static
+void LLMeshHeaderIndex::toHeader(const Record& record, LLSD& header)
+{
+	header = LLSD::emptyMap();
+	if (record.mVersion >= 0)
+	{
+		header["version"] = record.mVersion;
+	}
+	for (S32 i = 0; i < NUM_RANGES; ++i)
+	{
+		if (record.mOffset[i] >= 0)
+		{
+			LLSD& range = header[RANGE_KEYS[i]];
+			range["offset"] = record.mOffset[i];
+			range["size"] = record.mSize[i];
+		}
+	}
+}
@@ -0,0 +1,119 @@
+/**
+ * @file llmeshheaderindex.h
+ * @brief Memory mapped index of decoded mesh asset headers
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHHEADERINDEX_H
+#define LL_LLMESHHEADERINDEX_H
+
+#include "llmappedfile.h"
+#include "lluuid.h"
+
+class LLSD;
+
+// Open addressed, linear probed table of mesh asset UUID -> byte ranges of
+// the asset (LODs, skin, physics), stored in a memory mapped file so it
+// survives restarts. With a record at hand the mesh repository can request
+// LOD ranges right away instead of reading or fetching the header first.
+//
+// Mesh assets never change, so records are only ever added. Each record
+// carries a checksum, a record torn by a crash reads as a miss.
+//
+// Not thread safe, LLMeshRepoThread only uses it under its header mutex.
+class LLMeshHeaderIndex
+{
+public:
+	enum ERange
+	{
+		LOWEST_LOD = 0,
+		LOW_LOD,
+		MEDIUM_LOD,
+		HIGH_LOD,
+		SKIN,
+		PHYSICS_CONVEX,
+		PHYSICS_MESH,
+		NUM_RANGES
+	};
+
+	struct Record
+	{
+		Record();
+		S32 mVersion;				// mesh format version
+		U32 mHeaderSize;			// bytes before the ranges, as in LLMeshRepoThread::mMeshHeaderSize
+		S32 mOffset[NUM_RANGES];	// relative to the end of the header
+		S32 mSize[NUM_RANGES];
+	};
+
+	LLMeshHeaderIndex();
+	~LLMeshHeaderIndex();
+
+	// Maps filename, creating or recreating it if needed. When read_only is
+	// set the file is never written, records added stay in memory.
+	bool open(const std::string& filename, bool read_only);
+	void close();
+	bool isOpen() const { return mSlots != nullptr; }
+
+	bool find(const LLUUID& id, Record& record) const;
+	void insert(const LLUUID& id, const Record& record);
+	U32 size() const;
+
+	// Record of a parsed header, false if it has nothing worth keeping
+	static bool fromHeader(const LLSD& header, U32 header_size, Record& record);
+	// The parts of a header the mesh repository reads, rebuilt from a record
+	static void toHeader(const Record& record, LLSD& header);
+
+private:
+	struct Header
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mCapacity;		// number of slots, power of 2
+		U32 mCount;			// records
+		U8 mReserved[16];
+	};
+
+	struct Slot
+	{
+		LLUUID mID;			// null for a free slot
+		U32 mChecksum;
+		S32 mVersion;
+		U32 mHeaderSize;
+		S32 mOffset[NUM_RANGES];
+		S32 mSize[NUM_RANGES];
+	};
+
+	static U32 hashID(const LLUUID& id);
+	static U32 checksum(const Slot& slot);
+	bool initialize(const std::string& filename, U32 capacity);
+	bool grow();
+
+	LLMappedFile mFile;
+	std::string mFileName;
+	Header* mHeader;
+	Slot* mSlots;
+	U32 mMask;
+	bool mReadOnly;
+};
+
+#endif // LL_LLMESHHEADERINDEX_H
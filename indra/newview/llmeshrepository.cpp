@@ -246,6 +246,7 @@
 //     sMaxConcurrentRequests   mMutex        wo.main.none, ro.repo.none, ro.main.mMutex
 //     mMeshHeader              mHeaderMutex  rw.repo.mHeaderMutex, ro.main.mHeaderMutex, ro.main.none [0]
 //     mMeshHeaderSize          mHeaderMutex  rw.repo.mHeaderMutex
+//     mHeaderIndex             mHeaderMutex  rw.any.mHeaderMutex
 //     mSkinRequests            mMutex        rw.repo.mMutex, ro.repo.none [5]
 //     mSkinInfoQ               mMutex        rw.repo.mMutex, rw.main.mMutex [5] (was:  [0])
 //     mDecompositionRequests   mMutex        rw.repo.mMutex, ro.repo.none [5]
@@ -394,6 +395,11 @@ U32 LLMeshRepository::sMaxLockHoldoffs = 0;
 	
 LLDeadmanTimer LLMeshRepository::sQuiescentTimer(15.0, false);	// true -> gather cpu metrics
 
+static LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > MESH_HEADER_INDEX_HIT_RATE("mesh_header_index_hits");
+static LLTrace::EventStatHandle<F64Seconds> MESH_FIRST_LOAD_TIME("mesh_first_load_time");
+// Main thread only
+static bool sFirstMeshLoaded = false;
+
 namespace {
     // The NoOpDeletor is used when passing certain objects (generally the LLMeshUploadThread) 
     // in a smart pointer below for passage into the LLCore::Http libararies.  
@@ -810,6 +816,7 @@ void log_upload_error(LLCore::HttpStatus status, const LLSD& content,
 
 LLMeshRepoThread::LLMeshRepoThread()
 : LLThread("mesh repo"),
+  mHeaderIndexOpened(false),
   mHttpRequest(nullptr),
   mHttpOptions(),
   mHttpLargeOptions(),
@@ -858,6 +865,7 @@ LLMeshRepoThread::~LLMeshRepoThread()
 
     delete mHttpRequest;
 	mHttpRequest = nullptr;
+	mHeaderIndex.close();
 	delete mMutex;
 	mMutex = nullptr;
 	delete mHeaderMutex;
@@ -1165,7 +1173,7 @@ void LLMeshRepoThread::lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32
 void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 { //could be called from any thread
 	std::unique_lock<LLMutex> header_lock(*mHeaderMutex);
-	mesh_header_map::iterator iter = mMeshHeader.find(mesh_params.getSculptID());
+	mesh_header_map::iterator iter = findMeshHeader(mesh_params.getSculptID());
 	if (iter != mMeshHeader.end())
 	{ //if we have the header, request LOD byte range
 		header_lock.unlock();
@@ -1329,7 +1337,7 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
 
 	mHeaderMutex->lock();
 
-	auto header_it = mMeshHeader.find(mesh_id);
+	auto header_it = findMeshHeader(mesh_id);
 	if (header_it == mMeshHeader.end())
 	{ //we have no header info for this mesh, do nothing
 		mHeaderMutex->unlock();
@@ -1443,7 +1451,7 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 
 	mHeaderMutex->lock();
 
-	auto header_it = mMeshHeader.find(mesh_id);
+	auto header_it = findMeshHeader(mesh_id);
 	if (header_it == mMeshHeader.end())
 	{ //we have no header info for this mesh, do nothing
 		mHeaderMutex->unlock();
@@ -1543,7 +1551,7 @@ bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
 
 	mHeaderMutex->lock();
 
-	auto header_it = mMeshHeader.find(mesh_id);
+	auto header_it = findMeshHeader(mesh_id);
 	if (header_it == mMeshHeader.end())
 	{ //we have no header info for this mesh, do nothing
 		mHeaderMutex->unlock();
@@ -1735,7 +1743,7 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 	const LLUUID& mesh_id = mesh_params.getSculptID();
 
 	mHeaderMutex->lock();
-	auto header_it = mMeshHeader.find(mesh_id);
+	auto header_it = findMeshHeader(mesh_id);
 	if (header_it == mMeshHeader.end())
 	{ //we have no header info for this mesh, do nothing
 		mHeaderMutex->unlock();
@@ -1893,6 +1901,12 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 			LLMutexLock lock(mHeaderMutex);
 			mMeshHeaderSize.insert_or_assign(mesh_id, header_size);
 			mMeshHeader.insert_or_assign(mesh_id, header);
+
+			LLMeshHeaderIndex::Record entry;
+			if (LLMeshHeaderIndex::fromHeader(header, header_size, entry))
+			{
+				getHeaderIndex().insert(mesh_id, entry);
+			}
 		}
 
 		
@@ -1923,9 +1937,7 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
 	}
 
 	LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
-	boost::iostreams::stream<boost::iostreams::array_source> stream((char*)data, data_size);
-
-	if (volume->unpackVolumeFaces(stream, data_size))
+	if (volume->unpackVolumeFaces(data, data_size))
 	{
 		if (volume->getNumFaces() > 0)
 		{
@@ -2016,9 +2028,7 @@ bool LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32
 		volume_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
 		volume_params.setSculptID(mesh_id, LL_SCULPT_TYPE_MESH);
 		LLPointer<LLVolume> volume = new LLVolume(volume_params,0);
-		boost::iostreams::stream<boost::iostreams::array_source> stream((char*)data, data_size);
-
-		if (volume->unpackVolumeFaces(stream, data_size))
+		if (volume->unpackVolumeFaces(data, data_size))
 		{
 			//load volume faces into decomposition buffer
 			S32 vertex_count = 0;
@@ -2944,7 +2954,7 @@ void LLMeshRepoThread::notifyLoadedMeshes()
 S32 LLMeshRepoThread::getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod) 
 { //only ever called from main thread
 	LLMutexLock lock(mHeaderMutex);
-	mesh_header_map::iterator iter = mMeshHeader.find(mesh_params.getSculptID());
+	mesh_header_map::iterator iter = findMeshHeader(mesh_params.getSculptID());
 
 	if (iter != mMeshHeader.end())
 	{
@@ -4015,6 +4025,13 @@ void LLMeshRepository::notifyMeshLoaded(const LLVolumeParams& mesh_params, LLVol
 			LL_WARNS(LOG_MESH) << "Mesh loading returned empty volume.  ID:  " << mesh_params.getSculptID()
 							   << LL_ENDL;
 		}
+		else if (!sFirstMeshLoaded)
+		{
+			sFirstMeshLoaded = true;
+			F64Seconds first_load_time = totalTime() - gStartTime;
+			record(MESH_FIRST_LOAD_TIME, first_load_time);
+			LL_INFOS(LOG_MESH) << "First mesh loaded " << first_load_time << " after startup" << LL_ENDL;
+		}
 		
 		{ //update system volume
 			LLVolume* sys_volume = LLPrimitive::getVolumeManager()->refVolume(mesh_params, detail);
@@ -4223,6 +4240,64 @@ LLSD& LLMeshRepository::getMeshHeader(const LLUUID& mesh_id)
 	return mThread->getMeshHeader(mesh_id);
 }
 
+LLMeshHeaderIndex& LLMeshRepoThread::getHeaderIndex()
+{
+	if (!mHeaderIndexOpened)
+	{
+		mHeaderIndexOpened = true;
+		std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "mesh_headers.index");
+		if (mHeaderIndex.open(filename, LLAppViewer::instance()->isSecondInstance()))
+		{
+			LL_INFOS(LOG_MESH) << "Mesh header index has " << mHeaderIndex.size() << " entries" << LL_ENDL;
+		}
+	}
+	return mHeaderIndex;
+}
+
+LLMeshRepoThread::mesh_header_map::iterator LLMeshRepoThread::findMeshHeader(const LLUUID& mesh_id)
+{
+	mesh_header_map::iterator iter = mMeshHeader.find(mesh_id);
+	if (iter != mMeshHeader.end() || mesh_id.isNull() || mHeaderIndexMisses.count(mesh_id))
+	{
+		return iter;
+	}
+
+	// Known from an earlier session, the LOD ranges can be requested without
+	// reading or fetching the header again
+	LLMeshHeaderIndex::Record entry;
+	if (!getHeaderIndex().find(mesh_id, entry) || entry.mVersion > MAX_MESH_VERSION)
+	{
+		mHeaderIndexMisses.insert(mesh_id);
+		record(MESH_HEADER_INDEX_HIT_RATE, LLUnits::Ratio::fromValue(0));
+		return iter;
+	}
+
+	// Only the header fetch creates and sizes the VFS entry the LODs are
+	// cached into, so fetch it again if the entry has been evicted
+	// (sized as in LLMeshHeaderHandler::processData)
+	S32 bytes = 0;
+	for (S32 i = 0; i < LLMeshHeaderIndex::PHYSICS_MESH; ++i)
+	{
+		if (entry.mSize[i] > 0)
+		{
+			bytes = llmax(bytes, entry.mOffset[i] + entry.mSize[i]);
+		}
+	}
+	LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
+	if (file.getSize() < (S32)entry.mHeaderSize + bytes)
+	{
+		mHeaderIndexMisses.insert(mesh_id);
+		record(MESH_HEADER_INDEX_HIT_RATE, LLUnits::Ratio::fromValue(0));
+		return iter;
+	}
+	record(MESH_HEADER_INDEX_HIT_RATE, LLUnits::Ratio::fromValue(1));
+
+	LLSD header;
+	LLMeshHeaderIndex::toHeader(entry, header);
+	mMeshHeaderSize.insert_or_assign(mesh_id, entry.mHeaderSize);
+	return mMeshHeader.insert_or_assign(mesh_id, header).first;
+}
+
 LLSD& LLMeshRepoThread::getMeshHeader(const LLUUID& mesh_id)
 {
 	static LLSD dummy_ret;
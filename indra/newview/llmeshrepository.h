@@ -40,8 +40,10 @@
 #include "httpheaders.h"
 #include "httphandler.h"
 #include "llthread.h"
+#include "llmeshheaderindex.h"
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/container/node_hash_map.h>
 
 #define LLCONVEXDECOMPINTER_STATIC 1
@@ -218,6 +220,14 @@ public:
 	
 	absl::flat_hash_map<LLUUID, U32> mMeshHeaderSize;
 
+	// byte ranges of headers seen in earlier sessions, opened on first use
+	// since the cache directory isn't settled when the thread is created
+	LLMeshHeaderIndex mHeaderIndex;
+	bool mHeaderIndexOpened;
+	// meshes findMeshHeader() found no usable index entry for, so that per
+	// frame lookups neither probe the VFS nor count against the hit rate again
+	absl::flat_hash_set<LLUUID> mHeaderIndexMisses;
+
 	class HeaderRequest : public RequestStats
 	{ 
 	public:
@@ -354,6 +364,10 @@ public:
 	bool decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	bool physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	LLSD& getMeshHeader(const LLUUID& mesh_id);
+	// mHeaderMutex must be held. Falls back to mHeaderIndex, adding what it finds to mMeshHeader.
+	mesh_header_map::iterator findMeshHeader(const LLUUID& mesh_id);
+	// mHeaderMutex must be held
+	LLMeshHeaderIndex& getHeaderIndex();
 
 	void notifyLoadedMeshes();
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
@@ -370,6 +370,12 @@ void LLPanelNearByMedia::updateListItem(LLScrollListItem* item, LLViewerMediaImp
 		debug_str += llformat("%g/", (F32) sqrt(impl->getProximityDistance()));
 		
 		//			s += llformat("%g/", (float)impl->getCPUUsage());
+		LLPluginClassMedia* plugin = impl->getMediaPlugin();
+		if (plugin)
+		{
+			// message rate and microseconds of CPU per message, both processes
+			debug_str += llformat("%.0fmsg/s %.1fus/", (F32)plugin->getMessageRate(), (F32)(plugin->getMessageCPU() * 1000000.0));
+		}
 		//			s += llformat("%g/", (float)impl->getApproximateTextureInterest());
 		debug_str += llformat("%g/", (float)(nullptr == impl->getSomeObject()) ? 0.0 : impl->getSomeObject()->getPixelArea());
 		
@@ -33,6 +33,7 @@
 #include "llmeshrepository.h"
 #include "llvolume.h"
 #include "llrigginginfo.h"
+#include "llskinningkernel.h"
 
 #include "llvector4a.h"
 
@@ -247,6 +248,30 @@ void LLSkinningUtil::getPerVertexSkinMatrix(
 #endif
 }
 
+void LLSkinningUtil::skinVertices(
+    const LLMeshSkinInfo* skin,
+    const LLMatrix4a* mat,
+    S32 count,
+    const LLVector4a* weights,
+    const LLVector4a* positions,
+    LLVector4a* out_positions,
+    const LLVector4a* normals,
+    LLVector4a* out_normals,
+    S32 num_vertices,
+    LLVector4a* extents)
+{
+    // Fold the bind shape into the palette once instead of transforming every vertex by it
+    LLMatrix4a palette[LL_MAX_JOINTS_PER_MESH_OBJECT];
+    count = llmin(count, (S32)LL_MAX_JOINTS_PER_MESH_OBJECT);
+    for (S32 j = 0; j < count; ++j)
+    {
+        palette[j].setMul(mat[j], skin->mBindShapeMatrix);
+    }
+
+    LLSkinningKernel::skin(palette, count, weights, positions, out_positions,
+                           normals, out_normals, num_vertices, extents);
+}
+
 void LLSkinningUtil::initJointNums(LLMeshSkinInfo* skin, LLVOAvatar *avatar)
 {
     if (!skin->mJointNumsInitialized)
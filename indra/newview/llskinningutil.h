@@ -41,6 +41,11 @@ namespace LLSkinningUtil
     void checkSkinWeights(LLVector4a* weights, U32 num_vertices, const LLMeshSkinInfo* skin);
     void scrubSkinWeights(LLVector4a* weights, U32 num_vertices, const LLMeshSkinInfo* skin);
     void getPerVertexSkinMatrix(const LLVector4a& weights, LLMatrix4a* mat, bool handle_bad_scale, LLMatrix4a& final_mat, U32 max_joints);
+    // Skins a whole face with LLSkinningKernel, bind shape included. normals,
+    // out_normals and extents may be null.
+    void skinVertices(const LLMeshSkinInfo* skin, const LLMatrix4a* mat, S32 count,
+                      const LLVector4a* weights, const LLVector4a* positions, LLVector4a* out_positions,
+                      const LLVector4a* normals, LLVector4a* out_normals, S32 num_vertices, LLVector4a* extents);
     void initJointNums(LLMeshSkinInfo* skin, LLVOAvatar *avatar);
     void updateRiggingInfo(const LLMeshSkinInfo* skin, LLVOAvatar *avatar, LLVolumeFace& vol_face);
 	LLQuaternion getUnscaledQuaternion(const LLMatrix4a& mat4);
@@ -567,7 +567,7 @@ LLSpatialGroup::LLSpatialGroup(OctreeNode* node, LLSpatialPartition* part) : LLO
 	mPixelArea = 1024.f;
 }
 
-void LLSpatialGroup::updateDistance(LLCamera &camera)
+void LLSpatialGroup::updateDistance(LLCamera &camera, std::vector<LLSpatialGroup*>* rebuild_groups)
 {
 	if (LLViewerCamera::sCurCameraID != LLViewerCamera::CAMERA_WORLD)
 	{
@@ -590,12 +590,12 @@ void LLSpatialGroup::updateDistance(LLCamera &camera)
 	{
 		mRadius = getSpatialPartition()->mRenderByGroup ? mObjectBounds[1].getLength3().getF32() :
 						(F32) mOctreeNode->getSize().getLength3().getF32();
-		mDistance = getSpatialPartition()->calcDistance(this, camera);
+		mDistance = getSpatialPartition()->calcDistance(this, camera, rebuild_groups);
 		mPixelArea = getSpatialPartition()->calcPixelArea(this, camera);
 	}
 }
 
-F32 LLSpatialPartition::calcDistance(LLSpatialGroup* group, LLCamera& camera)
+F32 LLSpatialPartition::calcDistance(LLSpatialGroup* group, LLCamera& camera, std::vector<LLSpatialGroup*>* rebuild_groups)
 {
 	LLVector4a eye;
 	LLVector4a origin;
@@ -629,7 +629,14 @@ F32 LLSpatialPartition::calcDistance(LLSpatialGroup* group, LLCamera& camera)
 					//NOTE: If there is a trivial way to detect that alpha sorting here would not change the render order,
 					//not setting this node to dirty would be a very good thing
 					group->setState(LLSpatialGroup::ALPHA_DIRTY);
-					gPipeline.markRebuild(group, FALSE);
+					if (rebuild_groups)
+					{
+						rebuild_groups->push_back(group);
+					}
+					else
+					{
+						gPipeline.markRebuild(group, FALSE);
+					}
 				}
 			}
 		}
@@ -956,18 +963,33 @@ void LLSpatialPartition::shift(const LLVector4a &offset)
 class LLOctreeCull : public LLViewerOctreeCull
 {
 public:
-	LLOctreeCull(LLCamera* camera) : LLViewerOctreeCull(camera) {}
+	LLOctreeCull(LLCamera* camera, LLDeferredCull* deferred = nullptr)
+		: LLViewerOctreeCull(camera), mDeferred(deferred) {}
 
     bool earlyFail(LLViewerOctreeGroup* base_group) override
 	{
 		LLSpatialGroup* group = (LLSpatialGroup*)base_group;
-		group->checkOcclusion();
+		if (!mDeferred)
+		{
+			group->checkOcclusion();
+		}
+		else if (group->needsOcclusionCheck())
+		{
+			mDeferred->mCheckOcclusion.push_back(group);
+		}
 
 		if (group->getOctreeNode()->getParent() &&	//never occlusion cull the root node
 		  	LLPipeline::sUseOcclusion &&			//ignore occlusion if disabled
 			group->isOcclusionState(LLSpatialGroup::OCCLUDED))
 		{
-			gPipeline.markOccluder(group);
+			if (mDeferred)
+			{
+				gPipeline.markOccluder(group, mDeferred->mResult);
+			}
+			else
+			{
+				gPipeline.markOccluder(group);
+			}
 			return true;
 		}
 		
@@ -1000,17 +1022,35 @@ public:
 		if (group->needsUpdate() ||
 			group->getVisible(LLViewerCamera::sCurCameraID) < LLDrawable::getCurrentFrame() - 1)
 		{
-			group->doOcclusion(mCamera);
+			if (mDeferred)
+			{
+				mDeferred->mDoOcclusion.push_back(group);
+			}
+			else
+			{
+				group->doOcclusion(mCamera);
+			}
+		}
+
+		if (mDeferred)
+		{
+			gPipeline.markNotCulled(group, *mCamera, mDeferred->mResult, mDeferred->mVisibleNodes, &mDeferred->mRebuild);
+		}
+		else
+		{
+			gPipeline.markNotCulled(group, *mCamera);
 		}
-		gPipeline.markNotCulled(group, *mCamera);
 	}
+
+protected:
+	LLDeferredCull* mDeferred;
 };
 
 class LLOctreeCullNoFarClip final : public LLOctreeCull
 {
 public: 
-	LLOctreeCullNoFarClip(LLCamera* camera) 
-		: LLOctreeCull(camera) { }
+	LLOctreeCullNoFarClip(LLCamera* camera, LLDeferredCull* deferred = nullptr)
+		: LLOctreeCull(camera, deferred) { }
 
     S32 frustumCheck(const LLViewerOctreeGroup* group) override
 	{
@@ -1027,8 +1067,8 @@ public:
 class LLOctreeCullShadow : public LLOctreeCull
 {
 public:
-	LLOctreeCullShadow(LLCamera* camera)
-		: LLOctreeCull(camera) { }
+	LLOctreeCullShadow(LLCamera* camera, LLDeferredCull* deferred = nullptr)
+		: LLOctreeCull(camera, deferred) { }
 
     S32 frustumCheck(const LLViewerOctreeGroup* group) final override
 	{
@@ -1390,7 +1430,7 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	return 0;
 	}
 	
-S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
+void LLSpatialPartition::rebound()
 {
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->checkStates();
@@ -1404,6 +1444,11 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->validate();
 #endif
+}
+
+S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
+{
+	rebound();
 
 	if (LLPipeline::sShadowRender)
 	{
@@ -1427,6 +1472,28 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 	return 0;
 }
 
+S32 LLSpatialPartition::cull(LLDeferredCull& deferred)
+{
+	LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);
+	if (LLPipeline::sShadowRender)
+	{
+		LLOctreeCullShadow culler(&deferred.mCamera, &deferred);
+		culler.traverse(mOctree);
+	}
+	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		LLOctreeCullNoFarClip culler(&deferred.mCamera, &deferred);
+		culler.traverse(mOctree);
+	}
+	else
+	{
+		LLOctreeCull culler(&deferred.mCamera, &deferred);
+		culler.traverse(mOctree);
+	}
+
+	return 0;
+}
+
 void pushVerts(LLDrawInfo* params, U32 mask)
 {
 	LLRenderPass::applyModelMatrix(*params);
@@ -3949,6 +4016,41 @@ void LLCullResult::pushBack(T& head, U32& count, V* val)
 	count++;
 }
 
+void LLCullResult::append(LLCullResult& other)
+{
+	for (sg_iterator i = other.beginVisibleGroups(); i != other.endVisibleGroups(); ++i)
+	{
+		pushVisibleGroup(*i);
+	}
+	for (sg_iterator i = other.beginAlphaGroups(); i != other.endAlphaGroups(); ++i)
+	{
+		pushAlphaGroup(*i);
+	}
+	for (sg_iterator i = other.beginOcclusionGroups(); i != other.endOcclusionGroups(); ++i)
+	{
+		pushOcclusionGroup(*i);
+	}
+	for (sg_iterator i = other.beginDrawableGroups(); i != other.endDrawableGroups(); ++i)
+	{
+		pushDrawableGroup(*i);
+	}
+	for (drawable_iterator i = other.beginVisibleList(); i != other.endVisibleList(); ++i)
+	{
+		pushDrawable(*i);
+	}
+	for (bridge_iterator i = other.beginVisibleBridge(); i != other.endVisibleBridge(); ++i)
+	{
+		pushBridge(*i);
+	}
+	for (U32 type = 0; type < LLRenderPass::NUM_RENDER_TYPES; ++type)
+	{
+		for (drawinfo_iterator i = other.beginRenderMap(type); i != other.endRenderMap(type); ++i)
+		{
+			pushDrawInfo(type, *i);
+		}
+	}
+}
+
 void LLCullResult::clear()
 {
 	mVisibleGroupsSize = 0;
@@ -4161,3 +4263,43 @@ void LLCullResult::assertDrawMapsEmpty()
 	}
 }
 
+
+//============================================================================
+
+LLDeferredCull::LLDeferredCull()
+:	mPartition(nullptr),
+	mVisibleNodes(0)
+{
+}
+
+void LLDeferredCull::reset(LLSpatialPartition* part, const LLCamera& camera)
+{
+	mPartition = part;
+	mCamera = camera;
+	mResult.clear();
+	mCheckOcclusion.clear();
+	mDoOcclusion.clear();
+	mRebuild.clear();
+	mVisibleNodes = 0;
+}
+
+void LLDeferredCull::cull()
+{
+	mPartition->cull(*this);
+}
+
+void LLDeferredCull::finish()
+{
+	for (LLSpatialGroup* group : mCheckOcclusion)
+	{
+		group->checkOcclusion();
+	}
+	for (LLSpatialGroup* group : mDoOcclusion)
+	{
+		group->doOcclusion(&mCamera);
+	}
+	for (LLSpatialGroup* group : mRebuild)
+	{
+		gPipeline.markRebuild(group, FALSE);
+	}
+}
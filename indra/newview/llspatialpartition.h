@@ -52,6 +52,7 @@ class LLSpatialPartition;
 class LLSpatialBridge;
 class LLSpatialGroup;
 class LLViewerRegion;
+class LLDeferredCull;
 
 void pushVerts(LLFace* face, U32 mask);
 
@@ -281,7 +282,9 @@ public:
 	void shift(const LLVector4a &offset);
 	void destroyGL(bool keep_occlusion = false);
 	
-	void updateDistance(LLCamera& camera);
+	// Groups whose alpha sorting needs a rebuild go to rebuild_groups when given, for the
+	// caller to markRebuild() on the main thread
+	void updateDistance(LLCamera& camera, std::vector<LLSpatialGroup*>* rebuild_groups = nullptr);
 	F32 getUpdateUrgency() const;
 	BOOL changeLOD();
 	void rebuildGeom();
@@ -372,7 +375,7 @@ public:
 	virtual void move(LLDrawable *drawablep, LLSpatialGroup *curp, BOOL immediate = FALSE);
 	virtual void shift(const LLVector4a &offset);
 
-	virtual F32 calcDistance(LLSpatialGroup* group, LLCamera& camera);
+	virtual F32 calcDistance(LLSpatialGroup* group, LLCamera& camera, std::vector<LLSpatialGroup*>* rebuild_groups = nullptr);
 	virtual F32 calcPixelArea(LLSpatialGroup* group, LLCamera& camera);
 
 	void rebuildGeom(LLSpatialGroup* group) override;
@@ -381,6 +384,8 @@ public:
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	/*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion=false) final override; // Cull on arbitrary frustum
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select); // Cull on arbitrary frustum
+	S32 cull(LLDeferredCull& deferred); // Cull on any thread, call rebound() on the main thread first
+	void rebound(); // Update the bounds of dirty groups
 	
 	BOOL isVisible(const LLVector3& v);
 	bool isHUDPartition() ;
@@ -487,6 +492,7 @@ public:
 	void pushDrawable(LLDrawable* drawable);
 	void pushBridge(LLSpatialBridge* bridge);
 	void pushDrawInfo(U32 type, LLDrawInfo* draw_info);
+	void append(LLCullResult& other); // push everything in other after what is already here
 	
 	U32 getVisibleGroupsSize()		{ return mVisibleGroupsSize; }
 	U32	getAlphaGroupsSize()		{ return mAlphaGroupsSize; }
@@ -536,6 +542,29 @@ private:
 };
 
 
+// Culls one spatial partition off the main thread. The traversal only touches the partition's
+// own groups and mResult. Reading back and issuing occlusion queries needs the GL context, so
+// the groups concerned are recorded for finish(), as are alpha sorting rebuilds, since the
+// pipeline's rebuild queues are not thread safe. finish() then runs on the main thread, after
+// the traversal. Occlusion results thus take one frame longer to be seen than in a serial cull.
+class LLDeferredCull
+{
+public:
+	LLDeferredCull();
+
+	void reset(LLSpatialPartition* part, const LLCamera& camera);
+	void cull();
+	void finish();
+
+	LLSpatialPartition* mPartition;
+	LLCamera mCamera;
+	LLCullResult mResult;
+	std::vector<LLSpatialGroup*> mCheckOcclusion;	// visited groups with a query to read back
+	std::vector<LLSpatialGroup*> mDoOcclusion;		// visible groups to issue a query for
+	std::vector<LLSpatialGroup*> mRebuild;			// groups to re-sort, pipeline queues are main thread only
+	S32 mVisibleNodes;
+};
+
 //spatial partition for water (implemented in LLVOWater.cpp)
 class LLWaterPartition : public LLSpatialPartition
 {
@@ -620,6 +649,9 @@ class LLVolumeGeometryManager: public LLGeometryManager
 	U32 genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort = FALSE, BOOL batch_textures = FALSE, BOOL no_materials = FALSE);
 	void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
 
+	// rebuildMesh() for each group, generating the vertex data of volume groups on the job system
+	static void rebuildMeshes(const LLSpatialGroup::sg_vector_t& groups);
+
 private:
 	void allocateFaces(U32 pMaxFaceCount);
 	void freeFaces();
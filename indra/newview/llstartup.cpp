@@ -609,6 +609,10 @@ bool idle_startup()
 				msg->mPacketRing.setUseOutThrottle(TRUE);
 				msg->mPacketRing.setOutBandwidth(outBandwidth);
 			}
+			if (gSavedSettings.getBOOL("PacketReceiveThread"))
+			{
+				msg->mPacketRing.startReceiveThread(msg->mSocket);
+			}
 		}
 
 		LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
@@ -734,15 +734,30 @@ BOOL LLSurface::idleUpdate(F32 max_update_time)
 
 void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL b_large_patch) 
 {
+	DecodedPatches decoded;
+	decodeDCTPatches(bitpack, *gopp, b_large_patch, mPatchesPerEdge, decoded);
+	applyDecodedPatches(decoded);
+}
 
+// static
+void LLSurface::decodeDCTPatches(LLBitPack &bitpack, const LLGroupHeader &goph, BOOL b_large_patch,
+								 S32 patches_per_edge, DecodedPatches &decoded)
+{
 	LLPatchHeader  ph;
 	S32 j, i;
 	S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-	LLSurfacePatch *patchp;
 
-	init_patch_decompressor(gopp->patch_size);
-	gopp->stride = mGridsPerEdge;
-	set_group_of_patch_header(gopp);
+	const S32 patch_size = goph.patch_size;
+	const S32 patch_area = patch_size*patch_size;
+	decoded.mPatchSize = patch_size;
+	decoded.mPatches.clear();
+	decoded.mHeights.clear();
+
+	if ((patch_size != NORMAL_PATCH_SIZE) && (patch_size != LARGE_PATCH_SIZE))
+	{
+		LL_WARNS() << "Received invalid terrain packet - patch size " << patch_size << LL_ENDL;
+		return;
+	}
 
 	while (true)
 	{
@@ -763,10 +778,10 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 			j = ph.patchids & 0x1F; //y
 		}
 
-		if ((i >= mPatchesPerEdge) || (j >= mPatchesPerEdge))
+		if ((i >= patches_per_edge) || (j >= patches_per_edge))
 		{
 			LL_WARNS() << "Received invalid terrain packet - patch header patch ID incorrect!" 
-				<< " patches per edge " << mPatchesPerEdge
+				<< " patches per edge " << patches_per_edge
 				<< " i " << i
 				<< " j " << j
 				<< " dc_offset " << ph.dc_offset
@@ -777,11 +792,28 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 			return;
 		}
 
-		patchp = &mPatchList[j*mPatchesPerEdge + i];
+		decode_patch(bitpack, patch);
+
+		decoded.mPatches.push_back(j*patches_per_edge + i);
+		decoded.mHeights.resize(decoded.mHeights.size() + patch_area);
+		decompress_patch_simd(&decoded.mHeights[decoded.mHeights.size() - patch_area], patch_size, patch, &ph, patch_size);
+	}
+}
 
+void LLSurface::applyDecodedPatches(const DecodedPatches &decoded)
+{
+	const S32 patch_size = decoded.mPatchSize;
+	const F32 *heights = decoded.mHeights.data();
+	for (S32 patch_index : decoded.mPatches)
+	{
+		LLSurfacePatch *patchp = &mPatchList[patch_index];
 
-		decode_patch(bitpack, patch);
-		decompress_patch(patchp->getDataZ(), patch, &ph);
+		F32 *data_z = patchp->getDataZ();
+		for (S32 j = 0; j < patch_size; j++)
+		{
+			memcpy(data_z + j*mGridsPerEdge, heights, patch_size*sizeof(F32));
+			heights += patch_size;
+		}
 
 		// Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
 		patchp->updateNorthEdge();
@@ -84,7 +84,21 @@ public:
 	void disconnectNeighbor(LLSurface *neighborp);
 	void disconnectAllNeighbors();
 
+	// Land patches of a LayerData packet, see decodeDCTPatches()
+	struct DecodedPatches
+	{
+		S32 mPatchSize;
+		std::vector<S32> mPatches;	// index in mPatchList of each patch
+		std::vector<F32> mHeights;	// mPatchSize rows of mPatchSize heights per patch
+	};
+
 	virtual void decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL b_large_patch);
+	// Any thread. Decodes the patches following the group header goph, decoded
+	// from bitpack on the same thread, for a surface with patches_per_edge patches.
+	static void decodeDCTPatches(LLBitPack &bitpack, const LLGroupHeader &goph, BOOL b_large_patch,
+								 S32 patches_per_edge, DecodedPatches &decoded);
+	// Copies decoded heights into their patches and updates the patch edges
+	void applyDecodedPatches(const DecodedPatches &decoded);
 	virtual void updatePatchVisibilities(LLAgent &agent);
 
 	inline F32 getZ(const U32 k) const				{ return mSurfaceZ[k]; }
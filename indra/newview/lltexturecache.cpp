@@ -41,6 +41,7 @@
 #include "lldir.h"
 #include "llimage.h"
 #include "llimagej2c.h" // for version control
+#include "lljobsystem.h"
 #include "lllfsthread.h"
 #include "llviewercontrol.h"
 
@@ -52,6 +53,8 @@
 // Cache organization:
 // cache/texture.entries
 //  Unordered array of Entry structs
+// cache/texture.index
+//  Memory mapped hash table of UUID -> texture.entries index (see LLTextureCacheIndex)
 // cache/texture.cache
 //  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
 // cache/textures/[0-F]/UUID.texture
@@ -834,8 +837,10 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 
 //////////////////////////////////////////////////////////////////////////////
 
+static LLJobType sTextureCacheJobType("texture_cache");
+
 LLTextureCache::LLTextureCache(bool threaded)
-	: LLWorkerThread("TextureCache", threaded),
+	: LLWorkerThread("TextureCache", threaded, false, &sTextureCacheJobType),
 	  mWorkersMutex(),
 	  mHeaderMutex(),
 	  mListMutex(),
@@ -847,6 +852,7 @@ LLTextureCache::LLTextureCache(bool threaded)
 	  mReadOnly(TRUE),
 	  mFastCachep(NULL),
 	  mFastCachePadBuffer(NULL),
+	  mStampOnRead(false),
 	  mTexturesSizeTotal(0),
 	  mDoPurge(false)
 {
@@ -857,6 +863,13 @@ LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList() ;
 	writeUpdatedEntries() ;
+	if (!mReadOnly)
+	{
+		// texture.entries is fully written out, the next session can start from the index
+		LLMutexLock lock(&mHeaderMutex);
+		mHeaderIndex.markClean(mHeaderEntriesInfo.mEntries, getEntriesStamp(), mTexturesSizeTotal);
+	}
+	mHeaderIndex.close();
 	delete mFastCachep;
 	delete mFastCachePoolp;
 	delete mHeaderAPRFilePoolp;
@@ -943,10 +956,14 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
+	LLTextureCacheIndex::Record record;
+	if (mHeaderIndex.find(id, record))
+	{
+		return TRUE;
+	}
+	// A lock free miss can race with the writer, only a locked one is final
 	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-	
-	return (iter != mHeaderIDMap.end()) ;
+	return mHeaderIndex.find(id, record);
 }
 
 //debug
@@ -1003,6 +1020,7 @@ U32 LLTextureCache::sHeaderCacheAddressSize = 32;
 #endif
 
 const char* entries_filename = "texture.entries";
+const char* index_filename = "texture.index";
 const char* cache_filename = "texture.cache";
 const char* old_textures_dirname = "textures";
 //change the location of the texture cache to prevent from being deleted by old version viewers.
@@ -1012,6 +1030,7 @@ const char* fast_cache_filename = "FastCache.cache";
 void LLTextureCache::setDirNames(ELLPath location)
 {
 	mHeaderEntriesFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, entries_filename);
+	mHeaderIndexFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, index_filename);
 	mHeaderDataFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, cache_filename);
 	mTexturesDirName = gDirUtilp->getExpandedFilename(location, textures_dirname);
 	mFastCacheFileName =  gDirUtilp->getExpandedFilename(location, textures_dirname, fast_cache_filename);
@@ -1097,8 +1116,16 @@ U64 LLTextureCache::initCache(ELLPath location, U64 max_size, BOOL texture_cache
 			LLFile::mkdir(dirname);
 		}
 	}
-	readHeaderCache();
-	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
+	readHeaderCache(true);
+	if (!mHeaderIndex.isValidFor(mHeaderEntriesInfo.mEntries, getEntriesStamp()))
+	{
+		purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
+	}
+	else if (mTexturesSizeTotal > sCacheMaxTexturesSize)
+	{
+		// Started from the index without reading the entries, trim on the next write instead
+		mDoPurge = true;
+	}
 
 	llassert_always(getPending() == 0) ; //should not start accessing the texture cache before initialized.
 	openFastCache(true);
@@ -1180,10 +1207,10 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 {
 	S32 idx = -1;
 	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
+	LLTextureCacheIndex::Record record;
+	if (mHeaderIndex.find(id, record))
 	{
-		idx = iter1->second;
+		idx = record.mEntry;
 	}
 
 	if (idx < 0)
@@ -1194,7 +1221,7 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			{
 				// Add an entry to the end of the list
 				idx = mHeaderEntriesInfo.mEntries++;
-
+				updateStampOnRead();
 			}
 			else if (!mFreeList.empty())
 			{
@@ -1211,10 +1238,10 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 					// Erase entry from LRU regardless
 					mLRU.erase(curiter2);
 					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+					LLTextureCacheIndex::Record old_record;
+					if (mHeaderIndex.find(oldid, old_record))
 					{
-						idx = iter3->second;
+						idx = old_record.mEntry;
 						removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
 						break;
 					}
@@ -1245,6 +1272,13 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 		{
 			readEntryFromHeaderImmediately(idx, entry) ;
 		}
+		if(idx >= 0 && entry.mID != id)
+		{
+			// The index is stale, texture.entries has since given this slot to another texture
+			LL_WARNS() << "Texture cache index entry " << idx << " for " << id << " holds " << entry.mID << LL_ENDL;
+			mHeaderIndex.erase(id);
+			return openAndReadEntry(id, entry, create);
+		}
 		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 		{
 			LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL ;
@@ -1314,9 +1348,7 @@ void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
 //update an existing entry time stamp, delay writing.
 void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 {
-	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
-
-	if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
+	if(!mStampOnRead)
 	{
 		return ; //there are enough empty entry index space, no need to stamp time.
 	}
@@ -1331,6 +1363,14 @@ void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 	}
 }
 
+//mHeaderMutex is locked before calling this.
+void LLTextureCache::updateStampOnRead()
+{
+	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
+
+	mStampOnRead = mHeaderEntriesInfo.mEntries >= MAX_ENTRIES_WITHOUT_TIME_STAMP;
+}
+
 //update an existing entry, write to header file immediately.
 bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_data_size)
 {
@@ -1349,8 +1389,6 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		bool update_header = false ;
 		if(entry.mImageSize < 0) //is a brand-new entry
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = new_body_size ;
 			mTexturesSizeTotal += new_body_size ;
 			
 			// Update Header
@@ -1358,8 +1396,7 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		}				
 		else if (entry.mBodySize != new_body_size)
 		{
-			//already in mHeaderIDMap.
-			mTexturesSizeMap[entry.mID] = new_body_size ;
+			//already in mHeaderIndex.
 			mTexturesSizeTotal -= entry.mBodySize ;
 			mTexturesSizeTotal += new_body_size ;
 		}
@@ -1368,6 +1405,10 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		entry.mBodySize = new_body_size ;
 		
 		writeEntryToHeaderImmediately(idx, entry, update_header) ;
+		if (idx >= 0)
+		{
+			mHeaderIndex.insert(entry.mID, LLTextureCacheIndex::Record(idx, new_image_size, new_body_size));
+		}
 	
 		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 		{
@@ -1389,8 +1430,7 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 {
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
+	mHeaderIndex.clear();
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 
@@ -1424,8 +1464,7 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 // 		LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
 		if(entry.mImageSize > entry.mBodySize)
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = entry.mBodySize;
+			mHeaderIndex.insert(entry.mID, LLTextureCacheIndex::Record(idx, entry.mImageSize, entry.mBodySize));
 			mTexturesSizeTotal += entry.mBodySize;
 		}
 		else
@@ -1507,8 +1546,37 @@ void LLTextureCache::updatedHeaderEntriesFile()
 }
 //----------------------------------------------------------------------------
 
+//Size and modification time of texture.entries, changed by anything that rewrites it,
+//including another viewer or an older one sharing the cache.
+U64 LLTextureCache::getEntriesStamp() const
+{
+	llstat file_status;
+	if (LLFile::stat(mHeaderEntriesFileName, &file_status) != 0)
+	{
+		return 0;
+	}
+	return ((U64)file_status.st_mtime << 32) ^ (U64)file_status.st_size;
+}
+
+//mHeaderMutex is locked before calling this.
+//Returns true if the index on disk matches texture.entries and can be used as is.
+bool LLTextureCache::openHeaderIndex(bool reuse)
+{
+	if (!mHeaderIndex.isOpen())
+	{
+		mHeaderIndex.open(mHeaderIndexFileName, sCacheMaxEntries, mReadOnly);
+	}
+	if (reuse && mHeaderIndex.isValidFor(mHeaderEntriesInfo.mEntries, getEntriesStamp()))
+	{
+		return true;
+	}
+	mHeaderIndex.clear();
+	return false;
+}
+
 // Called from either the main thread or the worker thread
-void LLTextureCache::readHeaderCache()
+// use_index: trust a clean index from the last session instead of reading every entry
+void LLTextureCache::readHeaderCache(bool use_index)
 {
 	mHeaderMutex.lock();
 
@@ -1520,11 +1588,24 @@ void LLTextureCache::readHeaderCache()
 		|| mHeaderEntriesInfo.mAdressSize != sHeaderCacheAddressSize
 		|| strcmp(mHeaderEntriesInfo.mEncoderVersion, sHeaderCacheEncoderVersion.c_str()) != 0)
 	{
+		if (use_index)
+		{
+			// Still starting up, nobody can be reading the index yet so let the purge delete it
+			mHeaderIndex.close();
+		}
 		if (!mReadOnly)
 		{
 			LL_INFOS() << "Texture Cache version mismatch, Purging." << LL_ENDL;
 			purgeAllTextures(false);
 		}
+		openHeaderIndex(false);
+	}
+	else if (openHeaderIndex(use_index))
+	{
+		// The LRU and free list are rebuilt from the entries the first time we run out of room
+		mTexturesSizeTotal = mHeaderIndex.getBodySizeTotal();
+		LL_INFOS("TextureCache") << "Texture Cache index reused, entries: " << mHeaderEntriesInfo.mEntries
+								 << " size: " << mTexturesSizeTotal / (1024 * 1024) << " MB" << LL_ENDL;
 	}
 	else
 	{
@@ -1619,6 +1700,7 @@ void LLTextureCache::readHeaderCache()
 			}
 		}
 	}
+	updateStampOnRead();
 	mHeaderMutex.unlock();
 }
 
@@ -1673,8 +1755,9 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
+	// Readers may be looking up the index without the lock, clear it in place rather than unmapping it.
+	// The file itself was just deleted with the headers, it is recreated on the next start.
+	mHeaderIndex.clear();
 	mTexturesSizeTotal = 0;
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
@@ -1683,6 +1766,7 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 	// Info with 0 entries
 	setEntriesHeader();
 	writeEntriesHeader();
+	updateStampOnRead();
 
 	LL_INFOS() << "The entire texture cache is cleared." << LL_ENDL ;
 }
@@ -1712,24 +1796,17 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
 			return; // nothing to purge
 		}
 
-		// Use mTexturesSizeMap to collect UUIDs of textures with bodies
+		// Use mHeaderIndex to collect entries of textures with bodies
 		typedef std::set<std::pair<U32, S32> > time_idx_set_t;
 		std::set<std::pair<U32, S32> > time_idx_set;
-		for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-			iter1 != mTexturesSizeMap.end(); ++iter1)
+		LLTextureCacheIndex::Record record;
+		for (U32 idx = 0; idx < num_entries; ++idx)
 		{
-			if (iter1->second > 0)
+			if (entries[idx].mBodySize > 0
+				&& mHeaderIndex.find(entries[idx].mID, record)
+				&& record.mEntry == (S32)idx)
 			{
-				id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-				if (iter2 != mHeaderIDMap.end())
-				{
-					S32 idx = iter2->second;
-					time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-				}
-				else
-				{
-					LL_ERRS("TextureCache") << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL;
-				}
+				time_idx_set.insert(std::make_pair(entries[idx].mTime, (S32)idx));
 			}
 		}
 
@@ -1761,8 +1838,8 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
 			Entry entry = mPurgeEntryList.back().second;
 			mPurgeEntryList.pop_back();
 			// make sure record is still valid
-			id_map_t::iterator iter_header = mHeaderIDMap.find(entry.mID);
-			if (iter_header != mHeaderIDMap.end() && iter_header->second == idx)
+			LLTextureCacheIndex::Record record;
+			if (mHeaderIndex.find(entry.mID, record) && record.mEntry == idx)
 			{
 				std::string tex_filename = getTextureFileName(entry.mID);
 				removeEntry(idx, entry, tex_filename);
@@ -1797,24 +1874,18 @@ void LLTextureCache::purgeTextures(bool validate)
 		return; // nothing to purge
 	}
 	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
+	// Use mHeaderIndex to collect entries of textures with bodies
 	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
 	std::set<std::pair<U32,S32> > time_idx_set;
-	for (auto& iter1 : mTexturesSizeMap)
-    {
-		if (iter1.second > 0)
+	LLTextureCacheIndex::Record record;
+	for (U32 idx = 0; idx < num_entries; ++idx)
+	{
+		if (entries[idx].mBodySize > 0
+			&& mHeaderIndex.find(entries[idx].mID, record)
+			&& record.mEntry == (S32)idx)
 		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1.first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.emplace(entries[idx].mTime, idx);
-// 				LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
-			}
-			else
-			{
-				LL_ERRS() << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL ;
-			}
+			time_idx_set.emplace(entries[idx].mTime, (S32)idx);
+// 			LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
 		}
 	}
 	
@@ -1916,6 +1987,24 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 // Reads imagesize from the header, updates timestamp
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
+	if (!mStampOnRead)
+	{
+		// Nothing to write back, the index has everything a reader needs
+		LLTextureCacheIndex::Record record;
+		Entry stored;
+		if (mHeaderIndex.find(id, record) && record.mImageSize > record.mBodySize
+			// Only trust the slot while texture.entries still has this texture in it
+			&& LLAPRFile::readEx(mHeaderEntriesFileName, (void*)&stored, sizeof(EntriesInfo) + record.mEntry * sizeof(Entry), sizeof(Entry)) == sizeof(Entry)
+			&& stored.mID == id)
+		{
+			entry.mID = id;
+			entry.mImageSize = record.mImageSize;
+			entry.mBodySize = record.mBodySize;
+			entry.mTime = 0;
+			return record.mEntry;
+		}
+	}
+
 	LLMutexLock lock(&mHeaderMutex);	
 	S32 idx = openAndReadEntry(id, entry, false);
 	if (idx >= 0)
@@ -2056,14 +2145,13 @@ LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& d
 {
 	U32 offset;
 	{
-		LLMutexLock lock(&mHeaderMutex);
-		id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-		if(iter == mHeaderIDMap.end())
+		LLTextureCacheIndex::Record record;
+		if(!mHeaderIndex.find(id, record))
 		{
 			return NULL; //not in the cache
 		}
 
-		offset = iter->second;
+		offset = record.mEntry;
 	}
 	offset *= TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
@@ -2289,12 +2377,12 @@ void LLTextureCache::addCompleted(Responder* responder, bool success)
 //called after mHeaderMutex is locked.
 void LLTextureCache::removeCachedTexture(const LLUUID& id)
 {
-	if(mTexturesSizeMap.find(id) != mTexturesSizeMap.end())
+	LLTextureCacheIndex::Record record;
+	if(mHeaderIndex.find(id, record))
 	{
-		mTexturesSizeTotal -= mTexturesSizeMap[id] ;
-		mTexturesSizeMap.erase(id);
+		mTexturesSizeTotal -= record.mBodySize ;
+		mHeaderIndex.erase(id);
 	}
-	mHeaderIDMap.erase(id);
 	// We are inside header's mutex so mHeaderAPRFilePoolp is safe to use,
 	// but getLocalAPRFilePool() is not safe, it might be in use by worker
 	LLAPRFile::remove(getTextureFileName(id), mHeaderAPRFilePoolp);
@@ -2325,8 +2413,7 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
-		mTexturesSizeMap.erase(entry.mID);		
+		mHeaderIndex.erase(entry.mID);
 		mFreeList.insert(idx);	
 	}
 
@@ -31,6 +31,7 @@
 #include "lluuid.h"
 
 #include "llworkerthread.h"
+#include "lltexturecacheindex.h"
 
 class LLImageFormatted;
 class LLTextureCacheWorker;
@@ -149,7 +150,10 @@ protected:
 
 private:
 	void setDirNames(ELLPath location);
-	void readHeaderCache();
+	void readHeaderCache(bool use_index = false);
+	bool openHeaderIndex(bool reuse);
+	U64 getEntriesStamp() const;
+	void updateStampOnRead();
 	void clearCorruptedCache();
 	void purgeAllTextures(bool purge_directories);
 	void purgeTexturesLazy(F32 time_limit_sec);
@@ -214,8 +218,10 @@ private:
 	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
 	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID, S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	// UUID -> entry index and sizes, lock free for readers, written under mHeaderMutex
+	std::string mHeaderIndexFileName;
+	LLTextureCacheIndex mHeaderIndex;
+	LLAtomicBool mStampOnRead; // entries are filling up, reads must update time stamps under the header mutex
 
 	LLAPRFile*   mFastCachep;
 	LLFrameTimer mFastCacheTimer;
@@ -223,8 +229,6 @@ private:
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomicBool mDoPurge;
 
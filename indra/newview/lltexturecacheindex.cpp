@@ -0,0 +1,406 @@
+/**
+ * @file lltexturecacheindex.cpp
+ * @brief Memory mapped UUID index for the texture cache headers
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturecacheindex.h"
+
+#include <cerrno>
+#include <thread>
+
+static const U32 INDEX_MAGIC = 0x58494354; // "TCIX"
+static const U32 INDEX_VERSION = 2;
+static const U32 INDEX_MIN_CAPACITY = 1024;
+
+static_assert(std::atomic<U32>::is_always_lock_free, "texture cache index needs lock free 32 bit atomics");
+
+LLTextureCacheIndex::LLTextureCacheIndex()
+:	mHeader(nullptr),
+	mSlots(nullptr),
+	mMask(0),
+	mReadOnly(true)
+{
+	static_assert(sizeof(Header) == 64, "texture cache index header layout changed");
+	static_assert(sizeof(Slot) == 32, "texture cache index slot layout changed");
+}
+
+LLTextureCacheIndex::~LLTextureCacheIndex()
+{
+	close();
+}
+
+bool LLTextureCacheIndex::open(const std::string& filename, U32 max_entries, bool read_only)
+{
+	close();
+	mReadOnly = read_only;
+
+	// Keep the load factor under 2/3 so probe chains stay short
+	U32 capacity = INDEX_MIN_CAPACITY;
+	while (capacity < max_entries + max_entries / 2)
+	{
+		capacity <<= 1;
+	}
+	const size_t file_size = sizeof(Header) + (size_t)capacity * sizeof(Slot);
+
+	bool mapped = read_only ? mFile.open(filename, LLMappedFile::COPY_ON_WRITE)
+							: mFile.open(filename, LLMappedFile::READ_WRITE, file_size);
+	if (mapped)
+	{
+		const Header* header = mFile.getAs<Header>();
+		if (header
+			&& header->mMagic == INDEX_MAGIC
+			&& header->mVersion == INDEX_VERSION
+			&& header->mCapacity == capacity
+			&& mFile.size() == file_size)
+		{
+			mHeader = mFile.getAs<Header>();
+			mSlots = reinterpret_cast<Slot*>(mFile.data() + sizeof(Header));
+			mMask = capacity - 1;
+			return true;
+		}
+		mFile.close();
+	}
+
+	// Missing, from an older version or sized for another cache size: start over
+	return initialize(read_only ? LLStringUtil::null : filename, capacity);
+}
+
+bool LLTextureCacheIndex::initialize(const std::string& filename, U32 capacity)
+{
+	const size_t file_size = sizeof(Header) + (size_t)capacity * sizeof(Slot);
+
+	bool needs_zero = false;
+	bool mapped = false;
+	if (!filename.empty())
+	{
+		// Removing the file gives us a zero filled (and sparse where supported) replacement
+		needs_zero = LLFile::isfile(filename) && LLFile::remove(filename, ENOENT) != 0;
+		mapped = mFile.open(filename, LLMappedFile::READ_WRITE, file_size);
+		if (mapped && mFile.size() != file_size)
+		{
+			mapped = mFile.resize(file_size);
+		}
+	}
+	if (!mapped)
+	{
+		// Keep a working index for this session even if it can't be persisted
+		needs_zero = false;
+		mapped = mFile.open(LLStringUtil::null, LLMappedFile::READ_WRITE, file_size);
+		if (!mapped)
+		{
+			LL_WARNS("TextureCache") << "Unable to allocate texture cache index" << LL_ENDL;
+			return false;
+		}
+	}
+	if (needs_zero)
+	{
+		memset(mFile.data(), 0, file_size);
+	}
+
+	mHeader = mFile.getAs<Header>();
+	memset((void*)mHeader, 0, sizeof(Header));
+	mHeader->mMagic = INDEX_MAGIC;
+	mHeader->mVersion = INDEX_VERSION;
+	mHeader->mCapacity = capacity;
+	mSlots = reinterpret_cast<Slot*>(mFile.data() + sizeof(Header));
+	mMask = capacity - 1;
+	return true;
+}
+
+void LLTextureCacheIndex::close()
+{
+	if (mHeader && !mReadOnly)
+	{
+		mFile.flush(true);
+	}
+	mFile.close();
+	mHeader = nullptr;
+	mSlots = nullptr;
+	mMask = 0;
+}
+
+bool LLTextureCacheIndex::isValidFor(U32 num_entries, U64 entries_stamp) const
+{
+	return mHeader && mHeader->mClean && mHeader->mEntries == num_entries && mHeader->mEntriesStamp == entries_stamp;
+}
+
+void LLTextureCacheIndex::markClean(U32 num_entries, U64 entries_stamp, S64 body_size_total)
+{
+	if (!mHeader)
+	{
+		return;
+	}
+	mHeader->mEntries = num_entries;
+	mHeader->mEntriesStamp = entries_stamp;
+	mHeader->mBodySizeTotal = body_size_total;
+	mHeader->mClean = 1;
+	if (!mReadOnly)
+	{
+		mFile.flush();
+	}
+}
+
+void LLTextureCacheIndex::markDirty()
+{
+	if (mHeader && mHeader->mClean)
+	{
+		mHeader->mClean = 0;
+		if (!mReadOnly)
+		{
+			// Make sure the flag is out before any slot it no longer vouches for
+			mFile.flush(true);
+		}
+	}
+}
+
+//static
+U32 LLTextureCacheIndex::hashID(const LLUUID& id)
+{
+	// Must be stable across sessions, so no std::hash / absl::Hash here
+	U64 lo, hi;
+	memcpy(&lo, id.mData, sizeof(U64));
+	memcpy(&hi, id.mData + sizeof(U64), sizeof(U64));
+	U64 h = lo ^ (hi * 0x9E3779B97F4A7C15ULL);
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return (U32)h;
+}
+
+// Returns false at the end of a probe chain
+//static
+bool LLTextureCacheIndex::readSlot(const Slot& slot, LLUUID& id, Record& record)
+{
+	while (true)
+	{
+		const U32 before = slot.mSequence.load(std::memory_order_acquire);
+		if (before == 0)
+		{
+			return false;
+		}
+		if (before & 1)
+		{
+			// Writer is mid update, it only copies a few words
+			std::this_thread::yield();
+			continue;
+		}
+		id = slot.mID;
+		record.mEntry = slot.mEntry;
+		record.mImageSize = slot.mImageSize;
+		record.mBodySize = slot.mBodySize;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.mSequence.load(std::memory_order_relaxed) == before)
+		{
+			break;
+		}
+	}
+	return record.mEntry != EMPTY;
+}
+
+//static
+void LLTextureCacheIndex::writeSlot(Slot& slot, const LLUUID& id, const Record& record)
+{
+	const U32 sequence = slot.mSequence.load(std::memory_order_relaxed);
+	slot.mSequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.mID = id;
+	slot.mEntry = record.mEntry;
+	slot.mImageSize = record.mImageSize;
+	slot.mBodySize = record.mBodySize;
+	slot.mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool LLTextureCacheIndex::find(const LLUUID& id, Record& record) const
+{
+	if (!mSlots)
+	{
+		return false;
+	}
+
+	U32 pos = hashID(id) & mMask;
+	for (U32 probe = 0; probe <= mMask; ++probe, pos = (pos + 1) & mMask)
+	{
+		LLUUID slot_id;
+		Record slot_record;
+		if (!readSlot(mSlots[pos], slot_id, slot_record))
+		{
+			return false;
+		}
+		if (slot_id == id)
+		{
+			if (slot_record.mEntry < 0)
+			{
+				return false; // removed
+			}
+			record = slot_record;
+			return true;
+		}
+	}
+	return false;
+}
+
+void LLTextureCacheIndex::insert(const LLUUID& id, const Record& record)
+{
+	if (!mSlots)
+	{
+		return;
+	}
+	llassert(record.mEntry >= 0);
+
+	markDirty();
+
+	if (mHeader->mTombstones && (mHeader->mCount + mHeader->mTombstones + 1) * 4 > mHeader->mCapacity * 3)
+	{
+		// Too many tombstones, chains get long. Re-probe every live record.
+		rebuild();
+	}
+
+	Slot* free_slot = nullptr;
+	U32 pos = hashID(id) & mMask;
+	for (U32 probe = 0; probe <= mMask; ++probe, pos = (pos + 1) & mMask)
+	{
+		Slot& slot = mSlots[pos];
+		// Only the writer changes slots, plain reads are fine here
+		if (slot.mSequence.load(std::memory_order_relaxed) == 0 || slot.mEntry == EMPTY)
+		{
+			if (!free_slot)
+			{
+				free_slot = &slot;
+			}
+			break;
+		}
+		if (slot.mID == id)
+		{
+			if (slot.mEntry == TOMBSTONE)
+			{
+				mHeader->mTombstones--;
+				mHeader->mCount++;
+			}
+			writeSlot(slot, id, record);
+			return;
+		}
+		if (slot.mEntry == TOMBSTONE && !free_slot)
+		{
+			free_slot = &slot;
+		}
+	}
+
+	if (!free_slot)
+	{
+		LL_WARNS("TextureCache") << "Texture cache index full" << LL_ENDL;
+		return;
+	}
+	if (free_slot->mSequence.load(std::memory_order_relaxed) != 0 && free_slot->mEntry == TOMBSTONE)
+	{
+		mHeader->mTombstones--;
+	}
+	writeSlot(*free_slot, id, record);
+	mHeader->mCount++;
+}
+
+void LLTextureCacheIndex::erase(const LLUUID& id)
+{
+	if (!mSlots)
+	{
+		return;
+	}
+
+	U32 pos = hashID(id) & mMask;
+	for (U32 probe = 0; probe <= mMask; ++probe, pos = (pos + 1) & mMask)
+	{
+		Slot& slot = mSlots[pos];
+		if (slot.mSequence.load(std::memory_order_relaxed) == 0 || slot.mEntry == EMPTY)
+		{
+			return; // not indexed
+		}
+		if (slot.mID == id)
+		{
+			if (slot.mEntry != TOMBSTONE)
+			{
+				markDirty();
+				writeSlot(slot, id, Record(TOMBSTONE, 0, 0));
+				mHeader->mCount--;
+				mHeader->mTombstones++;
+			}
+			return;
+		}
+	}
+}
+
+void LLTextureCacheIndex::clear()
+{
+	if (!mSlots)
+	{
+		return;
+	}
+
+	markDirty();
+
+	// Sequences keep counting up so a lock free reader can never mistake
+	// a cleared and reused slot for the one it started reading
+	for (U32 pos = 0; pos <= mMask; ++pos)
+	{
+		Slot& slot = mSlots[pos];
+		if (slot.mSequence.load(std::memory_order_relaxed) != 0 && slot.mEntry != EMPTY)
+		{
+			writeSlot(slot, LLUUID::null, Record(EMPTY, 0, 0));
+		}
+	}
+	mHeader->mCount = 0;
+	mHeader->mTombstones = 0;
+	mHeader->mBodySizeTotal = 0;
+}
+
+void LLTextureCacheIndex::rebuild()
+{
+	std::vector<std::pair<LLUUID, Record> > live;
+	live.reserve(mHeader->mCount);
+	for (U32 pos = 0; pos <= mMask; ++pos)
+	{
+		const Slot& slot = mSlots[pos];
+		if (slot.mSequence.load(std::memory_order_relaxed) != 0 && slot.mEntry >= 0)
+		{
+			live.emplace_back(slot.mID, Record(slot.mEntry, slot.mImageSize, slot.mBodySize));
+		}
+	}
+
+	clear();
+	for (const auto& record : live)
+	{
+		insert(record.first, record.second);
+	}
+	LL_DEBUGS("TextureCache") << "Rebuilt texture cache index with " << live.size() << " records" << LL_ENDL;
+}
+
+U32 LLTextureCacheIndex::size() const
+{
+	return mHeader ? mHeader->mCount : 0;
+}
+
+S64 LLTextureCacheIndex::getBodySizeTotal() const
+{
+	return mHeader ? mHeader->mBodySizeTotal : 0;
+}
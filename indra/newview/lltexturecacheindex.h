@@ -0,0 +1,125 @@
+/**
+ * @file lltexturecacheindex.h
+ * @brief Memory mapped UUID index for the texture cache headers
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTURECACHEINDEX_H
+#define LL_LLTEXTURECACHEINDEX_H
+
+#include "llmappedfile.h"
+#include "lluuid.h"
+
+#include <atomic>
+
+// Open addressed, linear probed table of texture UUID -> texture.entries record,
+// stored in a memory mapped file so that it is usable as soon as it is mapped.
+//
+// Lookups are lock free and may run on any thread. Each slot is guarded by a
+// sequence counter (odd while being written), readers retry until they get a
+// consistent copy. Only one thread may modify the table at a time; the texture
+// cache does all modifications under its header mutex.
+//
+// Removed ids leave a tombstone so probe chains stay intact for lock free readers.
+// A miss is only authoritative when it is observed by the writer.
+class LLTextureCacheIndex
+{
+public:
+	struct Record
+	{
+		Record() : mEntry(-1), mImageSize(0), mBodySize(0) {}
+		Record(S32 entry, S32 image_size, S32 body_size)
+			: mEntry(entry), mImageSize(image_size), mBodySize(body_size) {}
+		S32 mEntry;		// index in texture.entries
+		S32 mImageSize;	// total size of image if known
+		S32 mBodySize;	// size of body file in body cache
+	};
+
+	LLTextureCacheIndex();
+	~LLTextureCacheIndex();
+
+	// Maps filename, creating or recreating it for max_entries if needed.
+	// When read_only is set the file is never written, changes stay in memory.
+	bool open(const std::string& filename, U32 max_entries, bool read_only);
+	void close();
+	bool isOpen() const { return mSlots != nullptr; }
+
+	// True if the index was last marked clean against an entries file holding num_entries
+	// records and stamped with entries_stamp, see LLTextureCache::getEntriesStamp()
+	bool isValidFor(U32 num_entries, U64 entries_stamp) const;
+	// Records that the index matches texture.entries. The next modification marks it dirty
+	// again, so a crash in between makes the next session rebuild it from texture.entries.
+	void markClean(U32 num_entries, U64 entries_stamp, S64 body_size_total);
+
+	// Any thread
+	bool find(const LLUUID& id, Record& record) const;
+
+	// Writer only
+	void insert(const LLUUID& id, const Record& record);
+	void erase(const LLUUID& id);
+	void clear();
+	U32 size() const;
+	S64 getBodySizeTotal() const;
+
+private:
+	struct Header
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mCapacity;		// number of slots, power of 2
+		U32 mCount;			// live records
+		U32 mTombstones;	// removed records still occupying a slot
+		U32 mEntries;		// texture.entries record count when marked clean
+		U32 mClean;			// 1 if consistent with texture.entries
+		U32 mPad;
+		S64 mBodySizeTotal;	// sum of body sizes when marked clean
+		U64 mEntriesStamp;	// texture.entries stamp when marked clean, catches other writers
+		U8 mReserved[16];
+	};
+
+	struct Slot
+	{
+		std::atomic<U32> mSequence;	// 0 = never used, odd = write in progress
+		S32 mEntry;					// TOMBSTONE for a removed id, EMPTY for a cleared slot
+		S32 mImageSize;
+		S32 mBodySize;
+		LLUUID mID;
+	};
+
+	enum { TOMBSTONE = -1, EMPTY = -2 };
+
+	static U32 hashID(const LLUUID& id);
+	static bool readSlot(const Slot& slot, LLUUID& id, Record& record);
+	static void writeSlot(Slot& slot, const LLUUID& id, const Record& record);
+	bool initialize(const std::string& filename, U32 capacity);
+	void markDirty();
+	void rebuild();
+
+	LLMappedFile mFile;
+	Header* mHeader;
+	Slot* mSlots;
+	U32 mMask;
+	bool mReadOnly;
+};
+
+#endif // LL_LLTEXTURECACHEINDEX_H
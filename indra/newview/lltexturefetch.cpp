@@ -365,6 +365,16 @@ private:
  				worker->callbackDecoded(success, raw, aux);
 			}
 		}
+
+		// Threads:  Tid
+		void preview(LLImageRaw* raw, S32 discard) override
+		{
+			LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
+			if (worker)
+			{
+				worker->callbackPreview(raw, discard);
+			}
+		}
 	private:
 		LLTextureFetch* mFetcher;
 		LLUUID mID;
@@ -414,6 +424,9 @@ public:
 
 	// Threads:  Tid
 	void callbackDecoded(bool success, LLImageRaw* raw, LLImageRaw* aux);
+
+	// Threads:  Tid
+	void callbackPreview(LLImageRaw* raw, S32 discard);
 	
 	// Threads:  T*
 	void setGetStatus(LLCore::HttpStatus status, const std::string& reason)
@@ -556,7 +569,8 @@ private:
 	LLTextureFetch* mFetcher;
 	LLPointer<LLImageFormatted> mFormattedImage;
 	LLPointer<LLImageRaw>       mRawImage,
-								mAuxImage;
+								mAuxImage,
+								mPreviewImage;			// coarser decode handed out while the full one runs
 	FTType mFTType;
 	LLUUID mID;
 	LLHost mHost;
@@ -570,6 +584,8 @@ private:
 	S32 mRequestedDiscard;
     S32 mLoadedDiscard;
     S32 mDecodedDiscard;
+	S32 mPreviewDiscard;
+	S32 mBestDecodedDiscard;	// over all passes of this worker, never reset by INIT
 	S32 mFullWidth;
 	S32 mFullHeight;
 	LLFrameTimer mRequestedDeltaTimer;
@@ -910,6 +926,8 @@ LLTextureFetchWorker::LLTextureFetchWorker(LLTextureFetch* fetcher,
 	  mRequestedDiscard(-1),
 	  mLoadedDiscard(-1),
 	  mDecodedDiscard(-1),
+	  mPreviewDiscard(-1),
+	  mBestDecodedDiscard(-1),
 	  mCacheReadTime(0.f),
 	  mDecodeTime(0.f),
       mFetchTime(0.f),
@@ -1180,9 +1198,11 @@ bool LLTextureFetchWorker::doWork(S32 param)
 	if (mState == INIT)
 	{		
 		mRawImage = NULL ;
+		mPreviewImage = NULL;
 		mRequestedDiscard = -1;
 		mLoadedDiscard = -1;
 		mDecodedDiscard = -1;
+		mPreviewDiscard = -1;
 		mRequestedSize = 0;
 		mRequestedOffset = 0;
 		mFileSize = 0;
@@ -1890,15 +1910,32 @@ bool LLTextureFetchWorker::doWork(S32 param)
 
 		mRawImage = NULL;
 		mAuxImage = NULL;
+		mPreviewImage = NULL;
+		mPreviewDiscard = -1;
 		llassert_always(mFormattedImage.notNull());
 		S32 discard = mHaveAllData ? 0 : mLoadedDiscard;
 		U32 image_priority = LLWorkerThread::PRIORITY_NORMAL | mWorkPriority;
+
+		// Ask the decoder for a coarser image first, so something shows while
+		// the full resolution decodes, unless we already handed out as much
+		static LLCachedControl<U32> preview_levels(gSavedSettings, "TextureDecodePreviewLevels", 2);
+		S32 preview_discard = -1;
+		if (preview_levels > 0 && !mNeedsAux)
+		{
+			preview_discard = llmin(discard + (S32)preview_levels, MAX_DISCARD_LEVEL);
+			if (preview_discard <= discard ||
+				(mBestDecodedDiscard >= 0 && preview_discard >= mBestDecodedDiscard))
+			{
+				preview_discard = -1;
+			}
+		}
+
 		mDecoded  = FALSE;
 		setState(DECODE_IMAGE_UPDATE);
 		LL_DEBUGS(LOG_TXT) << mID << ": Decoding. Bytes: " << mFormattedImage->getDataSize() << " Discard: " << discard
-						   << " All Data: " << mHaveAllData << LL_ENDL;
+						   << " Preview: " << preview_discard << " All Data: " << mHaveAllData << LL_ENDL;
 		mDecodeHandle = mFetcher->mImageDecodeThread->decodeImage(mFormattedImage, image_priority, discard, mNeedsAux,
-																  new DecodeResponder(mFetcher, mID, this));
+																  new DecodeResponder(mFetcher, mID, this), preview_discard);
 		// fall though
 	}
 	
@@ -2476,12 +2513,18 @@ void LLTextureFetchWorker::callbackDecoded(bool success, LLImageRaw* raw, LLImag
 	llassert_always(mFormattedImage.notNull());
 	
 	mDecodeHandle = 0;
+	mPreviewImage = NULL;
+	mPreviewDiscard = -1;
 	if (success)
 	{
 		llassert_always(raw);
 		mRawImage = raw;
 		mAuxImage = aux;
 		mDecodedDiscard = mFormattedImage->getDiscardLevel();
+		if (mBestDecodedDiscard < 0 || mDecodedDiscard < mBestDecodedDiscard)
+		{
+			mBestDecodedDiscard = mDecodedDiscard;
+		}
  		LL_DEBUGS(LOG_TXT) << mID << ": Decode Finished. Discard: " << mDecodedDiscard
 						   << " Raw Image: " << llformat("%dx%d",mRawImage->getWidth(),mRawImage->getHeight()) << LL_ENDL;
 	}
@@ -2497,6 +2540,20 @@ void LLTextureFetchWorker::callbackDecoded(bool success, LLImageRaw* raw, LLImag
 	mCacheReadTime = mCacheReadTimer.getElapsedTimeF32();
 }																		// -Mw
 
+// Threads:  Tid
+void LLTextureFetchWorker::callbackPreview(LLImageRaw* raw, S32 discard)
+{
+	LLMutexLock lock(&mWorkMutex);										// +Mw
+	if (mDecodeHandle == 0 || mState != DECODE_IMAGE_UPDATE)
+	{
+		return; // aborted or superseded, ignore
+	}
+	mPreviewImage = raw;
+	mPreviewDiscard = discard;
+	LL_DEBUGS(LOG_TXT) << mID << ": Preview decoded. Discard: " << mPreviewDiscard
+					   << " Raw Image: " << llformat("%dx%d",raw->getWidth(),raw->getHeight()) << LL_ENDL;
+}																		// -Mw
+
 //////////////////////////////////////////////////////////////////////////////
 
 // Threads:  Ttf
@@ -2988,6 +3045,15 @@ bool LLTextureFetch::getRequestFinished(const LLUUID& id, S32& discard_level,
 				raw = worker->mRawImage;
 				aux = worker->mAuxImage;
 			}
+			else if ((worker->mPreviewDiscard >= 0) &&
+					 (worker->mPreviewDiscard < discard_level || discard_level < 0) &&
+					 (worker->mState == LLTextureFetchWorker::DECODE_IMAGE_UPDATE))
+			{
+				// Still decoding, a coarser preview of it is ready
+				discard_level = worker->mPreviewDiscard;
+				raw = worker->mPreviewImage;
+				aux = NULL;
+			}
 			worker->unlockWorkMutex();									// -Mw
 		}
 	}
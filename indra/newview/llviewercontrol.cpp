@@ -31,6 +31,7 @@
 
 // Library includes
 #include "llwindow.h"	// getGamma()
+#include "llvolumemgr.h"
 
 // For Listeners
 #include "llaudioengine.h"
@@ -426,6 +427,12 @@ static bool handleResetVertexBuffersChanged(const LLSD&)
 	return true;
 }
 
+static bool handleAsyncVolumeGenerationChanged(const LLSD& newvalue)
+{
+	LLPrimitive::getVolumeManager()->setAsyncGeneration(newvalue.asBoolean(), &LLVOVolume::onVolumeGenerated);
+	return true;
+}
+
 static bool handleRepartition(const LLSD&)
 {
 	if (gPipeline.isInit())
@@ -785,6 +792,8 @@ void settings_setup_listeners()
 	gSavedSettings.getControl("RenderVBOMappingDisable")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderUseStreamVBO")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderPreferStreamDraw")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
+	gSavedSettings.getControl("RenderStreamRing")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
+	gSavedSettings.getControl("RenderAsyncVolumeGeneration")->getSignal()->connect(boost::bind(&handleAsyncVolumeGenerationChanged, _2));
 	gSavedSettings.getControl("WLSkyDetail")->getSignal()->connect(boost::bind(&handleWLSkyDetailChanged, _2));
 	gSavedSettings.getControl("JoystickAxis0")->getSignal()->connect(boost::bind(&handleJoystickChanged, _2));
 	gSavedSettings.getControl("JoystickAxis1")->getSignal()->connect(boost::bind(&handleJoystickChanged, _2));
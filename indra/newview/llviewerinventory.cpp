@@ -33,6 +33,7 @@
 #include "message.h"
 
 #include "llaisapi.h"
+#include "llinventorycache.h"
 #include "llagent.h"
 #include "llagentcamera.h"
 #include "llagentwearables.h"
@@ -561,6 +562,13 @@ bool LLViewerInventoryItem::importFileLocal(LLFILE* fp)
 	return rv;
 }
 
+bool LLViewerInventoryItem::importCache(const LLInventoryCacheReader& reader, U32 index)
+{
+	bool rv = reader.getItem(index, *this);
+	mIsComplete = false;
+	return rv;
+}
+
 bool LLViewerInventoryItem::exportFileLocal(LLFILE* fp) const
 {
 	std::string uuid_str;
@@ -872,6 +880,16 @@ bool LLViewerInventoryCategory::exportFileLocal(LLFILE* fp) const
 	return true;
 }
 
+void LLViewerInventoryCategory::exportCache(LLInventoryCacheWriter& writer) const
+{
+	writer.addCategory(*this, mOwnerID, mVersion);
+}
+
+bool LLViewerInventoryCategory::importCache(const LLInventoryCacheReader& reader, U32 index)
+{
+	return reader.getCategory(index, *this, mOwnerID, mVersion);
+}
+
 bool LLViewerInventoryCategory::acceptItem(LLInventoryItem* inv_item)
 {
     if (!inv_item)
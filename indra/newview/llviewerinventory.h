@@ -39,6 +39,8 @@ class LLFolderBridge;
 class LLViewerInventoryCategory;
 class LLInventoryCallback;
 class LLAvatarName;
+class LLInventoryCacheReader;
+class LLInventoryCacheWriter;
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // Class LLViewerInventoryItem
@@ -133,6 +135,7 @@ public:
 	// other than cacheing.
 	bool exportFileLocal(LLFILE* fp) const;
 	bool importFileLocal(LLFILE* fp);
+	bool importCache(const LLInventoryCacheReader& reader, U32 index);
 
 	// new methods
 	BOOL isFinished() const { return mIsComplete; }
@@ -225,6 +228,8 @@ public:
 	// other than caching.
 	bool exportFileLocal(LLFILE* fp) const;
 	bool importFileLocal(LLFILE* fp);
+	void exportCache(LLInventoryCacheWriter& writer) const;
+	bool importCache(const LLInventoryCacheReader& reader, U32 index);
 	void determineFolderType();
 	void changeType(LLFolderType::EType new_folder_type);
     void unpackMessage(LLMessageSystem* msg, const char* block, S32 block_num = 0) override;
@@ -191,6 +191,8 @@ static bool sForceUpdate = false;
 static LLUUID sOnlyAudibleTextureID = LLUUID::null;
 static F64 sLowestLoadableImplInterest = 0.0f;
 static bool sAnyMediaShowing = false;
+// Bytes of media texture left to upload this frame, -1 for no limit
+static S64 sMediaUploadBytesLeft = -1;
 
 //////////////////////////////////////////////////////////////////////////////////////////
 static void add_media_impl(LLViewerMediaImpl* media)
@@ -651,6 +653,15 @@ void LLViewerMedia::updateMedia(void *dummy_arg)
 	// Enable/disable the plugin read thread
 	static LLCachedControl<bool> pluginUseReadThread(gSavedSettings, "PluginUseReadThread");
 	LLPluginProcessParent::setUseReadThread(pluginUseReadThread);
+	// Binary messages to plugin processes, XML is easier to read in the plugin debug log
+	static LLCachedControl<bool> pluginBinaryMessages(gSavedSettings, "PluginBinaryMessages");
+	LLPluginProcessParent::setBinaryMessages(pluginBinaryMessages);
+	// Frame buffers shared with media plugins, so they can draw the next frame while we upload the last
+	static LLCachedControl<U32> pluginMediaFrameBuffers(gSavedSettings, "PluginMediaFrameBuffers");
+	LLPluginClassMedia::setFrameBuffers(pluginMediaFrameBuffers);
+	// Media texture uploads per frame, the highest priority media always gets to upload
+	static LLCachedControl<F32> mediaUploadBudgetMB(gSavedSettings, "MediaUploadBudgetMB");
+	sMediaUploadBytesLeft = (mediaUploadBudgetMB > 0.f) ? (S64)(mediaUploadBudgetMB * 1024.f * 1024.f) : -1;
 
 	// HACK: we always try to keep a spare running webkit plugin around to improve launch times.
 	// 2017-04-19 Removed CP - this doesn't appear to buy us much and consumes a lot of resources so
@@ -2818,7 +2829,20 @@ void LLViewerMediaImpl::update()
 		// Since we're updating this texture, we know it's playing.  Tell the texture to do its replacement magic so it gets rendered.
 		placeholder_image->setPlaying(TRUE);
 
-		if(mMediaSource->getDirty(&dirty_rect))
+		// Media further down the list waits for a later frame once this frame's upload budget is spent,
+		// its dirty rects keep adding up meanwhile
+		if(sMediaUploadBytesLeft == 0)
+		{
+			return;
+		}
+
+		U8* data = nullptr;
+		{
+			LL_RECORD_BLOCK_TIME(FTM_MEDIA_GET_DATA);
+			data = mMediaSource->acquireFrame(dirty_rect);
+		}
+
+		if(data != NULL)
 		{
 			// Constrain the dirty rect to be inside the texture
 			S32 x_pos = llmax(dirty_rect.mLeft, 0);
@@ -2828,37 +2852,27 @@ void LLViewerMediaImpl::update()
 
 			if(width > 0 && height > 0)
 			{
-
-				U8* data = nullptr;
+				// Straight from the shared memory, setSubImage() finds the dirty rect in the frame itself
+				LL_RECORD_BLOCK_TIME(FTM_MEDIA_SET_SUBIMAGE);
+				placeholder_image->setSubImage(
+					data,
+					mMediaSource->getBitsWidth(),
+					mMediaSource->getBitsHeight(),
+					x_pos,
+					y_pos,
+					width,
+					height,
+					TRUE);
+
+				if(sMediaUploadBytesLeft > 0)
 				{
-					LL_RECORD_BLOCK_TIME(FTM_MEDIA_GET_DATA);
-					data = mMediaSource->getBitsData();
+					sMediaUploadBytesLeft = llmax(sMediaUploadBytesLeft - (S64)width * height * mMediaSource->getTextureDepth(), (S64)0);
 				}
-
-				if(data != NULL)
-				{
-					// Offset the pixels pointer to match x_pos and y_pos
-					data += ( x_pos * mMediaSource->getTextureDepth() * mMediaSource->getBitsWidth() );
-					data += ( y_pos * mMediaSource->getTextureDepth() );
-
-					{
-						LL_RECORD_BLOCK_TIME(FTM_MEDIA_SET_SUBIMAGE);
-									placeholder_image->setSubImage(
-									data,
-									mMediaSource->getBitsWidth(),
-									mMediaSource->getBitsHeight(),
-									x_pos,
-									y_pos,
-									width,
-									height,
-									TRUE);
-					}
-				}
-
 			}
-
-			mMediaSource->resetDirty();
 		}
+
+		// The plugin may draw into this frame again now
+		mMediaSource->releaseFrame();
 	}
 }
 
@@ -68,6 +68,8 @@
 #include "llviewertexturelist.h"
 #include "lldatapacker.h"
 #include "llcallstack.h"
+#include "llcontrolavatar.h"
+#include "lljobsystem.h"
 #ifdef LL_USESYSTEMLIBS
 #include <zlib.h>
 #else
@@ -865,6 +867,9 @@ void LLViewerObjectList::updateApparentAngles(LLAgent &agent)
 }
 
 static LLTrace::BlockTimerStatHandle FTM_IDLE_COPY("Idle Copy");
+static LLTrace::BlockTimerStatHandle FTM_AVATAR_POSES("Avatar Poses");
+
+static LLJobType sAnimateAvatarJobType("animate_avatar");
 
 void LLViewerObjectList::update(LLAgent &agent)
 {
@@ -969,12 +974,90 @@ void LLViewerObjectList::update(LLAgent &agent)
 	}
 	else
 	{
+		// Other avatars run idleUpdate() in three steps, so that their poses
+		// can be updated on the job system. Animated objects worn by an
+		// avatar follow its attachment point, so they wait for the avatar.
+		static std::vector<LLVOAvatar*> posed_avatars;
+		static std::vector<LLViewerObject*> attached_animesh;
+		posed_avatars.clear();
+		attached_animesh.clear();
+
 		for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
 			idle_iter != idle_end; idle_iter++)
 		{
 			objectp = *idle_iter;
 			llassert(objectp->isActive());
-                objectp->idleUpdate(agent, frame_time);
+			LLVOAvatar* avatarp = objectp->isAvatar() ? objectp->asAvatar() : nullptr;
+			if (!avatarp || avatarp->isSelf())
+			{
+				objectp->idleUpdate(agent, frame_time);
+			}
+			else if (avatarp->isControlAvatar() && ((LLControlAvatar*)avatarp)->mRootVolp
+					 && ((LLControlAvatar*)avatarp)->mRootVolp->isAttachment())
+			{
+				attached_animesh.push_back(objectp);
+			}
+			else if (avatarp->beginIdleUpdate(agent, frame_time))
+			{
+				posed_avatars.push_back(avatarp);
+			}
+		}
+
+		{
+			LL_RECORD_BLOCK_TIME(FTM_AVATAR_POSES);
+			static LLCachedControl<bool> parallel_animation(gSavedSettings, "AvatarParallelAnimation", true);
+			size_t first = 0;
+			if (parallel_animation && posed_avatars.size() > 1 && LLJobSystem::instanceExists())
+			{
+				// One job per avatar, the last one posed here
+				LLJobSystem::job_list_t jobs;
+				for (; first + 1 < posed_avatars.size(); ++first)
+				{
+					LLVOAvatar* avatarp = posed_avatars[first];
+					LLJobSystem::job_ptr_t job = LLJobSystem::getInstance()->submit(sAnimateAvatarJobType,
+						[avatarp]()
+						{
+							avatarp->updatePose();
+						}, LLJobSystem::PRIORITY_HIGH);
+					if (job.isNull())
+					{ // job system is shutting down
+						break;
+					}
+					jobs.push_back(job);
+				}
+				for (size_t i = first; i < posed_avatars.size(); ++i)
+				{
+					posed_avatars[i]->updatePose();
+				}
+				// Only runs animate_avatar jobs left in the queues, then blocks on the rest
+				for (const LLJobSystem::job_ptr_t& job : jobs)
+				{
+					LLJobSystem::getInstance()->wait(job);
+				}
+			}
+			else
+			{
+				for (LLVOAvatar* avatarp : posed_avatars)
+				{
+					avatarp->updatePose();
+				}
+			}
+		}
+
+		for (LLVOAvatar* avatarp : posed_avatars)
+		{
+			if (!avatarp->isDead())
+			{
+				avatarp->finishIdleUpdate();
+			}
+		}
+
+		for (LLViewerObject* animeshp : attached_animesh)
+		{
+			if (!animeshp->isDead())
+			{
+				animeshp->idleUpdate(agent, frame_time);
+			}
 		}
 
 		//update flexible objects
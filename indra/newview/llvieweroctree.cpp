@@ -1168,6 +1168,17 @@ void LLOcclusionCullingGroup::checkOcclusion()
 	}
 }
 
+bool LLOcclusionCullingGroup::needsOcclusionCheck()
+{
+	if (LLPipeline::sUseOcclusion <= 1)
+	{
+		return false;
+	}
+	LLOcclusionCullingGroup* parent = (LLOcclusionCullingGroup*)getParent();
+	return (parent && parent->isOcclusionState(LLOcclusionCullingGroup::OCCLUDED))
+		|| isOcclusionState(QUERY_PENDING | LLOcclusionCullingGroup::OCCLUDED);
+}
+
 static LLTrace::BlockTimerStatHandle FTM_PUSH_OCCLUSION_VERTS("Push Occlusion");
 static LLTrace::BlockTimerStatHandle FTM_SET_OCCLUSION_STATE("Occlusion State");
 static LLTrace::BlockTimerStatHandle FTM_OCCLUSION_EARLY_FAIL("Occlusion Early Fail");
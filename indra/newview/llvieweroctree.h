@@ -301,6 +301,7 @@ public:
 	void setOcclusionState(U32 state, S32 mode = STATE_MODE_SINGLE);
 	void clearOcclusionState(U32 state, S32 mode = STATE_MODE_SINGLE);
 	void checkOcclusion(); //read back last occlusion query (if any)
+	bool needsOcclusionCheck(); //checkOcclusion() has something to do
 	void doOcclusion(LLCamera* camera, const LLVector4a* shift = nullptr); //issue occlusion query
 	BOOL isOcclusionState(U32 state) const	{ return mOcclusionState[LLViewerCamera::sCurCameraID] & state ? TRUE : FALSE; }
 	U32  getOcclusionState() const	{ return mOcclusionState[LLViewerCamera::sCurCameraID];}
@@ -42,9 +42,22 @@
 #include "llspatialpartition.h"
 #include "llvoavatarself.h"
 #include "llvovolume.h"
+#include "lljobsystem.h"
+
+#include <boost/pool/pool.hpp>
 
 const F32 PART_SIM_BOX_SIDE = 16.f;
 
+// Particles that need their source or the region before LLParticleKernel::update()
+// runs, or after it
+const U32 PART_PRE_PASS = LLParticleStore::FIRST_USER_FLAG;
+const U32 PART_POST_PASS = LLParticleStore::FIRST_USER_FLAG << 1;
+
+// About as many particles each job simulates, in whole groups
+const S32 PARTICLES_PER_JOB = 1024;
+
+static LLJobType sSimulateParticlesJobType("simulate_particles");
+
 //static
 S32 LLViewerPartSim::sMaxParticleCount = 0;
 S32 LLViewerPartSim::sParticleCount = 0;
@@ -54,7 +67,7 @@ F32 LLViewerPartSim::sParticleAdaptiveRate = 0.0625f;
 F32 LLViewerPartSim::sParticleBurstRate = 0.5f;
 
 //static
-const S32 LLViewerPartSim::MAX_PART_COUNT = 8192;
+const S32 LLViewerPartSim::MAX_PART_COUNT = LL_MAX_PARTICLE_COUNT;
 const F32 LLViewerPartSim::PART_THROTTLE_THRESHOLD = 0.9f;
 const F32 LLViewerPartSim::PART_ADAPT_RATE_MULT = 2.0f;
 
@@ -84,6 +97,28 @@ LLViewerPart::LLViewerPart() :
 	++LLViewerPartSim::sParticleCount2 ;
 }
 
+static boost::pool<>& get_part_pool()
+{
+	static boost::pool<> sPool(sizeof(LLViewerPart), 1024);
+	return sPool;
+}
+
+void* LLViewerPart::operator new(size_t size)
+{
+	llassert(size == sizeof(LLViewerPart));
+	void* ptr = get_part_pool().malloc();
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void LLViewerPart::operator delete(void* ptr)
+{
+	get_part_pool().free(ptr);
+}
+
 LLViewerPart::~LLViewerPart()
 {
 	if (mPartSourcep.notNull() && mPartSourcep->mLastPart == this)
@@ -188,6 +223,8 @@ LLViewerPartGroup::LLViewerPartGroup(const LLVector3 &center_agent, const F32 bo
 	}
 
 	mSkippedTime = 0.f;
+	mUpdateDt = 0.f;
+	mSimulatedCount = 0;
 
 	static U32 id_seed = 0;
 	mID = ++id_seed;
@@ -267,33 +304,111 @@ BOOL LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 	
 	mParticles.push_back(part);
 	part->mSkipOffset=mSkippedTime;
+	storePart(part, mStore.append());
 	LLViewerPartSim::incPartCount(1);
 	return TRUE;
 }
 
+void LLViewerPartGroup::storePart(const LLViewerPart* part, S32 index)
+{
+	typedef LLParticleStore S;
+
+	for (S32 k = 0; k < 3; ++k)
+	{
+		mStore.get((S::EComponent)(S::POS_X + k))[index] = part->mPosAgent.mV[k];
+		mStore.get((S::EComponent)(S::VEL_X + k))[index] = part->mVelocity.mV[k];
+		mStore.get((S::EComponent)(S::ACCEL_X + k))[index] = part->mAccel.mV[k];
+	}
+	mStore.get(S::AGE)[index] = part->mLastUpdateTime;
+	mStore.get(S::MAX_AGE)[index] = part->mMaxAge;
+	mStore.get(S::SKIP_OFFSET)[index] = part->mSkipOffset;
+	for (S32 k = 0; k < 4; ++k)
+	{
+		mStore.get((S::EComponent)(S::START_RED + k))[index] = part->mStartColor.mV[k];
+		mStore.get((S::EComponent)(S::END_RED + k))[index] = part->mEndColor.mV[k];
+		mStore.get((S::EComponent)(S::RED + k))[index] = part->mColor.mV[k];
+	}
+	for (S32 k = 0; k < 2; ++k)
+	{
+		mStore.get((S::EComponent)(S::START_SCALE_X + k))[index] = part->mStartScale.mV[k];
+		mStore.get((S::EComponent)(S::END_SCALE_X + k))[index] = part->mEndScale.mV[k];
+		mStore.get((S::EComponent)(S::SCALE_X + k))[index] = part->mScale.mV[k];
+	}
+	mStore.get(S::START_GLOW)[index] = part->mStartGlow;
+	mStore.get(S::END_GLOW)[index] = part->mEndGlow;
+	mStore.get(S::GLOW)[index] = part->mGlow.mV[3] / 255.f;
+
+	U32 flags = 0;
+	if (!(part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK))
+	{
+		flags |= S::INTEGRATE;
+	}
+	if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+	{
+		flags |= S::INTERP_COLOR;
+	}
+	if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+	{
+		flags |= S::INTERP_SCALE;
+	}
+	if (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags)
+	{
+		flags |= S::KILLED;
+	}
+	if (part->mVPCallback || (part->mFlags & (LLPartData::LL_PART_FOLLOW_SRC_MASK | LLPartData::LL_PART_WIND_MASK |
+											  LLPartData::LL_PART_TARGET_POS_MASK | LLPartData::LL_PART_TARGET_LINEAR_MASK)))
+	{
+		flags |= PART_PRE_PASS;
+	}
+	if (part->mFlags & (LLPartData::LL_PART_BOUNCE_MASK | LLPartData::LL_PART_FOLLOW_SRC_MASK))
+	{
+		flags |= PART_POST_PASS;
+	}
+	mStore.getFlags()[index] = flags;
+}
+
 
 void LLViewerPartGroup::updateParticles(const F32 lastdt)
 {
-	F32 dt;
-	
-	LLVector3 gravity(0.f, 0.f, GRAVITY);
+	prepareUpdate(lastdt);
+	simulate();
+	finishUpdate();
+}
 
+void LLViewerPartGroup::prepareUpdate(const F32 lastdt)
+{
 	LLViewerPartSim::checkParticleCount(mParticles.size());
 
-	LLViewerCamera* camera = LLViewerCamera::getInstance();
-	LLViewerRegion *regionp = getRegion();
-	S32 end = (S32) mParticles.size();
-	for (S32 i = 0 ; i < (S32)mParticles.size();)
+	mUpdateDt = lastdt + mSkippedTime;
+	mSkippedTime = 0.f;
+	mSimulatedCount = getCount();
+	mResults.resize((mSimulatedCount + 3) & ~3);
+
+	const LLVector3& camera = LLViewerCamera::getInstance()->getOrigin();
+	for (S32 k = 0; k < 3; ++k)
 	{
-		LLVector3 a(0.f, 0.f, 0.f);
-		LLViewerPart* part = mParticles[i] ;
+		mBounds.mMin[k] = mMinObjPos.mV[k];
+		mBounds.mMax[k] = mMaxObjPos.mV[k];
+		mBounds.mCamera[k] = camera.mV[k];
+	}
+	mBounds.mMinSize = mBoxRadius*0.5f;
+	mBounds.mMaxSize = mBoxRadius*2.f;
+	mBounds.mSizeLimit = PART_SIM_BOX_SIDE*2;
 
-		dt = lastdt + mSkippedTime - part->mSkipOffset;
-		part->mSkipOffset = 0.f;
+	// Whatever follows the source or the wind, the kernel does the rest
+	typedef LLParticleStore S;
+	U32* flags = mStore.getFlags();
+	LLViewerRegion *regionp = getRegion();
+	for (S32 i = 0; i < mSimulatedCount; i++)
+	{
+		if (!(flags[i] & PART_PRE_PASS))
+		{
+			continue;
+		}
 
-		// Update current time
-		const F32 cur_time = part->mLastUpdateTime + dt;
-		const F32 frac = cur_time / part->mMaxAge;
+		LLViewerPart* part = mParticles[i];
+		const F32 dt = mUpdateDt - part->mSkipOffset;
+		const F32 frac = (part->mLastUpdateTime + dt) / part->mMaxAge;
 
 		// "Drift" the object based on the source object
 		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
@@ -332,7 +447,7 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 			part->mVelocity += step*delta_pos;
 		}
 
-
+		// The kernel leaves these alone
 		if (part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
 		{
 			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPartSourcep->mPosAgent;			
@@ -340,13 +455,58 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 			part->mPosAgent += frac*delta_pos;
 			part->mVelocity = delta_pos;
 		}
-		else
+
+		for (S32 k = 0; k < 3; ++k)
+		{
+			mStore.get((S::EComponent)(S::POS_X + k))[i] = part->mPosAgent.mV[k];
+			mStore.get((S::EComponent)(S::VEL_X + k))[i] = part->mVelocity.mV[k];
+		}
+		if (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags)
 		{
-			// Do velocity interpolation
-			part->mPosAgent += dt*part->mVelocity;
-			part->mPosAgent += 0.5f*dt*dt*part->mAccel;
-			part->mVelocity += part->mAccel*dt;
+			flags[i] |= S::KILLED;
 		}
+	}
+}
+
+void LLViewerPartGroup::simulate()
+{
+	llassert(mStore.size() == mSimulatedCount);
+	LLParticleKernel::update(mStore, mUpdateDt, mBounds, mResults.data());
+
+	// Copied back for rendering, ribbons and the particle callbacks
+	typedef LLParticleStore S;
+	const F32* pos[3] = { mStore.get(S::POS_X), mStore.get(S::POS_Y), mStore.get(S::POS_Z) };
+	const F32* vel[3] = { mStore.get(S::VEL_X), mStore.get(S::VEL_Y), mStore.get(S::VEL_Z) };
+	const F32* color[4] = { mStore.get(S::RED), mStore.get(S::GREEN), mStore.get(S::BLUE), mStore.get(S::ALPHA) };
+	const F32* scale[2] = { mStore.get(S::SCALE_X), mStore.get(S::SCALE_Y) };
+	const F32* glow = mStore.get(S::GLOW);
+	const F32* age = mStore.get(S::AGE);
+	for (S32 i = 0; i < mSimulatedCount; i++)
+	{
+		LLViewerPart* part = mParticles[i];
+		part->mPosAgent.set(pos[0][i], pos[1][i], pos[2][i]);
+		part->mVelocity.set(vel[0][i], vel[1][i], vel[2][i]);
+		part->mColor.set(color[0][i], color[1][i], color[2][i], color[3][i]);
+		part->mScale.set(scale[0][i], scale[1][i]);
+		part->mGlow.mV[3] = (U8) ll_round(glow[i]*255.f);
+		part->mLastUpdateTime = age[i];
+		part->mSkipOffset = 0.f;
+	}
+}
+
+void LLViewerPartGroup::finishUpdate()
+{
+	typedef LLParticleStore S;
+	LLViewerCamera* camera = LLViewerCamera::getInstance();
+	const U32* flags = mStore.getFlags();
+	for (S32 i = 0; i < mSimulatedCount; i++)
+	{
+		if (!(flags[i] & PART_POST_PASS))
+		{
+			continue;
+		}
+
+		LLViewerPart* part = mParticles[i];
 
 		// Do a bounce test
 		if (part->mFlags & LLPartData::LL_PART_BOUNCE_MASK)
@@ -358,10 +518,11 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 			{
 				part->mPosAgent.mV[VZ] += -2.f*dz;
 				part->mVelocity.mV[VZ] *= -0.75f;
+				mStore.get(S::POS_Z)[i] = part->mPosAgent.mV[VZ];
+				mStore.get(S::VEL_Z)[i] = part->mVelocity.mV[VZ];
 			}
 		}
 
-
 		// Reset the offset from the source position
 		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
 		{
@@ -369,55 +530,41 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 			part->mPosOffset -= part->mPartSourcep->mPosAgent;
 		}
 
-		// Do color interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+		if (!(mResults[i] & LLParticleKernel::EXPIRED))
 		{
-			part->mColor.setVec(part->mStartColor);
-			// note: LLColor4's v%k means multiply-alpha-only,
-			//       LLColor4's v*k means multiply-rgb-only
-			part->mColor *= 1.f - frac; // rgb*k
-			part->mColor %= 1.f - frac; // alpha*k
-			part->mColor += frac%(frac*part->mEndColor); // rgb,alpha
+			F32 desired_size = calc_desired_size(camera, part->mPosAgent, part->mScale);
+			mResults[i] = posInGroup(part->mPosAgent, desired_size) ? 0 : LLParticleKernel::OUTSIDE;
 		}
+	}
 
-		// Do scale interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+	// Backwards, so that removing a particle only moves one already looked at,
+	// or one another group handed over meanwhile
+	S32 removed = 0;
+	for (S32 i = mSimulatedCount - 1; i >= 0; i--)
+	{
+		if (!mResults[i])
 		{
-			part->mScale.setVec(part->mStartScale);
-			part->mScale *= 1.f - frac;
-			part->mScale += frac*part->mEndScale;
+			continue;
 		}
 
-		// Do glow interpolation
-		part->mGlow.mV[3] = (U8) ll_round(lerp(part->mStartGlow, part->mEndGlow, frac)*255.f);
-
-		// Set the last update time to now.
-		part->mLastUpdateTime = cur_time;
-
+		LLViewerPart* part = mParticles[i];
+		vector_replace_with_last(mParticles, mParticles.begin() + i);
+		mStore.remove(i);
+		removed++;
 
 		// Kill dead particles (either flagged dead, or too old)
-		if ((part->mLastUpdateTime > part->mMaxAge) || (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags))
+		if (mResults[i] & LLParticleKernel::EXPIRED)
 		{
-			vector_replace_with_last(mParticles, mParticles.begin() + i);
 			delete part ;
 		}
-		else 
+		else
 		{
-			F32 desired_size = calc_desired_size(camera, part->mPosAgent, part->mScale);
-			if (!posInGroup(part->mPosAgent, desired_size))
-			{
-				// Transfer particles between groups
-				LLViewerPartSim::getInstance()->put(part) ;
-				vector_replace_with_last(mParticles, mParticles.begin() + i);
-			}
-			else
-			{
-				i++ ;
-			}
+			// Transfer particles between groups
+			LLViewerPartSim::getInstance()->put(part) ;
 		}
 	}
+	mSimulatedCount = 0;
 
-	S32 removed = end - (S32)mParticles.size();
 	if (removed > 0)
 	{
 		// we removed one or more particles, so flag this group for update
@@ -449,15 +596,25 @@ void LLViewerPartGroup::shift(const LLVector3 &offset)
     {
         particle->mPosAgent += offset;
 	}
+
+	for (S32 k = 0; k < 3; ++k)
+	{
+		F32* pos = mStore.get((LLParticleStore::EComponent)(LLParticleStore::POS_X + k));
+		for (S32 i = 0; i < mStore.size(); ++i)
+		{
+			pos[i] += offset.mV[k];
+		}
+	}
 }
 
 void LLViewerPartGroup::removeParticlesByID(const U32 source_id)
 {
-	for (auto& particle : mParticles)
+	for (S32 i = 0; i < getCount(); ++i)
     {
-		if(particle->mPartSourcep->getID() == source_id)
+		if(mParticles[i]->mPartSourcep->getID() == source_id)
 		{
-            particle->mFlags = LLViewerPart::LL_PART_DEAD_MASK;
+            mParticles[i]->mFlags = LLViewerPart::LL_PART_DEAD_MASK;
+            mStore.getFlags()[i] |= LLParticleStore::KILLED;
 		}		
 	}
 }
@@ -743,6 +900,10 @@ void LLViewerPartSim::updateSimulation()
 		num_updates++;
 	}
 
+	// Groups due this frame are prepared, simulated, on the job system if there
+	// are enough particles, then finished, which moves particles between groups
+	std::vector<LLViewerPartGroup*> updated;
+	S32 updated_particles = 0;
 	count = (S32) mViewerPartGroups.size();
 	for (i = 0; i < count; i++)
 	{
@@ -764,15 +925,9 @@ void LLViewerPartSim::updateSimulation()
 			{
 				gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_ALL, TRUE);
 			}
-			mViewerPartGroups[i]->updateParticles(dt * visirate);
-			mViewerPartGroups[i]->mSkippedTime=0.0f;
-			if (!mViewerPartGroups[i]->getCount())
-			{
-				delete mViewerPartGroups[i];
-				vector_replace_with_last(mViewerPartGroups, mViewerPartGroups.begin() + i);
-				i--;
-				count--;
-			}
+			mViewerPartGroups[i]->prepareUpdate(dt * visirate);
+			updated.push_back(mViewerPartGroups[i]);
+			updated_particles += mViewerPartGroups[i]->getCount();
 		}
 		else
 		{	
@@ -780,6 +935,78 @@ void LLViewerPartSim::updateSimulation()
 		}
 
 	}
+
+	static LLCachedControl<bool> parallel_particles(gSavedSettings, "RenderParallelParticles", false);
+	if (parallel_particles && updated_particles > PARTICLES_PER_JOB && LLJobSystem::instanceExists())
+	{
+		// The largest group is simulated here, the others go out in batches of
+		// about PARTICLES_PER_JOB. Every prepareUpdate() is done and no
+		// finishUpdate() starts before the last batch is back, so jobs only
+		// ever touch the particles of their own groups.
+		std::vector<LLViewerPartGroup*>::iterator largest = std::max_element(updated.begin(), updated.end(),
+			[](const LLViewerPartGroup* a, const LLViewerPartGroup* b) { return a->getCount() < b->getCount(); });
+		LLViewerPartGroup* local = *largest;
+		std::vector<LLViewerPartGroup*> others(updated.begin(), largest);
+		others.insert(others.end(), largest + 1, updated.end());
+
+		LLJobSystem::job_list_t jobs;
+		size_t first = 0;
+		S32 batch = 0;
+		for (size_t g = 0; g < others.size(); ++g)
+		{
+			batch += others[g]->getCount();
+			if (batch < PARTICLES_PER_JOB && g + 1 < others.size())
+			{
+				continue;
+			}
+
+			LLViewerPartGroup** groups = others.data() + first;
+			const size_t group_count = g + 1 - first;
+			LLJobSystem::job_ptr_t job = LLJobSystem::getInstance()->submit(sSimulateParticlesJobType,
+				[groups, group_count]()
+				{
+					for (size_t n = 0; n < group_count; ++n)
+					{
+						groups[n]->simulate();
+					}
+				}, LLJobSystem::PRIORITY_HIGH);
+			if (job.isNull())
+			{ // job system is shutting down
+				break;
+			}
+			jobs.push_back(job);
+			first = g + 1;
+			batch = 0;
+		}
+
+		local->simulate();
+		for (size_t g = first; g < others.size(); ++g)
+		{
+			others[g]->simulate();
+		}
+		// Blocks on the batches still running, or runs them here if no worker took them
+		for (const LLJobSystem::job_ptr_t& job : jobs)
+		{
+			LLJobSystem::getInstance()->wait(job);
+		}
+	}
+	else
+	{
+		for (LLViewerPartGroup* group : updated)
+		{
+			group->simulate();
+		}
+	}
+
+	for (LLViewerPartGroup* group : updated)
+	{
+		group->finishUpdate();
+		if (!group->getCount())
+		{
+			vector_replace_with_last(mViewerPartGroups, std::find(mViewerPartGroups.begin(), mViewerPartGroups.end(), group));
+			delete group;
+		}
+	}
 	if (LLDrawable::getCurrentFrame()%16==0)
 	{
 		if (sParticleCount > sMaxParticleCount * 0.875f
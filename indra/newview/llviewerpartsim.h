@@ -30,6 +30,7 @@
 #include "llframetimer.h"
 #include "llpointer.h"
 #include "llpartdata.h"
+#include "llparticlekernel.h"
 #include "llviewerpartsource.h"
 
 class LLViewerTexture;
@@ -37,7 +38,8 @@ class LLViewerPart;
 class LLViewerRegion;
 class LLVOPartGroup;
 
-#define LL_MAX_PARTICLE_COUNT 8192
+// Particles share one vertex buffer indexed with U16, four vertices each
+#define LL_MAX_PARTICLE_COUNT 16384
 
 ///////////////////
 //
@@ -53,6 +55,10 @@ public:
 public:
 	LLViewerPart();
 
+	// Particles come and go by the thousand every second, from a pool owned by the main thread
+	void* operator new(size_t size);
+	void operator delete(void* ptr);
+
 	void init(LLPointer<LLViewerPartSource> sourcep, LLViewerTexture *imagep, vp_callback_t cb = nullptr);
 
 
@@ -96,6 +102,12 @@ public:
 	
 	void updateParticles(const F32 lastdt);
 
+	// updateParticles() in three steps, so that LLViewerPartSim can simulate
+	// groups on the job system. Only simulate() may run off the main thread.
+	void prepareUpdate(const F32 lastdt);
+	void simulate();
+	void finishUpdate();
+
 	BOOL posInGroup(const LLVector3 &pos, const F32 desired_size = -1.f);
 
 	void shift(const LLVector3 &offset);
@@ -128,6 +140,15 @@ protected:
 	LLVector3 mMaxObjPos;
 
 	LLViewerRegion *mRegionp;
+
+private:
+	void storePart(const LLViewerPart* part, S32 index);
+
+	LLParticleStore mStore;					// simulated state of mParticles, in the same order
+	std::vector<U8> mResults;				// LLParticleKernel::update() results of the last update
+	LLParticleKernel::Bounds mBounds;
+	F32 mUpdateDt;
+	S32 mSimulatedCount;					// particles prepareUpdate() found, later ones came from other groups
 };
 
 class LLViewerPartSim final : public LLSingleton<LLViewerPartSim>
@@ -37,7 +37,9 @@
 #include "llregionflags.h"
 #include "llregionhandle.h"
 #include "llsurface.h"
+#include "lldecodedmessage.h"
 #include "message.h"
+#include "message_layouts.h"
 //#include "vmath.h"
 #include "v3math.h"
 
@@ -202,6 +204,7 @@ public:
 	LLVLComposition *mCompositionp;		// Composition layer for the surface
 
 	LLVOCacheEntry::vocache_entry_map_t	  mCacheMap; //all cached entries
+	LLPointer<LLVOCacheRegionLoad>        mCacheLoad; //cache file read, kept to append to the file on save
 	LLVOCacheEntry::vocache_entry_set_t   mActiveSet; //all active entries;
 	LLVOCacheEntry::vocache_entry_set_t   mWaitingSet; //entries waiting for LLDrawable to be generated.	
 	std::set< LLPointer<LLViewerOctreeGroup> >      mVisibleGroups; //visible groupa
@@ -714,14 +717,35 @@ void LLViewerRegion::loadObjectCache()
 
 	if(LLVOCache::instanceExists())
 	{
-		LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap) ;
-		if (mImpl->mCacheMap.empty())
+		mImpl->mCacheLoad = LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID);
+		if (mImpl->mCacheLoad.isNull())
 		{
 			mCacheDirty = TRUE;
 		}
 	}
 }
 
+void LLViewerRegion::fetchObjectCache(F32 max_time)
+{
+	if (mImpl->mCacheLoad.isNull() || mImpl->mCacheLoad->isFetched() || !LLVOCache::instanceExists())
+	{
+		return;
+	}
+
+	const S32 FETCH_BATCH_SIZE = 256;
+	LLTimer fetch_timer;
+	do
+	{
+		if (LLVOCache::getInstance()->fetchFromCache(mHandle, mImpl->mCacheLoad, mImpl->mCacheMap, FETCH_BATCH_SIZE))
+		{
+			if (mImpl->mCacheMap.empty())
+			{
+				mCacheDirty = TRUE;
+			}
+			return;
+		}
+	} while (mImpl->mCacheLoad->isDecoded() && fetch_timer.getElapsedTimeF32() < max_time);
+}
 
 void LLViewerRegion::saveObjectCache()
 {
@@ -730,6 +754,16 @@ void LLViewerRegion::saveObjectCache()
 		return;
 	}
 
+	if (mImpl->mCacheLoad.notNull() && !mImpl->mCacheLoad->isDecoded())
+	{
+		// Rather than wait for the read, leave the file as it is and drop what came in since
+		LL_DEBUGS("ObjectCache") << "Cache file of handle " << mHandle << " still loading, not saving" << LL_ENDL;
+		mImpl->mCacheMap.clear();
+		mImpl->mCacheLoad = nullptr;
+		return;
+	}
+	fetchObjectCache(F32_MAX);
+
 	if (mImpl->mCacheMap.empty())
 	{
 		return;
@@ -740,11 +774,12 @@ void LLViewerRegion::saveObjectCache()
 		const F32 start_time_threshold = 600.0f; //seconds
 		bool removal_enabled = sVOCacheCullingEnabled && (mRegionTimer.getElapsedTimeF32() > start_time_threshold); //allow to remove invalid objects from object cache file.
 		
-		LLVOCache::getInstance()->writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty, removal_enabled) ;
+		LLVOCache::getInstance()->writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty, removal_enabled, mImpl->mCacheLoad) ;
 		mCacheDirty = FALSE;
 	}
 
 	mImpl->mCacheMap.clear();
+	mImpl->mCacheLoad = nullptr;
 }
 
 void LLViewerRegion::sendMessage()
@@ -1451,6 +1486,8 @@ void LLViewerRegion::clearCachedVisibleObjects()
 //to replace the function idleUpdate(...) in case there is no enough time.
 void LLViewerRegion::lightIdleUpdate()
 {
+	fetchObjectCache(0.f); //a single batch
+
 	if(!sVOCacheCullingEnabled)
 	{
 		return;
@@ -1478,6 +1515,8 @@ void LLViewerRegion::idleUpdate(F32 max_update_time)
 		mParcelOverlay->idleUpdate();
 	}
 
+	fetchObjectCache(max_update_time * 0.25f);
+
 	if(!sVOCacheCullingEnabled)
 	{
 		return;
@@ -2165,20 +2204,43 @@ void LLViewerRegion::updateCoarseLocations(LLMessageSystem* msg)
 
 	S16 agent_index;
 	S16 target_index;
-	msg->getS16Fast(_PREHASH_Index, _PREHASH_You, agent_index);
-	msg->getS16Fast(_PREHASH_Index, _PREHASH_Prey, target_index);
+	namespace coarse = LLMessageLayouts::CoarseLocationUpdate;
+	const LLDecodedMessage* decoded = msg->getDecodedMessage();
+	if (decoded)
+	{
+		agent_index = decoded->get<coarse::Index::You>();
+		target_index = decoded->get<coarse::Index::Prey>();
+	}
+	else
+	{
+		msg->getS16Fast(_PREHASH_Index, _PREHASH_You, agent_index);
+		msg->getS16Fast(_PREHASH_Index, _PREHASH_Prey, target_index);
+	}
 
 	BOOL has_agent_data = msg->has(_PREHASH_AgentData);
 	S32 count = msg->getNumberOfBlocksFast(_PREHASH_Location);
 	for(S32 i = 0; i < count; i++)
 	{
-		msg->getU8Fast(_PREHASH_Location, _PREHASH_X, x_pos, i);
-		msg->getU8Fast(_PREHASH_Location, _PREHASH_Y, y_pos, i);
-		msg->getU8Fast(_PREHASH_Location, _PREHASH_Z, z_pos, i);
 		LLUUID agent_id = LLUUID::null;
-		if(has_agent_data)
+		if (decoded)
 		{
-			msg->getUUIDFast(_PREHASH_AgentData, _PREHASH_AgentID, agent_id, i);
+			x_pos = decoded->get<coarse::Location::X>(i);
+			y_pos = decoded->get<coarse::Location::Y>(i);
+			z_pos = decoded->get<coarse::Location::Z>(i);
+			if (has_agent_data)
+			{
+				agent_id = decoded->get<coarse::AgentData::AgentID>(i);
+			}
+		}
+		else
+		{
+			msg->getU8Fast(_PREHASH_Location, _PREHASH_X, x_pos, i);
+			msg->getU8Fast(_PREHASH_Location, _PREHASH_Y, y_pos, i);
+			msg->getU8Fast(_PREHASH_Location, _PREHASH_Z, z_pos, i);
+			if (has_agent_data)
+			{
+				msg->getUUIDFast(_PREHASH_AgentData, _PREHASH_AgentID, agent_id, i);
+			}
 		}
 
 		//LL_INFOS() << "  object X: " << (S32)x_pos << " Y: " << (S32)y_pos
@@ -2659,6 +2721,13 @@ bool LLViewerRegion::probeCache(U32 local_id, U32 crc, U32 flags, U8 &cache_miss
 	//llassert(mCacheLoaded);  This assert failes often, changing to early-out -- davep, 2010/10/18
 
 	LLVOCacheEntry* entry = getCacheEntry(local_id, false);
+	if (!entry && mImpl->mCacheLoad.notNull() && LLVOCache::instanceExists()
+		&& LLVOCache::getInstance()->fetchEntryFromCache(mImpl->mCacheLoad, local_id, mImpl->mCacheMap))
+	{
+		// Probe came in before the decoded cache file was picked up. If the
+		// file is still being read this is a miss, the object is requested again.
+		entry = getCacheEntry(local_id, false);
+	}
 
 	if (entry)
 	{
@@ -2973,7 +3042,7 @@ void LLViewerRegion::unpackRegionHandshake()
 	{
 		flags |= 0x00000001; //set the bit 0 to be 1 to ask sim to send all cacheable objects.		
 	}
-	if(mImpl->mCacheMap.empty())
+	if(mImpl->mCacheMap.empty() && mImpl->mCacheLoad.isNull())
 	{
 		flags |= 0x00000002; //set the bit 1 to be 1 to tell sim the cache file is empty, no need to send cache probes.
 	}
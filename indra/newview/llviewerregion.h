@@ -101,6 +101,7 @@ public:
 	~LLViewerRegion();
 
 	// Call this after you have the region name and handle.
+	// The cache file is decoded on the object cache thread and picked up during idle updates.
 	void loadObjectCache();
 	void saveObjectCache();
 
@@ -440,6 +441,7 @@ private:
 	void createVisibleObjects(F32 max_time);
 	void updateVisibleEntries(F32 max_time); //update visible entries
 
+	void fetchObjectCache(F32 max_time); //move decoded cache entries into the cache map
 	void addCacheMiss(U32 id, LLViewerRegion::eCacheMissType miss_type);
 	void decodeBoundingInfo(LLVOCacheEntry* entry);
 	bool isNonCacheableObjectCreated(U32 local_id);
@@ -550,7 +550,7 @@ public:
 			addText(xpos, ypos, llformat("%d Vertex Buffers", LLVertexBuffer::sGLCount));
 			ypos += y_inc;
 
-			addText(xpos, ypos, llformat("%d Mapped Buffers", LLVertexBuffer::sMappedCount));
+			addText(xpos, ypos, llformat("%d Mapped Buffers", LLVertexBuffer::sMappedCount.load()));
 			ypos += y_inc;
 
 			addText(xpos, ypos, llformat("%d Vertex Buffer Binds", LLVertexBuffer::sBindCount));
@@ -559,6 +559,12 @@ public:
 			addText(xpos, ypos, llformat("%d Vertex Buffer Sets", LLVertexBuffer::sSetCount));
 			ypos += y_inc;
 
+			if (LLVertexBuffer::sStreamRing.isValid())
+			{
+				addText(xpos, ypos, llformat("%d KB Stream Ring Copies, %d Waits", (S32)(LLVertexBuffer::sStreamRing.mBytesCopied / 1024), LLVertexBuffer::sStreamRing.mWaitCount));
+				ypos += y_inc;
+			}
+
 			addText(xpos, ypos, llformat("%d Texture Binds", LLImageGL::sBindCount));
 			ypos += y_inc;
 
@@ -630,6 +636,8 @@ public:
 			LLVertexBuffer::sBindCount = LLImageGL::sBindCount = 
 				LLVertexBuffer::sSetCount = LLImageGL::sUniqueCount = 
 				gPipeline.mNumVisibleNodes = LLPipeline::sVisibleLightCount = 0;
+			LLVertexBuffer::sStreamRing.mBytesCopied = 0;
+			LLVertexBuffer::sStreamRing.mWaitCount = 0;
 		}
 		static LLCachedControl<bool> debugShowAvatarRenderInfo(gSavedSettings, "DebugShowAvatarRenderInfo");
 		if (debugShowAvatarRenderInfo)
@@ -35,6 +35,8 @@
 #include "llframetimer.h"
 #include "llsurface.h"
 #include "llbitpack.h"
+#include "lljobsystem.h"
+#include "llviewercontrol.h"
 
 const	char	LAND_LAYER_CODE					= 'L';
 const	char	WATER_LAYER_CODE				= 'W';
@@ -48,6 +50,19 @@ const	char	AURORA_CLOUD_LAYER_CODE			= ':';
 
 LLVLManager gVLManager;
 
+static LLJobType sDecodeLandJobType("decode_land");
+
+// A land LayerData packet being decoded on the job system
+struct LLVLManager::LandDecode
+{
+	LLViewerRegion *mRegionp;			// null once the region is gone
+	std::unique_ptr<LLVLData> mData;	// only touched by the job until it is done
+	BOOL mLargePatch;
+	S32 mPatchesPerEdge;
+	LLSurface::DecodedPatches mPatches;
+	LLJobSystem::job_ptr_t mJob;
+};
+
 LLVLManager::~LLVLManager()
 {
 	S32 i;
@@ -87,22 +102,33 @@ void LLVLManager::addLayerData(LLVLData *vl_datap, const S32Bytes mesg_size)
 void LLVLManager::unpackData(const S32 num_packets)
 {
 	static LLFrameTimer decode_timer;
+	static LLCachedControl<bool> parallel_decode(gSavedSettings, "TerrainParallelDecode", true);
 	
 	S32 i;
 	for (i = 0; i < mPacketData.size(); i++)
 	{
 		LLVLData *datap = mPacketData[i];
 
+		const bool land = LAND_LAYER_CODE == datap->mType || AURORA_LAND_LAYER_CODE == datap->mType;
+		if (land && parallel_decode && decodeLandAsync(datap, AURORA_LAND_LAYER_CODE == datap->mType))
+		{
+			mPacketData[i] = nullptr;
+			continue;
+		}
+
 		LLBitPack bit_pack(datap->mData, datap->mSize);
 		LLGroupHeader goph;
 
 		decode_patch_group_header(bit_pack, &goph);
 		if (LAND_LAYER_CODE == datap->mType)
 		{
+			// Not to be overwritten by older packets still being decoded
+			applyLandDecodes(true);
 			datap->mRegionp->getLand().decompressDCTPatch(bit_pack, &goph, FALSE);
 		}
 		else if (AURORA_LAND_LAYER_CODE == datap->mType)
 		{
+			applyLandDecodes(true);
 			datap->mRegionp->getLand().decompressDCTPatch(bit_pack, &goph, TRUE);
 		}
 		else if (WIND_LAYER_CODE == datap->mType || AURORA_WIND_LAYER_CODE == datap->mType)
@@ -129,6 +155,62 @@ void LLVLManager::unpackData(const S32 num_packets)
 
 }
 
+bool LLVLManager::decodeLandAsync(LLVLData *datap, BOOL b_large_patch)
+{
+	if (!LLJobSystem::instanceExists())
+	{
+		return false;
+	}
+
+	land_decode_ptr_t decode = std::make_shared<LandDecode>();
+	decode->mRegionp = datap->mRegionp;
+	decode->mLargePatch = b_large_patch;
+	decode->mPatchesPerEdge = datap->mRegionp->getLand().getPatchesPerEdge();
+	decode->mData.reset(datap);
+	decode->mJob = LLJobSystem::getInstance()->submit(sDecodeLandJobType,
+		[decode]()
+		{
+			// The group header sets up decode_patch() for this thread
+			LLBitPack bit_pack(decode->mData->mData, decode->mData->mSize);
+			LLGroupHeader goph;
+			decode_patch_group_header(bit_pack, &goph);
+			LLSurface::decodeDCTPatches(bit_pack, goph, decode->mLargePatch, decode->mPatchesPerEdge, decode->mPatches);
+			decode->mData.reset();
+		},
+		LLJobSystem::PRIORITY_NORMAL,
+		[]() { gVLManager.applyLandDecodes(false); });
+
+	if (decode->mJob.isNull())
+	{ // job system is shutting down, the caller keeps the packet
+		decode->mData.release();
+		return false;
+	}
+	mLandDecodes.push_back(decode);
+	return true;
+}
+
+void LLVLManager::applyLandDecodes(bool wait)
+{
+	while (!mLandDecodes.empty())
+	{
+		land_decode_ptr_t decode = mLandDecodes.front();
+		if (!decode->mJob->isDone())
+		{
+			if (!wait)
+			{
+				break;
+			}
+			LLJobSystem::getInstance()->wait(decode->mJob);
+		}
+		mLandDecodes.pop_front();
+
+		if (decode->mRegionp)
+		{
+			decode->mRegionp->getLand().applyDecodedPatches(decode->mPatches);
+		}
+	}
+}
+
 void LLVLManager::resetBitCounts()
 {
 	mLandBits = mWindBits = mCloudBits = (S32Bits)0;
@@ -161,6 +243,14 @@ S32Bytes LLVLManager::getTotalBytes() const
 
 void LLVLManager::cleanupData(LLViewerRegion *regionp)
 {
+	for (land_decode_ptr_t& decode : mLandDecodes)
+	{
+		if (decode->mRegionp == regionp)
+		{
+			decode->mRegionp = nullptr;
+		}
+	}
+
 	S32 cur = 0;
 	while (cur < mPacketData.size())
 	{
@@ -29,6 +29,9 @@
 
 // This class manages the data coming in for viewer layers from the network.
 
+#include <deque>
+#include <memory>
+
 class LLVLData;
 class LLViewerRegion;
 
@@ -52,8 +55,16 @@ public:
 
 	void cleanupData(LLViewerRegion *regionp);
 protected:
+	struct LandDecode;
+	typedef std::shared_ptr<LandDecode> land_decode_ptr_t;
+
+	bool decodeLandAsync(LLVLData *datap, BOOL b_large_patch);
+	// Applies the land packets decoded on the job system, in the order they
+	// arrived. With wait, also waits for those still being decoded.
+	void applyLandDecodes(bool wait);
 
 	std::vector<LLVLData *> mPacketData;
+	std::deque<land_decode_ptr_t> mLandDecodes;
 	U32Bits mLandBits;
 	U32Bits mWindBits;
 	U32Bits mCloudBits;
@@ -658,6 +658,13 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mAttachmentEstTriangleCount(0.f),
 	mNeedsSkin(FALSE),
 	mLastSkinTime(0.f),
+	mDetailedUpdate(FALSE),
+	mPoseUpdatePending(false),
+	mPoseHoverOffset(0.f),
+	mIdleUpdateUsec(0),
+	mJointTouches(0),
+	mJointUpdates(0),
+	mMainThreadUpdateTime(0.f),
 	mUpdatePeriod(1),
 	mNumInitFaces(0),
 	mVisualComplexity(VISUAL_COMPLEXITY_UNKNOWN),
@@ -2467,22 +2474,41 @@ void LLVOAvatar::dumpAnimationState()
 // idleUpdate()
 //------------------------------------------------------------------------
 void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
+{
+	if (beginIdleUpdate(agent, time))
+	{
+		updatePose();
+		finishIdleUpdate();
+	}
+}
+
+//------------------------------------------------------------------------
+// beginIdleUpdate()
+// Everything up to and including the motion update, leaving the new pose
+// for updatePose()
+//------------------------------------------------------------------------
+bool LLVOAvatar::beginIdleUpdate(LLAgent &agent, const F64 &time)
 {
 	LL_RECORD_BLOCK_TIME(FTM_AVATAR_UPDATE);
 
 	if (isDead())
 	{
 		LL_INFOS() << "Warning!  Idle on dead avatar" << LL_ENDL;
-		return;
+		return false;
 	}	
 
 	static LLCachedControl<bool> disable_all_render_types(gSavedSettings, "DisableAllRenderTypes");
 	if (!(gPipeline.hasRenderType(LLPipeline::RENDER_TYPE_AVATAR))
 		&& !(disable_all_render_types) && !isSelf())
 	{
-		return;
+		return false;
 	}
 
+	const U64 start = totalTime();
+	// The joint counters are per thread, keep what this avatar adds to them
+	const U32 touches = LLJoint::sNumTouches;
+	const U32 updates = LLJoint::sNumUpdates;
+
     // Update should be happening max once per frame.
 	const S32 upd_freq = 4; // force update every upd_freq frames.
 	if ((mLastAnimExtents[0]==LLVector3())||
@@ -2560,7 +2586,69 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 	// animate the character
 	// store off last frame's root position to be consistent with camera position
 	mLastRootPos = mRoot->getWorldPosition();
-	BOOL detailed_update = updateCharacter(agent);
+	mDetailedUpdate = updateCharacter(agent);
+
+	mJointTouches += LLJoint::sNumTouches - touches;
+	mJointUpdates += LLJoint::sNumUpdates - updates;
+	mIdleUpdateUsec = totalTime() - start;
+	return true;
+}
+
+//------------------------------------------------------------------------
+// updatePose()
+// Blends the pose of the motion update into the skeleton and updates its
+// world matrices. Reads and writes nothing but this avatar's joints, so
+// that the poses of many avatars may be updated at once.
+//------------------------------------------------------------------------
+void LLVOAvatar::updatePose()
+{
+	if (!mPoseUpdatePending)
+	{
+		return;
+	}
+	mPoseUpdatePending = false;
+
+	const U32 touches = LLJoint::sNumTouches;
+	const U32 updates = LLJoint::sNumUpdates;
+
+	applyPendingPose();
+
+	// Special handling for sitting on ground.
+	if (mPoseHoverOffset != 0.f)
+	{
+		LLVector3 pos = mRoot->getWorldPosition();
+		pos.mV[VZ] += mPoseHoverOffset;
+		mRoot->touch();
+		// SL-315
+		mRoot->setWorldPosition(pos);
+	}
+
+	// Update child joints as needed.
+	mRoot->updateWorldMatrixChildren();
+
+	mJointTouches += LLJoint::sNumTouches - touches;
+	mJointUpdates += LLJoint::sNumUpdates - updates;
+}
+
+//------------------------------------------------------------------------
+// finishIdleUpdate()
+// What idleUpdate() does once the pose is up to date
+//------------------------------------------------------------------------
+void LLVOAvatar::finishIdleUpdate()
+{
+	LL_RECORD_BLOCK_TIME(FTM_AVATAR_UPDATE);
+
+	const U64 start = totalTime();
+
+	if (mDetailedUpdate)
+	{
+		const U32 touches = LLJoint::sNumTouches;
+		const U32 updates = LLJoint::sNumUpdates;
+		finishCharacterUpdate();
+		mJointTouches += LLJoint::sNumTouches - touches;
+		mJointUpdates += LLJoint::sNumUpdates - updates;
+	}
+	BOOL detailed_update = mDetailedUpdate;
 
 	static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
 	bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
@@ -2579,6 +2667,10 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 		
 	idleUpdateNameTag( mLastRootPos );
 	idleUpdateRenderComplexity();
+
+	// For Animation Info, the time updatePose() leaves to the job system is not counted
+	const F32 update_ms = (F32)(mIdleUpdateUsec + (totalTime() - start)) / 1000.f;
+	mMainThreadUpdateTime = lerp(mMainThreadUpdateTime, update_ms, 0.1f);
 }
 
 void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled)
@@ -2697,11 +2789,11 @@ void LLVOAvatar::idleUpdateMisc(bool detailed_update)
 {
 	if (LLVOAvatar::sJointDebug)
 	{
-		LL_INFOS() << getFullname() << ": joint touches: " << LLJoint::sNumTouches << " updates: " << LLJoint::sNumUpdates << LL_ENDL;
+		LL_INFOS() << getFullname() << ": joint touches: " << mJointTouches << " updates: " << mJointUpdates << LL_ENDL;
 	}
 
-	LLJoint::sNumUpdates = 0;
-	LLJoint::sNumTouches = 0;
+	mJointUpdates = 0;
+	mJointTouches = 0;
 
 	BOOL visible = isVisible() || mNeedsAnimUpdate;
 
@@ -3778,6 +3870,7 @@ LLViewerInventoryItem* recursiveGetObjectInventoryItem(LLViewerObject *vobj, LLU
 
 void LLVOAvatar::updateAnimationDebugText()
 {
+	addDebugText(llformat("Update: %.2f ms main thread", mMainThreadUpdateTime));
     for (auto motionp : mMotionController.getActiveMotions())
     {
         if (motionp->getMinPixelArea() < getPixelArea())
@@ -4381,6 +4474,8 @@ void LLVOAvatar::updateRootPositionAndRotation(LLAgent& agent, F32 speed, bool w
 //------------------------------------------------------------------------
 BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 {	
+	mPoseUpdatePending = false;
+
 	updateDebugText();
 	
 	if (!mIsBuilt)
@@ -4471,30 +4566,36 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	// store data relevant to motions
 	mSpeed = speed;
 
-	// update animations
+	// update animations, the pose is blended by updatePose()
 	if (mSpecialRenderMode == 1) // Animation Preview
 	{
-		updateMotions(LLCharacter::FORCE_UPDATE);
+		updateMotions(LLCharacter::FORCE_UPDATE, true);
 	}
 	else
 	{
-		updateMotions(LLCharacter::NORMAL_UPDATE);
+		updateMotions(LLCharacter::NORMAL_UPDATE, true);
 	}
 
 	// Special handling for sitting on ground.
+	mPoseHoverOffset = 0.f;
 	if (!getParent() && (isSitting() || was_sit_ground_constrained))
 	{
-		
-		F32 off_z = getHoverOffset().mV[VZ];
-		if (off_z != 0.f)
-		{
-			LLVector3 pos = mRoot->getWorldPosition();
-			pos.mV[VZ] += off_z;
-			mRoot->touch();
-			// SL-315
-			mRoot->setWorldPosition(pos);
-		}
+		mPoseHoverOffset = getHoverOffset().mV[VZ];
 	}
+	mPoseUpdatePending = true;
+
+	return TRUE;
+}
+
+//------------------------------------------------------------------------
+// finishCharacterUpdate()
+// The rest of a detailed updateCharacter(), after updatePose()
+//------------------------------------------------------------------------
+void LLVOAvatar::finishCharacterUpdate()
+{
+	// Runs after updatePose() walked the skeleton. getWorldPosition() resolves
+	// the pending transforms of a joint's parents itself, so the eye and ankle
+	// positions read here are the ones the walk would have left anyway.
 
 	// update head position
 	updateHeadOffset();
@@ -4502,13 +4603,8 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	// Generate footstep sounds when feet hit the ground
     updateFootstepSounds();
 
-	// Update child joints as needed.
-	mRoot->updateWorldMatrixChildren();
-
 	// System avatar mesh vertices need to be reskinned.
 	mNeedsSkin = TRUE;
-
-	return TRUE;
 }
 
 //-----------------------------------------------------------------------------
@@ -264,6 +264,14 @@ public:
 	void 			updateAnimationDebugText();
 	virtual void	updateDebugText();
 	virtual BOOL 	updateCharacter(LLAgent &agent);
+	void			finishCharacterUpdate();
+	// idleUpdate() in three steps, so that LLViewerObjectList can run the
+	// updatePose() of many avatars on the job system. beginIdleUpdate()
+	// returns false when there is nothing left to do this frame.
+	virtual bool	beginIdleUpdate(LLAgent &agent, const F64 &time);
+	void			updatePose(); // touches nothing but this avatar's joints
+	void			finishIdleUpdate();
+	F32				getMainThreadUpdateTime() const { return mMainThreadUpdateTime; }
     void			updateFootstepSounds();
     void			computeUpdatePeriod();
     void			updateOrientation(LLAgent &agent, F32 speed, F32 delta_time);
@@ -467,6 +475,14 @@ public:
 	BOOL 		mNeedsSkin; // avatar has been animated and verts have not been updated
 	F32			mLastSkinTime; //value of gFrameTimeSeconds at last skin update
 
+	BOOL		mDetailedUpdate; // updateCharacter() animated the avatar this frame
+	bool		mPoseUpdatePending; // for updatePose()
+	F32			mPoseHoverOffset; // sitting on ground hover, applied with the pose
+	U64			mIdleUpdateUsec; // main thread time of beginIdleUpdate()
+	U32			mJointTouches; // over beginIdleUpdate() to finishIdleUpdate() since the last idleUpdateMisc(), for sJointDebug
+	U32			mJointUpdates;
+	F32			mMainThreadUpdateTime; // smoothed per frame main thread update time, ms
+
 	S32	 		mUpdatePeriod;
 	S32  		mNumInitFaces; //number of faces generated when creating the avatar drawable, does not inculde splitted faces due to long vertex buffer.
 
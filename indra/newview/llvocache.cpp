@@ -35,6 +35,8 @@
 #include "pipeline.h"
 #include "llagentcamera.h"
 #include "llmemory.h"
+#include "llcrc.h"
+#include "lljobsystem.h"
 
 //static variables
 U32 LLVOCacheEntry::sMinFrameRange = 0;
@@ -54,6 +56,25 @@ BOOL check_write(LLAPRFile* apr_file, void* src, S32 n_bytes)
 	return (S32)apr_file->write(src, n_bytes) == n_bytes ;
 }
 
+template<typename T>
+static bool read_value(const U8*& buffer, const U8* end, T& value)
+{
+	if (end - buffer < (S32)sizeof(T))
+	{
+		return false;
+	}
+	memcpy(&value, buffer, sizeof(T));
+	buffer += sizeof(T);
+	return true;
+}
+
+template<typename T>
+static void append_value(std::vector<U8>& buffer, const T& value)
+{
+	const U8* bytes = reinterpret_cast<const U8*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
 
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
@@ -73,6 +94,7 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mSceneContrib(0.f),
 	mState(INACTIVE),
 	mValid(TRUE),
+	mDirty(true),
 	mBSphereRadius(-1.0f)
 {
 	mBuffer = new U8[dp.getBufferSize()];
@@ -95,12 +117,13 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mSceneContrib(0.f),
 	mState(INACTIVE),
 	mValid(TRUE),
+	mDirty(true),
 	mBSphereRadius(-1.0f)
 {
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
+LLVOCacheEntry::LLVOCacheEntry(const U8*& buffer, const U8* end)
 :	LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
 	LLTrace::MemTrackable<LLVOCacheEntry, 16>("LLVOCacheEntry"), 
 	mLastCameraUpdated(0),
@@ -110,58 +133,36 @@ LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
 	mSceneContrib(0.f),
 	mState(INACTIVE),
 	mValid(FALSE),
+	mDirty(false),
 	mBSphereRadius(-1.0f)
 {
 	S32 size = -1;
-	BOOL success;
+	bool success;
 
 	mDP.assignBuffer(mBuffer, 0);
 	
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
+	success = read_value(buffer, end, mLocalID)
+		&& read_value(buffer, end, mCRC)
+		&& read_value(buffer, end, mHitCount)
+		&& read_value(buffer, end, mDupeCount)
+		&& read_value(buffer, end, mCRCChangeCount)
+		&& read_value(buffer, end, size);
 	if(success)
 	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
-
 		// Corruption in the cache entries
-		if ((size > 10000) || (size < 1))
+		if ((size > 10000) || (size < 1) || (end - buffer < size))
 		{
-			// We've got a bogus size, skip reading it.
-			// We won't bother seeking, because the rest of this file
-			// is likely bogus, and will be tossed anyway.
+			// We've got a bogus size, the rest of this file is likely bogus too
 			LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-			success = FALSE;
+			success = false;
 		}
 	}
-	if(success && size > 0)
+	if(success)
 	{
 		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = nullptr ;
-		}
+		memcpy(mBuffer, buffer, size);
+		buffer += size;
+		mDP.assignBuffer(mBuffer, size);
 	}
 
 	if(!success)
@@ -189,6 +190,7 @@ void LLVOCacheEntry::updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp)
 		mCRC = crc;
 		mCRCChangeCount++;
 	}
+	mDirty = true;
 
 	mDP.freeBuffer();
 
@@ -348,38 +350,16 @@ void LLVOCacheEntry::dump() const
 		<< LL_ENDL;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
+void LLVOCacheEntry::writeToBuffer(std::vector<U8>& buffer) const
 {
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
-		{
-			success = check_write(apr_file, (void*)mBuffer, size);
-		}
-	}
-
-	return success ;
+	S32 size = mDP.getBufferSize();
+	append_value(buffer, mLocalID);
+	append_value(buffer, mCRC);
+	append_value(buffer, mHitCount);
+	append_value(buffer, mDupeCount);
+	append_value(buffer, mCRCChangeCount);
+	append_value(buffer, size);
+	buffer.insert(buffer.end(), mBuffer, mBuffer + size);
 }
 
 //static 
@@ -1073,15 +1053,277 @@ const U32 INVALID_TIME = 0 ;
 const char* object_cache_dirname = "objectcache";
 const char* header_filename = "object.cache";
 
+// A region cache file is a full snapshot of the region's entries, followed by delta blocks
+// appended on later visits. Each block holds the entries that changed and the local ids
+// of the entries that were removed:
+//   U32 magic, U32 payload size, U32 payload crc, S32 num_updates, S32 num_removed, entries, ids
+const U32 DELTA_MAGIC = 0x4c44434f; // "OCDL"
+const S32 DELTA_HEADER_SIZE = 3 * sizeof(U32);
+
+//-------------------------------------------------------------------
+//LLVOCache::IOThread
+//-------------------------------------------------------------------
+// Runs the region cache file reads, writes and removals in the order they were queued,
+// so a region read always sees the writes queued before it.
+class LLVOCache::IOThread final : public LLQueuedThread
+{
+public:
+	IOThread();
+
+	void read(LLVOCacheRegionLoad* load);
+	void write(const std::string& filename, std::vector<U8>&& data, bool append);
+	void remove(const std::string& filename);
+
+	// Blocks until everything queued is on disk
+	void flush();
+
+private:
+	class Request;
+	void queue(Request* request);
+};
+
+class LLVOCache::IOThread::Request final : public LLQueuedThread::QueuedRequest
+{
+public:
+	enum EOperation { READ, WRITE, APPEND, REMOVE };
+
+	Request(IOThread* thread, handle_t handle, EOperation op, std::string filename)
+	:	QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL, FLAG_AUTO_COMPLETE),
+		mThread(thread),
+		mOperation(op),
+		mFilename(std::move(filename))
+	{
+	}
+
+	/*virtual*/ bool processRequest() override;
+	/*virtual*/ void deleteRequest() override { QueuedRequest::deleteRequest(); }
+
+	LLPointer<LLVOCacheRegionLoad> mLoad;
+	std::vector<U8> mData;
+
+private:
+	IOThread* mThread;
+	EOperation mOperation;
+	std::string mFilename;
+};
+
+static LLJobType sVOCacheJobType("vocache");
+
+LLVOCache::IOThread::IOThread()
+:	LLQueuedThread("VOCache", true, false, &sVOCacheJobType)
+{
+	if(!mLocalAPRFilePoolp)
+	{
+		mLocalAPRFilePoolp = new LLVolatileAPRPool("VOCache Thread Pool") ;
+	}
+}
+
+void LLVOCache::IOThread::queue(Request* request)
+{
+	if (!addRequest(request))
+	{
+		LL_WARNS() << "Object cache thread is shutting down, dropping request" << LL_ENDL;
+		request->deleteRequest();
+	}
+}
+
+void LLVOCache::IOThread::read(LLVOCacheRegionLoad* load)
+{
+	Request* request = new Request(this, generateHandle(), Request::READ, load->mFilename);
+	request->mLoad = load;
+	queue(request);
+}
+
+void LLVOCache::IOThread::write(const std::string& filename, std::vector<U8>&& data, bool append)
+{
+	Request* request = new Request(this, generateHandle(), append ? Request::APPEND : Request::WRITE, filename);
+	request->mData = std::move(data);
+	queue(request);
+}
+
+void LLVOCache::IOThread::remove(const std::string& filename)
+{
+	queue(new Request(this, generateHandle(), Request::REMOVE, filename));
+}
+
+void LLVOCache::IOThread::flush()
+{
+	while (getPending() > 0 || !mIdleThread)
+	{
+		ms_sleep(1);
+	}
+}
+
+bool LLVOCache::IOThread::Request::processRequest()
+{
+	LLVolatileAPRPool* pool = mThread->getLocalAPRFilePool();
+	switch (mOperation)
+	{
+	case READ:
+		mLoad->decode(pool);
+		mLoad = nullptr;
+		break;
+	case WRITE:
+	case APPEND:
+		{
+			apr_int32_t flags = APR_CREATE|APR_WRITE|APR_BINARY|(mOperation == APPEND ? APR_APPEND : APR_TRUNCATE);
+			bool success;
+			{
+				LLAPRFile apr_file(mFilename, flags, pool);
+				success = check_write(&apr_file, mData.data(), mData.size());
+			}
+			if (!success)
+			{
+				// A damaged file is dropped when it is read back, don't leave half of one behind
+				LL_WARNS() << "Failed to write object cache file " << mFilename << LL_ENDL;
+				LLAPRFile::remove(mFilename, pool);
+			}
+		}
+		break;
+	case REMOVE:
+		LLAPRFile::remove(mFilename, pool);
+		break;
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------
+//LLVOCacheRegionLoad
+//-------------------------------------------------------------------
+LLVOCacheRegionLoad::LLVOCacheRegionLoad(const LLUUID& id, std::string filename)
+:	mCacheID(id),
+	mFilename(std::move(filename)),
+	mDecoded(false),
+	mSuccess(false),
+	mAppendable(false),
+	mBaseBytes(0),
+	mDeltaBytes(0),
+	mFetched(false)
+{
+}
+
+void LLVOCacheRegionLoad::decode(LLVolatileAPRPool* pool)
+{
+	// One read for the whole file, then decode from memory
+	std::vector<U8> data;
+	S32 file_size = (S32)LLAPRFile::size(mFilename, pool);
+	if (file_size > 0)
+	{
+		data.resize(file_size);
+		if ((S32)LLAPRFile::readEx(mFilename, data.data(), 0, file_size, pool) != file_size)
+		{
+			data.clear();
+		}
+	}
+	const U8* buffer = data.data();
+	const U8* end = buffer + data.size();
+
+	LLUUID cache_id;
+	mSuccess = read_value(buffer, end, cache_id.mData);
+	if(mSuccess && cache_id != mCacheID)
+	{
+		LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+		mSuccess = false;
+	}
+
+	S32 num_entries = 0;
+	if(mSuccess)
+	{
+		mSuccess = read_value(buffer, end, num_entries);
+	}
+	if(mSuccess)
+	{
+		for (S32 i = 0; i < num_entries && buffer < end; i++)
+		{
+			LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(buffer, end);
+			if (!entry->getLocalID())
+			{
+				LL_WARNS() << "Aborting cache file load for " << mFilename << ", cache file corruption!" << LL_ENDL;
+				mSuccess = false;
+				break;
+			}
+			mEntries[entry->getLocalID()] = entry;
+		}
+	}
+	mBaseBytes = buffer - data.data();
+
+	// Replay the deltas written since, up to the first damaged one
+	while (mSuccess && buffer < end && applyDelta(buffer, end))
+	{
+	}
+	mDeltaBytes = (buffer - data.data()) - mBaseBytes;
+	mAppendable = mSuccess && buffer == end;
+
+	LL_DEBUGS("ObjectCache") << "Decoded " << mEntries.size() << " entries from " << mFilename
+							 << " snapshot bytes: " << mBaseBytes << " delta bytes: " << mDeltaBytes << LL_ENDL;
+	mDecoded = true;
+}
+
+bool LLVOCacheRegionLoad::applyDelta(const U8*& buffer, const U8* end)
+{
+	const U8* block = buffer;
+	U32 magic = 0;
+	U32 size = 0;
+	U32 crc = 0;
+	if (!read_value(block, end, magic) || magic != DELTA_MAGIC
+		|| !read_value(block, end, size) || !read_value(block, end, crc)
+		|| (U32)(end - block) < size)
+	{
+		LL_WARNS() << "Incomplete delta in " << mFilename << ", ignoring the rest of the file" << LL_ENDL;
+		return false;
+	}
+	LLCRC block_crc;
+	block_crc.update(block, size);
+	if (block_crc.getCRC() != crc)
+	{
+		LL_WARNS() << "Damaged delta in " << mFilename << ", ignoring the rest of the file" << LL_ENDL;
+		return false;
+	}
+
+	const U8* block_end = block + size;
+	S32 num_updates = 0;
+	S32 num_removed = 0;
+	if (!read_value(block, block_end, num_updates) || !read_value(block, block_end, num_removed))
+	{
+		return false;
+	}
+	for (S32 i = 0; i < num_updates; i++)
+	{
+		LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(block, block_end);
+		if (!entry->getLocalID())
+		{
+			return false;
+		}
+		mEntries[entry->getLocalID()] = entry;
+	}
+	for (S32 i = 0; i < num_removed; i++)
+	{
+		U32 local_id;
+		if (!read_value(block, block_end, local_id))
+		{
+			return false;
+		}
+		mEntries.erase(local_id);
+	}
+
+	buffer = block_end;
+	return true;
+}
+
 
 LLVOCache::LLVOCache(bool read_only) :
 	mInitialized(false),
 	mReadOnly(read_only),
 	mCacheSize(1),
-	mNumEntries(0)
+	mNumEntries(0),
+	mIOThread(nullptr)
 {
 	mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
 	mLocalAPRFilePoolp = new LLVolatileAPRPool("VOCache Local Pool") ;
+	if(mEnabled)
+	{
+		mIOThread = new IOThread();
+	}
 }
 
 LLVOCache::~LLVOCache()
@@ -1091,6 +1333,13 @@ LLVOCache::~LLVOCache()
 		writeCacheHeader();
 		clearCacheInMemory();
 	}
+	if(mIOThread)
+	{
+		// Let the region files written on exit land
+		mIOThread->flush();
+		delete mIOThread;
+		mIOThread = nullptr;
+	}
 	delete mLocalAPRFilePoolp;
 }
 
@@ -1164,6 +1413,11 @@ void LLVOCache::removeCache(ELLPath location, bool started)
 
 	LL_INFOS() << "about to remove the object cache due to settings." << LL_ENDL ;
 
+	if(mIOThread)
+	{
+		mIOThread->flush();
+	}
+
 	std::string mask = "*";
 	std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 	LL_INFOS() << "Removing cache at " << cache_dir << LL_ENDL;
@@ -1188,6 +1442,11 @@ void LLVOCache::removeCache()
 		return ;
 	}
 
+	if(mIOThread)
+	{
+		mIOThread->flush();
+	}
+
 	std::string mask = "*";
 	LL_INFOS() << "Removing object cache at " << mObjectCacheDirName << LL_ENDL;
 	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
@@ -1267,7 +1526,10 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 
 	std::string filename;
 	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename, mLocalAPRFilePoolp);
+	if(mIOThread)
+	{
+		mIOThread->remove(filename);
+	}
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
 }
@@ -1415,12 +1677,12 @@ BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
 }
 
-void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+LLPointer<LLVOCacheRegionLoad> LLVOCache::readFromCache(U64 handle, const LLUUID& id)
 {
 	if(!mEnabled)
 	{
 		LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-		return ;
+		return nullptr;
 	}
 	llassert_always(mInitialized);
 
@@ -1428,58 +1690,62 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 	if(iter == mHandleEntryMap.end()) //no cache
 	{
 		LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
-		return ;
+		return nullptr;
 	}
 
-	bool success = true ;
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	LLPointer<LLVOCacheRegionLoad> load = new LLVOCacheRegionLoad(id, filename);
+	mIOThread->read(load);
+	return load;
+}
+
+bool LLVOCache::fetchFromCache(U64 handle, LLVOCacheRegionLoad* load, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, S32 max_entries)
+{
+	if(load->mFetched)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
-		if(success)
-		{		
-			if(cache_id != id)
-			{
-				LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-				success = false ;
-			}
+		return true;
+	}
+	if(!load->isDecoded())
+	{
+		return false;
+	}
 
-			if(success)
-			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-					{
-						LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
-			}
-		}		
+	LLVOCacheEntry::vocache_entry_map_t::iterator iter = load->mEntries.begin();
+	for (S32 count = 0; count < max_entries && iter != load->mEntries.end(); count++)
+	{
+		// An entry already in the map came from the simulator after the file was written, keep it
+		cache_entry_map.insert(*iter);
+		iter = load->mEntries.erase(iter);
 	}
-	
-	if(!success)
+	if(!load->mEntries.empty())
 	{
-		if(cache_entry_map.empty())
-		{
-			removeEntry(iter->second) ;
-		}
+		return false;
 	}
 
-	return ;
+	load->mFetched = true;
+	if(!load->mSuccess && cache_entry_map.empty())
+	{
+		removeEntry(handle);
+	}
+	return true;
+}
+
+bool LLVOCache::fetchEntryFromCache(LLVOCacheRegionLoad* load, U32 local_id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	if(load->mFetched || !load->isDecoded())
+	{
+		return false;
+	}
+
+	LLVOCacheEntry::vocache_entry_map_t::iterator iter = load->mEntries.find(local_id);
+	if(iter == load->mEntries.end())
+	{
+		return false;
+	}
+	cache_entry_map.insert(*iter);
+	load->mEntries.erase(iter);
+	return true;
 }
 	
 void LLVOCache::purgeEntries(U32 size)
@@ -1496,7 +1762,8 @@ void LLVOCache::purgeEntries(U32 size)
 	mNumEntries = mHandleEntryMap.size() ;
 }
 
-void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled) 
+void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled,
+							 const LLVOCacheRegionLoad* load)
 {
 	if(!mEnabled)
 	{
@@ -1552,39 +1819,73 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		return ; //nothing changed, no need to update.
 	}
 
-	//write to cache file
-	bool success = true ;
-	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
-
-	
-		if(success)
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+
+	// Append what changed since the file was read, as long as the deltas stay smaller than the snapshot
+	std::vector<U8> data;
+	bool append = false;
+	if(load && load->isFetched() && load->mAppendable)
+	{
+		std::vector<U8> payload;
+		std::vector<U32> removed;
+		S32 num_updates = 0;
+		append_value(payload, num_updates);
+		append_value(payload, (S32)0);
+		for (const auto& cache_entry : cache_entry_map)
 		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
+			if(removal_enabled && !cache_entry.second->isValid())
 			{
-				if(!removal_enabled || iter->second->isValid())
-				{
-					success = iter->second->writeToFile(&apr_file) ;
-					if(!success)
-					{
-						break;
-					}
-				}
+				removed.push_back(cache_entry.first);
 			}
+			else if(cache_entry.second->isDirty())
+			{
+				cache_entry.second->writeToBuffer(payload);
+				num_updates++;
+			}
+		}
+		if(!num_updates && removed.empty())
+		{
+			return; //nothing changed since the file was read.
+		}
+		for (U32 local_id : removed)
+		{
+			append_value(payload, local_id);
+		}
+		S32 num_removed = removed.size();
+		memcpy(&payload[0], &num_updates, sizeof(S32));
+		memcpy(&payload[sizeof(S32)], &num_removed, sizeof(S32));
+
+		if(load->mDeltaBytes + DELTA_HEADER_SIZE + (S32)payload.size() <= load->mBaseBytes)
+		{
+			LLCRC crc;
+			crc.update(payload.data(), payload.size());
+			data.reserve(DELTA_HEADER_SIZE + payload.size());
+			append_value(data, DELTA_MAGIC);
+			append_value(data, (U32)payload.size());
+			append_value(data, crc.getCRC());
+			data.insert(data.end(), payload.begin(), payload.end());
+			append = true;
 		}
 	}
 
-	if(!success)
+	if(!append)
 	{
-		removeEntry(entry) ;
+		// Full snapshot of the region
+		S32 num_entries = 0;
+		data.insert(data.end(), id.mData, id.mData + UUID_BYTES);
+		append_value(data, num_entries);
+		for (const auto& cache_entry : cache_entry_map)
+		{
+			if(!removal_enabled || cache_entry.second->isValid())
+			{
+				cache_entry.second->writeToBuffer(data);
+				num_entries++;
+			}
+		}
+		memcpy(&data[UUID_BYTES], &num_entries, sizeof(S32));
 	}
 
-	return ;
+	LL_DEBUGS("ObjectCache") << (append ? "Appending " : "Writing ") << data.size() << " bytes to " << filename << LL_ENDL;
+	mIOThread->write(filename, std::move(data), append);
 }
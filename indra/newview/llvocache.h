@@ -32,6 +32,9 @@
 #include "lldir.h"
 #include "llvieweroctree.h"
 #include "llapr.h"
+#include "llqueuedthread.h"
+
+#include <atomic>
 
 //---------------------------------------------------------------------------
 // Cache entries
@@ -83,7 +86,7 @@ protected:
 	~LLVOCacheEntry();
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	LLVOCacheEntry(const U8*& buffer, const U8* end); // advances buffer past the entry
 	LLVOCacheEntry();	
 
 	void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -106,7 +109,7 @@ public:
 	F32 getSceneContribution() const             { return mSceneContrib;}
 
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
+	void writeToBuffer(std::vector<U8>& buffer) const;
 	LLDataPackerBinaryBuffer *getDP();
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
@@ -130,6 +133,9 @@ public:
 	void setValid(BOOL valid = TRUE) {mValid = valid;}
 	BOOL isValid() const {return mValid;}
 
+	// Set when the entry differs from what is in the region cache file
+	bool isDirty() const {return mDirty;}
+
 	void setUpdateFlags(U32 flags) {mUpdateFlags = flags;}
 	U32  getUpdateFlags() const    {return mUpdateFlags;}
 
@@ -161,6 +167,7 @@ protected:
 	vocache_entry_set_t         mChildrenList; //children entries in a linked set.
 
 	BOOL                        mValid; //if set, this entry is valid, otherwise it is invalid and will be removed.
+	bool                        mDirty; //changed since read from the cache file.
 
 	LLVector4a                  mBSphereCenter; //bounding sphere center
 	F32                         mBSphereRadius; //bounding sphere radius
@@ -219,7 +226,42 @@ private:
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//A region cache file being decoded on the object cache thread.
+//The region moves the decoded entries into its cache map a batch at a time.
+//
+class LLVOCacheRegionLoad final : public LLThreadSafeRefCount
+{
+	friend class LLVOCache;
+public:
+	LLVOCacheRegionLoad(const LLUUID& id, std::string filename);
+
+	bool isDecoded() const { return mDecoded; }
+	bool isFetched() const { return mFetched; }
+
+	// cache thread
+	void decode(LLVolatileAPRPool* pool);
+
+private:
+	bool applyDelta(const U8*& buffer, const U8* end);
+
+	const LLUUID        mCacheID;
+	const std::string   mFilename;
+	std::atomic<bool>   mDecoded;
+
+	// written by the cache thread before mDecoded is set, main thread only after
+	LLVOCacheEntry::vocache_entry_map_t mEntries;
+	bool                mSuccess;     //cache id matched and no corruption found
+	bool                mAppendable;  //the file ends with the last good delta block
+	S32                 mBaseBytes;   //size of the full snapshot at the start of the file
+	S32                 mDeltaBytes;  //size of the delta blocks after it
+
+	// main thread
+	bool                mFetched;
+};
+
+//
+//Note: LLVOCache is not thread-safe, call it from the main thread only.
+//File IO is done on its own thread, see LLVOCache::IOThread.
 //
 class LLVOCache final : public LLParamSingleton<LLVOCache>
 {
@@ -263,8 +305,17 @@ public:
 	void initCache(ELLPath location, U32 size, U32 cache_version);
 	void removeCache(ELLPath location, bool started = false) ;
 
-	void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
-	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled);
+	// Starts decoding the region cache file on the cache thread, returns null if nothing is cached for the region.
+	LLPointer<LLVOCacheRegionLoad> readFromCache(U64 handle, const LLUUID& id);
+	// Moves up to max_entries decoded entries into cache_entry_map, keeping the ones already there.
+	// Returns true once the load is decoded and every entry has been moved.
+	bool fetchFromCache(U64 handle, LLVOCacheRegionLoad* load, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, S32 max_entries);
+	// Moves the entry for local_id alone out of a decoded load, never waits for the load.
+	bool fetchEntryFromCache(LLVOCacheRegionLoad* load, U32 local_id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+	// Queues the file write on the cache thread. When the region was loaded through load, only the
+	// entries that changed since are appended as a delta block, as long as the deltas stay small.
+	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled,
+					  const LLVOCacheRegionLoad* load);
 	void removeEntry(U64 handle) ;
 
 	U32 getCacheEntries() { return mNumEntries; }
@@ -282,6 +333,8 @@ private:
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
 	BOOL updateEntry(const HeaderEntryInfo* entry);
+
+	class IOThread;
 	
 private:
 	bool                 mEnabled;
@@ -293,6 +346,7 @@ private:
 	std::string          mHeaderFileName ;
 	std::string          mObjectCacheDirName;
 	LLVolatileAPRPool*   mLocalAPRFilePoolp ; 	
+	IOThread*            mIOThread;
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
 };
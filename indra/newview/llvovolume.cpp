@@ -87,6 +87,8 @@
 #include "llsculptidsize.h"
 #include "llavatarappearancedefines.h"
 #include "llfloaterreg.h" // <alchemy/>
+#include "lljobsystem.h"
+#include "llviewerstats.h"
 // [RLVa:KB] - Checked: RLVa-2.0.0
 #include "rlvactions.h"
 #include "rlvlocks.h"
@@ -103,6 +105,7 @@ F32 LLVOVolume::sLODFactor = 1.f;
 F32	LLVOVolume::sLODSlopDistanceFactor = 0.5f; //Changing this to zero, effectively disables the LOD transition slop 
 F32 LLVOVolume::sDistanceFactor = 1.0f;
 S32 LLVOVolume::sNumLODChanges = 0;
+LLVOVolume::volume_waiters_t LLVOVolume::sVolumeWaiters;
 S32 LLVOVolume::mRenderComplexity_last = 0;
 S32 LLVOVolume::mRenderComplexity_current = 0;
 LLPointer<LLObjectMediaDataClient> LLVOVolume::sObjectMediaClient = NULL;
@@ -239,6 +242,7 @@ LLVOVolume::LLVOVolume(const LLUUID &id, const LLPCode pcode, LLViewerRegion *re
 
 	mSkinInfoFailed = false;
 	mSkinInfo = NULL;
+	mWaitingVolume = NULL;
 
 	mMediaImplList.resize(getNumTEs());
 	mLastFetchedMediaVersion = -1;
@@ -255,6 +259,7 @@ LLVOVolume::~LLVOVolume()
 	mVolumeImpl = NULL;
 
 	gMeshRepo.unregisterMesh(this);
+	updateWaitingVolume();
 
 	if(!mMediaImplList.empty())
 	{
@@ -304,6 +309,7 @@ void LLVOVolume::markDead()
 	}
 	
 	LLViewerObject::markDead();
+	updateWaitingVolume();
 }
 
 
@@ -311,6 +317,8 @@ void LLVOVolume::markDead()
 void LLVOVolume::initClass()
 {
 	// gSavedSettings better be around
+	LLPrimitive::getVolumeManager()->setAsyncGeneration(gSavedSettings.getBOOL("RenderAsyncVolumeGeneration"), &LLVOVolume::onVolumeGenerated);
+
 	if (gSavedSettings.getBOOL("PrimMediaMasterEnabled"))
 	{
 		const F32 queue_timer_delay = gSavedSettings.getF32("PrimMediaRequestQueueDelay");
@@ -330,6 +338,11 @@ void LLVOVolume::cleanupClass()
 {
     sObjectMediaClient = NULL;
     sObjectMediaNavigateClient = NULL;
+
+	if (LLPrimitive::getVolumeManager())
+	{
+		LLPrimitive::getVolumeManager()->setAsyncGeneration(false, nullptr);
+	}
 }
 
 U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
@@ -1047,6 +1060,7 @@ BOOL LLVOVolume::setVolume(const LLVolumeParams &params_in, const S32 detail, bo
 	if ((LLPrimitive::setVolume(volume_params, lod, (mVolumeImpl && mVolumeImpl->isVolumeUnique()))) || mSculptChanged)
 	{
 		mFaceMappingChanged = TRUE;
+		updateWaitingVolume();
 		
 		if (mVolumeImpl)
 		{
@@ -1169,6 +1183,52 @@ void LLVOVolume::notifyMeshLoaded()
     updateVisualComplexity();
 }
 
+// static
+void LLVOVolume::onVolumeGenerated(LLVolume* volume)
+{
+	auto range = sVolumeWaiters.equal_range(volume);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		LLVOVolume* vobj = it->second;
+		vobj->mWaitingVolume = NULL;
+		if (vobj->mDrawable.notNull())
+		{ // same rebuild as a mesh LOD arriving
+			vobj->mSculptChanged = TRUE;
+			gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_GEOMETRY, TRUE);
+		}
+	}
+	sVolumeWaiters.erase(range.first, range.second);
+}
+
+void LLVOVolume::updateWaitingVolume()
+{
+	LLVolume* volume = getVolume();
+	const LLVolume* waiting = !mDead && volume && volume->isGenerating() ? volume : NULL;
+	if (waiting == mWaitingVolume)
+	{
+		return;
+	}
+
+	if (mWaitingVolume)
+	{
+		auto range = sVolumeWaiters.equal_range(mWaitingVolume);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == this)
+			{
+				sVolumeWaiters.erase(it);
+				break;
+			}
+		}
+	}
+
+	mWaitingVolume = waiting;
+	if (mWaitingVolume)
+	{
+		sVolumeWaiters.emplace(mWaitingVolume, this);
+	}
+}
+
 void LLVOVolume::notifySkinInfoLoaded(const LLMeshSkinInfo* skin)
 {
 	mSkinInfoFailed = false;
@@ -4849,42 +4909,21 @@ void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, cons
 			{
 				LL_RECORD_BLOCK_TIME(FTM_SKIN_RIGGED);
 
-                U32 max_joints = LLSkinningUtil::getMaxJointCount();
                 rigged_vert_count += dst_face.mNumVertices;
                 rigged_face_count++;
-				for (S32 j = 0; j < dst_face.mNumVertices; ++j)
-				{
-					LLMatrix4a final_mat;
-                    LLSkinningUtil::getPerVertexSkinMatrix(weight[j], mat, false, final_mat, max_joints);
-				
-					LLVector4a& v = vol_face.mPositions[j];
-					LLVector4a dst;
-					skin->mBindShapeMatrix.affineTransform(v, dst);
-					final_mat.affineTransform(dst, pos[j]);
-				}
+				LLSkinningUtil::skinVertices(skin, mat, maxJoints, weight, vol_face.mPositions, pos,
+											 nullptr, nullptr, dst_face.mNumVertices, dst_face.mExtents);
 
 				//update bounding box
 				// VFExtents change
-				LLVector4a& min = dst_face.mExtents[0];
-				LLVector4a& max = dst_face.mExtents[1];
-
-				min = pos[0];
-				max = pos[1];
 #if LL_DEBUG
                 if (i==0)
                 {
-                    box_min = min;
-                    box_max = max;
+                    box_min = dst_face.mExtents[0];
+                    box_max = dst_face.mExtents[1];
                 }
-#endif
-				for (S32 j = 1; j < dst_face.mNumVertices; ++j)
-				{
-					min.setMin(min, pos[j]);
-					max.setMax(max, pos[j]);
-				}
-#if LL_DEBUG
-                box_min.setMin(min,box_min);
-                box_max.setMax(max,box_max);
+                box_min.setMin(dst_face.mExtents[0],box_min);
+                box_max.setMax(dst_face.mExtents[1],box_max);
 #endif
 				dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
 				dst_face.mCenter->mul(0.5f);
@@ -4893,10 +4932,9 @@ void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, cons
 
 			{
 				LL_RECORD_BLOCK_TIME(FTM_RIGGED_OCTREE);
-				delete dst_face.mOctree;
-				dst_face.mOctree = NULL;
-
-				dst_face.createOctree(1.f);
+				// Triangles keep their nodes from pose to pose, only the bounds move.
+				// copyVolumeFaces() drops the octree, so changed faces still get a new one.
+				dst_face.refitOctree(1.f);
 			}
 		}
 	}
@@ -6304,6 +6342,7 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 		LL_RECORD_BLOCK_TIME(FTM_REBUILD_VOLUME_GEN_DRAW_INFO); //make sure getgeometryvolume shows up in the right place in timers
 
 		group->mBuilt = 1.f;
+		add(LLStatViewer::MESH_REBUILD_GROUPS, 1);
 		
 		S32 num_mapped_vertex_buffer = LLVertexBuffer::sMappedCount;
 
@@ -6425,6 +6464,218 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 //	llassert(!group || !group->isState(LLSpatialGroup::NEW_DRAWINFO));
 }
 
+static LLJobType sRebuildMeshJobType("rebuild_mesh");
+
+namespace
+{
+	// One face whose vertex data a job regenerates
+	struct LLFaceRebuild
+	{
+		LLFace* mFace;
+		LLVolume* mVolume;
+		LLMatrix4 mXform;
+		LLMatrix3 mXformInvTrans;
+		bool mFailed;
+	};
+
+	struct LLGroupRebuild
+	{
+		LLSpatialGroup* mGroup;
+		std::vector<LLDrawable*> mDrawables;
+		std::vector<LLFaceRebuild> mFaces;
+		std::vector<LLVertexBuffer*> mBuffers;
+		LLJobSystem::job_ptr_t mJob;
+
+		void run()
+		{
+			for (LLFaceRebuild& rebuild : mFaces)
+			{
+				LLFace* face = rebuild.mFace;
+				rebuild.mFailed = !face->getGeometryVolume(*rebuild.mVolume, face->getTEOffset(),
+					rebuild.mXform, rebuild.mXformInvTrans, face->getGeomIndex());
+			}
+		}
+	};
+
+	// Same selection as rebuildMesh()
+	bool needs_mesh_rebuild(LLDrawable* drawablep)
+	{
+		return drawablep && !drawablep->isDead() && drawablep->isState(LLDrawable::REBUILD_ALL) && !drawablep->isState(LLDrawable::RIGGED)
+			&& !drawablep->getVOVolume()->isNoLOD();
+	}
+
+	// True if every buffer the group's rebuild writes can be handed to a job
+	bool can_rebuild_mesh_off_thread(LLSpatialGroup* group)
+	{
+		for (LLSpatialGroup::element_iter drawable_iter = group->getDataBegin(), drawable_iter_end = group->getDataEnd(); drawable_iter != drawable_iter_end; ++drawable_iter)
+		{
+			LLDrawable* drawablep = (LLDrawable*)(*drawable_iter)->getDrawable();
+			if (!needs_mesh_rebuild(drawablep))
+			{
+				continue;
+			}
+			for (S32 i = 0; i < drawablep->getNumFaces(); ++i)
+			{
+				LLFace* face = drawablep->getFace(i);
+				LLVertexBuffer* buff = face ? face->getVertexBuffer() : nullptr;
+				if (buff && !buff->canClientWrite())
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+//static
+void LLVolumeGeometryManager::rebuildMeshes(const LLSpatialGroup::sg_vector_t& groups)
+{
+	if (!LLPipeline::RenderParallelMeshRebuild || !LLJobSystem::instanceExists())
+	{
+		for (LLSpatialGroup* group : groups)
+		{
+			group->rebuildMesh();
+		}
+		return;
+	}
+
+	LL_RECORD_BLOCK_TIME(FTM_REBUILD_VOLUME_VB);
+
+	// Everything touching the objects, their volumes or GL happens here, jobs only run getGeometryVolume()
+	std::vector<LLGroupRebuild> rebuilds;
+	for (LLSpatialGroup* group : groups)
+	{
+		if (group->isDead() || !group->hasState(LLSpatialGroup::MESH_DIRTY) || group->hasState(LLSpatialGroup::GEOM_DIRTY))
+		{
+			continue;
+		}
+		if (!dynamic_cast<LLVolumeGeometryManager*>(group->getSpatialPartition()) || !can_rebuild_mesh_off_thread(group))
+		{
+			group->rebuildMesh();
+			continue;
+		}
+
+		group->mBuilt = 1.f;
+		rebuilds.emplace_back();
+		LLGroupRebuild& rebuild = rebuilds.back();
+		rebuild.mGroup = group;
+
+		for (LLSpatialGroup::element_iter drawable_iter = group->getDataBegin(), drawable_iter_end = group->getDataEnd(); drawable_iter != drawable_iter_end; ++drawable_iter)
+		{
+			LLDrawable* drawablep = (LLDrawable*)(*drawable_iter)->getDrawable();
+			if (!needs_mesh_rebuild(drawablep))
+			{
+				continue;
+			}
+
+			LLVOVolume* vobj = drawablep->getVOVolume();
+			vobj->preRebuild();
+
+			if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+			{
+				vobj->updateRelativeXform(true);
+			}
+
+			LLVolume* volume = vobj->getVolume();
+			for (S32 i = 0; i < drawablep->getNumFaces(); ++i)
+			{
+				LLFace* face = drawablep->getFace(i);
+				LLVertexBuffer* buff = face ? face->getVertexBuffer() : nullptr;
+				if (!buff)
+				{
+					continue;
+				}
+				llassert(!face->isState(LLFace::RIGGED));
+
+				// Volumes are shared between objects, generate the tangents a job could otherwise race for
+				const LLTextureEntry* te = face->getTextureEntry();
+				if (face->getTEOffset() < volume->getNumVolumeFaces() &&
+					(buff->hasDataType(LLVertexBuffer::TYPE_TANGENT) ||
+					 (te && (te->getBumpmap() || te->getTexGen() != LLTextureEntry::TEX_GEN_DEFAULT))))
+				{
+					volume->genTangents(face->getTEOffset());
+				}
+
+				LLFaceRebuild face_rebuild = { face, volume, vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), false };
+				rebuild.mFaces.push_back(face_rebuild);
+
+				if (std::find(rebuild.mBuffers.begin(), rebuild.mBuffers.end(), buff) == rebuild.mBuffers.end())
+				{
+					buff->beginClientWrite();
+					rebuild.mBuffers.push_back(buff);
+				}
+			}
+
+			if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+			{
+				vobj->updateRelativeXform();
+			}
+
+			// REBUILD_ALL stays set until the job is done, getGeometryVolume() reads it
+			rebuild.mDrawables.push_back(drawablep);
+		}
+	}
+
+	// A group's buffers only hold that group's faces, so each job has its buffers to itself
+	for (LLGroupRebuild& rebuild : rebuilds)
+	{
+		if (rebuild.mFaces.empty())
+		{
+			continue;
+		}
+		LLGroupRebuild* rebuildp = &rebuild;
+		rebuild.mJob = LLJobSystem::getInstance()->submit(sRebuildMeshJobType, [rebuildp]() { rebuildp->run(); }, LLJobSystem::PRIORITY_HIGH);
+	}
+
+	for (LLGroupRebuild& rebuild : rebuilds)
+	{
+		LLSpatialGroup* group = rebuild.mGroup;
+		if (rebuild.mJob.notNull())
+		{
+			// Only picks up other rebuild jobs while waiting, never background IO
+			LLJobSystem::getInstance()->wait(rebuild.mJob);
+		}
+		else
+		{ //nothing to do, or the job system is shutting down
+			rebuild.run();
+		}
+
+		for (const LLFaceRebuild& face_rebuild : rebuild.mFaces)
+		{
+			if (face_rebuild.mFailed)
+			{ //something's gone wrong with the vertex buffer accounting, rebuild this group
+				group->dirtyGeom();
+				gPipeline.markRebuild(group, TRUE);
+				break;
+			}
+		}
+
+		for (LLDrawable* drawablep : rebuild.mDrawables)
+		{
+			drawablep->clearState(LLDrawable::REBUILD_ALL);
+		}
+
+		{
+			LL_RECORD_BLOCK_TIME(FTM_REBUILD_MESH_FLUSH);
+			for (LLVertexBuffer* buff : rebuild.mBuffers)
+			{
+				buff->flush();
+			}
+
+			// don't forget alpha
+			if (group->mVertexBuffer.notNull() && group->mVertexBuffer->isLocked())
+			{
+				group->mVertexBuffer->flush();
+			}
+		}
+
+		group->clearState(LLSpatialGroup::MESH_DIRTY | LLSpatialGroup::NEW_DRAWINFO);
+	}
+
+	add(LLStatViewer::MESH_REBUILD_GROUPS, (F64)rebuilds.size());
+}
+
 struct CompareBatchBreakerModified
 {
 	bool operator()(const LLFace* const& lhs, const LLFace* const& rhs)
@@ -36,6 +36,7 @@
 #include "m4math.h"		// LLMatrix4
 #include <map>
 #include <set>
+#include <unordered_map>
 
 
 class LLViewerTextureAnim;
@@ -334,6 +335,8 @@ public:
     void updateVisualComplexity();
     
 	void notifyMeshLoaded();
+	// Called by the volume manager once the faces of a shared prim volume are in
+	static void onVolumeGenerated(LLVolume* volume);
 	void notifySkinInfoLoaded(const LLMeshSkinInfo* skin);
 	void notifySkinInfoUnavailable();
 	
@@ -418,6 +421,10 @@ private:
 
 	bool mSkinInfoFailed;
 	const LLMeshSkinInfo *mSkinInfo;
+
+	// Registers with onVolumeGenerated() while the volume's faces are being generated
+	void updateWaitingVolume();
+	const LLVolume* mWaitingVolume;
 	
 	// statics
 public:
@@ -431,6 +438,9 @@ public:
 protected:
 	static S32 sNumLODChanges;
 
+	typedef std::unordered_multimap<const LLVolume*, LLVOVolume*> volume_waiters_t;
+	static volume_waiters_t sVolumeWaiters;
+
 	friend class LLVolumeImplFlexible;
 
 public:
@@ -103,6 +103,7 @@
 #include "llwlparammanager.h"
 #include "llwaterparammanager.h"
 #include "llspatialpartition.h"
+#include "lljobsystem.h"
 #include "llmutelist.h"
 #include "lltoolpie.h"
 #include "llnotifications.h"
@@ -218,6 +219,8 @@ F32 LLPipeline::RenderAutoHideSurfaceAreaLimit;
 BOOL LLPipeline::RenderDeferredAlwaysSoftenShadows;
 BOOL LLPipeline::RenderAggressiveBatching;
 BOOL LLPipeline::RenderDeferredFullbright;
+BOOL LLPipeline::RenderParallelCull;
+BOOL LLPipeline::RenderParallelMeshRebuild;
 
 LLTrace::EventStatHandle<S64> LLPipeline::sStatBatchSize("renderbatchsize");
 
@@ -472,6 +475,7 @@ void LLPipeline::init()
 	LLVertexBuffer::sUseStreamDraw = gSavedSettings.getBOOL("RenderUseStreamVBO");
 	LLVertexBuffer::sUseVAO = gSavedSettings.getBOOL("RenderUseVAO");
 	LLVertexBuffer::sPreferStreamDraw = gSavedSettings.getBOOL("RenderPreferStreamDraw");
+	LLVertexBuffer::sUseStreamRing = gSavedSettings.getBOOL("RenderStreamRing");
 	sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
 	sRenderAttachedParticles = gSavedSettings.getBOOL("RenderAttachedParticles");
 
@@ -640,6 +644,8 @@ void LLPipeline::init()
 	connectRefreshCachedSettingsSafe("RenderDeferredAlwaysSoftenShadows");
 	connectRefreshCachedSettingsSafe("RenderAggressiveBatching");
 	connectRefreshCachedSettingsSafe("RenderDeferredFullbright");
+	connectRefreshCachedSettingsSafe("RenderParallelCull");
+	connectRefreshCachedSettingsSafe("RenderParallelMeshRebuild");
 }
 
 LLPipeline::~LLPipeline()
@@ -1186,6 +1192,8 @@ void LLPipeline::refreshCachedSettings()
 	RenderDeferredAlwaysSoftenShadows = gSavedSettings.getBOOL("RenderDeferredAlwaysSoftenShadows");
 	RenderAggressiveBatching = gSavedSettings.getBOOL("RenderAggressiveBatching");
 	RenderDeferredFullbright = gSavedSettings.getBOOL("RenderDeferredFullbright");
+	RenderParallelCull = gSavedSettings.getBOOL("RenderParallelCull");
+	RenderParallelMeshRebuild = gSavedSettings.getBOOL("RenderParallelMeshRebuild");
 	
 	updateRenderDeferred();
 }
@@ -2401,6 +2409,8 @@ bool LLPipeline::getVisibleExtents(LLCamera& camera, LLVector3& min, LLVector3&
 
 static LLTrace::BlockTimerStatHandle FTM_CULL("Object Culling");
 
+static LLJobType sCullJobType("cull");
+
 void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_clip, LLPlane* planep, bool hud_attachments)
 {
 	static LLCachedControl<bool> use_occlusion(gSavedSettings,"UseOcclusion");
@@ -2492,6 +2502,12 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 		mCubeVB->setBuffer(LLVertexBuffer::MAP_VERTEX);
 	}
 	
+	// Partitions only share the cull result, so each one can be culled by a job into its own
+	// result, merged back in region and partition order once they are all done
+	const bool parallel_cull = RenderParallelCull && LLJobSystem::instanceExists();
+	LLJobSystem::job_list_t cull_jobs;
+	U32 deferred_count = 0;
+
 	for(LLViewerRegion* region : LLWorld::getInstance()->getRegionList())
 	{
 		if (water_clip != 0)
@@ -2511,7 +2527,23 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 			{
 				if (!hud_attachments ? LLViewerRegion::PARTITION_BRIDGE == i || hasRenderType(part->mDrawableType) : hasRenderType(part->mDrawableType))
 				{
-					part->cull(camera);
+					if (!parallel_cull)
+					{
+						part->cull(camera);
+						continue;
+					}
+
+					// Moving dirty groups around is not safe off the main thread
+					part->rebound();
+
+					if (deferred_count == mDeferredCulls.size())
+					{
+						mDeferredCulls.emplace_back(new LLDeferredCull);
+					}
+					LLDeferredCull* deferred = mDeferredCulls[deferred_count++].get();
+					deferred->reset(part, camera);
+					cull_jobs.push_back(LLJobSystem::getInstance()->submit(sCullJobType,
+						[deferred]() { deferred->cull(); }, LLJobSystem::PRIORITY_HIGH));
 				}
 			}
 		}
@@ -2525,6 +2557,30 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 		}
 	}
 
+	if (deferred_count)
+	{
+		// Waiting only ever lends a hand with other cull jobs, never with background IO
+		for (const LLJobSystem::job_ptr_t& job : cull_jobs)
+		{
+			if (job)
+			{
+				LLJobSystem::getInstance()->wait(job);
+			}
+		}
+
+		for (U32 i = 0; i < deferred_count; ++i)
+		{
+			LLDeferredCull* deferred = mDeferredCulls[i].get();
+			if (cull_jobs[i].isNull())
+			{ //job system is shutting down
+				deferred->cull();
+			}
+			deferred->finish();
+			sCull->append(deferred->mResult);
+			mNumVisibleNodes += deferred->mVisibleNodes;
+		}
+	}
+
 	if (bound_shader)
 	{
 		gOcclusionCubeProgram.unbind();
@@ -2570,6 +2626,12 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 }
 
 void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera)
+{
+	markNotCulled(group, camera, *sCull, mNumVisibleNodes);
+}
+
+void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera, LLCullResult& result, S32& visible_nodes,
+								std::vector<LLSpatialGroup*>* rebuild_groups)
 {
 	if (group->isEmpty())
 	{ 
@@ -2580,7 +2642,7 @@ void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera)
 
 	if (LLViewerCamera::sCurCameraID == LLViewerCamera::CAMERA_WORLD)
 	{
-		group->updateDistance(camera);
+		group->updateDistance(camera, rebuild_groups);
 	}
 	
 	const F32 MINIMUM_PIXEL_AREA = 16.f;
@@ -2601,17 +2663,22 @@ void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera)
 	
 	if (!group->getSpatialPartition()->mRenderByGroup)
 	{ //render by drawable
-		sCull->pushDrawableGroup(group);
+		result.pushDrawableGroup(group);
 	}
 	else
 	{   //render by group
-		sCull->pushVisibleGroup(group);
+		result.pushVisibleGroup(group);
 	}
 
-	mNumVisibleNodes++;
+	visible_nodes++;
 }
 
 void LLPipeline::markOccluder(LLSpatialGroup* group)
+{
+	markOccluder(group, *sCull);
+}
+
+void LLPipeline::markOccluder(LLSpatialGroup* group, LLCullResult& result)
 {
 	if (sUseOcclusion > 1 && group && !group->isOcclusionState(LLSpatialGroup::ACTIVE_OCCLUSION))
 	{
@@ -2619,7 +2686,7 @@ void LLPipeline::markOccluder(LLSpatialGroup* group)
 
 		if (!parent || !parent->isOcclusionState(LLSpatialGroup::OCCLUDED))
 		{ //only mark top most occluders as active occlusion
-			sCull->pushOcclusionGroup(group);
+			result.pushOcclusionGroup(group);
 			group->setOcclusionState(LLSpatialGroup::ACTIVE_OCCLUSION);
 				
 			if (parent && 
@@ -2627,7 +2694,7 @@ void LLPipeline::markOccluder(LLSpatialGroup* group)
 				parent->getElementCount() == 0 &&
 				parent->needsUpdate())
 			{
-				sCull->pushOcclusionGroup(group);
+				result.pushOcclusionGroup(group);
 				parent->setOcclusionState(LLSpatialGroup::ACTIVE_OCCLUSION);
 			}
 		}
@@ -3832,10 +3899,7 @@ void LLPipeline::postSort(LLCamera& camera)
 	}
 
 	//pack vertex buffers for groups that chose to delay their updates
-	for(LLSpatialGroup* group : mMeshDirtyGroup)
-	{
-		group->rebuildMesh();
-	}
+	LLVolumeGeometryManager::rebuildMeshes(mMeshDirtyGroup);
 
 	mMeshDirtyGroup.clear();
 
@@ -6919,6 +6983,7 @@ void LLPipeline::doResetVertexBuffers(bool forced)
 	LLVertexBuffer::sUseStreamDraw = gSavedSettings.getBOOL("RenderUseStreamVBO");
 	LLVertexBuffer::sUseVAO = gSavedSettings.getBOOL("RenderUseVAO");
 	LLVertexBuffer::sPreferStreamDraw = gSavedSettings.getBOOL("RenderPreferStreamDraw");
+	LLVertexBuffer::sUseStreamRing = gSavedSettings.getBOOL("RenderStreamRing");
 	LLVertexBuffer::sEnableVBOs = gSavedSettings.getBOOL("RenderVBOEnable");
 	LLVertexBuffer::sDisableVBOMapping = LLVertexBuffer::sEnableVBOs && gSavedSettings.getBOOL("RenderVBOMappingDisable") ;
 	sNoAlpha = gSavedSettings.getBOOL("RenderNoAlpha");
@@ -39,6 +39,7 @@
 #include "lldrawable.h"
 #include "llrendertarget.h"
 
+#include <memory>
 #include <stack>
 #include <glm/mat4x4.hpp>
 
@@ -161,9 +162,13 @@ public:
 	// Object related methods
 	void        markVisible(LLDrawable *drawablep, LLCamera& camera);
 	void		markOccluder(LLSpatialGroup* group);
+	void		markOccluder(LLSpatialGroup* group, LLCullResult& result);
 
 	void		doOcclusion(LLCamera& camera);
 	void		markNotCulled(LLSpatialGroup* group, LLCamera &camera);
+	// Safe on worker threads for groups of a partition no other thread is culling
+	void		markNotCulled(LLSpatialGroup* group, LLCamera &camera, LLCullResult& result, S32& visible_nodes,
+							  std::vector<LLSpatialGroup*>* rebuild_groups = nullptr);
 	void        markMoved(LLDrawable *drawablep, bool damped_motion = false);
 	void        markShift(LLDrawable *drawablep);
 	void        markTextured(LLDrawable *drawablep);
@@ -606,6 +611,9 @@ public:
 	//utility buffer for rendering cubes, 8 vertices are corners of a cube [-1, 1]
 	LLPointer<LLVertexBuffer> mCubeVB;
 
+	//per partition culls handed to the job system by updateCull, reused every frame
+	std::vector<std::unique_ptr<LLDeferredCull> > mDeferredCulls;
+
 	//sun shadow map
 	LLRenderTarget			mShadow[6];
 	std::vector<LLVector3>	mShadowFrustPoints[4];
@@ -925,6 +933,8 @@ public:
 	static BOOL RenderDeferredAlwaysSoftenShadows;
 	static BOOL RenderAggressiveBatching;
 	static BOOL RenderDeferredFullbright;
+	static BOOL RenderParallelCull;
+	static BOOL RenderParallelMeshRebuild;
 };
 
 void render_hud_elements();
@@ -0,0 +1,307 @@
+/**
+ * @file llmeshheaderindex_test.cpp
+ * @brief Tests for the persistent mesh header index
+ *
+ * @cond
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ * @endcond
+ */
+
+#include "linden_common.h"
+
+#include "../llmeshheaderindex.h"
+
+#include "llfile.h"
+#include "llsd.h"
+
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	LLMeshHeaderIndex::Record make_record(S32 n)
+	{
+		LLMeshHeaderIndex::Record record;
+		record.mVersion = 1;
+		record.mHeaderSize = 100 + n;
+		for (S32 i = 0; i < LLMeshHeaderIndex::NUM_RANGES; ++i)
+		{
+			record.mOffset[i] = n * 1000 + i * 10;
+			record.mSize[i] = i + 1;
+		}
+		return record;
+	}
+}
+
+namespace tut
+{
+	struct meshheaderindex_data
+	{
+		meshheaderindex_data()
+		{
+			LLUUID id;
+			id.generate();
+			mFileName = std::string(LLFile::tmpdir()) + "llmeshheaderindex_test_" + id.asString();
+		}
+
+		~meshheaderindex_data()
+		{
+			LLFile::remove(mFileName, ENOENT);
+		}
+
+		std::vector<U8> readFile() const
+		{
+			std::vector<U8> data;
+			LLFILE* file = LLFile::fopen(mFileName, "rb");
+			if (file)
+			{
+				U8 buffer[4096];
+				size_t bytes;
+				while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+				{
+					data.insert(data.end(), buffer, buffer + bytes);
+				}
+				fclose(file);
+			}
+			return data;
+		}
+
+		void writeFile(const U8* data, size_t size) const
+		{
+			LLFILE* file = LLFile::fopen(mFileName, "wb");
+			ensure("file written", file && fwrite(data, 1, size, file) == size);
+			fclose(file);
+		}
+
+		static std::vector<LLUUID> makeIDs(U32 count)
+		{
+			std::vector<LLUUID> ids(count);
+			for (LLUUID& id : ids)
+			{
+				id.generate();
+			}
+			return ids;
+		}
+
+		static void ensureRecord(const std::string& msg, const LLMeshHeaderIndex::Record& record, S32 n)
+		{
+			const LLMeshHeaderIndex::Record expected = make_record(n);
+			ensure_equals(msg + " version", record.mVersion, expected.mVersion);
+			ensure_equals(msg + " header size", record.mHeaderSize, expected.mHeaderSize);
+			for (S32 i = 0; i < LLMeshHeaderIndex::NUM_RANGES; ++i)
+			{
+				ensure_equals(msg + " offset", record.mOffset[i], expected.mOffset[i]);
+				ensure_equals(msg + " size", record.mSize[i], expected.mSize[i]);
+			}
+		}
+
+		std::string mFileName;
+	};
+	typedef test_group<meshheaderindex_data> meshheaderindex_test;
+	typedef meshheaderindex_test::object meshheaderindex_object;
+	tut::meshheaderindex_test meshheaderindex("LLMeshHeaderIndex");
+
+	template<> template<>
+	void meshheaderindex_object::test<1>()
+	{
+		set_test_name("Insert and find across sessions");
+		LLMeshHeaderIndex::Record record;
+		const std::vector<LLUUID> ids = makeIDs(100);
+		{
+			LLMeshHeaderIndex index;
+			ensure("closed index finds nothing", !index.find(ids[0], record));
+			ensure("opened", index.open(mFileName, false));
+			ensure_equals("starts empty", index.size(), 0U);
+			for (S32 i = 0; i < (S32)ids.size(); ++i)
+			{
+				index.insert(ids[i], make_record(i));
+			}
+			ensure_equals("all inserted", index.size(), 100U);
+			ensure("found", index.find(ids[42], record));
+			ensureRecord("record", record, 42);
+			ensure("unknown id", !index.find(LLUUID::generateNewID(), record));
+			ensure("null id", !index.find(LLUUID::null, record));
+
+			// Inserting a known id updates it in place
+			index.insert(ids[5], make_record(500));
+			ensure_equals("no new record", index.size(), 100U);
+		}
+
+		LLMeshHeaderIndex index;
+		ensure("opened again", index.open(mFileName, false));
+		ensure_equals("records kept", index.size(), 100U);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			ensure("found again", index.find(ids[i], record));
+			ensureRecord("kept", record, i == 5 ? 500 : i);
+		}
+	}
+
+	template<> template<>
+	void meshheaderindex_object::test<2>()
+	{
+		set_test_name("Collisions and growth");
+		// Past three quarters of the smallest table, so ids share probe runs
+		// and the table is rehashed into a larger one on the way
+		const std::vector<LLUUID> ids = makeIDs(5000);
+		LLMeshHeaderIndex index;
+		ensure("opened", index.open(mFileName, false));
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			index.insert(ids[i], make_record(i));
+		}
+		ensure_equals("all inserted", index.size(), (U32)ids.size());
+
+		LLMeshHeaderIndex::Record record;
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			ensure("found", index.find(ids[i], record));
+			ensureRecord("record", record, i);
+		}
+		const std::vector<LLUUID> unknown = makeIDs(1000);
+		for (const LLUUID& id : unknown)
+		{
+			ensure("unknown id", !index.find(id, record));
+		}
+	}
+
+	template<> template<>
+	void meshheaderindex_object::test<3>()
+	{
+		set_test_name("Damaged record reads as a miss");
+		const std::vector<LLUUID> ids = makeIDs(10);
+		{
+			LLMeshHeaderIndex index;
+			ensure("opened", index.open(mFileName, false));
+			for (S32 i = 0; i < (S32)ids.size(); ++i)
+			{
+				index.insert(ids[i], make_record(i));
+			}
+		}
+
+		// Flip a bit in the ranges of the third record
+		std::vector<U8> data = readFile();
+		size_t slot = 0;
+		for (size_t pos = 0; pos + UUID_BYTES <= data.size(); ++pos)
+		{
+			if (!memcmp(&data[pos], ids[2].mData, UUID_BYTES))
+			{
+				slot = pos;
+				break;
+			}
+		}
+		ensure("record in the file", slot != 0);
+		const size_t range = slot + UUID_BYTES + 3 * sizeof(U32);
+		ensure("range in the file", range < data.size());
+		data[range] ^= 0x10;
+		writeFile(data.data(), data.size());
+
+		LLMeshHeaderIndex index;
+		ensure("opened damaged", index.open(mFileName, false));
+		LLMeshHeaderIndex::Record record;
+		ensure("damaged record missed", !index.find(ids[2], record));
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			if (i != 2)
+			{
+				ensure("others found", index.find(ids[i], record));
+				ensureRecord("others", record, i);
+			}
+		}
+
+		// Written again on the next header fetch
+		index.insert(ids[2], make_record(2));
+		ensure("rewritten", index.find(ids[2], record));
+		ensureRecord("rewritten", record, 2);
+	}
+
+	template<> template<>
+	void meshheaderindex_object::test<4>()
+	{
+		set_test_name("Truncated file starts over");
+		const std::vector<LLUUID> ids = makeIDs(10);
+		{
+			LLMeshHeaderIndex index;
+			ensure("opened", index.open(mFileName, false));
+			for (S32 i = 0; i < (S32)ids.size(); ++i)
+			{
+				index.insert(ids[i], make_record(i));
+			}
+		}
+
+		std::vector<U8> data = readFile();
+		ensure("file written", data.size() > 1000);
+		writeFile(data.data(), data.size() / 2);
+
+		LLMeshHeaderIndex::Record record;
+		{
+			LLMeshHeaderIndex index;
+			ensure("opened truncated", index.open(mFileName, false));
+			ensure_equals("starts over", index.size(), 0U);
+			ensure("nothing found", !index.find(ids[0], record));
+			index.insert(ids[0], make_record(0));
+			ensure("usable", index.find(ids[0], record));
+		}
+		ensure_equals("full size again", readFile().size(), data.size());
+
+		// Too short to even hold the header
+		writeFile(data.data(), 8);
+		LLMeshHeaderIndex index;
+		ensure("opened stub", index.open(mFileName, false));
+		ensure_equals("empty", index.size(), 0U);
+		ensure("nothing kept", !index.find(ids[0], record));
+	}
+
+	template<> template<>
+	void meshheaderindex_object::test<5>()
+	{
+		set_test_name("Header round trip");
+		LLSD header;
+		header["version"] = 1;
+		header["lowest_lod"]["offset"] = 0;
+		header["lowest_lod"]["size"] = 100;
+		header["high_lod"]["offset"] = 100;
+		header["high_lod"]["size"] = 2000;
+		header["skin"]["offset"] = 2100;
+		header["skin"]["size"] = 30;
+
+		LLMeshHeaderIndex::Record record;
+		ensure("indexed", LLMeshHeaderIndex::fromHeader(header, 512, record));
+		ensure_equals("header size", record.mHeaderSize, 512U);
+		ensure_equals("missing range", record.mOffset[LLMeshHeaderIndex::LOW_LOD], -1);
+
+		LLSD rebuilt;
+		LLMeshHeaderIndex::toHeader(record, rebuilt);
+		ensure_equals("version", rebuilt["version"].asInteger(), 1);
+		ensure_equals("high offset", rebuilt["high_lod"]["offset"].asInteger(), 100);
+		ensure_equals("high size", rebuilt["high_lod"]["size"].asInteger(), 2000);
+		ensure_equals("skin size", rebuilt["skin"]["size"].asInteger(), 30);
+		ensure("no low lod", !rebuilt.has("low_lod"));
+
+		ensure("404 not indexed", !LLMeshHeaderIndex::fromHeader(LLSD().with("404", 1), 512, record));
+		LLSD skin_only;
+		skin_only["skin"]["offset"] = 0;
+		skin_only["skin"]["size"] = 30;
+		ensure("no lod not indexed", !LLMeshHeaderIndex::fromHeader(skin_only, 512, record));
+	}
+}
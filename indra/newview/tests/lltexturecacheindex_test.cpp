@@ -0,0 +1,249 @@
+/**
+ * @file lltexturecacheindex_test.cpp
+ * @brief Tests for the memory mapped texture cache index
+ *
+ * @cond
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2020, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ * @endcond
+ */
+
+#include "linden_common.h"
+
+#include "../lltexturecacheindex.h"
+
+#include "llfile.h"
+
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// Stands in for the texture.entries stamp
+	const U64 STAMP = 0x5e5e5e5e12345678ULL;
+}
+
+namespace tut
+{
+	struct texturecacheindex_data
+	{
+		texturecacheindex_data()
+		{
+			LLUUID id;
+			id.generate();
+			mFileName = std::string(LLFile::tmpdir()) + "lltexturecacheindex_test_" + id.asString();
+		}
+
+		~texturecacheindex_data()
+		{
+			LLFile::remove(mFileName, ENOENT);
+		}
+
+		S64 fileSize() const
+		{
+			llstat file_status;
+			return LLFile::stat(mFileName, &file_status) == 0 ? (S64)file_status.st_size : 0;
+		}
+
+		static std::vector<LLUUID> makeIDs(U32 count)
+		{
+			std::vector<LLUUID> ids(count);
+			for (LLUUID& id : ids)
+			{
+				id.generate();
+			}
+			return ids;
+		}
+
+		std::string mFileName;
+	};
+	typedef test_group<texturecacheindex_data> texturecacheindex_test;
+	typedef texturecacheindex_test::object texturecacheindex_object;
+	tut::texturecacheindex_test texturecacheindex("LLTextureCacheIndex");
+
+	template<> template<>
+	void texturecacheindex_object::test<1>()
+	{
+		set_test_name("Insert and find");
+		LLTextureCacheIndex index;
+		LLTextureCacheIndex::Record record;
+		ensure("closed index finds nothing", !index.find(LLUUID::generateNewID(), record));
+		ensure("opened", index.open(mFileName, 100, false));
+		ensure("open", index.isOpen());
+		ensure_equals("starts empty", index.size(), 0U);
+
+		const std::vector<LLUUID> ids = makeIDs(100);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			index.insert(ids[i], LLTextureCacheIndex::Record(i, i * 10, i * 100));
+		}
+		ensure_equals("all inserted", index.size(), 100U);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			ensure("found", index.find(ids[i], record));
+			ensure_equals("entry", record.mEntry, i);
+			ensure_equals("image size", record.mImageSize, i * 10);
+			ensure_equals("body size", record.mBodySize, i * 100);
+		}
+		ensure("unknown id", !index.find(LLUUID::generateNewID(), record));
+
+		// Inserting a known id updates it in place
+		index.insert(ids[5], LLTextureCacheIndex::Record(500, 1, 2));
+		ensure_equals("no new record", index.size(), 100U);
+		ensure("found updated", index.find(ids[5], record));
+		ensure_equals("updated entry", record.mEntry, 500);
+		ensure_equals("updated body size", record.mBodySize, 2);
+	}
+
+	template<> template<>
+	void texturecacheindex_object::test<2>()
+	{
+		set_test_name("Erase and clear");
+		LLTextureCacheIndex index;
+		ensure("opened", index.open(mFileName, 100, false));
+		const std::vector<LLUUID> ids = makeIDs(50);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			index.insert(ids[i], LLTextureCacheIndex::Record(i, 0, 0));
+		}
+
+		LLTextureCacheIndex::Record record;
+		index.erase(ids[10]);
+		ensure_equals("one less", index.size(), 49U);
+		ensure("erased", !index.find(ids[10], record));
+		index.erase(ids[10]);
+		index.erase(LLUUID::generateNewID());
+		ensure_equals("erasing again changes nothing", index.size(), 49U);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			ensure_equals("others kept", index.find(ids[i], record), i != 10);
+		}
+
+		// The tombstone goes back to the same id
+		index.insert(ids[10], LLTextureCacheIndex::Record(77, 0, 0));
+		ensure_equals("back again", index.size(), 50U);
+		ensure("found again", index.find(ids[10], record));
+		ensure_equals("new entry", record.mEntry, 77);
+
+		index.clear();
+		ensure_equals("cleared", index.size(), 0U);
+		ensure_equals("cleared body total", index.getBodySizeTotal(), S64(0));
+		for (const LLUUID& id : ids)
+		{
+			ensure("nothing left", !index.find(id, record));
+		}
+		index.insert(ids[0], LLTextureCacheIndex::Record(1, 0, 0));
+		ensure("usable after clear", index.find(ids[0], record));
+		ensure_equals("one record", index.size(), 1U);
+	}
+
+	template<> template<>
+	void texturecacheindex_object::test<3>()
+	{
+		set_test_name("Clean state across sessions");
+		const std::vector<LLUUID> ids = makeIDs(20);
+		{
+			LLTextureCacheIndex index;
+			ensure("opened", index.open(mFileName, 100, false));
+			ensure("new index isn't valid", !index.isValidFor(0, STAMP));
+			for (S32 i = 0; i < (S32)ids.size(); ++i)
+			{
+				index.insert(ids[i], LLTextureCacheIndex::Record(i, 0, 10));
+			}
+			index.markClean(20, STAMP, 200);
+			ensure("clean", index.isValidFor(20, STAMP));
+			ensure("only for its entries", !index.isValidFor(21, STAMP));
+			ensure("only for its entries file", !index.isValidFor(20, STAMP + 1));
+		}
+
+		LLTextureCacheIndex::Record record;
+		{
+			LLTextureCacheIndex index;
+			ensure("opened again", index.open(mFileName, 100, false));
+			ensure("still clean", index.isValidFor(20, STAMP));
+			ensure_equals("body total", index.getBodySizeTotal(), S64(200));
+			ensure_equals("records kept", index.size(), 20U);
+			ensure("record kept", index.find(ids[19], record));
+			ensure_equals("kept entry", record.mEntry, 19);
+
+			// A session ending without markClean leaves it dirty
+			index.erase(ids[0]);
+			ensure("dirty once changed", !index.isValidFor(20, STAMP));
+		}
+
+		{
+			LLTextureCacheIndex index;
+			ensure("opened dirty", index.open(mFileName, 100, false));
+			ensure("still dirty", !index.isValidFor(20, STAMP));
+
+			// Changes made read only never reach the file
+			index.close();
+			ensure("opened read only", index.open(mFileName, 100, true));
+			index.insert(ids[0], LLTextureCacheIndex::Record(0, 0, 0));
+			index.markClean(20, STAMP, 200);
+			ensure("clean in memory", index.isValidFor(20, STAMP));
+		}
+
+		LLTextureCacheIndex index;
+		ensure("opened after read only", index.open(mFileName, 100, false));
+		ensure("file still dirty", !index.isValidFor(20, STAMP));
+		ensure("read only insert dropped", !index.find(ids[0], record));
+	}
+
+	template<> template<>
+	void texturecacheindex_object::test<4>()
+	{
+		set_test_name("Growing the cache remaps the index");
+		const std::vector<LLUUID> ids = makeIDs(3000);
+		{
+			LLTextureCacheIndex index;
+			ensure("opened", index.open(mFileName, 100, false));
+			index.insert(ids[0], LLTextureCacheIndex::Record(0, 0, 0));
+			index.markClean(1, STAMP, 0);
+		}
+		const S64 small_size = fileSize();
+
+		// Sized for another cache, so it is laid out again for the larger one
+		LLTextureCacheIndex index;
+		ensure("opened larger", index.open(mFileName, (U32)ids.size(), false));
+		ensure("file grew", fileSize() > small_size);
+		ensure_equals("starts over", index.size(), 0U);
+		ensure("needs a rebuild", !index.isValidFor(1, STAMP));
+
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			index.insert(ids[i], LLTextureCacheIndex::Record(i, 0, 0));
+		}
+		ensure_equals("all inserted", index.size(), (U32)ids.size());
+		index.markClean((U32)ids.size(), STAMP, 0);
+		index.close();
+
+		ensure("opened at the larger size", index.open(mFileName, (U32)ids.size(), false));
+		ensure("clean at the larger size", index.isValidFor((U32)ids.size(), STAMP));
+		LLTextureCacheIndex::Record record;
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			ensure("found after growing", index.find(ids[i], record));
+			ensure_equals("entry after growing", record.mEntry, i);
+		}
+	}
+}
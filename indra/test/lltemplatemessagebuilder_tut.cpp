@@ -29,12 +29,17 @@
 #include "linden_common.h"
 #include "lltut.h"
 
+#include <iostream>
+
 #include "llapr.h"
+#include "lldecodedmessage.h"
 #include "llmessagetemplate.h"
 #include "llmath.h"
 #include "llquaternion.h"
 #include "lltemplatemessagebuilder.h"
 #include "lltemplatemessagereader.h"
+#include "lltimer.h"
+#include "message_layouts.h"
 #include "message_prehash.h"
 #include "v3dmath.h"
 #include "v3math.h"
@@ -115,6 +120,140 @@ namespace tut
 			return reader;
 		}
 
+		// CoarseLocationUpdate as message_template.msg has it, unless z_type
+		// says otherwise
+		static LLMessageTemplate* coarseLocationTemplate(EMsgVariableType z_type = MVT_U8, S32 z_size = 1)
+		{
+			defaultTemplate();
+			LLMessageTemplate* result = new LLMessageTemplate(_PREHASH_CoarseLocationUpdate, (255 << 8) | 6, MFT_MEDIUM);
+			LLMessageBlock* block = new LLMessageBlock(_PREHASH_Location, MBT_VARIABLE);
+			block->addVariable(const_cast<char*>(_PREHASH_X), MVT_U8, 1);
+			block->addVariable(const_cast<char*>(_PREHASH_Y), MVT_U8, 1);
+			block->addVariable(const_cast<char*>(_PREHASH_Z), z_type, z_size);
+			result->addBlock(block);
+			block = new LLMessageBlock(_PREHASH_Index, MBT_SINGLE);
+			block->addVariable(const_cast<char*>(_PREHASH_You), MVT_S16, 2);
+			block->addVariable(const_cast<char*>(_PREHASH_Prey), MVT_S16, 2);
+			result->addBlock(block);
+			block = new LLMessageBlock(_PREHASH_AgentData, MBT_VARIABLE);
+			block->addVariable(const_cast<char*>(_PREHASH_AgentID), MVT_LLUUID, 16);
+			result->addBlock(block);
+			result->setHandlerFunc(null_message_callback, NULL);
+			numberMap[result->mMessageNumber] = result;
+			return result;
+		}
+
+		static LLUUID agentID(S32 i)
+		{
+			LLUUID id;
+			id.mData[0] = (U8)i;
+			id.mData[15] = (U8)(i + 1);
+			return id;
+		}
+
+		static U32 buildCoarseLocation(LLMessageTemplate& messageTemplate, U8* buffer, S32 count)
+		{
+			nameMap[_PREHASH_CoarseLocationUpdate] = &messageTemplate;
+			LLTemplateMessageBuilder builder(nameMap);
+			builder.newMessage(_PREHASH_CoarseLocationUpdate);
+			for (S32 i = 0; i < count; ++i)
+			{
+				builder.nextBlock(_PREHASH_Location);
+				builder.addU8(_PREHASH_X, (U8)i);
+				builder.addU8(_PREHASH_Y, (U8)(i * 3));
+				builder.addU8(_PREHASH_Z, (U8)(255 - i));
+			}
+			builder.nextBlock(_PREHASH_Index);
+			builder.addS16(_PREHASH_You, 1);
+			builder.addS16(_PREHASH_Prey, -1);
+			for (S32 i = 0; i < count; ++i)
+			{
+				builder.nextBlock(_PREHASH_AgentData);
+				builder.addUUID(_PREHASH_AgentID, agentID(i));
+			}
+			memset(buffer, 0, LL_PACKET_ID_SIZE);
+			return builder.buildMessage(buffer, MAX_BUFFER_SIZE, 0);
+		}
+
+		// ObjectUpdateCompressed as message_template.msg has it
+		static LLMessageTemplate* objectUpdateCompressedTemplate()
+		{
+			defaultTemplate();
+			LLMessageTemplate* result = new LLMessageTemplate(_PREHASH_ObjectUpdateCompressed, 13, MFT_HIGH);
+			LLMessageBlock* block = new LLMessageBlock(_PREHASH_RegionData, MBT_SINGLE);
+			block->addVariable(const_cast<char*>(_PREHASH_RegionHandle), MVT_U64, 8);
+			block->addVariable(const_cast<char*>(_PREHASH_TimeDilation), MVT_U16, 2);
+			result->addBlock(block);
+			block = new LLMessageBlock(_PREHASH_ObjectData, MBT_VARIABLE);
+			block->addVariable(const_cast<char*>(_PREHASH_UpdateFlags), MVT_U32, 4);
+			block->addVariable(const_cast<char*>(_PREHASH_Data), MVT_VARIABLE, 2);
+			result->addBlock(block);
+			result->setHandlerFunc(null_message_callback, NULL);
+			numberMap[result->mMessageNumber] = result;
+			return result;
+		}
+
+		static U32 buildObjectUpdateCompressed(LLMessageTemplate& messageTemplate, U8* buffer, S32 count, S32 data_size)
+		{
+			nameMap[_PREHASH_ObjectUpdateCompressed] = &messageTemplate;
+			LLTemplateMessageBuilder builder(nameMap);
+			builder.newMessage(_PREHASH_ObjectUpdateCompressed);
+			builder.nextBlock(_PREHASH_RegionData);
+			builder.addU64(_PREHASH_RegionHandle, 0x0003e80000042000ULL);
+			builder.addU16(_PREHASH_TimeDilation, 65535);
+			std::vector<U8> data(data_size);
+			for (S32 i = 0; i < count; ++i)
+			{
+				std::fill(data.begin(), data.end(), (U8)i);
+				builder.nextBlock(_PREHASH_ObjectData);
+				builder.addU32(_PREHASH_UpdateFlags, 0x100 + i);
+				builder.addBinaryData(_PREHASH_Data, data.data(), data_size);
+			}
+			memset(buffer, 0, LL_PACKET_ID_SIZE);
+			return builder.buildMessage(buffer, MAX_BUFFER_SIZE, 0);
+		}
+
+		// What a handler of either message reads, through the reader getters
+		static U32 readCoarseLocation(LLTemplateMessageReader& reader)
+		{
+			U32 sum = 0;
+			S16 you, prey;
+			reader.getS16(_PREHASH_Index, _PREHASH_You, you);
+			reader.getS16(_PREHASH_Index, _PREHASH_Prey, prey);
+			sum += you + prey;
+			const S32 count = reader.getNumberOfBlocks(_PREHASH_Location);
+			for (S32 i = 0; i < count; ++i)
+			{
+				U8 x, y, z;
+				LLUUID id;
+				reader.getU8(_PREHASH_Location, _PREHASH_X, x, i);
+				reader.getU8(_PREHASH_Location, _PREHASH_Y, y, i);
+				reader.getU8(_PREHASH_Location, _PREHASH_Z, z, i);
+				reader.getUUID(_PREHASH_AgentData, _PREHASH_AgentID, id, i);
+				sum += x + y + z + id.mData[15];
+			}
+			return sum;
+		}
+
+		static U32 readObjectUpdateCompressed(LLTemplateMessageReader& reader)
+		{
+			U8 data[MAX_BUFFER_SIZE];
+			U64 handle;
+			U16 dilation;
+			reader.getU64(_PREHASH_RegionData, _PREHASH_RegionHandle, handle);
+			reader.getU16(_PREHASH_RegionData, _PREHASH_TimeDilation, dilation);
+			U32 sum = (U32)handle + dilation;
+			const S32 count = reader.getNumberOfBlocks(_PREHASH_ObjectData);
+			for (S32 i = 0; i < count; ++i)
+			{
+				U32 flags;
+				reader.getU32(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+				const S32 size = reader.getSize(_PREHASH_ObjectData, i, _PREHASH_Data);
+				reader.getBinaryData(_PREHASH_ObjectData, _PREHASH_Data, data, 0, i, MAX_BUFFER_SIZE);
+				sum += flags + size + data[size - 1];
+			}
+			return sum;
+		}
 	};
 	
 	typedef test_group<LLTemplateMessageBuilderTestData>	LLTemplateMessageBuilderTestGroup;
@@ -965,5 +1104,141 @@ namespace tut
 		ensure_equals("Ensure unchanged buffer ", strlen(outBuffer), 0);
 		delete reader;
 	}
-}
 
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<46>()
+		// compiled layouts only bind to the template they were generated from
+	{
+		LLMessageTemplate* messageTemplate = coarseLocationTemplate();
+		const LLMessageDecoder* decoder = LLMessageDecoder::find(*messageTemplate);
+		ensure("Ensure matching template decoder", decoder != NULL);
+		ensure("Ensure decoder layout", decoder->mLayout == &LLMessageLayouts::CoarseLocationUpdate::LAYOUT);
+		delete messageTemplate;
+
+		messageTemplate = coarseLocationTemplate(MVT_U16, 2);
+		ensure("Ensure no decoder for changed template", LLMessageDecoder::find(*messageTemplate) == NULL);
+		delete messageTemplate;
+
+		LLMessageTemplate messageTemplate2 = defaultTemplate();
+		ensure("Ensure no decoder for other messages", LLMessageDecoder::find(messageTemplate2) == NULL);
+	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<47>()
+		// compiled and generic decodes read the same
+	{
+		LLMessageTemplate* messageTemplate = coarseLocationTemplate();
+		U8 buffer[MAX_BUFFER_SIZE];
+		U32 builtSize = buildCoarseLocation(*messageTemplate, buffer, 7);
+
+		LLTemplateMessageReader reader(numberMap);
+		reader.validateMessage(buffer, builtSize, LLHost());
+		reader.readMessage(buffer, LLHost());
+		ensure("Ensure generic decode", reader.getDecodedMessage() == NULL);
+		const U32 generic = readCoarseLocation(reader);
+		reader.clearMessage();
+
+		messageTemplate->mDecoder = LLMessageDecoder::find(*messageTemplate);
+		reader.validateMessage(buffer, builtSize, LLHost());
+		reader.readMessage(buffer, LLHost());
+		const LLDecodedMessage* decoded = reader.getDecodedMessage();
+		ensure("Ensure compiled decode", decoded != NULL);
+		ensure_equals("Ensure same values", readCoarseLocation(reader), generic);
+		ensure_equals("Ensure blocks", reader.getNumberOfBlocks(_PREHASH_AgentData), 7);
+		ensure_equals("Ensure size", reader.getSize(_PREHASH_Index, _PREHASH_Prey), 2);
+		ensure_equals("Ensure missing variable", reader.getSize(_PREHASH_Index, _PREHASH_X), LL_VARIABLE_NOT_IN_BLOCK);
+
+		namespace coarse = LLMessageLayouts::CoarseLocationUpdate;
+		ensure_equals("Ensure typed S16", decoded->get<coarse::Index::Prey>(), -1);
+		ensure_equals("Ensure typed U8", decoded->get<coarse::Location::Z>(6), 249);
+		ensure("Ensure typed UUID", decoded->get<coarse::AgentData::AgentID>(5) == agentID(5));
+		reader.clearMessage();
+		ensure("Ensure cleared", reader.getDecodedMessage() == NULL);
+
+		LLMessageTemplate* objectTemplate = objectUpdateCompressedTemplate();
+		builtSize = buildObjectUpdateCompressed(*objectTemplate, buffer, 5, 60);
+		reader.validateMessage(buffer, builtSize, LLHost());
+		reader.readMessage(buffer, LLHost());
+		const U32 generic2 = readObjectUpdateCompressed(reader);
+		reader.clearMessage();
+
+		objectTemplate->mDecoder = LLMessageDecoder::find(*objectTemplate);
+		ensure("Ensure object decoder", objectTemplate->mDecoder != NULL);
+		reader.validateMessage(buffer, builtSize, LLHost());
+		reader.readMessage(buffer, LLHost());
+		ensure("Ensure compiled object decode", reader.getDecodedMessage() != NULL);
+		ensure_equals("Ensure same object values", readObjectUpdateCompressed(reader), generic2);
+		S32 size = 0;
+		const U8* data = reader.getDecodedMessage()->getBinary<LLMessageLayouts::ObjectUpdateCompressed::ObjectData::Data>(size, 4);
+		ensure_equals("Ensure binary size", size, 60);
+		ensure_equals("Ensure binary data", data[59], 4);
+		reader.clearMessage();
+
+		delete messageTemplate;
+		delete objectTemplate;
+	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<48>()
+		// truncated messages are left to the generic decode
+	{
+		LLMessageTemplate* messageTemplate = coarseLocationTemplate();
+		messageTemplate->mDecoder = LLMessageDecoder::find(*messageTemplate);
+		U8 buffer[MAX_BUFFER_SIZE];
+		const U32 builtSize = buildCoarseLocation(*messageTemplate, buffer, 4);
+
+		LLTemplateMessageReader reader(numberMap);
+		reader.validateMessage(buffer, builtSize - 8, LLHost());
+		reader.readMessage(buffer, LLHost());
+		ensure("Ensure generic decode", reader.getDecodedMessage() == NULL);
+		ensure_equals("Ensure blocks", reader.getNumberOfBlocks(_PREHASH_AgentData), 4);
+		LLUUID id;
+		reader.getUUID(_PREHASH_AgentData, _PREHASH_AgentID, id, 3);
+		ensure("Ensure default value", id.isNull());
+		reader.clearMessage();
+		delete messageTemplate;
+	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<49>()
+		// decode and read time, generic against compiled
+	{
+		const S32 PASSES = 20000;
+		LLMessageTemplate* coarseTemplate = coarseLocationTemplate();
+		LLMessageTemplate* objectTemplate = objectUpdateCompressedTemplate();
+		U8 coarse[MAX_BUFFER_SIZE];
+		U8 objects[MAX_BUFFER_SIZE];
+		const U32 coarseSize = buildCoarseLocation(*coarseTemplate, coarse, 60);
+		const U32 objectsSize = buildObjectUpdateCompressed(*objectTemplate, objects, 12, 90);
+		LLTemplateMessageReader reader(numberMap);
+
+		F64 times[2];
+		U32 sums[2] = { 0, 0 };
+		for (S32 compiled = 0; compiled < 2; ++compiled)
+		{
+			coarseTemplate->mDecoder = compiled ? LLMessageDecoder::find(*coarseTemplate) : NULL;
+			objectTemplate->mDecoder = compiled ? LLMessageDecoder::find(*objectTemplate) : NULL;
+			LLTimer timer;
+			for (S32 p = 0; p < PASSES; ++p)
+			{
+				reader.validateMessage(coarse, coarseSize, LLHost());
+				reader.readMessage(coarse, LLHost());
+				sums[compiled] += readCoarseLocation(reader);
+				reader.clearMessage();
+
+				reader.validateMessage(objects, objectsSize, LLHost());
+				reader.readMessage(objects, LLHost());
+				sums[compiled] += readObjectUpdateCompressed(reader);
+				reader.clearMessage();
+			}
+			times[compiled] = timer.getElapsedTimeF64() / PASSES;
+		}
+		ensure_equals("Ensure same values", sums[1], sums[0]);
+
+		std::cout << "\nDecoding and reading a CoarseLocationUpdate and an ObjectUpdateCompressed: generic "
+				  << times[0] * 1000000.0 << " us, compiled " << times[1] * 1000000.0 << " us" << std::endl;
+
+		delete coarseTemplate;
+		delete objectTemplate;
+	}
+}
@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+"""\
+@file message_layouts.py
+@brief Generates compile time layouts of message template messages.
+
+$LicenseInfo:firstyear=2020&license=viewerlgpl$
+Second Life Viewer Source Code
+Copyright (C) 2020, Linden Research, Inc.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation;
+version 2.1 of the License only.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+$/LicenseInfo$
+"""
+
+"""message_layouts writes a C++ header describing the given messages of a
+message template as constexpr LLMsgLayout structures (see llmessagelayout.h),
+for LLDecodedMessage to decode them without walking LLMessageTemplate.
+
+usage: message_layouts.py TEMPLATE OUTPUT MESSAGE...
+"""
+
+import sys
+import os.path
+
+# Same lookup of indra/lib/python as template_verifier.py
+def add_indra_lib_path():
+    root = os.path.realpath(__file__)
+    dir = os.path.dirname(root)
+    if dir not in sys.path:
+        sys.path.insert(0, dir)
+
+    while root != os.path.sep:
+        root = os.path.dirname(root)
+        dir = os.path.join(root, 'indra', 'lib', 'python')
+        if os.path.isdir(dir):
+            if dir not in sys.path:
+                sys.path.insert(0, dir)
+            break
+    else:
+        sys.stderr.write("This script is not inside a valid installation.\n")
+        sys.exit(1)
+
+add_indra_lib_path()
+
+from indra.ipc import llmessage
+
+# Type names and sizes as LLTemplateParser::parseVariable() sets them
+TYPES = {
+    "U8": ("MVT_U8", 1),
+    "U16": ("MVT_U16", 2),
+    "U32": ("MVT_U32", 4),
+    "U64": ("MVT_U64", 8),
+    "S8": ("MVT_S8", 1),
+    "S16": ("MVT_S16", 2),
+    "S32": ("MVT_S32", 4),
+    "S64": ("MVT_S64", 8),
+    "F32": ("MVT_F32", 4),
+    "F64": ("MVT_F64", 8),
+    "LLVector3": ("MVT_LLVector3", 12),
+    "LLVector3d": ("MVT_LLVector3d", 24),
+    "LLVector4": ("MVT_LLVector4", 16),
+    "LLQuaternion": ("MVT_LLQuaternion", 12),
+    "LLUUID": ("MVT_LLUUID", 16),
+    "BOOL": ("MVT_BOOL", 1),
+    "IPADDR": ("MVT_IP_ADDR", 4),
+    "IPPORT": ("MVT_IP_PORT", 2),
+    "Fixed": ("MVT_FIXED", None),
+    "Variable": ("MVT_VARIABLE", None),
+}
+
+FREQUENCIES = {
+    "High": ("MFT_HIGH", 0),
+    "Medium": ("MFT_MEDIUM", 255 << 8),
+    "Low": ("MFT_LOW", (255 << 24) | (255 << 16)),
+    "Fixed": ("MFT_LOW", (255 << 24) | (255 << 16)),
+}
+
+BLOCK_TYPES = {
+    "Single": "MBT_SINGLE",
+    "Multiple": "MBT_MULTIPLE",
+    "Variable": "MBT_VARIABLE",
+}
+
+HEADER = """\
+/**
+ * @file message_layouts.h
+ * @brief Layouts of the messages LLDecodedMessage decodes
+ *
+ * Generated by scripts/message_layouts.py from %(template)s, do not edit.
+ */
+
+#ifndef LL_MESSAGE_LAYOUTS_H
+#define LL_MESSAGE_LAYOUTS_H
+
+#include "llmessagelayout.h"
+
+namespace LLMessageLayouts
+{
+"""
+
+FOOTER = """\
+}
+
+// X(name) for each message above
+#define LL_MESSAGE_LAYOUTS(X) \\
+%(list)s
+
+#endif // LL_MESSAGE_LAYOUTS_H
+"""
+
+def write_message(out, message):
+    frequency, base = FREQUENCIES[message.priority]
+    out.append("\tnamespace %s\n\t{\n" % message.name)
+
+    for block in message.blocks:
+        out.append("\t\tinline constexpr LLMsgFieldLayout %s_FIELDS[] =\n\t\t{\n" % block.name)
+        offset = 0
+        for variable in block.variables:
+            type, size = TYPES[variable.type]
+            if size is None:
+                size = int(variable.size)
+            out.append("\t\t\t{ \"%s\", %s, %d, %d },\n" % (variable.name, type, size, offset))
+            if offset >= 0:
+                offset = -1 if type == "MVT_VARIABLE" else offset + size
+        out.append("\t\t};\n")
+        block.fixed_size = offset
+
+    out.append("\t\tinline constexpr LLMsgBlockLayout BLOCKS[] =\n\t\t{\n")
+    for block in message.blocks:
+        out.append("\t\t\t{ \"%s\", %s, %d, %s_FIELDS, %d, %d },\n" % (
+            block.name, BLOCK_TYPES[block.repeat], int(block.count or 1),
+            block.name, len(block.variables), block.fixed_size))
+    out.append("\t\t};\n")
+
+    out.append("\t\tinline constexpr LLMsgLayout LAYOUT = { \"%s\", 0x%X, %s, BLOCKS, %d };\n" % (
+        message.name, base | message.number, frequency, len(message.blocks)))
+
+    for b, block in enumerate(message.blocks):
+        out.append("\n\t\tnamespace %s\n\t\t{\n" % block.name)
+        for f, variable in enumerate(block.variables):
+            out.append("\t\t\ttypedef LLMsgField<LAYOUT, %d, %d> %s;\n" % (b, f, variable.name))
+        out.append("\t\t}\n")
+
+    out.append("\t}\n")
+
+def main(argv):
+    if len(argv) < 4:
+        sys.stderr.write("usage: message_layouts.py TEMPLATE OUTPUT MESSAGE...\n")
+        return 1
+    template_file, output_file, names = argv[1], argv[2], argv[3:]
+
+    with open(template_file) as f:
+        template = llmessage.parseTemplateFile(f)
+    out = [HEADER % {"template": os.path.basename(template_file)}]
+    for i, name in enumerate(names):
+        if name not in template.messages:
+            sys.stderr.write("%s is not in %s\n" % (name, template_file))
+            return 1
+        if i:
+            out.append("\n")
+        write_message(out, template.messages[name])
+    out.append(FOOTER % {"list": " \\\n".join("\tX(%s)" % name for name in names)})
+
+    contents = "".join(out)
+    # Leave the header alone when nothing changed, so nothing is rebuilt
+    if os.path.exists(output_file):
+        with open(output_file) as f:
+            if f.read() == contents:
+                return 0
+    with open(output_file, "w") as f:
+        f.write(contents)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))